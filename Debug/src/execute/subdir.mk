@@ -5,18 +5,24 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 CPP_SRCS += \
 ../src/execute/execute.cpp \
+../src/execute/execute_analytics.cpp \
 ../src/execute/order_leg.cpp \
-../src/execute/order_ticket.cpp 
+../src/execute/order_ticket.cpp \
+../src/execute/paper_broker.cpp 
 
 OBJS += \
 ./src/execute/execute.o \
+./src/execute/execute_analytics.o \
 ./src/execute/order_leg.o \
-./src/execute/order_ticket.o 
+./src/execute/order_ticket.o \
+./src/execute/paper_broker.o 
 
 CPP_DEPS += \
 ./src/execute/execute.d \
+./src/execute/execute_analytics.d \
 ./src/execute/order_leg.d \
-./src/execute/order_ticket.d 
+./src/execute/order_ticket.d \
+./src/execute/paper_broker.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
@@ -8,7 +8,10 @@ CPP_SRCS += \
 ../src/common.cpp \
 ../src/curl_connect.cpp \
 ../src/error.cpp \
+../src/executor.cpp \
+../src/flight_recorder.cpp \
 ../src/tdma_connect.cpp \
+../src/token_store.cpp \
 ../src/util.cpp \
 ../src/websocket_connect.cpp 
 
@@ -17,7 +20,10 @@ OBJS += \
 ./src/common.o \
 ./src/curl_connect.o \
 ./src/error.o \
+./src/executor.o \
+./src/flight_recorder.o \
 ./src/tdma_connect.o \
+./src/token_store.o \
 ./src/util.o \
 ./src/websocket_connect.o 
 
@@ -26,7 +32,10 @@ CPP_DEPS += \
 ./src/common.d \
 ./src/curl_connect.d \
 ./src/error.d \
+./src/executor.d \
+./src/flight_recorder.d \
 ./src/tdma_connect.d \
+./src/token_store.d \
 ./src/util.d \
 ./src/websocket_connect.d 
 
@@ -22,6 +22,13 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 #include <string>
 #include <algorithm>
 #include <cctype>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "tdma_common.h"
 
 
 bool
@@ -79,4 +86,47 @@ bounded( T val, T low, T high )
     return std::max(low, std::min(high, val));
 }
 
+
+/*
+ * run 'worker' on this thread and (up to) nthreads - 1 tasks on the
+ * library's thread pool; returns when all of them are done. Tasks that
+ * haven't started by the time this thread's worker returns don't run, so
+ * a busy pool just means less parallelism, never a wait.
+ */
+inline void
+run_parallel( size_t nthreads, const std::function<void()>& worker )
+{
+    struct State{
+        std::mutex mtx;
+        std::condition_variable cv;
+        bool closed = false;
+        unsigned int running = 0;
+    };
+
+    auto state = std::make_shared<State>();
+    const std::function<void()> *w = &worker;
+    for( size_t i = 1; i < nthreads; ++i ){
+        tdma::ExecutorPost( [state, w](){
+            {
+                std::lock_guard<std::mutex> _(state->mtx);
+                if( state->closed )
+                    return;
+                ++state->running;
+            }
+            (*w)();
+            {
+                std::lock_guard<std::mutex> _(state->mtx);
+                --state->running;
+            }
+            state->cv.notify_all();
+        } );
+    }
+
+    worker();
+
+    std::unique_lock<std::mutex> lock(state->mtx);
+    state->closed = true;
+    state->cv.wait( lock, [&state](){ return state->running == 0; } );
+}
+
 #endif /* INCLUDE_COMMON_H_ */
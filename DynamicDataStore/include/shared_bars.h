@@ -0,0 +1,189 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef INCLUDE_SHARED_BARS_H_
+#define INCLUDE_SHARED_BARS_H_
+
+#include <string>
+#include <set>
+#include <map>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+#include "tdma_data_store.h"
+
+/*
+ * The most recent 'nbars' of each symbol in a named shared memory segment,
+ * written by the one process that runs the store, read by any number of
+ * others.
+ *
+ *   [ SharedBarsHeader ][ SharedSymbol x max_symbols ][ bars x max_symbols ]
+ *
+ *   bars: 'nbars' SharedBar per symbol, minute 'm' at m % nbars
+ *
+ * [start_min, end_min] of a symbol is its committed watermark. 'stamp' works
+ * like a seqlock: odd while the writer changes bars/watermark, so readers
+ * never lock - they copy what they need and retry if the stamp moved.
+ */
+
+const uint64_t SHARED_BARS_MAGIC = 0x5444414d41444453ULL; // "TDAMADDS"
+const uint32_t SHARED_BARS_VERSION = 1;
+const size_t SHARED_BARS_SYMBOL_MAX = 15;
+
+static_assert( ATOMIC_LLONG_LOCK_FREE == 2,
+               "shared bars require lock-free 64 bit atomics" );
+
+struct alignas(64) SharedBarsHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t max_symbols;
+    uint32_t nbars;
+    std::atomic<uint32_t> active;
+    std::atomic<uint64_t> generation; // incr when symbols added/removed
+};
+
+struct alignas(64) SharedSymbol {
+    std::atomic<uint64_t> stamp;
+    uint64_t start_min;
+    uint64_t end_min;
+    uint32_t used;
+    char symbol[SHARED_BARS_SYMBOL_MAX + 1];
+};
+
+struct SharedBar {
+    uint64_t min_since_epoch;
+    double open;
+    double high;
+    double low;
+    double close;
+    int64_t volume;
+};
+
+
+class SharedBarsSegment {
+    std::string _name;
+    void *_addr;
+    size_t _size;
+    bool _owner;
+
+public:
+    /* create (or replace) read/write */
+    SharedBarsSegment( const std::string& name,
+                       unsigned int nbars,
+                       unsigned int max_symbols );
+
+    /* attach read-only */
+    explicit SharedBarsSegment( const std::string& name );
+
+    ~SharedBarsSegment();
+
+    SharedBarsSegment( const SharedBarsSegment& ) = delete;
+
+    SharedBarsSegment&
+    operator=( const SharedBarsSegment& ) = delete;
+
+    std::string
+    get_name() const
+    { return _name; }
+
+    SharedBarsHeader*
+    header() const
+    { return reinterpret_cast<SharedBarsHeader*>(_addr); }
+
+    SharedSymbol*
+    symbol(unsigned int i) const
+    { return reinterpret_cast<SharedSymbol*>(header() + 1) + i; }
+
+    SharedBar*
+    bars(unsigned int i) const
+    {
+        return reinterpret_cast<SharedBar*>( symbol(header()->max_symbols) )
+               + static_cast<size_t>(i) * header()->nbars;
+    }
+};
+
+
+class SharedBarsWriter {
+    SharedBarsSegment _segment;
+    std::map<std::string, unsigned int> _slots;
+
+public:
+    SharedBarsWriter( const std::string& name,
+                      unsigned int nbars,
+                      unsigned int max_symbols );
+
+    ~SharedBarsWriter();
+
+    /* (re)write bars from 'from_min' through the end of 'data'(newest first) */
+    bool
+    publish( const std::string& symbol,
+             const std::deque<ds::OHLCVData>& data,
+             unsigned long long min_start,
+             unsigned long long min_end,
+             unsigned long long from_min );
+
+    void
+    remove( const std::string& symbol );
+
+    bool
+    contains( const std::string& symbol ) const
+    { return _slots.count(symbol) > 0; }
+
+    std::string
+    get_name() const
+    { return _segment.get_name(); }
+};
+
+
+class SharedBarsReader {
+    SharedBarsSegment _segment;
+
+public:
+    /* [start,end] (minutes) to copy, given the watermark */
+    typedef std::function<std::pair<long long, long long>(
+        long long, long long)> range_func_ty;
+
+    explicit SharedBarsReader( const std::string& name );
+
+    bool
+    is_writer_active() const
+    { return _segment.header()->active.load(std::memory_order_acquire); }
+
+    std::set<std::string>
+    get_symbols() const;
+
+    /* -1 if not shared */
+    int
+    find( const std::string& symbol ) const;
+
+    /*
+     * copy (newest first) a consistent snapshot into 'out';
+     * false if 'symbol' is no longer at 'slot'
+     */
+    bool
+    read( int slot,
+          const std::string& symbol,
+          range_func_ty range_func,
+          std::vector<ds::OHLCVData>& out,
+          std::pair<long long, long long>& watermark ) const;
+};
+
+#endif /* INCLUDE_SHARED_BARS_H_ */
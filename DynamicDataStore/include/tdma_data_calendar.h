@@ -0,0 +1,194 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+
+#ifndef TDMA_DATA_CALENDAR_H_
+#define TDMA_DATA_CALENDAR_H_
+
+#include <string>
+#include <vector>
+#include <array>
+#include <deque>
+#include <chrono>
+
+#include "tdma_data_store.h"
+#include "tdma_api_get.h"
+
+namespace ds {
+
+/*
+ * epoch-minute <-> civil (UTC) time, w/o gmtime/timegm (no locking, no
+ * allocation, valid for negative minutes)
+ */
+struct CivilTime {
+    int year;
+    unsigned int month; // 1 - 12
+    unsigned int day; // 1 - 31
+    unsigned int hour;
+    unsigned int minute;
+    unsigned int weekday; // 0 = Sunday
+};
+
+long long
+DaysFromCivil( int year, unsigned int month, unsigned int day );
+
+CivilTime
+ToCivilTime( std::chrono::minutes min_since_epoch );
+
+std::chrono::minutes
+FromCivilTime( int year,
+               unsigned int month,
+               unsigned int day,
+               unsigned int hour = 0,
+               unsigned int minute = 0 );
+
+
+/* [start, end) minutes-since-epoch; -1 if none */
+struct SessionInterval {
+    long long start;
+    long long end;
+
+    bool
+    contains( long long m ) const
+    { return start >= 0 && m >= start && m < end; }
+
+    long long
+    length() const
+    { return (start >= 0 && end > start) ? end - start : 0; }
+};
+
+struct SessionHours {
+    bool is_open;
+    SessionInterval pre;
+    SessionInterval regular; // first start to last end
+    SessionInterval post;
+};
+
+
+/*
+ * TradingCalendar - session hours per market from MarketHoursGetter
+ *
+ * refresh() loads a horizon of days(one throttled request per day not already
+ * loaded) and, if constructed w/ a path, stores them there; constructing w/
+ * the same path later loads them back w/o any requests.
+ *
+ * Days are kept in one contiguous table per market (by date, US/Eastern)
+ * along w/ running totals of session minutes and the next open day, so
+ * queries are O(1). 'extended' includes pre/post market.
+ *
+ * Only one product per market is tracked - the first one in the response
+ * unless 'product' is passed to refresh() (e.g "EQ", "EQO", "DFE").
+ *
+ * Queries about minutes on days not loaded throw std::out_of_range.
+ */
+class TradingCalendar {
+public:
+    typedef tdma::MarketType MarketType;
+
+    /* empty path: don't persist */
+    explicit TradingCalendar( const std::string& path = "" );
+
+    /* 'ndays' starting at 'from' (today if ERROR_MINUTES) */
+    bool
+    refresh( Credentials& creds,
+             MarketType market,
+             unsigned int ndays,
+             std::chrono::minutes from = ERROR_MINUTES,
+             const std::string& product = "",
+             bool reload = false );
+
+    bool
+    store() const;
+
+    std::string
+    get_path() const
+    { return _path; }
+
+    /* range of loaded days (as minutes since epoch), ERROR_MINUTES if none */
+    std::pair<std::chrono::minutes, std::chrono::minutes>
+    get_horizon( MarketType market ) const;
+
+    /* the session of the day(US/Eastern) 'min_since_epoch' falls on */
+    SessionHours
+    get_session( MarketType market, std::chrono::minutes min_since_epoch ) const;
+
+    bool
+    is_trading_day( MarketType market,
+                    std::chrono::minutes min_since_epoch ) const;
+
+    bool
+    is_open( MarketType market,
+             std::chrono::minutes min_since_epoch,
+             bool extended = false ) const;
+
+    /* start of the first session at or after 'min_since_epoch' */
+    std::chrono::minutes
+    next_session_start( MarketType market,
+                        std::chrono::minutes min_since_epoch,
+                        bool extended = false ) const;
+
+    /* in-session minutes in [start, end) */
+    long long
+    session_minutes_between( MarketType market,
+                             std::chrono::minutes start_min_since_epoch,
+                             std::chrono::minutes end_min_since_epoch,
+                             bool extended = false ) const;
+
+private:
+    struct Day {
+        SessionHours hours;
+        bool is_loaded;
+    };
+
+    struct Table {
+        long long first_day;
+        std::vector<Day> days; // first_day + i
+        std::vector<long long> cum_regular; // minutes before day i
+        std::vector<long long> cum_extended;
+        std::vector<long long> next_open; // first open day >= i, -1 if none
+
+        Table() : first_day(-1) {}
+    };
+
+    std::string _path;
+    std::array<Table, 5> _tables; // by MarketType
+
+    const Table&
+    _table( MarketType market ) const;
+
+    const Day*
+    _day( const Table& t, long long day ) const;
+
+    const Day&
+    _day_or_throw( const Table& t, long long m ) const;
+
+    void
+    _set_day( MarketType market, long long day, const SessionHours& hours );
+
+    void
+    _rebuild( MarketType market );
+
+    bool
+    _load();
+
+    static long long
+    _minutes_before( const Table& t, long long m, bool extended );
+};
+
+}; /* namespace ds */
+
+#endif /* TDMA_DATA_CALENDAR_H_ */
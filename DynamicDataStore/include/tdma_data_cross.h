@@ -0,0 +1,127 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+
+#ifndef TDMA_DATA_CROSS_H_
+#define TDMA_DATA_CROSS_H_
+
+#include <string>
+#include <set>
+#include <map>
+#include <vector>
+#include <memory>
+#include <deque>
+#include <chrono>
+
+#include "tdma_data_store.h"
+
+namespace ds {
+
+struct CrossSectionStats {
+    unsigned long long min_since_epoch;
+    double value;
+    unsigned int rank; // 1 = largest value, 0 = not ranked
+    /*
+     * 0 - 100: (mean position among tied values, from 0) / (count - 1);
+     * 50 if only one symbol was ranked
+     */
+    double percentile;
+    double zscore;
+    unsigned int count; // symbols ranked that minute
+
+    static const CrossSectionStats null;
+};
+
+
+/*
+ * CrossSection - ranks, percentiles and z-scores of metrics across symbols
+ *
+ *   CrossSection cs({ {"ret", "close / lag(close, 1) - 1"},
+ *                     {"surge", "volume / avg(volume, 30)"},
+ *                     {"vol", "std(close / lag(close, 1), 30)"} });
+ *
+ * Each metric is a Screen expression (see tdma_data_screen.h) evaluated
+ * incrementally for every symbol. A minute is 'closed' once a bar from a
+ * later minute has been received (for any symbol); update() computes the
+ * cross-section of each metric for every minute closed since the last call -
+ * in parallel across metrics/minutes(on the library's thread pool, like
+ * Screen) - and keeps the last 'nminutes' of them.
+ *
+ * Symbols w/o a value for a minute when it closes (not enough history, no bar
+ * yet etc.) aren't ranked for that minute. Equal values share a rank and
+ * percentile.
+ */
+class CrossSection {
+public:
+    /* throws std::invalid_argument if a metric can't be compiled */
+    CrossSection( const std::map<std::string, std::string>& metrics,
+                  unsigned int nminutes = 390,
+                  unsigned int nthreads = 0 ); // 0 = hardware concurrency
+
+    ~CrossSection();
+
+    CrossSection( const CrossSection& ) = delete;
+
+    CrossSection&
+    operator=( const CrossSection& ) = delete;
+
+    std::set<std::string>
+    get_metrics() const;
+
+    unsigned int
+    get_nminutes() const;
+
+    /* returns the minutes computed by this call, oldest first */
+    std::vector<std::chrono::minutes>
+    update( const std::set<std::string>& symbols );
+
+    std::vector<std::chrono::minutes>
+    update(); // all symbols in the store
+
+    /* most recent minute computed, ERROR_MINUTES if none */
+    std::chrono::minutes
+    last_minute() const;
+
+    /* CrossSectionStats::null if not ranked; throws on unknown metric */
+    CrossSectionStats
+    get( const std::string& metric,
+         const std::string& symbol,
+         std::chrono::minutes min_since_epoch ) const;
+
+    CrossSectionStats
+    get( const std::string& metric, const std::string& symbol ) const; // last
+
+    /* the stats of 'symbol' for each stored minute, most recent first */
+    std::vector<CrossSectionStats>
+    series( const std::string& metric, const std::string& symbol ) const;
+
+    /* all symbols ranked at a minute, by rank */
+    std::vector<std::pair<std::string, CrossSectionStats>>
+    ranking( const std::string& metric,
+             std::chrono::minutes min_since_epoch ) const;
+
+    std::vector<std::pair<std::string, CrossSectionStats>>
+    ranking( const std::string& metric ) const; // last
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> _impl;
+};
+
+}; /* namespace ds */
+
+#endif /* TDMA_DATA_CROSS_H_ */
@@ -0,0 +1,105 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+
+#ifndef TDMA_DATA_SCREEN_H_
+#define TDMA_DATA_SCREEN_H_
+
+#include <string>
+#include <set>
+#include <vector>
+#include <memory>
+#include <deque>
+#include <chrono>
+
+#include "tdma_data_store.h"
+
+namespace ds {
+
+/*
+ * Screen - an expression over the bar columns of each symbol
+ *
+ *   e.g "close > sma(close, 20) and volume > 2 * sma(volume, 50)"
+ *
+ *   columns:     open high low close volume
+ *   arithmetic:  + - * /  (unary -)
+ *   comparison:  < <= > >= == !=   (1 or 0)
+ *   logical:     and or not        (non-zero is true)
+ *   functions:   sma(x,n) avg(x,n) sum(x,n) min(x,n) max(x,n) std(x,n)
+ *                lag(x,n) abs(x)
+ *
+ * The expression is compiled once into a plan (common sub-expressions
+ * are shared) that's run over contiguous per-symbol column buffers, in
+ * parallel across symbols (this thread + up to nthreads - 1 tasks on the
+ * library's thread pool, see tdma::SetExecutorPoolSize). Each symbol keeps only the bars the plan needs
+ * ('lookback') plus 'nbars' results; after the first evaluate() only bars
+ * that are new (or were revised) are fetched and evaluated.
+ *
+ * Empty (filler) bars take the previous close w/ 0 volume. Values that
+ * can't be computed (e.g not enough history for a window) are NaN and
+ * never 'true'.
+ */
+class Screen {
+public:
+    /* throws std::invalid_argument if expression can't be compiled */
+    Screen( const std::string& expression,
+            unsigned int nbars = 1,
+            unsigned int nthreads = 0 ); // 0 = hardware concurrency
+
+    ~Screen();
+
+    Screen( const Screen& ) = delete;
+
+    Screen&
+    operator=( const Screen& ) = delete;
+
+    std::string
+    get_expression() const;
+
+    /* bars needed before the first result is valid */
+    unsigned int
+    get_lookback() const;
+
+    unsigned int
+    get_nbars() const;
+
+    /* symbols whose most recent result is true */
+    std::set<std::string>
+    evaluate( const std::set<std::string>& symbols );
+
+    std::set<std::string>
+    evaluate(); // all symbols in the store
+
+    /* last 'nbars' results from the last evaluate(), most recent first */
+    std::vector<double>
+    series( const std::string& symbol ) const;
+
+    std::chrono::minutes
+    end_minute( const std::string& symbol ) const;
+
+    /* drop cached buffers (all if empty) so they're rebuilt */
+    void
+    reset( const std::string& symbol = "" );
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> _impl;
+};
+
+}; /* namespace ds */
+
+#endif /* TDMA_DATA_SCREEN_H_ */
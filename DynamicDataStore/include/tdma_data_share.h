@@ -0,0 +1,119 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+
+#ifndef TDMA_DATA_SHARE_H_
+#define TDMA_DATA_SHARE_H_
+
+#include <string>
+#include <set>
+#include <vector>
+#include <memory>
+#include <deque>
+#include <chrono>
+#include <functional>
+
+#include "tdma_data_store.h"
+
+class SharedBarsReader;
+
+namespace ds {
+
+/*
+ * SharedDataAccessor - read-only access to the bars another process
+ * publishes w/ ds::Share(name)
+ *
+ * Doesn't require Initialize() - the process only attaches to the named
+ * segment. Each call copies a consistent snapshot of the bars it needs,
+ * without locking the writer. Only the most recent 'nbars' (see Share) are
+ * available; index 0 is the most recent bar and copies are most-recent-first,
+ * as with DataAccessor.
+ *
+ * Throws std::runtime_error if the segment can't be attached and
+ * std::logic_error if the symbol isn't (or is no longer) shared.
+ */
+class SharedDataAccessor {
+public:
+    SharedDataAccessor( const std::string& name, const std::string& symbol );
+
+    void
+    set_symbol( const std::string& symbol );
+
+    std::string
+    get_symbol() const;
+
+    std::string
+    get_name() const;
+
+    /* false once the writer has stopped sharing (or exited cleanly) */
+    bool
+    is_writer_active() const;
+
+    // QUERY
+    std::chrono::minutes
+    start_minute() const;
+
+    std::chrono::minutes
+    end_minute() const;
+
+    std::pair<std::chrono::minutes, std::chrono::minutes>
+    start_end_minutes() const;
+
+    // COPY
+    OHLCVData
+    operator[](unsigned int indx) const;
+
+    OHLCVData
+    operator[](std::chrono::minutes min_since_epoch) const;
+
+    std::vector<OHLCVData>
+    copy_between(std::chrono::minutes start_min_since_epoch,
+                 std::chrono::minutes end_min_since_epoch) const;
+
+    std::vector<OHLCVData>
+    copy_between(std::chrono::minutes start_min_since_epoch) const;
+
+    std::vector<OHLCVData>
+    copy_between(unsigned int start_indx, unsigned int end_indx=0) const;
+
+    std::vector<OHLCVData>
+    copy_between() const;
+
+    /* symbols currently shared under 'name' */
+    static std::set<std::string>
+    GetSymbols( const std::string& name );
+
+private:
+    typedef std::function<std::pair<long long, long long>(
+        long long, long long)> range_func_ty;
+
+    std::shared_ptr<SharedBarsReader> _reader;
+    std::string _name;
+    std::string _symbol;
+    mutable int _slot;
+
+    void
+    _set_symbol( const std::string& symbol );
+
+    std::vector<OHLCVData>
+    _read( range_func_ty range_func,
+           std::pair<long long, long long>& watermark ) const;
+};
+
+}; /* namespace ds */
+
+#endif /* TDMA_DATA_SHARE_H_ */
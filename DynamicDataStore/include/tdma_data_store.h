@@ -113,6 +113,22 @@ Contains( const std::string& symbol );
 void
 Update();
 
+/*
+ * publish the most recent 'nbars' of each symbol to the named shared memory
+ * segment on each Update(); other processes read them w/ SharedDataAccessor
+ * (tdma_data_share.h)
+ */
+bool
+Share( const std::string& name,
+       unsigned int nbars = 60 * 24 * 5, // 5 days
+       unsigned int max_symbols = 256 );
+
+void
+StopSharing();
+
+bool
+IsSharing();
+
 
 
 class DataAccessor {
@@ -24,6 +24,7 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 
 #include "common.h"
 #include "backing_store.h"
+#include "_probes.h"
 
 using FFLAG = std::ios_base;
 using std::string;
@@ -198,6 +199,7 @@ BackingStore::read_from_symbol_store( const string& symbol,
 
     long long nlines, nelems_front, nelems_back;
     bool result_front, result_back;
+    TDMA_PROBE1(load_start, symbol.c_str());
 
     // FRONT
     std::tie(result_front, nlines, nelems_front) = 
@@ -216,6 +218,8 @@ BackingStore::read_from_symbol_store( const string& symbol,
         f->second.back.file->clear();
 
     log_read_write<false, false>(result_back, nlines, nelems_back, symbol);
+    TDMA_PROBE3(load_end, symbol.c_str(), result_front && result_back,
+                std::max(0LL, nelems_front) + std::max(0LL, nelems_back));
 
     return std::make_tuple(
         result_front && result_back,
@@ -240,6 +244,7 @@ BackingStore::write_to_symbol_store( const string& symbol,
 
     long long nlines, nelems_front, nelems_back;
     bool result_front, result_back;
+    TDMA_PROBE1(store_start, symbol.c_str());
 
     // FRONT
     std::tie(result_front, nlines, nelems_front) 
@@ -252,6 +257,8 @@ BackingStore::write_to_symbol_store( const string& symbol,
         = _write_store(f->second.back, write_func_back);
 
     log_read_write<true, false>(result_back, nlines, nelems_back, symbol);
+    TDMA_PROBE3(store_end, symbol.c_str(), result_front && result_back,
+                std::max(0LL, nelems_front) + std::max(0LL, nelems_back));
 
     return std::make_tuple(
         result_front && result_back,
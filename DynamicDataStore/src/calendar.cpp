@@ -0,0 +1,622 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <stdexcept>
+#include <algorithm>
+
+#include "common.h"
+#include "tdma_data_calendar.h"
+
+#include "_json_parse.h"
+
+using std::string;
+
+namespace {
+
+using namespace ds;
+
+const long long MIN_IN_DAY = 24 * 60;
+const int NMARKETS = 5;
+
+const SessionInterval NO_INTERVAL = {-1, -1};
+const SessionHours CLOSED = {false, NO_INTERVAL, NO_INTERVAL, NO_INTERVAL};
+
+inline long long
+floor_div(long long a, long long b)
+{ return (a >= 0) ? a / b : -((-a + b - 1) / b); }
+
+
+/* US/Eastern (rules since 2007) */
+long long
+eastern_offset(long long m)
+{
+    int y = ToCivilTime( std::chrono::minutes(m) ).year;
+
+    unsigned int w = ToCivilTime( FromCivilTime(y, 3, 1) ).weekday;
+    unsigned int dst_beg_day = 1 + (7 - w) % 7 + 7; // 2nd Sunday March
+    w = ToCivilTime( FromCivilTime(y, 11, 1) ).weekday;
+    unsigned int dst_end_day = 1 + (7 - w) % 7; // 1st Sunday November
+
+    long long beg = FromCivilTime(y, 3, dst_beg_day, 7).count(); // 2AM EST
+    long long end = FromCivilTime(y, 11, dst_end_day, 6).count(); // 2AM EDT
+    return (m >= beg && m < end) ? -4 * 60 : -5 * 60;
+}
+
+
+/* date (days since epoch) in US/Eastern */
+inline long long
+eastern_day(long long m)
+{ return floor_div(m + eastern_offset(m), MIN_IN_DAY); }
+
+
+string
+date_string(long long day)
+{
+    CivilTime c = ToCivilTime( std::chrono::minutes(day * MIN_IN_DAY) );
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%04d-%02u-%02u", c.year, c.month, c.day);
+    return buf;
+}
+
+
+bool
+parse_digits(const string& s, size_t pos, size_t n, int& v)
+{
+    if( pos + n > s.size() )
+        return false;
+    v = 0;
+    for( size_t i = pos; i < pos + n; ++i ){
+        if( s[i] < '0' || s[i] > '9' )
+            return false;
+        v = v * 10 + (s[i] - '0');
+    }
+    return true;
+}
+
+
+/* YYYY-MM-DD, -1 if bad */
+long long
+parse_date(const string& s)
+{
+    int y, m, d;
+    if( !parse_digits(s, 0, 4, y) || !parse_digits(s, 5, 2, m)
+        || !parse_digits(s, 8, 2, d) || m < 1 || m > 12 || d < 1 || d > 31 )
+        return -1;
+    return DaysFromCivil(y, m, d);
+}
+
+
+/* YYYY-MM-DDThh:mm:ss(+|-)hh:mm or ...Z, -1 if bad */
+long long
+parse_timestamp(const string& s)
+{
+    long long day = parse_date(s);
+    int hh, mm, oh = 0, om = 0;
+    if( day < 0 || !parse_digits(s, 11, 2, hh) || !parse_digits(s, 14, 2, mm) )
+        return -1;
+
+    size_t p = 16;
+    if( p < s.size() && s[p] == ':' )
+        p += 3; // seconds
+    if( p < s.size() && s[p] == '.' )
+        while( ++p < s.size() && s[p] >= '0' && s[p] <= '9' )
+            {}
+    int sign = 0;
+    if( p < s.size() && (s[p] == '+' || s[p] == '-') ){
+        sign = (s[p] == '-') ? -1 : 1;
+        if( !parse_digits(s, p + 1, 2, oh) || !parse_digits(s, p + 4, 2, om) )
+            return -1;
+    }
+    return day * MIN_IN_DAY + hh * 60 + mm - sign * (oh * 60 + om);
+}
+
+
+/* first start to last end of a list of {"start":..., "end":...} */
+SessionInterval
+parse_intervals(const json& j, const string& name)
+{
+    SessionInterval i = NO_INTERVAL;
+    auto f = j.find(name);
+    if( f == j.end() || !f->is_array() )
+        return i;
+
+    for( auto& e : *f ){
+        auto s = e.find("start");
+        auto t = e.find("end");
+        if( s == e.end() || t == e.end() || !s->is_string() || !t->is_string() )
+            continue;
+        long long beg = parse_timestamp( s->get<string>() );
+        long long end = parse_timestamp( t->get<string>() );
+        if( beg < 0 || end <= beg )
+            continue;
+        if( i.start < 0 || beg < i.start )
+            i.start = beg;
+        i.end = std::max(i.end, end);
+    }
+    return i;
+}
+
+
+/* false if the response is unusable */
+bool
+parse_market_hours( const json& j,
+                    const string& product,
+                    SessionHours& hours )
+{
+    hours = CLOSED;
+    if( !j.is_object() || j.empty() || !j.begin()->is_object() )
+        return false;
+
+    /* {"equity": {"EQ": {"isOpen": ..., "sessionHours": {...}}, ...}} */
+    const json& jm = *(j.begin());
+    const json *jp = nullptr;
+    for( auto iter = jm.begin(); iter != jm.end(); ++iter ){
+        if( !iter->is_object() )
+            continue;
+        if( !product.empty() ){
+            if( iter.key() == product )
+                jp = &(*iter);
+        }else{
+            auto o = iter->find("isOpen");
+            if( o != iter->end() && o->is_boolean() && o->get<bool>() ){
+                jp = &(*iter);
+                break;
+            }
+        }
+    }
+
+    /* closed days return a single entry w/o sessionHours */
+    if( !jp )
+        return true;
+
+    auto o = jp->find("isOpen");
+    auto sh = jp->find("sessionHours");
+    if( o == jp->end() || !o->is_boolean() || !o->get<bool>()
+        || sh == jp->end() || !sh->is_object() )
+        return true;
+
+    hours.pre = parse_intervals(*sh, "preMarket");
+    hours.regular = parse_intervals(*sh, "regularMarket");
+    hours.post = parse_intervals(*sh, "postMarket");
+    hours.is_open = (hours.regular.start >= 0);
+    if( !hours.is_open )
+        hours = CLOSED;
+    return true;
+}
+
+
+inline long long
+overlap_before(const SessionInterval& i, long long m)
+{ return (i.start >= 0 && m > i.start) ? std::min(m, i.end) - i.start : 0; }
+
+
+inline long long
+session_length(const SessionHours& h, bool extended)
+{
+    if( !h.is_open )
+        return 0;
+    return h.regular.length()
+        + (extended ? h.pre.length() + h.post.length() : 0);
+}
+
+
+/* the earliest session start >= m */
+inline long long
+first_start_after(const SessionHours& h, long long m, bool extended)
+{
+    if( !h.is_open )
+        return -1;
+    const SessionInterval *ivs[] = {&h.pre, &h.regular, &h.post};
+    long long r = -1;
+    for( auto i : ivs ){
+        if( !extended && i != &h.regular )
+            continue;
+        if( i->start >= m && (r < 0 || i->start < r) )
+            r = i->start;
+    }
+    return r;
+}
+
+
+inline bool
+contains(const SessionHours& h, long long m, bool extended)
+{
+    return h.is_open && ( h.regular.contains(m)
+        || (extended && (h.pre.contains(m) || h.post.contains(m))) );
+}
+
+} /* namespace */
+
+
+namespace ds {
+
+using namespace std::chrono;
+
+long long
+DaysFromCivil( int year, unsigned int month, unsigned int day )
+{
+    /* H. Hinnant, 'chrono-Compatible Low-Level Date Algorithms' */
+    long long y = year - (month <= 2);
+    long long era = (y >= 0 ? y : y - 399) / 400;
+    long long yoe = y - era * 400;
+    long long doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    long long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+
+CivilTime
+ToCivilTime( minutes min_since_epoch )
+{
+    long long m = min_since_epoch.count();
+    long long z = floor_div(m, MIN_IN_DAY);
+    long long mod = m - z * MIN_IN_DAY;
+
+    CivilTime c;
+    c.hour = static_cast<unsigned int>(mod / 60);
+    c.minute = static_cast<unsigned int>(mod % 60);
+    c.weekday = static_cast<unsigned int>( (z % 7 + 11) % 7 ); // 1/1/70 Thu
+
+    z += 719468;
+    long long era = (z >= 0 ? z : z - 146096) / 146097;
+    long long doe = z - era * 146097;
+    long long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    long long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    long long mp = (5 * doy + 2) / 153;
+    c.day = static_cast<unsigned int>(doy - (153 * mp + 2) / 5 + 1);
+    c.month = static_cast<unsigned int>(mp < 10 ? mp + 3 : mp - 9);
+    c.year = static_cast<int>(yoe + era * 400 + (c.month <= 2));
+    return c;
+}
+
+
+minutes
+FromCivilTime( int year,
+               unsigned int month,
+               unsigned int day,
+               unsigned int hour,
+               unsigned int minute )
+{
+    return minutes( DaysFromCivil(year, month, day) * MIN_IN_DAY
+                    + hour * 60 + minute );
+}
+
+
+TradingCalendar::TradingCalendar( const string& path )
+    :
+        _path( path )
+    {
+        if( !_path.empty() && !_load() )
+            log_error("CALENDAR", "failed to load", _path);
+    }
+
+
+const TradingCalendar::Table&
+TradingCalendar::_table( MarketType market ) const
+{
+    int i = static_cast<int>(market);
+    if( i < 0 || i >= NMARKETS ){
+        log_error("CALENDAR", "invalid market type", std::to_string(i));
+        throw std::invalid_argument("invalid market type");
+    }
+    return _tables[i];
+}
+
+
+const TradingCalendar::Day*
+TradingCalendar::_day( const Table& t, long long day ) const
+{
+    long long i = day - t.first_day;
+    if( t.first_day < 0 || i < 0 || i >= static_cast<long long>(t.days.size())
+        || !t.days[i].is_loaded )
+        return nullptr;
+    return &t.days[i];
+}
+
+
+const TradingCalendar::Day&
+TradingCalendar::_day_or_throw( const Table& t, long long m ) const
+{
+    long long day = eastern_day(m);
+    const Day *d = _day(t, day);
+    if( !d ){
+        log_error("CALENDAR", "day not loaded", date_string(day));
+        throw std::out_of_range("day not loaded: " + date_string(day));
+    }
+    return *d;
+}
+
+
+void
+TradingCalendar::_set_day( MarketType market,
+                           long long day,
+                           const SessionHours& hours )
+{
+    Table& t = _tables[ static_cast<int>(market) ];
+    if( t.first_day < 0 ){
+        t.first_day = day;
+    }else if( day < t.first_day ){
+        t.days.insert( t.days.begin(), t.first_day - day, Day{CLOSED, false} );
+        t.first_day = day;
+    }
+    size_t i = static_cast<size_t>(day - t.first_day);
+    if( i >= t.days.size() )
+        t.days.resize(i + 1, Day{CLOSED, false});
+    t.days[i] = Day{hours, true};
+}
+
+
+void
+TradingCalendar::_rebuild( MarketType market )
+{
+    Table& t = _tables[ static_cast<int>(market) ];
+    size_t n = t.days.size();
+
+    t.cum_regular.assign(n + 1, 0);
+    t.cum_extended.assign(n + 1, 0);
+    for( size_t i = 0; i < n; ++i ){
+        t.cum_regular[i + 1] = t.cum_regular[i]
+            + session_length(t.days[i].hours, false);
+        t.cum_extended[i + 1] = t.cum_extended[i]
+            + session_length(t.days[i].hours, true);
+    }
+
+    t.next_open.assign(n + 1, -1);
+    for( size_t i = n; i-- > 0; )
+        t.next_open[i] = t.days[i].hours.is_open
+            ? static_cast<long long>(i)
+            : t.next_open[i + 1];
+}
+
+
+/* dates before D are over and dates after D+1 haven't started yet */
+long long
+TradingCalendar::_minutes_before( const Table& t, long long m, bool extended )
+{
+    long long n = static_cast<long long>(t.days.size());
+    long long i = eastern_day(m) - t.first_day;
+    i = std::max(0LL, std::min(i, n));
+
+    long long r = extended ? t.cum_extended[i] : t.cum_regular[i];
+    for( long long k = i; k < std::min(i + 2, n); ++k ){
+        const SessionHours& h = t.days[k].hours;
+        if( !h.is_open )
+            continue;
+        r += overlap_before(h.regular, m);
+        if( extended )
+            r += overlap_before(h.pre, m) + overlap_before(h.post, m);
+    }
+    return r;
+}
+
+
+bool
+TradingCalendar::refresh( Credentials& creds,
+                          MarketType market,
+                          unsigned int ndays,
+                          minutes from,
+                          const string& product,
+                          bool reload )
+{
+    _table(market); // check
+
+    if( from == ERROR_MINUTES )
+        from = duration_cast<minutes>( system_clock::now().time_since_epoch() );
+    long long first = eastern_day( from.count() );
+
+    const Table& t = _tables[ static_cast<int>(market) ];
+    std::unique_ptr<tdma::MarketHoursGetter> getter;
+    bool ret = true;
+    size_t nloaded = 0;
+
+    for( long long day = first; day < first + ndays; ++day ){
+        if( !reload && _day(t, day) )
+            continue;
+
+        string date = date_string(day);
+        json j;
+        try{
+            if( getter )
+                getter->set_date(date);
+            else
+                getter.reset( new tdma::MarketHoursGetter(creds, market, date) );
+
+            log_info("CALENDAR", "HTTP/GET MarketHours", date);
+            j = getter->get();
+        }catch( tdma::APIException& e ){
+            log_error("CALENDAR", "market hours getter failed", e.what());
+            ret = false;
+            break;
+        }
+
+        SessionHours hours;
+        if( !parse_market_hours(j, product, hours) ){
+            log_error("CALENDAR", "bad market hours json", date);
+            ret = false;
+            break;
+        }
+        _set_day(market, day, hours);
+        ++nloaded;
+    }
+
+    _rebuild(market);
+    if( nloaded && !_path.empty() && !store() )
+        ret = false;
+    return ret;
+}
+
+
+bool
+TradingCalendar::store() const
+{
+    std::ofstream out(_path, std::ios_base::out | std::ios_base::trunc);
+    if( !out ){
+        log_error("CALENDAR", "failed to open for writing", _path);
+        return false;
+    }
+
+    for( int mi = 0; mi < NMARKETS; ++mi ){
+        const Table& t = _tables[mi];
+        string name = tdma::to_string( static_cast<MarketType>(mi) );
+        for( size_t i = 0; i < t.days.size(); ++i ){
+            const Day& d = t.days[i];
+            if( !d.is_loaded )
+                continue;
+            const SessionHours& h = d.hours;
+            out << name << ' ' << date_string(t.first_day + i) << ' '
+                << h.is_open << ' ' << h.pre.start << ' ' << h.pre.end << ' '
+                << h.regular.start << ' ' << h.regular.end << ' '
+                << h.post.start << ' ' << h.post.end << '\n';
+        }
+    }
+    return static_cast<bool>(out);
+}
+
+
+bool
+TradingCalendar::_load()
+{
+    std::ifstream in(_path);
+    if( !in )
+        return true; // nothing stored yet
+
+    std::string line;
+    size_t nline = 0;
+    while( std::getline(in, line) ){
+        ++nline;
+        if( line.empty() )
+            continue;
+
+        std::istringstream ss(line);
+        string name, date;
+        SessionHours h;
+        if( !(ss >> name >> date >> h.is_open >> h.pre.start >> h.pre.end
+                 >> h.regular.start >> h.regular.end >> h.post.start
+                 >> h.post.end) )
+        {
+            log_error("CALENDAR", "bad line", std::to_string(nline));
+            return false;
+        }
+
+        int mi = 0;
+        for( ; mi < NMARKETS; ++mi )
+            if( tdma::to_string(static_cast<MarketType>(mi)) == name )
+                break;
+        long long day = parse_date(date);
+        if( mi == NMARKETS || day < 0 ){
+            log_error("CALENDAR", "bad market or date", std::to_string(nline));
+            return false;
+        }
+        _set_day( static_cast<MarketType>(mi), day, h );
+    }
+
+    for( int mi = 0; mi < NMARKETS; ++mi )
+        _rebuild( static_cast<MarketType>(mi) );
+    return true;
+}
+
+
+std::pair<minutes, minutes>
+TradingCalendar::get_horizon( MarketType market ) const
+{
+    const Table& t = _table(market);
+    if( t.first_day < 0 || t.days.empty() )
+        return {ERROR_MINUTES, ERROR_MINUTES};
+    return { minutes(t.first_day * MIN_IN_DAY),
+             minutes((t.first_day + t.days.size()) * MIN_IN_DAY - 1) };
+}
+
+
+SessionHours
+TradingCalendar::get_session( MarketType market, minutes min_since_epoch ) const
+{ return _day_or_throw( _table(market), min_since_epoch.count() ).hours; }
+
+
+bool
+TradingCalendar::is_trading_day( MarketType market,
+                                 minutes min_since_epoch ) const
+{ return get_session(market, min_since_epoch).is_open; }
+
+
+bool
+TradingCalendar::is_open( MarketType market,
+                          minutes min_since_epoch,
+                          bool extended ) const
+{
+    const Table& t = _table(market);
+    long long m = min_since_epoch.count();
+    const Day& d = _day_or_throw(t, m);
+
+    /* e.g futures sessions start the evening before */
+    const Day *next = _day(t, eastern_day(m) + 1);
+    return contains(d.hours, m, extended)
+        || (next && contains(next->hours, m, extended));
+}
+
+
+minutes
+TradingCalendar::next_session_start( MarketType market,
+                                     minutes min_since_epoch,
+                                     bool extended ) const
+{
+    const Table& t = _table(market);
+    long long m = min_since_epoch.count();
+    _day_or_throw(t, m);
+
+    long long i = eastern_day(m) - t.first_day;
+    long long n = static_cast<long long>(t.days.size());
+    for( long long k = i; k < std::min(i + 2, n); ++k ){
+        long long s = first_start_after(t.days[k].hours, m, extended);
+        if( s >= 0 )
+            return minutes(s);
+    }
+
+    if( i + 2 < n ){
+        long long k = t.next_open[i + 2];
+        if( k >= 0 )
+            return minutes( first_start_after(t.days[k].hours, m, extended) );
+    }
+    return ERROR_MINUTES;
+}
+
+
+long long
+TradingCalendar::session_minutes_between( MarketType market,
+                                          minutes start_min_since_epoch,
+                                          minutes end_min_since_epoch,
+                                          bool extended ) const
+{
+    if( start_min_since_epoch > end_min_since_epoch ){
+        log_error("CALENDAR", "start > end");
+        throw std::invalid_argument("start > end");
+    }
+
+    const Table& t = _table(market);
+    _day_or_throw(t, start_min_since_epoch.count());
+    _day_or_throw(t, end_min_since_epoch.count());
+
+    return _minutes_before(t, end_min_since_epoch.count(), extended)
+        - _minutes_before(t, start_min_since_epoch.count(), extended);
+}
+
+}; /* namespace ds */
@@ -0,0 +1,385 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include <map>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+#include <algorithm>
+
+#include "common.h"
+#include "tdma_data_cross.h"
+#include "tdma_data_screen.h"
+
+
+/*
+ * Each metric is a Screen; its last 'nminutes' results per symbol are the
+ * inputs. For every closed minute, per metric, a Minute record holds the
+ * stats of every symbol in the universe (by index, so the symbol strings
+ * aren't repeated per minute). Records are kept most recent first.
+ */
+
+namespace {
+
+using namespace ds;
+using std::string;
+using std::vector;
+
+const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+struct Minute {
+    unsigned long long min_since_epoch;
+    vector<CrossSectionStats> stats; // by symbol index
+};
+
+/* the inputs to one metric's cross-sections */
+struct MetricInputs {
+    vector<vector<double>> series; // by symbol index, most recent first
+    vector<long long> end_min; // by symbol index, -1 if none
+};
+
+
+/* stats of all symbols w/ a value at 'm' (a 'task') */
+void
+compute_minute( const MetricInputs& in, long long m, Minute& out )
+{
+    vector<std::pair<double, size_t>> vals;
+    for( size_t i = 0; i < in.series.size(); ++i ){
+        long long off = in.end_min[i] - m;
+        if( in.end_min[i] < 0 || off < 0
+            || off >= static_cast<long long>(in.series[i].size()) )
+            continue;
+        double v = in.series[i][off];
+        if( !std::isnan(v) )
+            vals.emplace_back(v, i);
+    }
+
+    out.min_since_epoch = static_cast<unsigned long long>(m);
+    out.stats.assign(in.series.size(), CrossSectionStats::null);
+
+    size_t n = vals.size();
+    if( n == 0 )
+        return;
+
+    double mean = 0;
+    for( auto& v : vals )
+        mean += v.first;
+    mean /= n;
+
+    double ss = 0;
+    for( auto& v : vals )
+        ss += (v.first - mean) * (v.first - mean);
+    double sd = std::sqrt(ss / n);
+
+    std::sort( vals.begin(), vals.end() );
+    for( size_t i = 0; i < n; ){
+        size_t j = i + 1;
+        while( j < n && vals[j].first == vals[i].first )
+            ++j;
+        /* ties: same (average) percentile, same (best) rank */
+        double pct = (n > 1) ? ((i + j - 1) / 2.0) / (n - 1) * 100.0 : 50.0;
+        for( size_t k = i; k < j; ++k ){
+            double v = vals[k].first;
+            out.stats[vals[k].second] = CrossSectionStats{
+                out.min_since_epoch, v, static_cast<unsigned int>(n - j + 1),
+                pct, (sd > 0) ? (v - mean) / sd : 0.0,
+                static_cast<unsigned int>(n)
+            };
+        }
+        i = j;
+    }
+}
+
+} /* namespace */
+
+
+namespace ds {
+
+using namespace std::chrono;
+
+const CrossSectionStats CrossSectionStats::null = {0, NaN, 0, NaN, NaN, 0};
+
+class CrossSection::Impl {
+public:
+    std::map<string, std::unique_ptr<Screen>> screens;
+    unsigned int nminutes;
+    unsigned int nthreads;
+    vector<string> universe;
+    std::map<string, size_t> indices;
+    std::map<string, std::deque<Minute>> records; // most recent first
+    long long last_min;
+
+    Impl( const std::map<string, string>& metrics,
+          unsigned int nminutes,
+          unsigned int nthreads )
+        :
+            nminutes( std::max(nminutes, 1U) ),
+            nthreads( nthreads ? nthreads
+                               : std::max(std::thread::hardware_concurrency(),
+                                          1U) ),
+            last_min( -1 )
+        {
+            if( metrics.empty() ){
+                log_error("CROSS-SECTION", "no metrics");
+                throw std::invalid_argument("no metrics");
+            }
+            for( auto& p : metrics ){
+                screens[p.first].reset(
+                    new Screen(p.second, this->nminutes, this->nthreads)
+                    );
+                records[p.first];
+            }
+        }
+
+    size_t
+    index(const string& symbol)
+    {
+        auto f = indices.find(symbol);
+        if( f != indices.end() )
+            return f->second;
+        universe.push_back(symbol);
+        return (indices[symbol] = universe.size() - 1);
+    }
+
+    const std::deque<Minute>&
+    records_or_throw(const string& metric) const
+    {
+        auto f = records.find(metric);
+        if( f == records.end() ){
+            log_error("CROSS-SECTION", "invalid metric", metric);
+            throw std::invalid_argument("invalid metric: " + metric);
+        }
+        return f->second;
+    }
+
+    const Minute*
+    find(const std::deque<Minute>& recs, long long m) const
+    {
+        if( m < 0 )
+            return nullptr;
+        auto f = std::lower_bound(
+            recs.begin(), recs.end(), static_cast<unsigned long long>(m),
+            [](const Minute& r, unsigned long long v){
+                return r.min_since_epoch > v;
+            });
+        if( f == recs.end()
+            || f->min_since_epoch != static_cast<unsigned long long>(m) )
+            return nullptr;
+        return &(*f);
+    }
+
+    CrossSectionStats
+    get(const string& metric, const string& symbol, long long m) const
+    {
+        const Minute *r = find( records_or_throw(metric), m );
+        auto i = indices.find( toupper(symbol) );
+        if( !r || i == indices.end() || i->second >= r->stats.size() )
+            return CrossSectionStats::null;
+        return r->stats[i->second];
+    }
+
+    std::vector<std::pair<string, CrossSectionStats>>
+    ranking(const string& metric, long long m) const
+    {
+        std::vector<std::pair<string, CrossSectionStats>> v;
+        const Minute *r = find( records_or_throw(metric), m );
+        if( !r )
+            return v;
+        for( size_t i = 0; i < r->stats.size(); ++i )
+            if( r->stats[i].rank )
+                v.emplace_back( universe[i], r->stats[i] );
+        std::sort( v.begin(), v.end(),
+                   [](const std::pair<string, CrossSectionStats>& a,
+                      const std::pair<string, CrossSectionStats>& b){
+                       return a.second.rank < b.second.rank
+                           || (a.second.rank == b.second.rank
+                               && a.first < b.first);
+                   });
+        return v;
+    }
+
+    void
+    run( const vector<MetricInputs*>& inputs,
+         vector<vector<Minute>*>& outputs,
+         long long from,
+         long long to )
+    {
+        size_t nmins = static_cast<size_t>(to - from + 1);
+        size_t ntasks = inputs.size() * nmins;
+        std::atomic<size_t> next(0);
+        auto worker = [&](){
+            for( size_t i = next++; i < ntasks; i = next++ ){
+                size_t k = i / nmins, j = i % nmins;
+                compute_minute( *inputs[k], from + static_cast<long long>(j),
+                                (*outputs[k])[j] );
+            }
+        };
+
+        run_parallel( std::min(static_cast<size_t>(nthreads), ntasks), worker );
+    }
+};
+
+
+CrossSection::CrossSection( const std::map<string, string>& metrics,
+                            unsigned int nminutes,
+                            unsigned int nthreads )
+    :
+        _impl( new Impl(metrics, nminutes, nthreads) )
+    {
+    }
+
+
+CrossSection::~CrossSection()
+    {
+    }
+
+
+std::set<string>
+CrossSection::get_metrics() const
+{
+    std::set<string> m;
+    for( auto& p : _impl->screens )
+        m.insert(p.first);
+    return m;
+}
+
+
+unsigned int
+CrossSection::get_nminutes() const
+{ return _impl->nminutes; }
+
+
+std::vector<minutes>
+CrossSection::update()
+{ return update( GetSymbols() ); }
+
+
+std::vector<minutes>
+CrossSection::update( const std::set<string>& symbols )
+{
+    /* evaluation (in parallel across symbols) is incremental per metric */
+    for( auto& p : _impl->screens )
+        p.second->evaluate(symbols);
+
+    for( auto& s : symbols )
+        _impl->index( toupper(s) );
+    size_t nsyms = _impl->universe.size();
+
+    long long end = -1;
+    std::map<string, MetricInputs> inputs;
+    for( auto& p : _impl->screens ){
+        auto& in = inputs[p.first];
+        in.series.resize(nsyms);
+        in.end_min.assign(nsyms, -1);
+        for( auto& s : symbols ){
+            string sym = toupper(s);
+            size_t i = _impl->indices[sym];
+            in.end_min[i] = p.second->end_minute(sym).count();
+            in.series[i] = p.second->series(sym);
+            end = std::max(end, in.end_min[i]);
+        }
+    }
+
+    /* the most recent bar may still be active */
+    long long closed = end - 1;
+    long long from = std::max( _impl->last_min + 1,
+                               closed - static_cast<long long>(_impl->nminutes)
+                                   + 1 );
+    std::vector<minutes> mins;
+    if( end < 0 || closed < from )
+        return mins;
+
+    size_t nmins = static_cast<size_t>(closed - from + 1);
+    std::map<string, vector<Minute>> outputs;
+    vector<MetricInputs*> in_ptrs;
+    vector<vector<Minute>*> out_ptrs;
+    for( auto& p : inputs ){
+        auto& out = outputs[p.first];
+        out.resize(nmins);
+        in_ptrs.push_back(&p.second);
+        out_ptrs.push_back(&out);
+    }
+
+    _impl->run(in_ptrs, out_ptrs, from, closed);
+
+    for( auto& p : outputs ){
+        auto& recs = _impl->records[p.first];
+        for( auto& r : p.second )
+            recs.push_front( std::move(r) );
+        while( recs.size() > _impl->nminutes )
+            recs.pop_back();
+    }
+
+    for( long long m = from; m <= closed; ++m )
+        mins.emplace_back(m);
+    _impl->last_min = closed;
+    return mins;
+}
+
+
+minutes
+CrossSection::last_minute() const
+{ return (_impl->last_min < 0) ? ERROR_MINUTES : minutes(_impl->last_min); }
+
+
+CrossSectionStats
+CrossSection::get( const string& metric,
+                   const string& symbol,
+                   minutes min_since_epoch ) const
+{ return _impl->get(metric, symbol, min_since_epoch.count()); }
+
+
+CrossSectionStats
+CrossSection::get( const string& metric, const string& symbol ) const
+{ return _impl->get(metric, symbol, _impl->last_min); }
+
+
+std::vector<CrossSectionStats>
+CrossSection::series( const string& metric, const string& symbol ) const
+{
+    std::vector<CrossSectionStats> v;
+    auto& recs = _impl->records_or_throw(metric);
+    auto i = _impl->indices.find( toupper(symbol) );
+    if( i == _impl->indices.end() )
+        return v;
+
+    for( auto& r : recs ){
+        if( i->second < r.stats.size() && r.stats[i->second].rank )
+            v.push_back( r.stats[i->second] );
+        else{
+            v.push_back( CrossSectionStats::null );
+            v.back().min_since_epoch = r.min_since_epoch;
+        }
+    }
+    return v;
+}
+
+
+std::vector<std::pair<string, CrossSectionStats>>
+CrossSection::ranking( const string& metric, minutes min_since_epoch ) const
+{ return _impl->ranking(metric, min_since_epoch.count()); }
+
+
+std::vector<std::pair<string, CrossSectionStats>>
+CrossSection::ranking( const string& metric ) const
+{ return _impl->ranking(metric, _impl->last_min); }
+
+}; /* namespace ds */
@@ -28,14 +28,14 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 
 #include "common.h"
 #include "tdma_data_store.h"
+#include "tdma_data_calendar.h"
 #include "backing_store.h"
+#include "shared_bars.h"
 
 #include "tdma_api_streaming.h"
 #include "tdma_api_get.h"
-
-#ifdef _WIN32
-#define timegm _mkgmtime
-#endif
+#include "_json_parse.h"
+#include "_probes.h"
 
 
 /*
@@ -89,6 +89,7 @@ std::shared_ptr<BackingStore> backing_store;
 std::shared_ptr<tdma::StreamingSession> session;
 std::shared_ptr<tdma::ChartEquitySubscription> sub_equity_chart;
 std::shared_ptr<tdma::TimesaleEquitySubscription> sub_equity_timesale;
+std::shared_ptr<SharedBarsWriter> shared_bars;
 
 Credentials *credentials; // TODO
 
@@ -230,6 +231,7 @@ private:
             min_end = min;
         if( min < min_start || min_start == 0 )
             min_start = min;
+        mark_dirty(min);
     }
 
 public:
@@ -239,6 +241,7 @@ public:
     unsigned long long min_end;
     std::deque<OHLCVData>::size_type write_pos_begin; // < here goes to file_back
     std::deque<OHLCVData>::size_type write_pos_end; // >= here goes to file_front
+    unsigned long long min_dirty; // oldest bar changed since last publish
     bool allow_reload;
 
     SymbolData() = delete;
@@ -251,6 +254,7 @@ public:
             min_end( 0 ),
             write_pos_begin( 0 ),
             write_pos_end( 0 ),
+            min_dirty( 0 ),
             allow_reload( allow_reload )
         {
             assert( toupper(symbol) == symbol );
@@ -259,11 +263,19 @@ public:
     operator bool() const
     { return data.operator bool(); }
 
+    void
+    mark_dirty(unsigned long long min)
+    {
+        if( min < min_dirty || min_dirty == 0 )
+            min_dirty = min;
+    }
+
     void
     push_front( const OHLCVData& d )
     {
         data->push_front(d);
         _update<true>(d.min_since_epoch);
+        TDMA_PROBE2(bar_appended, symbol.c_str(), d.min_since_epoch);
     }
 
     void
@@ -733,7 +745,7 @@ session_callback( int callback_type,
         return;
     }
 
-    json j = json::parse(string(data));
+    json j = tdma::parse_json(data, strlen(data));
     unsigned long long t;
 
     StreamingData::QueuesGuard lock;
@@ -990,6 +1002,7 @@ handle_duplicate( SymbolData& sdata,
     }
 
     D[-gap] = d;
+    sdata.mark_dirty(d.min_since_epoch);
 }
 
 
@@ -1257,6 +1270,23 @@ get_symbol_data_or_throw( const std::string& symbol )
 }
 
 
+void
+publish_shared( SymbolData& sdata, bool all = false )
+{
+    if( !shared_bars || !sdata )
+        return;
+
+    if( all || sdata.min_dirty > 0 ){
+        if( !shared_bars->publish( sdata.symbol, *sdata.data, sdata.min_start,
+                                   sdata.min_end, all ? 0 : sdata.min_dirty ) )
+        {
+            log_error("SHARE", "failed to publish", sdata.symbol);
+        }
+    }
+    sdata.min_dirty = 0;
+}
+
+
 }; /* namespace */
 
 
@@ -1385,6 +1415,7 @@ Add( const std::string& symbol )
     }
     log_info("ADD-STORE", "successfully built symbol data", s);
     SymbolData::all.emplace( s, std::move(sdata) );
+    publish_shared( SymbolData::all.at(s), true );
 
     if( session ){
         auto old_symbols = sub_equity_chart->get_symbols();
@@ -1440,6 +1471,9 @@ Remove( const std::string& symbol, bool delete_file )
         ret = false;
     }
 
+    if( shared_bars )
+        shared_bars->remove(s);
+
     if( SymbolData::all.erase(s) < 1 ){
         log_error("REMOVE", "failed to remove symbol data from collection", s);
         ret = false;
@@ -1488,6 +1522,8 @@ Finalize()
     if( is_initialized && !store() )
         log_error("FINALIZE", "failed to store (ALL)");
 
+    StopSharing();
+
     SymbolData::all.clear();
 
     is_initialized = false;
@@ -1601,11 +1637,54 @@ Update()
         if( !update_front_from_streaming(iter_sd->second, std::move(Q)) )
             log_error("UPDATE", "front-from-streaming failed", s);
         // p.second no longer valid
+
+        publish_shared(iter_sd->second);
     }
     // qcopies no longer valid
 }
 
 
+bool
+Share( const std::string& name, unsigned int nbars, unsigned int max_symbols )
+{
+    INIT_CHECK_AND_RETURN("SHARE", false);
+
+    if( name.empty() || nbars == 0 || max_symbols == 0 ){
+        log_error("SHARE", "invalid name, nbars or max_symbols", name);
+        return false;
+    }
+
+    StopSharing();
+    try{
+        shared_bars = std::make_shared<SharedBarsWriter>(name, nbars,
+                                                         max_symbols);
+    }catch(std::exception& e){
+        log_error("SHARE", "failed to create shared segment", e.what());
+        return false;
+    }
+    log_info("SHARE", "sharing bars", name);
+
+    for( auto& p : SymbolData::all )
+        publish_shared(p.second, true);
+    return true;
+}
+
+
+void
+StopSharing()
+{
+    if( shared_bars ){
+        log_info("SHARE", "stop sharing bars", shared_bars->get_name());
+        shared_bars.reset();
+    }
+}
+
+
+bool
+IsSharing()
+{ return shared_bars != nullptr; }
+
+
 /* *** DATA ACCESSOR *** */
 
 DataAccessor::DataAccessor( const std::string& symbol )
@@ -2048,50 +2127,34 @@ DataAccessor::_all() const
 
 int
 DataAccessor::ToMinuteOfHour( minutes min_since_epoch )
-{
-    time_t sec = min_since_epoch.count() * 60;
-    return gmtime(&sec)->tm_min;
-}
+{ return ToCivilTime(min_since_epoch).minute; }
 
 int
 DataAccessor::ToHourOfDay( minutes min_since_epoch )
-{
-    time_t sec = min_since_epoch.count() * 60;
-    return gmtime(&sec)->tm_hour;
-}
+{ return ToCivilTime(min_since_epoch).hour; }
 
 int
 DataAccessor::ToDayOfMonth( minutes min_since_epoch )
-{
-    time_t sec = min_since_epoch.count() * 60;
-    return gmtime(&sec)->tm_mday;
-}
+{ return ToCivilTime(min_since_epoch).day; }
 
 int
 DataAccessor::ToMonthOfYear( minutes min_since_epoch )
-{
-    time_t sec = min_since_epoch.count() * 60;
-    return gmtime(&sec)->tm_mon + 1;
-}
+{ return ToCivilTime(min_since_epoch).month; }
 
 int
 DataAccessor::ToYear( minutes min_since_epoch )
-{
-    time_t sec = min_since_epoch.count() * 60;
-    return gmtime(&sec)->tm_year + 1900;
-}
+{ return ToCivilTime(min_since_epoch).year; }
 
 std::tuple<int, int, int, int, int>
 DataAccessor::ToYYMMDDhhmm( minutes min_since_epoch )
 {
-    time_t sec = min_since_epoch.count() * 60;
-    tm *t = gmtime( &sec );
+    CivilTime c = ToCivilTime(min_since_epoch);
     return std::make_tuple(
-        t->tm_year + 1900,
-        t->tm_mon + 1,
-        t->tm_mday,
-        t->tm_hour,
-        t->tm_min
+        c.year,
+        static_cast<int>(c.month),
+        static_cast<int>(c.day),
+        static_cast<int>(c.hour),
+        static_cast<int>(c.minute)
     );
 }
 
@@ -2100,8 +2163,17 @@ DataAccessor::ToFormatString( minutes min_since_epoch,
                               const std::string& format_str )
 {
     char buf[128];
-    time_t sec = min_since_epoch.count() * 60;
-    if( !std::strftime(buf, sizeof(buf), format_str.c_str(), gmtime(&sec) ) ){
+    CivilTime c = ToCivilTime(min_since_epoch);
+    std::tm t = {};
+    t.tm_year = c.year - 1900;
+    t.tm_mon = c.month - 1;
+    t.tm_mday = c.day;
+    t.tm_hour = c.hour;
+    t.tm_min = c.minute;
+    t.tm_wday = c.weekday;
+    t.tm_yday = static_cast<int>( DaysFromCivil(c.year, c.month, c.day)
+                                  - DaysFromCivil(c.year, 1, 1) );
+    if( !std::strftime(buf, sizeof(buf), format_str.c_str(), &t) ){
         log_error("DATETIME", "formatted string conversion failed");
         return "";
     }
@@ -2136,18 +2208,7 @@ DataAccessor::BuildMinutesSinceEpoch( unsigned int year,
         return ERROR_MINUTES;
     }
 
-    std::tm t = {};
-    t.tm_year = year - 1900;
-    t.tm_mon = month - 1;
-    t.tm_mday = day;
-    t.tm_hour = hour;
-    t.tm_min = minute;
-    t.tm_sec = 0;
-    t.tm_isdst = -1;
-    time_t tt = timegm(&t);
-    if (tt < 0 )
-        return ERROR_MINUTES;
-    return minutes(tt / 60);
+    return FromCivilTime(year, month, day, hour, minute);
 }
 
 
@@ -0,0 +1,857 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include <map>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <cstdio>
+#include <stdexcept>
+#include <algorithm>
+
+#include "common.h"
+#include "tdma_data_screen.h"
+
+
+/*
+ * Per symbol the columns and the output of each op of the plan are kept as
+ * contiguous vectors (oldest first, unlike the data deque), trimmed to the
+ * bars the plan needs. An evaluate() only computes ops from the first bar
+ * that's new or was revised.
+ */
+
+namespace {
+
+using namespace ds;
+using std::string;
+using std::vector;
+
+const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+/* recent bars can be revised (e.g timesale bar replaced by chart bar) */
+const long long REFRESH_BARS = 5;
+
+enum Column : int {
+    col_open = 0,
+    col_high,
+    col_low,
+    col_close,
+    col_volume,
+    ncolumns
+};
+
+const std::map<string, Column> COLUMNS = {
+    {"open", col_open},
+    {"high", col_high},
+    {"low", col_low},
+    {"close", col_close},
+    {"volume", col_volume}
+};
+
+enum class OpCode : int {
+    column,
+    constant,
+    neg,
+    abs,
+    add,
+    sub,
+    mul,
+    div,
+    lt,
+    le,
+    gt,
+    ge,
+    eq,
+    ne,
+    and_,
+    or_,
+    not_,
+    lag,
+    sum,
+    sma,
+    min,
+    max,
+    std
+};
+
+/* name(x, n) */
+const std::map<string, OpCode> WINDOW_FUNCS = {
+    {"lag", OpCode::lag},
+    {"sum", OpCode::sum},
+    {"sma", OpCode::sma},
+    {"avg", OpCode::sma},
+    {"min", OpCode::min},
+    {"max", OpCode::max},
+    {"std", OpCode::std}
+};
+
+struct Op {
+    OpCode code;
+    int a;              // operand slots
+    int b;
+    unsigned int n;     // window, lag or column
+    double value;       // constant
+    unsigned int lookback;
+};
+
+struct Plan {
+    vector<Op> ops; // children before parents
+    int root;
+
+    unsigned int
+    lookback() const
+    { return ops[root].lookback; }
+};
+
+
+#define SCREEN_THROW(msg, msg2) \
+do{ \
+    log_error("SCREEN", msg, msg2); \
+    throw std::invalid_argument(string(msg) + ": " + (msg2)); \
+}while(0)
+
+
+class Compiler {
+    const string& _expr;
+    size_t _pos;
+    Plan _plan;
+    std::map<string, int> _slots; // sub-expression -> slot (shared)
+
+    string
+    _peek_token()
+    {
+        size_t p = _pos;
+        return _next_token(p);
+    }
+
+    string
+    _next_token()
+    { return _next_token(_pos); }
+
+    string
+    _next_token(size_t& p)
+    {
+        while( p < _expr.size() && std::isspace((unsigned char)_expr[p]) )
+            ++p;
+        if( p >= _expr.size() )
+            return "";
+
+        size_t beg = p;
+        char c = _expr[p];
+        if( std::isalpha((unsigned char)c) || c == '_' ){
+            while( p < _expr.size() && (std::isalnum((unsigned char)_expr[p])
+                                        || _expr[p] == '_') )
+                ++p;
+            string t = _expr.substr(beg, p - beg);
+            std::transform( t.begin(), t.end(), t.begin(),
+                            [](unsigned char c){ return std::tolower(c); } );
+            return t;
+        }
+        if( std::isdigit((unsigned char)c) || c == '.' ){
+            char *end;
+            std::strtod(_expr.c_str() + p, &end);
+            p = end - _expr.c_str();
+            if( p == beg )
+                SCREEN_THROW("invalid number", _expr.substr(beg));
+            return _expr.substr(beg, p - beg);
+        }
+        if( (c == '<' || c == '>' || c == '=' || c == '!')
+            && p + 1 < _expr.size() && _expr[p + 1] == '=' ){
+            p += 2;
+            return _expr.substr(beg, 2);
+        }
+        if( c == '&' && p + 1 < _expr.size() && _expr[p + 1] == '&' ){
+            p += 2;
+            return "and";
+        }
+        if( c == '|' && p + 1 < _expr.size() && _expr[p + 1] == '|' ){
+            p += 2;
+            return "or";
+        }
+        ++p;
+        return string(1, c);
+    }
+
+    void
+    _expect(const string& tok)
+    {
+        string t = _next_token();
+        if( t != tok )
+            SCREEN_THROW("expected '" + tok + "'",
+                         t.empty() ? "end of expression" : t);
+    }
+
+    int
+    _add(OpCode code, int a, int b, unsigned int n, double value)
+    {
+        char key[128];
+        snprintf( key, sizeof(key), "%d(%d,%d,%u,%.17g)",
+                  static_cast<int>(code), a, b, n, value );
+        auto s = _slots.find(key);
+        if( s != _slots.end() )
+            return s->second;
+
+        unsigned int lb = 0;
+        if( a >= 0 )
+            lb = _plan.ops[a].lookback;
+        if( b >= 0 )
+            lb = std::max(lb, _plan.ops[b].lookback);
+        if( code == OpCode::lag )
+            lb += n;
+        else if( code >= OpCode::sum )
+            lb += n - 1;
+
+        _plan.ops.push_back( Op{code, a, b, n, value, lb} );
+        int slot = static_cast<int>(_plan.ops.size()) - 1;
+        _slots.emplace(key, slot);
+        return slot;
+    }
+
+    int
+    _or()
+    {
+        int l = _and();
+        while( _peek_token() == "or" ){
+            _next_token();
+            l = _add(OpCode::or_, l, _and(), 0, 0);
+        }
+        return l;
+    }
+
+    int
+    _and()
+    {
+        int l = _not();
+        while( _peek_token() == "and" ){
+            _next_token();
+            l = _add(OpCode::and_, l, _not(), 0, 0);
+        }
+        return l;
+    }
+
+    int
+    _not()
+    {
+        if( _peek_token() == "not" ){
+            _next_token();
+            return _add(OpCode::not_, _not(), -1, 0, 0);
+        }
+        return _compare();
+    }
+
+    int
+    _compare()
+    {
+        static const std::map<string, OpCode> CMPS = {
+            {"<", OpCode::lt}, {"<=", OpCode::le}, {">", OpCode::gt},
+            {">=", OpCode::ge}, {"==", OpCode::eq}, {"!=", OpCode::ne}
+        };
+        int l = _additive();
+        auto c = CMPS.find( _peek_token() );
+        if( c != CMPS.end() ){
+            _next_token();
+            l = _add(c->second, l, _additive(), 0, 0);
+        }
+        return l;
+    }
+
+    int
+    _additive()
+    {
+        int l = _multiplicative();
+        for( string t = _peek_token(); t == "+" || t == "-"; t = _peek_token() ){
+            _next_token();
+            l = _add( t == "+" ? OpCode::add : OpCode::sub, l,
+                      _multiplicative(), 0, 0 );
+        }
+        return l;
+    }
+
+    int
+    _multiplicative()
+    {
+        int l = _unary();
+        for( string t = _peek_token(); t == "*" || t == "/"; t = _peek_token() ){
+            _next_token();
+            l = _add( t == "*" ? OpCode::mul : OpCode::div, l, _unary(), 0, 0 );
+        }
+        return l;
+    }
+
+    int
+    _unary()
+    {
+        string t = _peek_token();
+        if( t == "-" ){
+            _next_token();
+            return _add(OpCode::neg, _unary(), -1, 0, 0);
+        }
+        if( t == "+" ){
+            _next_token();
+            return _unary();
+        }
+        return _primary();
+    }
+
+    unsigned int
+    _window()
+    {
+        string t = _next_token();
+        char *end;
+        double d = std::strtod(t.c_str(), &end);
+        if( t.empty() || *end || d < 1 || d != std::floor(d) || d > 1e7 )
+            SCREEN_THROW("window/lag must be an integer >= 1",
+                         t.empty() ? "end of expression" : t);
+        return static_cast<unsigned int>(d);
+    }
+
+    int
+    _primary()
+    {
+        string t = _next_token();
+        if( t.empty() )
+            SCREEN_THROW("unexpected end of expression", _expr);
+
+        if( t == "(" ){
+            int e = _or();
+            _expect(")");
+            return e;
+        }
+
+        if( std::isdigit((unsigned char)t[0]) || t[0] == '.' )
+            return _add(OpCode::constant, -1, -1, 0, std::strtod(t.c_str(), 0));
+
+        auto c = COLUMNS.find(t);
+        if( c != COLUMNS.end() )
+            return _add(OpCode::column, -1, -1, c->second, 0);
+
+        if( t == "abs" ){
+            _expect("(");
+            int x = _or();
+            _expect(")");
+            return _add(OpCode::abs, x, -1, 0, 0);
+        }
+
+        auto f = WINDOW_FUNCS.find(t);
+        if( f != WINDOW_FUNCS.end() ){
+            _expect("(");
+            int x = _or();
+            _expect(",");
+            unsigned int n = _window();
+            _expect(")");
+            return _add(f->second, x, -1, n, 0);
+        }
+
+        SCREEN_THROW("unknown token", t);
+    }
+
+public:
+    Compiler(const string& expr)
+        : _expr(expr), _pos(0)
+    {}
+
+    Plan
+    compile()
+    {
+        _plan.root = _or();
+        string t = _next_token();
+        if( !t.empty() )
+            SCREEN_THROW("unexpected token", t);
+        return _plan;
+    }
+};
+
+
+struct SymbolBuffers {
+    long long end_min = -1; // minute of the last bar
+    vector<double> columns[ncolumns];
+    vector<vector<double>> outputs;
+    size_t eval_from = 0;
+
+    size_t
+    size() const
+    { return columns[0].size(); }
+
+    void
+    clear()
+    {
+        end_min = -1;
+        for( auto& c : columns )
+            c.clear();
+        outputs.clear();
+        eval_from = 0;
+    }
+
+    /* returns if anything changed */
+    bool
+    set_bar(size_t i, const OHLCVData& d)
+    {
+        double v[ncolumns];
+        if( d.is_empty_bar() ){
+            double c = i ? columns[col_close][i - 1] : NaN;
+            v[col_open] = v[col_high] = v[col_low] = v[col_close] = c;
+            v[col_volume] = 0;
+        }else{
+            v[col_open] = d.open;
+            v[col_high] = d.high;
+            v[col_low] = d.low;
+            v[col_close] = d.close;
+            v[col_volume] = static_cast<double>(d.volume);
+        }
+
+        bool changed = false;
+        for( int c = 0; c < ncolumns; ++c ){
+            if( i == columns[c].size() ){
+                columns[c].push_back(v[c]);
+                changed = true;
+            }else if( !(columns[c][i] == v[c]
+                        || (std::isnan(columns[c][i]) && std::isnan(v[c]))) ){
+                columns[c][i] = v[c];
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    void
+    trim(size_t keep)
+    {
+        if( size() <= 2 * keep )
+            return;
+        size_t n = size() - keep;
+        for( auto& c : columns )
+            c.erase(c.begin(), c.begin() + n);
+        for( auto& o : outputs ){
+            if( !o.empty() )
+                o.erase(o.begin(), o.begin() + n);
+        }
+        eval_from = (eval_from > n) ? eval_from - n : 0;
+    }
+};
+
+
+inline bool
+is_true(double v)
+{ return v == v && v != 0; }
+
+inline double
+nan_or(double a, double b, double v)
+{ return (a != a || b != b) ? NaN : v; }
+
+
+void
+run_window( const Op& op, const double *x, double *out, size_t from, size_t n )
+{
+    size_t w = op.n;
+    switch( op.code ){
+    case OpCode::lag:
+        for( size_t i = from; i < n; ++i )
+            out[i] = (i >= w) ? x[i - w] : NaN;
+        return;
+
+    case OpCode::min:
+    case OpCode::max:
+        for( size_t i = from; i < n; ++i ){
+            if( i + 1 < w ){
+                out[i] = NaN;
+                continue;
+            }
+            double m = x[i];
+            for( size_t j = i + 1 - w; j < i; ++j ){
+                double v = x[j];
+                m = (op.code == OpCode::min) ? std::min(m, v) : std::max(m, v);
+                if( v != v )
+                    m = v;
+            }
+            out[i] = (x[i] != x[i]) ? NaN : m;
+        }
+        return;
+
+    default: /* running sums */
+        break;
+    }
+
+    double s = 0, s2 = 0;
+    size_t nnan = 0;
+    size_t lo = (from + 1 >= w) ? from + 1 - w : 0;
+    for( size_t j = lo; j < from; ++j ){
+        if( x[j] != x[j] ){
+            ++nnan;
+        }else{
+            s += x[j];
+            s2 += x[j] * x[j];
+        }
+    }
+
+    for( size_t i = from; i < n; ++i ){
+        if( x[i] != x[i] ){
+            ++nnan;
+        }else{
+            s += x[i];
+            s2 += x[i] * x[i];
+        }
+        if( i >= w && i - w >= lo ){
+            double r = x[i - w];
+            if( r != r ){
+                --nnan;
+            }else{
+                s -= r;
+                s2 -= r * r;
+            }
+        }
+
+        if( i + 1 < w || nnan ){
+            out[i] = NaN;
+            continue;
+        }
+        switch( op.code ){
+        case OpCode::sum:
+            out[i] = s;
+            break;
+        case OpCode::sma:
+            out[i] = s / w;
+            break;
+        default: { /* std (population) */
+            double m = s / w;
+            out[i] = std::sqrt( std::max(0.0, s2 / w - m * m) );
+        }}
+    }
+}
+
+
+void
+run_plan(const Plan& plan, SymbolBuffers& buf)
+{
+    size_t n = buf.size();
+    size_t from = buf.eval_from;
+    if( from >= n )
+        return;
+
+    buf.outputs.resize( plan.ops.size() );
+
+    auto input = [&](int slot) -> const double* {
+        const Op& op = plan.ops[slot];
+        return (op.code == OpCode::column) ? buf.columns[op.n].data()
+                                           : buf.outputs[slot].data();
+    };
+
+    for( size_t s = 0; s < plan.ops.size(); ++s ){
+        const Op& op = plan.ops[s];
+        if( op.code == OpCode::column )
+            continue;
+
+        auto& o = buf.outputs[s];
+        o.resize(n);
+        double *out = o.data();
+        const double *a = (op.a >= 0) ? input(op.a) : nullptr;
+        const double *b = (op.b >= 0) ? input(op.b) : nullptr;
+
+        switch( op.code ){
+        case OpCode::constant:
+            std::fill(out + from, out + n, op.value);
+            break;
+        case OpCode::neg:
+            for( size_t i = from; i < n; ++i ) out[i] = -a[i];
+            break;
+        case OpCode::abs:
+            for( size_t i = from; i < n; ++i ) out[i] = std::fabs(a[i]);
+            break;
+        case OpCode::add:
+            for( size_t i = from; i < n; ++i ) out[i] = a[i] + b[i];
+            break;
+        case OpCode::sub:
+            for( size_t i = from; i < n; ++i ) out[i] = a[i] - b[i];
+            break;
+        case OpCode::mul:
+            for( size_t i = from; i < n; ++i ) out[i] = a[i] * b[i];
+            break;
+        case OpCode::div:
+            for( size_t i = from; i < n; ++i )
+                out[i] = b[i] ? a[i] / b[i] : NaN;
+            break;
+        case OpCode::lt:
+            for( size_t i = from; i < n; ++i )
+                out[i] = nan_or(a[i], b[i], a[i] < b[i]);
+            break;
+        case OpCode::le:
+            for( size_t i = from; i < n; ++i )
+                out[i] = nan_or(a[i], b[i], a[i] <= b[i]);
+            break;
+        case OpCode::gt:
+            for( size_t i = from; i < n; ++i )
+                out[i] = nan_or(a[i], b[i], a[i] > b[i]);
+            break;
+        case OpCode::ge:
+            for( size_t i = from; i < n; ++i )
+                out[i] = nan_or(a[i], b[i], a[i] >= b[i]);
+            break;
+        case OpCode::eq:
+            for( size_t i = from; i < n; ++i )
+                out[i] = nan_or(a[i], b[i], a[i] == b[i]);
+            break;
+        case OpCode::ne:
+            for( size_t i = from; i < n; ++i )
+                out[i] = nan_or(a[i], b[i], a[i] != b[i]);
+            break;
+        case OpCode::and_:
+            for( size_t i = from; i < n; ++i )
+                out[i] = nan_or(a[i], b[i], is_true(a[i]) && is_true(b[i]));
+            break;
+        case OpCode::or_:
+            for( size_t i = from; i < n; ++i )
+                out[i] = nan_or(a[i], b[i], is_true(a[i]) || is_true(b[i]));
+            break;
+        case OpCode::not_:
+            for( size_t i = from; i < n; ++i )
+                out[i] = nan_or(a[i], 0, !is_true(a[i]));
+            break;
+        default:
+            run_window(op, a, out, from, n);
+        }
+    }
+
+    buf.eval_from = n;
+}
+
+}; /* namespace */
+
+
+
+namespace ds {
+
+using namespace std::chrono;
+
+class Screen::Impl {
+public:
+    string expression;
+    Plan plan;
+    unsigned int nbars;
+    unsigned int nthreads;
+    std::map<string, SymbolBuffers> buffers;
+
+    Impl( const string& expression, unsigned int nbars, unsigned int nthreads )
+        :
+            expression( expression ),
+            plan( Compiler(expression).compile() ),
+            nbars( std::max(nbars, 1U) ),
+            nthreads( nthreads ? nthreads
+                               : std::max(std::thread::hardware_concurrency(),
+                                          1U) )
+        {}
+
+    size_t
+    keep() const
+    { return plan.lookback() + nbars + REFRESH_BARS; }
+
+    const double*
+    root(const SymbolBuffers& buf) const
+    {
+        const Op& op = plan.ops[plan.root];
+        if( op.code == OpCode::column )
+            return buf.columns[op.n].data();
+        return (buf.outputs.size() > (size_t)plan.root)
+            ? buf.outputs[plan.root].data()
+            : nullptr;
+    }
+
+    /* pull new/revised bars into the buffers (NOT thread safe) */
+    void
+    sync(DataAccessor& acc, SymbolBuffers& buf)
+    {
+        auto se = acc.start_end_minutes();
+        if( se.first == ERROR_MINUTES ){
+            buf.clear();
+            return;
+        }
+
+        long long s = se.first.count();
+        long long e = se.second.count();
+        long long k = static_cast<long long>( keep() );
+        long long beg = buf.end_min - static_cast<long long>(buf.size()) + 1;
+
+        if( buf.end_min < 0 || e < buf.end_min || e - buf.end_min >= k
+            || s > beg )
+        {
+            buf.clear();
+            beg = std::max(s, e - k + 1);
+        }else{
+            beg = std::max( beg, std::max(s, buf.end_min - REFRESH_BARS + 1) );
+        }
+
+        auto bars = acc.copy_between( minutes(beg), minutes(e) );
+        long long base = buf.size()
+            ? buf.end_min - static_cast<long long>(buf.size()) + 1
+            : -1;
+        size_t first = buf.size();
+        // newest first
+        for( auto d = bars.crbegin(); d != bars.crend(); ++d ){
+            long long m = static_cast<long long>(d->min_since_epoch);
+            if( base < 0 )
+                base = m;
+            if( m < base )
+                continue;
+            size_t i = static_cast<size_t>(m - base);
+            /* shouldn't happen (data is contiguous) but treat as empty */
+            while( buf.size() < i )
+                buf.set_bar( buf.size(), OHLCVData() );
+            if( buf.set_bar(i, *d) )
+                first = std::min(first, i);
+        }
+        if( base >= 0 )
+            buf.end_min = base + static_cast<long long>(buf.size()) - 1;
+        buf.eval_from = std::min(buf.eval_from, first);
+        buf.trim( keep() );
+    }
+
+    void
+    run(vector<SymbolBuffers*>& work)
+    {
+        std::atomic<size_t> next(0);
+        auto worker = [&](){
+            for( size_t i = next++; i < work.size(); i = next++ )
+                run_plan(plan, *work[i]);
+        };
+
+        run_parallel( std::min(static_cast<size_t>(nthreads), work.size()),
+                      worker );
+    }
+};
+
+
+Screen::Screen( const string& expression,
+                unsigned int nbars,
+                unsigned int nthreads )
+    :
+        _impl( new Impl(expression, nbars, nthreads) )
+    {
+    }
+
+
+Screen::~Screen()
+    {
+    }
+
+
+string
+Screen::get_expression() const
+{ return _impl->expression; }
+
+
+unsigned int
+Screen::get_lookback() const
+{ return _impl->plan.lookback(); }
+
+
+unsigned int
+Screen::get_nbars() const
+{ return _impl->nbars; }
+
+
+std::set<string>
+Screen::evaluate()
+{ return evaluate( GetSymbols() ); }
+
+
+std::set<string>
+Screen::evaluate( const std::set<string>& symbols )
+{
+    if( !IsInitialized() ){
+        log_error("SCREEN", "DataStore has not been initialized");
+        throw std::logic_error("DataStore has not been initialized");
+    }
+
+    Update();
+
+    /* the store isn't thread safe; only the evaluation is parallel */
+    std::unique_ptr<DataAccessor> acc;
+    vector<SymbolBuffers*> work;
+    for( auto& s : symbols ){
+        string sym = toupper(s);
+        if( !Contains(sym) ){
+            log_info("SCREEN", "symbol not in store", sym);
+            continue;
+        }
+        if( acc )
+            acc->set_symbol(sym);
+        else
+            acc.reset( new DataAccessor(sym) );
+
+        auto& buf = _impl->buffers[sym];
+        _impl->sync(*acc, buf);
+        if( buf.size() )
+            work.push_back(&buf);
+    }
+
+    _impl->run(work);
+
+    std::set<string> matches;
+    for( auto& s : symbols ){
+        auto b = _impl->buffers.find( toupper(s) );
+        if( b == _impl->buffers.end() || !b->second.size() )
+            continue;
+        const double *r = _impl->root(b->second);
+        if( r && is_true(r[b->second.size() - 1]) )
+            matches.insert(b->first);
+    }
+    return matches;
+}
+
+
+std::vector<double>
+Screen::series( const string& symbol ) const
+{
+    std::vector<double> v;
+    auto b = _impl->buffers.find( toupper(symbol) );
+    if( b == _impl->buffers.end() )
+        return v;
+
+    const double *r = _impl->root(b->second);
+    size_t n = b->second.eval_from;
+    if( !r )
+        return v;
+
+    for( size_t i = 0; i < _impl->nbars && i < n; ++i )
+        v.push_back( r[n - 1 - i] );
+    return v;
+}
+
+
+minutes
+Screen::end_minute( const string& symbol ) const
+{
+    auto b = _impl->buffers.find( toupper(symbol) );
+    if( b == _impl->buffers.end() || b->second.end_min < 0 )
+        return ERROR_MINUTES;
+    return minutes(b->second.end_min);
+}
+
+
+void
+Screen::reset( const string& symbol )
+{
+    if( symbol.empty() )
+        _impl->buffers.clear();
+    else
+        _impl->buffers.erase( toupper(symbol) );
+}
+
+}; /* namespace ds */
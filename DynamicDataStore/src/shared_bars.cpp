@@ -0,0 +1,559 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <algorithm>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "shared_bars.h"
+#include "tdma_data_share.h"
+
+using std::string;
+using ds::OHLCVData;
+
+namespace {
+
+string
+segment_name( const string& name )
+{ return (name.empty() || name[0] != '/') ? "/" + name : name; }
+
+size_t
+segment_size( unsigned int nbars, unsigned int max_symbols )
+{
+    return sizeof(SharedBarsHeader)
+        + sizeof(SharedSymbol) * max_symbols
+        + sizeof(SharedBar) * static_cast<size_t>(nbars) * max_symbols;
+}
+
+void
+throw_errno( const string& tag, const string& msg, int e )
+{
+    string m = msg + ": " + string(strerror(e));
+    log_error(tag, m);
+    throw std::runtime_error(m);
+}
+
+std::map<string, std::weak_ptr<SharedBarsReader>> readers;
+std::mutex readers_mtx;
+
+/* accessors in one process share the mapping */
+std::shared_ptr<SharedBarsReader>
+get_reader( const string& name )
+{
+    std::lock_guard<std::mutex> _(readers_mtx);
+    auto r = readers[name].lock();
+    if( !r ){
+        r = std::make_shared<SharedBarsReader>(name);
+        readers[name] = r;
+    }
+    return r;
+}
+
+} /* namespace */
+
+
+SharedBarsSegment::SharedBarsSegment( const string& name,
+                                      unsigned int nbars,
+                                      unsigned int max_symbols )
+    :
+        _name( name ),
+        _addr( nullptr ),
+        _size( segment_size(nbars, max_symbols) ),
+        _owner( true )
+    {
+        string sname = segment_name(name);
+
+        /* a stale segment from a dead writer is simply replaced */
+        shm_unlink( sname.c_str() );
+
+        int fd = shm_open( sname.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644 );
+        if( fd == -1 )
+            throw_errno("SHARE", "shm_open failed", errno);
+
+        if( ftruncate(fd, _size) == -1 ){
+            int e = errno;
+            close(fd);
+            shm_unlink( sname.c_str() );
+            throw_errno("SHARE", "ftruncate failed", e);
+        }
+
+        _addr = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if( _addr == MAP_FAILED ){
+            _addr = nullptr;
+            shm_unlink( sname.c_str() );
+            throw_errno("SHARE", "mmap failed", errno);
+        }
+
+        /* ftruncate zero-fills; only the header needs setting */
+        SharedBarsHeader *h = header();
+        h->magic = SHARED_BARS_MAGIC;
+        h->version = SHARED_BARS_VERSION;
+        h->max_symbols = max_symbols;
+        h->nbars = nbars;
+        h->generation.store(0);
+        h->active.store(1, std::memory_order_release);
+    }
+
+
+SharedBarsSegment::SharedBarsSegment( const string& name )
+    :
+        _name( name ),
+        _addr( nullptr ),
+        _size( 0 ),
+        _owner( false )
+    {
+        int fd = shm_open( segment_name(name).c_str(), O_RDONLY, 0 );
+        if( fd == -1 )
+            throw_errno("SHARE-ATTACH", "shm_open failed (" + name + ")", errno);
+
+        struct stat st;
+        if( fstat(fd, &st) == -1 ){
+            int e = errno;
+            close(fd);
+            throw_errno("SHARE-ATTACH", "fstat failed", e);
+        }
+        _size = static_cast<size_t>(st.st_size);
+
+        if( _size < sizeof(SharedBarsHeader) ){
+            close(fd);
+            log_error("SHARE-ATTACH", "segment too small", name);
+            throw std::runtime_error("shared bars segment too small");
+        }
+
+        _addr = mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if( _addr == MAP_FAILED ){
+            _addr = nullptr;
+            throw_errno("SHARE-ATTACH", "mmap failed", errno);
+        }
+
+        SharedBarsHeader *h = header();
+        if( h->magic != SHARED_BARS_MAGIC || h->version != SHARED_BARS_VERSION
+            || _size < segment_size(h->nbars, h->max_symbols) )
+        {
+            munmap(_addr, _size);
+            _addr = nullptr;
+            log_error("SHARE-ATTACH", "invalid segment", name);
+            throw std::runtime_error("invalid shared bars segment");
+        }
+    }
+
+
+SharedBarsSegment::~SharedBarsSegment()
+{
+    if( _addr )
+        munmap(_addr, _size);
+    if( _owner )
+        shm_unlink( segment_name(_name).c_str() );
+}
+
+
+SharedBarsWriter::SharedBarsWriter( const string& name,
+                                    unsigned int nbars,
+                                    unsigned int max_symbols )
+    :
+        _segment( name, nbars, max_symbols )
+    {
+    }
+
+
+SharedBarsWriter::~SharedBarsWriter()
+{
+    _segment.header()->active.store(0, std::memory_order_release);
+}
+
+
+bool
+SharedBarsWriter::publish( const string& symbol,
+                           const std::deque<OHLCVData>& data,
+                           unsigned long long min_start,
+                           unsigned long long min_end,
+                           unsigned long long from_min )
+{
+    SharedBarsHeader *h = _segment.header();
+
+    auto f = _slots.find(symbol);
+    if( f == _slots.end() ){
+        if( symbol.size() > SHARED_BARS_SYMBOL_MAX ){
+            log_error("SHARE", "symbol too long to share", symbol);
+            return false;
+        }
+        unsigned int i = 0;
+        for( ; i < h->max_symbols && _segment.symbol(i)->used; ++i )
+            {}
+        if( i == h->max_symbols ){
+            log_error("SHARE", "no room for symbol", symbol);
+            return false;
+        }
+        f = _slots.emplace(symbol, i).first;
+        from_min = 0;
+    }
+
+    SharedSymbol *s = _segment.symbol(f->second);
+    SharedBar *bars = _segment.bars(f->second);
+
+    unsigned long long beg = 0, end = 0;
+    if( min_end > 0 ){
+        beg = std::max( min_start,
+                        (min_end >= h->nbars) ? min_end - h->nbars + 1 : 0 );
+        end = min_end;
+    }
+
+    uint64_t stamp = s->stamp.load(std::memory_order_relaxed);
+    s->stamp.store(stamp + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    bool is_new = !s->used;
+    if( is_new ){
+        memset(s->symbol, 0, sizeof(s->symbol));
+        strncpy(s->symbol, symbol.c_str(), SHARED_BARS_SYMBOL_MAX);
+        s->used = 1;
+    }
+
+    /* only bars that are new, revised or newly in the window */
+    unsigned long long from = beg;
+    if( !is_new && s->end_min > 0 && from_min > 0 && s->start_min <= beg )
+        from = std::max( std::min<unsigned long long>(from_min, s->end_min + 1),
+                         beg );
+
+    if( end > 0 ){
+        for( unsigned long long m = from; m <= end; ++m ){
+            const OHLCVData& d = data[min_end - m];
+            SharedBar& b = bars[m % h->nbars];
+            b.min_since_epoch = d.min_since_epoch;
+            b.open = d.open;
+            b.high = d.high;
+            b.low = d.low;
+            b.close = d.close;
+            b.volume = d.volume;
+        }
+    }
+    s->start_min = beg;
+    s->end_min = end;
+
+    s->stamp.store(stamp + 2, std::memory_order_release);
+
+    if( is_new )
+        h->generation.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+
+void
+SharedBarsWriter::remove( const string& symbol )
+{
+    auto f = _slots.find(symbol);
+    if( f == _slots.end() )
+        return;
+
+    SharedSymbol *s = _segment.symbol(f->second);
+    uint64_t stamp = s->stamp.load(std::memory_order_relaxed);
+    s->stamp.store(stamp + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s->used = 0;
+    s->start_min = s->end_min = 0;
+    s->stamp.store(stamp + 2, std::memory_order_release);
+
+    _segment.header()->generation.fetch_add(1, std::memory_order_release);
+    _slots.erase(f);
+}
+
+
+SharedBarsReader::SharedBarsReader( const string& name )
+    :
+        _segment( name )
+    {
+    }
+
+
+std::set<string>
+SharedBarsReader::get_symbols() const
+{
+    std::set<string> symbols;
+    for( unsigned int i = 0; i < _segment.header()->max_symbols; ++i ){
+        const SharedSymbol *s = _segment.symbol(i);
+        for( ;; ){
+            uint64_t stamp = s->stamp.load(std::memory_order_acquire);
+            if( stamp & 1 ){
+                std::this_thread::yield();
+                continue;
+            }
+            bool used = s->used;
+            string sym( s->symbol, strnlen(s->symbol, SHARED_BARS_SYMBOL_MAX) );
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if( s->stamp.load(std::memory_order_relaxed) != stamp )
+                continue;
+            if( used )
+                symbols.insert(sym);
+            break;
+        }
+    }
+    return symbols;
+}
+
+
+int
+SharedBarsReader::find( const string& symbol ) const
+{
+    for( unsigned int i = 0; i < _segment.header()->max_symbols; ++i ){
+        const SharedSymbol *s = _segment.symbol(i);
+        /* verified under the seqlock when read */
+        if( s->used && strncmp(s->symbol, symbol.c_str(),
+                               SHARED_BARS_SYMBOL_MAX + 1) == 0 )
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+
+bool
+SharedBarsReader::read( int slot,
+                        const string& symbol,
+                        range_func_ty range_func,
+                        std::vector<OHLCVData>& out,
+                        std::pair<long long, long long>& watermark ) const
+{
+    const SharedBarsHeader *h = _segment.header();
+    if( slot < 0 || static_cast<unsigned int>(slot) >= h->max_symbols )
+        return false;
+
+    const SharedSymbol *s = _segment.symbol(slot);
+    const SharedBar *bars = _segment.bars(slot);
+
+    for( ;; ){
+        uint64_t stamp = s->stamp.load(std::memory_order_acquire);
+        if( stamp & 1 ){
+            std::this_thread::yield();
+            continue;
+        }
+
+        out.clear();
+        bool ok = s->used && strncmp(s->symbol, symbol.c_str(),
+                                     SHARED_BARS_SYMBOL_MAX + 1) == 0;
+        long long beg = static_cast<long long>(s->start_min);
+        long long end = static_cast<long long>(s->end_min);
+
+        /* don't size the copy from a torn (start, end) */
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if( s->stamp.load(std::memory_order_relaxed) != stamp )
+            continue;
+
+        if( ok && end > 0 ){
+            auto r = range_func(beg, end);
+            long long lo = std::max(r.first, beg);
+            long long hi = std::min(r.second, end);
+            /* the ring never holds more than 'nbars' */
+            if( hi - lo >= static_cast<long long>(h->nbars) )
+                lo = hi - static_cast<long long>(h->nbars) + 1;
+            for( long long m = hi; m >= lo; --m ){
+                const SharedBar& b = bars[m % h->nbars];
+                out.emplace_back( b.min_since_epoch, b.open, b.high, b.low,
+                                  b.close, b.volume );
+            }
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if( s->stamp.load(std::memory_order_relaxed) != stamp )
+            continue;
+
+        if( !ok ){
+            out.clear();
+            return false;
+        }
+        watermark = (end > 0) ? std::make_pair(beg, end)
+                              : std::make_pair(-1LL, -1LL);
+        return true;
+    }
+}
+
+
+namespace ds {
+
+using namespace std::chrono;
+
+SharedDataAccessor::SharedDataAccessor( const string& name,
+                                        const string& symbol )
+    :
+        _reader( get_reader(name) ),
+        _name( name ),
+        _slot( -1 )
+    {
+        _set_symbol(symbol);
+    }
+
+
+void
+SharedDataAccessor::_set_symbol( const string& symbol )
+{
+    string s = toupper(symbol);
+    int slot = _reader->find(s);
+    if( slot < 0 ){
+        log_error("SHARED-ACCESS-SET", "symbol not shared", s);
+        throw std::logic_error("symbol not shared");
+    }
+    _symbol = s;
+    _slot = slot;
+}
+
+
+void
+SharedDataAccessor::set_symbol( const string& symbol )
+{ _set_symbol(symbol); }
+
+
+string
+SharedDataAccessor::get_symbol() const
+{ return _symbol; }
+
+
+string
+SharedDataAccessor::get_name() const
+{ return _name; }
+
+
+bool
+SharedDataAccessor::is_writer_active() const
+{ return _reader->is_writer_active(); }
+
+
+std::vector<OHLCVData>
+SharedDataAccessor::_read( range_func_ty range_func,
+                           std::pair<long long, long long>& watermark ) const
+{
+    std::vector<OHLCVData> bars;
+    if( !_reader->read(_slot, _symbol, range_func, bars, watermark) ){
+        /* slot was re-used (symbol removed and maybe re-added) */
+        int slot = _reader->find(_symbol);
+        if( slot < 0
+            || !_reader->read(slot, _symbol, range_func, bars, watermark) )
+        {
+            log_error("SHARED-ACCESS", "symbol no longer shared", _symbol);
+            throw std::logic_error("symbol no longer shared");
+        }
+        _slot = slot;
+    }
+    return bars;
+}
+
+
+std::pair<minutes, minutes>
+SharedDataAccessor::start_end_minutes() const
+{
+    std::pair<long long, long long> w;
+    _read( [](long long, long long){ return std::make_pair(1LL, 0LL); }, w );
+    if( w.first < 0 )
+        return {ERROR_MINUTES, ERROR_MINUTES};
+    return {minutes(w.first), minutes(w.second)};
+}
+
+
+minutes
+SharedDataAccessor::start_minute() const
+{ return start_end_minutes().first; }
+
+
+minutes
+SharedDataAccessor::end_minute() const
+{ return start_end_minutes().second; }
+
+
+OHLCVData
+SharedDataAccessor::operator[]( minutes min_since_epoch ) const
+{
+    auto v = copy_between(min_since_epoch, min_since_epoch);
+    return v.empty() ? OHLCVData::null : v[0];
+}
+
+
+OHLCVData
+SharedDataAccessor::operator[]( unsigned int indx ) const
+{
+    auto v = copy_between(indx, indx);
+    return v.empty() ? OHLCVData::null : v[0];
+}
+
+
+std::vector<OHLCVData>
+SharedDataAccessor::copy_between( minutes start_min_since_epoch,
+                                  minutes end_min_since_epoch ) const
+{
+    if( start_min_since_epoch > end_min_since_epoch ){
+        log_error("SHARED-COPY-BETWEEN-TIME", "start > end", _symbol);
+        throw std::invalid_argument("start > end");
+    }
+    long long s = start_min_since_epoch.count();
+    long long e = end_min_since_epoch.count();
+    std::pair<long long, long long> w;
+    return _read( [=](long long, long long){ return std::make_pair(s, e); },
+                  w );
+}
+
+
+std::vector<OHLCVData>
+SharedDataAccessor::copy_between( minutes start_min_since_epoch ) const
+{
+    long long s = start_min_since_epoch.count();
+    std::pair<long long, long long> w;
+    return _read( [=](long long, long long end){
+                      return std::make_pair(s, end);
+                  }, w );
+}
+
+
+std::vector<OHLCVData>
+SharedDataAccessor::copy_between( unsigned int start_indx,
+                                  unsigned int end_indx ) const
+{
+    if( start_indx < end_indx ){
+        log_error("SHARED-COPY-BETWEEN-INDX", "start_indx < end_indx", _symbol);
+        throw std::invalid_argument("start_indx < end_indx");
+    }
+    long long si = start_indx, ei = end_indx;
+    std::pair<long long, long long> w;
+    return _read( [=](long long, long long end){
+                      return std::make_pair(end - si, end - ei);
+                  }, w );
+}
+
+
+std::vector<OHLCVData>
+SharedDataAccessor::copy_between() const
+{
+    std::pair<long long, long long> w;
+    return _read( [](long long beg, long long end){
+                      return std::make_pair(beg, end);
+                  }, w );
+}
+
+
+std::set<string>
+SharedDataAccessor::GetSymbols( const string& name )
+{ return get_reader(name)->get_symbols(); }
+
+}; /* namespace ds */
@@ -0,0 +1,197 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+/*
+ * TradingCalendar around the 2019 US/Eastern DST boundaries (offline: days
+ * are loaded from a store file, no requests)
+ *
+ * 2019-03-10 EST -> EDT @ 07:00 UTC, 2019-11-03 EDT -> EST @ 06:00 UTC
+ * regular 09:30 - 16:00 ET, pre 07:00 - 09:30 ET, post 16:00 - 20:00 ET
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdio>
+#include <stdexcept>
+
+#include "tdma_data_calendar.h"
+
+using namespace std;
+using namespace ds;
+using std::chrono::minutes;
+
+namespace {
+
+const string PATH = "test_calendar.dat";
+
+minutes
+utc(int y, unsigned int mo, unsigned int d, unsigned int h, unsigned int mi)
+{ return FromCivilTime(y, mo, d, h, mi); }
+
+/* one line of the store file; 'offset' is UTC - ET in hours (5 EST, 4 EDT) */
+string
+day_line(int y, unsigned int mo, unsigned int d, bool is_open, int offset)
+{
+    string date = to_string(y) + (mo < 10 ? "-0" : "-") + to_string(mo)
+                  + (d < 10 ? "-0" : "-") + to_string(d);
+    string line = tdma::to_string(tdma::MarketType::equity) + " " + date;
+    if( !is_open )
+        return line + " 0 -1 -1 -1 -1 -1 -1";
+
+    long long day = DaysFromCivil(y, mo, d) * 1440 + offset * 60;
+    return line + " 1 " + to_string(day + 7 * 60) + " "
+           + to_string(day + 9 * 60 + 30) + " "
+           + to_string(day + 9 * 60 + 30) + " "
+           + to_string(day + 16 * 60) + " "
+           + to_string(day + 16 * 60) + " "
+           + to_string(day + 20 * 60);
+}
+
+void
+check(bool b, const string& what)
+{
+    cout<< "  " << what << ": " << (b ? "OK" : "FAILED") << endl;
+    if( !b )
+        throw std::runtime_error(what);
+}
+
+void
+civil_time()
+{
+    cout<< endl << "*** CIVIL TIME ***" << endl;
+
+    CivilTime c = ToCivilTime( utc(2019, 3, 10, 7, 0) );
+    check( c.year == 2019 && c.month == 3 && c.day == 10 && c.hour == 7
+           && c.minute == 0 && c.weekday == 0, "2019-03-10 07:00 (Sunday)" );
+
+    c = ToCivilTime( minutes(-1) );
+    check( c.year == 1969 && c.month == 12 && c.day == 31 && c.hour == 23
+           && c.minute == 59 && c.weekday == 3, "1969-12-31 23:59 (Wednesday)" );
+
+    check( utc(1969, 12, 31, 23, 59) == minutes(-1), "FromCivilTime < epoch" );
+    check( utc(2020, 2, 29, 12, 0) + minutes(1440) == utc(2020, 3, 1, 12, 0),
+           "leap day" );
+}
+
+void
+dst_begin(const TradingCalendar& cal)
+{
+    cout<< endl << "*** DST BEGIN (2019-03-10) ***" << endl;
+    const auto EQ = tdma::MarketType::equity;
+
+    /* Fri EST: 14:30 - 21:00 UTC, Mon EDT: 13:30 - 20:00 UTC */
+    check( !cal.is_open(EQ, utc(2019, 3, 8, 14, 29)), "Fri 14:29 UTC closed" );
+    check( cal.is_open(EQ, utc(2019, 3, 8, 14, 30)), "Fri 14:30 UTC open" );
+    check( !cal.is_open(EQ, utc(2019, 3, 11, 13, 29)), "Mon 13:29 UTC closed" );
+    check( cal.is_open(EQ, utc(2019, 3, 11, 13, 30)), "Mon 13:30 UTC open" );
+    check( !cal.is_open(EQ, utc(2019, 3, 11, 20, 0)), "Mon 20:00 UTC closed" );
+
+    /* Fri post market runs past midnight UTC */
+    check( cal.is_open(EQ, utc(2019, 3, 9, 0, 59), true), "Fri post @ Sat 00:59 UTC" );
+    check( !cal.is_open(EQ, utc(2019, 3, 9, 1, 0), true), "Fri post ends Sat 01:00 UTC" );
+
+    /* Eastern midnight is 05:00 UTC before, 04:00 UTC after */
+    check( cal.is_trading_day(EQ, utc(2019, 3, 9, 4, 59)), "Sat 04:59 UTC is Fri" );
+    check( !cal.is_trading_day(EQ, utc(2019, 3, 9, 5, 0)), "Sat 05:00 UTC is Sat" );
+    check( !cal.is_trading_day(EQ, utc(2019, 3, 11, 3, 59)), "Mon 03:59 UTC is Sun" );
+    check( cal.is_trading_day(EQ, utc(2019, 3, 11, 4, 0)), "Mon 04:00 UTC is Mon" );
+
+    check( cal.next_session_start(EQ, utc(2019, 3, 8, 21, 0))
+           == utc(2019, 3, 11, 13, 30), "next start after Fri close" );
+    check( cal.next_session_start(EQ, utc(2019, 3, 9, 1, 0), true)
+           == utc(2019, 3, 11, 11, 0), "next extended start after Fri post" );
+
+    check( cal.session_minutes_between(EQ, utc(2019, 3, 8, 14, 30),
+                                       utc(2019, 3, 11, 20, 0)) == 780,
+           "regular minutes Fri open -> Mon close" );
+    check( cal.session_minutes_between(EQ, utc(2019, 3, 8, 5, 0),
+                                       utc(2019, 3, 12, 0, 0), true) == 1560,
+           "extended minutes Fri -> Mon" );
+}
+
+void
+dst_end(const TradingCalendar& cal)
+{
+    cout<< endl << "*** DST END (2019-11-03) ***" << endl;
+    const auto EQ = tdma::MarketType::equity;
+
+    /* Fri EDT: 13:30 - 20:00 UTC, Mon EST: 14:30 - 21:00 UTC */
+    check( cal.is_open(EQ, utc(2019, 11, 1, 13, 30)), "Fri 13:30 UTC open" );
+    check( !cal.is_open(EQ, utc(2019, 11, 1, 20, 0)), "Fri 20:00 UTC closed" );
+    check( !cal.is_open(EQ, utc(2019, 11, 4, 13, 30)), "Mon 13:30 UTC closed" );
+    check( cal.is_open(EQ, utc(2019, 11, 4, 14, 30)), "Mon 14:30 UTC open" );
+    check( cal.is_open(EQ, utc(2019, 11, 4, 20, 59)), "Mon 20:59 UTC open" );
+
+    check( cal.is_trading_day(EQ, utc(2019, 11, 2, 3, 59)), "Sat 03:59 UTC is Fri" );
+    check( !cal.is_trading_day(EQ, utc(2019, 11, 2, 4, 0)), "Sat 04:00 UTC is Sat" );
+    check( !cal.is_trading_day(EQ, utc(2019, 11, 4, 4, 59)), "Mon 04:59 UTC is Sun" );
+    check( cal.is_trading_day(EQ, utc(2019, 11, 4, 5, 0)), "Mon 05:00 UTC is Mon" );
+
+    SessionHours h = cal.get_session(EQ, utc(2019, 11, 4, 12, 0));
+    check( h.is_open && h.regular.start == utc(2019, 11, 4, 14, 30).count()
+           && h.regular.length() == 390 && h.pre.length() == 150
+           && h.post.length() == 240, "Mon session" );
+
+    check( cal.next_session_start(EQ, utc(2019, 11, 1, 20, 0))
+           == utc(2019, 11, 4, 14, 30), "next start after Fri close" );
+    check( cal.session_minutes_between(EQ, utc(2019, 11, 1, 13, 30),
+                                       utc(2019, 11, 4, 21, 0)) == 780,
+           "regular minutes Fri open -> Mon close" );
+
+    bool threw = false;
+    try{
+        cal.is_open(EQ, utc(2019, 11, 6, 15, 0));
+    }catch( std::out_of_range& ){
+        threw = true;
+    }
+    check( threw, "day not loaded throws" );
+}
+
+} /* namespace */
+
+
+int
+main(int argc, char* argv[])
+{
+    {
+        std::ofstream out(PATH);
+        out<< day_line(2019, 3, 8, true, 5) << endl
+           << day_line(2019, 3, 9, false, 5) << endl
+           << day_line(2019, 3, 10, false, 5) << endl
+           << day_line(2019, 3, 11, true, 4) << endl
+           << day_line(2019, 11, 1, true, 4) << endl
+           << day_line(2019, 11, 2, false, 4) << endl
+           << day_line(2019, 11, 3, false, 4) << endl
+           << day_line(2019, 11, 4, true, 5) << endl;
+    }
+
+    int ret = 0;
+    try{
+        TradingCalendar cal(PATH);
+        civil_time();
+        dst_begin(cal);
+        dst_end(cal);
+        cout<< endl << "*** SUCCESS ***" << endl;
+    }catch( std::exception& e ){
+        cout<< endl << "*** FAILED *** " << e.what() << endl;
+        ret = 1;
+    }
+
+    std::remove(PATH.c_str());
+    return ret;
+}
@@ -6,6 +6,7 @@
 CPP_SRCS += \
 ../src/get/account.cpp \
 ../src/get/get.cpp \
+../src/get/get_broker.cpp \
 ../src/get/historical.cpp \
 ../src/get/instrument_info.cpp \
 ../src/get/market_hours.cpp \
@@ -16,6 +17,7 @@ CPP_SRCS += \
 OBJS += \
 ./src/get/account.o \
 ./src/get/get.o \
+./src/get/get_broker.o \
 ./src/get/historical.o \
 ./src/get/instrument_info.o \
 ./src/get/market_hours.o \
@@ -26,6 +28,7 @@ OBJS += \
 CPP_DEPS += \
 ./src/get/account.d \
 ./src/get/get.d \
+./src/get/get_broker.d \
 ./src/get/historical.d \
 ./src/get/instrument_info.d \
 ./src/get/market_hours.d \
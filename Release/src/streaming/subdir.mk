@@ -5,17 +5,32 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 CPP_SRCS += \
 ../src/streaming/streaming.cpp \
+../src/streaming/streaming_filter.cpp \
+../src/streaming/streaming_iv_surface.cpp \
+../src/streaming/streaming_router.cpp \
 ../src/streaming/streaming_session.cpp \
+../src/streaming/streaming_shm.cpp \
+../src/streaming/streaming_spreads.cpp \
 ../src/streaming/streaming_subscriptions.cpp 
 
 OBJS += \
 ./src/streaming/streaming.o \
+./src/streaming/streaming_filter.o \
+./src/streaming/streaming_iv_surface.o \
+./src/streaming/streaming_router.o \
 ./src/streaming/streaming_session.o \
+./src/streaming/streaming_shm.o \
+./src/streaming/streaming_spreads.o \
 ./src/streaming/streaming_subscriptions.o 
 
 CPP_DEPS += \
 ./src/streaming/streaming.d \
+./src/streaming/streaming_filter.d \
+./src/streaming/streaming_iv_surface.d \
+./src/streaming/streaming_router.d \
 ./src/streaming/streaming_session.d \
+./src/streaming/streaming_shm.d \
+./src/streaming/streaming_spreads.d \
 ./src/streaming/streaming_subscriptions.d 
 
 
@@ -9,6 +9,7 @@ CPP_SRCS += \
 ../uWebSockets/Group.cpp \
 ../uWebSockets/HTTPSocket.cpp \
 ../uWebSockets/Hub.cpp \
+../uWebSockets/IoUring.cpp \
 ../uWebSockets/Networking.cpp \
 ../uWebSockets/Node.cpp \
 ../uWebSockets/Room.cpp \
@@ -21,6 +22,7 @@ OBJS += \
 ./uWebSockets/Group.o \
 ./uWebSockets/HTTPSocket.o \
 ./uWebSockets/Hub.o \
+./uWebSockets/IoUring.o \
 ./uWebSockets/Networking.o \
 ./uWebSockets/Node.o \
 ./uWebSockets/Room.o \
@@ -33,6 +35,7 @@ CPP_DEPS += \
 ./uWebSockets/Group.d \
 ./uWebSockets/HTTPSocket.d \
 ./uWebSockets/Hub.d \
+./uWebSockets/IoUring.d \
 ./uWebSockets/Networking.d \
 ./uWebSockets/Node.d \
 ./uWebSockets/Room.d \
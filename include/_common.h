@@ -42,6 +42,12 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 #define DEBUG_VERBOSE_1_
 #endif /* NDEBUG */
 
+/* C++ proxies call into the library w/o the C ABI; requires the same
+   compiler/std lib as the library, so exceptions can cross too */
+#if defined(TDMA_API_DIRECT_LINKAGE) && !defined(ALLOW_EXCEPTIONS_ACROSS_ABI)
+#define ALLOW_EXCEPTIONS_ACROSS_ABI
+#endif /* TDMA_API_DIRECT_LINKAGE */
+
 #ifdef ALLOW_EXCEPTIONS_ACROSS_ABI
 #define ALLOW_EXCEPTIONS 1
 #else
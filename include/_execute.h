@@ -80,6 +80,8 @@ class OrderTicketImpl {
     std::vector<OrderTicketImpl> _children;
     double _price;
     double _stop_price;
+    /* serialized on every change so sends don't have to */
+    std::string _json_string;
     // requestedDestination
     // specialInstruction
     // stopPriceLinkBasis
@@ -90,6 +92,9 @@ class OrderTicketImpl {
     // priceLinkType
     // taxLotMethod
 
+    OrderTicketImpl&
+    _serialize();
+
 public:
     typedef OrderTicket ProxyType;
     static const int TYPE_ID_LOW = 1;
@@ -114,7 +119,8 @@ public:
     as_json() const;
 
     std::string
-    as_json_string() const;
+    as_json_string() const
+    { return _json_string; }
 
     OrderSession
     get_session() const;
@@ -0,0 +1,166 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef EXECUTE_ANALYTICS_H_
+#define EXECUTE_ANALYTICS_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include "_tdma_api.h"
+#include "tdma_api_execute.h"
+#include "tdma_api_streaming.h"
+
+/*
+ * Execution Analytics
+ *
+ * One per process: orders are sent w/o a session, and their acks/fills can
+ * come in on any session subscribed to ACCT_ACTIVITY.
+ *
+ * begin_send() stamps the order (steady clock) and snapshots the last
+ * bid/ask seen for its symbol before the request goes out; end_send() files
+ * it under the id the response returns. Sessions feed update() everything
+ * they receive (before filters) for the quote cache and ACCT_ACTIVITY.
+ *
+ * An ack/fill can beat the send's response back - those are held (bounded)
+ * by order id and replayed when the id shows up. Orders leave the pending
+ * table when filled, rejected or canceled, or the oldest when it's full.
+ *
+ * Fills from OrderGetter/OrdersGetter results (add_orders, called by their
+ * get() and Execute_AnalyticsAddOrders) only count toward quantity and
+ * slippage - there's no arrival time to measure - and
+ * only by how much they add to what ACCT_ACTIVITY already reported.
+ */
+
+namespace tdma {
+
+class OrderTicketImpl;
+
+class ExecutionAnalytics{
+public:
+    typedef std::chrono::steady_clock clock_ty;
+
+    struct Send{
+        bool valid; // analytics were enabled
+        std::string symbol;
+        int order_type;
+        int side; // 1 buy, -1 sell, 0 slippage not measured
+        double bid;
+        double ask;
+        int time_bucket;
+        clock_ty::time_point tp;
+    };
+
+    static const size_t MAX_PENDING;
+    static const size_t MAX_EARLY;
+
+private:
+    typedef std::tuple<std::string, int, int> cell_key_ty;
+
+    struct Cell{
+        ExecuteAnalyticsStats stats;
+        double slippage_total; // x quantity
+        double slippage_bps_total; // x quantity
+    };
+
+    enum class EventType{ ack, fill, reject, out };
+
+    struct Event{
+        EventType type;
+        clock_ty::time_point tp;
+        double quantity;
+        double price;
+        bool final; // no quantity left
+    };
+
+    struct Order{
+        Send send;
+        Cell *cell;
+        bool acked;
+        bool fill_timed; // ack_to_fill recorded
+        clock_ty::time_point ack_tp;
+        double fill_quantity; // counted so far, from either source
+        double activity_quantity; // reported by ACCT_ACTIVITY
+    };
+
+    std::atomic<bool> _enabled;
+    std::unordered_map<std::string, std::pair<double, double>> _quotes;
+    std::map<cell_key_ty, Cell> _cells;
+    std::unordered_map<std::string, Order> _pending;
+    std::deque<std::string> _pending_order; // send order, for eviction
+    std::unordered_map<std::string, std::vector<Event>> _early;
+    std::deque<std::string> _early_order;
+    mutable std::mutex _mtx;
+
+    ExecutionAnalytics();
+
+    void
+    _update_quotes(StreamerServiceType service, const json& content);
+
+    void
+    _update_activity(const json& content);
+
+    /* false if the order is done */
+    bool
+    _apply(Order& order, const Event& event);
+
+    void
+    _add_fill(Order& order, double quantity, double notional);
+
+public:
+    static ExecutionAnalytics&
+    instance();
+
+    void
+    set_enabled(bool enabled);
+
+    bool
+    is_enabled() const
+    { return _enabled.load(std::memory_order_relaxed); }
+
+    Send
+    begin_send(const OrderTicketImpl& order) const;
+
+    void
+    end_send(const Send& send, const std::string& order_id);
+
+    void
+    update(StreamerServiceType service, const json& content);
+
+    /* OrderGetter (object) or OrdersGetter (array) result */
+    void
+    add_orders(const json& orders);
+
+    ExecuteAnalyticsStats
+    get_stats( const std::string& symbol,
+               int order_type,
+               int time_bucket ) const;
+
+    void
+    reset();
+};
+
+} /* tdma */
+
+#endif /* EXECUTE_ANALYTICS_H_ */
@@ -0,0 +1,208 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef EXECUTOR_H_
+#define EXECUTOR_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+/*
+ * Executor - where all of the library's threads come from
+ *
+ *   pool      post()          short tasks (timer callbacks, coroutine
+ *                             resumption, parallel evaluation)
+ *   I/O pool  post_io()       blocking calls (e.g HTTP requests)
+ *   I/O       spawn_io()      a dedicated thread for a blocking loop (uWS
+ *                             socket, streaming listener, getter broker)
+ *   timers    post_after()    a timer wheel(TICK resolution, never early);
+ *             post_every()    callbacks run on the pool or I/O pool
+ *
+ * Threads are named ('tdma-...') and pinned to the CPUs set w/
+ * set_affinity(), which also re-pins those already running. Pool threads
+ * start on first use; shrinking a pool retires threads as they go idle.
+ *
+ * The instance is never destroyed; idle threads just block at exit.
+ */
+
+namespace tdma {
+
+class Executor{
+public:
+    typedef std::function<void()> task_ty;
+    typedef unsigned long long timer_id_ty;
+
+    static const std::chrono::milliseconds TICK;
+    static const unsigned int WHEEL_SLOTS = 512;
+
+    static Executor&
+    instance();
+
+    void
+    post(task_ty task);
+
+    void
+    post_io(task_ty task);
+
+    timer_id_ty
+    post_after( std::chrono::milliseconds delay,
+                task_ty task,
+                bool io = false );
+
+    timer_id_ty
+    post_every( std::chrono::milliseconds period,
+                task_ty task,
+                bool io = false );
+
+    /* false if already fired (one-shot) or cancelled */
+    bool
+    cancel(timer_id_ty id);
+
+    /* a named thread w/ the current affinity, joined by the caller */
+    std::thread
+    spawn_io(const std::string& name, task_ty loop);
+
+    void
+    set_pool_size(unsigned int n);
+
+    unsigned int
+    get_pool_size() const;
+
+    void
+    set_io_pool_size(unsigned int n);
+
+    unsigned int
+    get_io_pool_size() const;
+
+    /* empty to unpin */
+    void
+    set_affinity(const std::vector<int>& cpus);
+
+    std::vector<int>
+    get_affinity() const;
+
+    /* library threads currently running (all kinds) */
+    unsigned int
+    get_thread_count() const;
+
+private:
+    class Pool{
+        Executor *_exec;
+        std::string _name;
+        mutable std::mutex _mtx;
+        std::condition_variable _cv;
+        std::deque<task_ty> _tasks;
+        unsigned int _size;
+        unsigned int _nthreads;
+        unsigned int _next_index;
+
+        void
+        _run(unsigned int index);
+
+        /* call w/ _mtx held */
+        void
+        _grow();
+
+    public:
+        Pool(Executor *exec, const std::string& name, unsigned int size);
+
+        void
+        post(task_ty task);
+
+        void
+        set_size(unsigned int n);
+
+        unsigned int
+        get_size() const;
+    };
+
+    struct Timer{
+        timer_id_ty id;
+        unsigned long long due_tick;
+        unsigned long long period_ticks; // 0 if one-shot
+        bool io;
+        task_ty task;
+    };
+
+    typedef std::list<Timer> slot_ty;
+
+    Pool _pool;
+    Pool _io_pool;
+
+    mutable std::mutex _threads_mtx;
+    std::unordered_map<std::thread::id, std::thread::native_handle_type>
+        _threads;
+    std::vector<int> _affinity;
+
+    std::mutex _timer_mtx;
+    std::condition_variable _timer_cv;
+    std::vector<slot_ty> _wheel;
+    std::unordered_map<timer_id_ty, slot_ty::iterator> _timers;
+    std::chrono::steady_clock::time_point _wheel_start;
+    unsigned long long _tick; // next to process
+    timer_id_ty _next_timer_id;
+    bool _timer_thread_started;
+
+    Executor();
+
+    Executor( const Executor& ) = delete;
+
+    Executor&
+    operator=( const Executor& ) = delete;
+
+    /* run by each library thread at start/exit */
+    void
+    _enter(const std::string& name);
+
+    void
+    _exit();
+
+    void
+    _run_timers();
+
+    unsigned long long
+    _current_tick() const;
+
+    /* call w/ _timer_mtx held */
+    timer_id_ty
+    _add_timer( std::chrono::milliseconds delay,
+                std::chrono::milliseconds period,
+                task_ty task,
+                bool io );
+
+    void
+    _insert_timer(Timer&& t);
+
+    static void
+    _run_task(task_ty& task, const char* where);
+
+    static void
+    _apply_affinity( std::thread::native_handle_type h,
+                     const std::vector<int>& cpus );
+};
+
+} /* tdma */
+
+#endif /* EXECUTOR_H_ */
@@ -0,0 +1,145 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef FLIGHT_RECORDER_H_
+#define FLIGHT_RECORDER_H_
+
+#include <string>
+#include <cstdint>
+#include <utility>
+
+/*
+ * Flight Recorder
+ *
+ * Each thread that records gets its own ring of the last RING_SIZE events
+ * (fixed size, 64 bytes each, no locks; recording is a clock read and a few
+ * stores). Rings outlive their threads so a dump after e.g the listening
+ * thread dies still has its events.
+ *
+ * dump() writes the rings as-is (w/o allocating or locking, so it can run in
+ * a signal handler); tools/flight_decode.py orders/prints the events.
+ *
+ * Dumps happen:
+ *   - on request (DumpFlightRecorder)
+ *   - on the signal passed to SetFlightRecorderSignal
+ *   - when a connection, server, auth, or streaming exception is thrown
+ *     (at most once a second)
+ * the latter two only if a path was set w/ SetFlightRecorderPath.
+ *
+ * FILE FORMAT (little endian, native layout):
+ *   FileHeader
+ *   { RingHeader, Event[ring_size] } ... until EOF
+ *
+ * An Event is valid if its 'seq' is in [head - ring_size, head) + 1 of its
+ * ring; the one being written during a dump may be dropped.
+ */
+
+namespace tdma {
+namespace flight {
+
+enum class EventType : uint16_t {
+    none = 0,
+    request_start, /* text: url class */
+    request_end, /* text: url class, a: HTTP status(0 if failed), b: usec */
+    throttle, /* text: client id, a: wait msec, b: # gets */
+    token_refresh, /* text: client id, a: success */
+    ws_connect,
+    ws_disconnect, /* text: message, a: code */
+    ws_error,
+    ws_frame, /* a: size, b: opcode */
+    frame_parsed, /* text: response type, a: # items */
+    subscription_request, /* text: service command, a: request id */
+    subscription_response, /* text: service command, a: request id, b: code */
+    exception, /* text: name: what, a: error code, b: line number */
+    listening_stop /* text: reason, a: callback type */
+};
+
+static const uint32_t RING_SIZE = 512;
+static const uint32_t MAX_RINGS = 64;
+static const size_t TEXT_SIZE = 30;
+
+struct Event {
+    uint64_t seq; /* index in the ring + 1, 0 while being written */
+    int64_t ts_nsec; /* steady clock */
+    int64_t a;
+    int64_t b;
+    uint16_t type;
+    char text[TEXT_SIZE]; /* not null-terminated if full */
+};
+
+static_assert( sizeof(Event) == 64, "sizeof(flight::Event) != 64" );
+
+struct FileHeader {
+    char magic[8]; /* "TDMAFR01" */
+    uint32_t event_size;
+    uint32_t ring_size;
+    int64_t steady_nsec; /* steady and system clocks at the time of the dump */
+    int64_t system_nsec;
+    int64_t pid;
+    char reason[256]; /* null-terminated */
+};
+
+struct RingHeader {
+    uint64_t thread_id;
+    uint64_t head; /* # events ever written */
+    uint32_t alive;
+    uint32_t pad;
+};
+
+void
+record( EventType type,
+        long long a = 0,
+        long long b = 0,
+        const char* text = nullptr,
+        const char* text2 = nullptr );
+
+/* write all rings to 'path'; returns false if the file can't be written */
+bool
+dump(const char* path, const char* reason);
+
+/* "" to disable automatic dumps */
+void
+set_path(const std::string& path);
+
+std::string
+get_path();
+
+/* dump to the path when 'signum' is received; 0 to stop */
+void
+set_signal(int signum);
+
+/* record an exception and, if it's a connection/server/streaming error,
+   dump (if a path is set and we haven't in the last second) */
+void
+on_exception( const char* name,
+              const char* what,
+              int error_code,
+              int lineno );
+
+/* see TDMA_API_THROW */
+template<typename E>
+E&&
+recorded(E&& e)
+{
+    on_exception(e.name(), e.what(), e.error_code(), e.lineno());
+    return std::forward<E>(e);
+}
+
+} /* flight */
+} /* tdma */
+
+#endif /* FLIGHT_RECORDER_H_ */
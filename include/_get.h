@@ -16,7 +16,14 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 */
 
 #include <string>
+#include <vector>
+#include <cstdlib>
 #include <chrono>
+#include <set>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
 
 #include "curl_connect.h"
 #include "tdma_api_get.h"
@@ -43,19 +50,69 @@ const int TYPE_ID_GETTER_USER_PRINCIPALS = 17;
 const int TYPE_ID_GETTER_INSTRUMENT_INFO = 18;
 
 class APIGetterImpl{
+    friend class GetterBrokerImpl;
+
+    /*
+     * each client_id has its own quota so the throttle state is kept per
+     * 'rate domain'; getters in different domains run in parallel
+     */
+    struct RateDomain{
+        /* held for the throttle wait and the request */
+        std::mutex mtx;
+        /* msec since epoch; read w/o mtx */
+        std::atomic<long long> last_get_msec;
+        /* msec since epoch of the first unreserved slot */
+        std::atomic<long long> next_slot_msec;
+        int connection_group;
+        std::mutex stats_mtx;
+        GetterRateDomainStats stats;
+        /* handed out by reserve_slot(), each good for one get_in_slot() */
+        std::mutex slots_mtx;
+        std::multiset<long long> reserved_slots;
+        RateDomain(int connection_group);
+    };
+
+    /* unused reservations older than this are dropped */
+    static const long long RESERVED_SLOT_LIFE_MSEC = 60000;
+
     static std::chrono::milliseconds wait_msec; // DEF_WAIT_MSEC
-    static std::chrono::milliseconds last_get_msec; // 0
-    static std::mutex get_mtx;
+    static std::unordered_map<std::string,
+                              std::shared_ptr<RateDomain>> rate_domains;
+    static std::mutex rate_domains_mtx;
     static int current_connection_group;
+    static std::string broker_path; // empty
+    static std::mutex broker_mtx;
+
+    static std::shared_ptr<RateDomain>
+    get_rate_domain(const std::string& client_id);
 
     static std::string
     throttled_get(APIGetterImpl& getter);
 
+    static std::string
+    throttled_get( conn::HTTPConnectionInterface& connection,
+                   Credentials& creds,
+                   api_on_error_cb_ty on_error_cb );
+
     static std::chrono::milliseconds
-    throttled_wait_remaining();
+    throttled_wait_remaining( const RateDomain& domain,
+                              std::chrono::milliseconds wait );
+
+    /* throttle wait plus any slots reserved ahead of it */
+    static std::chrono::milliseconds
+    domain_wait_remaining( const RateDomain& domain,
+                           std::chrono::milliseconds wait );
+
+    /*
+     * claim the next slot (msec since epoch) of 'domain' w/o blocking: at
+     * least 'wait' after the last response and the slot before it
+     */
+    static long long
+    reserve_slot(RateDomain& domain, std::chrono::milliseconds wait);
 
     api_on_error_cb_ty _on_error_callback;
     std::reference_wrapper<Credentials> _credentials;
+    std::shared_ptr<RateDomain> _rate_domain;
     std::unique_ptr<conn::HTTPConnectionInterface> _connection;
     int _connection_group_id;
 
@@ -91,9 +148,21 @@ public:
     static void
     set_wait_msec(std::chrono::milliseconds msec);
 
+    /* the most remaining in any rate domain */
     static std::chrono::milliseconds
     wait_remaining();
 
+    /* remaining in the rate domain of 'client_id' (0 if not used yet) */
+    static std::chrono::milliseconds
+    wait_remaining(const std::string& client_id);
+
+    /* client_ids of the rate domains used so far */
+    static std::set<std::string>
+    get_rate_domains();
+
+    static GetterRateDomainStats
+    get_rate_domain_stats(const std::string& client_id);
+
     static void
     share_connections(bool share)
     { current_connection_group = (share ? 0 : -1); }
@@ -102,9 +171,31 @@ public:
     is_sharing_connections()
     { return current_connection_group == 0; }
 
+    /* send requests to the getter broker at 'path' (empty to stop) */
+    static void
+    use_broker(const std::string& path);
+
+    static std::string
+    get_broker();
+
     virtual std::string
     get();
 
+    /* get() parsed; null if empty */
+    json
+    get_json();
+
+    /* (slot, msec until it) in this getter's rate domain; doesn't block */
+    std::pair<long long, std::chrono::milliseconds>
+    reserve_slot();
+
+    /*
+     * get() in a slot from reserve_slot(), w/o waiting behind other slots;
+     * ValueException if this getter's domain didn't issue it (or it's used)
+     */
+    std::string
+    get_in_slot(long long slot);
+
     void
     close();
 
@@ -118,4 +209,132 @@ public:
     get_timeout() const;
 };
 
+
+/*
+ * JsonRecordReader decodes the flat records of a response - the objects
+ * 'depth' levels down, under one of the top-level 'roots' keys - straight
+ * from the text (SAX), for filling the C structs (TDMA_Candle etc.) without
+ * building the json. Each scalar field of a record is passed to field();
+ * missing/null/non-numeric values are NaN, 0 or false.
+ */
+class JsonRecordReader
+        : public nlohmann::json_sax<json> {
+public:
+    struct Value{
+        enum { INTEGER, FLOAT, STRING, BOOLEAN } type;
+        long long i;
+        double d;
+        const std::string *s;
+
+        double
+        as_double() const;
+
+        long long
+        as_llong() const;
+
+        bool
+        as_bool() const;
+    };
+
+    /* throws if 's' isn't valid json */
+    void
+    read(const std::string& s);
+
+    bool null() override;
+    bool boolean(bool val) override;
+    bool number_integer(number_integer_t val) override;
+    bool number_unsigned(number_unsigned_t val) override;
+    bool number_float(number_float_t val, const string_t& s) override;
+    bool string(string_t& val) override;
+    bool start_object(std::size_t elements) override;
+    bool key(string_t& val) override;
+    bool end_object() override;
+    bool start_array(std::size_t elements) override;
+    bool end_array() override;
+    bool parse_error(std::size_t position, const std::string& last_token,
+                     const nlohmann::detail::exception& ex) override;
+
+protected:
+    JsonRecordReader(int depth, std::vector<std::string> roots);
+
+    /* 'root' is the index into 'roots' */
+    virtual void
+    begin_record(int root) = 0;
+
+    virtual void
+    field(const std::string& key, const Value& v) = 0;
+
+private:
+    const int _depth;
+    const std::vector<std::string> _roots;
+    int _level;
+    int _root;
+    bool _in_record;
+    std::string _key;
+
+    void
+    _scalar(const Value& v);
+};
+
+/* realloc, or throw MemoryError */
+void*
+grow_records(void *buf, size_t nbytes);
+
+/*
+ * RecordBuffer is a growing malloc'd array of C structs that's handed to
+ * the client as-is (free'd w/ the matching Free...Buffer)
+ */
+template<typename T>
+class RecordBuffer{
+    T *_buf;
+    size_t _n;
+    size_t _cap;
+
+public:
+    RecordBuffer()
+        : _buf(nullptr), _n(0), _cap(0)
+    {}
+
+    RecordBuffer(const RecordBuffer&) = delete;
+
+    RecordBuffer&
+    operator=(const RecordBuffer&) = delete;
+
+    ~RecordBuffer()
+    { free( (void*)_buf ); }
+
+    /* new zeroed record */
+    T&
+    add()
+    {
+        if( _n == _cap ){
+            size_t cap = _cap ? _cap * 2 : 64;
+            _buf = reinterpret_cast<T*>( grow_records(_buf, cap * sizeof(T)) );
+            _cap = cap;
+        }
+        _buf[_n] = T();
+        return _buf[_n++];
+    }
+
+    T*
+    begin()
+    { return _buf; }
+
+    T*
+    end()
+    { return _buf + _n; }
+
+    /* give up ownership (null if empty) */
+    void
+    release(T **pbuf, size_t *n)
+    {
+        *n = _n;
+        *pbuf = _n ? _buf : nullptr;
+        if( !_n )
+            free( (void*)_buf );
+        _buf = nullptr;
+        _n = _cap = 0;
+    }
+};
+
 } /* tdma */
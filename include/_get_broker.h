@@ -0,0 +1,171 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef GET_BROKER_H_
+#define GET_BROKER_H_
+
+#include <string>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <atomic>
+#include <vector>
+
+#include "_tdma_api.h"
+
+/*
+ * Getter Broker
+ *
+ * The getter throttle (APIGetterImpl::wait_msec) is process-wide; two
+ * processes using the same account each get their own budget. The broker
+ * lets one process own the budget (and the Credentials) while getters in
+ * other processes forward their request URLs to it over a unix socket.
+ *
+ * Broker side:
+ *   - every request goes through the normal throttled_get path so the
+ *     broker process's own getters share the same schedule
+ *   - identical URLs that are in-flight are coalesced into one request
+ *   - successful responses are cached for 'cache_msec' (0 to disable)
+ *
+ * Client side (APIGetterImpl::use_broker):
+ *   - APIGetterImpl::get() sends the URL instead of connecting; getter
+ *     objects, their arguments and error callbacks are unchanged
+ *   - the broker's credentials are used, NOT the client's
+ *
+ * Frames (native byte order, local only):
+ *   request:   [uint32 len][url]
+ *   response:  [int32 status][int32 code][uint32 len][data]
+ */
+
+namespace tdma {
+
+enum class GetterBrokerStatus : int32_t {
+    ok = 0,         /* code = http response code, data = body */
+    http_error = 1, /* code = http response code, data = body */
+    exception = 2   /* code = TDMA_API_ error code, data = message */
+};
+
+struct GetterBrokerResponse{
+    GetterBrokerStatus status;
+    int32_t code;
+    std::string data;
+};
+
+
+class GetterBrokerImpl{
+    struct InFlight{
+        bool done;
+        GetterBrokerResponse response;
+        std::condition_variable cv;
+        InFlight() : done(false) {}
+    };
+
+    struct CacheEntry{
+        std::chrono::steady_clock::time_point expires;
+        std::string data;
+    };
+
+    std::reference_wrapper<Credentials> _credentials;
+    std::string _path;
+    std::chrono::milliseconds _cache_msec;
+    int _listen_fd;
+    std::atomic<bool> _running;
+    std::thread _accept_thread;
+
+    std::mutex _clients_mtx;
+    std::unordered_set<int> _client_fds;
+    std::unordered_map<std::thread::id, std::thread> _client_threads;
+    std::vector<std::thread::id> _finished_threads;
+
+    std::mutex _state_mtx;
+    std::unordered_map<std::string, std::shared_ptr<InFlight>> _in_flight;
+    std::unordered_map<std::string, CacheEntry> _cache;
+
+    std::mutex _conn_mtx;
+    conn::HTTPConnection _connection;
+
+    std::atomic<unsigned long long> _nrequests;
+    std::atomic<unsigned long long> _nfetched;
+
+    void
+    _accept_loop();
+
+    void
+    _client_loop(int fd);
+
+    /* call w/ _clients_mtx */
+    void
+    _join_finished();
+
+    GetterBrokerResponse
+    _fetch(const std::string& url);
+
+    GetterBrokerResponse
+    _request(const std::string& url);
+
+public:
+    static const std::chrono::milliseconds DEF_CACHE_MSEC;
+
+    GetterBrokerImpl( Credentials& creds,
+                      const std::string& path,
+                      std::chrono::milliseconds cache_msec );
+
+    ~GetterBrokerImpl();
+
+    GetterBrokerImpl( const GetterBrokerImpl& ) = delete;
+
+    GetterBrokerImpl&
+    operator=( const GetterBrokerImpl& ) = delete;
+
+    std::string
+    get_path() const
+    { return _path; }
+
+    /* requests received, and requests actually sent to the server */
+    unsigned long long
+    get_nrequests() const
+    { return _nrequests; }
+
+    unsigned long long
+    get_nfetched() const
+    { return _nfetched; }
+
+    /* one broker per process */
+    static void
+    start( Credentials& creds,
+           const std::string& path,
+           std::chrono::milliseconds cache_msec );
+
+    static void
+    stop();
+
+    static bool
+    is_running();
+
+    /* client side */
+    static std::string
+    request(const std::string& path, const std::string& url,
+            api_on_error_cb_ty on_error_cb);
+};
+
+} /* tdma */
+
+#endif /* GET_BROKER_H_ */
@@ -0,0 +1,812 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef JSON_PARSE_H_
+#define JSON_PARSE_H_
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <cmath>
+#include <cfloat>
+#include <clocale>
+
+#include "_common.h"
+#include "json.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) \
+    && (defined(__x86_64__) || defined(__i386__))
+#define JSON_PARSE_X86_
+#include <immintrin.h>
+#endif
+
+/*
+ * Structural-Index JSON Parser
+ *
+ * Drop-in for json::parse on the hot paths (getter responses, streaming
+ * messages, the DataStore callback). Returns the same json object, but
+ * gets there in two passes:
+ *
+ *   1) index: 64 bytes at a time build bitmasks of quotes, backslashes,
+ *      structural chars ({}[]:,) and whitespace; resolve escaped quotes
+ *      and mask out string interiors (prefix-xor of the quote mask). What's
+ *      left - structural chars, quotes and the first char of each number/
+ *      literal - is flattened into a vector of byte offsets. The mask pass
+ *      has AVX2, SSE4.2 and scalar versions, picked at runtime.
+ *
+ *   2) build: walk the offsets, extracting values on demand. Strings are
+ *      copied straight from [open quote, close quote) unless the document
+ *      contained backslashes or non-ascii/control bytes; small numbers are
+ *      converted w/o strtod.
+ *
+ * Anything unusual (invalid JSON, deep nesting, numbers strtod must handle,
+ * > 4GB) falls back to json::parse so results/exceptions are unchanged.
+ */
+
+namespace tdma {
+
+enum class JsonIndexBackend : int {
+    scalar = 0,
+    sse42 = 1,
+    avx2 = 2
+};
+
+namespace json_parse_detail {
+
+const unsigned MAX_DEPTH = 512;
+
+/* set by set_json_index_backend, -1 to use the best available */
+inline std::atomic<int>&
+backend_override()
+{
+    static std::atomic<int> b(-1);
+    return b;
+}
+
+inline JsonIndexBackend
+best_backend()
+{
+#ifdef JSON_PARSE_X86_
+    static const JsonIndexBackend b = [](){
+        __builtin_cpu_init();
+        if( __builtin_cpu_supports("avx2") )
+            return JsonIndexBackend::avx2;
+        if( __builtin_cpu_supports("sse4.2") )
+            return JsonIndexBackend::sse42;
+        return JsonIndexBackend::scalar;
+    }();
+    return b;
+#else
+    return JsonIndexBackend::scalar;
+#endif /* JSON_PARSE_X86_ */
+}
+
+/* raw (pre-string-masking) masks for one 64 byte block */
+struct BlockMasks{
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t op;
+    uint64_t ws;
+    uint64_t unusual; /* < 0x20 or >= 0x80 */
+};
+
+inline void
+masks_scalar(const unsigned char *p, BlockMasks& m)
+{
+    m = BlockMasks{0,0,0,0,0};
+    for( unsigned i = 0; i < 64; ++i ){
+        uint64_t bit = uint64_t(1) << i;
+        unsigned char c = p[i];
+        switch( c ){
+        case '"': m.quote |= bit; break;
+        case '\\': m.backslash |= bit; break;
+        case '{': case '}': case '[': case ']': case ':': case ',':
+            m.op |= bit;
+            break;
+        case ' ': case '\t': case '\n': case '\r':
+            m.ws |= bit;
+            break;
+        }
+        if( c < 0x20 || c >= 0x80 )
+            m.unusual |= bit;
+    }
+}
+
+#ifdef JSON_PARSE_X86_
+
+__attribute__((target("sse4.2"))) inline void
+masks_sse42(const unsigned char *p, BlockMasks& m)
+{
+    const __m128i ops = _mm_setr_epi8('{','}','[',']',':',',',0,0,0,0,0,0,0,0,0,0);
+    const __m128i wss = _mm_setr_epi8(' ','\t','\n','\r',0,0,0,0,0,0,0,0,0,0,0,0);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i bslash = _mm_set1_epi8('\\');
+    const __m128i lim = _mm_set1_epi8(0x20);
+    const int mode = _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK;
+
+    m = BlockMasks{0,0,0,0,0};
+    for( unsigned i = 0; i < 4; ++i ){
+        __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>(p + i*16) );
+        unsigned s = i * 16;
+        /* explicit-length so embedded NULs don't end the compare */
+        m.op |= uint64_t( _mm_cvtsi128_si32(_mm_cmpestrm(ops, 6, v, 16, mode)) & 0xFFFF ) << s;
+        m.ws |= uint64_t( _mm_cvtsi128_si32(_mm_cmpestrm(wss, 4, v, 16, mode)) & 0xFFFF ) << s;
+        m.quote |= uint64_t( unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote))) ) << s;
+        m.backslash |= uint64_t( unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(v, bslash))) ) << s;
+        /* signed compare: >= 0x80 is negative */
+        m.unusual |= uint64_t( unsigned(_mm_movemask_epi8(_mm_cmplt_epi8(v, lim))) ) << s;
+    }
+}
+
+__attribute__((target("avx2"))) inline void
+masks_avx2(const unsigned char *p, BlockMasks& m)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i bslash = _mm256_set1_epi8('\\');
+    const __m256i obrace = _mm256_set1_epi8('{'); /* '[' | 0x20 */
+    const __m256i cbrace = _mm256_set1_epi8('}'); /* ']' | 0x20 */
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lim = _mm256_set1_epi8(0x1F);
+
+    m = BlockMasks{0,0,0,0,0};
+    for( unsigned i = 0; i < 2; ++i ){
+        __m256i v = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(p + i*32) );
+        __m256i vl = _mm256_or_si256(v, case_bit);
+        __m256i op = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(vl, obrace), _mm256_cmpeq_epi8(vl, cbrace)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, colon), _mm256_cmpeq_epi8(v, comma)) );
+        __m256i ws = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, tab)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, nl), _mm256_cmpeq_epi8(v, cr)) );
+        unsigned s = i * 32;
+        m.op |= uint64_t( unsigned(_mm256_movemask_epi8(op)) ) << s;
+        m.ws |= uint64_t( unsigned(_mm256_movemask_epi8(ws)) ) << s;
+        m.quote |= uint64_t( unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote))) ) << s;
+        m.backslash |= uint64_t( unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, bslash))) ) << s;
+        /* signed compare: >= 0x80 is negative */
+        m.unusual |= uint64_t( unsigned(_mm256_movemask_epi8(_mm256_cmpgt_epi8(lim, v))) ) << s;
+    }
+}
+
+#endif /* JSON_PARSE_X86_ */
+
+inline unsigned
+trailing_zeros(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>( __builtin_ctzll(x) );
+#else
+    unsigned n = 0;
+    while( !(x & 1) ){
+        x >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+inline uint64_t
+prefix_xor(uint64_t x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+class Indexer{
+    uint64_t _prev_escaped;
+    uint64_t _prev_in_string;
+    uint64_t _prev_scalar;
+
+    /* bits of chars preceded by an (unescaped) backslash; backslashes are
+       rare in TDMA payloads so blocks w/ them are just walked bit by bit */
+    uint64_t
+    _escaped(uint64_t backslash)
+    {
+        if( !backslash && !_prev_escaped )
+            return 0;
+        uint64_t escaped = 0;
+        bool esc = _prev_escaped != 0;
+        for( unsigned i = 0; i < 64; ++i ){
+            uint64_t bit = uint64_t(1) << i;
+            if( esc ){
+                escaped |= bit;
+                esc = false;
+            }else if( backslash & bit ){
+                esc = true;
+            }
+        }
+        _prev_escaped = esc ? 1 : 0;
+        return escaped;
+    }
+
+public:
+    bool has_backslash;
+    bool has_unusual;
+
+    Indexer()
+        :
+            _prev_escaped(0),
+            _prev_in_string(0),
+            _prev_scalar(0),
+            has_backslash(false),
+            has_unusual(false)
+        {
+        }
+
+    /* returns structural bits for the block */
+    uint64_t
+    next(const BlockMasks& m)
+    {
+        has_backslash |= (m.backslash != 0);
+        has_unusual |= (m.unusual != 0);
+
+        uint64_t quote = m.quote & ~_escaped(m.backslash);
+        /* set from an opening quote up to (not incl.) its closing quote */
+        uint64_t in_string = prefix_xor(quote) ^ _prev_in_string;
+        _prev_in_string = uint64_t( -static_cast<int64_t>(in_string >> 63) );
+
+        /* first char of each number/literal (or stray char) */
+        uint64_t scalar = ~(m.op | m.ws | quote);
+        uint64_t follows_scalar = (scalar << 1) | _prev_scalar;
+        _prev_scalar = scalar >> 63;
+        uint64_t scalar_start = scalar & ~follows_scalar;
+
+        return quote | ((m.op | scalar_start) & ~in_string);
+    }
+
+    bool
+    in_string() const
+    { return _prev_in_string != 0; }
+};
+
+inline bool
+build_index( const unsigned char *p,
+             size_t n,
+             JsonIndexBackend backend,
+             std::vector<uint32_t>& index,
+             bool& has_backslash,
+             bool& has_unusual )
+{
+    typedef void(*masks_fn_ty)(const unsigned char*, BlockMasks&);
+    masks_fn_ty masks_fn = masks_scalar;
+#ifdef JSON_PARSE_X86_
+    if( backend == JsonIndexBackend::avx2 )
+        masks_fn = masks_avx2;
+    else if( backend == JsonIndexBackend::sse42 )
+        masks_fn = masks_sse42;
+#endif /* JSON_PARSE_X86_ */
+
+    index.clear();
+    if( index.capacity() < n / 4 )
+        index.reserve(n / 4);
+
+    Indexer indexer;
+    BlockMasks m;
+    size_t off = 0;
+    for( ; off + 64 <= n || off < n; off += 64 ){
+        uint64_t bits;
+        if( off + 64 <= n ){
+            masks_fn(p + off, m);
+            bits = indexer.next(m);
+        }else{
+            unsigned char tail[64];
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, p + off, n - off);
+            masks_fn(tail, m);
+            bits = indexer.next(m);
+        }
+        while( bits ){
+            index.push_back( static_cast<uint32_t>(off + trailing_zeros(bits)) );
+            bits &= bits - 1;
+        }
+    }
+
+    has_backslash = indexer.has_backslash;
+    has_unusual = indexer.has_unusual;
+    return !indexer.in_string();
+}
+
+
+inline bool
+is_ws(unsigned char c)
+{ return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+inline bool
+is_digit(unsigned char c)
+{ return c >= '0' && c <= '9'; }
+
+/* well-formed UTF-8 (Unicode Table 3-7), no control chars */
+inline bool
+valid_string_bytes(const unsigned char *p, const unsigned char *end)
+{
+    while( p < end ){
+        unsigned char c = *p;
+        if( c < 0x80 ){
+            if( c < 0x20 )
+                return false;
+            ++p;
+            continue;
+        }
+        unsigned len;
+        unsigned char lo = 0x80, hi = 0xBF;
+        if( c >= 0xC2 && c <= 0xDF ){
+            len = 2;
+        }else if( c >= 0xE0 && c <= 0xEF ){
+            len = 3;
+            if( c == 0xE0 ) lo = 0xA0;
+            else if( c == 0xED ) hi = 0x9F;
+        }else if( c >= 0xF0 && c <= 0xF4 ){
+            len = 4;
+            if( c == 0xF0 ) lo = 0x90;
+            else if( c == 0xF4 ) hi = 0x8F;
+        }else{
+            return false;
+        }
+        if( end - p < static_cast<ptrdiff_t>(len) )
+            return false;
+        if( p[1] < lo || p[1] > hi )
+            return false;
+        for( unsigned i = 2; i < len; ++i ){
+            if( p[i] < 0x80 || p[i] > 0xBF )
+                return false;
+        }
+        p += len;
+    }
+    return true;
+}
+
+inline int
+hex4(const unsigned char *p)
+{
+    int v = 0;
+    for( unsigned i = 0; i < 4; ++i ){
+        unsigned char c = p[i];
+        v <<= 4;
+        if( c >= '0' && c <= '9' ) v |= c - '0';
+        else if( c >= 'a' && c <= 'f' ) v |= c - 'a' + 10;
+        else if( c >= 'A' && c <= 'F' ) v |= c - 'A' + 10;
+        else return -1;
+    }
+    return v;
+}
+
+inline void
+append_utf8(std::string& s, uint32_t cp)
+{
+    if( cp < 0x80 ){
+        s.push_back( static_cast<char>(cp) );
+    }else if( cp < 0x800 ){
+        s.push_back( static_cast<char>(0xC0 | (cp >> 6)) );
+        s.push_back( static_cast<char>(0x80 | (cp & 0x3F)) );
+    }else if( cp < 0x10000 ){
+        s.push_back( static_cast<char>(0xE0 | (cp >> 12)) );
+        s.push_back( static_cast<char>(0x80 | ((cp >> 6) & 0x3F)) );
+        s.push_back( static_cast<char>(0x80 | (cp & 0x3F)) );
+    }else{
+        s.push_back( static_cast<char>(0xF0 | (cp >> 18)) );
+        s.push_back( static_cast<char>(0x80 | ((cp >> 12) & 0x3F)) );
+        s.push_back( static_cast<char>(0x80 | ((cp >> 6) & 0x3F)) );
+        s.push_back( static_cast<char>(0x80 | (cp & 0x3F)) );
+    }
+}
+
+inline bool
+unescape(const unsigned char *p, const unsigned char *end, std::string& s)
+{
+    s.reserve(end - p);
+    while( p < end ){
+        const unsigned char *b = static_cast<const unsigned char*>(
+            memchr(p, '\\', end - p) );
+        if( !b ){
+            s.append(reinterpret_cast<const char*>(p), end - p);
+            return true;
+        }
+        s.append(reinterpret_cast<const char*>(p), b - p);
+        p = b + 1; /* index guarantees an escaped char follows */
+        switch( *p++ ){
+        case '"': s.push_back('"'); break;
+        case '\\': s.push_back('\\'); break;
+        case '/': s.push_back('/'); break;
+        case 'b': s.push_back('\b'); break;
+        case 'f': s.push_back('\f'); break;
+        case 'n': s.push_back('\n'); break;
+        case 'r': s.push_back('\r'); break;
+        case 't': s.push_back('\t'); break;
+        case 'u':{
+            if( end - p < 4 )
+                return false;
+            int cp = hex4(p);
+            p += 4;
+            if( cp < 0 || (cp >= 0xDC00 && cp <= 0xDFFF) )
+                return false;
+            if( cp >= 0xD800 && cp <= 0xDBFF ){
+                if( end - p < 6 || p[0] != '\\' || p[1] != 'u' )
+                    return false;
+                int lo = hex4(p + 2);
+                if( lo < 0xDC00 || lo > 0xDFFF )
+                    return false;
+                p += 6;
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+            }
+            append_utf8(s, static_cast<uint32_t>(cp));
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+/* strtoull/strtoll/strtod like json::parse (locale decimal point) */
+inline bool
+number_slow(const char *b, size_t len, bool is_int, bool neg, json& out)
+{
+    std::string tok(b, len);
+    if( !is_int ){
+        const char dp = *(std::localeconv()->decimal_point);
+        if( dp != '.' ){
+            size_t i = tok.find('.');
+            if( i != std::string::npos )
+                tok[i] = dp;
+        }
+    }
+    char *e = nullptr;
+    if( is_int ){
+        errno = 0;
+        if( neg ){
+            long long v = std::strtoll(tok.c_str(), &e, 10);
+            if( errno == 0 && e == tok.c_str() + tok.size() ){
+                out = static_cast<json::number_integer_t>(v);
+                return true;
+            }
+        }else{
+            unsigned long long v = std::strtoull(tok.c_str(), &e, 10);
+            if( errno == 0 && e == tok.c_str() + tok.size() ){
+                out = static_cast<json::number_unsigned_t>(v);
+                return true;
+            }
+        }
+    }
+    double d = std::strtod(tok.c_str(), &e);
+    if( !std::isfinite(d) )
+        return false;
+    out = static_cast<json::number_float_t>(d);
+    return true;
+}
+
+class Builder{
+    const unsigned char *_p;
+    size_t _n;
+    const uint32_t *_index;
+    size_t _nindex;
+    size_t _k;
+    bool _raw_strings;
+    bool _check_strings;
+
+    size_t
+    _next_pos() const
+    { return _k < _nindex ? _index[_k] : _n; }
+
+    /* nothing but whitespace between 'pos' and the next structural */
+    bool
+    _scalar_end(size_t pos) const
+    {
+        size_t end = _next_pos();
+        for( ; pos < end; ++pos ){
+            if( !is_ws(_p[pos]) )
+                return false;
+        }
+        return true;
+    }
+
+    bool
+    _string(size_t open, std::string& s)
+    {
+        if( _k >= _nindex )
+            return false;
+        size_t close = _index[_k++];
+        const unsigned char *b = _p + open + 1;
+        const unsigned char *e = _p + close;
+        if( _check_strings && !valid_string_bytes(b, e) )
+            return false;
+        if( _raw_strings ){
+            s.assign(reinterpret_cast<const char*>(b), e - b);
+            return true;
+        }
+        return unescape(b, e, s);
+    }
+
+    bool
+    _literal(size_t pos, const char *lit, size_t len)
+    {
+        if( _n - pos < len || memcmp(_p + pos, lit, len) )
+            return false;
+        return _scalar_end(pos + len);
+    }
+
+    bool
+    _number(size_t pos, json& out)
+    {
+        static const double POW10[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        const unsigned char *b = _p + pos;
+        const unsigned char *p = b;
+        const unsigned char *end = _p + _n;
+        bool neg = false;
+        if( *p == '-' ){
+            neg = true;
+            if( ++p == end )
+                return false;
+        }
+
+        uint64_t mant = 0;
+        unsigned ndigits = 0;
+        if( *p == '0' ){
+            ++p;
+        }else if( is_digit(*p) ){
+            for( ; p < end && is_digit(*p); ++p, ++ndigits )
+                mant = mant * 10 + (*p - '0');
+        }else{
+            return false;
+        }
+
+        bool is_int = true;
+        int nfrac = 0;
+        if( p < end && *p == '.' ){
+            is_int = false;
+            if( ++p == end || !is_digit(*p) )
+                return false;
+            for( ; p < end && is_digit(*p); ++p, ++nfrac ){
+                if( mant || *p != '0' )
+                    ++ndigits;
+                mant = mant * 10 + (*p - '0');
+            }
+        }
+
+        int exp = 0;
+        if( p < end && (*p == 'e' || *p == 'E') ){
+            is_int = false;
+            if( ++p == end )
+                return false;
+            bool exp_neg = false;
+            if( *p == '-' || *p == '+' ){
+                exp_neg = (*p == '-');
+                if( ++p == end )
+                    return false;
+            }
+            if( !is_digit(*p) )
+                return false;
+            for( ; p < end && is_digit(*p); ++p ){
+                if( exp < 100000 )
+                    exp = exp * 10 + (*p - '0');
+            }
+            if( exp_neg )
+                exp = -exp;
+        }
+
+        if( !_scalar_end(p - _p) )
+            return false;
+
+        /* beyond 19 digits mant may have wrapped */
+        if( ndigits <= 19 ){
+            if( is_int ){
+                if( !neg ){
+                    out = static_cast<json::number_unsigned_t>(mant);
+                    return true;
+                }
+                if( mant <= uint64_t(INT64_MAX) + 1 ){
+                    out = static_cast<json::number_integer_t>(
+                        mant == uint64_t(INT64_MAX) + 1 ? INT64_MIN
+                                                        : -static_cast<int64_t>(mant) );
+                    return true;
+                }
+            }else{
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+                /* exact mantissa and power of ten: one correctly rounded op,
+                   same result as strtod */
+                int e10 = exp - nfrac;
+                if( mant <= (uint64_t(1) << 53) && e10 >= -22 && e10 <= 22 ){
+                    double d = static_cast<double>(mant);
+                    d = (e10 < 0) ? d / POW10[-e10] : d * POW10[e10];
+                    out = static_cast<json::number_float_t>(neg ? -d : d);
+                    return true;
+                }
+#endif
+            }
+        }
+
+        return number_slow( reinterpret_cast<const char*>(b), p - b, is_int,
+                            neg, out );
+    }
+
+public:
+    Builder( const unsigned char *p,
+             size_t n,
+             const std::vector<uint32_t>& index,
+             bool has_backslash,
+             bool has_unusual )
+        :
+            _p(p),
+            _n(n),
+            _index(index.data()),
+            _nindex(index.size()),
+            _k(0),
+            _raw_strings(!has_backslash),
+            _check_strings(has_unusual)
+        {
+        }
+
+    bool
+    value(json& out, unsigned depth)
+    {
+        if( _k >= _nindex || depth > MAX_DEPTH )
+            return false;
+
+        size_t pos = _index[_k++];
+        switch( _p[pos] ){
+        case '{':{
+            out = json::object();
+            auto& obj = out.get_ref<json::object_t&>();
+            if( _k < _nindex && _p[_index[_k]] == '}' ){
+                ++_k;
+                return true;
+            }
+            std::string key;
+            while( true ){
+                if( _k >= _nindex || _p[_index[_k]] != '"' )
+                    return false;
+                key.clear();
+                if( !_string(_index[_k++], key) )
+                    return false;
+                if( _k >= _nindex || _p[_index[_k++]] != ':' )
+                    return false;
+                /* duplicate keys: last one wins, like json::parse */
+                if( !value(obj[key], depth + 1) )
+                    return false;
+                if( _k >= _nindex )
+                    return false;
+                unsigned char c = _p[_index[_k++]];
+                if( c == '}' )
+                    return true;
+                if( c != ',' )
+                    return false;
+            }
+        }
+        case '[':{
+            out = json::array();
+            auto& arr = out.get_ref<json::array_t&>();
+            if( _k < _nindex && _p[_index[_k]] == ']' ){
+                ++_k;
+                return true;
+            }
+            while( true ){
+                arr.emplace_back();
+                if( !value(arr.back(), depth + 1) )
+                    return false;
+                if( _k >= _nindex )
+                    return false;
+                unsigned char c = _p[_index[_k++]];
+                if( c == ']' )
+                    return true;
+                if( c != ',' )
+                    return false;
+            }
+        }
+        case '"':{
+            std::string s;
+            if( !_string(pos, s) )
+                return false;
+            out = std::move(s);
+            return true;
+        }
+        case 't':
+            out = true;
+            return _literal(pos, "true", 4);
+        case 'f':
+            out = false;
+            return _literal(pos, "false", 5);
+        case 'n':
+            out = nullptr;
+            return _literal(pos, "null", 4);
+        case '-': case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            return _number(pos, out);
+        default:
+            return false;
+        }
+    }
+
+    bool
+    done() const
+    { return _k == _nindex; }
+};
+
+} /* json_parse_detail */
+
+
+/* the backend in use (best supported unless overridden) */
+inline JsonIndexBackend
+get_json_index_backend()
+{
+    int b = json_parse_detail::backend_override().load();
+    return (b < 0) ? json_parse_detail::best_backend()
+                   : static_cast<JsonIndexBackend>(b);
+}
+
+/* for benchmarks/testing; returns false if not supported by this cpu */
+inline bool
+set_json_index_backend(JsonIndexBackend backend)
+{
+    if( static_cast<int>(backend)
+        > static_cast<int>(json_parse_detail::best_backend()) )
+    {
+        return false;
+    }
+    json_parse_detail::backend_override().store( static_cast<int>(backend) );
+    return true;
+}
+
+inline json
+parse_json(const char *s, size_t n)
+{
+    using namespace json_parse_detail;
+
+    /* reused by each thread (listener, getters) to avoid re-allocating */
+    static thread_local std::vector<uint32_t> index;
+
+    if( n < UINT32_MAX ){
+        const unsigned char *p = reinterpret_cast<const unsigned char*>(s);
+        bool has_backslash, has_unusual;
+        if( build_index(p, n, get_json_index_backend(), index,
+                        has_backslash, has_unusual) )
+        {
+            json j;
+            Builder b(p, n, index, has_backslash, has_unusual);
+            if( b.value(j, 0) && b.done() )
+                return j;
+        }
+    }
+    /* invalid or unusual; let json::parse handle it (and throw) */
+    return json::parse(s, s + n);
+}
+
+inline json
+parse_json(const std::string& s)
+{ return parse_json(s.data(), s.size()); }
+
+} /* tdma */
+
+#endif /* JSON_PARSE_H_ */
@@ -0,0 +1,347 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef PAPER_BROKER_H_
+#define PAPER_BROKER_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+#include "_tdma_api.h"
+#include "tdma_api_execute.h"
+#include "tdma_api_get.h"
+#include "tdma_api_streaming.h"
+
+/*
+ * Paper Broker
+ *
+ * One per process. Execute_SendOrder/CancelOrder/ReplaceOrder and
+ * OrderGetter/OrdersGetter for an account added here are handled locally
+ * instead of going to TDMA.
+ *
+ * Orders are the json the OrderTicket serializes (SINGLE, TRIGGER and OCO
+ * w/ nested childOrderStrategies; single and multi-leg). Each node of the
+ * tree gets its own order id; the root's is returned.
+ *
+ * Quotes (level one bid/ask/size) come from the QUOTE/OPTION data of any
+ * streaming session ('live', on by default) and/or replay()/set_quote().
+ * The broker's clock is the timestamp of the last quote (the system clock
+ * until there is one): an order sent at T is 'QUEUED' until the first
+ * quote at/after T + the account's latency, then matched:
+ *
+ *   MARKET          at the ask(buy)/bid(sell)
+ *   LIMIT           at the quote if marketable on arrival, otherwise rests
+ *                   and fills at its limit when the quote reaches it
+ *   STOP(_LIMIT)    triggered by ask >= stop(buy)/bid <= stop(sell), then
+ *                   as MARKET(LIMIT)
+ *   NET_DEBIT/NET_CREDIT/NET_ZERO (multi-leg)
+ *                   all legs at their quotes when the net debit/credit
+ *                   is at/through the price
+ *
+ * Fill models (per account):
+ *   TOUCH           resting orders fill when the quote reaches their price
+ *   THROUGH         ... when it goes through their price
+ *   DISPLAYED_SIZE  TOUCH, but no more than the displayed size per quote
+ *
+ * A TRIGGER's children are activated when it fills; the first fill of an
+ * OCO child cancels its siblings. Other order types are accepted and then
+ * REJECTED.
+ *
+ * ACCT_ACTIVITY-style events (OrderEntryRequest, OrderPartialFill,
+ * OrderFill, OrderRejection, UROUT) are passed to the activity callback -
+ * as the json array the streaming callback would get - and to
+ * ExecutionAnalytics; they're only built if one of those wants them.
+ * Callbacks are made outside the lock, on the thread that sent the order or
+ * delivered the quote.
+ *
+ * Orders are matched in per-symbol books (limits/stops sorted by price) so
+ * a quote only looks at orders it can fill. Only the last MAX_CLOSED_ORDERS
+ * closed order trees are kept (for the getters) per account.
+ */
+
+namespace tdma {
+
+class PaperBroker{
+public:
+    static const size_t MAX_CLOSED_ORDERS;
+
+private:
+    struct Order;
+
+    typedef std::multimap<double, Order*, std::greater<double>> desc_book_ty;
+    typedef std::multimap<double, Order*> asc_book_ty;
+
+    struct Quote{
+        double bid;
+        double ask;
+        double bid_size;
+        double ask_size;
+    };
+
+    struct Book{
+        Quote quote;
+        desc_book_ty buy_limits;
+        asc_book_ty sell_limits;
+        asc_book_ty buy_stops;
+        desc_book_ty sell_stops;
+        /* markets waiting on a quote/size, multi-leg orders w/ a leg here */
+        std::vector<Order*> waiting;
+    };
+
+    enum class Slot{ none, buy_limit, sell_limit, buy_stop, sell_stop,
+                     waiting };
+
+    struct Leg{
+        int symbol;
+        int side; // 1 buy, -1 sell
+        long long ratio; // per unit
+    };
+
+    struct Execution{
+        unsigned long long msec;
+        long long quantity;
+        std::vector<double> prices; // per leg
+    };
+
+    struct Account;
+
+    struct Order{
+        unsigned long long id;
+        Account *account;
+        Order *parent;
+        Order *root;
+        std::vector<Order*> children;
+        std::string ticket; // as sent, w/o children
+        OrderStrategyType strategy;
+        OrderType type;
+        std::vector<Leg> legs;
+        long long quantity; // units (legs' quantity gcd)
+        long long filled;
+        double price;
+        double stop_price;
+        bool triggered; // stop
+        OrderStatusType status;
+        unsigned long long entered_msec;
+        unsigned long long close_msec;
+        std::vector<Execution> executions;
+        Slot slot;
+        desc_book_ty::iterator desc_pos;
+        asc_book_ty::iterator asc_pos;
+        bool queued;
+        std::multimap<unsigned long long, Order*>::iterator queued_pos;
+        size_t nopen; // root: nodes of the tree not closed
+    };
+
+    struct Account{
+        std::string id;
+        std::chrono::milliseconds latency;
+        PaperFillModel fill_model;
+        std::map<unsigned long long, std::unique_ptr<Order>> orders; // by id
+        std::deque<unsigned long long> closed; // roots, as they close
+    };
+
+    std::unordered_map<std::string, std::unique_ptr<Account>> _accounts;
+    std::atomic<size_t> _naccounts;
+    std::atomic<bool> _live;
+    std::unordered_map<std::string, int> _symbol_ids;
+    std::vector<std::string> _symbols;
+    std::deque<Book> _books; // by symbol id; stable, orders hold iterators
+    std::multimap<unsigned long long, Order*> _queued; // by activation
+    unsigned long long _now; // msec; 0 until the first quote
+    unsigned long long _next_id;
+    unsigned long long _next_exec_id;
+    paper_activity_cb_ty _callback;
+    bool _emitting;
+    json _events;
+    mutable std::mutex _mtx;
+
+    PaperBroker();
+
+    Account&
+    _get_account(const std::string& account_id) const;
+
+    int
+    _intern(const std::string& symbol);
+
+    unsigned long long
+    _clock() const;
+
+    Order*
+    _create( const json& j,
+             Account& account,
+             Order *parent,
+             std::vector<std::unique_ptr<Order>>& nodes );
+
+    bool
+    _is_supported(const Order& order) const;
+
+    void
+    _place(Order& order);
+
+    void
+    _activate(Order& order);
+
+    void
+    _activate_due();
+
+    void
+    _arrive_single(Order& order);
+
+    bool
+    _try_spread(Order& order, bool resting);
+
+    void
+    _match(int symbol);
+
+    void
+    _fill( Order& order,
+           long long quantity,
+           const std::vector<double>& prices );
+
+    void
+    _trigger_children(Order& order);
+
+    void
+    _cancel_tree(Order& order, OrderStatusType status);
+
+    void
+    _close(Order& order, OrderStatusType status);
+
+    void
+    _unslot(Order& order);
+
+    void
+    _evict(Account& account);
+
+    void
+    _delete_tree(Account& account, Order& order);
+
+    void
+    _emit(const char* type, const Order& order, const std::string& body);
+
+    json
+    _order_json(const Order& order) const;
+
+    void
+    _begin();
+
+    /* unlocks */
+    void
+    _end(std::unique_lock<std::mutex>& lock);
+
+    void
+    _update_quotes( StreamerServiceType service,
+                    unsigned long long timestamp,
+                    const json& content );
+
+    Order&
+    _find_order(Account& account, const std::string& order_id) const;
+
+    std::string
+    _send(Account& account, const json& order);
+
+public:
+    static PaperBroker&
+    instance();
+
+    void
+    add_account(const std::string& account_id);
+
+    void
+    remove_account(const std::string& account_id);
+
+    bool
+    is_account(const std::string& account_id) const;
+
+    void
+    set_latency(const std::string& account_id, std::chrono::milliseconds latency);
+
+    std::chrono::milliseconds
+    get_latency(const std::string& account_id) const;
+
+    void
+    set_fill_model(const std::string& account_id, PaperFillModel model);
+
+    PaperFillModel
+    get_fill_model(const std::string& account_id) const;
+
+    void
+    set_live_quotes(bool live)
+    { _live.store(live); }
+
+    bool
+    get_live_quotes() const
+    { return _live.load(); }
+
+    void
+    set_activity_callback(paper_activity_cb_ty callback);
+
+    /* from the streaming sessions; ignored unless live */
+    void
+    update( StreamerServiceType service,
+            unsigned long long timestamp,
+            const json& content );
+
+    /* recorded QUOTE/OPTION 'data' content */
+    void
+    replay( StreamerServiceType service,
+            unsigned long long timestamp,
+            const json& content );
+
+    void
+    set_quote( const std::string& symbol,
+               double bid,
+               double ask,
+               double bid_size,
+               double ask_size,
+               unsigned long long timestamp );
+
+    std::string
+    send_order(const std::string& account_id, const std::string& order_json);
+
+    bool
+    cancel_order(const std::string& account_id, const std::string& order_id);
+
+    std::string
+    replace_order( const std::string& account_id,
+                   const std::string& order_id,
+                   const std::string& order_json );
+
+    /* OrderGetter/OrdersGetter results */
+    std::string
+    get_order( const std::string& account_id,
+               const std::string& order_id ) const;
+
+    std::string
+    get_orders( const std::string& account_id,
+                unsigned int nmax_results,
+                const std::string& from_entered_time,
+                const std::string& to_entered_time,
+                OrderStatusType status ) const;
+};
+
+} /* tdma */
+
+#endif /* PAPER_BROKER_H_ */
@@ -0,0 +1,140 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef PROBES_H_
+#define PROBES_H_
+
+#include <type_traits>
+
+/*
+ * USDT (static tracepoint) probes, provider 'tdma'
+ *
+ * Each probe is one nop plus a .note.stapsdt entry saying where its
+ * arguments live - the format sys/sdt.h emits, w/o needing the systemtap
+ * headers. perf/bpftrace/bcc replace the nop w/ a breakpoint when attached;
+ * otherwise the cost is the nop and keeping the arguments available.
+ *
+ *   $ bpftrace -l 'usdt:./libTDAmeritradeAPI.so:tdma:*'
+ *
+ * Arguments must be integers or pointers (strings as const char*) and
+ * should be cheap to compute. Define TDMA_API_NO_PROBES to compile them
+ * out; they're always compiled out on other platforms/architectures.
+ *
+ * tools/probes has bpftrace scripts that use them.
+ */
+
+#if !defined(TDMA_API_NO_PROBES) && defined(__linux__) \
+    && (defined(__GNUC__) || defined(__clang__)) \
+    && (defined(__x86_64__) || defined(__aarch64__))
+#define TDMA_PROBES_ENABLED_
+#endif
+
+#ifdef TDMA_PROBES_ENABLED_
+
+namespace tdma {
+namespace probe_detail {
+
+/* the arg spec is '[-]size@location' ('-' if signed); the size operand is
+   printed negated (%n) so unsigned sizes are passed as negative, like sdt.h */
+template<typename T>
+struct ArgSize{
+    typedef typename std::decay<T>::type type;
+    static_assert( std::is_integral<type>::value
+                   || std::is_pointer<type>::value
+                   || std::is_enum<type>::value,
+                   "probe arguments must be integers or pointers" );
+    static const int value = (std::is_signed<type>::value ? 1 : -1)
+                             * static_cast<int>(sizeof(type));
+};
+
+} /* probe_detail */
+} /* tdma */
+
+#define TDMA_PROBE_NOTE_(name, args) \
+    "990: nop\n" \
+    ".pushsection .note.stapsdt,\"?\",\"note\"\n" \
+    ".balign 4\n" \
+    ".4byte 992f-991f, 994f-993f, 3\n" \
+    "991: .asciz \"stapsdt\"\n" \
+    "992: .balign 4\n" \
+    "993: .8byte 990b\n" \
+    ".8byte _.stapsdt.base\n" \
+    ".8byte 0\n" \
+    ".asciz \"tdma\"\n" \
+    ".asciz \"" #name "\"\n" \
+    ".asciz \"" args "\"\n" \
+    "994: .balign 4\n" \
+    ".popsection\n" \
+    ".ifndef _.stapsdt.base\n" \
+    ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+    ".weak _.stapsdt.base\n" \
+    ".hidden _.stapsdt.base\n" \
+    "_.stapsdt.base: .space 1\n" \
+    ".size _.stapsdt.base, 1\n" \
+    ".popsection\n" \
+    ".endif\n"
+
+#define TDMA_PROBE_FMT_(n) "%n[_s" #n "]@%[_a" #n "]"
+
+#define TDMA_PROBE_ARG_(n, x) \
+    [_s##n] "n" (tdma::probe_detail::ArgSize<decltype(x)>::value), \
+    [_a##n] "nor" (x)
+
+#define TDMA_PROBE0(name) \
+    __asm__ __volatile__ ( TDMA_PROBE_NOTE_(name, "") )
+
+#define TDMA_PROBE1(name, a1) \
+    __asm__ __volatile__ ( TDMA_PROBE_NOTE_(name, TDMA_PROBE_FMT_(1)) \
+                           :: TDMA_PROBE_ARG_(1, a1) )
+
+#define TDMA_PROBE2(name, a1, a2) \
+    __asm__ __volatile__ ( TDMA_PROBE_NOTE_(name, TDMA_PROBE_FMT_(1) " " \
+                                                  TDMA_PROBE_FMT_(2)) \
+                           :: TDMA_PROBE_ARG_(1, a1), \
+                              TDMA_PROBE_ARG_(2, a2) )
+
+#define TDMA_PROBE3(name, a1, a2, a3) \
+    __asm__ __volatile__ ( TDMA_PROBE_NOTE_(name, TDMA_PROBE_FMT_(1) " " \
+                                                  TDMA_PROBE_FMT_(2) " " \
+                                                  TDMA_PROBE_FMT_(3)) \
+                           :: TDMA_PROBE_ARG_(1, a1), \
+                              TDMA_PROBE_ARG_(2, a2), \
+                              TDMA_PROBE_ARG_(3, a3) )
+
+#define TDMA_PROBE4(name, a1, a2, a3, a4) \
+    __asm__ __volatile__ ( TDMA_PROBE_NOTE_(name, TDMA_PROBE_FMT_(1) " " \
+                                                  TDMA_PROBE_FMT_(2) " " \
+                                                  TDMA_PROBE_FMT_(3) " " \
+                                                  TDMA_PROBE_FMT_(4)) \
+                           :: TDMA_PROBE_ARG_(1, a1), \
+                              TDMA_PROBE_ARG_(2, a2), \
+                              TDMA_PROBE_ARG_(3, a3), \
+                              TDMA_PROBE_ARG_(4, a4) )
+
+#else
+
+#define TDMA_PROBE0(name) do{}while(0)
+#define TDMA_PROBE1(name, a1) do{ (void)(a1); }while(0)
+#define TDMA_PROBE2(name, a1, a2) do{ (void)(a1); (void)(a2); }while(0)
+#define TDMA_PROBE3(name, a1, a2, a3) \
+    do{ (void)(a1); (void)(a2); (void)(a3); }while(0)
+#define TDMA_PROBE4(name, a1, a2, a3, a4) \
+    do{ (void)(a1); (void)(a2); (void)(a3); (void)(a4); }while(0)
+
+#endif /* TDMA_PROBES_ENABLED_ */
+
+#endif /* PROBES_H_ */
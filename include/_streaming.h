@@ -15,6 +15,9 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see http://www.gnu.org/licenses.
 */
 
+#ifndef STREAMING_H_
+#define STREAMING_H_
+
 #include <string>
 #include <map>
 #include <unordered_map>
@@ -75,8 +78,8 @@ protected:
 
 public:
     void
-    set_parameters(const std::map<std::string, std::string>& parameters)
-    { _parameters = parameters; }
+    set_parameters(std::map<std::string, std::string> parameters)
+    { _parameters = std::move(parameters); }
 
     // caller responsible for syncing w/ this
     // TODO check for empty/malformed ?
@@ -108,7 +111,7 @@ public:
     get_command_str() const
     { return _command_str; }
 
-    std::map<std::string, std::string>
+    const std::map<std::string, std::string>&
     get_parameters() const
     { return _parameters; }
 
@@ -124,6 +127,18 @@ public:
     operator!=(const StreamingSubscriptionImpl& sub ) const
     { return !(*this == sub); }
 
+    // managed subscriptions hash their typed state, not the parameters
+    virtual size_t
+    hash() const
+    {
+        std::hash<std::string> hs;
+        size_t h = util::hash_combine( hs(_service_str), hs(_command_str) );
+        for( auto& p : _parameters )
+            h = util::hash_combine( util::hash_combine(h, hs(p.first)),
+                                    hs(p.second) );
+        return h;
+    }
+
     virtual
     ~StreamingSubscriptionImpl(){}
 };
@@ -137,4 +152,4 @@ C_sub_ptr_to_impl(StreamingSubscription_C *psub);
 
 } /* tdma */
 
-
+#endif /* STREAMING_H_ */
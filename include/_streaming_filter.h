@@ -0,0 +1,124 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef STREAMING_FILTER_H_
+#define STREAMING_FILTER_H_
+
+#include <string>
+#include <set>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+
+#include "_tdma_api.h"
+#include "tdma_api_streaming.h"
+
+/*
+ * Streaming Filters
+ *
+ * Evaluated by the listener thread right after a 'data' response is
+ * parsed; items that don't match are removed from 'content' before it's
+ * published or passed to the callback (and if none are left, neither
+ * happens).
+ *
+ * Per service:
+ *   - symbols: if not empty, an item's 'key' must be in the set
+ *   - rules: if any, at least one has to match:
+ *       changed - the field is in the update (level one services only
+ *                 send fields that changed)
+ *       delta   - |value - value of the last update that passed| >= 'value'
+ *                 (always matches the first time a symbol is seen)
+ *       cross   - value crossed the level 'value' since the last update
+ *                 that had the field, passed or not
+ */
+
+namespace tdma {
+
+class StreamingFilterImpl{
+    struct Rule{
+        StreamingFilterRuleType type;
+        std::string field;
+        double value;
+    };
+
+    typedef std::unordered_map<std::string, double> field_values_ty;
+
+    std::unordered_set<std::string> _symbols;
+    std::vector<Rule> _rules;
+    /* by symbol */
+    std::unordered_map<std::string, field_values_ty> _last_passed;
+    std::unordered_map<std::string, field_values_ty> _last_seen;
+    unsigned long long _npassed;
+    unsigned long long _ndropped;
+
+    bool
+    _passes(const json& item);
+
+public:
+    StreamingFilterImpl();
+
+    void
+    set_symbols(const std::set<std::string>& symbols);
+
+    void
+    add_rule(int field, StreamingFilterRuleType type, double value);
+
+    /* removes what doesn't pass, returns false if nothing's left */
+    bool
+    apply(json& content);
+
+    unsigned long long
+    get_npassed() const
+    { return _npassed; }
+
+    unsigned long long
+    get_ndropped() const
+    { return _ndropped; }
+};
+
+
+class StreamingFilterSet{
+    std::unordered_map<int, StreamingFilterImpl> _filters;
+    mutable std::mutex _mtx;
+
+public:
+    void
+    set_symbols(StreamerServiceType service,
+                const std::set<std::string>& symbols);
+
+    void
+    add_rule( StreamerServiceType service,
+              int field,
+              StreamingFilterRuleType type,
+              double value );
+
+    /* StreamerServiceType::NONE to clear all */
+    void
+    clear(StreamerServiceType service);
+
+    bool
+    apply(StreamerServiceType service, json& content);
+
+    /* npassed, ndropped */
+    std::pair<unsigned long long, unsigned long long>
+    get_stats(StreamerServiceType service) const;
+};
+
+} /* tdma */
+
+#endif /* STREAMING_FILTER_H_ */
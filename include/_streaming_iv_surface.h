@@ -0,0 +1,202 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef STREAMING_IV_SURFACE_H_
+#define STREAMING_IV_SURFACE_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include "_tdma_api.h"
+#include "tdma_api_streaming.h"
+
+/*
+ * Streaming IV Surface
+ *
+ * Per underlying, a smile (natural cubic spline of vol over strike) for
+ * each expiry, kept up to date from the OPTION 'data' the listener thread
+ * receives (before filters) and/or seeded from an OptionChainGetter result.
+ *
+ * A contract is placed on the surface by its underlying, expiration,
+ * strike and contract type - from the first (full) update of the symbol or
+ * the chain it was seeded from. Each strike uses the OTM side's vol (the
+ * average when the underlying price isn't known).
+ *
+ * Off until enabled (or seeded) so sessions that don't use it do no work;
+ * disabling drops everything it holds.
+ *
+ * An update only marks its expiry dirty; dirty expiries are refit at most
+ * once per refit interval - by the next OPTION message after it's passed,
+ * or a timer (Executor pool) if none comes, or refit(). Each refit publishes a new immutable snapshot w/ an atomic
+ * shared_ptr store, so queries never wait on the engine's mutex or a refit
+ * and always see whole smiles.
+ *
+ * Queries interpolate in strike w/ the smile (flat beyond the wings) and
+ * linearly in total variance between expiries (flat before the first and
+ * after the last). Expiries are taken to expire at 21:00 UTC.
+ */
+
+namespace tdma {
+
+class IVSurfaceEngine{
+public:
+    struct Smile{
+        int date; // days since epoch
+        std::vector<double> strikes;
+        std::vector<double> vols; // decimal
+        std::vector<double> d2; // spline second derivatives
+
+        double
+        vol(double strike) const;
+    };
+
+    struct Surface{
+        std::vector<std::shared_ptr<const Smile>> smiles; // by date
+        double underlying_price; // nan if unknown
+        double rate; // decimal
+
+        /* decimal; 'days' to expiration, 'now' in days since epoch */
+        double
+        vol(double strike, double days, double now) const;
+    };
+
+private:
+    typedef std::unordered_map<std::string, std::shared_ptr<const Surface>>
+        surfaces_ty;
+
+    struct Underlying;
+
+    struct Expiry{
+        int date;
+        Underlying *underlying;
+        std::map<double, std::pair<double, double>> strikes; // call, put vol
+        std::shared_ptr<const Smile> smile;
+        std::chrono::steady_clock::time_point last_fit;
+        bool dirty;
+    };
+
+    struct Underlying{
+        std::string symbol;
+        std::map<int, Expiry> expiries;
+        double price;
+        double rate;
+        bool changed; // a smile was refit, needs to be published
+    };
+
+    struct Contract{
+        Expiry *expiry;
+        double strike;
+        bool call;
+    };
+
+    /* node based, the Expiry/Underlying pointers stay valid */
+    std::unordered_map<std::string, Underlying> _underlyings;
+    std::unordered_map<std::string, Contract> _contracts;
+    std::vector<Expiry*> _dirty;
+    std::chrono::milliseconds _refit_interval;
+    /* only through std::atomic_load/atomic_store */
+    std::shared_ptr<const surfaces_ty> _surfaces;
+    std::atomic<bool> _enabled;
+    mutable std::mutex _mtx;
+
+    /* held by the refit timer's task; the engine can go before it fires */
+    struct TimerGuard{
+        std::mutex mtx;
+        IVSurfaceEngine *engine;
+    };
+    std::shared_ptr<TimerGuard> _timer_guard;
+    bool _timer_pending;
+
+    Contract*
+    _add_contract( const std::string& symbol,
+                   const std::string& underlying,
+                   int date,
+                   double strike,
+                   bool call );
+
+    void
+    _set_vol(Contract& contract, double vol);
+
+    /* call w/ _mtx */
+    void
+    _refit(bool force);
+
+    /* call w/ _mtx; when the first dirty expiry is due */
+    void
+    _schedule_refit();
+
+    std::shared_ptr<const Surface>
+    _get_surface(const std::string& underlying) const;
+
+public:
+    static const std::chrono::milliseconds DEF_REFIT_INTERVAL;
+
+    IVSurfaceEngine();
+
+    ~IVSurfaceEngine();
+
+    IVSurfaceEngine( const IVSurfaceEngine& ) = delete;
+
+    IVSurfaceEngine&
+    operator=( const IVSurfaceEngine& ) = delete;
+
+    void
+    set_refit_interval(std::chrono::milliseconds interval);
+
+    std::chrono::milliseconds
+    get_refit_interval() const;
+
+    void
+    set_enabled(bool enabled);
+
+    bool
+    is_enabled() const
+    { return _enabled.load(std::memory_order_relaxed); }
+
+    /* the (decoded) result of an OptionChainGetter; enables, refits now */
+    void
+    seed(const json& chain);
+
+    /* all dirty expiries, ignoring the refit interval */
+    void
+    refit();
+
+    void
+    update(StreamerServiceType service, const json& content);
+
+    /* percent, like the OPTION 'volatility' field */
+    double
+    get_vol( const std::string& underlying,
+             double strike,
+             double days_to_expiration ) const;
+
+    IVSurfaceGreeks
+    get_greeks( const std::string& underlying,
+                double strike,
+                double days_to_expiration,
+                bool call ) const;
+};
+
+} /* tdma */
+
+#endif /* STREAMING_IV_SURFACE_H_ */
@@ -0,0 +1,121 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef STREAMING_ROUTER_H_
+#define STREAMING_ROUTER_H_
+
+#include <string>
+#include <set>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+#include "_tdma_api.h"
+#include "tdma_api_streaming.h"
+
+/*
+ * Streaming Router
+ *
+ * Handlers for a service's 'data' (all of it) or for some of its symbols
+ * (just their items, in the order received). Evaluated by the listener
+ * thread after filters; what no route takes goes to the session's callback
+ * (the catch-all) along w/ everything that isn't 'data'.
+ *
+ * Every change rebuilds an immutable table - per service, the handlers for
+ * all of it and, by interned symbol id, offsets into a flat array of
+ * handler slots - and publishes it w/ an atomic shared_ptr store; dispatch
+ * loads it w/o the lock (which only serializes changes). So a handler can
+ * still be called (once) by a message that was being routed when it was
+ * removed.
+ */
+
+namespace tdma {
+
+class StreamingRouter{
+    struct Handler{
+        streaming_cb_ty callback;
+        streaming_json_cb_ty json_callback;
+    };
+
+    struct Route{
+        StreamerServiceType service;
+        std::vector<std::string> symbols; // empty for all
+        Handler handler;
+    };
+
+    struct Table{
+        std::unordered_map<std::string, int> symbol_ids;
+        /* by service */
+        std::vector<std::vector<Handler>> service_handlers;
+        /* by service, then symbol id (size nsymbols + 1 or empty) */
+        std::vector<std::vector<unsigned int>> symbol_offsets;
+        std::vector<std::vector<int>> symbol_slots;
+        std::vector<Handler> slot_handlers;
+    };
+
+    std::map<int, Route> _routes; // by id (slots follow this order)
+    int _next_id;
+    /* only through std::atomic_load/atomic_store */
+    std::shared_ptr<const Table> _table;
+    std::atomic<bool> _empty;
+    std::mutex _mtx;
+
+    int
+    _add(StreamerServiceType service,
+         const std::set<std::string>& symbols,
+         Handler handler);
+
+    void
+    _rebuild();
+
+public:
+    StreamingRouter();
+
+    /* no symbols for all of the service's data */
+    int
+    add_route( StreamerServiceType service,
+               const std::set<std::string>& symbols,
+               streaming_cb_ty callback );
+
+    int
+    add_route( StreamerServiceType service,
+               const std::set<std::string>& symbols,
+               streaming_json_cb_ty callback );
+
+    void
+    remove_route(int id);
+
+    void
+    clear();
+
+    /*
+     * calls the routes 'content' matches; false if none did, otherwise
+     * 'unrouted' gets the items no route took (if any)
+     */
+    bool
+    route( StreamerServiceType service,
+           unsigned long long timestamp,
+           const json& content,
+           json& unrouted ) const;
+};
+
+} /* tdma */
+
+#endif /* STREAMING_ROUTER_H_ */
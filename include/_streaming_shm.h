@@ -0,0 +1,217 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef STREAMING_SHM_H_
+#define STREAMING_SHM_H_
+
+#include <string>
+#include <atomic>
+#include <unordered_set>
+#include <set>
+#include <chrono>
+#include <cstdint>
+
+#include "_streaming.h"
+
+/*
+ * Shared-memory fan-out of a single StreamingSession
+ *
+ * The publishing process owns the session and writes each decoded item
+ * (one per symbol for 'data' callbacks) into a fixed-slot broadcast ring
+ * that lives in a named shared memory segment. Subscribers in other
+ * processes map the segment read-only and keep their own cursor.
+ *
+ *   [ RingHeader ][ slot 0 ][ slot 1 ] ... [ slot nslots-1 ]
+ *
+ *   slot: [ SlotHeader | data (NUL terminated json) ]
+ *
+ * The publisher never waits on subscribers. Each slot has a 'stamp' that
+ * works like a seqlock: odd while being written, (pos+1)*2 when complete.
+ * A subscriber that falls more than 'nslots' behind skips ahead and counts
+ * what it missed; an item it has already been handed can be checked with
+ * 'is_valid' to make sure it wasn't overwritten while in use.
+ */
+
+namespace tdma {
+
+const int TYPE_ID_STREAMING_SUBSCRIBER = 101;
+
+const uint64_t STREAMING_SHM_MAGIC = 0x5444414d41534d52ULL; // "TDAMASMR"
+const uint32_t STREAMING_SHM_VERSION = 2;
+const size_t STREAMING_SHM_SYMBOL_MAX = 39;
+
+static_assert( ATOMIC_LLONG_LOCK_FREE == 2,
+               "shared memory ring requires lock-free 64 bit atomics" );
+
+struct alignas(64) StreamingRingHeader{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t nslots;
+    uint32_t slot_size;
+    std::atomic<uint32_t> active;
+    std::atomic<uint64_t> write_pos;
+    std::atomic<uint64_t> noversize;
+    int64_t pid; // publisher's
+};
+
+struct StreamingSlotHeader{
+    std::atomic<uint64_t> stamp;
+    uint64_t timestamp;
+    int32_t callback_type;
+    int32_t service_type;
+    uint32_t data_len;
+    char symbol[STREAMING_SHM_SYMBOL_MAX + 1];
+};
+
+
+class SharedMemorySegment{
+    std::string _name;
+    void *_addr;
+    size_t _size;
+    bool _owner;
+
+public:
+    /* create a read/write segment (replaces it only if 'is_stale') */
+    SharedMemorySegment( const std::string& name,
+                         size_t size,
+                         bool(*is_stale)(const void*, size_t) );
+
+    /* attach to an existing segment read-only */
+    explicit SharedMemorySegment(const std::string& name);
+
+    ~SharedMemorySegment();
+
+    SharedMemorySegment( const SharedMemorySegment& ) = delete;
+
+    SharedMemorySegment&
+    operator=( const SharedMemorySegment& ) = delete;
+
+    void*
+    get() const
+    { return _addr; }
+
+    size_t
+    size() const
+    { return _size; }
+
+    std::string
+    get_name() const
+    { return _name; }
+};
+
+
+class StreamingPublisherImpl{
+    SharedMemorySegment _segment;
+    StreamingRingHeader *_header;
+    char *_slots;
+    uint64_t _pos;
+
+    StreamingSlotHeader*
+    _slot(uint64_t pos) const
+    {
+        return reinterpret_cast<StreamingSlotHeader*>(
+            _slots + (pos & (_header->nslots - 1)) * _header->slot_size );
+    }
+
+    void
+    _write( StreamingCallbackType cb_type,
+            StreamerServiceType ss_type,
+            unsigned long long ts,
+            const std::string& symbol,
+            const std::string& data );
+
+public:
+    static const size_t DEF_NSLOTS = 65536;
+    static const size_t DEF_SLOT_SIZE = 1024;
+    static const size_t MIN_SLOT_SIZE = 256;
+
+    StreamingPublisherImpl( const std::string& name,
+                            size_t nslots,
+                            size_t slot_size );
+
+    ~StreamingPublisherImpl();
+
+    /* splits 'data' arrays into one item per symbol ('key') */
+    void
+    publish( StreamingCallbackType cb_type,
+             StreamerServiceType ss_type,
+             unsigned long long ts,
+             const json& j );
+
+    std::string
+    get_name() const
+    { return _segment.get_name(); }
+};
+
+
+class StreamingSubscriberImpl{
+    SharedMemorySegment _segment;
+    const StreamingRingHeader *_header;
+    const char *_slots;
+    uint64_t _cursor;
+    unsigned long long _ndropped;
+    uint64_t _services_mask;
+    std::unordered_set<std::string> _symbols;
+
+    const StreamingSlotHeader*
+    _slot(uint64_t pos) const
+    {
+        return reinterpret_cast<const StreamingSlotHeader*>(
+            _slots + (pos & (_header->nslots - 1)) * _header->slot_size );
+    }
+
+    bool
+    _matches(const StreamingSlotHeader *slot) const;
+
+    bool
+    _try_next(StreamingSubscriberItem *item);
+
+public:
+    static const int TYPE_ID_LOW = TYPE_ID_STREAMING_SUBSCRIBER;
+    static const int TYPE_ID_HIGH = TYPE_ID_STREAMING_SUBSCRIBER;
+    typedef StreamingSubscriber ProxyType;
+
+    explicit StreamingSubscriberImpl(const std::string& name);
+
+    void
+    set_services(const std::set<StreamerServiceType>& services);
+
+    void
+    set_symbols(const std::set<std::string>& symbols);
+
+    bool
+    next(StreamingSubscriberItem *item, std::chrono::milliseconds timeout);
+
+    bool
+    is_valid(const StreamingSubscriberItem *item) const;
+
+    unsigned long long
+    get_ndropped() const
+    { return _ndropped; }
+
+    unsigned long long
+    get_noversize() const
+    { return _header->noversize.load(std::memory_order_relaxed); }
+
+    bool
+    is_publisher_active() const
+    { return _header->active.load(std::memory_order_acquire); }
+};
+
+} /* tdma */
+
+#endif /* STREAMING_SHM_H_ */
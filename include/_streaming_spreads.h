@@ -0,0 +1,115 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef STREAMING_SPREADS_H_
+#define STREAMING_SPREADS_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+
+#include "_tdma_api.h"
+#include "tdma_api_streaming.h"
+
+/*
+ * Streaming Spreads
+ *
+ * Synthetic quotes for spreads (legs w/ signed ratios) kept up to date from
+ * the QUOTE and OPTION 'data' the listener thread receives - before any
+ * filter is applied. Only the legs of spreads that have been added are
+ * tracked (by an interned id, w/ their last bid/ask); with no spreads
+ * defined update() returns right away, w/o taking the lock.
+ *
+ * Each symbol has a list of the spreads it's a leg of; an update only
+ * reprices those, O(legs) each. Spreads touched more than once by the same
+ * message are repriced once and the callback is called (outside the lock)
+ * only if the quote changed.
+ *
+ *   natural bid = sum(long r * bid) - sum(short |r| * ask)
+ *   natural ask = sum(long r * ask) - sum(short |r| * bid)
+ *   mid         = sum(r * leg mid)
+ */
+
+namespace tdma {
+
+class StreamingSpreadEngine{
+    struct Spread;
+
+    struct Leg{
+        int symbol;
+        int ratio;
+    };
+
+    struct LegQuote{
+        double bid;
+        double ask;
+        std::vector<Spread*> spreads;
+        LegQuote();
+    };
+
+    struct Spread{
+        std::vector<Leg> legs;
+        SpreadQuote quote;
+        int id;
+        unsigned long long epoch; // of the last message that marked it
+    };
+
+    std::unordered_map<std::string, int> _symbol_ids;
+    std::vector<LegQuote> _quotes; // by symbol id
+    /* node based, Spread* in LegQuote::spreads stay valid */
+    std::unordered_map<int, Spread> _spreads;
+    std::vector<Spread*> _dirty;
+    int _next_id;
+    unsigned long long _epoch;
+    unsigned long long _last_timestamp;
+    spread_cb_ty _callback;
+    std::atomic<bool> _has_spreads;
+    mutable std::mutex _mtx;
+
+    int
+    _intern(const std::string& symbol);
+
+    void
+    _price(Spread& spread) const;
+
+public:
+    StreamingSpreadEngine();
+
+    /* (symbol, ratio) - ratio > 0 long, < 0 short; reduced by their gcd */
+    int
+    add_spread(const std::vector<std::pair<std::string, int>>& legs);
+
+    void
+    remove_spread(int id);
+
+    SpreadQuote
+    get_quote(int id) const;
+
+    void
+    set_callback(spread_cb_ty callback);
+
+    void
+    update( StreamerServiceType service,
+            unsigned long long timestamp,
+            const json& content );
+};
+
+} /* tdma */
+
+#endif /* STREAMING_SPREADS_H_ */
@@ -24,11 +24,14 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 
 #include <string>
 #include <functional>
+#include <vector>
+#include <algorithm>
 #include <sstream>
 
 #include "util.h"
 #include "tdma_common.h"
 #include "curl_connect.h"
+#include "_flight_recorder.h"
 
 namespace tdma{
 
@@ -76,6 +79,12 @@ to_new_char_buffers( const std::set<std::string>& strs,
                      size_t *n,
                      bool allow_exceptions );
 
+int
+to_new_char_buffers( const std::vector<std::string>& strs,
+                     char*** bufs,
+                     size_t *n,
+                     bool allow_exceptions );
+
 void
 set_error_state( int code,
                  const std::string&  msg,
@@ -171,8 +180,11 @@ CallImplFromABI(bool allow_throw, RetTy(*func)(Args...), Args2... args)
 
 /*
  * TDMA_API_THROW should ONLY be used by code that is run by CallImplFromABI
+ *
+ * (the exception is recorded by the flight recorder first)
  */
-#define TDMA_API_THROW(exc, ...) throw exc(__VA_ARGS__, __LINE__, __FILE__)
+#define TDMA_API_THROW(exc, ...) \
+    throw tdma::flight::recorded( exc(__VA_ARGS__, __LINE__, __FILE__) )
 
 
 template<typename T2>
@@ -190,7 +202,8 @@ kill_proxy( ProxyTy *proxy,
                 IsValidCProxy<ProxyTy, Getter_C>::value ||
                 IsValidCProxy<ProxyTy, StreamingSubscription_C>::value ||
                 IsValidCProxy<ProxyTy, OrderLeg_C>::value ||
-                IsValidCProxy<ProxyTy, OrderTicket_C>::value
+                IsValidCProxy<ProxyTy, OrderTicket_C>::value ||
+                IsValidCProxy<ProxyTy, StreamingSubscriber_C>::value
                 >::type* _ = nullptr )
 {
     proxy->obj = nullptr;
@@ -264,6 +277,24 @@ alloc_to_buffer(T** pbuf, size_t n, bool allow_exceptions)
     return 0;
 }
 
+/* copy of 'v' (null if empty) */
+template<typename T>
+int
+to_new_buffer(const std::vector<T>& v, T** pbuf, size_t *n, bool allow_exceptions)
+{
+    *n = v.size();
+    *pbuf = nullptr;
+    if( v.empty() )
+        return 0;
+
+    int err = alloc_to_buffer(pbuf, *n, allow_exceptions);
+    if( err )
+        return err;
+
+    std::copy(v.begin(), v.end(), *pbuf);
+    return 0;
+}
+
 
 /*
  * CHECK_PTR/KILL check for null pointer and call HANDLE_ERROR/EX
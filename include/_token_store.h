@@ -0,0 +1,72 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef TOKEN_STORE_H_
+#define TOKEN_STORE_H_
+
+#include <string>
+
+#include "tdma_common.h"
+
+/*
+ * Shared Token Store
+ *
+ * connect() caches access tokens by client_id, but only per-process. When
+ * several processes use the same account they each get a 401, each refresh,
+ * and can end up invalidating each other's tokens.
+ *
+ * If a store path is set the latest access token for each client_id is also
+ * kept in that file (one 'client_id epoch_sec access_token' line each, mode
+ * 0600 - an existing file that's group/world accessible is restricted, or
+ * refused if that fails; entries older than an access token's life are
+ * ignored):
+ *
+ *   - peek() returns the stored token so connect() can switch to a token
+ *     another process refreshed BEFORE making a request w/ the old one
+ *   - refresh() holds an exclusive flock while it either adopts a token
+ *     that changed since 'failed_token' or, if it hasn't, refreshes and
+ *     stores the new one; so only one process actually refreshes
+ */
+
+namespace tdma {
+
+class SharedTokenStore{
+public:
+    /* empty path to disable */
+    static void
+    set_path(const std::string& path);
+
+    static std::string
+    get_path();
+
+    /* empty if disabled or nothing stored for 'client_id' */
+    static std::string
+    peek(const std::string& client_id);
+
+    /* updates creds.access_token (via 'refresh_from_server' if necessary) */
+    static void
+    refresh( Credentials& creds,
+             const std::string& failed_token,
+             void(*refresh_from_server)(Credentials*) );
+};
+
+void
+replace_access_token(Credentials& creds, const std::string& token);
+
+} /* tdma */
+
+#endif /* TOKEN_STORE_H_ */
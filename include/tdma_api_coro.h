@@ -0,0 +1,1061 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#ifndef TDMA_API_CORO_H
+#define TDMA_API_CORO_H
+
+/*
+ * OPTIONAL C++20 coroutine layer - header only, so the library itself is
+ * built as before and only client code needs -std=c++20.
+ *
+ *   Task<json> get_quote(QuoteGetter& g)
+ *   { co_return co_await coro::async_get(g); }
+ *
+ *   coro::StreamingChannel channel;
+ *   auto session = StreamingSession::Create(creds, channel.callback());
+ *   ...
+ *   auto items = channel.items();
+ *   while( auto item = co_await items.next() )
+ *       ...
+ *
+ * Coroutines are resumed by a Scheduler (default: one at a time on the
+ * library's thread pool, see set_default_scheduler() and ExecutorPost()).
+ * The throttle wait before a getter's request is a timer, and the blocking
+ * library calls (network I/O) run on the library's I/O pool (see
+ * io_scheduler()) - a thread that resumes coroutines never waits on the
+ * network or the throttle.
+ */
+
+#if !defined(__cplusplus) || __cplusplus < 202002L \
+    || !defined(__has_include) || !__has_include(<coroutine>)
+#error "tdma_api_coro.h requires C++20 coroutines (-std=c++20)"
+#endif
+
+#include <coroutine>
+#include <optional>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <utility>
+
+#include "tdma_api_get.h"
+#include "tdma_api_execute.h"
+#include "tdma_api_streaming.h"
+
+namespace tdma {
+
+namespace coro {
+
+/* where coroutines (and blocking calls) are run */
+class Scheduler {
+public:
+    virtual
+    ~Scheduler() {}
+
+    virtual void
+    post( std::function<void()> func ) = 0;
+
+    virtual void
+    post_after( std::chrono::milliseconds delay,
+                std::function<void()> func ) = 0;
+};
+
+
+/* 'nthreads' share a ready queue and a timer queue */
+class ThreadScheduler
+        : public Scheduler {
+    typedef std::chrono::steady_clock clock_ty;
+    typedef std::pair<clock_ty::time_point, unsigned long long> key_ty;
+
+    std::mutex _mtx;
+    std::condition_variable _cv;
+    std::deque<std::function<void()>> _ready;
+    std::map<key_ty, std::function<void()>> _timed; // by time, then order
+    unsigned long long _ntimed;
+    bool _stopping;
+    std::vector<std::thread> _threads;
+
+    void
+    _run()
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+        for( ;; ){
+            auto now = clock_ty::now();
+            while( !_timed.empty() && _timed.begin()->first.first <= now ){
+                _ready.push_back( std::move(_timed.begin()->second) );
+                _timed.erase( _timed.begin() );
+            }
+
+            if( !_ready.empty() ){
+                auto func = std::move(_ready.front());
+                _ready.pop_front();
+                lock.unlock();
+                func();
+                lock.lock();
+                continue;
+            }
+
+            if( _stopping )
+                return;
+
+            if( _timed.empty() )
+                _cv.wait(lock);
+            else
+                _cv.wait_until(lock, _timed.begin()->first.first);
+        }
+    }
+
+public:
+    explicit ThreadScheduler( unsigned int nthreads = 1 )
+        :
+            _ntimed( 0 ),
+            _stopping( false )
+        {
+            for( unsigned int i = 0; i < std::max(nthreads, 1U); ++i )
+                _threads.emplace_back( [this](){ _run(); } );
+        }
+
+    /* runs what's ready; pending timers are dropped */
+    ~ThreadScheduler()
+    {
+        {
+            std::lock_guard<std::mutex> _(_mtx);
+            _stopping = true;
+            _timed.clear();
+        }
+        _cv.notify_all();
+        for( auto& t : _threads ){
+            if( t.get_id() == std::this_thread::get_id() )
+                t.detach();
+            else
+                t.join();
+        }
+    }
+
+    ThreadScheduler( const ThreadScheduler& ) = delete;
+
+    ThreadScheduler&
+    operator=( const ThreadScheduler& ) = delete;
+
+    void
+    post( std::function<void()> func )
+    {
+        {
+            std::lock_guard<std::mutex> _(_mtx);
+            _ready.push_back( std::move(func) );
+        }
+        _cv.notify_one();
+    }
+
+    void
+    post_after( std::chrono::milliseconds delay, std::function<void()> func )
+    {
+        if( delay.count() <= 0 ){
+            post( std::move(func) );
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> _(_mtx);
+            _timed.emplace( key_ty(clock_ty::now() + delay, _ntimed++),
+                            std::move(func) );
+        }
+        _cv.notify_all();
+    }
+};
+
+
+/* the library's pool (or, if 'io', its I/O pool) - see ExecutorPost() */
+class LibraryScheduler
+        : public Scheduler {
+    bool _io;
+
+public:
+    explicit LibraryScheduler( bool io = false )
+        : _io( io )
+        {}
+
+    void
+    post( std::function<void()> func )
+    { ExecutorPost( std::move(func), _io ); }
+
+    void
+    post_after( std::chrono::milliseconds delay, std::function<void()> func )
+    {
+        if( delay.count() <= 0 )
+            post( std::move(func) );
+        else
+            ExecutorPostAfter( delay, std::move(func), _io );
+    }
+};
+
+
+/* runs one function at a time, in order, on the library's pool */
+class StrandScheduler
+        : public Scheduler {
+    struct State{
+        std::mutex mtx;
+        std::deque<std::function<void()>> ready;
+        bool running = false;
+    };
+
+    /* shared w/ posted drains and timers so they can outlive us */
+    std::shared_ptr<State> _state;
+
+    static void
+    _drain( std::shared_ptr<State> state )
+    {
+        for( ;; ){
+            std::function<void()> func;
+            {
+                std::lock_guard<std::mutex> _(state->mtx);
+                if( state->ready.empty() ){
+                    state->running = false;
+                    return;
+                }
+                func = std::move(state->ready.front());
+                state->ready.pop_front();
+            }
+            func();
+        }
+    }
+
+    static void
+    _post( std::shared_ptr<State> state, std::function<void()> func )
+    {
+        {
+            std::lock_guard<std::mutex> _(state->mtx);
+            state->ready.push_back( std::move(func) );
+            if( state->running )
+                return;
+            state->running = true;
+        }
+        ExecutorPost( [state](){ _drain(state); } );
+    }
+
+public:
+    StrandScheduler()
+        : _state( std::make_shared<State>() )
+        {}
+
+    StrandScheduler( const StrandScheduler& ) = delete;
+
+    StrandScheduler&
+    operator=( const StrandScheduler& ) = delete;
+
+    void
+    post( std::function<void()> func )
+    { _post( _state, std::move(func) ); }
+
+    void
+    post_after( std::chrono::milliseconds delay, std::function<void()> func )
+    {
+        if( delay.count() <= 0 ){
+            post( std::move(func) );
+            return;
+        }
+        std::shared_ptr<State> state = _state;
+        ExecutorPostAfter( delay, [state, func](){ _post(state, func); } );
+    }
+};
+
+
+namespace detail {
+
+inline std::atomic<Scheduler*>&
+default_scheduler_ptr()
+{
+    static std::atomic<Scheduler*> s(nullptr);
+    return s;
+}
+
+} /* detail */
+
+
+/* library I/O pool - blocking library calls only */
+inline Scheduler&
+io_scheduler()
+{
+    static LibraryScheduler s(true);
+    return s;
+}
+
+
+inline Scheduler&
+default_scheduler()
+{
+    Scheduler *s = detail::default_scheduler_ptr().load();
+    if( s )
+        return *s;
+    static StrandScheduler def;
+    return def;
+}
+
+
+/* nullptr to restore the library's own; must outlive its use */
+inline void
+set_default_scheduler( Scheduler *scheduler )
+{ detail::default_scheduler_ptr().store(scheduler); }
+
+
+template<typename T = void>
+class Task;
+
+namespace detail {
+
+struct PromiseBase {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exc;
+
+    struct FinalAwaiter {
+        bool
+        await_ready() const noexcept
+        { return false; }
+
+        template<typename PromiseTy>
+        std::coroutine_handle<>
+        await_suspend( std::coroutine_handle<PromiseTy> h ) noexcept
+        {
+            auto c = h.promise().continuation;
+            return c ? c : std::noop_coroutine();
+        }
+
+        void
+        await_resume() const noexcept
+        {}
+    };
+
+    std::suspend_always
+    initial_suspend() const noexcept
+    { return {}; }
+
+    FinalAwaiter
+    final_suspend() const noexcept
+    { return {}; }
+
+    void
+    unhandled_exception()
+    { exc = std::current_exception(); }
+};
+
+
+template<typename T>
+struct TaskPromise
+        : public PromiseBase {
+    std::optional<T> value;
+
+    Task<T>
+    get_return_object();
+
+    template<typename V>
+    void
+    return_value( V&& v )
+    { value.emplace( std::forward<V>(v) ); }
+
+    T
+    result()
+    {
+        if( exc )
+            std::rethrow_exception(exc);
+        return std::move(*value);
+    }
+};
+
+
+template<>
+struct TaskPromise<void>
+        : public PromiseBase {
+    Task<void>
+    get_return_object();
+
+    void
+    return_void()
+    {}
+
+    void
+    result()
+    {
+        if( exc )
+            std::rethrow_exception(exc);
+    }
+};
+
+
+/* fire-and-forget, for sync_wait */
+struct Detached {
+    struct promise_type {
+        Detached
+        get_return_object() const noexcept
+        { return {}; }
+
+        std::suspend_never
+        initial_suspend() const noexcept
+        { return {}; }
+
+        std::suspend_never
+        final_suspend() const noexcept
+        { return {}; }
+
+        void
+        return_void()
+        {}
+
+        void
+        unhandled_exception()
+        { std::terminate(); }
+    };
+};
+
+} /* detail */
+
+
+/* lazy; starts when awaited, resumes the awaiter when done */
+template<typename T>
+class Task {
+public:
+    typedef detail::TaskPromise<T> promise_type;
+    typedef std::coroutine_handle<promise_type> handle_ty;
+
+private:
+    handle_ty _h;
+
+public:
+    explicit Task( handle_ty h )
+        : _h( h )
+    {}
+
+    Task( Task&& t ) noexcept
+        : _h( std::exchange(t._h, nullptr) )
+    {}
+
+    Task&
+    operator=( Task&& t ) noexcept
+    {
+        if( this != &t ){
+            if( _h )
+                _h.destroy();
+            _h = std::exchange(t._h, nullptr);
+        }
+        return *this;
+    }
+
+    Task( const Task& ) = delete;
+
+    Task&
+    operator=( const Task& ) = delete;
+
+    ~Task()
+    {
+        if( _h )
+            _h.destroy();
+    }
+
+    auto
+    operator co_await() && noexcept
+    {
+        struct Awaiter {
+            handle_ty h;
+
+            bool
+            await_ready() const noexcept
+            { return !h || h.done(); }
+
+            std::coroutine_handle<>
+            await_suspend( std::coroutine_handle<> awaiting ) noexcept
+            {
+                h.promise().continuation = awaiting;
+                return h;
+            }
+
+            T
+            await_resume()
+            { return h.promise().result(); }
+        };
+        return Awaiter{_h};
+    }
+};
+
+
+namespace detail {
+
+template<typename T>
+inline Task<T>
+TaskPromise<T>::get_return_object()
+{ return Task<T>( std::coroutine_handle<TaskPromise<T>>::from_promise(*this) ); }
+
+inline Task<void>
+TaskPromise<void>::get_return_object()
+{
+    return Task<void>(
+        std::coroutine_handle<TaskPromise<void>>::from_promise(*this)
+        );
+}
+
+} /* detail */
+
+
+/* block the calling thread until 'task' is done (e.g from main) */
+template<typename T>
+T
+sync_wait( Task<T> task )
+{
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool done = false;
+    std::exception_ptr exc;
+    std::optional<std::conditional_t<std::is_void_v<T>, bool, T>> result;
+
+    auto run = [&]() -> detail::Detached {
+        try{
+            if constexpr( std::is_void_v<T> ){
+                co_await std::move(task);
+                result.emplace(true);
+            }else{
+                result.emplace( co_await std::move(task) );
+            }
+        }catch(...){
+            exc = std::current_exception();
+        }
+        /* notify under the lock; the waiter may return right after */
+        std::lock_guard<std::mutex> _(mtx);
+        done = true;
+        cv.notify_one();
+    };
+    run();
+
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait( lock, [&](){ return done; } );
+    if( exc )
+        std::rethrow_exception(exc);
+    if constexpr( !std::is_void_v<T> )
+        return std::move(*result);
+}
+
+
+/* co_await resume_on(s) to continue on 's' */
+inline auto
+resume_on( Scheduler& scheduler )
+{
+    struct Awaiter {
+        Scheduler& s;
+
+        bool
+        await_ready() const noexcept
+        { return false; }
+
+        void
+        await_suspend( std::coroutine_handle<> h )
+        { s.post( [h](){ h.resume(); } ); }
+
+        void
+        await_resume() const noexcept
+        {}
+    };
+    return Awaiter{scheduler};
+}
+
+
+inline auto
+sleep_for( std::chrono::milliseconds delay,
+           Scheduler& scheduler = default_scheduler() )
+{
+    struct Awaiter {
+        std::chrono::milliseconds d;
+        Scheduler& s;
+
+        bool
+        await_ready() const noexcept
+        { return false; }
+
+        void
+        await_suspend( std::coroutine_handle<> h )
+        { s.post_after( d, [h](){ h.resume(); } ); }
+
+        void
+        await_resume() const noexcept
+        {}
+    };
+    return Awaiter{delay, scheduler};
+}
+
+
+/*
+ * run blocking 'func' on an io_scheduler() thread after 'delay' (a timer,
+ * not a sleep), then resume on 'scheduler'
+ */
+template<typename F>
+auto
+blocking_call( F func,
+               Scheduler& scheduler = default_scheduler(),
+               std::function<std::chrono::milliseconds()> delay = nullptr )
+{
+    typedef std::invoke_result_t<F> result_ty;
+    typedef std::conditional_t<std::is_void_v<result_ty>, bool, result_ty>
+        stored_ty;
+
+    struct Awaiter {
+        F func;
+        Scheduler& s;
+        std::function<std::chrono::milliseconds()> delay;
+        std::optional<stored_ty> result;
+        std::exception_ptr exc;
+
+        bool
+        await_ready() const noexcept
+        { return false; }
+
+        void
+        await_suspend( std::coroutine_handle<> h )
+        {
+            auto d = delay ? delay() : std::chrono::milliseconds(0);
+            io_scheduler().post_after( d, [this, h](){
+                try{
+                    if constexpr( std::is_void_v<result_ty> ){
+                        func();
+                        result.emplace(true);
+                    }else{
+                        result.emplace( func() );
+                    }
+                }catch(...){
+                    exc = std::current_exception();
+                }
+                s.post( [h](){ h.resume(); } );
+            });
+        }
+
+        result_ty
+        await_resume()
+        {
+            if( exc )
+                std::rethrow_exception(exc);
+            if constexpr( !std::is_void_v<result_ty> )
+                return std::move(*result);
+        }
+    };
+    return Awaiter{std::move(func), scheduler, std::move(delay), {}, {}};
+}
+
+
+/* 'getter' must outlive the co_await */
+inline auto
+async_get( const APIGetter& getter, Scheduler& scheduler = default_scheduler() )
+{
+    /*
+     * reserve a slot in the getter's rate domain (doesn't block) and post
+     * the request for it; concurrent gets go out at their own slots and
+     * get_in_slot() doesn't sleep in the throttle
+     */
+    auto slot = std::make_shared<unsigned long long>(0);
+    return blocking_call( [&getter, slot](){
+                              return getter.get_in_slot(*slot);
+                          },
+                          scheduler,
+                          [&getter, slot](){
+                              auto r = getter.reserve_slot();
+                              *slot = r.first;
+                              return r.second;
+                          } );
+}
+
+
+inline auto
+async_send_order( Credentials& creds,
+                  const std::string& account_id,
+                  const OrderTicket& order,
+                  Scheduler& scheduler = default_scheduler() )
+{
+    return blocking_call(
+        [&creds, account_id, &order](){
+            return Execute_SendOrder(creds, account_id, order);
+        }, scheduler );
+}
+
+
+inline auto
+async_cancel_order( Credentials& creds,
+                    const std::string& account_id,
+                    const std::string& order_id,
+                    Scheduler& scheduler = default_scheduler() )
+{
+    return blocking_call(
+        [&creds, account_id, order_id](){
+            return Execute_CancelOrder(creds, account_id, order_id);
+        }, scheduler );
+}
+
+
+inline auto
+async_replace_order( Credentials& creds,
+                     const std::string& account_id,
+                     const std::string& order_id,
+                     const OrderTicket& order,
+                     Scheduler& scheduler = default_scheduler() )
+{
+    return blocking_call(
+        [&creds, account_id, order_id, &order](){
+            return Execute_ReplaceOrder(creds, account_id, order_id, order);
+        }, scheduler );
+}
+
+
+/*
+ * co_await gen.next() until it returns an empty optional
+ *
+ * next() runs the generator from inside its await_suspend; if the generator
+ * yields before returning there the consumer just continues, otherwise
+ * (it's waiting on something) the yield resumes the consumer. The stack
+ * doesn't grow w/ the number of items, even when symmetric transfer isn't a
+ * tail call (e.g unoptimized builds).
+ */
+template<typename T>
+class AsyncGenerator {
+public:
+    enum class State : int {
+        running,
+        yielded,
+        waiting
+    };
+
+    struct promise_type {
+        std::optional<T> value;
+        std::exception_ptr exc;
+        std::coroutine_handle<> consumer;
+        std::atomic<State> state{State::running};
+
+        struct YieldAwaiter {
+            bool
+            await_ready() const noexcept
+            { return false; }
+
+            std::coroutine_handle<>
+            await_suspend( std::coroutine_handle<promise_type> h ) noexcept
+            {
+                auto& p = h.promise();
+                State s = State::running;
+                if( p.state.compare_exchange_strong(s, State::yielded,
+                                                    std::memory_order_acq_rel) )
+                    return std::noop_coroutine(); // back in next()
+                return p.consumer;
+            }
+
+            void
+            await_resume() const noexcept
+            {}
+        };
+
+        AsyncGenerator
+        get_return_object()
+        {
+            return AsyncGenerator(
+                std::coroutine_handle<promise_type>::from_promise(*this)
+                );
+        }
+
+        std::suspend_always
+        initial_suspend() const noexcept
+        { return {}; }
+
+        YieldAwaiter
+        final_suspend() noexcept
+        {
+            value.reset();
+            return {};
+        }
+
+        template<typename V>
+        YieldAwaiter
+        yield_value( V&& v )
+        {
+            value.emplace( std::forward<V>(v) );
+            return {};
+        }
+
+        void
+        return_void()
+        {}
+
+        void
+        unhandled_exception()
+        { exc = std::current_exception(); }
+    };
+
+    typedef std::coroutine_handle<promise_type> handle_ty;
+
+private:
+    handle_ty _h;
+
+public:
+    explicit AsyncGenerator( handle_ty h )
+        : _h( h )
+    {}
+
+    AsyncGenerator( AsyncGenerator&& g ) noexcept
+        : _h( std::exchange(g._h, nullptr) )
+    {}
+
+    AsyncGenerator( const AsyncGenerator& ) = delete;
+
+    AsyncGenerator&
+    operator=( const AsyncGenerator& ) = delete;
+
+    ~AsyncGenerator()
+    {
+        if( _h )
+            _h.destroy();
+    }
+
+    auto
+    next()
+    {
+        struct Awaiter {
+            handle_ty h;
+
+            bool
+            await_ready() const noexcept
+            { return !h || h.done(); }
+
+            bool
+            await_suspend( std::coroutine_handle<> consumer ) noexcept
+            {
+                auto& p = h.promise();
+                p.consumer = consumer;
+                p.state.store(State::running, std::memory_order_release);
+                h.resume();
+                State s = State::running;
+                return p.state.compare_exchange_strong(
+                    s, State::waiting, std::memory_order_acq_rel );
+            }
+
+            std::optional<T>
+            await_resume()
+            {
+                if( !h )
+                    return std::nullopt;
+                auto& p = h.promise();
+                if( p.exc )
+                    std::rethrow_exception( std::exchange(p.exc, nullptr) );
+                std::optional<T> v = std::move(p.value);
+                p.value.reset();
+                return v;
+            }
+        };
+        return Awaiter{_h};
+    }
+};
+
+
+struct StreamingItem {
+    StreamingCallbackType callback_type;
+    StreamerServiceType service_type;
+    unsigned long long timestamp;
+    std::string data;
+};
+
+
+/*
+ * StreamingChannel - queues what a StreamingSession passes to callback()
+ * for coroutines to co_await
+ *
+ * streaming_cb_ty has no context argument so each channel takes one of
+ * MAX_CHANNELS callback slots (throws if none are left). Items are queued
+ * on the library's streaming thread; waiting coroutines are resumed on
+ * their scheduler, never on that thread.
+ */
+class StreamingChannel {
+public:
+    static const size_t MAX_CHANNELS = 16;
+
+private:
+    struct Registry {
+        std::mutex mtx;
+        std::array<StreamingChannel*, MAX_CHANNELS> channels{};
+    };
+
+    static Registry&
+    _registry()
+    {
+        static Registry r;
+        return r;
+    }
+
+    template<size_t N>
+    static void
+    _callback( int cb, int ss, unsigned long long ts, const char* msg )
+    {
+        Registry& r = _registry();
+        std::lock_guard<std::mutex> _(r.mtx);
+        if( r.channels[N] )
+            r.channels[N]->_push( StreamingItem{
+                static_cast<StreamingCallbackType>(cb),
+                static_cast<StreamerServiceType>(ss), ts, msg ? msg : ""} );
+    }
+
+    template<size_t... I>
+    static std::array<streaming_cb_ty, sizeof...(I)>
+    _callbacks( std::index_sequence<I...> )
+    { return { &_callback<I>... }; }
+
+    size_t _slot;
+    std::mutex _mtx;
+    std::deque<StreamingItem> _items;
+    std::coroutine_handle<> _waiter;
+    Scheduler *_waiter_scheduler;
+    bool _closed;
+
+    void
+    _resume_waiter( std::unique_lock<std::mutex>& lock )
+    {
+        if( !_waiter )
+            return;
+        auto h = std::exchange(_waiter, nullptr);
+        Scheduler *s = _waiter_scheduler;
+        lock.unlock();
+        s->post( [h](){ h.resume(); } );
+    }
+
+    void
+    _push( StreamingItem&& item )
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+        if( _closed )
+            return;
+        _items.push_back( std::move(item) );
+        _resume_waiter(lock);
+    }
+
+public:
+    StreamingChannel()
+        :
+            _slot( MAX_CHANNELS ),
+            _waiter_scheduler( nullptr ),
+            _closed( false )
+        {
+            Registry& r = _registry();
+            std::lock_guard<std::mutex> _(r.mtx);
+            for( size_t i = 0; i < MAX_CHANNELS; ++i ){
+                if( !r.channels[i] ){
+                    r.channels[i] = this;
+                    _slot = i;
+                    break;
+                }
+            }
+            if( _slot == MAX_CHANNELS )
+                throw ValueException("no streaming channels left", __LINE__,
+                                     __FILE__);
+        }
+
+    /* stop the session first; a waiting coroutine must not outlive this */
+    ~StreamingChannel()
+    {
+        close();
+        Registry& r = _registry();
+        std::lock_guard<std::mutex> _(r.mtx);
+        r.channels[_slot] = nullptr;
+    }
+
+    StreamingChannel( const StreamingChannel& ) = delete;
+
+    StreamingChannel&
+    operator=( const StreamingChannel& ) = delete;
+
+    /* pass to StreamingSession::Create */
+    streaming_cb_ty
+    callback() const
+    {
+        static const auto cbs =
+            _callbacks( std::make_index_sequence<MAX_CHANNELS>{} );
+        return cbs[_slot];
+    }
+
+    /* queued items are still returned; then next() returns nullopt */
+    void
+    close()
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+        _closed = true;
+        _resume_waiter(lock);
+    }
+
+    bool
+    is_closed()
+    {
+        std::lock_guard<std::mutex> _(_mtx);
+        return _closed;
+    }
+
+    /* one waiting coroutine at a time */
+    auto
+    next( Scheduler& scheduler = default_scheduler() )
+    {
+        struct Awaiter {
+            StreamingChannel& c;
+            Scheduler& s;
+
+            bool
+            await_ready() const noexcept
+            { return false; }
+
+            bool
+            await_suspend( std::coroutine_handle<> h )
+            {
+                std::lock_guard<std::mutex> _(c._mtx);
+                if( !c._items.empty() || c._closed )
+                    return false;
+                if( c._waiter )
+                    throw ValueException(
+                        "channel already has a waiting coroutine", __LINE__,
+                        __FILE__ );
+                c._waiter = h;
+                c._waiter_scheduler = &s;
+                return true;
+            }
+
+            std::optional<StreamingItem>
+            await_resume()
+            {
+                std::lock_guard<std::mutex> _(c._mtx);
+                if( c._items.empty() )
+                    return std::nullopt;
+                StreamingItem item = std::move(c._items.front());
+                c._items.pop_front();
+                return item;
+            }
+        };
+        return Awaiter{*this, scheduler};
+    }
+
+    AsyncGenerator<StreamingItem>
+    items( Scheduler& scheduler = default_scheduler() )
+    {
+        while( auto item = co_await next(scheduler) )
+            co_yield std::move(*item);
+    }
+};
+
+} /* coro */
+
+} /* tdma */
+
+#endif /* TDMA_API_CORO_H */
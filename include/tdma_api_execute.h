@@ -24,6 +24,7 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 #ifdef __cplusplus
 
 #include <regex>
+#include <chrono>
 
 #endif /* __cplusplus */
 
@@ -114,6 +115,12 @@ DECL_C_CPP_TDMA_ENUM(OrderStrategyType, 0, 2,
     BUILD_C_CPP_TDMA_ENUM_NAME(OrderStrategyType, TRIGGER)
     );
 
+DECL_C_CPP_TDMA_ENUM(PaperFillModel, 0, 2,
+    BUILD_C_CPP_TDMA_ENUM_NAME(PaperFillModel, TOUCH),
+    BUILD_C_CPP_TDMA_ENUM_NAME(PaperFillModel, THROUGH),
+    BUILD_C_CPP_TDMA_ENUM_NAME(PaperFillModel, DISPLAYED_SIZE)
+    );
+
 #define THROW_VALUE_EXCEPTION(m) throw ValueException(m, __LINE__, __FILE__)
 
 EXTERN_C_SPEC_ DLL_SPEC_ int
@@ -4338,6 +4345,198 @@ Execute_CancelOrder_ABI( struct Credentials *creds,
                          int *success,
                          int allow_exceptions );
 
+/* cancels 'order_id' and places 'porder' in one request, returns new id */
+EXTERN_C_SPEC_ DLL_SPEC_ int
+Execute_ReplaceOrder_ABI( struct Credentials *creds,
+                          const char* account_id,
+                          const char* order_id,
+                          OrderTicket_C *porder,
+                          char** buf,
+                          size_t *n,
+                          int allow_exceptions );
+
+/*
+ * Round-trip latency of the order calls: from the request being sent
+ * (ticket already serialized) to the response being received
+ */
+typedef struct{
+    unsigned long long ncalls;      /* calls that got a response */
+    unsigned long long nerrors;     /* calls that failed */
+    unsigned long long last_usec;
+    unsigned long long min_usec;
+    unsigned long long max_usec;
+    unsigned long long total_usec;
+} ExecuteOpLatency;
+
+typedef struct{
+    ExecuteOpLatency send;
+    ExecuteOpLatency cancel;
+    ExecuteOpLatency replace;
+} ExecuteLatencyStats;
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+Execute_GetLatencyStats_ABI( ExecuteLatencyStats *pstats,
+                             int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+Execute_ResetLatencyStats_ABI( int allow_exceptions );
+
+/*
+ * Execution Analytics (off by default)
+ *
+ * Each sent/replacement order is stamped (monotonic clock) before the
+ * request goes out, along w/ the last QUOTE/OPTION bid/ask any streaming
+ * session has received for it. Acks (OrderEntryRequest) and fills
+ * (OrderPartialFill/OrderFill) are matched to it by order id from the
+ * ACCT_ACTIVITY data of any session, and/or fills from OrderGetter or
+ * OrdersGetter results (added by their get(); others, e.g. from another
+ * process, can be passed to Execute_AnalyticsAddOrders).
+ *
+ * Stats are kept per symbol, order type and time of day (of the send) and
+ * merged when queried; use EXECUTE_ANALYTICS_ANY for any symbol (or NULL),
+ * order type or time of day.
+ */
+#define EXECUTE_ANALYTICS_ANY -1
+/* latency bucket 'i' counts [2^i, 2^(i+1)) usec; the last one the rest */
+#define EXECUTE_ANALYTICS_LATENCY_BUCKETS 32
+/* time of day bucket 'i' is the 'i'th half hour after midnight UTC */
+#define EXECUTE_ANALYTICS_TIME_BUCKETS 48
+
+typedef struct{
+    unsigned long long count;
+    unsigned long long min_usec;
+    unsigned long long max_usec;
+    unsigned long long total_usec;
+    unsigned long long buckets[EXECUTE_ANALYTICS_LATENCY_BUCKETS];
+} ExecuteLatencyHistogram;
+
+typedef struct{
+    unsigned long long norders;   /* sent w/ analytics enabled */
+    unsigned long long nacks;
+    unsigned long long nrejects;
+    unsigned long long nfilled;   /* orders w/ at least one fill */
+    ExecuteLatencyHistogram send_to_ack;
+    ExecuteLatencyHistogram ack_to_fill;  /* to the first fill */
+    double filled_quantity;
+    /*
+     * slippage of single leg orders vs the mid at send (> 0 is worse),
+     * per share/contract, averaged over the quantity it could be measured
+     * for (a quote was known at send)
+     */
+    double slippage_quantity;
+    double avg_slippage;
+    double avg_slippage_bps;
+} ExecuteAnalyticsStats;
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+Execute_SetAnalyticsEnabled_ABI( int enabled, int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+Execute_IsAnalyticsEnabled_ABI( int *enabled, int allow_exceptions );
+
+/* the (json) result of an OrderGetter or OrdersGetter */
+EXTERN_C_SPEC_ DLL_SPEC_ int
+Execute_AnalyticsAddOrders_ABI( const char* orders_json,
+                                int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+Execute_GetAnalyticsStats_ABI( const char* symbol,
+                               int order_type,
+                               int time_bucket,
+                               ExecuteAnalyticsStats *pstats,
+                               int allow_exceptions );
+
+/* stats and orders waiting on acks/fills */
+EXTERN_C_SPEC_ DLL_SPEC_ int
+Execute_ResetAnalytics_ABI( int allow_exceptions );
+
+/*
+ * Paper Trading
+ *
+ * Execute_SendOrder/CancelOrder/ReplaceOrder and OrderGetter/OrdersGetter
+ * for a paper account are handled by a local matching simulator instead of
+ * TDMA (credentials aren't used). Orders are matched against the level one
+ * quotes (bid/ask/size) of the QUOTE/OPTION data any streaming session
+ * receives ('live quotes', on by default) and/or quotes replayed/set here;
+ * the simulator's clock is the timestamp of the last quote.
+ *
+ * An order is QUEUED until the first quote at/after the time it was sent
+ * plus the account's latency (msec). MARKET, LIMIT, STOP and STOP_LIMIT
+ * single leg orders, MARKET/LIMIT/NET_DEBIT/NET_CREDIT/NET_ZERO spreads and
+ * TRIGGER/OCO children are supported; other types are REJECTED.
+ *
+ * Fill models (per account) for resting orders:
+ *   TOUCH          - filled at their price when the quote reaches it
+ *   THROUGH        - ... when the quote goes through it
+ *   DISPLAYED_SIZE - TOUCH, but no more than the displayed size per quote
+ *
+ * The activity callback gets the simulator's time (msec) and a json array
+ * of ACCT_ACTIVITY-style items ("1": account, "2": message type, "3": xml
+ * message), from the thread that sent the order or delivered the quote.
+ */
+typedef void(*paper_activity_cb_ty)(unsigned long long, const char*);
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+Execute_PaperAddAccount_ABI( const char* account_id, int allow_exceptions );
+
+/* its orders are discarded */
+EXTERN_C_SPEC_ DLL_SPEC_ int
+Execute_PaperRemoveAccount_ABI( const char* account_id,
+                                int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+Execute_PaperIsAccount_ABI( const char* account_id,
+                            int *is_account,
+                            int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+Execute_PaperSetLatency_ABI( const char* account_id,
+                             unsigned long msec,
+                             int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+Execute_PaperGetLatency_ABI( const char* account_id,
+                             unsigned long *msec,
+                             int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+Execute_PaperSetFillModel_ABI( const char* account_id,
+                               int fill_model,
+                               int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+Execute_PaperGetFillModel_ABI( const char* account_id,
+                               int *fill_model,
+                               int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+Execute_PaperSetLiveQuotes_ABI( int live, int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+Execute_PaperGetLiveQuotes_ABI( int *live, int allow_exceptions );
+
+/* sizes as reported by the stream (NaN for unknown) */
+EXTERN_C_SPEC_ DLL_SPEC_ int
+Execute_PaperSetQuote_ABI( const char* symbol,
+                           double bid,
+                           double ask,
+                           double bid_size,
+                           double ask_size,
+                           unsigned long long timestamp,
+                           int allow_exceptions );
+
+/* the (json array) 'content' of recorded QUOTE/OPTION data */
+EXTERN_C_SPEC_ DLL_SPEC_ int
+Execute_PaperReplay_ABI( int service,
+                         unsigned long long timestamp,
+                         const char* content_json,
+                         int allow_exceptions );
+
+/* NULL to remove */
+EXTERN_C_SPEC_ DLL_SPEC_ int
+Execute_PaperSetActivityCallback_ABI( paper_activity_cb_ty callback,
+                                      int allow_exceptions );
+
 #ifndef __cplusplus
 
 static inline int
@@ -4357,6 +4556,130 @@ Execute_CancelOrder( struct Credentials *creds,
 { return Execute_CancelOrder_ABI(creds, account_id, order_id, success, 0); }
 
 
+static inline int
+Execute_ReplaceOrder( struct Credentials *creds,
+                      const char* account_id,
+                      const char* order_id,
+                      OrderTicket_C *porder,
+                      char** buf,
+                      size_t *n )
+{
+    return Execute_ReplaceOrder_ABI(creds, account_id, order_id, porder,
+                                    buf, n, 0);
+}
+
+
+static inline int
+Execute_GetLatencyStats( ExecuteLatencyStats *pstats )
+{ return Execute_GetLatencyStats_ABI(pstats, 0); }
+
+
+static inline int
+Execute_ResetLatencyStats(void)
+{ return Execute_ResetLatencyStats_ABI(0); }
+
+
+static inline int
+Execute_SetAnalyticsEnabled( int enabled )
+{ return Execute_SetAnalyticsEnabled_ABI(enabled, 0); }
+
+
+static inline int
+Execute_IsAnalyticsEnabled( int *enabled )
+{ return Execute_IsAnalyticsEnabled_ABI(enabled, 0); }
+
+
+static inline int
+Execute_AnalyticsAddOrders( const char* orders_json )
+{ return Execute_AnalyticsAddOrders_ABI(orders_json, 0); }
+
+
+static inline int
+Execute_GetAnalyticsStats( const char* symbol,
+                           int order_type,
+                           int time_bucket,
+                           ExecuteAnalyticsStats *pstats )
+{
+    return Execute_GetAnalyticsStats_ABI(symbol, order_type, time_bucket,
+                                         pstats, 0);
+}
+
+
+static inline int
+Execute_ResetAnalytics(void)
+{ return Execute_ResetAnalytics_ABI(0); }
+
+
+static inline int
+Execute_PaperAddAccount( const char* account_id )
+{ return Execute_PaperAddAccount_ABI(account_id, 0); }
+
+
+static inline int
+Execute_PaperRemoveAccount( const char* account_id )
+{ return Execute_PaperRemoveAccount_ABI(account_id, 0); }
+
+
+static inline int
+Execute_PaperIsAccount( const char* account_id, int *is_account )
+{ return Execute_PaperIsAccount_ABI(account_id, is_account, 0); }
+
+
+static inline int
+Execute_PaperSetLatency( const char* account_id, unsigned long msec )
+{ return Execute_PaperSetLatency_ABI(account_id, msec, 0); }
+
+
+static inline int
+Execute_PaperGetLatency( const char* account_id, unsigned long *msec )
+{ return Execute_PaperGetLatency_ABI(account_id, msec, 0); }
+
+
+static inline int
+Execute_PaperSetFillModel( const char* account_id, PaperFillModel fill_model )
+{ return Execute_PaperSetFillModel_ABI(account_id, (int)fill_model, 0); }
+
+
+static inline int
+Execute_PaperGetFillModel( const char* account_id, PaperFillModel *fill_model )
+{ return Execute_PaperGetFillModel_ABI(account_id, (int*)fill_model, 0); }
+
+
+static inline int
+Execute_PaperSetLiveQuotes( int live )
+{ return Execute_PaperSetLiveQuotes_ABI(live, 0); }
+
+
+static inline int
+Execute_PaperGetLiveQuotes( int *live )
+{ return Execute_PaperGetLiveQuotes_ABI(live, 0); }
+
+
+static inline int
+Execute_PaperSetQuote( const char* symbol,
+                       double bid,
+                       double ask,
+                       double bid_size,
+                       double ask_size,
+                       unsigned long long timestamp )
+{
+    return Execute_PaperSetQuote_ABI(symbol, bid, ask, bid_size, ask_size,
+                                     timestamp, 0);
+}
+
+
+static inline int
+Execute_PaperReplay( int service,
+                     unsigned long long timestamp,
+                     const char* content_json )
+{ return Execute_PaperReplay_ABI(service, timestamp, content_json, 0); }
+
+
+static inline int
+Execute_PaperSetActivityCallback( paper_activity_cb_ty callback )
+{ return Execute_PaperSetActivityCallback_ABI(callback, 0); }
+
+
 #else
 
 namespace tdma {
@@ -4379,6 +4702,158 @@ Execute_CancelOrder( Credentials& creds,
     return static_cast<bool>(success);
 }
 
+inline std::string
+Execute_ReplaceOrder( Credentials& creds,
+                      const std::string& account_id,
+                      const std::string& order_id,
+                      const OrderTicket& order )
+{
+    return str_from_abi_vargs( Execute_ReplaceOrder_ABI, ALLOW_EXCEPTIONS,
+                               &creds, account_id.c_str(), order_id.c_str(),
+                               order.get_cproxy() );
+}
+
+inline ExecuteLatencyStats
+Execute_GetLatencyStats()
+{
+    ExecuteLatencyStats stats;
+    call_abi( Execute_GetLatencyStats_ABI, &stats );
+    return stats;
+}
+
+inline void
+Execute_ResetLatencyStats()
+{ call_abi( Execute_ResetLatencyStats_ABI ); }
+
+inline void
+Execute_SetAnalyticsEnabled( bool enabled )
+{ call_abi( Execute_SetAnalyticsEnabled_ABI, static_cast<int>(enabled) ); }
+
+inline bool
+Execute_IsAnalyticsEnabled()
+{
+    int enabled;
+    call_abi( Execute_IsAnalyticsEnabled_ABI, &enabled );
+    return static_cast<bool>(enabled);
+}
+
+inline void
+Execute_AnalyticsAddOrders( const json& orders )
+{ call_abi( Execute_AnalyticsAddOrders_ABI, orders.dump().c_str() ); }
+
+/* all order types */
+inline ExecuteAnalyticsStats
+Execute_GetAnalyticsStats( const std::string& symbol = "",
+                           int time_bucket = EXECUTE_ANALYTICS_ANY )
+{
+    ExecuteAnalyticsStats stats;
+    call_abi( Execute_GetAnalyticsStats_ABI, symbol.c_str(),
+              EXECUTE_ANALYTICS_ANY, time_bucket, &stats );
+    return stats;
+}
+
+inline ExecuteAnalyticsStats
+Execute_GetAnalyticsStats( const std::string& symbol,
+                           OrderType order_type,
+                           int time_bucket = EXECUTE_ANALYTICS_ANY )
+{
+    ExecuteAnalyticsStats stats;
+    call_abi( Execute_GetAnalyticsStats_ABI, symbol.c_str(),
+              static_cast<int>(order_type), time_bucket, &stats );
+    return stats;
+}
+
+inline void
+Execute_ResetAnalytics()
+{ call_abi( Execute_ResetAnalytics_ABI ); }
+
+inline void
+Execute_PaperAddAccount( const std::string& account_id )
+{ call_abi( Execute_PaperAddAccount_ABI, account_id.c_str() ); }
+
+inline void
+Execute_PaperRemoveAccount( const std::string& account_id )
+{ call_abi( Execute_PaperRemoveAccount_ABI, account_id.c_str() ); }
+
+inline bool
+Execute_PaperIsAccount( const std::string& account_id )
+{
+    int is_account;
+    call_abi( Execute_PaperIsAccount_ABI, account_id.c_str(), &is_account );
+    return static_cast<bool>(is_account);
+}
+
+inline void
+Execute_PaperSetLatency( const std::string& account_id,
+                         std::chrono::milliseconds latency )
+{
+    call_abi( Execute_PaperSetLatency_ABI, account_id.c_str(),
+              static_cast<unsigned long>(latency.count()) );
+}
+
+inline std::chrono::milliseconds
+Execute_PaperGetLatency( const std::string& account_id )
+{
+    unsigned long msec;
+    call_abi( Execute_PaperGetLatency_ABI, account_id.c_str(), &msec );
+    return std::chrono::milliseconds(msec);
+}
+
+inline void
+Execute_PaperSetFillModel( const std::string& account_id,
+                           PaperFillModel fill_model )
+{
+    call_abi( Execute_PaperSetFillModel_ABI, account_id.c_str(),
+              static_cast<int>(fill_model) );
+}
+
+inline PaperFillModel
+Execute_PaperGetFillModel( const std::string& account_id )
+{
+    int fill_model;
+    call_abi( Execute_PaperGetFillModel_ABI, account_id.c_str(), &fill_model );
+    return static_cast<PaperFillModel>(fill_model);
+}
+
+inline void
+Execute_PaperSetLiveQuotes( bool live )
+{ call_abi( Execute_PaperSetLiveQuotes_ABI, static_cast<int>(live) ); }
+
+inline bool
+Execute_PaperGetLiveQuotes()
+{
+    int live;
+    call_abi( Execute_PaperGetLiveQuotes_ABI, &live );
+    return static_cast<bool>(live);
+}
+
+inline void
+Execute_PaperSetQuote( const std::string& symbol,
+                       double bid,
+                       double ask,
+                       double bid_size,
+                       double ask_size,
+                       unsigned long long timestamp )
+{
+    call_abi( Execute_PaperSetQuote_ABI, symbol.c_str(), bid, ask, bid_size,
+              ask_size, timestamp );
+}
+
+/* 'service' is a StreamerServiceType (QUOTE or OPTION) */
+template<typename ServiceTy>
+inline void
+Execute_PaperReplay( ServiceTy service,
+                     unsigned long long timestamp,
+                     const json& content )
+{
+    call_abi( Execute_PaperReplay_ABI, static_cast<int>(service), timestamp,
+              content.dump().c_str() );
+}
+
+inline void
+Execute_PaperSetActivityCallback( paper_activity_cb_ty callback )
+{ call_abi( Execute_PaperSetActivityCallback_ABI, callback ); }
+
 } /* tdma */
 
 #endif /* __cplusplus */
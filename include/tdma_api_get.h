@@ -323,6 +323,26 @@ APIGetter_SetTimeout_ABI(Getter_C *pgetter, unsigned long long msec, int allow_e
 EXTERN_C_SPEC_ DLL_SPEC_ int
 APIGetter_GetTimeout_ABI(Getter_C *pgetter, unsigned long long *msec, int allow_exceptions);
 
+/*
+ * reserve the next request slot of the getter's rate domain w/o blocking;
+ * call APIGetter_GetInSlot w/ 'slot' after 'delay_msec' (it then doesn't
+ * wait behind other requests). A slot is only accepted once, by a getter of
+ * the same domain (client_id), within a minute of its time; anything else
+ * is TDMA_API_VALUE_ERROR.
+ */
+EXTERN_C_SPEC_ DLL_SPEC_ int
+APIGetter_ReserveSlot_ABI( Getter_C *pgetter,
+                           unsigned long long *slot,
+                           unsigned long long *delay_msec,
+                           int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+APIGetter_GetInSlot_ABI( Getter_C *pgetter,
+                         unsigned long long slot,
+                         char **buf,
+                         size_t *n,
+                         int allow_exceptions );
+
 EXTERN_C_SPEC_ DLL_SPEC_ int
 APIGetter_SetWaitMSec_ABI(unsigned long long msec, int allow_exceptions);
 
@@ -335,12 +355,62 @@ APIGetter_GetDefWaitMSec_ABI(unsigned long long *msec, int allow_exceptions);
 EXTERN_C_SPEC_ DLL_SPEC_ int
 APIGetter_WaitRemaining_ABI(unsigned long long *msec, int allow_exceptions);
 
+/* remaining in the rate domain of 'client_id' */
+EXTERN_C_SPEC_ DLL_SPEC_ int
+APIGetter_WaitRemainingForClient_ABI( const char* client_id,
+                                      unsigned long long *msec,
+                                      int allow_exceptions );
+
 EXTERN_C_SPEC_ DLL_SPEC_ int
 APIGetter_ShareConnections_ABI(int b, int allow_exceptions);
 
 EXTERN_C_SPEC_ DLL_SPEC_ int
 APIGetter_IsSharingConnections_ABI(int *b, int allow_exceptions);
 
+/*
+ * Getters are throttled per client_id ('rate domain') so credentials w/
+ * different client ids (and quotas) don't wait on each other
+ */
+typedef struct{
+    unsigned long long ngets;       /* requests made */
+    unsigned long long nthrottled;  /* requests that had to wait */
+    unsigned long long nerrors;     /* requests that failed */
+    unsigned long long wait_msec;   /* total msec spent waiting */
+    unsigned long long wait_remaining_msec;
+} GetterRateDomainStats;
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+APIGetter_GetRateDomains_ABI( char ***client_ids,
+                              size_t *n,
+                              int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+APIGetter_GetRateDomainStats_ABI( const char* client_id,
+                                  GetterRateDomainStats *pstats,
+                                  int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+APIGetter_StartBroker_ABI( struct Credentials *pcreds,
+                           const char* path,
+                           unsigned long long cache_msec,
+                           int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+APIGetter_StopBroker_ABI(int allow_exceptions);
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+APIGetter_IsBrokerRunning_ABI(int *b, int allow_exceptions);
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+APIGetter_GetDefBrokerCacheMSec_ABI( unsigned long long *msec,
+                                     int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+APIGetter_UseBroker_ABI(const char* path, int allow_exceptions);
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+APIGetter_GetBroker_ABI(char** buf, size_t *n, int allow_exceptions);
+
 /* QuoteGetter */
 EXTERN_C_SPEC_ DLL_SPEC_ int
 QuoteGetter_Create_ABI( struct Credentials *pcreds,
@@ -521,6 +591,28 @@ HistoricalGetterBase_SetFrequency_ABI( Getter_C *pgetter,
                                        unsigned int frequency,
                                        int allow_exceptions );
 
+/*
+ * GetCandles makes the request and decodes the response in the library,
+ * returning one flat array instead of json; free w/ FreeCandlesBuffer
+ */
+typedef struct{
+    long long datetime; /* msec since epoch */
+    double open;
+    double high;
+    double low;
+    double close;
+    long long volume;
+} TDMA_Candle;
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+HistoricalGetterBase_GetCandles_ABI( Getter_C *pgetter,
+                                     TDMA_Candle **candles,
+                                     size_t *n,
+                                     int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+FreeCandlesBuffer_ABI( TDMA_Candle *candles, int allow_exceptions );
+
 /* HistoricalPeriodGetter */
 EXTERN_C_SPEC_ DLL_SPEC_ int
 HistoricalPeriodGetter_Create_ABI(
@@ -712,6 +804,52 @@ OptionChainGetter_SetOptionType_ABI( OptionChainGetter_C *pgetter,
                                      int option_type,
                                      int allow_exceptions );
 
+/*
+ * GetQuotes makes the request and decodes every contract in the chain
+ * (calls then puts, by expiration then strike) in the library; free w/
+ * FreeOptionQuotesBuffer. Not supported by OptionChainStrategyGetter.
+ *
+ * Missing/'NaN' values are NaN (doubles) or 0 (integers).
+ */
+typedef struct{
+    char symbol[32];
+    long long expiration; /* msec since epoch */
+    double strike;
+    int is_put;
+    int days_to_expiration;
+    double bid;
+    double ask;
+    double last;
+    double mark;
+    long long bid_size;
+    long long ask_size;
+    long long last_size;
+    long long total_volume;
+    long long open_interest;
+    long long quote_time; /* msec since epoch */
+    long long trade_time; /* msec since epoch */
+    double volatility;
+    double delta;
+    double gamma;
+    double theta;
+    double vega;
+    double rho;
+    double time_value;
+    double theoretical_value;
+    double multiplier;
+    int in_the_money;
+    int non_standard;
+} TDMA_OptionQuote;
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+OptionChainGetter_GetQuotes_ABI( OptionChainGetter_C *pgetter,
+                                 TDMA_OptionQuote **quotes,
+                                 size_t *n,
+                                 int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+FreeOptionQuotesBuffer_ABI( TDMA_OptionQuote *quotes, int allow_exceptions );
+
 /* OptionChainStrategyGetter */
 EXTERN_C_SPEC_ DLL_SPEC_ int
 OptionChainStrategyGetter_Create_ABI( struct Credentials *pcreds,
@@ -1218,6 +1356,19 @@ static inline int
 APIGetter_GetTimeout(Getter_C *pgetter, unsigned long long *msec)
 { return APIGetter_GetTimeout_ABI(pgetter, msec, 0): }
 
+static inline int
+APIGetter_ReserveSlot( Getter_C *pgetter,
+                       unsigned long long *slot,
+                       unsigned long long *delay_msec )
+{ return APIGetter_ReserveSlot_ABI(pgetter, slot, delay_msec, 0); }
+
+static inline int
+APIGetter_GetInSlot( Getter_C *pgetter,
+                     unsigned long long slot,
+                     char **buf,
+                     size_t *n )
+{ return APIGetter_GetInSlot_ABI(pgetter, slot, buf, n, 0); }
+
 static inline int
 APIGetter_SetWaitMSec(unsigned long long msec)
 { return APIGetter_SetWaitMSec_ABI(msec, 0); }
@@ -1234,6 +1385,11 @@ static inline int
 APIGetter_WaitRemaining(unsigned long long *msec)
 { return APIGetter_WaitRemaining_ABI(msec, 0); }
 
+static inline int
+APIGetter_WaitRemainingForClient( const char* client_id,
+                                  unsigned long long *msec )
+{ return APIGetter_WaitRemainingForClient_ABI(client_id, msec, 0); }
+
 static inline int
 APIGetter_ShareConnections(int share)
 { return APIGetter_ShareConnections_ABI(share, 0); }
@@ -1242,6 +1398,42 @@ static inline int
 APIGetter_IsSharingConnections(int *share)
 { return APIGetter_IsSharingConnections(share, 0); }
 
+static inline int
+APIGetter_GetRateDomains(char ***client_ids, size_t *n)
+{ return APIGetter_GetRateDomains_ABI(client_ids, n, 0); }
+
+static inline int
+APIGetter_GetRateDomainStats( const char* client_id,
+                              GetterRateDomainStats *pstats )
+{ return APIGetter_GetRateDomainStats_ABI(client_id, pstats, 0); }
+
+static inline int
+APIGetter_StartBroker( struct Credentials *pcreds,
+                       const char* path,
+                       unsigned long long cache_msec )
+{ return APIGetter_StartBroker_ABI(pcreds, path, cache_msec, 0); }
+
+static inline int
+APIGetter_StopBroker(void)
+{ return APIGetter_StopBroker_ABI(0); }
+
+static inline int
+APIGetter_IsBrokerRunning(int *b)
+{ return APIGetter_IsBrokerRunning_ABI(b, 0); }
+
+static inline int
+APIGetter_GetDefBrokerCacheMSec(unsigned long long *msec)
+{ return APIGetter_GetDefBrokerCacheMSec_ABI(msec, 0); }
+
+/* NULL or "" to stop using the broker */
+static inline int
+APIGetter_UseBroker(const char* path)
+{ return APIGetter_UseBroker_ABI(path, 0); }
+
+static inline int
+APIGetter_GetBroker(char** buf, size_t *n)
+{ return APIGetter_GetBroker_ABI(buf, n, 0); }
+
 /* declare derived versions of Get, Close, IsClosed for each getter*/
 #define DECL_WRAPPED_API_GETTER_BASE_FUNCS(name) \
 static inline int \
@@ -1538,6 +1730,13 @@ HistoricalPeriodGetter_GetMSecSinceEpoch( HistoricalPeriodGetter_C *pgetter,
 { return HistoricalPeriodGetter_GetMSecSinceEpoch_ABI( pgetter,
                                                        msec_since_epoch, 0 ); }
 
+static inline int
+HistoricalPeriodGetter_GetCandles( HistoricalPeriodGetter_C *pgetter,
+                                   TDMA_Candle **candles,
+                                   size_t *n )
+{ return HistoricalGetterBase_GetCandles_ABI( (Getter_C*)pgetter, candles,
+                                              n, 0); }
+
 static inline int
 GetHistoricalPeriod( struct Credentials *pcreds,
                      const char* symbol,
@@ -1644,6 +1843,17 @@ HistoricalRangeGetter_SetFrequency( HistoricalRangeGetter_C *pgetter,
                                                 (int)frequency_type,
                                                 frequency, 0); }
 
+static inline int
+HistoricalRangeGetter_GetCandles( HistoricalRangeGetter_C *pgetter,
+                                  TDMA_Candle **candles,
+                                  size_t *n )
+{ return HistoricalGetterBase_GetCandles_ABI( (Getter_C*)pgetter, candles,
+                                              n, 0); }
+
+static inline int
+FreeCandlesBuffer( TDMA_Candle *candles )
+{ return FreeCandlesBuffer_ABI(candles, 0); }
+
 static inline int
 GetHistoricalRange( struct Credentials *pcreds,
                     const char* symbol,
@@ -1775,6 +1985,16 @@ name##_SetOptionType(name##_C *pgetter, OptionType option_type) \
 DECL_WRAPPED_API_GETTER_BASE_FUNCS(OptionChainGetter)
 DECL_WRAPPED_OPTION_GETTER_BASE_FUNCS(OptionChainGetter)
 
+static inline int
+OptionChainGetter_GetQuotes( OptionChainGetter_C *pgetter,
+                             TDMA_OptionQuote **quotes,
+                             size_t *n )
+{ return OptionChainGetter_GetQuotes_ABI(pgetter, quotes, n, 0); }
+
+static inline int
+FreeOptionQuotesBuffer( TDMA_OptionQuote *quotes )
+{ return FreeOptionQuotesBuffer_ABI(quotes, 0); }
+
 static inline int
 GetOptionChain( struct Credentials *pcreds,
                 const char* symbol,
@@ -1969,6 +2189,13 @@ OptionChainAnalyticalGetter_SetDaysToExp(
     )
 { return OptionChainAnalyticalGetter_SetDaysToExp_ABI(pgetter, days_to_exp, 0); }
 
+static inline int
+OptionChainAnalyticalGetter_GetQuotes( OptionChainAnalyticalGetter_C *pgetter,
+                                       TDMA_OptionQuote **quotes,
+                                       size_t *n )
+{ return OptionChainGetter_GetQuotes_ABI( (OptionChainGetter_C*)pgetter,
+                                          quotes, n, 0); }
+
 static inline int
 GetOptionChainAnalytical( struct Credentials *pcreds,
                           const char* symbol,
@@ -2502,6 +2729,26 @@ GetOrders( struct Credentials *pcreds,
 
 namespace tdma{
 
+/* direct (C++ linkage) access to the getter for TDMA_API_DIRECT_LINKAGE */
+DLL_SPEC_ std::string
+APIGetter_Get_Direct(Getter_C *pgetter);
+
+/* parsed w/ the library's (private) parser */
+DLL_SPEC_ json
+APIGetter_GetJson_Direct(Getter_C *pgetter);
+
+DLL_SPEC_ void
+APIGetter_Close_Direct(Getter_C *pgetter);
+
+DLL_SPEC_ bool
+APIGetter_IsClosed_Direct(Getter_C *pgetter);
+
+DLL_SPEC_ void
+APIGetter_SetTimeout_Direct(Getter_C *pgetter, std::chrono::milliseconds msec);
+
+DLL_SPEC_ std::chrono::milliseconds
+APIGetter_GetTimeout_Direct(Getter_C *pgetter);
+
 class APIGetter{
 public:
     typedef Getter_C CType;
@@ -2587,6 +2834,15 @@ public:
         return std::chrono::milliseconds(w);
     }
 
+    static std::chrono::milliseconds
+    wait_remaining(const std::string& client_id)
+    {
+        unsigned long long w;
+        call_abi( APIGetter_WaitRemainingForClient_ABI, client_id.c_str(),
+                  &w );
+        return std::chrono::milliseconds(w);
+    }
+
     static void
     share_connections(bool share)
     {
@@ -2601,6 +2857,114 @@ public:
         return static_cast<bool>(b);
     }
 
+    static std::set<std::string>
+    get_rate_domains()
+    {
+        char **buf;
+        size_t n;
+        std::set<std::string> strs;
+        call_abi( APIGetter_GetRateDomains_ABI, &buf, &n );
+        if( buf ){
+            while(n--){
+                strs.insert(buf[n]);
+                free(buf[n]);
+            }
+            free(buf);
+        }
+        return strs;
+    }
+
+    static GetterRateDomainStats
+    get_rate_domain_stats(const std::string& client_id)
+    {
+        GetterRateDomainStats stats;
+        call_abi( APIGetter_GetRateDomainStats_ABI, client_id.c_str(), &stats );
+        return stats;
+    }
+
+    static std::chrono::milliseconds
+    get_def_broker_cache_msec()
+    {
+        unsigned long long w;
+        call_abi( APIGetter_GetDefBrokerCacheMSec_ABI, &w );
+        return std::chrono::milliseconds(w);
+    }
+
+    static void
+    start_broker( Credentials& creds,
+                  const std::string& path,
+                  std::chrono::milliseconds cache_msec
+                      = get_def_broker_cache_msec() )
+    {
+        call_abi( APIGetter_StartBroker_ABI, &creds, path.c_str(),
+                  static_cast<unsigned long long>(cache_msec.count()) );
+    }
+
+    static void
+    stop_broker()
+    { call_abi( APIGetter_StopBroker_ABI ); }
+
+    static bool
+    is_broker_running()
+    {
+        int b;
+        call_abi( APIGetter_IsBrokerRunning_ABI, &b );
+        return static_cast<bool>(b);
+    }
+
+    static void
+    use_broker(const std::string& path)
+    { call_abi( APIGetter_UseBroker_ABI, path.c_str() ); }
+
+    static std::string
+    get_broker()
+    { return str_from_abi_vargs( APIGetter_GetBroker_ABI, ALLOW_EXCEPTIONS ); }
+
+    /*
+     * reserve the next request slot of the getter's rate domain w/o
+     * blocking: (slot, time until it) - then get_in_slot(slot) doesn't wait
+     */
+    std::pair<unsigned long long, std::chrono::milliseconds>
+    reserve_slot() const
+    {
+        unsigned long long slot, d;
+        call_abi( APIGetter_ReserveSlot_ABI, _cgetter.get(), &slot, &d );
+        return {slot, std::chrono::milliseconds(d)};
+    }
+
+    json
+    get_in_slot(unsigned long long slot) const
+    {
+        char *buf;
+        size_t n;
+        call_abi( APIGetter_GetInSlot_ABI, _cgetter.get(), slot, &buf, &n );
+        json j = (n > 1) ? json::parse(std::string(buf)) : json();
+        if(buf)
+            free(buf);
+        return j;
+    }
+
+#ifdef TDMA_API_DIRECT_LINKAGE
+    json
+    get() const
+    { return APIGetter_GetJson_Direct(_cgetter.get()); }
+
+    void
+    close()
+    { APIGetter_Close_Direct(_cgetter.get()); }
+
+    bool
+    is_closed() const
+    { return APIGetter_IsClosed_Direct(_cgetter.get()); }
+
+    void
+    set_timeout(std::chrono::milliseconds timeout)
+    { APIGetter_SetTimeout_Direct(_cgetter.get(), timeout); }
+
+    std::chrono::milliseconds
+    get_timeout() const
+    { return APIGetter_GetTimeout_Direct(_cgetter.get()); }
+#else
     json
     get() const
     {
@@ -2639,6 +3003,7 @@ public:
         call_abi( APIGetter_GetTimeout_ABI, _cgetter.get(), &t);
         return std::chrono::milliseconds(t);
     }
+#endif /* TDMA_API_DIRECT_LINKAGE */
 };
 
 
@@ -2922,6 +3287,17 @@ public:
                   static_cast<int>(extended_hours) );
     }
 
+    /* like get() but decoded in the library, skipping the json */
+    std::vector<TDMA_Candle>
+    get_candles() const
+    {
+        TDMA_Candle *buf;
+        size_t n;
+        call_abi( HistoricalGetterBase_GetCandles_ABI, cgetter<>(), &buf, &n );
+        std::vector<TDMA_Candle> candles(buf, buf + n);
+        call_abi( FreeCandlesBuffer_ABI, buf );
+        return candles;
+    }
 
 };
 
@@ -3416,6 +3792,18 @@ public:
         call_abi( OptionChainGetter_SetOptionType_ABI, cgetter<CType>(),
                   static_cast<int>(option_type) );
     }
+
+    /* like get() but decoded in the library, skipping the json */
+    std::vector<TDMA_OptionQuote>
+    get_quotes() const
+    {
+        TDMA_OptionQuote *buf;
+        size_t n;
+        call_abi( OptionChainGetter_GetQuotes_ABI, cgetter<CType>(), &buf, &n );
+        std::vector<TDMA_OptionQuote> quotes(buf, buf + n);
+        call_abi( FreeOptionQuotesBuffer_ABI, buf );
+        return quotes;
+    }
 };
 
 
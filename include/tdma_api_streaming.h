@@ -28,6 +28,8 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 #include <thread>
 #include <string>
 #include <deque>
+#include <vector>
+#include <functional>
 
 //#include "websocket_connect.h"
 //#include "threadsafe_hashmap.h"
@@ -411,6 +413,17 @@ DECL_C_CPP_TDMA_ENUM(StreamingCallbackType, 0, 6,
     BUILD_C_CPP_TDMA_ENUM_NAME(StreamingCallbackType, error)
     );
 
+DECL_C_CPP_TDMA_ENUM(StreamingFilterRuleType, 0, 2,
+    BUILD_C_CPP_TDMA_ENUM_NAME(StreamingFilterRuleType, changed), /* field in update */
+    BUILD_C_CPP_TDMA_ENUM_NAME(StreamingFilterRuleType, delta),   /* moved >= value */
+    BUILD_C_CPP_TDMA_ENUM_NAME(StreamingFilterRuleType, cross)    /* crossed value */
+    );
+
+DECL_C_CPP_TDMA_ENUM(SocketBackendType, 0, 1,
+    BUILD_C_CPP_TDMA_ENUM_NAME(SocketBackendType, epoll),
+    BUILD_C_CPP_TDMA_ENUM_NAME(SocketBackendType, io_uring)
+    );
+
 
 
 static const int SUBSCRIPTION_MAX_FIELDS = 100;
@@ -540,6 +553,12 @@ StreamingSubscription_IsSame_ABI( StreamingSubscription_C *l,
                                   int *is_same,
                                   int allow_exceptions );
 
+/* SUBSCRIPTION HASH METHOD (equal subscriptions hash the same) */
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSubscription_Hash_ABI( StreamingSubscription_C *psub,
+                                size_t *hash,
+                                int allow_exceptions );
+
 /* SUBSCRIPTION DESTROY METHODS */
 
 #define DECL_CSUB_DESTROY_FUNC(name) \
@@ -840,6 +859,11 @@ StreamingSubscription_IsSame( StreamingSubscription_C *l,
 
 { return StreamingSubscription_IsSame_ABI(l, r, is_same, 0); }
 
+/* SUBSCRIPTION HASH METHOD */
+static inline int
+StreamingSubscription_Hash( StreamingSubscription_C *psub, size_t *hash )
+{ return StreamingSubscription_Hash_ABI(psub, hash, 0); }
+
 /* SUBSCRIPTION DESTROY METHODS */
 
 #define DECL_CSUB_DESTROY_FUNC(name) \
@@ -1139,6 +1163,20 @@ RawSubscription_SetParameters( RawSubscription_C *psub,
 
 namespace tdma{
 
+/* direct (C++ linkage) access to subscriptions for TDMA_API_DIRECT_LINKAGE */
+DLL_SPEC_ StreamerServiceType
+StreamingSubscription_GetService_Direct(StreamingSubscription_C *psub);
+
+DLL_SPEC_ CommandType
+StreamingSubscription_GetCommand_Direct(StreamingSubscription_C *psub);
+
+DLL_SPEC_ std::set<std::string>
+SubscriptionBySymbolBase_GetSymbols_Direct(StreamingSubscription_C *psub);
+
+DLL_SPEC_ void
+SubscriptionBySymbolBase_SetSymbols_Direct( StreamingSubscription_C *psub,
+                                            const std::set<std::string>& symbols );
+
 struct StreamerCredentials{
     std::string user_id;
     std::string token;
@@ -1219,13 +1257,32 @@ public:
     StreamingSubscription&
     operator=( const StreamingSubscription& sub )
     {
-        if( *this != sub ){
+        if( this != &sub ){
             _csub.reset( new CType{0,0} );
             call_abi( StreamingSubscription_Copy_ABI, sub._csub.get(), _csub.get() );
         }
         return *this;
     }
 
+    /*
+     * moved-from subscriptions can only be assigned to or destroyed
+     * (swap, so they keep their destroyer)
+     */
+    StreamingSubscription( StreamingSubscription&& sub ) noexcept
+        :
+            _csub( nullptr,
+                   CProxyDestroyer<CType>(StreamingSubscription_Destroy_ABI) )
+        {
+            _csub.swap(sub._csub);
+        }
+
+    StreamingSubscription&
+    operator=( StreamingSubscription&& sub ) noexcept
+    {
+        _csub.swap(sub._csub);
+        return *this;
+    }
+
     bool
     operator==( const StreamingSubscription& sub ) const
     {
@@ -1238,6 +1295,21 @@ public:
     operator!=( const StreamingSubscription& sub ) const
     { return !(*this == sub); }
 
+    size_t
+    hash() const
+    {
+        size_t h;
+        call_abi( StreamingSubscription_Hash_ABI, _csub.get(), &h );
+        return h;
+    }
+
+    /* e.g std::unordered_set<QuotesSubscription, StreamingSubscription::Hash> */
+    struct Hash{
+        size_t
+        operator()( const StreamingSubscription& sub ) const
+        { return sub.hash(); }
+    };
+
 };
 
 
@@ -1348,6 +1420,15 @@ protected:
     using StreamingSubscription::StreamingSubscription;
 
 public:
+#ifdef TDMA_API_DIRECT_LINKAGE
+    StreamerServiceType
+    get_service() const
+    { return StreamingSubscription_GetService_Direct( csub<>() ); }
+
+    CommandType
+    get_command() const
+    { return StreamingSubscription_GetCommand_Direct( csub<>() ); }
+#else
     StreamerServiceType
     get_service() const
     {
@@ -1363,6 +1444,7 @@ public:
         call_abi( StreamingSubscription_GetCommand_ABI, csub<>(), &c );
         return static_cast<CommandType>(c);
     }
+#endif /* TDMA_API_DIRECT_LINKAGE */
 
     void
     set_command( CommandType command )
@@ -1432,6 +1514,15 @@ protected:
 
 
 public:
+#ifdef TDMA_API_DIRECT_LINKAGE
+    std::set<std::string>
+    get_symbols() const
+    { return SubscriptionBySymbolBase_GetSymbols_Direct( csub() ); }
+
+    void
+    set_symbols( const std::set<std::string>& symbols )
+    { SubscriptionBySymbolBase_SetSymbols_Direct( csub(), symbols ); }
+#else
     std::set<std::string>
     get_symbols() const
     {
@@ -1445,6 +1536,7 @@ public:
         set_of_strs_to_abi( SubscriptionBySymbolBase_SetSymbols_ABI, csub(),
                             symbols );
     }
+#endif /* TDMA_API_DIRECT_LINKAGE */
 };
 
 
@@ -2086,6 +2178,347 @@ StreamingSession_GetQOS_ABI( StreamingSession_C *psession,
                              int *qos,
                              int allow_exceptions );
 
+/*
+ * External event loop
+ *
+ * By default a session runs its socket and listener on library threads.
+ * Set 'external_loop' (before Start) to run both on the caller's own event
+ * loop instead: wait for 'events' on 'fd' (or until 'msec' passes), then
+ * call ProcessEvents, which handles what's ready and runs the callback on
+ * that thread; it returns 'is_listening' == 0 once the session has stopped
+ * (after the listening_stop/timeout/error callback).
+ *
+ * All calls on the session must come from the loop's thread; those that
+ * wait on the server (Start, AddSubscriptions, SetQOS, Stop) run the loop
+ * themselves until they're done. The fd and deadline are only valid while
+ * the session is active. (epoll backend only)
+ */
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_SetExternalLoop_ABI( StreamingSession_C *psession,
+                                      int external_loop,
+                                      int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_IsExternalLoop_ABI( StreamingSession_C *psession,
+                                     int *external_loop,
+                                     int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_GetEventFd_ABI( StreamingSession_C *psession,
+                                 int *fd,
+                                 int *events,
+                                 int allow_exceptions );
+
+/* -1 if no deadline */
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_GetNextTimeout_ABI( StreamingSession_C *psession,
+                                     long long *msec,
+                                     int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_ProcessEvents_ABI( StreamingSession_C *psession,
+                                    long long wait_msec,
+                                    int *is_listening,
+                                    int allow_exceptions );
+
+/*
+ * Socket backend
+ *
+ * How the socket of sessions started after this call is polled: epoll
+ * (default) or io_uring (one batched syscall per loop iteration instead of
+ * one per wait and per poll change). io_uring falls back to epoll if the
+ * kernel doesn't support it (< 5.11, disabled, seccomp); Get returns the
+ * backend new sessions will actually use. (Linux only)
+ */
+EXTERN_C_SPEC_ DLL_SPEC_ int
+SetStreamingSocketBackend_ABI( int backend, int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+GetStreamingSocketBackend_ABI( int *backend, int allow_exceptions );
+
+/*
+ * Shared-memory fan-out
+ *
+ * A session can publish everything it receives to a named shared memory
+ * ring so other *local* processes can consume the stream without their
+ * own login. 'data' items are split one per symbol. Subscribers attach by
+ * name, filter by service/symbol and are handed pointers directly into the
+ * ring (no copies). The publisher never waits on subscribers; a subscriber
+ * that falls too far behind skips ahead and the skipped items are counted.
+ * Publishing fails if a live publisher already has 'name'; a segment left
+ * by one that died is replaced.
+ *
+ * Because the ring is overwritten in place, 'data'/'symbol' of an item are
+ * only guaranteed intact if StreamingSubscriber_IsValid returns true AFTER
+ * the item has been consumed (or copied).
+ */
+#define STREAMING_SHM_DEF_NSLOTS 65536 /* must be a power of 2 */
+#define STREAMING_SHM_DEF_SLOT_SIZE 1024
+
+typedef struct{
+    int callback_type;
+    int service_type;
+    unsigned long long timestamp;
+    unsigned long long sequence;
+    const char* symbol;
+    const char* data;
+    size_t data_len;
+} StreamingSubscriberItem;
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_StartPublishing_ABI( StreamingSession_C *psession,
+                                      const char* name,
+                                      size_t nslots,
+                                      size_t slot_size,
+                                      int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_StopPublishing_ABI( StreamingSession_C *psession,
+                                     int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_IsPublishing_ABI( StreamingSession_C *psession,
+                                   int *is_publishing,
+                                   int allow_exceptions );
+
+/*
+ * Filters
+ *
+ * Drop 'data' items before they're passed to the callback(s). Filters are
+ * per session: what's published to shared memory is unfiltered.
+ * Per service, an item passes if its symbol is in the symbol set (when not
+ * empty) AND it matches one of the rules (when there are any):
+ *
+ *   changed - 'field' is in the update
+ *   delta   - 'field' moved >= 'value' since the last update that passed
+ *   cross   - 'field' crossed the level 'value' since the last update
+ *
+ * 'field' is the int value of the service's field enum (e.g.
+ * QuotesSubscriptionField). Clearing StreamerServiceType NONE clears all.
+ */
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_SetFilterSymbols_ABI( StreamingSession_C *psession,
+                                       int service,
+                                       const char** symbols,
+                                       size_t nsymbols,
+                                       int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_AddFilterRule_ABI( StreamingSession_C *psession,
+                                    int service,
+                                    int field,
+                                    int rule_type,
+                                    double value,
+                                    int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_ClearFilter_ABI( StreamingSession_C *psession,
+                                  int service,
+                                  int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_GetFilterStats_ABI( StreamingSession_C *psession,
+                                     int service,
+                                     unsigned long long *npassed,
+                                     unsigned long long *ndropped,
+                                     int allow_exceptions );
+
+/*
+ * Routes
+ *
+ * Send a service's 'data' (no symbols) or the items for some of its
+ * symbols to 'callback' instead of the session's callback, which becomes
+ * the catch-all: it gets what no route takes and every other callback
+ * type. Routes are evaluated (listener thread) after filters; a symbol
+ * route's callback gets only its items, once per message. Unrelated routes
+ * aren't called.
+ */
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_AddRoute_ABI( StreamingSession_C *psession,
+                               int service,
+                               const char** symbols,
+                               size_t nsymbols,
+                               streaming_cb_ty callback,
+                               int *id,
+                               int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_RemoveRoute_ABI( StreamingSession_C *psession,
+                                  int id,
+                                  int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_ClearRoutes_ABI( StreamingSession_C *psession,
+                                  int allow_exceptions );
+
+/*
+ * Spreads
+ *
+ * Synthetic quotes for a spread (legs w/ signed ratios: > 0 long, < 0 short,
+ * reduced by their gcd) updated from the QUOTE/OPTION data the session
+ * receives (before filters) - subscribe to the legs as usual. Only spreads
+ * with a leg in an update are repriced. 'is_valid' is 0 until every leg has
+ * a bid and ask.
+ *
+ *   bid - natural: long legs at the bid, short legs at the ask
+ *   ask - natural: long legs at the ask, short legs at the bid
+ *   mid - sum of the leg mids
+ *
+ * The callback (listener thread) gets the id, bid, ask, mid and timestamp
+ * whenever a spread's quote changes.
+ */
+typedef struct{
+    double bid;
+    double ask;
+    double mid;
+    unsigned long long timestamp;
+    int is_valid;
+} SpreadQuote;
+
+typedef void(*spread_cb_ty)(int, double, double, double, unsigned long long);
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_AddSpread_ABI( StreamingSession_C *psession,
+                                const char** symbols,
+                                int *ratios,
+                                size_t nlegs,
+                                int *id,
+                                int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_RemoveSpread_ABI( StreamingSession_C *psession,
+                                   int id,
+                                   int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_GetSpreadQuote_ABI( StreamingSession_C *psession,
+                                     int id,
+                                     SpreadQuote *quote,
+                                     int allow_exceptions );
+
+/* NULL to remove */
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_SetSpreadCallback_ABI( StreamingSession_C *psession,
+                                        spread_cb_ty callback,
+                                        int allow_exceptions );
+
+/*
+ * IV Surface
+ *
+ * Per underlying, a volatility smile for each expiration kept up to date
+ * from the OPTION data the session receives (before filters); subscribe
+ * w/ at least the volatility, strike, contract type, underlying (price) and
+ * expiration fields. Off (no work per message) until enabled or seeded w/
+ * the (JSON) result of an OptionChainGetter, which also supplies the
+ * interest rate for greeks. Disabling drops the surface.
+ *
+ * Only expirations w/ a changed vol are refit, at most once per refit
+ * interval (msec) - on the next OPTION message after it, or a timer if
+ * none comes. Queries don't lock and always see complete fits; vol is
+ * in percent (like the 'volatility' field), theta is per day and vega per
+ * vol point.
+ */
+#define STREAMING_IV_SURFACE_DEF_REFIT_INTERVAL 250
+
+typedef struct{
+    double volatility;
+    double delta;
+    double gamma;
+    double theta;
+    double vega;
+} IVSurfaceGreeks;
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_SeedIVSurface_ABI( StreamingSession_C *psession,
+                                    const char* option_chain_json,
+                                    int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_SetIVSurfaceRefitInterval_ABI( StreamingSession_C *psession,
+                                                unsigned long msec,
+                                                int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_GetIVSurfaceRefitInterval_ABI( StreamingSession_C *psession,
+                                                unsigned long *msec,
+                                                int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_SetIVSurfaceEnabled_ABI( StreamingSession_C *psession,
+                                          int enabled,
+                                          int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_IsIVSurfaceEnabled_ABI( StreamingSession_C *psession,
+                                         int *enabled,
+                                         int allow_exceptions );
+
+/* refit pending expirations now, ignoring the interval */
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_RefitIVSurface_ABI( StreamingSession_C *psession,
+                                     int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_GetIVSurfaceVol_ABI( StreamingSession_C *psession,
+                                      const char* underlying,
+                                      double strike,
+                                      double days_to_expiration,
+                                      double *vol,
+                                      int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSession_GetIVSurfaceGreeks_ABI( StreamingSession_C *psession,
+                                         const char* underlying,
+                                         double strike,
+                                         double days_to_expiration,
+                                         int is_call,
+                                         IVSurfaceGreeks *greeks,
+                                         int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSubscriber_Create_ABI( const char* name,
+                                StreamingSubscriber_C *psub,
+                                int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSubscriber_Destroy_ABI( StreamingSubscriber_C *psub,
+                                 int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSubscriber_SetServices_ABI( StreamingSubscriber_C *psub,
+                                     int *services,
+                                     size_t nservices,
+                                     int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSubscriber_SetSymbols_ABI( StreamingSubscriber_C *psub,
+                                    const char** symbols,
+                                    size_t nsymbols,
+                                    int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSubscriber_Next_ABI( StreamingSubscriber_C *psub,
+                              unsigned long timeout,
+                              StreamingSubscriberItem *item,
+                              int *has_item,
+                              int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSubscriber_IsValid_ABI( StreamingSubscriber_C *psub,
+                                 StreamingSubscriberItem *item,
+                                 int *is_valid,
+                                 int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSubscriber_GetNDropped_ABI( StreamingSubscriber_C *psub,
+                                     unsigned long long *ndropped,
+                                     int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+StreamingSubscriber_IsPublisherActive_ABI( StreamingSubscriber_C *psub,
+                                           int *is_active,
+                                           int allow_exceptions );
+
 #ifndef __cplusplus
 
 /* C Interface */
@@ -2153,12 +2586,271 @@ static inline int
 StreamingSession_GetQOS( StreamingSession_C *psession, QOSType *qos)
 { return StreamingSession_GetQOS_ABI(psession, (int*)qos, 0); }
 
+static inline int
+StreamingSession_SetExternalLoop( StreamingSession_C *psession,
+                                  int external_loop )
+{ return StreamingSession_SetExternalLoop_ABI(psession, external_loop, 0); }
+
+static inline int
+StreamingSession_IsExternalLoop( StreamingSession_C *psession,
+                                 int *external_loop )
+{ return StreamingSession_IsExternalLoop_ABI(psession, external_loop, 0); }
+
+static inline int
+StreamingSession_GetEventFd( StreamingSession_C *psession,
+                             int *fd,
+                             int *events )
+{ return StreamingSession_GetEventFd_ABI(psession, fd, events, 0); }
+
+static inline int
+StreamingSession_GetNextTimeout( StreamingSession_C *psession,
+                                 long long *msec )
+{ return StreamingSession_GetNextTimeout_ABI(psession, msec, 0); }
+
+static inline int
+StreamingSession_ProcessEvents( StreamingSession_C *psession,
+                                long long wait_msec,
+                                int *is_listening )
+{
+    return StreamingSession_ProcessEvents_ABI(psession, wait_msec,
+                                              is_listening, 0);
+}
+
+static inline int
+SetStreamingSocketBackend( SocketBackendType backend )
+{ return SetStreamingSocketBackend_ABI((int)backend, 0); }
+
+static inline int
+GetStreamingSocketBackend( SocketBackendType *backend )
+{ return GetStreamingSocketBackend_ABI((int*)backend, 0); }
+
+static inline int
+StreamingSession_StartPublishing( StreamingSession_C *psession,
+                                  const char* name )
+{ return StreamingSession_StartPublishing_ABI(psession, name,
+                                              STREAMING_SHM_DEF_NSLOTS,
+                                              STREAMING_SHM_DEF_SLOT_SIZE, 0); }
+
+static inline int
+StreamingSession_StartPublishingEx( StreamingSession_C *psession,
+                                    const char* name,
+                                    size_t nslots,
+                                    size_t slot_size )
+{ return StreamingSession_StartPublishing_ABI(psession, name, nslots,
+                                              slot_size, 0); }
+
+static inline int
+StreamingSession_StopPublishing( StreamingSession_C *psession )
+{ return StreamingSession_StopPublishing_ABI(psession, 0); }
+
+static inline int
+StreamingSession_IsPublishing( StreamingSession_C *psession,
+                               int *is_publishing )
+{ return StreamingSession_IsPublishing_ABI(psession, is_publishing, 0); }
+
+static inline int
+StreamingSession_SetFilterSymbols( StreamingSession_C *psession,
+                                   StreamerServiceType service,
+                                   const char** symbols,
+                                   size_t nsymbols )
+{ return StreamingSession_SetFilterSymbols_ABI(psession, (int)service,
+                                               symbols, nsymbols, 0); }
+
+static inline int
+StreamingSession_AddFilterRule( StreamingSession_C *psession,
+                                StreamerServiceType service,
+                                int field,
+                                StreamingFilterRuleType rule_type,
+                                double value )
+{ return StreamingSession_AddFilterRule_ABI(psession, (int)service, field,
+                                            (int)rule_type, value, 0); }
+
+static inline int
+StreamingSession_ClearFilter( StreamingSession_C *psession,
+                              StreamerServiceType service )
+{ return StreamingSession_ClearFilter_ABI(psession, (int)service, 0); }
+
+static inline int
+StreamingSession_GetFilterStats( StreamingSession_C *psession,
+                                 StreamerServiceType service,
+                                 unsigned long long *npassed,
+                                 unsigned long long *ndropped )
+{ return StreamingSession_GetFilterStats_ABI(psession, (int)service,
+                                             npassed, ndropped, 0); }
+
+static inline int
+StreamingSession_AddRoute( StreamingSession_C *psession,
+                           StreamerServiceType service,
+                           const char** symbols,
+                           size_t nsymbols,
+                           streaming_cb_ty callback,
+                           int *id )
+{ return StreamingSession_AddRoute_ABI(psession, (int)service, symbols,
+                                       nsymbols, callback, id, 0); }
+
+static inline int
+StreamingSession_RemoveRoute( StreamingSession_C *psession, int id )
+{ return StreamingSession_RemoveRoute_ABI(psession, id, 0); }
+
+static inline int
+StreamingSession_ClearRoutes( StreamingSession_C *psession )
+{ return StreamingSession_ClearRoutes_ABI(psession, 0); }
+
+static inline int
+StreamingSession_AddSpread( StreamingSession_C *psession,
+                            const char** symbols,
+                            int *ratios,
+                            size_t nlegs,
+                            int *id )
+{ return StreamingSession_AddSpread_ABI(psession, symbols, ratios, nlegs,
+                                        id, 0); }
+
+static inline int
+StreamingSession_RemoveSpread( StreamingSession_C *psession, int id )
+{ return StreamingSession_RemoveSpread_ABI(psession, id, 0); }
+
+static inline int
+StreamingSession_GetSpreadQuote( StreamingSession_C *psession,
+                                 int id,
+                                 SpreadQuote *quote )
+{ return StreamingSession_GetSpreadQuote_ABI(psession, id, quote, 0); }
+
+static inline int
+StreamingSession_SetSpreadCallback( StreamingSession_C *psession,
+                                    spread_cb_ty callback )
+{ return StreamingSession_SetSpreadCallback_ABI(psession, callback, 0); }
+
+static inline int
+StreamingSession_SeedIVSurface( StreamingSession_C *psession,
+                                const char* option_chain_json )
+{ return StreamingSession_SeedIVSurface_ABI(psession, option_chain_json, 0); }
+
+static inline int
+StreamingSession_SetIVSurfaceRefitInterval( StreamingSession_C *psession,
+                                            unsigned long msec )
+{ return StreamingSession_SetIVSurfaceRefitInterval_ABI(psession, msec, 0); }
+
+static inline int
+StreamingSession_GetIVSurfaceRefitInterval( StreamingSession_C *psession,
+                                            unsigned long *msec )
+{ return StreamingSession_GetIVSurfaceRefitInterval_ABI(psession, msec, 0); }
+
+static inline int
+StreamingSession_SetIVSurfaceEnabled( StreamingSession_C *psession,
+                                      int enabled )
+{ return StreamingSession_SetIVSurfaceEnabled_ABI(psession, enabled, 0); }
+
+static inline int
+StreamingSession_IsIVSurfaceEnabled( StreamingSession_C *psession,
+                                     int *enabled )
+{ return StreamingSession_IsIVSurfaceEnabled_ABI(psession, enabled, 0); }
+
+static inline int
+StreamingSession_RefitIVSurface( StreamingSession_C *psession )
+{ return StreamingSession_RefitIVSurface_ABI(psession, 0); }
+
+static inline int
+StreamingSession_GetIVSurfaceVol( StreamingSession_C *psession,
+                                  const char* underlying,
+                                  double strike,
+                                  double days_to_expiration,
+                                  double *vol )
+{ return StreamingSession_GetIVSurfaceVol_ABI(psession, underlying, strike,
+                                              days_to_expiration, vol, 0); }
+
+static inline int
+StreamingSession_GetIVSurfaceGreeks( StreamingSession_C *psession,
+                                     const char* underlying,
+                                     double strike,
+                                     double days_to_expiration,
+                                     int is_call,
+                                     IVSurfaceGreeks *greeks )
+{ return StreamingSession_GetIVSurfaceGreeks_ABI(psession, underlying, strike,
+                                                 days_to_expiration, is_call,
+                                                 greeks, 0); }
+
+static inline int
+StreamingSubscriber_Create( const char* name, StreamingSubscriber_C *psub )
+{ return StreamingSubscriber_Create_ABI(name, psub, 0); }
+
+static inline int
+StreamingSubscriber_Destroy( StreamingSubscriber_C *psub )
+{ return StreamingSubscriber_Destroy_ABI(psub, 0); }
+
+static inline int
+StreamingSubscriber_SetServices( StreamingSubscriber_C *psub,
+                                 StreamerServiceType *services,
+                                 size_t nservices )
+{ return StreamingSubscriber_SetServices_ABI(psub, (int*)services,
+                                             nservices, 0); }
+
+static inline int
+StreamingSubscriber_SetSymbols( StreamingSubscriber_C *psub,
+                                const char** symbols,
+                                size_t nsymbols )
+{ return StreamingSubscriber_SetSymbols_ABI(psub, symbols, nsymbols, 0); }
+
+static inline int
+StreamingSubscriber_Next( StreamingSubscriber_C *psub,
+                          unsigned long timeout,
+                          StreamingSubscriberItem *item,
+                          int *has_item )
+{ return StreamingSubscriber_Next_ABI(psub, timeout, item, has_item, 0); }
+
+static inline int
+StreamingSubscriber_IsValid( StreamingSubscriber_C *psub,
+                             StreamingSubscriberItem *item,
+                             int *is_valid )
+{ return StreamingSubscriber_IsValid_ABI(psub, item, is_valid, 0); }
+
+static inline int
+StreamingSubscriber_GetNDropped( StreamingSubscriber_C *psub,
+                                 unsigned long long *ndropped )
+{ return StreamingSubscriber_GetNDropped_ABI(psub, ndropped, 0); }
+
+static inline int
+StreamingSubscriber_IsPublisherActive( StreamingSubscriber_C *psub,
+                                       int *is_active )
+{ return StreamingSubscriber_IsPublisherActive_ABI(psub, is_active, 0); }
+
 #else
 
 /* C++ Interface */
 
 namespace tdma{
 
+/* a C++ callback, passed the parsed message instead of a string */
+typedef std::function<void(StreamingCallbackType, StreamerServiceType,
+                           unsigned long long, const json&)>
+    streaming_json_cb_ty;
+
+/* direct (C++ linkage) access to the session for TDMA_API_DIRECT_LINKAGE */
+DLL_SPEC_ std::deque<bool>
+StreamingSession_Start_Direct(
+    StreamingSession_C *psession,
+    const std::vector<StreamingSubscription_C*>& subscriptions );
+
+DLL_SPEC_ std::deque<bool>
+StreamingSession_AddSubscriptions_Direct(
+    StreamingSession_C *psession,
+    const std::vector<StreamingSubscription_C*>& subscriptions );
+
+DLL_SPEC_ void
+StreamingSession_Stop_Direct(StreamingSession_C *psession);
+
+DLL_SPEC_ bool
+StreamingSession_IsActive_Direct(StreamingSession_C *psession);
+
+DLL_SPEC_ void
+StreamingSession_SetJsonCallback_Direct( StreamingSession_C *psession,
+                                         streaming_json_cb_ty callback );
+
+DLL_SPEC_ int
+StreamingSession_AddJsonRoute_Direct( StreamingSession_C *psession,
+                                      StreamerServiceType service,
+                                      const std::set<std::string>& symbols,
+                                      streaming_json_cb_ty callback );
+
 class DLL_SPEC_ StreamingSession{
 public:
     static const std::string VERSION; // = "1.0"
@@ -2213,6 +2905,22 @@ private:
         return cpp_results;
     }
 
+#ifdef TDMA_API_DIRECT_LINKAGE
+    std::deque<bool>
+    _call_direct_with_subs(
+        std::deque<bool>(*call)(CType*,
+                                const std::vector<StreamingSubscription_C*>&),
+        const std::vector<StreamingSubscription>& subscriptions
+        )
+    {
+        std::vector<StreamingSubscription_C*> csubs;
+        csubs.reserve( subscriptions.size() );
+        for( auto& s : subscriptions )
+            csubs.push_back( s.csub() );
+        return call(_obj.get(), csubs);
+    }
+#endif /* TDMA_API_DIRECT_LINKAGE */
+
 public:
     static std::shared_ptr<StreamingSession>
     Create( Credentials& creds,
@@ -2242,14 +2950,41 @@ public:
     StreamingSession&
     operator=( const StreamingSession& ) = delete;
 
+#ifdef TDMA_API_DIRECT_LINKAGE
+    std::deque<bool> // success/fails in the order passed
+    start( const std::vector<StreamingSubscription>& subscriptions )
+    { return _call_direct_with_subs(StreamingSession_Start_Direct,
+                                    subscriptions); }
+#else
     std::deque<bool> // success/fails in the order passed
     start( const std::vector<StreamingSubscription>& subscriptions )
     { return _call_abi_with_subs(StreamingSession_Start_ABI,subscriptions); }
+#endif /* TDMA_API_DIRECT_LINKAGE */
 
     bool 
     start( const StreamingSubscription& subscription )
     { return start(std::vector<StreamingSubscription>{subscription})[0]; }
 
+#ifdef TDMA_API_DIRECT_LINKAGE
+    void
+    stop()
+    { StreamingSession_Stop_Direct( _obj.get() ); }
+
+    bool
+    is_active() const
+    { return StreamingSession_IsActive_Direct( _obj.get() ); }
+
+    std::deque<bool> // success/fails in the order passed
+    add_subscriptions(const std::vector<StreamingSubscription>& subscriptions)
+    { return _call_direct_with_subs( StreamingSession_AddSubscriptions_Direct,
+                                     subscriptions ); }
+
+    // before start(); replaces the callback passed to Create (empty restores)
+    void
+    set_json_callback( streaming_json_cb_ty callback )
+    { StreamingSession_SetJsonCallback_Direct( _obj.get(),
+                                               std::move(callback) ); }
+#else
     void
     stop()
     { call_abi( StreamingSession_Stop_ABI, _obj.get() ); }
@@ -2266,6 +3001,7 @@ public:
     add_subscriptions(const std::vector<StreamingSubscription>& subscriptions)
     { return _call_abi_with_subs( StreamingSession_AddSubscriptions_ABI,
                                   subscriptions ); }
+#endif /* TDMA_API_DIRECT_LINKAGE */
 
     bool 
     add_subscription(const StreamingSubscription& subscription)
@@ -2291,6 +3027,376 @@ public:
                   static_cast<int>(qos), &result );
         return static_cast<bool>(result);
     }
+
+    // before start(), see StreamingSession_SetExternalLoop_ABI
+    void
+    set_external_loop(bool external_loop)
+    {
+        call_abi( StreamingSession_SetExternalLoop_ABI, _obj.get(),
+                  static_cast<int>(external_loop) );
+    }
+
+    bool
+    is_external_loop() const
+    {
+        int e;
+        call_abi( StreamingSession_IsExternalLoop_ABI, _obj.get(), &e );
+        return static_cast<bool>(e);
+    }
+
+    // fd, poll events
+    std::pair<int, int>
+    get_event_fd() const
+    {
+        int fd, events;
+        call_abi( StreamingSession_GetEventFd_ABI, _obj.get(), &fd, &events );
+        return std::make_pair(fd, events);
+    }
+
+    // -1 if no deadline
+    std::chrono::milliseconds
+    get_next_timeout() const
+    {
+        long long msec;
+        call_abi( StreamingSession_GetNextTimeout_ABI, _obj.get(), &msec );
+        return std::chrono::milliseconds(msec);
+    }
+
+    // false once the session has stopped listening
+    bool
+    process_events( std::chrono::milliseconds wait
+                        = std::chrono::milliseconds(0) )
+    {
+        int listening;
+        call_abi( StreamingSession_ProcessEvents_ABI, _obj.get(),
+                  static_cast<long long>(wait.count()), &listening );
+        return static_cast<bool>(listening);
+    }
+
+    // for sessions started after, see SetStreamingSocketBackend_ABI
+    static void
+    set_socket_backend(SocketBackendType backend)
+    { call_abi( SetStreamingSocketBackend_ABI, static_cast<int>(backend) ); }
+
+    static SocketBackendType
+    get_socket_backend()
+    {
+        int b;
+        call_abi( GetStreamingSocketBackend_ABI, &b );
+        return static_cast<SocketBackendType>(b);
+    }
+
+    void
+    start_publishing( const std::string& name,
+                      size_t nslots = STREAMING_SHM_DEF_NSLOTS,
+                      size_t slot_size = STREAMING_SHM_DEF_SLOT_SIZE )
+    {
+        call_abi( StreamingSession_StartPublishing_ABI, _obj.get(),
+                  name.c_str(), nslots, slot_size );
+    }
+
+    void
+    stop_publishing()
+    { call_abi( StreamingSession_StopPublishing_ABI, _obj.get() ); }
+
+    bool
+    is_publishing() const
+    {
+        int p;
+        call_abi( StreamingSession_IsPublishing_ABI, _obj.get(), &p );
+        return static_cast<bool>(p);
+    }
+
+    // empty set for all symbols
+    void
+    set_filter_symbols( StreamerServiceType service,
+                        const std::set<std::string>& symbols )
+    {
+        std::vector<const char*> s;
+        for( auto& ss : symbols )
+            s.push_back( ss.c_str() );
+        call_abi( StreamingSession_SetFilterSymbols_ABI, _obj.get(),
+                  static_cast<int>(service), s.data(), s.size() );
+    }
+
+    // 'field' is the service's field enum, e.g. QuotesSubscription::FieldType
+    template<typename FieldTy>
+    void
+    add_filter_rule( StreamerServiceType service,
+                     FieldTy field,
+                     StreamingFilterRuleType rule_type,
+                     double value = 0 )
+    {
+        call_abi( StreamingSession_AddFilterRule_ABI, _obj.get(),
+                  static_cast<int>(service), static_cast<int>(field),
+                  static_cast<int>(rule_type), value );
+    }
+
+    // StreamerServiceType::NONE for all
+    void
+    clear_filter( StreamerServiceType service )
+    {
+        call_abi( StreamingSession_ClearFilter_ABI, _obj.get(),
+                  static_cast<int>(service) );
+    }
+
+    // passed, dropped
+    std::pair<unsigned long long, unsigned long long>
+    get_filter_stats( StreamerServiceType service ) const
+    {
+        unsigned long long p, d;
+        call_abi( StreamingSession_GetFilterStats_ABI, _obj.get(),
+                  static_cast<int>(service), &p, &d );
+        return std::make_pair(p, d);
+    }
+
+    // all of the service's data; returns the route id
+    int
+    add_route( StreamerServiceType service, streaming_cb_ty callback )
+    { return add_route(service, std::set<std::string>(), callback); }
+
+    int
+    add_route( StreamerServiceType service,
+               const std::string& symbol,
+               streaming_cb_ty callback )
+    { return add_route(service, std::set<std::string>{symbol}, callback); }
+
+    int
+    add_route( StreamerServiceType service,
+               const std::set<std::string>& symbols,
+               streaming_cb_ty callback )
+    {
+        std::vector<const char*> s;
+        for( auto& ss : symbols )
+            s.push_back( ss.c_str() );
+        int id;
+        call_abi( StreamingSession_AddRoute_ABI, _obj.get(),
+                  static_cast<int>(service), s.data(), s.size(), callback,
+                  &id );
+        return id;
+    }
+
+#ifdef TDMA_API_DIRECT_LINKAGE
+    // as add_route, passed the parsed items (no symbols for all)
+    int
+    add_json_route( StreamerServiceType service,
+                    const std::set<std::string>& symbols,
+                    streaming_json_cb_ty callback )
+    { return StreamingSession_AddJsonRoute_Direct( _obj.get(), service,
+                                                   symbols,
+                                                   std::move(callback) ); }
+#endif /* TDMA_API_DIRECT_LINKAGE */
+
+    void
+    remove_route( int id )
+    { call_abi( StreamingSession_RemoveRoute_ABI, _obj.get(), id ); }
+
+    void
+    clear_routes()
+    { call_abi( StreamingSession_ClearRoutes_ABI, _obj.get() ); }
+
+    // (symbol, ratio): ratio > 0 long, < 0 short; returns the spread id
+    int
+    add_spread( const std::vector<std::pair<std::string, int>>& legs )
+    {
+        std::vector<const char*> s;
+        std::vector<int> r;
+        for( auto& l : legs ){
+            s.push_back( l.first.c_str() );
+            r.push_back( l.second );
+        }
+        int id;
+        call_abi( StreamingSession_AddSpread_ABI, _obj.get(), s.data(),
+                  r.data(), legs.size(), &id );
+        return id;
+    }
+
+    // legs of an OrderTicket (e.g from SpreadOrderBuilder): BUY... long,
+    // SELL... short, quantities as the ratios
+    template<typename OrderTicketTy>
+    int
+    add_spread_from_order( const OrderTicketTy& order )
+    {
+        std::vector<std::pair<std::string, int>> legs;
+        for( auto& leg : order.get_legs() ){
+            int q = static_cast<int>( leg.get_quantity() );
+            std::string i = to_string( leg.get_instruction() );
+            legs.emplace_back( leg.get_symbol(),
+                               i.compare(0, 4, "SELL") ? q : -q );
+        }
+        return add_spread(legs);
+    }
+
+    void
+    remove_spread( int id )
+    { call_abi( StreamingSession_RemoveSpread_ABI, _obj.get(), id ); }
+
+    SpreadQuote
+    get_spread_quote( int id ) const
+    {
+        SpreadQuote q;
+        call_abi( StreamingSession_GetSpreadQuote_ABI, _obj.get(), id, &q );
+        return q;
+    }
+
+    // nullptr to remove
+    void
+    set_spread_callback( spread_cb_ty callback )
+    {
+        call_abi( StreamingSession_SetSpreadCallback_ABI, _obj.get(),
+                  callback );
+    }
+
+    // off until enabled or seeded; disabling drops the surface
+    void
+    set_iv_surface_enabled( bool enabled )
+    {
+        call_abi( StreamingSession_SetIVSurfaceEnabled_ABI, _obj.get(),
+                  static_cast<int>(enabled) );
+    }
+
+    bool
+    is_iv_surface_enabled() const
+    {
+        int enabled;
+        call_abi( StreamingSession_IsIVSurfaceEnabled_ABI, _obj.get(),
+                  &enabled );
+        return static_cast<bool>(enabled);
+    }
+
+    // the result of OptionChainGetter::get(); enables the surface
+    void
+    seed_iv_surface( const json& option_chain )
+    {
+        call_abi( StreamingSession_SeedIVSurface_ABI, _obj.get(),
+                  option_chain.dump().c_str() );
+    }
+
+    void
+    set_iv_surface_refit_interval( std::chrono::milliseconds interval )
+    {
+        call_abi( StreamingSession_SetIVSurfaceRefitInterval_ABI, _obj.get(),
+                  static_cast<unsigned long>(interval.count()) );
+    }
+
+    std::chrono::milliseconds
+    get_iv_surface_refit_interval() const
+    {
+        unsigned long msec;
+        call_abi( StreamingSession_GetIVSurfaceRefitInterval_ABI, _obj.get(),
+                  &msec );
+        return std::chrono::milliseconds(msec);
+    }
+
+    void
+    refit_iv_surface()
+    { call_abi( StreamingSession_RefitIVSurface_ABI, _obj.get() ); }
+
+    // percent
+    double
+    get_iv_surface_vol( const std::string& underlying,
+                        double strike,
+                        double days_to_expiration ) const
+    {
+        double v;
+        call_abi( StreamingSession_GetIVSurfaceVol_ABI, _obj.get(),
+                  underlying.c_str(), strike, days_to_expiration, &v );
+        return v;
+    }
+
+    IVSurfaceGreeks
+    get_iv_surface_greeks( const std::string& underlying,
+                           double strike,
+                           double days_to_expiration,
+                           bool is_call ) const
+    {
+        IVSurfaceGreeks g;
+        call_abi( StreamingSession_GetIVSurfaceGreeks_ABI, _obj.get(),
+                  underlying.c_str(), strike, days_to_expiration,
+                  static_cast<int>(is_call), &g );
+        return g;
+    }
+};
+
+
+class DLL_SPEC_ StreamingSubscriber{
+public:
+    typedef StreamingSubscriber_C CType;
+    typedef StreamingSubscriberItem Item;
+
+private:
+    std::unique_ptr<CType, CProxyDestroyer<CType>> _obj;
+
+public:
+    StreamingSubscriber( const std::string& name )
+        :
+            _obj( new CType{0,0},
+                  CProxyDestroyer<CType>(StreamingSubscriber_Destroy_ABI) )
+        { call_abi( StreamingSubscriber_Create_ABI, name.c_str(), _obj.get() ); }
+
+    StreamingSubscriber( const StreamingSubscriber& ) = delete;
+
+    StreamingSubscriber&
+    operator=( const StreamingSubscriber& ) = delete;
+
+    // empty set for all services
+    void
+    set_services( const std::set<StreamerServiceType>& services )
+    {
+        std::vector<int> s;
+        for( auto ss : services )
+            s.push_back( static_cast<int>(ss) );
+        call_abi( StreamingSubscriber_SetServices_ABI, _obj.get(), s.data(),
+                  s.size() );
+    }
+
+    // empty set for all symbols
+    void
+    set_symbols( const std::set<std::string>& symbols )
+    {
+        std::vector<const char*> s;
+        for( auto& ss : symbols )
+            s.push_back( ss.c_str() );
+        call_abi( StreamingSubscriber_SetSymbols_ABI, _obj.get(), s.data(),
+                  s.size() );
+    }
+
+    // 'item' points into the shared ring; see is_valid()
+    bool
+    next( Item& item,
+          std::chrono::milliseconds timeout = std::chrono::milliseconds(0) )
+    {
+        int has_item;
+        call_abi( StreamingSubscriber_Next_ABI, _obj.get(),
+                  static_cast<unsigned long>(timeout.count()), &item,
+                  &has_item );
+        return static_cast<bool>(has_item);
+    }
+
+    bool
+    is_valid( const Item& item ) const
+    {
+        int v;
+        call_abi( StreamingSubscriber_IsValid_ABI, _obj.get(),
+                  const_cast<Item*>(&item), &v );
+        return static_cast<bool>(v);
+    }
+
+    unsigned long long
+    get_ndropped() const
+    {
+        unsigned long long n;
+        call_abi( StreamingSubscriber_GetNDropped_ABI, _obj.get(), &n );
+        return n;
+    }
+
+    bool
+    is_publisher_active() const
+    {
+        int a;
+        call_abi( StreamingSubscriber_IsPublisherActive_ABI, _obj.get(), &a );
+        return static_cast<bool>(a);
+    }
 };
 
 } /* tdma */
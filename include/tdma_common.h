@@ -29,6 +29,13 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 
 using json = nlohmann::json;
 
+namespace tdma{
+
+template<typename E>
+struct enum_bounds;
+
+} /* tdma */
+
 /*
  * if C++ DECL_C_CPP_TDMA_ENUM expands to:
  *
@@ -42,6 +49,7 @@ using json = nlohmann::json;
  * }
  *
  * and defines an inline [TypeName]_is_valid for checks in the ABI
+ * and specializes enum_bounds<type> with the (compile-time) low/high values
  * and declares a stable-ABI to_string: 'type_to_string_ABI(type t)'
  * and declares/defines a '<<' overload
  * and declares/defines an overloaded 'to_string()'
@@ -68,6 +76,12 @@ type##_is_valid(int v) \
 namespace tdma{ \
 enum class type : int { __VA_ARGS__ }; \
 \
+template<> \
+struct enum_bounds<type>{ \
+    static constexpr int low = l; \
+    static constexpr int high = h; \
+}; \
+\
 inline std::string \
 to_string(const type& v) \
 { \
@@ -110,6 +124,7 @@ DECL_CPROXY_BASE_STRUCT(Getter_C);
 DECL_CPROXY_BASE_STRUCT(StreamingSubscription_C);
 DECL_CPROXY_BASE_STRUCT(OrderLeg_C);
 DECL_CPROXY_BASE_STRUCT(OrderTicket_C);
+DECL_CPROXY_BASE_STRUCT(StreamingSubscriber_C);
 
 #undef DECL_CPROXY_BASE_STRUCT
 
@@ -195,6 +210,72 @@ GetDefaultCertificateBundlePath_ABI( char **path,
                                      size_t *n,
                                      int allow_exceptions );
 
+EXTERN_C_SPEC_ DLL_SPEC_ int
+SetSharedTokenStore_ABI(const char* path, int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+GetSharedTokenStore_ABI(char **path, size_t *n, int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+SetFlightRecorderPath_ABI(const char* path, int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+GetFlightRecorderPath_ABI(char **path, size_t *n, int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+SetFlightRecorderSignal_ABI(int signum, int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+DumpFlightRecorder_ABI(const char* path, int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+SetExecutorPoolSize_ABI(unsigned int n, int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+GetExecutorPoolSize_ABI(unsigned int *n, int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+SetExecutorIOPoolSize_ABI(unsigned int n, int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+GetExecutorIOPoolSize_ABI(unsigned int *n, int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+SetExecutorAffinity_ABI(const int *cpus, size_t n, int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+GetExecutorThreadCount_ABI(unsigned int *n, int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+ExecutorPost_ABI( void(*func)(void*),
+                  void(*release)(void*),
+                  void* arg,
+                  int io,
+                  int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+ExecutorPostAfter_ABI( long long msec,
+                       void(*func)(void*),
+                       void(*release)(void*),
+                       void* arg,
+                       int io,
+                       unsigned long long* id,
+                       int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+ExecutorPostEvery_ABI( long long msec,
+                       void(*func)(void*),
+                       void(*release)(void*),
+                       void* arg,
+                       int io,
+                       unsigned long long* id,
+                       int allow_exceptions );
+
+EXTERN_C_SPEC_ DLL_SPEC_ int
+ExecutorCancel_ABI( unsigned long long id,
+                    int *cancelled,
+                    int allow_exceptions );
+
 EXTERN_C_SPEC_ DLL_SPEC_ int
 CreateCredentials_ABI( const char* access_token,
                        const char* refresh_token,
@@ -310,6 +391,100 @@ static inline int
 GetCertificateBundlePath(char **path, size_t *n)
 { return GetCertificateBundlePath_ABI(path, n, 0); }
 
+/*
+ * share refreshed access tokens w/ other processes through the file at
+ * 'path' (e.g. next to the credentials file); NULL or "" to disable
+ */
+static inline int
+SetSharedTokenStore(const char* path)
+{ return SetSharedTokenStore_ABI(path, 0); }
+
+static inline int
+GetSharedTokenStore(char **path, size_t *n)
+{ return GetSharedTokenStore_ABI(path, n, 0); }
+
+/*
+ * flight recorder: the last events(requests, frames, subscriptions etc.) of
+ * each library thread, written to 'path' on connection/server/streaming
+ * errors, on 'signum', or by DumpFlightRecorder (NULL or "" for the path
+ * that was set); NULL or "", 0 to disable. (see tools/flight_decode.py)
+ */
+static inline int
+SetFlightRecorderPath(const char* path)
+{ return SetFlightRecorderPath_ABI(path, 0); }
+
+static inline int
+GetFlightRecorderPath(char **path, size_t *n)
+{ return GetFlightRecorderPath_ABI(path, n, 0); }
+
+static inline int
+SetFlightRecorderSignal(int signum)
+{ return SetFlightRecorderSignal_ABI(signum, 0); }
+
+static inline int
+DumpFlightRecorder(const char* path)
+{ return DumpFlightRecorder_ABI(path, 0); }
+
+/*
+ * executor: all library threads come from a thread pool (default: # of
+ * cores, max 4), an I/O pool for blocking calls (default 4), and dedicated
+ * threads for the socket/listener loops; all are pinned to 'cpus' (n == 0
+ * to unpin).
+ *
+ * ExecutorPost* run func(arg) on the pool (io == 0) or I/O pool; after
+ * 'msec' or every 'msec'. 'release'(if not NULL) is called w/ 'arg' once
+ * func won't be called again(including on error or ExecutorCancel).
+ */
+static inline int
+SetExecutorPoolSize(unsigned int n)
+{ return SetExecutorPoolSize_ABI(n, 0); }
+
+static inline int
+GetExecutorPoolSize(unsigned int *n)
+{ return GetExecutorPoolSize_ABI(n, 0); }
+
+static inline int
+SetExecutorIOPoolSize(unsigned int n)
+{ return SetExecutorIOPoolSize_ABI(n, 0); }
+
+static inline int
+GetExecutorIOPoolSize(unsigned int *n)
+{ return GetExecutorIOPoolSize_ABI(n, 0); }
+
+static inline int
+SetExecutorAffinity(const int *cpus, size_t n)
+{ return SetExecutorAffinity_ABI(cpus, n, 0); }
+
+static inline int
+GetExecutorThreadCount(unsigned int *n)
+{ return GetExecutorThreadCount_ABI(n, 0); }
+
+static inline int
+ExecutorPost( void(*func)(void*), void(*release)(void*), void* arg, int io )
+{ return ExecutorPost_ABI(func, release, arg, io, 0); }
+
+static inline int
+ExecutorPostAfter( long long msec,
+                   void(*func)(void*),
+                   void(*release)(void*),
+                   void* arg,
+                   int io,
+                   unsigned long long *id )
+{ return ExecutorPostAfter_ABI(msec, func, release, arg, io, id, 0); }
+
+static inline int
+ExecutorPostEvery( long long msec,
+                   void(*func)(void*),
+                   void(*release)(void*),
+                   void* arg,
+                   int io,
+                   unsigned long long *id )
+{ return ExecutorPostEvery_ABI(msec, func, release, arg, io, id, 0); }
+
+static inline int
+ExecutorCancel(unsigned long long id, int *cancelled)
+{ return ExecutorCancel_ABI(id, cancelled, 0); }
+
 /* DEPRECATED */ static inline int
 GetDefaultCertificateBundlePath(char **path, size_t *n )
 { return GetDefaultCertificateBundlePath_ABI(path, n, 0); }
@@ -514,7 +689,8 @@ struct IsValidCProxy<ProxyTy, void>{
         || IsValidCProxy<ProxyTy, StreamingSubscription_C>::value
         || IsValidCProxy<ProxyTy, StreamingSession_C>::value
         || IsValidCProxy<ProxyTy, OrderLeg_C>::value
-        || IsValidCProxy<ProxyTy, OrderTicket_C>::value;
+        || IsValidCProxy<ProxyTy, OrderTicket_C>::value
+        || IsValidCProxy<ProxyTy, StreamingSubscriber_C>::value;
 };
 
 template<typename ProxyTy>
@@ -524,7 +700,8 @@ struct IsCProxyBase{
         || std::is_same<ProxyTy, StreamingSubscription_C>::value
         || std::is_same<ProxyTy, StreamingSession_C>::value
         || std::is_same<ProxyTy, OrderLeg_C>::value
-        || std::is_same<ProxyTy, OrderTicket_C>::value;
+        || std::is_same<ProxyTy, OrderTicket_C>::value
+        || std::is_same<ProxyTy, StreamingSubscriber_C>::value;
 };
 
 template<typename F, typename... Args>
@@ -632,6 +809,141 @@ GetCertificateBundlePath()
 GetDefaultCertificateBundlePath()
 { return str_from_abi_vargs(GetDefaultCertificateBundlePath_ABI, ALLOW_EXCEPTIONS); }
 
+/*
+ * share refreshed access tokens w/ other processes through the file at
+ * 'path' (e.g. next to the credentials file); "" to disable
+ */
+inline void
+SetSharedTokenStore(const std::string& path)
+{ call_abi( SetSharedTokenStore_ABI, path.c_str() ); }
+
+inline std::string
+GetSharedTokenStore()
+{ return str_from_abi_vargs(GetSharedTokenStore_ABI, ALLOW_EXCEPTIONS); }
+
+/*
+ * flight recorder: the last events(requests, frames, subscriptions etc.) of
+ * each library thread, written to 'path' on connection/server/streaming
+ * errors, on 'signum', or by DumpFlightRecorder ("" for the path that was
+ * set); "", 0 to disable. (see tools/flight_decode.py)
+ */
+inline void
+SetFlightRecorderPath(const std::string& path)
+{ call_abi( SetFlightRecorderPath_ABI, path.c_str() ); }
+
+inline std::string
+GetFlightRecorderPath()
+{ return str_from_abi_vargs(GetFlightRecorderPath_ABI, ALLOW_EXCEPTIONS); }
+
+inline void
+SetFlightRecorderSignal(int signum)
+{ call_abi( SetFlightRecorderSignal_ABI, signum ); }
+
+inline void
+DumpFlightRecorder(const std::string& path = "")
+{ call_abi( DumpFlightRecorder_ABI, path.c_str() ); }
+
+/*
+ * executor: all library threads come from a thread pool (default: # of
+ * cores, max 4), an I/O pool for blocking calls (default 4), and dedicated
+ * threads for the socket/listener loops; all are pinned to 'cpus' (empty
+ * to unpin).
+ *
+ * ExecutorPost* run 'func' on the pool or (if 'io') the I/O pool; after
+ * 'delay' or every 'period' (returns an id for ExecutorCancel).
+ */
+inline void
+SetExecutorPoolSize(unsigned int n)
+{ call_abi( SetExecutorPoolSize_ABI, n ); }
+
+inline unsigned int
+GetExecutorPoolSize()
+{
+    unsigned int n;
+    call_abi( GetExecutorPoolSize_ABI, &n );
+    return n;
+}
+
+inline void
+SetExecutorIOPoolSize(unsigned int n)
+{ call_abi( SetExecutorIOPoolSize_ABI, n ); }
+
+inline unsigned int
+GetExecutorIOPoolSize()
+{
+    unsigned int n;
+    call_abi( GetExecutorIOPoolSize_ABI, &n );
+    return n;
+}
+
+inline void
+SetExecutorAffinity(const std::vector<int>& cpus)
+{ call_abi( SetExecutorAffinity_ABI, cpus.data(), cpus.size() ); }
+
+inline unsigned int
+GetExecutorThreadCount()
+{
+    unsigned int n;
+    call_abi( GetExecutorThreadCount_ABI, &n );
+    return n;
+}
+
+namespace detail {
+
+inline void
+executor_call(void *f)
+{ (*static_cast<std::function<void()>*>(f))(); }
+
+inline void
+executor_release(void *f)
+{ delete static_cast<std::function<void()>*>(f); }
+
+} /* detail */
+
+inline void
+ExecutorPost(std::function<void()> func, bool io = false)
+{
+    call_abi( ExecutorPost_ABI, detail::executor_call,
+              detail::executor_release,
+              static_cast<void*>(new std::function<void()>(std::move(func))),
+              io ? 1 : 0 );
+}
+
+inline unsigned long long
+ExecutorPostAfter( std::chrono::milliseconds delay,
+                   std::function<void()> func,
+                   bool io = false )
+{
+    unsigned long long id = 0;
+    call_abi( ExecutorPostAfter_ABI, static_cast<long long>(delay.count()),
+              detail::executor_call, detail::executor_release,
+              static_cast<void*>(new std::function<void()>(std::move(func))),
+              io ? 1 : 0, &id );
+    return id;
+}
+
+inline unsigned long long
+ExecutorPostEvery( std::chrono::milliseconds period,
+                   std::function<void()> func,
+                   bool io = false )
+{
+    unsigned long long id = 0;
+    call_abi( ExecutorPostEvery_ABI, static_cast<long long>(period.count()),
+              detail::executor_call, detail::executor_release,
+              static_cast<void*>(new std::function<void()>(std::move(func))),
+              io ? 1 : 0, &id );
+    return id;
+}
+
+/* false if it already ran(one-shot) or was cancelled */
+inline bool
+ExecutorCancel(unsigned long long id)
+{
+    int cancelled = 0;
+    call_abi( ExecutorCancel_ABI, id, &cancelled );
+    return cancelled != 0;
+}
+
 inline int
 LastErrorCode()
 {
@@ -1054,7 +1366,7 @@ set_of_strs_from_abi( int(*abicall)(CTy*, char***, size_t*, int), CTy *cty )
         while(n--){
             char *c = buf[n];
             assert(c);
-            strs.insert(c);
+            strs.emplace_hint(strs.begin(), c); // usually sorted
             free(c);
         }
         free(buf);
@@ -1088,7 +1400,7 @@ set_of_fields_from_abi( int(*abicall)(CTy*, int**, size_t*,int), CTy *cty )
     call_abi( abicall, cty, &f, &n );
     std::set<FTy> ret;
     while( n-- )
-        ret.insert( static_cast<FTy>(f[n]) );
+        ret.emplace_hint( ret.begin(), static_cast<FTy>(f[n]) ); // sorted
     call_abi( FreeFieldsBuffer_ABI, f );
     return ret;
 }
@@ -146,6 +146,25 @@ join(const C<A, B...>& container, char j)
     return s.erase(s.size() - 1);
 }
 
+// strings don't need the stringstream (e.g 1000s of symbols)
+template< template<typename T, typename... V> class C, typename...B >
+std::string
+join(const C<std::string, B...>& container, char j)
+{
+    size_t n = 0;
+    for(auto& e : container)
+        n += e.size() + 1;
+    std::string s;
+    s.reserve(n);
+    for(auto& e : container){
+        s += e;
+        s.push_back(j);
+    }
+    if( !s.empty() )
+        s.pop_back();
+    return s;
+}
+
 
 template<typename ClockTy>
 std::chrono::milliseconds
@@ -177,6 +196,10 @@ toupper(const C<A, B...>& container)
 
 using std::toupper;
 
+inline size_t
+hash_combine(size_t seed, size_t h)
+{ return seed ^ (h + 0x9e3779b9 + (seed << 6) + (seed >> 2)); }
+
 template<typename ToTy, typename FromTy>
 std::set<ToTy> // not safe
 buffers_to_set(FromTy *buffers, size_t n)
@@ -200,6 +223,19 @@ buffers_to_set(const char **buffers, size_t n)
     return s;
 }
 
+inline std::vector<std::string> // not safe
+buffers_to_vector(const char **buffers, size_t n)
+{
+    std::vector<std::string> v;
+    v.reserve(n);
+    for( size_t i = 0; i < n; ++i ){
+        const char* c = buffers[i];
+        assert(c);
+        v.emplace_back(c);
+    }
+    return v;
+}
+
 class IOStreamFormatGuard{
     std::iostream& _stream;
     std::ios _state;
@@ -57,6 +57,7 @@ class WebSocketClient{
 
     uWS::Hub _hub;
     std::string _url;
+    bool _external_loop;
     uS::Async *_signal;
     std::thread _thread;
     ThreadSafeQueue<std::string> _in_queue; // in from server
@@ -74,6 +75,11 @@ class WebSocketClient{
     };
     volatile CloseType _closing_state;
 
+    /* external loop: run it on this thread until pred() or 'timeout' */
+    void
+    _run_loop_until( std::chrono::milliseconds timeout,
+                     std::function<bool()> pred );
+
     struct SocketThreadTarget{
         WebSocketClient *_wsc;
         std::chrono::milliseconds _timeout;
@@ -95,7 +101,22 @@ class WebSocketClient{
     };
 
 public:
-    WebSocketClient(std::string url);
+    /*
+     * external_loop: no socket thread; the caller polls event_fd() and
+     * calls process_events() (and everything else) from one thread. The
+     * blocking calls (connect, close, recv..._wait...) run the loop
+     * themselves while they wait.
+     */
+    WebSocketClient(std::string url, bool external_loop = false);
+
+    /* (epoll backend) clients created after this poll their socket w/
+       io_uring instead of epoll, if the kernel supports it */
+    static void
+    set_use_io_uring(bool use_io_uring);
+
+    /* if clients created now will use io_uring */
+    static bool
+    uses_io_uring();
 
     WebSocketClient( const WebSocketClient& ) = delete;
 
@@ -111,6 +132,29 @@ public:
     bool
     is_connected() const;
 
+    bool
+    is_external_loop() const
+    { return _external_loop; }
+
+    /* (external loop) readable when process_events() has work */
+    int
+    event_fd();
+
+    /* (external loop) poll events to wait for on event_fd() */
+    int
+    poll_events() const;
+
+    /* (external loop) msec until process_events() should be called
+       regardless of event_fd(), -1 if no deadline */
+    long long
+    next_timeout();
+
+    /* (external loop) handle ready events, waiting up to 'wait' for them;
+       false once the socket (and loop) are closed */
+    bool
+    process_events(std::chrono::milliseconds wait
+                       = std::chrono::milliseconds(0));
+
     void
     close(bool graceful=true);
 
@@ -220,4 +220,17 @@ public class Auth {
         return CLib.Helpers.getString( TDAmeritradeAPI.getCLib()::GetDefaultCertificateBundlePath_ABI);   
     }
     
+    /* share refreshed access tokens w/ other processes; null or "" to disable */
+    public static void
+    setSharedTokenStore(String path) throws CLibException {
+        int err = TDAmeritradeAPI.getCLib().SetSharedTokenStore_ABI(path, 0);
+        if( err != 0 )
+            throw new CLibException(err);
+    }
+    
+    public static String
+    getSharedTokenStore() throws CLibException {
+        return CLib.Helpers.getString( TDAmeritradeAPI.getCLib()::GetSharedTokenStore_ABI);   
+    }
+    
 }
@@ -542,6 +542,39 @@ public interface CLib extends Library {
         public KeyValPair(Pointer p) { super(p); read(); }
         
     }
+    
+    public static class SpreadQuote extends Structure {
+        public double bid;
+        public double ask;
+        public double mid;
+        public long timestamp;
+        public int isValid;
+        
+        @Override
+        protected List<String> 
+        getFieldOrder() { 
+            return new ArrayList<String>(Arrays.asList("bid", "ask", "mid", "timestamp", "isValid")); 
+        }  
+   
+        public SpreadQuote() { super(); }
+    }
+    
+    public static class IVSurfaceGreeks extends Structure {
+        public double volatility;
+        public double delta;
+        public double gamma;
+        public double theta;
+        public double vega;
+        
+        @Override
+        protected List<String> 
+        getFieldOrder() { 
+            return new ArrayList<String>(Arrays.asList("volatility", "delta", "gamma", 
+                    "theta", "vega")); 
+        }  
+   
+        public IVSurfaceGreeks() { super(); }
+    }
 
     
     public class OptionStrikesValue extends Union {
@@ -595,6 +628,8 @@ public interface CLib extends Library {
     int StreamingCallbackType_to_string_ABI( int service, PointerByReference buffer, size_t[] n, int exc);
     int CommandType_to_string_ABI( int service, PointerByReference buffer, size_t[] n, int exc);
     int QOSType_to_string_ABI( int service, PointerByReference buffer, size_t[] n, int exc); 
+    int StreamingFilterRuleType_to_string_ABI( int service, PointerByReference buffer, size_t[] n, int exc);
+    int SocketBackendType_to_string_ABI( int service, PointerByReference buffer, size_t[] n, int exc);
     int QuotesSubscriptionField_to_string_ABI( int service, PointerByReference buffer, size_t[] n, int exc);
     int OptionsSubscriptionField_to_string_ABI( int service, PointerByReference buffer, size_t[] n, int exc); 
     int ChartEquitySubscriptionField_to_string_ABI( int service, PointerByReference buffer, size_t[] n, int exc );
@@ -634,11 +669,23 @@ public interface CLib extends Library {
     int SetCertificateBundlePath_ABI( String path, int exc );
     int GetCertificateBundlePath_ABI( PointerByReference buffer, size_t[] n, int exc );
     int GetDefaultCertificateBundlePath_ABI( PointerByReference buffer, size_t[] n, int exc );
+    int SetSharedTokenStore_ABI( String path, int exc );
+    int GetSharedTokenStore_ABI( PointerByReference buffer, size_t[] n, int exc );
         
     /* MISC */
     int BuildOptionSymbol_ABI( String underlying, int month, int day, int year, int is_call, 
             double strike, PointerByReference buffer, size_t[] n, int exc);    
     int CheckOptionSymbol_ABI( String symbol, int exc );
+    int SetFlightRecorderPath_ABI( String path, int exc );
+    int GetFlightRecorderPath_ABI( PointerByReference buffer, size_t[] n, int exc );
+    int SetFlightRecorderSignal_ABI( int signum, int exc );
+    int DumpFlightRecorder_ABI( String path, int exc );
+    int SetExecutorPoolSize_ABI( int n, int exc );
+    int GetExecutorPoolSize_ABI( int[] n, int exc );
+    int SetExecutorIOPoolSize_ABI( int n, int exc );
+    int GetExecutorIOPoolSize_ABI( int[] n, int exc );
+    int SetExecutorAffinity_ABI( int[] cpus, size_t n, int exc );
+    int GetExecutorThreadCount_ABI( int[] n, int exc );
 
     
     /*
@@ -911,11 +958,54 @@ public interface CLib extends Library {
     int StreamingSession_IsActive_ABI( _StreamingSession_C pSession, int[] b, int exc);
     int StreamingSession_GetQOS_ABI( _StreamingSession_C pSession, int[] qos, int exc);
     int StreamingSession_SetQOS_ABI( _StreamingSession_C pSession, int qos, int[] result, int exc);
+    int StreamingSession_SetExternalLoop_ABI( _StreamingSession_C pSession, int externalLoop, int exc);
+    int StreamingSession_IsExternalLoop_ABI( _StreamingSession_C pSession, int[] externalLoop, int exc);
+    int StreamingSession_GetEventFd_ABI( _StreamingSession_C pSession, int[] fd, int[] events, int exc);
+    int StreamingSession_GetNextTimeout_ABI( _StreamingSession_C pSession, long[] msec, int exc);
+    int StreamingSession_ProcessEvents_ABI( _StreamingSession_C pSession, long waitMsec, int[] isListening, int exc);
+    int SetStreamingSocketBackend_ABI( int backend, int exc);
+    int GetStreamingSocketBackend_ABI( int[] backend, int exc);
+    int StreamingSession_SetFilterSymbols_ABI( _StreamingSession_C pSession, int service,
+            String[] symbols, size_t n, int exc);
+    int StreamingSession_AddFilterRule_ABI( _StreamingSession_C pSession, int service, int field,
+            int ruleType, double value, int exc);
+    int StreamingSession_ClearFilter_ABI( _StreamingSession_C pSession, int service, int exc);
+    int StreamingSession_GetFilterStats_ABI( _StreamingSession_C pSession, int service,
+            long[] nPassed, long[] nDropped, int exc);
+    int StreamingSession_AddRoute_ABI( _StreamingSession_C pSession, int service,
+            String[] symbols, size_t n, StreamingSession._CallbackWrapper callback, int[] id,
+            int exc);
+    int StreamingSession_RemoveRoute_ABI( _StreamingSession_C pSession, int id, int exc);
+    int StreamingSession_ClearRoutes_ABI( _StreamingSession_C pSession, int exc);
+    int StreamingSession_AddSpread_ABI( _StreamingSession_C pSession, String[] symbols,
+            int[] ratios, size_t n, int[] id, int exc);
+    int StreamingSession_RemoveSpread_ABI( _StreamingSession_C pSession, int id, int exc);
+    int StreamingSession_GetSpreadQuote_ABI( _StreamingSession_C pSession, int id, 
+            SpreadQuote quote, int exc);
+    int StreamingSession_SetSpreadCallback_ABI( _StreamingSession_C pSession,
+            StreamingSession._SpreadCallbackWrapper callback, int exc);
+    int StreamingSession_SeedIVSurface_ABI( _StreamingSession_C pSession, String optionChain,
+            int exc);
+    int StreamingSession_SetIVSurfaceRefitInterval_ABI( _StreamingSession_C pSession, 
+            long msec, int exc);
+    int StreamingSession_GetIVSurfaceRefitInterval_ABI( _StreamingSession_C pSession, 
+            long[] msec, int exc);
+    int StreamingSession_SetIVSurfaceEnabled_ABI( _StreamingSession_C pSession, int enabled,
+            int exc);
+    int StreamingSession_IsIVSurfaceEnabled_ABI( _StreamingSession_C pSession, int[] enabled,
+            int exc);
+    int StreamingSession_RefitIVSurface_ABI( _StreamingSession_C pSession, int exc);
+    int StreamingSession_GetIVSurfaceVol_ABI( _StreamingSession_C pSession, String underlying,
+            double strike, double daysToExpiration, double[] vol, int exc);
+    int StreamingSession_GetIVSurfaceGreeks_ABI( _StreamingSession_C pSession, String underlying,
+            double strike, double daysToExpiration, int isCall, IVSurfaceGreeks greeks, int exc);
     
     /* STREAMING SUBCRIPTION (BASE) */
     int StreamingSubscription_Destroy_ABI( _StreamingSubscription_C pSubscription, int exc );
     int StreamingSubscription_IsSame_ABI( _StreamingSubscription_C lSubscription, 
             _StreamingSubscription_C rSubscription, int[] b, int exc );
+    int StreamingSubscription_Hash_ABI( _StreamingSubscription_C pSubscription, 
+            size_t[] hash, int exc );
     
     /* RAW SUBSCRIPTION */
     int RawSubscription_Create_ABI( String service, String command, KeyValPair[] kvPairs, size_t n, 
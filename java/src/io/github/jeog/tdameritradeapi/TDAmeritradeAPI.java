@@ -172,6 +172,72 @@ public final class TDAmeritradeAPI {
         if( err != 0 )
             throw new CLibException(err);        
     }
+    
+    /* where the flight recorder dumps on connection/server/streaming errors
+       and on the signal set w/ setFlightRecorderSignal; null or "" to disable */
+    public static void
+    setFlightRecorderPath(String path) throws CLibException {
+        int err = getCLib().SetFlightRecorderPath_ABI(path, 0);
+        if( err != 0 )
+            throw new CLibException(err);
+    }
+    
+    public static String
+    getFlightRecorderPath() throws CLibException {
+        return CLib.Helpers.getString( getCLib()::GetFlightRecorderPath_ABI );
+    }
+    
+    /* 0 to disable */
+    public static void
+    setFlightRecorderSignal(int signum) throws CLibException {
+        int err = getCLib().SetFlightRecorderSignal_ABI(signum, 0);
+        if( err != 0 )
+            throw new CLibException(err);
+    }
+    
+    /* null or "" to use the path that was set */
+    public static void
+    dumpFlightRecorder(String path) throws CLibException {
+        int err = getCLib().DumpFlightRecorder_ABI(path, 0);
+        if( err != 0 )
+            throw new CLibException(err);
+    }
+    
+    /* all library threads come from a thread pool (default # of cores,
+       max 4), an I/O pool for blocking calls (default 4), and dedicated
+       threads for the socket/listener loops */
+    public static void
+    setExecutorPoolSize(int n) throws CLibException {
+        CLib.Helpers.setInt( n, getCLib()::SetExecutorPoolSize_ABI );
+    }
+    
+    public static int
+    getExecutorPoolSize() throws CLibException {
+        return CLib.Helpers.getInt( getCLib()::GetExecutorPoolSize_ABI );
+    }
+    
+    public static void
+    setExecutorIOPoolSize(int n) throws CLibException {
+        CLib.Helpers.setInt( n, getCLib()::SetExecutorIOPoolSize_ABI );
+    }
+    
+    public static int
+    getExecutorIOPoolSize() throws CLibException {
+        return CLib.Helpers.getInt( getCLib()::GetExecutorIOPoolSize_ABI );
+    }
+    
+    /* pin all library threads (incl. those running); empty to unpin */
+    public static void
+    setExecutorAffinity(int[] cpus) throws CLibException {
+        int err = getCLib().SetExecutorAffinity_ABI(cpus, new size_t(cpus.length), 0);
+        if( err != 0 )
+            throw new CLibException(err);
+    }
+    
+    public static int
+    getExecutorThreadCount() throws CLibException {
+        return CLib.Helpers.getInt( getCLib()::GetExecutorThreadCount_ABI );
+    }
  
     
     public static int
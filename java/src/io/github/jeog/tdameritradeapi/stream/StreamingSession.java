@@ -19,7 +19,13 @@ package io.github.jeog.tdameritradeapi.stream;
 
 import java.util.ArrayList;
 import java.util.Arrays;
+import java.util.HashMap;
+import java.util.HashSet;
 import java.util.List;
+import java.util.Map;
+import java.util.Set;
+
+import org.json.JSONObject;
 
 import com.sun.jna.Pointer;
 
@@ -33,6 +39,7 @@ public class StreamingSession implements AutoCloseable {
     public static final long DEF_CONNECT_TIMEOUT = 3000;
     public static final long DEF_LISTENING_TIMEOUT = 30000;
     public static final long DEF_SUBSCRIBE_TIMEOUT = 1500;
+    public static final long IV_SURFACE_DEF_REFIT_INTERVAL = 250;
 
     public static interface Callback {
         public void 
@@ -51,6 +58,70 @@ public class StreamingSession implements AutoCloseable {
             callback.call(serviceType, callbackType, timestamp, data);
         }
     } 
+    
+    public static interface SpreadCallback {
+        public void 
+        call(int spreadID, double bid, double ask, double mid, long timestamp);
+    }
+    
+    public static class _SpreadCallbackWrapper implements com.sun.jna.Callback {
+        private SpreadCallback callback;
+        
+        public _SpreadCallbackWrapper(SpreadCallback callback) {
+            this.callback = callback;
+        }
+        
+        public void 
+        call(int spreadID, double bid, double ask, double mid, long timestamp) {
+            callback.call(spreadID, bid, ask, mid, timestamp);
+        }
+    } 
+    
+    // bid/ask are 'natural': long legs at the bid/ask, short legs at the ask/bid
+    public static class SpreadQuote {
+        public final double bid;
+        public final double ask;
+        public final double mid;
+        public final long timestamp;
+        
+        private SpreadQuote(CLib.SpreadQuote q) {
+            bid = q.bid;
+            ask = q.ask;
+            mid = q.mid;
+            timestamp = q.timestamp;
+        }
+        
+        @Override
+        public String
+        toString() {
+            return "SpreadQuote{bid=" + bid + ", ask=" + ask + ", mid=" + mid 
+                    + ", timestamp=" + timestamp + "}";
+        }
+    }
+    
+    // volatility in percent, theta per day, vega per vol point
+    public static class IVSurfaceGreeks {
+        public final double volatility;
+        public final double delta;
+        public final double gamma;
+        public final double theta;
+        public final double vega;
+        
+        private IVSurfaceGreeks(CLib.IVSurfaceGreeks g) {
+            volatility = g.volatility;
+            delta = g.delta;
+            gamma = g.gamma;
+            theta = g.theta;
+            vega = g.vega;
+        }
+        
+        @Override
+        public String
+        toString() {
+            return "IVSurfaceGreeks{volatility=" + volatility + ", delta=" + delta 
+                    + ", gamma=" + gamma + ", theta=" + theta + ", vega=" + vega + "}";
+        }
+    }
 
     
     public enum ServiceType implements CLib.ConvertibleEnum {
@@ -205,8 +276,67 @@ public class StreamingSession implements AutoCloseable {
         }
     };
     
+    public enum FilterRuleType implements CLib.ConvertibleEnum {
+        CHANGED(0), // field is in the update
+        DELTA(1),   // field moved >= value since the last update that passed
+        CROSS(2);   // field crossed the level 'value'
+                
+        private int value;
+        
+        FilterRuleType(int value){ this.value = value; }   
+        
+        @Override
+        public int toInt() { return value; }
+        
+        public static FilterRuleType
+        fromInt(int i) {
+            for(FilterRuleType ss : FilterRuleType.values()) {
+                if(ss.toInt() == i)
+                    return ss;
+            }
+            return null;
+        }  
+        
+        @Override
+        public String
+        toString() {
+            return CLib.Helpers.convertibleEnumToString( this,
+                    TDAmeritradeAPI.getCLib()::StreamingFilterRuleType_to_string_ABI);
+        }
+    };
+    
+    public enum SocketBackendType implements CLib.ConvertibleEnum {
+        EPOLL(0),
+        IO_URING(1); // falls back to EPOLL if unsupported
+                
+        private int value;
+        
+        SocketBackendType(int value){ this.value = value; }   
+        
+        @Override
+        public int toInt() { return value; }
+        
+        public static SocketBackendType
+        fromInt(int i) {
+            for(SocketBackendType ss : SocketBackendType.values()) {
+                if(ss.toInt() == i)
+                    return ss;
+            }
+            return null;
+        }  
+        
+        @Override
+        public String
+        toString() {
+            return CLib.Helpers.convertibleEnumToString( this,
+                    TDAmeritradeAPI.getCLib()::SocketBackendType_to_string_ABI);
+        }
+    };
+    
     private CLib._StreamingSession_C pSession; 
     private _CallbackWrapper callback;
+    private _SpreadCallbackWrapper spreadCallback; // keep a reference while native has it
+    private Map<Integer, _CallbackWrapper> routeCallbacks = new HashMap<>(); // by route id
     
     public StreamingSession( Credentials creds, Callback callback, String accountID,
             long connectTimeout, long listeningTimeout, long subscribeTimeout ) throws CLibException{
@@ -287,6 +417,275 @@ public class StreamingSession implements AutoCloseable {
         return (b[0] == 1);
     }
     
+    /* before start(): run on the caller's event loop (wait on getEventFd(),
+       or getNextTimeout() msec, then processEvents()) instead of library
+       threads; all calls must then come from that thread */
+    public void
+    setExternalLoop( boolean externalLoop ) throws CLibException {
+        int err = TDAmeritradeAPI.getCLib().StreamingSession_SetExternalLoop_ABI(
+                pSession, externalLoop ? 1 : 0, 0);
+        if(err != 0)
+            throw new CLibException(err);
+    }
+    
+    /* how the socket of sessions started after is polled (Linux only) */
+    public static void
+    setSocketBackend( SocketBackendType backend ) throws CLibException {
+        CLib.Helpers.setInt( backend.toInt(),
+                TDAmeritradeAPI.getCLib()::SetStreamingSocketBackend_ABI );
+    }
+    
+    /* the backend sessions started now will use */
+    public static SocketBackendType
+    getSocketBackend() throws CLibException {
+        return SocketBackendType.fromInt( CLib.Helpers.getInt(
+                TDAmeritradeAPI.getCLib()::GetStreamingSocketBackend_ABI) );
+    }
+    
+    public boolean
+    isExternalLoop() throws CLibException {
+        return CLib.Helpers.getInt(pSession,
+                TDAmeritradeAPI.getCLib()::StreamingSession_IsExternalLoop_ABI) == 1;
+    }
+    
+    // {fd, poll events}
+    public int[]
+    getEventFd() throws CLibException {
+        int[] fd = {-1};
+        int[] events = {0};
+        int err = TDAmeritradeAPI.getCLib().StreamingSession_GetEventFd_ABI(
+                pSession, fd, events, 0);
+        if(err != 0)
+            throw new CLibException(err);
+        return new int[]{fd[0], events[0]};
+    }
+    
+    // -1 if no deadline
+    public long
+    getNextTimeout() throws CLibException {
+        long[] msec = {-1};
+        int err = TDAmeritradeAPI.getCLib().StreamingSession_GetNextTimeout_ABI(
+                pSession, msec, 0);
+        if(err != 0)
+            throw new CLibException(err);
+        return msec[0];
+    }
+    
+    // false once the session has stopped listening
+    public boolean
+    processEvents( long waitMsec ) throws CLibException {
+        int[] b = {0};
+        int err = TDAmeritradeAPI.getCLib().StreamingSession_ProcessEvents_ABI(
+                pSession, waitMsec, b, 0);
+        if(err != 0)
+            throw new CLibException(err);
+        return (b[0] == 1);
+    }
+    
+    // empty set for all symbols
+    public void
+    setFilterSymbols( ServiceType service, Set<String> symbols ) throws CLibException {
+        int err = TDAmeritradeAPI.getCLib().StreamingSession_SetFilterSymbols_ABI(pSession, 
+                service.toInt(), CLib.Helpers.symbolsToStrings(symbols), 
+                new CLib.size_t(symbols.size()), 0);
+        if(err != 0)
+            throw new CLibException(err);
+    }
+    
+    // 'field' is the subscription's FieldType, e.g. QuotesSubscription.FieldType
+    public void
+    addFilterRule( ServiceType service, CLib.ConvertibleEnum field, FilterRuleType ruleType,
+            double value ) throws CLibException {
+        int err = TDAmeritradeAPI.getCLib().StreamingSession_AddFilterRule_ABI(pSession, 
+                service.toInt(), field.toInt(), ruleType.toInt(), value, 0);
+        if(err != 0)
+            throw new CLibException(err);
+    }
+    
+    public void
+    addFilterRule( ServiceType service, CLib.ConvertibleEnum field, FilterRuleType ruleType )
+            throws CLibException {
+        addFilterRule(service, field, ruleType, 0);
+    }
+    
+    // ServiceType.NONE for all
+    public void
+    clearFilter( ServiceType service ) throws CLibException {
+        int err = TDAmeritradeAPI.getCLib().StreamingSession_ClearFilter_ABI(pSession, 
+                service.toInt(), 0);
+        if(err != 0)
+            throw new CLibException(err);
+    }
+    
+    // {passed, dropped}
+    public long[]
+    getFilterStats( ServiceType service ) throws CLibException {
+        long[] p = {0};
+        long[] d = {0};
+        int err = TDAmeritradeAPI.getCLib().StreamingSession_GetFilterStats_ABI(pSession, 
+                service.toInt(), p, d, 0);
+        if(err != 0)
+            throw new CLibException(err);
+        return new long[]{p[0], d[0]};
+    }
+    
+    /* 
+     * 'service' data for 'symbols' (empty set for all of it) goes to 'callback' instead
+     * of the session's callback, which gets what no route takes; returns the route id
+     */
+    public int
+    addRoute( ServiceType service, Set<String> symbols, Callback callback ) throws CLibException {
+        _CallbackWrapper w = new _CallbackWrapper(callback);
+        int[] id = {0};
+        int err = TDAmeritradeAPI.getCLib().StreamingSession_AddRoute_ABI(pSession, 
+                service.toInt(), CLib.Helpers.symbolsToStrings(symbols), 
+                new CLib.size_t(symbols.size()), w, id, 0);
+        if(err != 0)
+            throw new CLibException(err);
+        routeCallbacks.put(id[0], w);
+        return id[0];
+    }
+    
+    public int
+    addRoute( ServiceType service, Callback callback ) throws CLibException {
+        return addRoute(service, new HashSet<String>(), callback);
+    }
+    
+    public void
+    removeRoute( int routeID ) throws CLibException {
+        int err = TDAmeritradeAPI.getCLib().StreamingSession_RemoveRoute_ABI(pSession, 
+                routeID, 0);
+        if(err != 0)
+            throw new CLibException(err);
+        routeCallbacks.remove(routeID);
+    }
+    
+    public void
+    clearRoutes() throws CLibException {
+        int err = TDAmeritradeAPI.getCLib().StreamingSession_ClearRoutes_ABI(pSession, 0);
+        if(err != 0)
+            throw new CLibException(err);
+        routeCallbacks.clear();
+    }
+    
+    // {symbol: ratio} - ratio > 0 long, < 0 short; returns the spread id
+    public int
+    addSpread( Map<String, Integer> legs ) throws CLibException {
+        String[] symbols = new String[legs.size()];
+        int[] ratios = new int[legs.size()];
+        int i = 0;
+        for( Map.Entry<String, Integer> e : legs.entrySet() ) {
+            symbols[i] = e.getKey();
+            ratios[i++] = e.getValue();
+        }
+        int[] id = {0};
+        int err = TDAmeritradeAPI.getCLib().StreamingSession_AddSpread_ABI(pSession, 
+                symbols, ratios, new CLib.size_t(symbols.length), id, 0);
+        if(err != 0)
+            throw new CLibException(err);
+        return id[0];
+    }
+    
+    public void
+    removeSpread( int spreadID ) throws CLibException {
+        int err = TDAmeritradeAPI.getCLib().StreamingSession_RemoveSpread_ABI(pSession, 
+                spreadID, 0);
+        if(err != 0)
+            throw new CLibException(err);
+    }
+    
+    // null until every leg has a bid and ask
+    public SpreadQuote
+    getSpreadQuote( int spreadID ) throws CLibException {
+        CLib.SpreadQuote q = new CLib.SpreadQuote();
+        int err = TDAmeritradeAPI.getCLib().StreamingSession_GetSpreadQuote_ABI(pSession, 
+                spreadID, q, 0);
+        if(err != 0)
+            throw new CLibException(err);
+        return q.isValid != 0 ? new SpreadQuote(q) : null;
+    }
+    
+    // null to remove
+    public void
+    setSpreadCallback( SpreadCallback callback ) throws CLibException {
+        _SpreadCallbackWrapper w = callback != null ? new _SpreadCallbackWrapper(callback) : null;
+        int err = TDAmeritradeAPI.getCLib().StreamingSession_SetSpreadCallback_ABI(pSession, 
+                w, 0);
+        if(err != 0)
+            throw new CLibException(err);
+        spreadCallback = w;
+    }
+    
+    // off until enabled or seeded; disabling drops the surface
+    public void
+    setIVSurfaceEnabled( boolean enabled ) throws CLibException {
+        CLib.Helpers.setInt(pSession, enabled ? 1 : 0,
+                TDAmeritradeAPI.getCLib()::StreamingSession_SetIVSurfaceEnabled_ABI);
+    }
+    
+    public boolean
+    isIVSurfaceEnabled() throws CLibException {
+        return CLib.Helpers.getInt(pSession,
+                TDAmeritradeAPI.getCLib()::StreamingSession_IsIVSurfaceEnabled_ABI) == 1;
+    }
+    
+    // the result of OptionChainGetter.get(); enables the surface
+    public void
+    seedIVSurface( JSONObject optionChain ) throws CLibException {
+        int err = TDAmeritradeAPI.getCLib().StreamingSession_SeedIVSurface_ABI(pSession, 
+                optionChain.toString(), 0);
+        if(err != 0)
+            throw new CLibException(err);
+    }
+    
+    public void
+    setIVSurfaceRefitInterval( long msec ) throws CLibException {
+        int err = TDAmeritradeAPI.getCLib().StreamingSession_SetIVSurfaceRefitInterval_ABI(
+                pSession, msec, 0);
+        if(err != 0)
+            throw new CLibException(err);
+    }
+    
+    public long
+    getIVSurfaceRefitInterval() throws CLibException {
+        long[] msec = {0};
+        int err = TDAmeritradeAPI.getCLib().StreamingSession_GetIVSurfaceRefitInterval_ABI(
+                pSession, msec, 0);
+        if(err != 0)
+            throw new CLibException(err);
+        return msec[0];
+    }
+    
+    public void
+    refitIVSurface() throws CLibException {
+        int err = TDAmeritradeAPI.getCLib().StreamingSession_RefitIVSurface_ABI(pSession, 0);
+        if(err != 0)
+            throw new CLibException(err);
+    }
+    
+    // percent
+    public double
+    getIVSurfaceVol( String underlying, double strike, double daysToExpiration )
+            throws CLibException {
+        double[] v = {0};
+        int err = TDAmeritradeAPI.getCLib().StreamingSession_GetIVSurfaceVol_ABI(pSession, 
+                underlying, strike, daysToExpiration, v, 0);
+        if(err != 0)
+            throw new CLibException(err);
+        return v[0];
+    }
+    
+    public IVSurfaceGreeks
+    getIVSurfaceGreeks( String underlying, double strike, double daysToExpiration,
+            boolean isCall ) throws CLibException {
+        CLib.IVSurfaceGreeks g = new CLib.IVSurfaceGreeks();
+        int err = TDAmeritradeAPI.getCLib().StreamingSession_GetIVSurfaceGreeks_ABI(pSession, 
+                underlying, strike, daysToExpiration, isCall ? 1 : 0, g, 0);
+        if(err != 0)
+            throw new CLibException(err);
+        return new IVSurfaceGreeks(g);
+    }
+    
     @Override
     public void close() throws CLibException {
         stop();        
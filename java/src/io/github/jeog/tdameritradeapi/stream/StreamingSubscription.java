@@ -50,8 +50,13 @@ public class StreamingSubscription {
     
     @Override
     public int
-    hashCode() {       
-        return pSubscription.getClass().hashCode();
+    hashCode() { // NO THROW
+        CLib.size_t h[] = new CLib.size_t[1];
+        int err = TDAmeritradeAPI.getCLib().StreamingSubscription_Hash_ABI(getProxy(), h, 0);
+        if( err != 0 )
+            return pSubscription.getClass().hashCode();
+        long l = h[0].longValue();
+        return (int)(l ^ (l >>> 32));
     }
 
 }
@@ -174,6 +174,29 @@ def get_certificate_bundle_path():
     return clib.get_str('GetCertificateBundlePath_ABI')
 
 
+def set_shared_token_store(path):
+    """Share refreshed access tokens with other processes through a file.
+    
+    When several processes use the same credentials each one refreshes its
+    own access token on expiration. With a shared store(e.g. a file next to
+    the credentials file) only one process refreshes and the others pick up
+    the new token before their next request.
+    
+    def set_shared_token_store(path);
+    
+        path    ::  str  ::  path of the token store file, None to disable
+        
+        returns -> None
+        throws  -> LibraryNotLoaded, CLibException
+    """
+    clib.call('SetSharedTokenStore_ABI', clib.PCHAR(path) if path else None)
+
+
+def get_shared_token_store():
+    """Get path of the shared token store, or empty string if not in use."""
+    return clib.get_str('GetSharedTokenStore_ABI')
+
+
 class CredentialsManager:    
     """Context Manager for handling load and store of Credentials Object.
     
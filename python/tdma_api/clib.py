@@ -17,7 +17,8 @@
 
 
 from ctypes import CDLL, c_int, c_char_p, c_size_t, c_void_p, byref as REF, \
-                    POINTER, Structure as _Structure
+                    POINTER, Structure as _Structure, addressof, sizeof, \
+                    Array, c_char
 from abc import ABCMeta, abstractmethod
 
 
@@ -191,6 +192,16 @@ def free_keyval_buffer(buf, n):
     if _lib is None:
         raise LibraryNotLoaded
     _lib.FreeKeyValBuffer_ABI(buf, n, 0);
+
+def free_candles_buffer(buf):
+    if _lib is None:
+        raise LibraryNotLoaded()
+    _lib.FreeCandlesBuffer_ABI(buf, 0)
+
+def free_option_quotes_buffer(buf):
+    if _lib is None:
+        raise LibraryNotLoaded()
+    _lib.FreeOptionQuotesBuffer_ABI(buf, 0)
                
            
 def get_str(fname, obj=None):
@@ -258,6 +269,56 @@ def get_vals(fname, ty, obj=None, free=None, free_needs_sz=False):
     if free:
         free(ptr,n) if free_needs_sz else free(ptr)
     return vals
+
+
+class _LibBuffer:
+    """Frees a library-allocated buffer once nothing references it."""
+    def __init__(self, ptr, free):
+        self._ptr = ptr
+        self._free = free
+
+    def __del__(self):
+        try:
+            self._free(self._ptr)
+        except:
+            pass
+
+def get_array(fname, ty, free, obj=None):
+    """Like get_vals() w/o a python object per element.
+
+    Returns a numpy structured array (ctypes array if numpy isn't installed)
+    of 'ty' that views the library's buffer directly; the buffer is freed
+    w/ 'free' when the array (and any views of it) are collected.
+    """
+    ptr = POINTER(ty)()
+    n = c_size_t()
+    if obj:
+        call(fname, REF(obj), REF(ptr), REF(n))
+    else:
+        call(fname, REF(ptr), REF(n))
+    if n.value:
+        arr = (ty * n.value).from_address(addressof(ptr.contents))
+        arr._buffer = _LibBuffer(ptr, free)
+    else:
+        arr = (ty * 0)()
+    try:
+        import numpy
+    except ImportError:
+        return arr
+    return numpy.frombuffer(arr, _numpy_dtype(numpy, ty))
+
+def _numpy_dtype(numpy, ty):
+    # char arrays as fixed-length bytes('S'), not arrays of 'S1'
+    names, formats, offsets = [], [], []
+    for name, fty in ty._fields_:
+        names.append(name)
+        offsets.append(getattr(ty, name).offset)
+        if issubclass(fty, Array) and fty._type_ is c_char:
+            formats.append('S%d' % fty._length_)
+        else:
+            formats.append(numpy.dtype(fty))
+    return numpy.dtype({'names': names, 'formats': formats,
+                        'offsets': offsets, 'itemsize': sizeof(ty)})
     
 def to_str(fname, ty, v):
     c = c_char_p()
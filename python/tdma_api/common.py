@@ -41,3 +41,84 @@ def check_option_symbol(symbol):
     (Note, this only checks the *format* not if the option actually exists.
     """
     clib.call("CheckOptionSymbol_ABI", clib.PCHAR(symbol))
+
+
+def set_flight_recorder_path(path):
+    """Set where the flight recorder dumps automatically.
+
+    The flight recorder keeps the last events(requests, frames, 
+    subscriptions etc.) of each library thread. They're written to 'path' 
+    on connection/server/streaming errors and on the signal passed to 
+    set_flight_recorder_signal. (Decode w/ tools/flight_decode.py)
+
+    def set_flight_recorder_path(path);
+
+        path    ::  str  ::  path of the dump file, None to disable
+
+        returns -> None
+        throws  -> LibraryNotLoaded, CLibException
+    """
+    clib.call('SetFlightRecorderPath_ABI', clib.PCHAR(path) if path else None)
+
+
+def get_flight_recorder_path():
+    """Get path of the flight recorder dump, or empty string if not set."""
+    return clib.get_str('GetFlightRecorderPath_ABI')
+
+
+def set_flight_recorder_signal(signum):
+    """Dump the flight recorder on signal 'signum' (e.g signal.SIGUSR2), 0 to 
+    disable. (Note: replaces any python handler for that signal.)
+    """
+    clib.call('SetFlightRecorderSignal_ABI', clib.c_int(signum))
+
+
+def dump_flight_recorder(path=None):
+    """Dump the flight recorder to 'path' (or the path that was set)."""
+    clib.call('DumpFlightRecorder_ABI', clib.PCHAR(path) if path else None)
+
+
+def set_executor_pool_size(n):
+    """Set the # of threads in the library's thread pool.
+
+    All library threads come from the executor: a thread pool (timers, 
+    coroutine resumption, parallel evaluation; default # of cores, max 4), 
+    an I/O pool for blocking calls (default 4), and dedicated threads for 
+    the socket/listener loops. Extra threads exit once idle.
+    """
+    clib.set_val('SetExecutorPoolSize_ABI', c_uint, n)
+
+
+def get_executor_pool_size():
+    """Get the # of threads in the library's thread pool."""
+    return clib.get_val('GetExecutorPoolSize_ABI', c_uint)
+
+
+def set_executor_io_pool_size(n):
+    """Set the # of threads in the library's I/O pool."""
+    clib.set_val('SetExecutorIOPoolSize_ABI', c_uint, n)
+
+
+def get_executor_io_pool_size():
+    """Get the # of threads in the library's I/O pool."""
+    return clib.get_val('GetExecutorIOPoolSize_ABI', c_uint)
+
+
+def set_executor_affinity(cpus):
+    """Pin all library threads (incl. those running) to 'cpus'.
+
+    def set_executor_affinity(cpus);
+
+        cpus    ::  [int]  ::  cpu indices, empty to unpin
+
+        returns -> None
+        throws  -> LibraryNotLoaded, CLibException
+    """
+    cpus = list(cpus)
+    clib.call('SetExecutorAffinity_ABI', (clib.c_int * len(cpus))(*cpus),
+              clib.c_size_t(len(cpus)))
+
+
+def get_executor_thread_count():
+    """Get the # of library threads currently running."""
+    return clib.get_val('GetExecutorThreadCount_ABI', c_uint)
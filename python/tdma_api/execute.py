@@ -49,7 +49,8 @@ https://github.com/jeog/TDAmeritradeAPI/blob/master/README_EXECUTE.md
 """
 
 from ctypes import byref as _REF, c_int, c_size_t, c_double, c_uint, \
-                    c_char_p, POINTER
+                    c_char_p, c_ulong, c_ulonglong, CFUNCTYPE, POINTER
+from inspect import signature
 import json
 
 from . import clib
@@ -122,6 +123,10 @@ ORDER_STRATEGY_TYPE_SINGLE = 0
 ORDER_STRATEGY_TYPE_OCO = 1
 ORDER_STRATEGY_TYPE_TRIGGER = 2
 
+PAPER_FILL_MODEL_TOUCH = 0
+PAPER_FILL_MODEL_THROUGH = 1
+PAPER_FILL_MODEL_DISPLAYED_SIZE = 2
+
 
 class _OrderLeg_C(clib._CProxy2):
     """C struct representing OrderLeg_C type."""
@@ -206,6 +211,218 @@ def cancel_order(creds, account_id, order_id):
     clib.call('Execute_CancelOrder_ABI', _REF(creds), PCHAR(account_id),
               PCHAR(order_id), _REF(b))
     return bool(b.value)
+
+
+def replace_order(creds, account_id, order_id, order):
+    """Replace active order with a new OrderTicket in one request.
+
+    WARNING - SENDS A LIVE ORDER & HAS UNDERGONE LIMITED TESTING !
+
+    def replace_order(creds, account_id, order_id, order):
+
+        creds      :: Credentials :: instance received from auth.py
+        account_id :: str         :: user account ID
+        order_id   :: str         :: order ID of order to replace
+        order      :: OrderTicket :: new order
+
+    RETURNS -> new order id str on success (throws CLibException on failure)
+
+    THROWS -> LibraryNotLoaded, CLibException
+    """
+    if not isinstance(order, OrderTicket):
+        raise TypeError("order not instance of 'OrderTicket'")
+    c = c_char_p()
+    n = c_size_t()
+    clib.call('Execute_ReplaceOrder_ABI', _REF(creds), PCHAR(account_id),
+              PCHAR(order_id), _REF(order._obj), _REF(c), _REF(n))
+    s = c.value.decode()
+    clib.free_buffer(c)
+    return s
+
+
+class ExecuteOpLatency(clib._Structure):
+    """Round-trip latency(usec) of one type of order call."""
+    _fields_ = [
+        ("ncalls", c_ulonglong),
+        ("nerrors", c_ulonglong),
+        ("last_usec", c_ulonglong),
+        ("min_usec", c_ulonglong),
+        ("max_usec", c_ulonglong),
+        ("total_usec", c_ulonglong)
+    ]
+
+class ExecuteLatencyStats(clib._Structure):
+    """Latency of send_order, cancel_order and replace_order."""
+    _fields_ = [
+        ("send", ExecuteOpLatency),
+        ("cancel", ExecuteOpLatency),
+        ("replace", ExecuteOpLatency)
+    ]
+
+def get_latency_stats():
+    """returns ExecuteLatencyStats for the order calls made so far"""
+    stats = ExecuteLatencyStats()
+    clib.call('Execute_GetLatencyStats_ABI', _REF(stats))
+    return stats
+
+def reset_latency_stats():
+    """zero the stats returned by get_latency_stats"""
+    clib.call('Execute_ResetLatencyStats_ABI')
+
+
+ANALYTICS_ANY = -1
+ANALYTICS_LATENCY_BUCKETS = 32
+ANALYTICS_TIME_BUCKETS = 48
+
+class ExecuteLatencyHistogram(clib._Structure):
+    """Latency(usec); buckets[i] counts [2^i, 2^(i+1)), the last the rest."""
+    _fields_ = [
+        ("count", c_ulonglong),
+        ("min_usec", c_ulonglong),
+        ("max_usec", c_ulonglong),
+        ("total_usec", c_ulonglong),
+        ("buckets", c_ulonglong * ANALYTICS_LATENCY_BUCKETS)
+    ]
+
+class ExecuteAnalyticsStats(clib._Structure):
+    """Ack/fill latency and slippage(vs mid at send, > 0 worse) of orders."""
+    _fields_ = [
+        ("norders", c_ulonglong),
+        ("nacks", c_ulonglong),
+        ("nrejects", c_ulonglong),
+        ("nfilled", c_ulonglong),
+        ("send_to_ack", ExecuteLatencyHistogram),
+        ("ack_to_fill", ExecuteLatencyHistogram),
+        ("filled_quantity", c_double),
+        ("slippage_quantity", c_double),
+        ("avg_slippage", c_double),
+        ("avg_slippage_bps", c_double)
+    ]
+
+def set_analytics_enabled(enabled):
+    """Start/stop tracking sent orders, quotes and ACCT_ACTIVITY.
+
+    Orders sent w/ send_order/replace_order while enabled are timed and get
+    the last bid/ask any StreamingSession received for their symbol; acks
+    and fills are matched from the ACCT_ACTIVITY data of any session.
+    """
+    clib.set_val('Execute_SetAnalyticsEnabled_ABI', c_int, enabled)
+
+def is_analytics_enabled():
+    return bool(clib.get_val('Execute_IsAnalyticsEnabled_ABI', c_int))
+
+def analytics_add_orders(orders):
+    """Fills from an OrderGetter(dict) or OrdersGetter(list) result.
+
+    OrderGetter/OrdersGetter .get() add their own results; this is for
+    ones from elsewhere.
+    """
+    clib.call('Execute_AnalyticsAddOrders_ABI', PCHAR(json.dumps(orders)))
+
+def get_analytics_stats(symbol="", order_type=ANALYTICS_ANY,
+                        time_bucket=ANALYTICS_ANY):
+    """returns ExecuteAnalyticsStats merged across the matching orders
+
+        symbol      :: str :: "" for any
+        order_type  :: int :: ORDER_TYPE_[] or ANALYTICS_ANY
+        time_bucket :: int :: half hour after midnight UTC the order was
+                              sent (0 - 47) or ANALYTICS_ANY
+    """
+    stats = ExecuteAnalyticsStats()
+    clib.call('Execute_GetAnalyticsStats_ABI', PCHAR(symbol), c_int(order_type),
+              c_int(time_bucket), _REF(stats))
+    return stats
+
+def reset_analytics():
+    """clear the stats and the orders waiting on acks/fills"""
+    clib.call('Execute_ResetAnalytics_ABI')
+
+
+PAPER_CALLBACK_FUNC_TYPE = CFUNCTYPE(None, c_ulonglong, c_char_p)
+PAPER_CALLBACK_NARGS = 2
+
+_paper_cb_wrapper = None
+
+def paper_add_account(account_id):
+    """Handle orders/order getters for 'account_id' locally (paper trading).
+
+    send_order, cancel_order, replace_order, OrderGetter and OrdersGetter for
+    the account are served by a matching simulator fed by the QUOTE/OPTION
+    data of any StreamingSession (see paper_set_live_quotes) and/or
+    paper_replay/paper_set_quote.
+    """
+    clib.call('Execute_PaperAddAccount_ABI', PCHAR(account_id))
+
+def paper_remove_account(account_id):
+    """stop paper trading 'account_id' (its orders are discarded)"""
+    clib.call('Execute_PaperRemoveAccount_ABI', PCHAR(account_id))
+
+def paper_is_account(account_id):
+    i = c_int()
+    clib.call('Execute_PaperIsAccount_ABI', PCHAR(account_id), _REF(i))
+    return bool(i.value)
+
+def paper_set_latency(account_id, msec):
+    """orders are QUEUED until the first quote 'msec' after they're sent"""
+    clib.call('Execute_PaperSetLatency_ABI', PCHAR(account_id), c_ulong(msec))
+
+def paper_get_latency(account_id):
+    l = c_ulong()
+    clib.call('Execute_PaperGetLatency_ABI', PCHAR(account_id), _REF(l))
+    return l.value
+
+def paper_set_fill_model(account_id, fill_model):
+    """fill_model :: int :: PAPER_FILL_MODEL_[]"""
+    clib.call('Execute_PaperSetFillModel_ABI', PCHAR(account_id),
+              c_int(fill_model))
+
+def paper_get_fill_model(account_id):
+    m = c_int()
+    clib.call('Execute_PaperGetFillModel_ABI', PCHAR(account_id), _REF(m))
+    return m.value
+
+def paper_set_live_quotes(live):
+    """use the quotes StreamingSessions receive (on by default)"""
+    clib.set_val('Execute_PaperSetLiveQuotes_ABI', c_int, live)
+
+def paper_get_live_quotes():
+    return bool(clib.get_val('Execute_PaperGetLiveQuotes_ABI', c_int))
+
+def paper_set_quote(symbol, bid, ask, bid_size, ask_size, timestamp):
+    """set a symbol's quote at 'timestamp'(msec) and match against it"""
+    clib.call('Execute_PaperSetQuote_ABI', PCHAR(symbol), c_double(bid),
+              c_double(ask), c_double(bid_size), c_double(ask_size),
+              c_ulonglong(timestamp))
+
+def paper_replay(service, timestamp, content):
+    """replay recorded data
+
+        service   :: int  :: stream.SERVICE_TYPE_QUOTE or _OPTION
+        timestamp :: int  :: msec
+        content   :: list :: the 'content' the streaming callback got
+    """
+    clib.call('Execute_PaperReplay_ABI', c_int(service),
+              c_ulonglong(timestamp), PCHAR(json.dumps(content)))
+
+def paper_set_activity_callback(callback):
+    """Call 'callback' w/ ACCT_ACTIVITY-style paper events. (None to remove)
+
+        def callback(timestamp, items)
+
+        timestamp :: int :: simulator time(msec)
+        items     :: str :: json list of {"1":account, "2":message type,
+                            "3":xml message}
+    """
+    global _paper_cb_wrapper
+    if callback is None:
+        w = None
+    else:
+        if len(signature(callback).parameters) != PAPER_CALLBACK_NARGS:
+            raise TypeError("callback requires %i args"
+                            % PAPER_CALLBACK_NARGS)
+        w = PAPER_CALLBACK_FUNC_TYPE(callback)
+    clib.call('Execute_PaperSetActivityCallback_ABI', w)
+    _paper_cb_wrapper = w
     
 #
 # Careful - this is a shared base, unlike our C++ 'OrderObjectProxy'
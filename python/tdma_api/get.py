@@ -45,7 +45,7 @@ https://github.com/jeog/TDAmeritradeAPI/blob/master/README_GET.md
 """
 
 from ctypes import byref as _REF, c_int, c_ulonglong, c_double, \
-                    Union as _Union, c_uint, c_longlong
+                    Union as _Union, c_uint, c_longlong, c_char
 import json
 
 from . import clib
@@ -177,9 +177,17 @@ def set_wait_msec(msec):
     """set current minimum wait milliseconds between .get() calls"""
     clib.set_val('APIGetter_SetWaitMSec_ABI', c_ulonglong, msec)
 
-def wait_remaining():
-    """milliseconds before .get() can be called without blocking"""
-    return clib.get_val("APIGetter_WaitRemaining_ABI", c_ulonglong)
+def wait_remaining(client_id=None):
+    """milliseconds before .get() can be called without blocking
+
+    with 'client_id' only its rate domain, otherwise the most of any
+    """
+    if client_id is None:
+        return clib.get_val("APIGetter_WaitRemaining_ABI", c_ulonglong)
+    msec = c_ulonglong()
+    clib.call("APIGetter_WaitRemainingForClient_ABI", PCHAR(client_id),
+              _REF(msec))
+    return msec.value
 
 def share_connections(share):
     """True to make new getters share TCP/HTTP Connection. (default)"""
@@ -189,6 +197,66 @@ def is_sharing_connections():
     """returns if newly created getters will share TCP/HTTP Connection."""
     return bool(clib.get_val("APIGetter_IsSharingConnections_ABI", c_int))
 
+class GetterRateDomainStats(clib._Structure):
+    """Throttle usage of one rate domain(client_id)."""
+    _fields_ = [
+        ("ngets", c_ulonglong),
+        ("nthrottled", c_ulonglong),
+        ("nerrors", c_ulonglong),
+        ("wait_msec", c_ulonglong),
+        ("wait_remaining_msec", c_ulonglong)
+    ]
+
+def get_rate_domains():
+    """client_ids of the rate domains used so far.
+
+    Getters are throttled per client_id so Credentials with different client
+    ids(and quotas) don't wait on each other.
+    """
+    return set(clib.get_strs('APIGetter_GetRateDomains_ABI'))
+
+def get_rate_domain_stats(client_id):
+    """returns GetterRateDomainStats for 'client_id'"""
+    stats = GetterRateDomainStats()
+    clib.call('APIGetter_GetRateDomainStats_ABI', PCHAR(client_id),
+              _REF(stats))
+    return stats
+
+def get_def_broker_cache_msec():
+    """get default milliseconds the broker caches a response"""
+    return clib.get_val('APIGetter_GetDefBrokerCacheMSec_ABI', c_ulonglong)
+
+def start_broker(creds, path, cache_msec=None):
+    """Serve .get() requests from other processes over unix socket 'path'.
+
+    All requests(local and brokered) share this process's throttle and
+    'creds'. Identical in-flight requests are coalesced and responses are
+    cached for 'cache_msec'(0 to disable). One broker per process.
+    """
+    if cache_msec is None:
+        cache_msec = get_def_broker_cache_msec()
+    clib.call('APIGetter_StartBroker_ABI', _REF(creds), PCHAR(path),
+              c_ulonglong(cache_msec))
+
+def stop_broker():
+    """stop the broker started by start_broker"""
+    clib.call('APIGetter_StopBroker_ABI')
+
+def is_broker_running():
+    """returns if a broker was started in this process"""
+    return bool(clib.get_val('APIGetter_IsBrokerRunning_ABI', c_int))
+
+def use_broker(path):
+    """Send .get() requests to the broker at 'path'(None to stop).
+
+    The broker's credentials are used, not the getter's.
+    """
+    clib.call('APIGetter_UseBroker_ABI', PCHAR(path) if path else None)
+
+def get_broker():
+    """returns path of the broker in use, or empty string"""
+    return clib.get_str('APIGetter_GetBroker_ABI')
+
 
 class _APIGetter( clib._ProxyBase ):
     """_APIGetter - Base getter class. DO NOT INSTANTIATE!
@@ -406,6 +474,17 @@ VALID_FREQUENCIES_BY_FREQUENCY_TYPE = {
     FREQUENCY_TYPE_MONTHLY : (1,)
     }
 
+class Candle(clib._Structure):
+    """One element of the array returned by get_candles()."""
+    _fields_ = [
+        ("datetime", c_longlong), # msec since epoch
+        ("open", c_double),
+        ("high", c_double),
+        ("low", c_double),
+        ("close", c_double),
+        ("volume", c_longlong)
+    ]
+
 class _HistoricalGetterBase(_APIGetter):
     """_HistoricalGetterBase - Base getter class. DO NOT INSTANTIATE!
 
@@ -447,6 +526,19 @@ class _HistoricalGetterBase(_APIGetter):
         clib.set_val('HistoricalGetterBase_SetExtendedHours_ABI', c_int,
                  extended_hours, self._obj)
 
+    def get_candles(self):
+        """Makes HTTPS/GET request and returns the candles as an array.
+
+        The response is decoded by the library, not json.loads; returns a
+        numpy structured array of Candle (a ctypes array if numpy isn't
+        installed) that uses the library's buffer directly, e.g:
+
+            c = getter.get_candles()
+            c['close'].mean()
+        """
+        return clib.get_array('HistoricalGetterBase_GetCandles_ABI', Candle,
+                              clib.free_candles_buffer, self._obj)
+
 
 class HistoricalPeriodGetter(_HistoricalGetterBase):
     """HistoricalPeriodGetter - Retrieve historical data over a certain period.
@@ -783,6 +875,41 @@ class OptionStrategy:
         return OptionStrategy(OPTION_STRATEGY_TYPE_ROLL, spread_interval)
 
 
+class OptionQuote(clib._Structure):
+    """One element of the array returned by get_quotes().
+
+    Missing/'NaN' values are NaN(floats) or 0(ints).
+    """
+    _fields_ = [
+        ("symbol", c_char * 32),
+        ("expiration", c_longlong), # msec since epoch
+        ("strike", c_double),
+        ("is_put", c_int),
+        ("days_to_expiration", c_int),
+        ("bid", c_double),
+        ("ask", c_double),
+        ("last", c_double),
+        ("mark", c_double),
+        ("bid_size", c_longlong),
+        ("ask_size", c_longlong),
+        ("last_size", c_longlong),
+        ("total_volume", c_longlong),
+        ("open_interest", c_longlong),
+        ("quote_time", c_longlong), # msec since epoch
+        ("trade_time", c_longlong), # msec since epoch
+        ("volatility", c_double),
+        ("delta", c_double),
+        ("gamma", c_double),
+        ("theta", c_double),
+        ("vega", c_double),
+        ("rho", c_double),
+        ("time_value", c_double),
+        ("theoretical_value", c_double),
+        ("multiplier", c_double),
+        ("in_the_money", c_int),
+        ("non_standard", c_int)
+    ]
+
 class _OptionChainGetterBase(_APIGetter):
     """_OptionChainGetterBase - Base getter class. DO NOT INSTANTIATE!
 
@@ -874,6 +1001,19 @@ class _OptionChainGetterBase(_APIGetter):
         clib.set_val('OptionChainGetter_SetOptionType_ABI', c_int, option_type,
                  self._obj)
 
+    def get_quotes(self):
+        """Makes HTTPS/GET request and returns every contract as an array.
+
+        The response is decoded by the library, not json.loads; returns a
+        numpy structured array of OptionQuote (a ctypes array if numpy isn't
+        installed), calls then puts, by expiration then strike, that uses
+        the library's buffer directly.
+
+        Not supported by OptionChainStrategyGetter (throws CLibException).
+        """
+        return clib.get_array('OptionChainGetter_GetQuotes_ABI', OptionQuote,
+                              clib.free_option_quotes_buffer, self._obj)
+
 
 class OptionChainGetter(_OptionChainGetterBase):
     """OptionChainGetter - Retrieve standard option chain.
@@ -39,7 +39,8 @@ https://github.com/jeog/TDAmeritradeAPI/blob/master/README_STREAMING.md
 """
 
 from ctypes import byref as _REF, c_int, c_void_p, c_ulonglong, CFUNCTYPE, \
-                    c_char_p, c_ulong, c_size_t, pointer, POINTER
+                    c_char_p, c_ulong, c_size_t, c_double, pointer, POINTER, \
+                    string_at, c_longlong
 from inspect import signature
 from xml.etree import ElementTree                    
 import json
@@ -52,9 +53,18 @@ DEF_CONNECT_TIMEOUT = 3000
 DEF_LISTENING_TIMEOUT = 30000
 DEF_SUBSCRIBE_TIMEOUT = 1500
 
+SHM_DEF_NSLOTS = 65536
+SHM_DEF_SLOT_SIZE = 1024
+
+IV_SURFACE_DEF_REFIT_INTERVAL = 250
+
 CALLBACK_FUNC_TYPE = CFUNCTYPE(None, c_int, c_int, c_ulonglong, c_char_p)
 CALLBACK_NARGS = 4
 
+SPREAD_CALLBACK_FUNC_TYPE = CFUNCTYPE(None, c_int, c_double, c_double, 
+                                      c_double, c_ulonglong)
+SPREAD_CALLBACK_NARGS = 5
+
 SERVICE_TYPE_NONE = 0
 SERVICE_TYPE_QUOTE = 1
 SERVICE_TYPE_OPTION = 2
@@ -107,6 +117,13 @@ CALLBACK_TYPE_NOTIFY = 4
 CALLBACK_TYPE_TIMEOUT = 5
 CALLBACK_TYPE_ERROR = 6
 
+FILTER_RULE_CHANGED = 0
+FILTER_RULE_DELTA = 1
+FILTER_RULE_CROSS = 2
+
+SOCKET_BACKEND_EPOLL = 0
+SOCKET_BACKEND_IO_URING = 1
+
 
 def service_type_to_str(service):
     """Converts SERVICE_TYPE_[] constant to str."""
@@ -115,11 +132,31 @@ def service_type_to_str(service):
 def callback_type_to_str(cb_type):
     """Converts CALLBACK_TYPE_[] constant to str."""
     return clib.to_str("StreamingCallbackType_to_string_ABI", c_int, cb_type)
+
+def filter_rule_to_str(rule_type):
+    """Converts FILTER_RULE_[] constant to str."""
+    return clib.to_str("StreamingFilterRuleType_to_string_ABI", c_int, rule_type)
     
 def command_type_to_str(command):
     """Convers COMMAND_TYPE_[] constatnt to str."""
     return clib.to_str("CommandType_to_string_ABI", c_int, command)    
 
+def socket_backend_to_str(backend):
+    """Converts SOCKET_BACKEND_[] constant to str."""
+    return clib.to_str("SocketBackendType_to_string_ABI", c_int, backend)
+
+def set_socket_backend(backend):
+    """Set how the socket of sessions started after is polled.
+
+    SOCKET_BACKEND_EPOLL (default) or SOCKET_BACKEND_IO_URING, which falls
+    back to epoll if the kernel doesn't support it. (Linux only)
+    """
+    clib.set_val("SetStreamingSocketBackend_ABI", c_int, backend)
+
+def get_socket_backend():
+    """Get the SOCKET_BACKEND_[] constant sessions started now will use."""
+    return clib.get_val("GetStreamingSocketBackend_ABI", c_int)
+
 
 class _StreamingSession_C(clib._CProxy3): 
     """C struct representing StreamingSession_C type."""
@@ -193,6 +230,7 @@ class StreamingSession( clib._ProxyBase ):
         self._creds = creds   
         self._cb_raw = callback
         self._cb_wrapper = self._build_callback_wrapper(callback)
+        self._route_cb_wrappers = {} # by route id, while the lib has them
         super().__init__(_REF(creds), self._cb_wrapper, 
                          PCHAR(account_id if account_id else ""),
                          c_ulong(connect_timeout), c_ulong(listening_timeout), 
@@ -282,6 +320,411 @@ class StreamingSession( clib._ProxyBase ):
         """Returns the quality-of-service."""
         return clib.get_val(self._abi("GetQOS"), c_int, self._obj)            
 
+    def set_external_loop(self, external_loop):
+        """Run the session on the caller's event loop instead of library 
+        threads. (Must be called before start.)
+
+        Once started, wait for get_event_fd() to be ready (or 
+        get_next_timeout() msec to pass) and call process_events(), which 
+        runs the callback on the calling thread. All calls on the session
+        must be made from that thread.
+
+            def set_external_loop(self, external_loop):
+
+                external_loop :: bool :: use the caller's event loop
+
+            returns -> None
+            throws  -> LibraryNotLoaded, CLibException
+        """
+        clib.call(self._abi("SetExternalLoop"), _REF(self._obj), 
+                  c_int(1 if external_loop else 0))
+
+    def is_external_loop(self):
+        """Returns if the session uses the caller's event loop."""
+        return bool(clib.get_val(self._abi("IsExternalLoop"), c_int, 
+                                 self._obj))
+
+    def get_event_fd(self):
+        """Returns (fd, events) to wait on, e.g with select.poll/epoll."""
+        fd = c_int()
+        events = c_int()
+        clib.call(self._abi("GetEventFd"), _REF(self._obj), _REF(fd), 
+                  _REF(events))
+        return (fd.value, events.value)
+
+    def get_next_timeout(self):
+        """Returns msec until process_events() is due regardless of the 
+        fd, or -1 if no deadline."""
+        return clib.get_val(self._abi("GetNextTimeout"), c_longlong, 
+                            self._obj)
+
+    def process_events(self, wait=0):
+        """Handle ready events, waiting up to 'wait' msec for them.
+
+            def process_events(self, wait=0):
+
+                wait :: int :: max msec to wait for events
+
+            returns -> bool, False once the session has stopped listening
+            throws  -> LibraryNotLoaded, CLibException
+        """
+        r = c_int()
+        clib.call(self._abi("ProcessEvents"), _REF(self._obj), 
+                  c_longlong(wait), _REF(r))
+        return bool(r)
+
+    def start_publishing(self, name, nslots=SHM_DEF_NSLOTS, 
+                         slot_size=SHM_DEF_SLOT_SIZE):
+        """Publish everything the session receives to shared memory.
+        (Unfiltered: filters only apply to this session's callbacks.)
+        
+            def start_publishing(self, name, nslots=SHM_DEF_NSLOTS,
+                                 slot_size=SHM_DEF_SLOT_SIZE):
+            
+                name      :: str :: name StreamingSubscriber objects attach to
+                nslots    :: int :: number of slots in ring (power of 2)
+                slot_size :: int :: max size(bytes) of each item
+                                           
+            throws   -> LibraryNotLoaded, CLibException 
+        """
+        clib.call(self._abi("StartPublishing"), _REF(self._obj), PCHAR(name),
+                  c_size_t(nslots), c_size_t(slot_size))
+        
+    def stop_publishing(self):
+        """Stop publishing to shared memory."""
+        clib.call(self._abi("StopPublishing"), _REF(self._obj))
+        
+    def is_publishing(self):
+        """Returns if the session is publishing to shared memory."""
+        return bool(clib.get_val(self._abi("IsPublishing"), c_int, self._obj))
+
+    def set_filter_symbols(self, service, *symbols):
+        """Drop 'data' items for other symbols. (no symbols for all)
+        
+            def set_filter_symbols(self, service, *symbols):
+            
+                service  :: int :: SERVICE_TYPE_[] constant
+                *symbols :: str :: symbols to keep
+                
+            throws   -> LibraryNotLoaded, CLibException 
+        """
+        clib.call(self._abi("SetFilterSymbols"), _REF(self._obj), 
+                  c_int(service), PCHAR_BUFFER(symbols), len(symbols))
+
+    def add_filter_rule(self, service, field, rule_type, value=0):
+        """Only pass 'data' items that match at least one rule.
+        
+        Evaluated in the session's listener thread before the callback.
+        
+            def add_filter_rule(self, service, field, rule_type, value=0):
+            
+                service   :: int   :: SERVICE_TYPE_[] constant
+                field     :: int   :: subscription's FIELD_[] constant
+                rule_type :: int   :: FILTER_RULE_[] constant
+                                        CHANGED - field in the update
+                                        DELTA - moved >= value since the
+                                                last item that passed
+                                        CROSS - crossed level 'value'
+                value     :: float :: threshold or level
+                
+            throws   -> LibraryNotLoaded, CLibException 
+        """
+        clib.call(self._abi("AddFilterRule"), _REF(self._obj), c_int(service),
+                  c_int(field), c_int(rule_type), c_double(value))
+
+    def clear_filter(self, service=SERVICE_TYPE_NONE):
+        """Remove filter for 'service'. (SERVICE_TYPE_NONE for all)"""
+        clib.call(self._abi("ClearFilter"), _REF(self._obj), c_int(service))
+
+    def get_filter_stats(self, service):
+        """Returns (# items passed, # items dropped) for 'service'."""
+        p = c_ulonglong()
+        d = c_ulonglong()
+        clib.call(self._abi("GetFilterStats"), _REF(self._obj), 
+                  c_int(service), _REF(p), _REF(d))
+        return (p.value, d.value)
+
+    def add_route(self, service, callback, *symbols):
+        """Send 'service' data for 'symbols' (no symbols for all of it) to 
+        'callback' instead of the session's callback.
+        
+        The session's callback becomes the catch-all: it gets what no 
+        route takes and every other callback type. A symbol route's 
+        callback gets only its items. Called from the session's listener 
+        thread, after filters.
+        
+            def add_route(self, service, callback, *symbols):
+            
+                service  :: int  :: SERVICE_TYPE_[] constant
+                callback :: func :: same signature as the session's callback
+                *symbols :: str  :: symbols to route
+                
+            returns -> int (route id)
+            throws  -> LibraryNotLoaded, CLibException 
+        """
+        w = self._build_callback_wrapper(callback)
+        i = c_int()
+        clib.call(self._abi("AddRoute"), _REF(self._obj), c_int(service),
+                  PCHAR_BUFFER(symbols), len(symbols), w, _REF(i))
+        self._route_cb_wrappers[i.value] = w
+        return i.value
+
+    def remove_route(self, route_id):
+        """Remove route 'route_id'."""
+        clib.call(self._abi("RemoveRoute"), _REF(self._obj), 
+                  c_int(route_id))
+        self._route_cb_wrappers.pop(route_id, None)
+
+    def clear_routes(self):
+        """Remove all routes."""
+        clib.call(self._abi("ClearRoutes"), _REF(self._obj))
+        self._route_cb_wrappers.clear()
+
+    def add_spread(self, *legs):
+        """Add a synthetic spread priced from the session's QUOTE/OPTION data.
+        
+        Only spreads with a leg in an update are repriced. Subscribe to 
+        the legs as usual.
+        
+            def add_spread(self, *legs):
+            
+                *legs :: (str, int) :: (symbol, ratio) - ratio > 0 long,
+                                       < 0 short (reduced by their gcd)
+                
+            returns -> int (spread id)
+            throws  -> LibraryNotLoaded, CLibException 
+        """
+        symbols = [l[0] for l in legs]
+        ratios = (c_int * len(legs))(*[l[1] for l in legs])
+        i = c_int()
+        clib.call(self._abi("AddSpread"), _REF(self._obj), 
+                  PCHAR_BUFFER(symbols), ratios, c_size_t(len(legs)), _REF(i))
+        return i.value
+
+    def add_spread_from_order(self, order):
+        """Add a synthetic spread from the legs of an execute.OrderTicket 
+        (e.g from SpreadOrderBuilder): BUY... long, SELL... short, leg 
+        quantities as the ratios. Returns the spread id.
+        """
+        from . import execute
+        sells = ( execute.ORDER_INSTRUCTION_SELL, 
+                  execute.ORDER_INSTRUCTION_SELL_SHORT, 
+                  execute.ORDER_INSTRUCTION_SELL_TO_OPEN, 
+                  execute.ORDER_INSTRUCTION_SELL_TO_CLOSE )
+        legs = []
+        for l in order.get_legs():
+            q = l.get_quantity()
+            legs.append( (l.get_symbol(), 
+                          -q if l.get_instruction() in sells else q) )
+        return self.add_spread(*legs)
+
+    def remove_spread(self, spread_id):
+        """Remove spread 'spread_id'."""
+        clib.call(self._abi("RemoveSpread"), _REF(self._obj), 
+                  c_int(spread_id))
+
+    def get_spread_quote(self, spread_id):
+        """Returns (bid, ask, mid, timestamp) of spread 'spread_id' or None
+        until every leg has a bid and ask. (bid/ask are 'natural')
+        """
+        q = _SpreadQuote()
+        clib.call(self._abi("GetSpreadQuote"), _REF(self._obj), 
+                  c_int(spread_id), _REF(q))
+        return (q.bid, q.ask, q.mid, q.timestamp) if q.is_valid else None
+
+    def set_spread_callback(self, callback):
+        """Call 'callback' when a spread's quote changes. (None to remove)
+        
+        Called from the session's listener thread.
+        
+            def callback(spread_id, bid, ask, mid, timestamp)
+        """
+        if callback is None:
+            self._spread_cb_wrapper = None
+        else:
+            if len(signature(callback).parameters) != SPREAD_CALLBACK_NARGS:
+                raise TypeError("callback requires %i args" 
+                                % SPREAD_CALLBACK_NARGS)
+            self._spread_cb_wrapper = SPREAD_CALLBACK_FUNC_TYPE(callback)
+        clib.call(self._abi("SetSpreadCallback"), _REF(self._obj), 
+                  self._spread_cb_wrapper)
+
+    def set_iv_surface_enabled(self, enabled):
+        """Keep an IV surface from the session's OPTION data (off by default).
+        
+        Disabling drops the surface.
+        """
+        clib.call(self._abi("SetIVSurfaceEnabled"), _REF(self._obj), 
+                  c_int(bool(enabled)))
+
+    def is_iv_surface_enabled(self):
+        """Returns if the IV surface is enabled."""
+        return bool(clib.get_val(self._abi("IsIVSurfaceEnabled"), c_int,
+                                 self._obj))
+
+    def seed_iv_surface(self, option_chain):
+        """Seed (and enable) the IV surface w/ the result of 
+        get.OptionChainGetter.get().
+        
+        The surface (per underlying, a smile for each expiration) is then 
+        kept up to date from the session's OPTION data; only expirations 
+        w/ a changed vol are refit, at most once per refit interval.
+        
+            def seed_iv_surface(self, option_chain):
+            
+                option_chain :: dict :: decoded option chain
+                
+            throws -> LibraryNotLoaded, CLibException 
+        """
+        clib.call(self._abi("SeedIVSurface"), _REF(self._obj), 
+                  PCHAR(json.dumps(option_chain)))
+
+    def set_iv_surface_refit_interval(self, msec):
+        """Refit a changed expiration at most once per 'msec'."""
+        clib.call(self._abi("SetIVSurfaceRefitInterval"), _REF(self._obj), 
+                  c_ulong(msec))
+
+    def get_iv_surface_refit_interval(self):
+        """Returns the IV surface refit interval in msec."""
+        return clib.get_val(self._abi("GetIVSurfaceRefitInterval"), c_ulong,
+                            self._obj)
+
+    def refit_iv_surface(self):
+        """Refit pending IV surface expirations now."""
+        clib.call(self._abi("RefitIVSurface"), _REF(self._obj))
+
+    def get_iv_surface_vol(self, underlying, strike, days_to_expiration):
+        """Returns interpolated implied vol (percent)."""
+        v = c_double()
+        clib.call(self._abi("GetIVSurfaceVol"), _REF(self._obj), 
+                  PCHAR(underlying), c_double(strike), 
+                  c_double(days_to_expiration), _REF(v))
+        return v.value
+
+    def get_iv_surface_greeks(self, underlying, strike, days_to_expiration,
+                              is_call):
+        """Returns dict of interpolated vol (percent) and greeks.
+        
+        Greeks are Black-Scholes from the interpolated vol, the last 
+        underlying price and the chain's interest rate. (theta per day, 
+        vega per vol point)
+        """
+        g = _IVSurfaceGreeks()
+        clib.call(self._abi("GetIVSurfaceGreeks"), _REF(self._obj), 
+                  PCHAR(underlying), c_double(strike), 
+                  c_double(days_to_expiration), c_int(is_call), _REF(g))
+        return {f[0]:getattr(g, f[0]) for f in g._fields_}
+
+
+class _SpreadQuote(clib._Structure):
+    _fields_ = [
+        ("bid", c_double),
+        ("ask", c_double),
+        ("mid", c_double),
+        ("timestamp", c_ulonglong),
+        ("is_valid", c_int)
+        ]
+
+
+class _IVSurfaceGreeks(clib._Structure):
+    _fields_ = [
+        ("volatility", c_double),
+        ("delta", c_double),
+        ("gamma", c_double),
+        ("theta", c_double),
+        ("vega", c_double)
+        ]
+            
+
+class _StreamingSubscriber_C(clib._CProxy2): 
+    """C struct representing StreamingSubscriber_C type."""
+    pass  
+
+
+class _StreamingSubscriberItem(clib._Structure):
+    _fields_ = [
+        ("callback_type", c_int),
+        ("service_type", c_int),
+        ("timestamp", c_ulonglong),
+        ("sequence", c_ulonglong),
+        ("symbol", c_char_p),
+        ("data", c_void_p),
+        ("data_len", c_size_t)
+        ]
+     
+      
+class StreamingSubscriber( clib._ProxyBase ):
+    """StreamingSubscriber - read items published by a StreamingSession 
+    in another process.
+    
+    Attaches to the shared memory that a StreamingSession writes to after 
+    .start_publishing(name) is called. Only items published after 
+    attaching are seen. If the subscriber falls too far behind items are
+    skipped(see .get_ndropped()); the publisher never waits.
+    
+        def __init__(self, name):
+        
+            name :: str :: name passed to StreamingSession.start_publishing
+            
+    ALL METHODS THROW -> LibraryNotLoaded, CLibException
+    """
+    def __init__(self, name):
+        super().__init__(PCHAR(name))
+        
+    @classmethod               
+    def _cproxy_type(cls):
+        return _StreamingSubscriber_C
+    
+    def set_services(self, *services):
+        """Only return 'data' items for these SERVICE_TYPE_[] constants. 
+        (no args for all)"""
+        l = len(services)
+        clib.call(self._abi("SetServices"), _REF(self._obj), 
+                  (c_int * l)(*services), l)
+        
+    def set_symbols(self, *symbols):
+        """Only return 'data' items for these symbols. (no args for all)"""
+        clib.set_strs(self._abi("SetSymbols"), symbols, self._obj)
+        
+    def next(self, timeout=0):
+        """Return the next item or None if none available within 'timeout'.
+        
+            def next(self, timeout=0):
+            
+                timeout :: int :: msec to wait for an item
+                
+            returns -> (callback_type, service_type, timestamp, symbol, json) 
+                       or None
+            throws  -> LibraryNotLoaded, CLibException 
+        """
+        item = _StreamingSubscriberItem()
+        has_item = c_int()
+        valid = c_int()
+        while True:
+            clib.call(self._abi("Next"), _REF(self._obj), c_ulong(timeout),
+                      _REF(item), _REF(has_item))
+            if not has_item:
+                return None
+            data = string_at(item.data, item.data_len)
+            symbol = item.symbol.decode()
+            clib.call(self._abi("IsValid"), _REF(self._obj), _REF(item),
+                      _REF(valid))
+            # overwritten while we copied it, counts as dropped
+            if valid:
+                return ( item.callback_type, item.service_type, 
+                         item.timestamp, symbol,
+                         json.loads(data.decode()) if data else None )
+            timeout = 0
+                       
+    def get_ndropped(self):
+        """Returns number of items skipped because we fell behind."""
+        return clib.get_val(self._abi("GetNDropped"), c_ulonglong, self._obj)
+    
+    def is_publisher_active(self):
+        """Returns if the publishing session is still publishing."""
+        return bool(clib.get_val(self._abi("IsPublisherActive"), c_int, 
+                                 self._obj))
+
 
 class _StreamingSubscription( clib._ProxyBaseCopyable ):
     """_StreamingSubscription - Base Subscription class. DO NOT INSTANTIATE!
@@ -295,6 +738,10 @@ class _StreamingSubscription( clib._ProxyBaseCopyable ):
                          
     def __eq__(self,other):
         return self._is_same(other, "StreamingSubscription_IsSame_ABI")
+
+    def __hash__(self):
+        return clib.get_val("StreamingSubscription_Hash_ABI", c_size_t,
+                            self._obj)
     
 
 class RawSubscription(_StreamingSubscription):
@@ -25,6 +25,8 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 
 #include "../include/_tdma_api.h"
 #include "../include/curl_connect.h"
+#include "../include/_token_store.h"
+#include "../include/_probes.h"
 
 #include "openssl/evp.h"
 #include "openssl/conf.h"
@@ -695,7 +697,7 @@ RequestAccessTokenImpl( const string& code,
 }
 
 void
-RefreshAccessTokenImpl(Credentials* creds)
+RefreshAccessTokenFromServerImpl(Credentials* creds)
 {
     if( creds->epoch_sec_token_expiration < TOKEN_EARLIEST_EXPIRATION ||
         creds->epoch_sec_token_expiration > TOKEN_LATEST_EXPIRATION )
@@ -734,17 +736,42 @@ RefreshAccessTokenImpl(Credentials* creds)
     auto r_json = connect_auth(connection, "RefreshAccessTokenImpl");
     string r_str = r_json["access_token"];
 
-    if( creds->access_token )
-        delete[] creds->access_token;
-    creds->access_token = new char[r_str.size() + 1];
-    creds->access_token[r_str.size()] = 0;
-    strcpy(creds->access_token, r_str.c_str());
+    replace_access_token(*creds, r_str);
 
     if( string(creds->access_token).empty() ){
         TDMA_API_THROW(LocalCredentialException,"creds.access_token is empty");
     }
 }
 
+void
+RefreshAccessTokenImpl(Credentials* creds)
+{
+    string client_id( creds->client_id ? creds->client_id : "" );
+    TDMA_PROBE1(token_refresh_start, client_id.c_str());
+
+    /* w/ a shared token store only one process goes to the server */
+    try{
+        SharedTokenStore::refresh( *creds,
+                                   creds->access_token ? creds->access_token : "",
+                                   RefreshAccessTokenFromServerImpl );
+    }catch(...){
+        TDMA_PROBE2(token_refresh_end, client_id.c_str(), 0);
+        flight::record( flight::EventType::token_refresh, 0, 0,
+                        client_id.c_str() );
+        throw;
+    }
+    TDMA_PROBE2(token_refresh_end, client_id.c_str(), 1);
+    flight::record(flight::EventType::token_refresh, 1, 0, client_id.c_str());
+}
+
+void
+SetSharedTokenStoreImpl(const string& path)
+{ SharedTokenStore::set_path(path); }
+
+string
+GetSharedTokenStoreImpl()
+{ return SharedTokenStore::get_path(); }
+
 void
 SetCertificateBundlePathImpl(const string& path)
 {    
@@ -922,6 +949,29 @@ GetDefaultCertificateBundlePath_ABI( char **path,
     return to_new_char_buffer(r, path, n, allow_exceptions);
 }
 
+
+int
+SetSharedTokenStore_ABI(const char *path, int allow_exceptions)
+{
+    return CallImplFromABI( allow_exceptions, SetSharedTokenStoreImpl,
+                            path ? path : "" );
+}
+
+
+int
+GetSharedTokenStore_ABI(char **path, size_t *n, int allow_exceptions)
+{
+    CHECK_PTR(path, "path", allow_exceptions);
+
+    string r;
+    int err;
+    tie(r,err) = CallImplFromABI(allow_exceptions, GetSharedTokenStoreImpl);
+    if( err )
+        return err;
+
+    return to_new_char_buffer(r, path, n, allow_exceptions);
+}
+
 int
 CreateCredentials_ABI( const char* access_token,
                        const char* refresh_token,
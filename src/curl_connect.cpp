@@ -362,8 +362,8 @@ public:
         if (is_closed())
             throw CurlException("connection/handle has been closed");
 
-        if( !fields.empty() )
-            set_option(CURLOPT_COPYPOSTFIELDS, fields.c_str());
+        /* empty replaces (rather than keeps) the last request's body */
+        set_option(CURLOPT_COPYPOSTFIELDS, fields.c_str());
     }
 
 
@@ -554,17 +554,28 @@ const string HTTPConnection::DEFAULT_ENCODING("gzip");
 HttpMethod
 HTTPConnection::_set_method(HttpMethod meth)
 {
+    /*
+     * the handle may be re-used w/ a different method (e.g shared execute
+     * connection) so clear any custom request; HTTPGET also stops get/delete
+     * from sending the last request's body (post/put bodies are set on
+     * every SharedHTTPConnection::execute)
+     */
+    static char *no_request = nullptr;
     switch( meth ){
     case HttpMethod::http_get:
+        set_option(CURLOPT_CUSTOMREQUEST, no_request);
         set_option(CURLOPT_HTTPGET, 1L);
         break;
     case HttpMethod::http_post:
+        set_option(CURLOPT_CUSTOMREQUEST, no_request);
         set_option(CURLOPT_POST, 1L);
         break;
     case HttpMethod::http_delete:
+        set_option(CURLOPT_HTTPGET, 1L);
         set_option(CURLOPT_CUSTOMREQUEST, "DELETE");
         break;
     case HttpMethod::http_put:
+        set_option(CURLOPT_POST, 1L);
         set_option(CURLOPT_CUSTOMREQUEST, "PUT");
         break;
     default:
@@ -735,10 +746,13 @@ SharedHTTPConnection::execute(bool return_header_data)
     if( !_headers.empty() )
         ctx.conn->add_headers(_headers);
 
+    /*
+     * set the body on EVERY call (e.g. a retry after a token refresh) - the
+     * handle may have been used by another connection of the group since
+     */
     ctx.conn->set_method(_meth);
-    if( _meth != HttpMethod::http_get && !_fields.empty() )
+    if( _meth == HttpMethod::http_post || _meth == HttpMethod::http_put )
         ctx.conn->set_fields(_fields);
-    _fields.clear();
 
     ctx.conn->set_timeout(_timeout);
 
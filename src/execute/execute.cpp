@@ -15,14 +15,23 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see http://www.gnu.org/licenses.
 */
 #include <iostream>
+#include <mutex>
 
 #include "../../include/_tdma_api.h"
 #include "../../include/_execute.h"
+#include "../../include/_execute_analytics.h"
+#include "../../include/_paper_broker.h"
 
 using std::string;
 
 namespace {
 
+/* shared-connection context for all execute calls (getters use 0 - N) */
+const int EXECUTE_CONNECTION_GROUP = -1;
+
+ExecuteLatencyStats latency_stats;
+std::mutex latency_mtx;
+
 string
 order_id_from_header(const string& header)
 {
@@ -40,6 +49,67 @@ order_id_from_header(const string& header)
     return "";
 }
 
+void
+record_latency( ExecuteOpLatency ExecuteLatencyStats::*op,
+                unsigned long long usec )
+{
+    std::lock_guard<std::mutex> _(latency_mtx);
+    ExecuteOpLatency& l = latency_stats.*op;
+    if( l.ncalls == 0 || usec < l.min_usec )
+        l.min_usec = usec;
+    if( usec > l.max_usec )
+        l.max_usec = usec;
+    l.last_usec = usec;
+    l.total_usec += usec;
+    ++l.ncalls;
+}
+
+void
+record_error( ExecuteOpLatency ExecuteLatencyStats::*op )
+{
+    std::lock_guard<std::mutex> _(latency_mtx);
+    ++(latency_stats.*op).nerrors;
+}
+
+/*
+ * Each call gets its own SharedHTTPConnection (so concurrent orders don't
+ * share url/headers/fields) but they all use the one curl handle of
+ * EXECUTE_CONNECTION_GROUP; 'keep_warm' holds a reference so the
+ * handle - and its TLS session - outlives the call.
+ */
+string
+timed_execute( const string& url,
+               conn::HttpMethod meth,
+               const string& body,
+               Credentials& creds,
+               long success_code,
+               ExecuteOpLatency ExecuteLatencyStats::*op )
+{
+    using namespace std::chrono;
+
+    static conn::SharedHTTPConnection keep_warm(
+        meth, EXECUTE_CONNECTION_GROUP
+        );
+
+    conn::SharedHTTPConnection connection(url, meth, EXECUTE_CONNECTION_GROUP);
+    if( !body.empty() )
+        connection.set_fields(body);
+
+    string r_head;
+    conn::clock_ty::time_point r_tp;
+    auto beg = conn::clock_ty::now();
+    try{
+        std::tie(r_head, r_tp) =
+            tdma::connect_execute(connection, creds, success_code);
+    }catch(...){
+        record_error(op);
+        throw;
+    }
+
+    record_latency( op, duration_cast<microseconds>(r_tp - beg).count() );
+    return r_head;
+}
+
 } /* namespace */
 
 
@@ -56,14 +126,20 @@ Execute_SendOrderImpl( Credentials& creds,
     if( body.empty() )
         TDMA_API_THROW(ValueException, "order json is empty");
 
-    conn::HTTPConnection connection( url, conn::HttpMethod::http_post );
-    connection.set_fields(body);
-
-    string r_head;
-    conn::clock_ty::time_point r_tp;
-    tie(r_head, r_tp) =
-        connect_execute(connection, creds, conn::HTTP_RESPONSE_CREATED);
-    return order_id_from_header(r_head);
+    auto& analytics = ExecutionAnalytics::instance();
+    auto& paper = PaperBroker::instance();
+    auto send = analytics.begin_send(order);
+    string order_id;
+    if( paper.is_account(account_id) ){
+        order_id = paper.send_order(account_id, body);
+    }else{
+        string r_head = timed_execute( url, conn::HttpMethod::http_post, body,
+                                       creds, conn::HTTP_RESPONSE_CREATED,
+                                       &ExecuteLatencyStats::send );
+        order_id = order_id_from_header(r_head);
+    }
+    analytics.end_send(send, order_id);
+    return order_id;
 }
 
 
@@ -72,16 +148,56 @@ Execute_CancelOrderImpl( Credentials& creds,
                          const string& account_id,
                          const string& order_id )
 {
+    auto& paper = PaperBroker::instance();
+    if( paper.is_account(account_id) )
+        return paper.cancel_order(account_id, order_id);
+
     string url = URL_ACCOUNTS + util::url_encode(account_id)
                + "/orders/" + util::url_encode(order_id); // encode uncessary
 
-    conn::HTTPConnection connection( url, conn::HttpMethod::http_delete );
-
     // TODO catch exceptions and return fail state ??
-    connect_execute(connection, creds, conn::HTTP_RESPONSE_OK);
+    timed_execute( url, conn::HttpMethod::http_delete, "", creds,
+                   conn::HTTP_RESPONSE_OK, &ExecuteLatencyStats::cancel );
     return true;
 }
 
+
+/*
+ * PUT on the order replaces it atomically: TDMA cancels the old order
+ * and creates a new one (new id in 'Location', like send)
+ */
+string
+Execute_ReplaceOrderImpl( Credentials& creds,
+                          const string& account_id,
+                          const string& order_id,
+                          const OrderTicketImpl& order )
+{
+    if( order_id.empty() )
+        TDMA_API_THROW(ValueException, "order id is empty");
+
+    string url = URL_ACCOUNTS + util::url_encode(account_id)
+               + "/orders/" + util::url_encode(order_id);
+    string body = order.as_json_string();
+
+    if( body.empty() )
+        TDMA_API_THROW(ValueException, "order json is empty");
+
+    auto& analytics = ExecutionAnalytics::instance();
+    auto& paper = PaperBroker::instance();
+    auto send = analytics.begin_send(order);
+    string new_id;
+    if( paper.is_account(account_id) ){
+        new_id = paper.replace_order(account_id, order_id, body);
+    }else{
+        string r_head = timed_execute( url, conn::HttpMethod::http_put, body,
+                                       creds, conn::HTTP_RESPONSE_CREATED,
+                                       &ExecuteLatencyStats::replace );
+        new_id = order_id_from_header(r_head);
+    }
+    analytics.end_send(send, new_id);
+    return new_id;
+}
+
 } /* tdma */
 
 
@@ -140,6 +256,300 @@ Execute_CancelOrder_ABI( Credentials *creds,
     return err;
 }
 
+int
+Execute_ReplaceOrder_ABI( Credentials *creds,
+                          const char* account_id,
+                          const char* order_id,
+                          OrderTicket_C *porder,
+                          char** buf,
+                          size_t *n,
+                          int allow_exceptions )
+{
+    int err = proxy_is_callable<OrderTicketImpl>(porder, allow_exceptions);
+    if( err )
+         return err;
+
+    CHECK_PTR(account_id, "account id", allow_exceptions);
+    CHECK_PTR(order_id, "order id", allow_exceptions);
+    CHECK_PTR(buf, "buf", allow_exceptions);
+    CHECK_PTR(n, "n", allow_exceptions);
+
+    static auto meth =
+        +[]( Credentials *c, const char* aid, const char* oid,
+             OrderTicket_C* porder ){
+            return Execute_ReplaceOrderImpl(
+                *c, aid, oid, *reinterpret_cast<OrderTicketImpl*>(porder->obj)
+                );
+        };
+
+    string r;
+    std::tie(r,err) = CallImplFromABI( allow_exceptions, meth, creds,
+                                       account_id, order_id, porder );
+    if( err )
+        return err;
+
+    return to_new_char_buffer(r, buf, n, allow_exceptions);
+}
+
+int
+Execute_GetLatencyStats_ABI( ExecuteLatencyStats *pstats,
+                             int allow_exceptions )
+{
+    CHECK_PTR(pstats, "stats", allow_exceptions);
+
+    std::lock_guard<std::mutex> _(latency_mtx);
+    *pstats = latency_stats;
+    return 0;
+}
+
+int
+Execute_ResetLatencyStats_ABI( int allow_exceptions )
+{
+    std::lock_guard<std::mutex> _(latency_mtx);
+    latency_stats = ExecuteLatencyStats();
+    return 0;
+}
+
+int
+Execute_SetAnalyticsEnabled_ABI( int enabled, int allow_exceptions )
+{
+    ExecutionAnalytics::instance().set_enabled( static_cast<bool>(enabled) );
+    return 0;
+}
+
+int
+Execute_IsAnalyticsEnabled_ABI( int *enabled, int allow_exceptions )
+{
+    CHECK_PTR(enabled, "enabled", allow_exceptions);
+
+    *enabled = static_cast<int>( ExecutionAnalytics::instance().is_enabled() );
+    return 0;
+}
+
+int
+Execute_AnalyticsAddOrders_ABI( const char* orders_json,
+                                int allow_exceptions )
+{
+    CHECK_PTR(orders_json, "orders json", allow_exceptions);
+
+    static auto meth = +[]( const char* s ){
+        json j;
+        try{
+            j = json::parse(s);
+        }catch( json::exception& e ){
+            TDMA_API_THROW( ValueException,
+                            "invalid orders json: " + string(e.what()) );
+        }
+        ExecutionAnalytics::instance().add_orders(j);
+    };
+
+    return CallImplFromABI( allow_exceptions, meth, orders_json );
+}
+
+int
+Execute_GetAnalyticsStats_ABI( const char* symbol,
+                               int order_type,
+                               int time_bucket,
+                               ExecuteAnalyticsStats *pstats,
+                               int allow_exceptions )
+{
+    CHECK_PTR(pstats, "stats", allow_exceptions);
+
+    static auto meth = +[]( const char* s, int ot, int tb ){
+        return ExecutionAnalytics::instance().get_stats( s ? s : "", ot, tb );
+    };
+
+    int err;
+    std::tie(*pstats, err) = CallImplFromABI( allow_exceptions, meth, symbol,
+                                              order_type, time_bucket );
+    return err;
+}
+
+int
+Execute_ResetAnalytics_ABI( int allow_exceptions )
+{
+    ExecutionAnalytics::instance().reset();
+    return 0;
+}
+
+int
+Execute_PaperAddAccount_ABI( const char* account_id, int allow_exceptions )
+{
+    CHECK_PTR(account_id, "account id", allow_exceptions);
+
+    static auto meth = +[]( const char* id ){
+        PaperBroker::instance().add_account(id);
+    };
+
+    return CallImplFromABI( allow_exceptions, meth, account_id );
+}
+
+int
+Execute_PaperRemoveAccount_ABI( const char* account_id,
+                                int allow_exceptions )
+{
+    CHECK_PTR(account_id, "account id", allow_exceptions);
+
+    static auto meth = +[]( const char* id ){
+        PaperBroker::instance().remove_account(id);
+    };
+
+    return CallImplFromABI( allow_exceptions, meth, account_id );
+}
+
+int
+Execute_PaperIsAccount_ABI( const char* account_id,
+                            int *is_account,
+                            int allow_exceptions )
+{
+    CHECK_PTR(account_id, "account id", allow_exceptions);
+    CHECK_PTR(is_account, "is_account", allow_exceptions);
+
+    *is_account = static_cast<int>(
+        PaperBroker::instance().is_account(account_id)
+        );
+    return 0;
+}
+
+int
+Execute_PaperSetLatency_ABI( const char* account_id,
+                             unsigned long msec,
+                             int allow_exceptions )
+{
+    CHECK_PTR(account_id, "account id", allow_exceptions);
+
+    static auto meth = +[]( const char* id, unsigned long ms ){
+        PaperBroker::instance().set_latency( id,
+                                             std::chrono::milliseconds(ms) );
+    };
+
+    return CallImplFromABI( allow_exceptions, meth, account_id, msec );
+}
+
+int
+Execute_PaperGetLatency_ABI( const char* account_id,
+                             unsigned long *msec,
+                             int allow_exceptions )
+{
+    CHECK_PTR(account_id, "account id", allow_exceptions);
+    CHECK_PTR(msec, "msec", allow_exceptions);
+
+    static auto meth = +[]( const char* id ){
+        return static_cast<unsigned long>(
+            PaperBroker::instance().get_latency(id).count()
+            );
+    };
+
+    int err;
+    std::tie(*msec, err) = CallImplFromABI( allow_exceptions, meth,
+                                            account_id );
+    return err;
+}
+
+int
+Execute_PaperSetFillModel_ABI( const char* account_id,
+                               int fill_model,
+                               int allow_exceptions )
+{
+    CHECK_PTR(account_id, "account id", allow_exceptions);
+    CHECK_ENUM(PaperFillModel, fill_model, allow_exceptions);
+
+    static auto meth = +[]( const char* id, int fm ){
+        PaperBroker::instance().set_fill_model(
+            id, static_cast<PaperFillModel>(fm)
+            );
+    };
+
+    return CallImplFromABI( allow_exceptions, meth, account_id, fill_model );
+}
+
+int
+Execute_PaperGetFillModel_ABI( const char* account_id,
+                               int *fill_model,
+                               int allow_exceptions )
+{
+    CHECK_PTR(account_id, "account id", allow_exceptions);
+    CHECK_PTR(fill_model, "fill model", allow_exceptions);
+
+    static auto meth = +[]( const char* id ){
+        return static_cast<int>( PaperBroker::instance().get_fill_model(id) );
+    };
+
+    int err;
+    std::tie(*fill_model, err) = CallImplFromABI( allow_exceptions, meth,
+                                                  account_id );
+    return err;
+}
+
+int
+Execute_PaperSetLiveQuotes_ABI( int live, int allow_exceptions )
+{
+    PaperBroker::instance().set_live_quotes( static_cast<bool>(live) );
+    return 0;
+}
+
+int
+Execute_PaperGetLiveQuotes_ABI( int *live, int allow_exceptions )
+{
+    CHECK_PTR(live, "live", allow_exceptions);
+
+    *live = static_cast<int>( PaperBroker::instance().get_live_quotes() );
+    return 0;
+}
+
+int
+Execute_PaperSetQuote_ABI( const char* symbol,
+                           double bid,
+                           double ask,
+                           double bid_size,
+                           double ask_size,
+                           unsigned long long timestamp,
+                           int allow_exceptions )
+{
+    CHECK_PTR(symbol, "symbol", allow_exceptions);
+
+    static auto meth = +[]( const char* s, double b, double a, double bs,
+                            double as, unsigned long long ts ){
+        PaperBroker::instance().set_quote(s, b, a, bs, as, ts);
+    };
+
+    return CallImplFromABI( allow_exceptions, meth, symbol, bid, ask,
+                            bid_size, ask_size, timestamp );
+}
+
+int
+Execute_PaperReplay_ABI( int service,
+                         unsigned long long timestamp,
+                         const char* content_json,
+                         int allow_exceptions )
+{
+    CHECK_ENUM(StreamerServiceType, service, allow_exceptions);
+    CHECK_PTR(content_json, "content json", allow_exceptions);
+
+    static auto meth = +[]( int s, unsigned long long ts, const char* c ){
+        json j;
+        try{
+            j = json::parse(c);
+        }catch( json::exception& e ){
+            TDMA_API_THROW( ValueException,
+                            "invalid content json: " + string(e.what()) );
+        }
+        PaperBroker::instance().replay( static_cast<StreamerServiceType>(s),
+                                        ts, j );
+    };
+
+    return CallImplFromABI( allow_exceptions, meth, service, timestamp,
+                            content_json );
+}
+
+int
+Execute_PaperSetActivityCallback_ABI( paper_activity_cb_ty callback,
+                                      int allow_exceptions )
+{
+    PaperBroker::instance().set_activity_callback(callback);
+    return 0;
+}
+
 
 int
 OrderSession_to_string_ABI( TDMA_API_TO_STRING_ABI_ARGS )
@@ -341,3 +751,20 @@ OrderStrategyType_to_string_ABI( TDMA_API_TO_STRING_ABI_ARGS )
     }
 }
 
+int
+PaperFillModel_to_string_ABI( TDMA_API_TO_STRING_ABI_ARGS )
+{
+    CHECK_ENUM(PaperFillModel, v, allow_exceptions);
+
+    switch(static_cast<PaperFillModel>(v)){
+    case PaperFillModel::TOUCH:
+        return to_new_char_buffer("TOUCH", buf, n, allow_exceptions);
+    case PaperFillModel::THROUGH:
+        return to_new_char_buffer("THROUGH", buf, n, allow_exceptions);
+    case PaperFillModel::DISPLAYED_SIZE:
+        return to_new_char_buffer("DISPLAYED_SIZE", buf, n, allow_exceptions);
+    default:
+        throw std::runtime_error("Invalid PaperFillModel");
+    }
+}
+
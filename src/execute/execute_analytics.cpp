@@ -0,0 +1,525 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+#include "../../include/_execute_analytics.h"
+#include "../../include/_execute.h"
+
+using std::string;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+namespace {
+
+const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+const string QUOTE_BID = std::to_string(
+    static_cast<int>(tdma::QuotesSubscriptionField::bid_price) );
+const string QUOTE_ASK = std::to_string(
+    static_cast<int>(tdma::QuotesSubscriptionField::ask_price) );
+const string OPTION_BID = std::to_string(
+    static_cast<int>(tdma::OptionsSubscriptionField::bid_price) );
+const string OPTION_ASK = std::to_string(
+    static_cast<int>(tdma::OptionsSubscriptionField::ask_price) );
+
+/* ACCT_ACTIVITY fields */
+const string ACTIVITY_MSG_TYPE = "2";
+const string ACTIVITY_MSG_DATA = "3";
+
+const long long SECONDS_PER_TIME_BUCKET =
+    24 * 60 * 60 / EXECUTE_ANALYTICS_TIME_BUCKETS;
+
+/*
+ * text of the first <tag>..</tag> at/after 'from'; "" if none (the
+ * messages are small and flat enough not to need a real parser)
+ */
+string
+xml_text(const string& xml, const string& tag, size_t from = 0)
+{
+    string open = "<" + tag + ">";
+    size_t b = xml.find(open, from);
+    if( b == string::npos )
+        return "";
+    b += open.size();
+    size_t e = xml.find("</" + tag + ">", b);
+    return e == string::npos ? "" : xml.substr(b, e - b);
+}
+
+double
+to_double(const string& s)
+{ return s.empty() ? NaN : strtod(s.c_str(), nullptr); }
+
+int
+side_of(tdma::OrderInstruction instruction)
+{
+    using tdma::OrderInstruction;
+    switch( instruction ){
+    case OrderInstruction::BUY:
+    case OrderInstruction::BUY_TO_COVER:
+    case OrderInstruction::BUY_TO_OPEN:
+    case OrderInstruction::BUY_TO_CLOSE:
+        return 1;
+    case OrderInstruction::SELL:
+    case OrderInstruction::SELL_SHORT:
+    case OrderInstruction::SELL_TO_OPEN:
+    case OrderInstruction::SELL_TO_CLOSE:
+        return -1;
+    default:
+        return 0;
+    }
+}
+
+void
+record(ExecuteLatencyHistogram& h, long long usec)
+{
+    unsigned long long u = usec > 0 ? static_cast<unsigned long long>(usec)
+                                    : 0;
+    if( h.count == 0 || u < h.min_usec )
+        h.min_usec = u;
+    if( u > h.max_usec )
+        h.max_usec = u;
+    h.total_usec += u;
+    ++h.count;
+
+    int i = 0;
+    while( i < EXECUTE_ANALYTICS_LATENCY_BUCKETS - 1 && (u >> (i + 1)) )
+        ++i;
+    ++h.buckets[i];
+}
+
+void
+merge(ExecuteLatencyHistogram& to, const ExecuteLatencyHistogram& from)
+{
+    if( from.count == 0 )
+        return;
+    if( to.count == 0 || from.min_usec < to.min_usec )
+        to.min_usec = from.min_usec;
+    if( from.max_usec > to.max_usec )
+        to.max_usec = from.max_usec;
+    to.total_usec += from.total_usec;
+    to.count += from.count;
+    for( int i = 0; i < EXECUTE_ANALYTICS_LATENCY_BUCKETS; ++i )
+        to.buckets[i] += from.buckets[i];
+}
+
+} /* namespace */
+
+
+namespace tdma{
+
+const size_t ExecutionAnalytics::MAX_PENDING = 100000;
+const size_t ExecutionAnalytics::MAX_EARLY = 1000;
+
+
+ExecutionAnalytics::ExecutionAnalytics()
+    :
+        _enabled(false)
+    {
+    }
+
+
+ExecutionAnalytics&
+ExecutionAnalytics::instance()
+{
+    static ExecutionAnalytics analytics;
+    return analytics;
+}
+
+
+void
+ExecutionAnalytics::set_enabled(bool enabled)
+{
+    std::lock_guard<std::mutex> _(_mtx);
+    if( !enabled ){
+        /* a stale quote/ack is worse than none when re-enabled */
+        _quotes.clear();
+        _early.clear();
+        _early_order.clear();
+    }
+    _enabled.store(enabled, std::memory_order_relaxed);
+}
+
+
+ExecutionAnalytics::Send
+ExecutionAnalytics::begin_send(const OrderTicketImpl& order) const
+{
+    Send send{false, "", 0, 0, NaN, NaN, 0, clock_ty::time_point()};
+    if( !is_enabled() )
+        return send;
+
+    std::vector<OrderLegImpl> legs = order.get_legs();
+    if( !legs.empty() )
+        send.symbol = util::toupper( legs[0].get_symbol() );
+    send.order_type = static_cast<int>(order.get_type());
+    if( legs.size() == 1 )
+        send.side = side_of( legs[0].get_instruction() );
+
+    if( send.side ){
+        std::lock_guard<std::mutex> _(_mtx);
+        auto q = _quotes.find(send.symbol);
+        if( q != _quotes.end() ){
+            send.bid = q->second.first;
+            send.ask = q->second.second;
+        }
+    }
+
+    long long sec = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch() ).count();
+    send.time_bucket = static_cast<int>(
+        (sec % (24 * 60 * 60)) / SECONDS_PER_TIME_BUCKET );
+    send.valid = true;
+    send.tp = clock_ty::now();
+    return send;
+}
+
+
+void
+ExecutionAnalytics::end_send(const Send& send, const string& order_id)
+{
+    if( !send.valid || order_id.empty() )
+        return;
+
+    std::lock_guard<std::mutex> _(_mtx);
+
+    Cell& cell = _cells[ std::make_tuple(send.symbol, send.order_type,
+                                         send.time_bucket) ];
+    ++cell.stats.norders;
+
+    Order& order = _pending[order_id];
+    order = Order{send, &cell, false, false, clock_ty::time_point(), 0, 0};
+    _pending_order.push_back(order_id);
+    while( _pending_order.size() > MAX_PENDING ){
+        _pending.erase( _pending_order.front() );
+        _pending_order.pop_front();
+    }
+
+    auto e = _early.find(order_id);
+    if( e == _early.end() )
+        return;
+
+    bool done = false;
+    for( auto& event : e->second ){
+        if( !_apply(order, event) ){
+            done = true;
+            break;
+        }
+    }
+    _early.erase(e);
+    if( done )
+        _pending.erase(order_id);
+}
+
+
+void
+ExecutionAnalytics::update(StreamerServiceType service, const json& content)
+{
+    if( !is_enabled() )
+        return;
+
+    switch( service ){
+    case StreamerServiceType::QUOTE:
+    case StreamerServiceType::OPTION:
+        _update_quotes(service, content);
+        break;
+    case StreamerServiceType::ACCT_ACTIVITY:
+        _update_activity(content);
+        break;
+    default:
+        break;
+    }
+}
+
+
+void
+ExecutionAnalytics::_update_quotes( StreamerServiceType service,
+                                    const json& content )
+{
+    bool option = (service == StreamerServiceType::OPTION);
+    const string& bid_field = option ? OPTION_BID : QUOTE_BID;
+    const string& ask_field = option ? OPTION_ASK : QUOTE_ASK;
+
+    std::lock_guard<std::mutex> _(_mtx);
+
+    for( auto& item : content ){
+        auto k = item.find("key");
+        if( k == item.end() || !k->is_string() )
+            continue;
+
+        auto b = item.find(bid_field);
+        auto a = item.find(ask_field);
+        bool has_bid = (b != item.end() && b->is_number());
+        bool has_ask = (a != item.end() && a->is_number());
+        if( !(has_bid || has_ask) )
+            continue;
+
+        auto& q = _quotes.emplace( k->get_ref<const string&>(),
+                                   std::make_pair(NaN, NaN) ).first->second;
+        if( has_bid )
+            q.first = b->get<double>();
+        if( has_ask )
+            q.second = a->get<double>();
+    }
+}
+
+
+void
+ExecutionAnalytics::_update_activity(const json& content)
+{
+    auto now = clock_ty::now();
+
+    std::lock_guard<std::mutex> _(_mtx);
+
+    for( auto& item : content ){
+        auto t = item.find(ACTIVITY_MSG_TYPE);
+        auto d = item.find(ACTIVITY_MSG_DATA);
+        if( t == item.end() || d == item.end()
+            || !t->is_string() || !d->is_string() )
+        {
+            continue;
+        }
+
+        const string& type = t->get_ref<const string&>();
+        const string& xml = d->get_ref<const string&>();
+
+        Event event{EventType::ack, now, 0, 0, false};
+        if( type == "OrderEntryRequest" ){
+            event.type = EventType::ack;
+        }else if( type == "OrderFill" || type == "OrderPartialFill" ){
+            size_t exec = xml.find("<ExecutionInformation");
+            if( exec == string::npos )
+                continue;
+            event.type = EventType::fill;
+            event.quantity = to_double( xml_text(xml, "Quantity", exec) );
+            event.price = to_double( xml_text(xml, "ExecutionPrice", exec) );
+            if( !(event.quantity > 0) || std::isnan(event.price) )
+                continue;
+            event.final = (type == "OrderFill"
+                || to_double( xml_text(xml, "LeavesQuantity", exec) ) == 0);
+        }else if( type == "OrderRejection" ){
+            event.type = EventType::reject;
+        }else if( type == "UROUT" ){
+            event.type = EventType::out;
+        }else{
+            continue;
+        }
+
+        string order_id = xml_text(xml, "OrderKey");
+        if( order_id.empty() )
+            continue;
+
+        auto p = _pending.find(order_id);
+        if( p != _pending.end() ){
+            if( !_apply(p->second, event) )
+                _pending.erase(p);
+            continue;
+        }
+
+        /* send hasn't returned yet (or isn't ours) */
+        auto& early = _early[order_id];
+        if( early.empty() )
+            _early_order.push_back(order_id);
+        early.push_back(event);
+        while( _early_order.size() > MAX_EARLY ){
+            _early.erase( _early_order.front() );
+            _early_order.pop_front();
+        }
+    }
+}
+
+
+bool
+ExecutionAnalytics::_apply(Order& order, const Event& event)
+{
+    ExecuteAnalyticsStats& stats = order.cell->stats;
+
+    switch( event.type ){
+    case EventType::ack:
+        if( !order.acked ){
+            order.acked = true;
+            order.ack_tp = event.tp;
+            ++stats.nacks;
+            record( stats.send_to_ack, duration_cast<microseconds>(
+                        event.tp - order.send.tp ).count() );
+        }
+        return true;
+
+    case EventType::fill:
+        if( order.acked && !order.fill_timed ){
+            order.fill_timed = true;
+            record( stats.ack_to_fill, duration_cast<microseconds>(
+                        event.tp - order.ack_tp ).count() );
+        }
+        /* only what add_orders hasn't already counted */
+        order.activity_quantity += event.quantity;
+        if( order.activity_quantity > order.fill_quantity ){
+            double q = order.activity_quantity - order.fill_quantity;
+            _add_fill(order, q, q * event.price);
+        }
+        return !event.final;
+
+    case EventType::reject:
+        ++stats.nrejects;
+        return false;
+
+    case EventType::out:
+    default:
+        return false;
+    }
+}
+
+
+void
+ExecutionAnalytics::_add_fill(Order& order, double quantity, double notional)
+{
+    Cell& cell = *order.cell;
+    if( order.fill_quantity == 0 )
+        ++cell.stats.nfilled;
+    order.fill_quantity += quantity;
+    cell.stats.filled_quantity += quantity;
+
+    const Send& send = order.send;
+    if( !send.side || !(send.bid > 0) || !(send.ask > 0) )
+        return;
+
+    double mid = (send.bid + send.ask) / 2;
+    double slippage = send.side * (notional / quantity - mid);
+    cell.stats.slippage_quantity += quantity;
+    cell.slippage_total += slippage * quantity;
+    cell.slippage_bps_total += slippage / mid * 10000 * quantity;
+}
+
+
+void
+ExecutionAnalytics::add_orders(const json& orders)
+{
+    if( orders.is_array() ){
+        for( auto& o : orders )
+            add_orders(o);
+        return;
+    }
+    if( !orders.is_object() )
+        TDMA_API_THROW(ValueException, "orders not an object or array");
+
+    auto i = orders.find("orderId");
+    if( i == orders.end() )
+        return;
+    string order_id = i->is_string() ? i->get<string>() : i->dump();
+
+    std::lock_guard<std::mutex> _(_mtx);
+
+    auto p = _pending.find(order_id);
+    if( p == _pending.end() )
+        return;
+    Order& order = p->second;
+
+    double quantity = 0, notional = 0;
+    auto activities = orders.find("orderActivityCollection");
+    if( activities != orders.end() && activities->is_array() ){
+        for( auto& a : *activities ){
+            if( a.value("activityType", "") != "EXECUTION" )
+                continue;
+            auto legs = a.find("executionLegs");
+            if( legs == a.end() || !legs->is_array() )
+                continue;
+            for( auto& l : *legs ){
+                double q = l.value("quantity", 0.0);
+                quantity += q;
+                notional += q * l.value("price", 0.0);
+            }
+        }
+    }
+
+    /* only what ACCT_ACTIVITY hasn't already reported, at the avg price */
+    if( quantity > order.fill_quantity ){
+        double q = quantity - order.fill_quantity;
+        _add_fill(order, q, q * notional / quantity);
+    }
+
+    string status = orders.value("status", "");
+    if( status == "REJECTED" )
+        ++order.cell->stats.nrejects;
+    if( status == "FILLED" || status == "CANCELED" || status == "EXPIRED"
+        || status == "REPLACED" || status == "REJECTED" )
+    {
+        _pending.erase(p);
+    }
+}
+
+
+ExecuteAnalyticsStats
+ExecutionAnalytics::get_stats( const string& symbol,
+                               int order_type,
+                               int time_bucket ) const
+{
+    if( time_bucket < EXECUTE_ANALYTICS_ANY
+        || time_bucket >= EXECUTE_ANALYTICS_TIME_BUCKETS )
+    {
+        TDMA_API_THROW(ValueException, "invalid time bucket");
+    }
+
+    string sym = util::toupper(symbol);
+    ExecuteAnalyticsStats stats{};
+    double slippage_total = 0, slippage_bps_total = 0;
+
+    std::lock_guard<std::mutex> _(_mtx);
+
+    for( auto& c : _cells ){
+        if( (!sym.empty() && std::get<0>(c.first) != sym)
+            || (order_type != EXECUTE_ANALYTICS_ANY
+                && std::get<1>(c.first) != order_type)
+            || (time_bucket != EXECUTE_ANALYTICS_ANY
+                && std::get<2>(c.first) != time_bucket) )
+        {
+            continue;
+        }
+
+        const ExecuteAnalyticsStats& s = c.second.stats;
+        stats.norders += s.norders;
+        stats.nacks += s.nacks;
+        stats.nrejects += s.nrejects;
+        stats.nfilled += s.nfilled;
+        merge(stats.send_to_ack, s.send_to_ack);
+        merge(stats.ack_to_fill, s.ack_to_fill);
+        stats.filled_quantity += s.filled_quantity;
+        stats.slippage_quantity += s.slippage_quantity;
+        slippage_total += c.second.slippage_total;
+        slippage_bps_total += c.second.slippage_bps_total;
+    }
+
+    if( stats.slippage_quantity > 0 ){
+        stats.avg_slippage = slippage_total / stats.slippage_quantity;
+        stats.avg_slippage_bps = slippage_bps_total / stats.slippage_quantity;
+    }
+    return stats;
+}
+
+
+void
+ExecutionAnalytics::reset()
+{
+    std::lock_guard<std::mutex> _(_mtx);
+    _cells.clear();
+    _pending.clear();
+    _pending_order.clear();
+    _early.clear();
+    _early_order.clear();
+}
+
+} /* tdma */
@@ -63,8 +63,16 @@ OrderTicketImpl::OrderTicketImpl()
         _price( 0.0 ),
         _stop_price( 0.0 )
     {
+        _serialize();
     }
 
+OrderTicketImpl&
+OrderTicketImpl::_serialize()
+{
+    _json_string = as_json().dump();
+    return *this;
+}
+
 bool
 OrderTicketImpl::operator!=(const OrderTicketImpl& other) const
 {
@@ -129,17 +137,13 @@ OrderTicketImpl::as_json() const
     return j;
 }
 
-string
-OrderTicketImpl::as_json_string() const
-{ return as_json().dump(); }
-
 OrderSession
 OrderTicketImpl::get_session() const
 { return _session; }
 
 OrderTicketImpl&
 OrderTicketImpl::set_session(OrderSession session)
-{ _session = session; return *this; }
+{ _session = session; return _serialize(); }
 
 OrderDuration
 OrderTicketImpl::get_duration() const
@@ -147,7 +151,7 @@ OrderTicketImpl::get_duration() const
 
 OrderTicketImpl&
 OrderTicketImpl::set_duration(OrderDuration duration)
-{ _duration = duration; return *this; }
+{ _duration = duration; return _serialize(); }
 
 string
 OrderTicketImpl::get_cancel_time() const
@@ -155,7 +159,7 @@ OrderTicketImpl::get_cancel_time() const
 
 OrderTicketImpl&
 OrderTicketImpl::set_cancel_time(const string& cancel_time)
-{ _cancel_time = cancel_time; return *this; }
+{ _cancel_time = cancel_time; return _serialize(); }
 
 OrderType
 OrderTicketImpl::get_type() const
@@ -163,7 +167,7 @@ OrderTicketImpl::get_type() const
 
 OrderTicketImpl&
 OrderTicketImpl::set_type(OrderType order_type)
-{ _type = order_type; return *this; }
+{ _type = order_type; return _serialize(); }
 
 ComplexOrderStrategyType
 OrderTicketImpl::get_complex_strategy_type() const
@@ -172,7 +176,7 @@ OrderTicketImpl::get_complex_strategy_type() const
 OrderTicketImpl&
 OrderTicketImpl::set_complex_strategy_type(
     ComplexOrderStrategyType complex_strategy_type)
-{ _complex_strategy_type = complex_strategy_type; return *this; }
+{ _complex_strategy_type = complex_strategy_type; return _serialize(); }
 
 OrderStrategyType
 OrderTicketImpl::get_strategy_type() const
@@ -180,7 +184,7 @@ OrderTicketImpl::get_strategy_type() const
 
 OrderTicketImpl&
 OrderTicketImpl::set_strategy_type(OrderStrategyType order_strategy_type)
-{ _strategy_type = order_strategy_type; return *this; }
+{ _strategy_type = order_strategy_type; return _serialize(); }
 
 vector<OrderLegImpl>
 OrderTicketImpl::get_legs() const
@@ -196,14 +200,14 @@ OrderTicketImpl::get_leg(size_t n) const
 
 OrderTicketImpl&
 OrderTicketImpl::add_leg(const OrderLegImpl& leg)
-{ _legs.emplace_back(leg); return *this; }
+{ _legs.emplace_back(leg); return _serialize(); }
 
 OrderTicketImpl&
 OrderTicketImpl::add_legs(const vector<OrderLegImpl>& legs)
 {
     for(auto& l : legs)
         _legs.emplace_back(l);
-    return *this;
+    return _serialize();
 }
 
 OrderTicketImpl&
@@ -212,7 +216,7 @@ OrderTicketImpl::remove_leg(size_t n)
     if( n >= _legs.size() )
         TDMA_API_THROW(ValueException, "invalid leg position");
     _legs.erase( _legs.cbegin() + n );
-    return *this;
+    return _serialize();
 }
 
 OrderTicketImpl&
@@ -221,12 +225,12 @@ OrderTicketImpl::replace_leg(size_t n, OrderLegImpl leg)
     if( n >= _legs.size() )
         TDMA_API_THROW(ValueException, "invalid leg position");
     _legs[n] = leg;
-    return *this;
+    return _serialize();
 }
 
 OrderTicketImpl&
 OrderTicketImpl::clear_legs()
-{ _legs.clear(); return *this; }
+{ _legs.clear(); return _serialize(); }
 
 vector<OrderTicketImpl>
 OrderTicketImpl::get_children() const
@@ -234,11 +238,11 @@ OrderTicketImpl::get_children() const
 
 OrderTicketImpl&
 OrderTicketImpl::add_child(const OrderTicketImpl& child)
-{ _children.emplace_back(child); return *this; }
+{ _children.emplace_back(child); return _serialize(); }
 
 OrderTicketImpl&
 OrderTicketImpl::clear_children()
-{ _children.clear(); return *this; }
+{ _children.clear(); return _serialize(); }
 
 double
 OrderTicketImpl::get_price() const
@@ -246,7 +250,7 @@ OrderTicketImpl::get_price() const
 
 OrderTicketImpl&
 OrderTicketImpl::set_price(double price)
-{ _price = price; return *this; }
+{ _price = price; return _serialize(); }
 
 double
 OrderTicketImpl::get_stop_price() const
@@ -254,7 +258,7 @@ OrderTicketImpl::get_stop_price() const
 
 OrderTicketImpl&
 OrderTicketImpl::set_stop_price(double stop_price)
-{ _stop_price = stop_price; return *this; }
+{ _stop_price = stop_price; return _serialize(); }
 
 typename OrderTicketImpl::ProxyType::CType // need to call Destroy when done
 OrderTicketImpl::as_ctype() const
@@ -0,0 +1,1245 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include <cmath>
+#include <ctime>
+#include <limits>
+#include <algorithm>
+
+#include "../../include/_paper_broker.h"
+#include "../../include/_execute_analytics.h"
+
+using std::string;
+using std::vector;
+using std::chrono::milliseconds;
+
+namespace {
+
+const double NaN = std::numeric_limits<double>::quiet_NaN();
+const double INF = std::numeric_limits<double>::infinity();
+/* net prices are sums of quotes; don't miss a fill by a rounding error */
+const double NET_EPSILON = 1e-9;
+
+const string QUOTE_BID = std::to_string(
+    static_cast<int>(tdma::QuotesSubscriptionField::bid_price) );
+const string QUOTE_ASK = std::to_string(
+    static_cast<int>(tdma::QuotesSubscriptionField::ask_price) );
+const string QUOTE_BID_SIZE = std::to_string(
+    static_cast<int>(tdma::QuotesSubscriptionField::bid_size) );
+const string QUOTE_ASK_SIZE = std::to_string(
+    static_cast<int>(tdma::QuotesSubscriptionField::ask_size) );
+const string OPTION_BID = std::to_string(
+    static_cast<int>(tdma::OptionsSubscriptionField::bid_price) );
+const string OPTION_ASK = std::to_string(
+    static_cast<int>(tdma::OptionsSubscriptionField::ask_price) );
+const string OPTION_BID_SIZE = std::to_string(
+    static_cast<int>(tdma::OptionsSubscriptionField::bid_size) );
+const string OPTION_ASK_SIZE = std::to_string(
+    static_cast<int>(tdma::OptionsSubscriptionField::ask_size) );
+
+/* built once from the to_string ABIs so parsing an order doesn't call them */
+template<typename E>
+std::unordered_map<string, E>
+enum_names()
+{
+    std::unordered_map<string, E> m;
+    for( int i = tdma::enum_bounds<E>::low; i <= tdma::enum_bounds<E>::high;
+         ++i )
+    {
+        m.emplace( tdma::to_string(static_cast<E>(i)), static_cast<E>(i) );
+    }
+    return m;
+}
+
+template<typename E>
+E
+enum_from_json(const json& j, const string& key, E def)
+{
+    static const std::unordered_map<string, E> names = enum_names<E>();
+
+    auto f = j.find(key);
+    if( f == j.end() )
+        return def;
+    auto n = f->is_string() ? names.find( f->get<string>() ) : names.end();
+    if( n == names.end() )
+        TDMA_API_THROW(tdma::ExecuteException, "invalid " + key);
+    return n->second;
+}
+
+/* the ticket serializes prices as strings */
+double
+price_from_json(const json& j, const string& key)
+{
+    auto f = j.find(key);
+    if( f == j.end() )
+        return NaN;
+    if( f->is_number() )
+        return f->get<double>();
+    if( f->is_string() ){
+        try{
+            return std::stod( f->get<string>() );
+        }catch( std::exception& ){
+        }
+    }
+    TDMA_API_THROW(tdma::ExecuteException, "invalid " + key);
+}
+
+string
+iso_time(unsigned long long msec)
+{
+    time_t t = static_cast<time_t>(msec / 1000);
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    char buf[32];
+    strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S+0000", &tm);
+    return buf;
+}
+
+long long
+gcd(long long a, long long b)
+{
+    while( b ){
+        long long t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+bool
+is_closed(tdma::OrderStatusType status)
+{
+    using tdma::OrderStatusType;
+    switch( status ){
+    case OrderStatusType::FILLED:
+    case OrderStatusType::CANCELED:
+    case OrderStatusType::REJECTED:
+    case OrderStatusType::REPLACED:
+    case OrderStatusType::EXPIRED:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void
+update_field(const json& item, const string& field, double& value)
+{
+    auto f = item.find(field);
+    if( f != item.end() && f->is_number() )
+        value = f->get<double>();
+}
+
+/* remove every 'o' (order doesn't matter) */
+template<typename T>
+void
+swap_remove(vector<T>& v, const T& o)
+{
+    for( size_t i = 0; i < v.size(); ){
+        if( v[i] == o ){
+            v[i] = v.back();
+            v.pop_back();
+        }else{
+            ++i;
+        }
+    }
+}
+
+} /* namespace */
+
+
+namespace tdma{
+
+const size_t PaperBroker::MAX_CLOSED_ORDERS = 100000;
+
+
+PaperBroker::PaperBroker()
+    :
+        _naccounts(0),
+        _live(true),
+        _now(0),
+        _next_id(1),
+        _next_exec_id(1),
+        _callback(nullptr),
+        _emitting(false),
+        _events( json::array() )
+    {
+    }
+
+
+PaperBroker&
+PaperBroker::instance()
+{
+    static PaperBroker broker;
+    return broker;
+}
+
+
+PaperBroker::Account&
+PaperBroker::_get_account(const string& account_id) const
+{
+    auto a = _accounts.find(account_id);
+    if( a == _accounts.end() )
+        TDMA_API_THROW(ValueException, "not a paper account: " + account_id);
+    return *a->second;
+}
+
+
+void
+PaperBroker::add_account(const string& account_id)
+{
+    if( account_id.empty() )
+        TDMA_API_THROW(ValueException, "empty account id");
+
+    std::lock_guard<std::mutex> _(_mtx);
+    if( _accounts.count(account_id) )
+        TDMA_API_THROW(ValueException, "paper account exists: " + account_id);
+
+    std::unique_ptr<Account> a(
+        new Account{account_id, milliseconds(0), PaperFillModel::TOUCH, {}, {}}
+        );
+    _accounts.emplace(account_id, std::move(a));
+    _naccounts = _accounts.size();
+}
+
+
+void
+PaperBroker::remove_account(const string& account_id)
+{
+    std::lock_guard<std::mutex> _(_mtx);
+
+    Account& account = _get_account(account_id);
+    /* out of the books/queue before the orders go away */
+    for( auto& o : account.orders ){
+        if( !is_closed(o.second->status) )
+            _unslot(*o.second);
+    }
+    _accounts.erase(account_id);
+    _naccounts = _accounts.size();
+}
+
+
+bool
+PaperBroker::is_account(const string& account_id) const
+{
+    if( _naccounts.load() == 0 )
+        return false;
+    std::lock_guard<std::mutex> _(_mtx);
+    return _accounts.count(account_id) > 0;
+}
+
+
+void
+PaperBroker::set_latency(const string& account_id, milliseconds latency)
+{
+    if( latency.count() < 0 )
+        TDMA_API_THROW(ValueException, "latency < 0");
+
+    std::lock_guard<std::mutex> _(_mtx);
+    _get_account(account_id).latency = latency;
+}
+
+
+milliseconds
+PaperBroker::get_latency(const string& account_id) const
+{
+    std::lock_guard<std::mutex> _(_mtx);
+    return _get_account(account_id).latency;
+}
+
+
+void
+PaperBroker::set_fill_model(const string& account_id, PaperFillModel model)
+{
+    std::lock_guard<std::mutex> _(_mtx);
+    _get_account(account_id).fill_model = model;
+}
+
+
+PaperFillModel
+PaperBroker::get_fill_model(const string& account_id) const
+{
+    std::lock_guard<std::mutex> _(_mtx);
+    return _get_account(account_id).fill_model;
+}
+
+
+void
+PaperBroker::set_activity_callback(paper_activity_cb_ty callback)
+{
+    std::lock_guard<std::mutex> _(_mtx);
+    _callback = callback;
+}
+
+
+int
+PaperBroker::_intern(const string& symbol)
+{
+    auto s = _symbol_ids.find(symbol);
+    if( s != _symbol_ids.end() )
+        return s->second;
+    int id = static_cast<int>(_books.size());
+    _symbol_ids.emplace(symbol, id);
+    _symbols.push_back(symbol);
+    _books.emplace_back();
+    _books.back().quote = Quote{NaN, NaN, NaN, NaN};
+    return id;
+}
+
+
+unsigned long long
+PaperBroker::_clock() const
+{
+    return _now ? _now
+                : static_cast<unsigned long long>(
+                      util::get_msec_since_epoch<std::chrono::system_clock>().count() );
+}
+
+
+void
+PaperBroker::_begin()
+{
+    _emitting = (_callback != nullptr)
+                || ExecutionAnalytics::instance().is_enabled();
+}
+
+
+void
+PaperBroker::_end(std::unique_lock<std::mutex>& lock)
+{
+    for( auto& a : _accounts )
+        _evict(*a.second);
+
+    if( _events.empty() ){
+        lock.unlock();
+        return;
+    }
+
+    json events = json::array();
+    events.swap(_events);
+    paper_activity_cb_ty callback = _callback;
+    unsigned long long now = _clock();
+    lock.unlock();
+
+    ExecutionAnalytics::instance().update( StreamerServiceType::ACCT_ACTIVITY,
+                                           events );
+    if( callback )
+        callback( now, events.dump().c_str() );
+}
+
+
+PaperBroker::Order*
+PaperBroker::_create( const json& j,
+                      Account& account,
+                      Order *parent,
+                      vector<std::unique_ptr<Order>>& nodes )
+{
+    if( !j.is_object() )
+        TDMA_API_THROW(ExecuteException, "order not an object");
+
+    nodes.emplace_back( new Order() );
+    Order& o = *nodes.back();
+    o.id = 0;
+    o.account = &account;
+    o.parent = parent;
+    o.root = parent ? parent->root : &o;
+    o.strategy = enum_from_json(j, "orderStrategyType",
+                                OrderStrategyType::SINGLE);
+    o.type = enum_from_json(j, "orderType", OrderType::NONE);
+    o.quantity = 0;
+    o.filled = 0;
+    o.price = price_from_json(j, "price");
+    o.stop_price = price_from_json(j, "stopPrice");
+    o.triggered = false;
+    o.status = OrderStatusType::QUEUED;
+    o.entered_msec = 0;
+    o.close_msec = 0;
+    o.slot = Slot::none;
+    o.queued = false;
+    o.nopen = 0;
+
+    auto legs = j.find("orderLegCollection");
+    if( o.strategy == OrderStrategyType::OCO ){
+        if( legs != j.end() )
+            TDMA_API_THROW(ExecuteException, "OCO order w/ legs");
+    }else{
+        if( legs == j.end() || !legs->is_array() || legs->empty() )
+            TDMA_API_THROW(ExecuteException, "order w/o legs");
+
+        long long g = 0;
+        vector<long long> quantities;
+        for( auto& l : *legs ){
+            auto ins = enum_from_json(l, "instruction", OrderInstruction::NONE);
+            long long q = l.value("quantity", 0LL);
+            string symbol;
+            auto inst = l.find("instrument");
+            if( inst != l.end() && inst->is_object() )
+                symbol = util::toupper( inst->value("symbol", "") );
+            if( symbol.empty() )
+                TDMA_API_THROW(ExecuteException, "leg w/o symbol");
+            if( q <= 0 )
+                TDMA_API_THROW(ExecuteException, "leg quantity <= 0");
+
+            int side;
+            switch( ins ){
+            case OrderInstruction::BUY:
+            case OrderInstruction::BUY_TO_COVER:
+            case OrderInstruction::BUY_TO_OPEN:
+            case OrderInstruction::BUY_TO_CLOSE:
+                side = 1;
+                break;
+            case OrderInstruction::SELL:
+            case OrderInstruction::SELL_SHORT:
+            case OrderInstruction::SELL_TO_OPEN:
+            case OrderInstruction::SELL_TO_CLOSE:
+                side = -1;
+                break;
+            default:
+                TDMA_API_THROW(ExecuteException, "invalid leg instruction");
+            }
+            o.legs.push_back( Leg{_intern(symbol), side, q} );
+            g = gcd(q, g);
+        }
+        for( auto& l : o.legs )
+            l.ratio /= g;
+        o.quantity = g;
+    }
+
+    json ticket = j;
+    ticket.erase("childOrderStrategies");
+    o.ticket = ticket.dump();
+
+    auto kids = j.find("childOrderStrategies");
+    if( kids != j.end() ){
+        if( !kids->is_array() )
+            TDMA_API_THROW(ExecuteException, "invalid childOrderStrategies");
+        for( auto& k : *kids )
+            o.children.push_back( _create(k, account, &o, nodes) );
+    }
+    if( o.strategy == OrderStrategyType::OCO && o.children.empty() )
+        TDMA_API_THROW(ExecuteException, "OCO order w/o children");
+
+    return &o;
+}
+
+
+bool
+PaperBroker::_is_supported(const Order& o) const
+{
+    if( o.strategy == OrderStrategyType::OCO )
+        return true;
+
+    bool has_price = !std::isnan(o.price);
+    bool has_stop = !std::isnan(o.stop_price);
+    if( o.legs.size() == 1 ){
+        switch( o.type ){
+        case OrderType::MARKET: return true;
+        case OrderType::LIMIT: return has_price;
+        case OrderType::STOP: return has_stop;
+        case OrderType::STOP_LIMIT: return has_price && has_stop;
+        default: return false;
+        }
+    }
+    switch( o.type ){
+    case OrderType::MARKET:
+    case OrderType::NET_ZERO: return true;
+    case OrderType::LIMIT:
+    case OrderType::NET_DEBIT:
+    case OrderType::NET_CREDIT: return has_price;
+    default: return false;
+    }
+}
+
+
+string
+PaperBroker::_send(Account& account, const json& j)
+{
+    vector<std::unique_ptr<Order>> nodes;
+    Order *root = _create(j, account, nullptr, nodes);
+
+    /* everything parsed, commit */
+    unsigned long long now = _clock();
+    bool supported = true;
+    for( auto& n : nodes ){
+        n->id = _next_id++;
+        n->entered_msec = now;
+        if( n->parent ){
+            n->status = (n->parent->strategy == OrderStrategyType::OCO)
+                      ? n->parent->status
+                      : OrderStatusType::AWAITING_PARENT_ORDER;
+        }
+        supported = supported && _is_supported(*n);
+    }
+    root->nopen = nodes.size();
+    for( auto& n : nodes ){
+        Order *o = n.get();
+        account.orders.emplace(o->id, std::move(n));
+        if( !o->legs.empty() )
+            _emit("OrderEntryRequest", *o, "");
+    }
+
+    if( !supported ){
+        vector<Order*> tree{root};
+        for( size_t i = 0; i < tree.size(); ++i ){
+            Order *o = tree[i];
+            tree.insert(tree.end(), o->children.begin(), o->children.end());
+            if( !o->legs.empty() )
+                _emit("OrderRejection", *o,
+                      "<RejectReason>order type not supported by paper"
+                      " broker</RejectReason>");
+            _close(*o, OrderStatusType::REJECTED);
+        }
+        return std::to_string(root->id);
+    }
+
+    root->queued = true;
+    root->queued_pos = _queued.emplace(now + account.latency.count(), root);
+    _activate_due();
+    return std::to_string(root->id);
+}
+
+
+void
+PaperBroker::_activate_due()
+{
+    unsigned long long now = _clock();
+    while( !_queued.empty() && _queued.begin()->first <= now ){
+        Order *o = _queued.begin()->second;
+        _queued.erase( _queued.begin() );
+        o->queued = false;
+        _activate(*o);
+    }
+}
+
+
+void
+PaperBroker::_activate(Order& o)
+{
+    if( is_closed(o.status) )
+        return;
+
+    o.status = OrderStatusType::WORKING;
+    if( o.strategy == OrderStrategyType::OCO ){
+        for( Order *c : o.children ){
+            _activate(*c);
+            if( is_closed(o.status) ) // a child filled
+                break;
+        }
+    }else if( o.legs.size() == 1 ){
+        _arrive_single(o);
+    }else if( !_try_spread(o, false) || !is_closed(o.status) ){
+        _place(o);
+    }
+}
+
+
+/* into the book it waits in */
+void
+PaperBroker::_place(Order& o)
+{
+    if( is_closed(o.status) || o.slot != Slot::none )
+        return;
+
+    if( o.legs.size() > 1 ){
+        vector<int> symbols;
+        for( auto& l : o.legs ){
+            if( std::find(symbols.begin(), symbols.end(), l.symbol)
+                == symbols.end() )
+            {
+                symbols.push_back(l.symbol);
+                _books[l.symbol].waiting.push_back(&o);
+            }
+        }
+        o.slot = Slot::waiting;
+        return;
+    }
+
+    const Leg& leg = o.legs[0];
+    Book& book = _books[leg.symbol];
+    bool stop = (o.type == OrderType::STOP || o.type == OrderType::STOP_LIMIT)
+                && !o.triggered;
+    bool limit = (o.type == OrderType::LIMIT || o.type == OrderType::STOP_LIMIT);
+    if( stop ){
+        if( leg.side > 0 ){
+            o.asc_pos = book.buy_stops.emplace(o.stop_price, &o);
+            o.slot = Slot::buy_stop;
+        }else{
+            o.desc_pos = book.sell_stops.emplace(o.stop_price, &o);
+            o.slot = Slot::sell_stop;
+        }
+    }else if( limit ){
+        if( leg.side > 0 ){
+            o.desc_pos = book.buy_limits.emplace(o.price, &o);
+            o.slot = Slot::buy_limit;
+        }else{
+            o.asc_pos = book.sell_limits.emplace(o.price, &o);
+            o.slot = Slot::sell_limit;
+        }
+    }else{
+        book.waiting.push_back(&o);
+        o.slot = Slot::waiting;
+    }
+}
+
+
+void
+PaperBroker::_arrive_single(Order& o)
+{
+    const Leg& leg = o.legs[0];
+    const Quote& q = _books[leg.symbol].quote;
+    double px = leg.side > 0 ? q.ask : q.bid;
+
+    if( (o.type == OrderType::STOP || o.type == OrderType::STOP_LIMIT)
+        && !o.triggered )
+    {
+        if( std::isnan(px)
+            || (leg.side > 0 ? px < o.stop_price : px > o.stop_price) )
+        {
+            _place(o);
+            return;
+        }
+        o.triggered = true;
+    }
+
+    bool limit = (o.type == OrderType::LIMIT || o.type == OrderType::STOP_LIMIT);
+    bool marketable = !std::isnan(px)
+        && (!limit || (leg.side > 0 ? px <= o.price : px >= o.price));
+    if( marketable ){
+        double size = leg.side > 0 ? q.ask_size : q.bid_size;
+        long long n = o.quantity - o.filled;
+        if( o.account->fill_model == PaperFillModel::DISPLAYED_SIZE
+            && !std::isnan(size) )
+        {
+            n = std::min( n, static_cast<long long>(size) );
+        }
+        if( n > 0 )
+            _fill(o, n, {px});
+    }
+    _place(o);
+}
+
+
+bool
+PaperBroker::_try_spread(Order& o, bool resting)
+{
+    PaperFillModel model = o.account->fill_model;
+    double debit = 0;
+    double units = INF;
+    vector<double> prices;
+    for( auto& l : o.legs ){
+        const Quote& q = _books[l.symbol].quote;
+        double px = l.side > 0 ? q.ask : q.bid;
+        if( std::isnan(px) )
+            return false;
+        prices.push_back(px);
+        debit += l.side * l.ratio * px;
+        double size = l.side > 0 ? q.ask_size : q.bid_size;
+        if( model == PaperFillModel::DISPLAYED_SIZE && !std::isnan(size) )
+            units = std::min(units, std::floor(size / l.ratio));
+    }
+
+    bool strict = resting && (model == PaperFillModel::THROUGH);
+    bool ok;
+    switch( o.type ){
+    case OrderType::MARKET:
+        ok = true;
+        break;
+    case OrderType::NET_CREDIT:
+        ok = strict ? (-debit > o.price + NET_EPSILON)
+                    : (-debit >= o.price - NET_EPSILON);
+        break;
+    case OrderType::NET_ZERO:
+        ok = strict ? (debit < -NET_EPSILON) : (debit <= NET_EPSILON);
+        break;
+    default: /* LIMIT, NET_DEBIT */
+        ok = strict ? (debit < o.price - NET_EPSILON)
+                    : (debit <= o.price + NET_EPSILON);
+        break;
+    }
+    if( !ok )
+        return false;
+
+    long long n = o.quantity - o.filled;
+    if( units < n )
+        n = static_cast<long long>(units);
+    if( n <= 0 )
+        return false;
+    _fill(o, n, prices);
+    return true;
+}
+
+
+void
+PaperBroker::_match(int symbol)
+{
+    Book& book = _books[symbol];
+    const Quote q = book.quote;
+    vector<Order*> hits;
+
+    /* stops first, they may become marketable */
+    if( !std::isnan(q.ask) ){
+        for( auto i = book.buy_stops.begin();
+             i != book.buy_stops.end() && i->first <= q.ask; ++i )
+        {
+            hits.push_back(i->second);
+        }
+    }
+    if( !std::isnan(q.bid) ){
+        for( auto i = book.sell_stops.begin();
+             i != book.sell_stops.end() && i->first >= q.bid; ++i )
+        {
+            hits.push_back(i->second);
+        }
+    }
+    for( Order *o : hits ){
+        if( o->slot != Slot::buy_stop && o->slot != Slot::sell_stop )
+            continue; // closed by an earlier one (OCO)
+        _unslot(*o);
+        o->triggered = true;
+        _arrive_single(*o);
+    }
+
+    /*
+     * resting limits fill at their price; DISPLAYED_SIZE orders share the
+     * displayed size, best price first
+     */
+    auto fill_resting = [&](double px, double size, bool buy){
+        double avail = std::isnan(size) ? INF : size;
+        for( Order *o : hits ){
+            if( o->slot != (buy ? Slot::buy_limit : Slot::sell_limit) )
+                continue;
+            PaperFillModel model = o->account->fill_model;
+            if( model == PaperFillModel::THROUGH
+                && (buy ? px >= o->price : px <= o->price) )
+            {
+                continue;
+            }
+            long long n = o->quantity - o->filled;
+            if( model == PaperFillModel::DISPLAYED_SIZE ){
+                n = std::min( n, static_cast<long long>(std::min(avail, 1e18)) );
+                if( n <= 0 )
+                    continue;
+                avail -= n;
+            }
+            _fill(*o, n, {o->price});
+        }
+    };
+
+    hits.clear();
+    if( !std::isnan(q.ask) ){
+        for( auto i = book.buy_limits.begin();
+             i != book.buy_limits.end() && i->first >= q.ask; ++i )
+        {
+            hits.push_back(i->second);
+        }
+        fill_resting(q.ask, q.ask_size, true);
+    }
+    hits.clear();
+    if( !std::isnan(q.bid) ){
+        for( auto i = book.sell_limits.begin();
+             i != book.sell_limits.end() && i->first <= q.bid; ++i )
+        {
+            hits.push_back(i->second);
+        }
+        fill_resting(q.bid, q.bid_size, false);
+    }
+
+    /* copy, fills/cancels change it */
+    hits = book.waiting;
+    for( Order *o : hits ){
+        if( o->slot != Slot::waiting )
+            continue;
+        if( o->legs.size() > 1 ){
+            _try_spread(*o, true);
+        }else{
+            _unslot(*o);
+            _arrive_single(*o);
+        }
+    }
+}
+
+
+void
+PaperBroker::_fill( Order& o,
+                    long long quantity,
+                    const vector<double>& prices )
+{
+    unsigned long long now = _clock();
+    bool first = (o.filled == 0);
+    o.filled += quantity;
+    o.executions.push_back( Execution{now, quantity, prices} );
+
+    if( _emitting ){
+        double px = 0;
+        for( size_t i = 0; i < o.legs.size(); ++i )
+            px += o.legs[i].side * o.legs[i].ratio * prices[i];
+        bool done = (o.filled == o.quantity);
+        _emit( done ? "OrderFill" : "OrderPartialFill", o,
+               "<ExecutionInformation><Type>"
+               + string(px >= 0 ? "BOUGHT" : "SOLD")
+               + "</Type><Timestamp>" + iso_time(now)
+               + "</Timestamp><Quantity>" + std::to_string(quantity)
+               + "</Quantity><ExecutionPrice>"
+               + util::to_fixedpoint_string(std::fabs(px))
+               + "</ExecutionPrice><AveragePriceIndicator>false"
+               "</AveragePriceIndicator><LeavesQuantity>"
+               + std::to_string(o.quantity - o.filled)
+               + "</LeavesQuantity><ID>" + std::to_string(_next_exec_id)
+               + "</ID><Exchange>PAPER</Exchange><BrokerId>PAPER</BrokerId>"
+               "</ExecutionInformation>" );
+    }
+    ++_next_exec_id;
+
+    Order *oco = (o.parent && o.parent->strategy == OrderStrategyType::OCO)
+               ? o.parent : nullptr;
+    if( first && oco ){
+        for( Order *s : oco->children ){
+            if( s != &o )
+                _cancel_tree(*s, OrderStatusType::CANCELED);
+        }
+    }
+
+    if( o.filled < o.quantity )
+        return;
+
+    _close(o, OrderStatusType::FILLED);
+    if( oco && !is_closed(oco->status) )
+        _close(*oco, OrderStatusType::FILLED);
+    _trigger_children(o);
+}
+
+
+/* activated w/o latency, on the next _activate_due */
+void
+PaperBroker::_trigger_children(Order& o)
+{
+    unsigned long long now = _clock();
+    for( Order *c : o.children ){
+        if( c->status != OrderStatusType::AWAITING_PARENT_ORDER )
+            continue;
+        c->status = OrderStatusType::QUEUED;
+        for( Order *cc : c->children ){
+            if( c->strategy == OrderStrategyType::OCO )
+                cc->status = OrderStatusType::QUEUED;
+        }
+        c->queued = true;
+        c->queued_pos = _queued.emplace(now, c);
+    }
+}
+
+
+void
+PaperBroker::_cancel_tree(Order& o, OrderStatusType status)
+{
+    for( Order *c : o.children ){
+        if( !is_closed(c->status) )
+            _cancel_tree(*c, OrderStatusType::CANCELED);
+    }
+    if( is_closed(o.status) )
+        return;
+    if( !o.legs.empty() ){
+        _emit("UROUT", o, "<CancelledQuantity>"
+              + std::to_string(o.quantity - o.filled)
+              + "</CancelledQuantity>");
+    }
+    _close(o, status);
+}
+
+
+void
+PaperBroker::_close(Order& o, OrderStatusType status)
+{
+    _unslot(o);
+    o.status = status;
+    o.close_msec = _clock();
+    if( --o.root->nopen == 0 )
+        o.account->closed.push_back(o.root->id);
+}
+
+
+void
+PaperBroker::_unslot(Order& o)
+{
+    if( o.queued ){
+        _queued.erase(o.queued_pos);
+        o.queued = false;
+    }
+
+    switch( o.slot ){
+    case Slot::buy_limit:
+        _books[o.legs[0].symbol].buy_limits.erase(o.desc_pos);
+        break;
+    case Slot::sell_limit:
+        _books[o.legs[0].symbol].sell_limits.erase(o.asc_pos);
+        break;
+    case Slot::buy_stop:
+        _books[o.legs[0].symbol].buy_stops.erase(o.asc_pos);
+        break;
+    case Slot::sell_stop:
+        _books[o.legs[0].symbol].sell_stops.erase(o.desc_pos);
+        break;
+    case Slot::waiting:
+        for( auto& l : o.legs )
+            swap_remove(_books[l.symbol].waiting, &o);
+        break;
+    case Slot::none:
+        break;
+    }
+    o.slot = Slot::none;
+}
+
+
+void
+PaperBroker::_evict(Account& account)
+{
+    while( account.closed.size() > MAX_CLOSED_ORDERS ){
+        auto r = account.orders.find( account.closed.front() );
+        account.closed.pop_front();
+        if( r != account.orders.end() )
+            _delete_tree(account, *r->second);
+    }
+}
+
+
+void
+PaperBroker::_delete_tree(Account& account, Order& o)
+{
+    for( Order *c : o.children )
+        _delete_tree(account, *c);
+    account.orders.erase(o.id);
+}
+
+
+void
+PaperBroker::_emit(const char* type, const Order& o, const string& body)
+{
+    if( !_emitting )
+        return;
+
+    const string& account = o.account->id;
+    string symbol = o.legs.empty() ? "" : _symbols[o.legs[0].symbol];
+    string xml = string("<") + type + "Message"
+        " xmlns=\"urn:xmlns:beb.ameritrade.com\"><OrderGroupID><Firm>PAPER"
+        "</Firm><Branch>PAPER</Branch><ClientKey>" + account
+        + "</ClientKey><AccountKey>" + account
+        + "</AccountKey></OrderGroupID><ActivityTimestamp>"
+        + iso_time(_clock()) + "</ActivityTimestamp><Order><OrderKey>"
+        + std::to_string(o.id) + "</OrderKey><Security><Symbol>" + symbol
+        + "</Symbol></Security><OrderType>" + to_string(o.type)
+        + "</OrderType><OriginalQuantity>" + std::to_string(o.quantity)
+        + "</OriginalQuantity><OrderEnteredDateTime>"
+        + iso_time(o.entered_msec) + "</OrderEnteredDateTime></Order>"
+        + body + "</" + type + "Message>";
+
+    _events.push_back( {{"1", account}, {"2", type}, {"3", xml}} );
+}
+
+
+json
+PaperBroker::_order_json(const Order& o) const
+{
+    json j = json::parse(o.ticket);
+    if( !std::isnan(o.price) )
+        j["price"] = o.price;
+    if( !std::isnan(o.stop_price) )
+        j["stopPrice"] = o.stop_price;
+
+    auto legs = j.find("orderLegCollection");
+    if( legs != j.end() ){
+        int leg_id = 0;
+        for( auto& l : *legs )
+            l["legId"] = ++leg_id;
+    }
+
+    bool cancelable = !is_closed(o.status);
+    j["orderId"] = o.id;
+    j["accountId"] = o.account->id;
+    j["status"] = to_string(o.status);
+    j["enteredTime"] = iso_time(o.entered_msec);
+    if( is_closed(o.status) )
+        j["closeTime"] = iso_time(o.close_msec);
+    j["quantity"] = o.quantity;
+    j["filledQuantity"] = o.filled;
+    j["remainingQuantity"] = o.quantity - o.filled;
+    j["cancelable"] = cancelable;
+    j["editable"] = cancelable;
+
+    if( !o.executions.empty() ){
+        json activities = json::array();
+        long long filled = 0;
+        for( auto& e : o.executions ){
+            filled += e.quantity;
+            json exec_legs = json::array();
+            for( size_t i = 0; i < o.legs.size(); ++i ){
+                exec_legs.push_back({
+                    {"legId", i + 1},
+                    {"quantity", e.quantity * o.legs[i].ratio},
+                    {"mismarkedQuantity", 0},
+                    {"price", e.prices[i]},
+                    {"time", iso_time(e.msec)}
+                });
+            }
+            activities.push_back({
+                {"activityType", "EXECUTION"},
+                {"executionType", "FILL"},
+                {"quantity", e.quantity},
+                {"orderRemainingQuantity", o.quantity - filled},
+                {"executionLegs", exec_legs}
+            });
+        }
+        j["orderActivityCollection"] = activities;
+    }
+
+    if( !o.children.empty() ){
+        json kids = json::array();
+        for( Order *c : o.children )
+            kids.push_back( _order_json(*c) );
+        j["childOrderStrategies"] = kids;
+    }
+    return j;
+}
+
+
+void
+PaperBroker::_update_quotes( StreamerServiceType service,
+                             unsigned long long timestamp,
+                             const json& content )
+{
+    const string *bid, *ask, *bid_size, *ask_size;
+    switch( service ){
+    case StreamerServiceType::QUOTE:
+        bid = &QUOTE_BID;
+        ask = &QUOTE_ASK;
+        bid_size = &QUOTE_BID_SIZE;
+        ask_size = &QUOTE_ASK_SIZE;
+        break;
+    case StreamerServiceType::OPTION:
+        bid = &OPTION_BID;
+        ask = &OPTION_ASK;
+        bid_size = &OPTION_BID_SIZE;
+        ask_size = &OPTION_ASK_SIZE;
+        break;
+    default:
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(_mtx);
+    _begin();
+    _now = timestamp;
+
+    vector<int> changed;
+    for( auto& item : content ){
+        auto k = item.find("key");
+        if( k == item.end() || !k->is_string() )
+            continue;
+        /* only symbols something has been ordered in */
+        auto s = _symbol_ids.find( k->get_ref<const string&>() );
+        if( s == _symbol_ids.end() )
+            continue;
+        Quote& q = _books[s->second].quote;
+        update_field(item, *bid, q.bid);
+        update_field(item, *ask, q.ask);
+        update_field(item, *bid_size, q.bid_size);
+        update_field(item, *ask_size, q.ask_size);
+        changed.push_back(s->second);
+    }
+
+    _activate_due();
+    for( int s : changed )
+        _match(s);
+    _activate_due();
+    _end(lock);
+}
+
+
+void
+PaperBroker::update( StreamerServiceType service,
+                     unsigned long long timestamp,
+                     const json& content )
+{
+    if( _naccounts.load() == 0 || !_live.load() )
+        return;
+    _update_quotes(service, timestamp, content);
+}
+
+
+void
+PaperBroker::replay( StreamerServiceType service,
+                     unsigned long long timestamp,
+                     const json& content )
+{
+    if( !content.is_array() )
+        TDMA_API_THROW(ValueException, "content not an array");
+    /* so analytics has the quote at send, like w/ live quotes */
+    ExecutionAnalytics::instance().update(service, content);
+    _update_quotes(service, timestamp, content);
+}
+
+
+void
+PaperBroker::set_quote( const string& symbol,
+                        double bid,
+                        double ask,
+                        double bid_size,
+                        double ask_size,
+                        unsigned long long timestamp )
+{
+    if( symbol.empty() )
+        TDMA_API_THROW(ValueException, "empty symbol");
+
+    std::unique_lock<std::mutex> lock(_mtx);
+    _begin();
+    _now = timestamp;
+    int s = _intern( util::toupper(symbol) );
+    _books[s].quote = Quote{bid, ask, bid_size, ask_size};
+    _activate_due();
+    _match(s);
+    _activate_due();
+    _end(lock);
+}
+
+
+string
+PaperBroker::send_order(const string& account_id, const string& order_json)
+{
+    json j;
+    try{
+        j = json::parse(order_json);
+    }catch( json::exception& e ){
+        TDMA_API_THROW( ExecuteException,
+                        "invalid order json: " + string(e.what()) );
+    }
+
+    std::unique_lock<std::mutex> lock(_mtx);
+    _begin();
+    string id = _send( _get_account(account_id), j );
+    _end(lock);
+    return id;
+}
+
+
+PaperBroker::Order&
+PaperBroker::_find_order(Account& account, const string& order_id) const
+{
+    unsigned long long id = 0;
+    try{
+        id = std::stoull(order_id);
+    }catch( std::exception& ){
+    }
+    auto o = account.orders.find(id);
+    if( o == account.orders.end() )
+        TDMA_API_THROW(InvalidRequest, "order not found: " + order_id);
+    return *o->second;
+}
+
+
+bool
+PaperBroker::cancel_order(const string& account_id, const string& order_id)
+{
+    std::unique_lock<std::mutex> lock(_mtx);
+    _begin();
+
+    Order *o = &_find_order( _get_account(account_id), order_id );
+    /* cancelling one side of an OCO cancels the group */
+    if( o->parent && o->parent->strategy == OrderStrategyType::OCO )
+        o = o->parent;
+    if( is_closed(o->status) ){
+        TDMA_API_THROW( ExecuteException,
+                        "order not cancelable: " + to_string(o->status) );
+    }
+    _cancel_tree(*o, OrderStatusType::CANCELED);
+
+    _end(lock);
+    return true;
+}
+
+
+string
+PaperBroker::replace_order( const string& account_id,
+                            const string& order_id,
+                            const string& order_json )
+{
+    json j;
+    try{
+        j = json::parse(order_json);
+    }catch( json::exception& e ){
+        TDMA_API_THROW( ExecuteException,
+                        "invalid order json: " + string(e.what()) );
+    }
+
+    std::unique_lock<std::mutex> lock(_mtx);
+    _begin();
+
+    Account& account = _get_account(account_id);
+    Order& old = _find_order(account, order_id);
+    if( is_closed(old.status) ){
+        TDMA_API_THROW( ExecuteException,
+                        "order not replaceable: " + to_string(old.status) );
+    }
+    /* parse (and throw) before touching the old order */
+    vector<std::unique_ptr<Order>> check;
+    _create(j, account, nullptr, check);
+
+    _cancel_tree(old, OrderStatusType::REPLACED);
+    string id = _send(account, j);
+
+    _end(lock);
+    return id;
+}
+
+
+string
+PaperBroker::get_order(const string& account_id, const string& order_id) const
+{
+    std::lock_guard<std::mutex> _(_mtx);
+    Account& account = _get_account(account_id);
+    return _order_json( _find_order(account, order_id) ).dump();
+}
+
+
+string
+PaperBroker::get_orders( const string& account_id,
+                         unsigned int nmax_results,
+                         const string& from_entered_time,
+                         const string& to_entered_time,
+                         OrderStatusType status ) const
+{
+    /* compare dates (yyyy-MM-dd), like the entered time range */
+    string from = from_entered_time.substr(0, 10);
+    string to = to_entered_time.substr(0, 10);
+
+    std::lock_guard<std::mutex> _(_mtx);
+    Account& account = _get_account(account_id);
+
+    json orders = json::array();
+    for( auto o = account.orders.rbegin();
+         o != account.orders.rend() && orders.size() < nmax_results; ++o )
+    {
+        const Order& order = *o->second;
+        if( order.parent )
+            continue;
+        if( status != OrderStatusType::ALL && order.status != status )
+            continue;
+        string date = iso_time(order.entered_msec).substr(0, 10);
+        if( (!from.empty() && date < from) || (!to.empty() && date > to) )
+            continue;
+        orders.push_back( _order_json(order) );
+    }
+    return orders.dump();
+}
+
+} /* tdma */
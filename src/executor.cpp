@@ -0,0 +1,674 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include <iostream>
+#include <memory>
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif /* __linux__ */
+
+#include "../include/_tdma_api.h"
+#include "../include/_executor.h"
+
+using std::string;
+using std::vector;
+using std::cerr;
+using std::endl;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+namespace {
+
+const unsigned int MAX_POOL_SIZE = 4;
+const unsigned int DEF_IO_POOL_SIZE = 4;
+const size_t MAX_THREAD_NAME = 15; // pthread limit w/o the null
+
+unsigned int
+def_pool_size()
+{
+    unsigned int n = std::thread::hardware_concurrency();
+    return std::max(1U, std::min(n, MAX_POOL_SIZE));
+}
+
+unsigned long long
+ceil_ticks(milliseconds d)
+{
+    long long t = tdma::Executor::TICK.count();
+    return static_cast<unsigned long long>( (d.count() + t - 1) / t );
+}
+
+} /* namespace */
+
+
+namespace tdma {
+
+const milliseconds Executor::TICK(10);
+
+
+Executor&
+Executor::instance()
+{
+    /* never destroyed; see _executor.h */
+    static Executor *e = new Executor();
+    return *e;
+}
+
+
+Executor::Executor()
+    :
+        _pool(this, "tdma-pool", def_pool_size()),
+        _io_pool(this, "tdma-io", DEF_IO_POOL_SIZE),
+        _threads_mtx(),
+        _threads(),
+        _affinity(),
+        _timer_mtx(),
+        _timer_cv(),
+        _wheel(WHEEL_SLOTS),
+        _timers(),
+        _wheel_start( steady_clock::now() ),
+        _tick(0),
+        _next_timer_id(0),
+        _timer_thread_started(false)
+    {
+    }
+
+
+Executor::Pool::Pool(Executor *exec, const string& name, unsigned int size)
+    :
+        _exec(exec),
+        _name(name),
+        _mtx(),
+        _cv(),
+        _tasks(),
+        _size(size),
+        _nthreads(0),
+        _next_index(0)
+    {
+    }
+
+
+void
+Executor::Pool::_run(unsigned int index)
+{
+    _exec->_enter( _name + "-" + std::to_string(index) );
+
+    std::unique_lock<std::mutex> lock(_mtx);
+    for( ;; ){
+        if( _nthreads > _size ) /* retire */
+            break;
+
+        if( !_tasks.empty() ){
+            task_ty task = std::move( _tasks.front() );
+            _tasks.pop_front();
+            lock.unlock();
+            _run_task(task, _name.c_str());
+            task = nullptr; /* destroy outside the lock */
+            lock.lock();
+            continue;
+        }
+
+        _cv.wait(lock);
+    }
+    --_nthreads;
+    lock.unlock();
+
+    _exec->_exit();
+}
+
+
+void
+Executor::Pool::_grow()
+{
+    while( _nthreads < _size ){
+        ++_nthreads;
+        std::thread(&Pool::_run, this, _next_index++).detach();
+    }
+}
+
+
+void
+Executor::Pool::post(task_ty task)
+{
+    {
+        std::lock_guard<std::mutex> _(_mtx);
+        _tasks.push_back( std::move(task) );
+        _grow();
+    }
+    _cv.notify_one();
+}
+
+
+void
+Executor::Pool::set_size(unsigned int n)
+{
+    {
+        std::lock_guard<std::mutex> _(_mtx);
+        _size = n;
+        /* only start threads if we already have */
+        if( _next_index > 0 )
+            _grow();
+    }
+    _cv.notify_all();
+}
+
+
+unsigned int
+Executor::Pool::get_size() const
+{
+    std::lock_guard<std::mutex> _(_mtx);
+    return _size;
+}
+
+
+void
+Executor::post(task_ty task)
+{ _pool.post( std::move(task) ); }
+
+
+void
+Executor::post_io(task_ty task)
+{ _io_pool.post( std::move(task) ); }
+
+
+Executor::timer_id_ty
+Executor::post_after(milliseconds delay, task_ty task, bool io)
+{
+    if( delay.count() <= 0 ){
+        (io ? _io_pool : _pool).post( std::move(task) );
+        return 0;
+    }
+    std::lock_guard<std::mutex> _(_timer_mtx);
+    return _add_timer(delay, milliseconds(0), std::move(task), io);
+}
+
+
+Executor::timer_id_ty
+Executor::post_every(milliseconds period, task_ty task, bool io)
+{
+    if( period.count() <= 0 )
+        TDMA_API_THROW(ValueException, "timer period must be > 0");
+
+    std::lock_guard<std::mutex> _(_timer_mtx);
+    return _add_timer(period, period, std::move(task), io);
+}
+
+
+bool
+Executor::cancel(timer_id_ty id)
+{
+    task_ty task;
+    {
+        std::lock_guard<std::mutex> _(_timer_mtx);
+        auto f = _timers.find(id);
+        if( f == _timers.end() )
+            return false;
+        slot_ty& slot = _wheel[f->second->due_tick % WHEEL_SLOTS];
+        task = std::move(f->second->task);
+        slot.erase(f->second);
+        _timers.erase(f);
+    }
+    /* the task is destroyed outside the lock */
+    return true;
+}
+
+
+std::thread
+Executor::spawn_io(const string& name, task_ty loop)
+{
+    return std::thread(
+        [this, name, loop](){
+            _enter(name);
+            try{
+                loop();
+            }catch(...){
+                _exit();
+                throw;
+            }
+            _exit();
+        }
+    );
+}
+
+
+void
+Executor::set_pool_size(unsigned int n)
+{
+    if( n == 0 )
+        TDMA_API_THROW(ValueException, "pool size must be > 0");
+    _pool.set_size(n);
+}
+
+
+unsigned int
+Executor::get_pool_size() const
+{ return _pool.get_size(); }
+
+
+void
+Executor::set_io_pool_size(unsigned int n)
+{
+    if( n == 0 )
+        TDMA_API_THROW(ValueException, "I/O pool size must be > 0");
+    _io_pool.set_size(n);
+}
+
+
+unsigned int
+Executor::get_io_pool_size() const
+{ return _io_pool.get_size(); }
+
+
+void
+Executor::set_affinity(const vector<int>& cpus)
+{
+    for( int c : cpus ){
+        if( c < 0 )
+            TDMA_API_THROW(ValueException, "invalid cpu: " + std::to_string(c));
+    }
+
+    std::lock_guard<std::mutex> _(_threads_mtx);
+    _affinity = cpus;
+    for( auto& t : _threads )
+        _apply_affinity(t.second, _affinity);
+}
+
+
+vector<int>
+Executor::get_affinity() const
+{
+    std::lock_guard<std::mutex> _(_threads_mtx);
+    return _affinity;
+}
+
+
+unsigned int
+Executor::get_thread_count() const
+{
+    std::lock_guard<std::mutex> _(_threads_mtx);
+    return static_cast<unsigned int>( _threads.size() );
+}
+
+
+void
+Executor::_enter(const string& name)
+{
+#ifdef __linux__
+    string n = name.substr(0, MAX_THREAD_NAME);
+    pthread_setname_np( pthread_self(), n.c_str() );
+    std::thread::native_handle_type h = pthread_self();
+#else
+    std::thread::native_handle_type h = std::thread::native_handle_type();
+#endif /* __linux__ */
+
+    std::lock_guard<std::mutex> _(_threads_mtx);
+    _threads[std::this_thread::get_id()] = h;
+    if( !_affinity.empty() )
+        _apply_affinity(h, _affinity);
+}
+
+
+void
+Executor::_exit()
+{
+    std::lock_guard<std::mutex> _(_threads_mtx);
+    _threads.erase( std::this_thread::get_id() );
+}
+
+
+unsigned long long
+Executor::_current_tick() const
+{
+    return static_cast<unsigned long long>(
+        (steady_clock::now() - _wheel_start) / TICK
+        );
+}
+
+
+Executor::timer_id_ty
+Executor::_add_timer( milliseconds delay,
+                      milliseconds period,
+                      task_ty task,
+                      bool io )
+{
+    if( !_timer_thread_started ){
+        _timer_thread_started = true;
+        std::thread(
+            [this](){
+                _enter("tdma-timer");
+                _run_timers();
+            }
+        ).detach();
+    }
+
+    unsigned long long now = _current_tick();
+    if( _timers.empty() ) /* don't walk the ticks we slept through */
+        _tick = std::max(_tick, now);
+
+    Timer t;
+    t.id = ++_next_timer_id;
+    /* +1: 'now' may be most of a tick ago; never fire early */
+    t.due_tick = now + ceil_ticks(delay) + 1;
+    t.period_ticks = period.count() > 0
+                   ? std::max(ceil_ticks(period), 1ULL)
+                   : 0;
+    t.io = io;
+    t.task = std::move(task);
+    timer_id_ty id = t.id;
+    _insert_timer( std::move(t) );
+
+    _timer_cv.notify_one();
+    return id;
+}
+
+
+void
+Executor::_insert_timer(Timer&& t)
+{
+    slot_ty& slot = _wheel[t.due_tick % WHEEL_SLOTS];
+    timer_id_ty id = t.id;
+    slot.push_back( std::move(t) );
+    _timers[id] = std::prev(slot.end());
+}
+
+
+void
+Executor::_run_timers()
+{
+    std::unique_lock<std::mutex> lock(_timer_mtx);
+    for( ;; ){
+        if( _timers.empty() ){
+            _timer_cv.wait(lock);
+            continue;
+        }
+
+        unsigned long long now = _current_tick();
+        while( _tick <= now ){
+            slot_ty& slot = _wheel[_tick % WHEEL_SLOTS];
+            for( auto it = slot.begin(); it != slot.end(); ){
+                if( it->due_tick > _tick ){ /* a later lap */
+                    ++it;
+                    continue;
+                }
+                Timer t = std::move(*it);
+                _timers.erase(t.id);
+                it = slot.erase(it);
+
+                Pool& pool = t.io ? _io_pool : _pool;
+                if( t.period_ticks ){
+                    task_ty task = t.task;
+                    t.due_tick = _tick + t.period_ticks;
+                    _insert_timer( std::move(t) );
+                    pool.post( std::move(task) );
+                }else{
+                    pool.post( std::move(t.task) );
+                }
+            }
+            ++_tick;
+        }
+
+        if( !_timers.empty() )
+            _timer_cv.wait_until(lock, _wheel_start + TICK * _tick);
+    }
+}
+
+
+void
+Executor::_run_task(task_ty& task, const char* where)
+{
+    try{
+        task();
+    }catch( std::exception& e ){
+        cerr<< "Executor(" << where << ") task exception: " << e.what()
+            << endl;
+    }catch( ... ){
+        cerr<< "Executor(" << where << ") task exception" << endl;
+    }
+}
+
+
+void
+Executor::_apply_affinity( std::thread::native_handle_type h,
+                           const vector<int>& cpus )
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if( cpus.empty() ){
+        for( int i = 0; i < CPU_SETSIZE; ++i )
+            CPU_SET(i, &set);
+    }else{
+        for( int c : cpus ){
+            if( c < CPU_SETSIZE )
+                CPU_SET(c, &set);
+        }
+    }
+    if( pthread_setaffinity_np(h, sizeof(set), &set) ){
+        cerr<< "Executor: failed to set thread affinity" << endl;
+    }
+#endif /* __linux__ */
+}
+
+
+void
+SetExecutorPoolSizeImpl(unsigned int n)
+{ Executor::instance().set_pool_size(n); }
+
+unsigned int
+GetExecutorPoolSizeImpl()
+{ return Executor::instance().get_pool_size(); }
+
+void
+SetExecutorIOPoolSizeImpl(unsigned int n)
+{ Executor::instance().set_io_pool_size(n); }
+
+unsigned int
+GetExecutorIOPoolSizeImpl()
+{ return Executor::instance().get_io_pool_size(); }
+
+void
+SetExecutorAffinityImpl(const int* cpus, size_t n)
+{ Executor::instance().set_affinity( vector<int>(cpus, cpus + n) ); }
+
+unsigned int
+GetExecutorThreadCountImpl()
+{ return Executor::instance().get_thread_count(); }
+
+
+/* 'release'(if any) is called when the last copy of the task is gone */
+Executor::task_ty
+task_from_abi( void(*func)(void*),
+               std::shared_ptr<void> arg )
+{ return [func, arg](){ func( arg.get() ); }; }
+
+void
+ExecutorPostImpl( void(*func)(void*), std::shared_ptr<void> arg, bool io )
+{
+    if( io )
+        Executor::instance().post_io( task_from_abi(func, arg) );
+    else
+        Executor::instance().post( task_from_abi(func, arg) );
+}
+
+unsigned long long
+ExecutorPostAfterImpl( long long msec,
+                       void(*func)(void*),
+                       std::shared_ptr<void> arg,
+                       bool io,
+                       bool repeat )
+{
+    if( repeat ){
+        return Executor::instance().post_every(
+            milliseconds(msec), task_from_abi(func, arg), io );
+    }
+    return Executor::instance().post_after(
+        milliseconds(msec), task_from_abi(func, arg), io );
+}
+
+bool
+ExecutorCancelImpl(unsigned long long id)
+{ return Executor::instance().cancel(id); }
+
+} /* tdma */
+
+
+using namespace tdma;
+
+namespace {
+
+std::shared_ptr<void>
+arg_holder(void* arg, void(*release)(void*))
+{
+    if( release )
+        return std::shared_ptr<void>(arg, release);
+    return std::shared_ptr<void>(arg, [](void*){});
+}
+
+int
+post_after_abi( long long msec,
+                void(*func)(void*),
+                void(*release)(void*),
+                void* arg,
+                int io,
+                unsigned long long* id,
+                bool repeat,
+                int allow_exceptions )
+{
+    /* first, so 'release' is called on any error */
+    auto holder = arg_holder(arg, release);
+    CHECK_PTR(func, "func", allow_exceptions);
+
+    unsigned long long r;
+    int err;
+    std::tie(r, err) = CallImplFromABI( allow_exceptions, ExecutorPostAfterImpl,
+                                   msec, func, holder, io != 0, repeat );
+    if( err )
+        return err;
+
+    if( id )
+        *id = r;
+    return 0;
+}
+
+} /* namespace */
+
+
+int
+SetExecutorPoolSize_ABI(unsigned int n, int allow_exceptions)
+{ return CallImplFromABI(allow_exceptions, SetExecutorPoolSizeImpl, n); }
+
+int
+GetExecutorPoolSize_ABI(unsigned int *n, int allow_exceptions)
+{
+    CHECK_PTR(n, "n", allow_exceptions);
+
+    int err;
+    std::tie(*n, err) = CallImplFromABI(allow_exceptions, GetExecutorPoolSizeImpl);
+    return err;
+}
+
+int
+SetExecutorIOPoolSize_ABI(unsigned int n, int allow_exceptions)
+{ return CallImplFromABI(allow_exceptions, SetExecutorIOPoolSizeImpl, n); }
+
+int
+GetExecutorIOPoolSize_ABI(unsigned int *n, int allow_exceptions)
+{
+    CHECK_PTR(n, "n", allow_exceptions);
+
+    int err;
+    std::tie(*n, err) = CallImplFromABI(allow_exceptions, GetExecutorIOPoolSizeImpl);
+    return err;
+}
+
+int
+SetExecutorAffinity_ABI(const int *cpus, size_t n, int allow_exceptions)
+{
+    if( n ){
+        CHECK_PTR(cpus, "cpus", allow_exceptions);
+    }
+
+    return CallImplFromABI( allow_exceptions, SetExecutorAffinityImpl,
+                            cpus, n );
+}
+
+int
+GetExecutorThreadCount_ABI(unsigned int *n, int allow_exceptions)
+{
+    CHECK_PTR(n, "n", allow_exceptions);
+
+    int err;
+    std::tie(*n, err) = CallImplFromABI( allow_exceptions,
+                                    GetExecutorThreadCountImpl );
+    return err;
+}
+
+int
+ExecutorPost_ABI( void(*func)(void*),
+                  void(*release)(void*),
+                  void* arg,
+                  int io,
+                  int allow_exceptions )
+{
+    auto holder = arg_holder(arg, release);
+    CHECK_PTR(func, "func", allow_exceptions);
+
+    return CallImplFromABI( allow_exceptions, ExecutorPostImpl, func, holder,
+                            io != 0 );
+}
+
+int
+ExecutorPostAfter_ABI( long long msec,
+                       void(*func)(void*),
+                       void(*release)(void*),
+                       void* arg,
+                       int io,
+                       unsigned long long* id,
+                       int allow_exceptions )
+{
+    return post_after_abi( msec, func, release, arg, io, id, false,
+                           allow_exceptions );
+}
+
+int
+ExecutorPostEvery_ABI( long long msec,
+                       void(*func)(void*),
+                       void(*release)(void*),
+                       void* arg,
+                       int io,
+                       unsigned long long* id,
+                       int allow_exceptions )
+{
+    return post_after_abi( msec, func, release, arg, io, id, true,
+                           allow_exceptions );
+}
+
+int
+ExecutorCancel_ABI(unsigned long long id, int *cancelled, int allow_exceptions)
+{
+    bool r;
+    int err;
+    std::tie(r, err) = CallImplFromABI(allow_exceptions, ExecutorCancelImpl, id);
+    if( err )
+        return err;
+
+    if( cancelled )
+        *cancelled = r ? 1 : 0;
+    return 0;
+}
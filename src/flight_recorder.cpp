@@ -0,0 +1,431 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <csignal>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <process.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif /* __linux__ */
+#endif /* _WIN32 */
+
+#include "../include/_tdma_api.h"
+#include "../include/_flight_recorder.h"
+
+using std::string;
+using namespace tdma::flight;
+
+namespace {
+
+struct Ring {
+    std::atomic<uint64_t> head; // # events ever written
+    std::atomic<uint64_t> thread_id;
+    std::atomic<bool> alive;
+    Event events[RING_SIZE];
+};
+
+/*
+ * rings are never freed: a dump (possibly from a signal handler) can't
+ * take a lock, and the rings of threads that have exited are still useful;
+ * a dead ring is only reused when all MAX_RINGS are taken
+ */
+std::atomic<Ring*> rings[MAX_RINGS];
+
+const size_t MAX_PATH_SIZE = 1024;
+char dump_path[MAX_PATH_SIZE]; // read w/o the lock in the signal handler
+std::mutex dump_path_mtx;
+int dump_signal = 0;
+std::atomic<int64_t> last_auto_dump_nsec(0);
+
+const int64_t AUTO_DUMP_INTERVAL_NSEC = 1000000000;
+
+int64_t
+steady_nsec()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(
+        steady_clock::now().time_since_epoch() ).count();
+}
+
+int64_t
+system_nsec()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(
+        system_clock::now().time_since_epoch() ).count();
+}
+
+uint64_t
+this_thread_id()
+{
+#ifdef __linux__
+    return static_cast<uint64_t>( syscall(SYS_gettid) );
+#else
+    return std::hash<std::thread::id>()( std::this_thread::get_id() );
+#endif /* __linux__ */
+}
+
+Ring*
+acquire_ring()
+{
+    uint64_t tid = this_thread_id();
+    for( uint32_t i = 0; i < MAX_RINGS; ++i ){
+        if( rings[i].load(std::memory_order_acquire) )
+            continue;
+        Ring *r = new Ring();
+        r->head = 0;
+        r->thread_id = tid;
+        r->alive = true;
+        std::memset(r->events, 0, sizeof(r->events));
+        Ring *expected = nullptr;
+        if( rings[i].compare_exchange_strong(expected, r) )
+            return r;
+        delete r;
+    }
+
+    for( uint32_t i = 0; i < MAX_RINGS; ++i ){
+        Ring *r = rings[i].load(std::memory_order_acquire);
+        bool expected = false;
+        if( r->alive.compare_exchange_strong(expected, true) ){
+            /* older events' seqs no longer fall in [head - RING_SIZE, head) */
+            r->head.store(0, std::memory_order_release);
+            r->thread_id = tid;
+            return r;
+        }
+    }
+    return nullptr;
+}
+
+struct RingHandle {
+    Ring *ring;
+    bool acquired;
+
+    RingHandle() : ring(nullptr), acquired(false) {}
+
+    ~RingHandle()
+    {
+        if( ring )
+            ring->alive.store(false, std::memory_order_release);
+    }
+};
+
+thread_local RingHandle this_ring;
+
+size_t
+copy_text(char *dest, size_t n, const char *src)
+{
+    size_t i = 0;
+    for( ; src && src[i] && i < n; ++i )
+        dest[i] = src[i];
+    return i;
+}
+
+void
+write_all(int fd, const void *buf, size_t n)
+{
+    const char *p = static_cast<const char*>(buf);
+    while( n > 0 ){
+#ifdef _WIN32
+        int w = _write(fd, p, static_cast<unsigned int>(n));
+#else
+        ssize_t w = write(fd, p, n);
+        if( w < 0 && errno == EINTR )
+            continue;
+#endif /* _WIN32 */
+        if( w <= 0 )
+            return;
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+}
+
+extern "C" void
+dump_on_signal(int signum)
+{
+    /* no stdio, no allocation */
+    char reason[32] = "signal ";
+    char digits[12];
+    int nd = 0;
+    for( int s = signum; s > 0 && nd < 11; s /= 10 )
+        digits[nd++] = static_cast<char>('0' + s % 10);
+    size_t len = std::strlen(reason);
+    while( nd > 0 )
+        reason[len++] = digits[--nd];
+    reason[len] = '\0';
+
+    if( dump_path[0] )
+        dump(dump_path, reason);
+}
+
+bool
+is_dump_error(int error_code)
+{
+    switch( error_code ){
+    case TDMA_API_CONNECT_ERROR:
+    case TDMA_API_AUTH_ERROR:
+    case TDMA_API_SERVER_ERROR:
+    case TDMA_API_STREAM_ERROR:
+        return true;
+    default:
+        return false;
+    }
+}
+
+} /* namespace */
+
+
+namespace tdma {
+namespace flight {
+
+void
+record( EventType type,
+        long long a,
+        long long b,
+        const char* text,
+        const char* text2 )
+{
+    if( !this_ring.acquired ){
+        this_ring.acquired = true;
+        this_ring.ring = acquire_ring();
+    }
+    Ring *r = this_ring.ring;
+    if( !r )
+        return;
+
+    uint64_t i = r->head.load(std::memory_order_relaxed);
+    Event& e = r->events[i % RING_SIZE];
+
+    e.seq = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    e.ts_nsec = steady_nsec();
+    e.a = a;
+    e.b = b;
+    e.type = static_cast<uint16_t>(type);
+    size_t n = copy_text(e.text, TEXT_SIZE, text);
+    if( text2 && n + 1 < TEXT_SIZE ){
+        if( n )
+            e.text[n++] = ' ';
+        n += copy_text(e.text + n, TEXT_SIZE - n, text2);
+    }
+    if( n < TEXT_SIZE )
+        std::memset(e.text + n, 0, TEXT_SIZE - n);
+    std::atomic_thread_fence(std::memory_order_release);
+    e.seq = i + 1;
+
+    r->head.store(i + 1, std::memory_order_release);
+}
+
+
+bool
+dump(const char* path, const char* reason)
+{
+#ifdef _WIN32
+    int fd = _open( path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+                    _S_IREAD | _S_IWRITE );
+#else
+    int fd = open( path, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+#endif /* _WIN32 */
+    if( fd < 0 )
+        return false;
+
+    FileHeader hdr;
+    std::memset(&hdr, 0, sizeof(hdr));
+    std::memcpy(hdr.magic, "TDMAFR01", sizeof(hdr.magic));
+    hdr.event_size = sizeof(Event);
+    hdr.ring_size = RING_SIZE;
+    hdr.steady_nsec = steady_nsec();
+    hdr.system_nsec = system_nsec();
+#ifdef _WIN32
+    hdr.pid = _getpid();
+#else
+    hdr.pid = getpid();
+#endif /* _WIN32 */
+    copy_text(hdr.reason, sizeof(hdr.reason) - 1, reason);
+    write_all(fd, &hdr, sizeof(hdr));
+
+    for( uint32_t i = 0; i < MAX_RINGS; ++i ){
+        Ring *r = rings[i].load(std::memory_order_acquire);
+        if( !r )
+            continue;
+        RingHeader rh;
+        rh.thread_id = r->thread_id.load();
+        rh.head = r->head.load(std::memory_order_acquire);
+        rh.alive = r->alive.load() ? 1 : 0;
+        rh.pad = 0;
+        write_all(fd, &rh, sizeof(rh));
+        write_all(fd, r->events, sizeof(r->events));
+    }
+
+#ifdef _WIN32
+    _close(fd);
+#else
+    close(fd);
+#endif /* _WIN32 */
+    return true;
+}
+
+
+void
+set_path(const string& path)
+{
+    if( path.size() >= MAX_PATH_SIZE ){
+        TDMA_API_THROW( ValueException,
+                        "flight recorder path is too long(max "
+                        + std::to_string(MAX_PATH_SIZE - 1) + ")" );
+    }
+    std::lock_guard<std::mutex> _(dump_path_mtx);
+    /* the signal handler may be reading it; it's 'empty' until we're done */
+    dump_path[0] = '\0';
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    if( !path.empty() ){
+        std::memcpy(dump_path + 1, path.c_str() + 1, path.size());
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        dump_path[0] = path[0];
+    }
+}
+
+
+string
+get_path()
+{
+    std::lock_guard<std::mutex> _(dump_path_mtx);
+    return string(dump_path);
+}
+
+
+void
+set_signal(int signum)
+{
+    std::lock_guard<std::mutex> _(dump_path_mtx);
+    if( signum == dump_signal )
+        return;
+
+    if( signum ){
+        if( std::signal(signum, dump_on_signal) == SIG_ERR ){
+            TDMA_API_THROW( ValueException,
+                            "invalid signal: " + std::to_string(signum) );
+        }
+    }
+    if( dump_signal )
+        std::signal(dump_signal, SIG_DFL);
+    dump_signal = signum;
+}
+
+
+void
+on_exception( const char* name,
+              const char* what,
+              int error_code,
+              int lineno )
+{
+    record(EventType::exception, error_code, lineno, name, what);
+
+    if( !is_dump_error(error_code) )
+        return;
+
+    int64_t now = steady_nsec();
+    int64_t last = last_auto_dump_nsec.load();
+    if( now - last < AUTO_DUMP_INTERVAL_NSEC
+        || !last_auto_dump_nsec.compare_exchange_strong(last, now) ){
+        return;
+    }
+
+    string path = get_path();
+    if( !path.empty() )
+        dump( path.c_str(), (string(name) + ": " + what).c_str() );
+}
+
+} /* flight */
+
+
+void
+SetFlightRecorderPathImpl(const string& path)
+{ flight::set_path(path); }
+
+string
+GetFlightRecorderPathImpl()
+{ return flight::get_path(); }
+
+void
+SetFlightRecorderSignalImpl(int signum)
+{ flight::set_signal(signum); }
+
+void
+DumpFlightRecorderImpl(const string& path)
+{
+    string p = path.empty() ? flight::get_path() : path;
+    if( p.empty() )
+        TDMA_API_THROW(ValueException, "no flight recorder path");
+
+    if( !flight::dump(p.c_str(), "DumpFlightRecorder") ){
+        TDMA_API_THROW( APIException,
+                        "failed to write flight recorder dump: " + p );
+    }
+}
+
+} /* tdma */
+
+
+using namespace tdma;
+
+int
+SetFlightRecorderPath_ABI(const char* path, int allow_exceptions)
+{
+    return CallImplFromABI( allow_exceptions, SetFlightRecorderPathImpl,
+                            path ? path : "" );
+}
+
+int
+GetFlightRecorderPath_ABI(char **path, size_t *n, int allow_exceptions)
+{
+    CHECK_PTR(path, "path", allow_exceptions);
+
+    string r;
+    int err;
+    tie(r,err) = CallImplFromABI(allow_exceptions, GetFlightRecorderPathImpl);
+    if( err )
+        return err;
+
+    return to_new_char_buffer(r, path, n, allow_exceptions);
+}
+
+int
+SetFlightRecorderSignal_ABI(int signum, int allow_exceptions)
+{
+    return CallImplFromABI( allow_exceptions, SetFlightRecorderSignalImpl,
+                            signum );
+}
+
+int
+DumpFlightRecorder_ABI(const char* path, int allow_exceptions)
+{
+    return CallImplFromABI( allow_exceptions, DumpFlightRecorderImpl,
+                            path ? path : "" );
+}
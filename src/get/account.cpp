@@ -19,6 +19,9 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 
 #include "../../include/_tdma_api.h"
 #include "../../include/_get.h"
+#include "../../include/_json_parse.h"
+#include "../../include/_paper_broker.h"
+#include "../../include/_execute_analytics.h"
 
 using std::string;
 using std::vector;
@@ -28,6 +31,28 @@ using util::is_valid_iso8601_datetime;
 
 namespace tdma {
 
+namespace {
+
+/* OrderGetter/OrdersGetter results feed execution analytics (if enabled) */
+string
+add_to_analytics(string orders)
+{
+    auto& analytics = ExecutionAnalytics::instance();
+    if( orders.empty() || !analytics.is_enabled() )
+        return orders;
+
+    try{
+        analytics.add_orders( parse_json(orders) );
+    }catch( std::exception& e ){
+        /* not the getter's error; the caller gets the result as is */
+        std::cerr<< "failed to add orders to analytics: " << e.what()
+                 << std::endl;
+    }
+    return orders;
+}
+
+} /* namespace */
+
 class AccountGetterBaseImpl
         : public APIGetterImpl{
     string _account_id;
@@ -459,7 +484,7 @@ json
 get_user_principals_for_streaming(Credentials& creds)
 {
     string s = UserPrincipalsGetterImpl(creds,true,true,false,false).get();
-    return s.empty() ? json() : json::parse(s);
+    return s.empty() ? json() : parse_json(s);
 }
 
 
@@ -497,6 +522,19 @@ public:
             _build();
         }
 
+    /* paper accounts are served by the paper broker */
+    virtual string
+    get()
+    {
+        auto& paper = PaperBroker::instance();
+        if( paper.is_account(get_account_id()) ){
+            return add_to_analytics(
+                paper.get_order(get_account_id(), _order_id)
+                );
+        }
+        return add_to_analytics( APIGetterImpl::get() );
+    }
+
     string
     get_order_id() const
     { return _order_id; }
@@ -575,6 +613,20 @@ public:
             _build();
         }
 
+    virtual string
+    get()
+    {
+        auto& paper = PaperBroker::instance();
+        if( paper.is_account(get_account_id()) ){
+            return add_to_analytics(
+                paper.get_orders( get_account_id(), _nmax_results,
+                                  _from_entered_time, _to_entered_time,
+                                  _order_status_type )
+                );
+        }
+        return add_to_analytics( APIGetterImpl::get() );
+    }
+
     unsigned int
     get_nmax_results() const
     { return _nmax_results; }
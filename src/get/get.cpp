@@ -20,34 +20,53 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 #include <regex>
 #include <cctype>
 #include <mutex>
+#include <limits>
+#include <algorithm>
+#include <cmath>
 #include <string.h>
 
 #include "../../include/_tdma_api.h"
 #include "../../include/_get.h"
+#include "../../include/_get_broker.h"
+#include "../../include/_probes.h"
+#include "../../include/_json_parse.h"
 
 using std::string;
 using std::tie;
 using std::chrono::milliseconds;
 
+namespace {
+
+/* set by get_in_slot() for the throttled_get() it leads to */
+thread_local long long reserved_slot_msec = 0;
+thread_local const void *reserved_slot_domain = nullptr;
+
+} /* namespace */
+
 
 namespace tdma{
 
 const milliseconds APIGetterImpl::DEF_WAIT_MSEC(500);
+const long long APIGetterImpl::RESERVED_SLOT_LIFE_MSEC;
 
 milliseconds APIGetterImpl::wait_msec(APIGetterImpl::DEF_WAIT_MSEC);
-milliseconds APIGetterImpl::last_get_msec(
-    util::get_msec_since_epoch<conn::clock_ty>()
-    );
 
-std::mutex APIGetterImpl::get_mtx;
+std::unordered_map<string, std::shared_ptr<APIGetterImpl::RateDomain>>
+APIGetterImpl::rate_domains;
+
+std::mutex APIGetterImpl::rate_domains_mtx;
 
 int APIGetterImpl::current_connection_group = 0;
 
+string APIGetterImpl::broker_path;
+std::mutex APIGetterImpl::broker_mtx;
+
 APIGetterImpl::APIGetterImpl( Credentials& creds,
                               api_on_error_cb_ty on_error_callback )
     :
         _on_error_callback(on_error_callback),
         _credentials(creds),
+        _rate_domain( get_rate_domain(creds.client_id ? creds.client_id : "") ),
         _connection(
             (current_connection_group < 0)
                 ? reinterpret_cast<conn::HTTPConnectionInterface*>(
@@ -56,12 +75,39 @@ APIGetterImpl::APIGetterImpl( Credentials& creds,
                 : reinterpret_cast<conn::HTTPConnectionInterface*>(
                         new conn::SharedHTTPConnection(
                                 conn::HttpMethod::http_get,
-                                current_connection_group)
+                                /* don't serialize domains on one connection */
+                                _rate_domain->connection_group)
                         )
                 )
     {
     }
 
+APIGetterImpl::RateDomain::RateDomain(int connection_group)
+    :
+        last_get_msec( util::get_msec_since_epoch<conn::clock_ty>().count() ),
+        next_slot_msec( 0 ),
+        connection_group( connection_group ),
+        stats_mtx(),
+        stats{0, 0, 0, 0, 0},
+        slots_mtx(),
+        reserved_slots()
+    {
+    }
+
+std::shared_ptr<APIGetterImpl::RateDomain>
+APIGetterImpl::get_rate_domain(const string& client_id)
+{
+    std::lock_guard<std::mutex> _(rate_domains_mtx);
+    auto d = rate_domains.find(client_id);
+    if( d != rate_domains.end() )
+        return d->second;
+
+    int group = static_cast<int>(rate_domains.size());
+    auto domain = std::make_shared<RateDomain>(group);
+    rate_domains.emplace(client_id, domain);
+    return domain;
+}
+
 void
 APIGetterImpl::set_url(const string& url)
 {
@@ -74,6 +120,60 @@ APIGetterImpl::get()
     return APIGetterImpl::throttled_get(*this);
 }
 
+std::pair<long long, milliseconds>
+APIGetterImpl::reserve_slot()
+{
+    long long slot = reserve_slot(*_rate_domain, get_wait_msec());
+    auto now = util::get_msec_since_epoch<conn::clock_ty>().count();
+    {
+        std::lock_guard<std::mutex> _(_rate_domain->slots_mtx);
+        auto& slots = _rate_domain->reserved_slots;
+        slots.erase( slots.begin(),
+                     slots.lower_bound(now - RESERVED_SLOT_LIFE_MSEC) );
+        slots.insert(slot);
+    }
+    return {slot, milliseconds( std::max(slot - now, 0LL) )};
+}
+
+string
+APIGetterImpl::get_in_slot(long long slot)
+{
+    /* only a slot this domain issued, once; otherwise it'd skip the throttle */
+    {
+        std::lock_guard<std::mutex> _(_rate_domain->slots_mtx);
+        auto& slots = _rate_domain->reserved_slots;
+        auto s = slots.find(slot);
+        if( s == slots.end() ){
+            TDMA_API_THROW( ValueException,
+                            "slot wasn't reserved by this getter's rate "
+                            "domain or was already used" );
+        }
+        slots.erase(s);
+    }
+
+    /* throttled_get() takes it if get() gets that far (i.e not paper) */
+    struct Guard{
+        Guard(long long slot, const void *domain)
+        {
+            reserved_slot_msec = slot;
+            reserved_slot_domain = domain;
+        }
+        ~Guard()
+        {
+            reserved_slot_msec = 0;
+            reserved_slot_domain = nullptr;
+        }
+    } _(slot, _rate_domain.get());
+    return get();
+}
+
+json
+APIGetterImpl::get_json()
+{
+    string r = get();
+    return r.empty() ? json() : parse_json(r);
+}
+
 void
 APIGetterImpl::close()
 {
@@ -98,63 +198,394 @@ APIGetterImpl::get_timeout() const
     return milliseconds( _connection->get_timeout() );
 }
 
+void
+APIGetterImpl::use_broker(const string& path)
+{
+    std::lock_guard<std::mutex> _(broker_mtx);
+    broker_path = path;
+}
+
+string
+APIGetterImpl::get_broker()
+{
+    std::lock_guard<std::mutex> _(broker_mtx);
+    return broker_path;
+}
+
 string
 APIGetterImpl::throttled_get(APIGetterImpl& getter)
 {
+    string broker = get_broker();
+    if( broker.empty() ){
+        return throttled_get( *(getter._connection), getter._credentials,
+                              getter._on_error_callback );
+    }
+
+    /* the broker applies the (shared) throttle and its own credentials */
+    if( getter._connection->is_closed() )
+        TDMA_API_THROW( APIException, "connection is closed");
+
+    return GetterBrokerImpl::request( broker, getter._connection->get_url(),
+                                      getter._on_error_callback );
+}
+
+string
+APIGetterImpl::throttled_get( conn::HTTPConnectionInterface& connection,
+                              Credentials& creds,
+                              api_on_error_cb_ty on_error_cb )
+{
+    auto domain = get_rate_domain(creds.client_id ? creds.client_id : "");
+    milliseconds wait = get_wait_msec();
+
+    /*
+     * every request takes a slot so reserved (async) and blocking calls are
+     * spaced together; a reserved call was already delayed until its slot
+     */
+    long long slot = reserved_slot_msec;
+    bool reserved = (slot != 0 && reserved_slot_domain == domain.get());
+    reserved_slot_msec = 0;
+    reserved_slot_domain = nullptr;
+    if( !reserved )
+        slot = reserve_slot(*domain, wait);
+
     /*
-     * get_mtx allows threaded api execution from different getters in
+     * domain.mtx allows threaded api execution from different getters in
      * different threads AND the same getter in different threads.
      *
      * IT DOESN'T HANDLE OTHER OTHER SYNC ISSUES INSIDE THE CurlConnection
      * CLASSES.
      */
-    std::lock_guard<std::mutex> _(get_mtx);
+    std::lock_guard<std::mutex> _(domain->mtx);
 
-    auto remaining = throttled_wait_remaining();
+    /*
+     * every request also waits 'wait' after the last response (a slow
+     * response can push it past a reserved slot)
+     */
+    auto to_slot = milliseconds(
+        slot - util::get_msec_since_epoch<conn::clock_ty>().count()
+        );
+    auto remaining = max(throttled_wait_remaining(*domain, wait), to_slot);
+    unsigned long long ngets;
+    {
+        std::lock_guard<std::mutex> _(domain->stats_mtx);
+        ngets = ++domain->stats.ngets;
+        if( remaining.count() > 0 ){
+            ++domain->stats.nthrottled;
+            domain->stats.wait_msec += remaining.count();
+        }
+    }
+
+    flight::record( flight::EventType::throttle,
+                    max(remaining, milliseconds(0)).count(),
+                    ngets, creds.client_id );
     if( remaining.count() > 0 ){
         /*
-         * wait_msec and last_get_msec provide a global throttling mechanism
-         * for ALL get requests to avoid excessive calls to TDMA servers
+         * wait_msec and last_get_msec provide a throttling mechanism
+         * for ALL get requests of a client_id to avoid excessive calls to
+         * TDMA servers
          */
-        assert( remaining <= wait_msec );
+        /* past 'wait' only when other slots are ahead of this one */
+        assert( remaining <= max(wait, to_slot) );
+        TDMA_PROBE2(throttle_wait, creds.client_id, remaining.count());
         std::this_thread::sleep_for( remaining );
     }
 
     string s;
     conn::clock_ty::time_point tp;
-    tie(s, tp) = connect_get( *(getter._connection), getter._credentials,
-                              getter._on_error_callback );
+    try{
+        tie(s, tp) = connect_get(connection, creds, on_error_cb);
+    }catch(...){
+        std::lock_guard<std::mutex> _(domain->stats_mtx);
+        ++domain->stats.nerrors;
+        throw;
+    }
 
-    last_get_msec =
-        std::chrono::duration_cast<milliseconds>(tp.time_since_epoch());
+    domain->last_get_msec.store(
+        std::chrono::duration_cast<milliseconds>(tp.time_since_epoch()).count()
+        );
     return s;
 }
 
 milliseconds
-APIGetterImpl::throttled_wait_remaining()
+APIGetterImpl::throttled_wait_remaining( const RateDomain& domain,
+                                         milliseconds wait )
 {
-    auto elapsed = util::get_msec_since_epoch<conn::clock_ty>() - last_get_msec;
-    assert( elapsed.count() >= 0 );
-    return wait_msec - elapsed;
+    auto elapsed = util::get_msec_since_epoch<conn::clock_ty>()
+                 - milliseconds( domain.last_get_msec.load() );
+    return wait - elapsed;
+}
+
+milliseconds
+APIGetterImpl::domain_wait_remaining( const RateDomain& domain,
+                                      milliseconds wait )
+{
+    auto ahead = milliseconds( domain.next_slot_msec.load() )
+               - util::get_msec_since_epoch<conn::clock_ty>();
+    return max(throttled_wait_remaining(domain, wait), ahead);
+}
+
+long long
+APIGetterImpl::reserve_slot(RateDomain& domain, milliseconds wait)
+{
+    long long next = domain.next_slot_msec.load();
+    long long slot;
+    do{
+        slot = std::max<long long>(
+            util::get_msec_since_epoch<conn::clock_ty>().count(),
+            domain.last_get_msec.load() + wait.count()
+            );
+        slot = std::max(slot, next);
+    }while( !domain.next_slot_msec.compare_exchange_weak(next,
+                                                         slot + wait.count()) );
+    return slot;
 }
 
 milliseconds
 APIGetterImpl::wait_remaining()
 {
-    static const milliseconds ms0(0);
-    return max(throttled_wait_remaining(), ms0);
+    milliseconds wait;
+    std::vector<std::shared_ptr<RateDomain>> domains;
+    {
+        std::lock_guard<std::mutex> _(rate_domains_mtx);
+        wait = wait_msec;
+        for( auto& d : rate_domains )
+            domains.push_back(d.second);
+    }
+
+    /* doesn't wait on a domain's get() */
+    milliseconds r(0);
+    for( auto& d : domains )
+        r = max(domain_wait_remaining(*d, wait), r);
+    return r;
+}
+
+milliseconds
+APIGetterImpl::wait_remaining(const string& client_id)
+{
+    std::shared_ptr<RateDomain> domain;
+    milliseconds wait;
+    {
+        std::lock_guard<std::mutex> _(rate_domains_mtx);
+        auto d = rate_domains.find(client_id);
+        if( d == rate_domains.end() )
+            return milliseconds(0);
+        domain = d->second;
+        wait = wait_msec;
+    }
+    return max(domain_wait_remaining(*domain, wait), milliseconds(0));
+}
+
+std::set<string>
+APIGetterImpl::get_rate_domains()
+{
+    std::set<string> ids;
+    std::lock_guard<std::mutex> _(rate_domains_mtx);
+    for( auto& d : rate_domains )
+        ids.insert(d.first);
+    return ids;
+}
+
+GetterRateDomainStats
+APIGetterImpl::get_rate_domain_stats(const string& client_id)
+{
+    std::shared_ptr<RateDomain> domain;
+    milliseconds wait;
+    {
+        std::lock_guard<std::mutex> _(rate_domains_mtx);
+        auto d = rate_domains.find(client_id);
+        if( d == rate_domains.end() )
+            TDMA_API_THROW( ValueException,
+                            "no rate domain for client_id: " + client_id );
+        domain = d->second;
+        wait = wait_msec;
+    }
+
+    GetterRateDomainStats stats;
+    {
+        std::lock_guard<std::mutex> _(domain->stats_mtx);
+        stats = domain->stats;
+    }
+    auto remaining = domain_wait_remaining(*domain, wait);
+    stats.wait_remaining_msec = static_cast<unsigned long long>(
+        max(remaining, milliseconds(0)).count()
+        );
+    return stats;
 }
 
 void
 APIGetterImpl::set_wait_msec(milliseconds msec)
 {
-    std::lock_guard<std::mutex> _(get_mtx);
+    std::lock_guard<std::mutex> _(rate_domains_mtx);
     wait_msec = msec;
 }
 
 milliseconds
 APIGetterImpl::get_wait_msec()
-{ return wait_msec; }
+{
+    std::lock_guard<std::mutex> _(rate_domains_mtx);
+    return wait_msec;
+}
+
+
+double
+JsonRecordReader::Value::as_double() const
+{
+    static const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+    switch(type){
+    case INTEGER:
+        return static_cast<double>(i);
+    case FLOAT:
+        return d;
+    case STRING: { /* e.g "NaN" */
+        char *e;
+        double v = strtod(s->c_str(), &e);
+        return (e != s->c_str()) ? v : NaN;
+    }
+    default:
+        return NaN;
+    }
+}
+
+long long
+JsonRecordReader::Value::as_llong() const
+{
+    if( type == INTEGER )
+        return i;
+    if( type == FLOAT )
+        return std::isfinite(d) ? static_cast<long long>(d) : 0;
+    return 0;
+}
+
+bool
+JsonRecordReader::Value::as_bool() const
+{ return type == BOOLEAN && i; }
+
+
+JsonRecordReader::JsonRecordReader(int depth, std::vector<std::string> roots)
+    :
+        _depth(depth),
+        _roots(std::move(roots)),
+        _level(0),
+        _root(-1),
+        _in_record(false)
+    {
+    }
+
+void
+JsonRecordReader::read(const std::string& s)
+{
+    if( !s.empty() )
+        json::sax_parse(s.begin(), s.end(), this);
+}
+
+void
+JsonRecordReader::_scalar(const Value& v)
+{
+    if( _in_record && _level == _depth )
+        field(_key, v);
+}
+
+bool
+JsonRecordReader::null()
+{ return true; }
+
+bool
+JsonRecordReader::boolean(bool val)
+{
+    _scalar( Value{Value::BOOLEAN, val, 0.0, nullptr} );
+    return true;
+}
+
+bool
+JsonRecordReader::number_integer(number_integer_t val)
+{
+    _scalar( Value{Value::INTEGER, val, 0.0, nullptr} );
+    return true;
+}
+
+bool
+JsonRecordReader::number_unsigned(number_unsigned_t val)
+{
+    _scalar( Value{Value::INTEGER, static_cast<long long>(val), 0.0, nullptr} );
+    return true;
+}
+
+bool
+JsonRecordReader::number_float(number_float_t val, const string_t& s)
+{
+    _scalar( Value{Value::FLOAT, 0, val, nullptr} );
+    return true;
+}
+
+bool
+JsonRecordReader::string(string_t& val)
+{
+    _scalar( Value{Value::STRING, 0, 0.0, &val} );
+    return true;
+}
+
+bool
+JsonRecordReader::start_object(std::size_t elements)
+{
+    if( ++_level == _depth && _root >= 0 ){
+        _in_record = true;
+        begin_record(_root);
+    }
+    return true;
+}
+
+bool
+JsonRecordReader::key(string_t& val)
+{
+    if( _level == 1 ){
+        auto f = std::find(_roots.begin(), _roots.end(), val);
+        _root = (f == _roots.end()) ? -1 : static_cast<int>(f - _roots.begin());
+    }else if( _in_record && _level == _depth ){
+        _key = val;
+    }
+    return true;
+}
+
+bool
+JsonRecordReader::end_object()
+{
+    if( _level-- == _depth )
+        _in_record = false;
+    return true;
+}
+
+bool
+JsonRecordReader::start_array(std::size_t elements)
+{
+    ++_level;
+    return true;
+}
+
+bool
+JsonRecordReader::end_array()
+{
+    --_level;
+    return true;
+}
+
+bool
+JsonRecordReader::parse_error( std::size_t position,
+                               const std::string& last_token,
+                               const nlohmann::detail::exception& ex )
+{
+    throw ex;
+}
+
+
+void*
+grow_records(void *buf, size_t nbytes)
+{
+    void *p = realloc(buf, nbytes);
+    if( !p )
+        TDMA_API_THROW(MemoryError, "failed to allocate buffer memory");
+    return p;
+}
 
 } /* tdma */
 
@@ -241,6 +672,105 @@ APIGetter_GetTimeout_ABI(Getter_C *pgetter, unsigned long long *msec, int allow_
     return err;
 }
 
+int
+APIGetter_ReserveSlot_ABI( Getter_C *pgetter,
+                           unsigned long long *slot,
+                           unsigned long long *delay_msec,
+                           int allow_exceptions )
+{
+    int err = proxy_is_callable<APIGetterImpl>(pgetter, allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_PTR(slot, "slot", allow_exceptions);
+    CHECK_PTR(delay_msec, "delay_msec", allow_exceptions);
+
+    static auto meth = +[](void* obj){
+        return reinterpret_cast<APIGetterImpl*>(obj)->reserve_slot();
+    };
+
+    std::pair<long long, milliseconds> r;
+    tie(r, err) = CallImplFromABI(allow_exceptions, meth, pgetter->obj);
+    if( err )
+        return err;
+
+    *slot = static_cast<unsigned long long>(r.first);
+    *delay_msec = static_cast<unsigned long long>(r.second.count());
+    return 0;
+}
+
+int
+APIGetter_GetInSlot_ABI( Getter_C *pgetter,
+                         unsigned long long slot,
+                         char **buf,
+                         size_t *n,
+                         int allow_exceptions )
+{
+    int err = proxy_is_callable<APIGetterImpl>(pgetter, allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_PTR(buf, "buf", allow_exceptions);
+    CHECK_PTR(n, "n", allow_exceptions);
+    if( slot == 0 ){
+        return HANDLE_ERROR( ValueException, "invalid slot",
+                             allow_exceptions );
+    }
+
+    static auto meth = +[](void* obj, long long s){
+        return reinterpret_cast<APIGetterImpl*>(obj)->get_in_slot(s);
+    };
+
+    string r;
+    tie(r, err) = CallImplFromABI( allow_exceptions, meth, pgetter->obj,
+                                   static_cast<long long>(slot) );
+    if( err )
+        return err;
+
+    return to_new_char_buffer(r, buf, n, allow_exceptions);
+}
+
+
+namespace tdma{
+
+/* TDMA_API_DIRECT_LINKAGE: the C++ proxy always holds a valid object */
+namespace {
+
+inline APIGetterImpl*
+direct_impl(Getter_C *pgetter)
+{
+    assert( pgetter && pgetter->obj );
+    return reinterpret_cast<APIGetterImpl*>(pgetter->obj);
+}
+
+} /* namespace */
+
+string
+APIGetter_Get_Direct(Getter_C *pgetter)
+{ return direct_impl(pgetter)->get(); }
+
+json
+APIGetter_GetJson_Direct(Getter_C *pgetter)
+{ return direct_impl(pgetter)->get_json(); }
+
+void
+APIGetter_Close_Direct(Getter_C *pgetter)
+{ direct_impl(pgetter)->close(); }
+
+bool
+APIGetter_IsClosed_Direct(Getter_C *pgetter)
+{ return direct_impl(pgetter)->is_closed(); }
+
+void
+APIGetter_SetTimeout_Direct(Getter_C *pgetter, milliseconds msec)
+{ direct_impl(pgetter)->set_timeout(msec); }
+
+milliseconds
+APIGetter_GetTimeout_Direct(Getter_C *pgetter)
+{ return direct_impl(pgetter)->get_timeout(); }
+
+} /* tdma */
+
 
 int
 APIGetter_SetWaitMSec_ABI(unsigned long long msec, int allow_exceptions)
@@ -287,6 +817,66 @@ APIGetter_WaitRemaining_ABI(unsigned long long *msec, int allow_exceptions)
     return 0;
 }
 
+int
+APIGetter_WaitRemainingForClient_ABI( const char* client_id,
+                                      unsigned long long *msec,
+                                      int allow_exceptions )
+{
+    CHECK_PTR(client_id, "client_id", allow_exceptions);
+    CHECK_PTR(msec, "msec", allow_exceptions);
+
+    milliseconds r;
+    int err;
+    tie(r, err) = CallImplFromABI(
+        allow_exceptions,
+        static_cast<milliseconds(*)(const string&)>(
+            APIGetterImpl::wait_remaining ),
+        client_id );
+    if( err )
+        return err;
+
+    *msec = static_cast<unsigned long long>(r.count());
+    return 0;
+}
+
+int
+APIGetter_GetRateDomains_ABI( char ***client_ids,
+                              size_t *n,
+                              int allow_exceptions )
+{
+    CHECK_PTR(client_ids, "client_ids", allow_exceptions);
+    CHECK_PTR(n, "n", allow_exceptions);
+
+    std::set<string> ids;
+    int err;
+    tie(ids, err) = CallImplFromABI( allow_exceptions,
+                                     APIGetterImpl::get_rate_domains );
+    if( err )
+        return err;
+
+    return to_new_char_buffers(ids, client_ids, n, allow_exceptions);
+}
+
+int
+APIGetter_GetRateDomainStats_ABI( const char* client_id,
+                                  GetterRateDomainStats *pstats,
+                                  int allow_exceptions )
+{
+    CHECK_PTR(client_id, "client_id", allow_exceptions);
+    CHECK_PTR(pstats, "stats", allow_exceptions);
+
+    GetterRateDomainStats stats;
+    int err;
+    tie(stats, err) = CallImplFromABI( allow_exceptions,
+                                       APIGetterImpl::get_rate_domain_stats,
+                                       client_id );
+    if( err )
+        return err;
+
+    *pstats = stats;
+    return 0;
+}
+
 int
 APIGetter_ShareConnections_ABI(int b, int allow_exceptions)
 {
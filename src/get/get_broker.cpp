@@ -0,0 +1,583 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif /* _WIN32 */
+
+#include "../../include/_tdma_api.h"
+#include "../../include/_get.h"
+#include "../../include/_get_broker.h"
+#include "../../include/_executor.h"
+
+using std::string;
+using std::cout;
+using std::endl;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+namespace tdma{
+
+const milliseconds GetterBrokerImpl::DEF_CACHE_MSEC(500);
+
+void
+D(string msg, GetterBrokerImpl *obj)
+{ util::debug_out("GetterBrokerImpl", msg, obj, cout); }
+
+
+namespace {
+
+const uint32_t MAX_URL_LEN = 64 * 1024;
+
+std::unique_ptr<GetterBrokerImpl> the_broker;
+std::mutex the_broker_mtx;
+
+/* thrown by the broker's error callback to pass the raw response back */
+struct HTTPErrorResponse{
+    long code;
+    string data;
+};
+
+void
+throw_http_error(long code, const string& data)
+{ throw HTTPErrorResponse{code, data}; }
+
+void
+throw_from_broker(int code, const string& msg)
+{
+    string m = "(broker) " + msg;
+    switch(code){
+    case TDMA_API_CRED_ERROR:
+        TDMA_API_THROW(LocalCredentialException, m);
+    case TDMA_API_VALUE_ERROR:
+        TDMA_API_THROW(ValueException, m);
+    case TDMA_API_TYPE_ERROR:
+        TDMA_API_THROW(TypeException, m);
+    case TDMA_API_MEMORY_ERROR:
+        TDMA_API_THROW(MemoryError, m);
+    case TDMA_API_CONNECT_ERROR:
+        TDMA_API_THROW(ConnectException, m);
+    case TDMA_API_AUTH_ERROR:
+        TDMA_API_THROW(AuthenticationException, m);
+    case TDMA_API_REQUEST_ERROR:
+        TDMA_API_THROW(InvalidRequest, m);
+    case TDMA_API_SERVER_ERROR:
+        TDMA_API_THROW(ServerError, m);
+    default:
+        TDMA_API_THROW(APIException, m);
+    };
+}
+
+#ifndef _WIN32
+
+sockaddr_un
+socket_addr(const string& path)
+{
+    if( path.empty() )
+        TDMA_API_THROW(ValueException, "empty broker path");
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    if( path.size() >= sizeof(addr.sun_path) )
+        TDMA_API_THROW(ValueException, "broker path too long");
+
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path.c_str());
+    return addr;
+}
+
+bool
+read_all(int fd, void *buf, size_t n)
+{
+    char *p = reinterpret_cast<char*>(buf);
+    while( n ){
+        ssize_t r = ::recv(fd, p, n, 0);
+        if( r < 0 && errno == EINTR )
+            continue;
+        if( r <= 0 )
+            return false;
+        p += r;
+        n -= r;
+    }
+    return true;
+}
+
+bool
+write_all(int fd, const void *buf, size_t n)
+{
+    const char *p = reinterpret_cast<const char*>(buf);
+    while( n ){
+        ssize_t r = ::send(fd, p, n, MSG_NOSIGNAL);
+        if( r < 0 && errno == EINTR )
+            continue;
+        if( r <= 0 )
+            return false;
+        p += r;
+        n -= r;
+    }
+    return true;
+}
+
+bool
+write_response(int fd, const GetterBrokerResponse& r)
+{
+    int32_t head[2] = { static_cast<int32_t>(r.status), r.code };
+    uint32_t len = static_cast<uint32_t>(r.data.size());
+    return write_all(fd, head, sizeof(head))
+        && write_all(fd, &len, sizeof(len))
+        && write_all(fd, r.data.data(), len);
+}
+
+#endif /* _WIN32 */
+
+} /* namespace */
+
+
+#ifndef _WIN32
+
+GetterBrokerImpl::GetterBrokerImpl( Credentials& creds,
+                                    const string& path,
+                                    milliseconds cache_msec )
+    :
+        _credentials( creds ),
+        _path( path ),
+        _cache_msec( cache_msec ),
+        _listen_fd( -1 ),
+        _running( false ),
+        _connection( conn::HttpMethod::http_get ),
+        _nrequests( 0 ),
+        _nfetched( 0 )
+    {
+        sockaddr_un addr = socket_addr(path);
+
+        _listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if( _listen_fd == -1 ){
+            TDMA_API_THROW( APIException,
+                            "socket failed: " + string(strerror(errno)) );
+        }
+
+        /* a stale socket from a dead broker is simply replaced */
+        ::unlink( path.c_str() );
+
+        /* owner-only from creation; chmod after bind leaves a window */
+        mode_t old_mask = ::umask(S_IRWXG | S_IRWXO);
+        int bound = ::bind( _listen_fd, reinterpret_cast<sockaddr*>(&addr),
+                            sizeof(addr) );
+        ::umask(old_mask);
+
+        if( bound == -1
+            || ::chmod(path.c_str(), S_IRUSR | S_IWUSR) == -1
+            || ::listen(_listen_fd, SOMAXCONN) == -1 )
+        {
+            int e = errno;
+            ::close(_listen_fd);
+            ::unlink( path.c_str() );
+            TDMA_API_THROW( APIException, "failed to start broker at '"
+                            + path + "': " + string(strerror(e)) );
+        }
+
+        _running = true;
+        _accept_thread = Executor::instance().spawn_io(
+            "tdma-broker", std::bind(&GetterBrokerImpl::_accept_loop, this)
+            );
+        D("started at " + path, this);
+    }
+
+
+GetterBrokerImpl::~GetterBrokerImpl()
+{
+    _running = false;
+    ::shutdown(_listen_fd, SHUT_RDWR);
+    if( _accept_thread.joinable() )
+        _accept_thread.join();
+    ::close(_listen_fd);
+    ::unlink( _path.c_str() );
+
+    /* wake blocked clients; those waiting on a fetch finish it first */
+    {
+        std::lock_guard<std::mutex> _(_clients_mtx);
+        for( int fd : _client_fds )
+            ::shutdown(fd, SHUT_RDWR);
+    }
+    for( auto& t : _client_threads )
+        t.second.join();
+
+    D("stopped", this);
+}
+
+
+void
+GetterBrokerImpl::_accept_loop()
+{
+    while( _running ){
+        int fd = ::accept(_listen_fd, nullptr, nullptr);
+        if( fd == -1 ){
+            if( errno == EINTR || errno == ECONNABORTED )
+                continue;
+            break;
+        }
+
+        std::lock_guard<std::mutex> _(_clients_mtx);
+        if( !_running ){
+            ::close(fd);
+            break;
+        }
+        _join_finished();
+        _client_fds.insert(fd);
+        std::thread t = Executor::instance().spawn_io(
+            "tdma-broker-cli",
+            std::bind(&GetterBrokerImpl::_client_loop, this, fd)
+            );
+        _client_threads.emplace(t.get_id(), std::move(t));
+    }
+}
+
+
+void
+GetterBrokerImpl::_join_finished()
+{
+    for( auto id : _finished_threads ){
+        auto t = _client_threads.find(id);
+        if( t != _client_threads.end() ){
+            t->second.join();
+            _client_threads.erase(t);
+        }
+    }
+    _finished_threads.clear();
+}
+
+
+void
+GetterBrokerImpl::_client_loop(int fd)
+{
+    uint32_t len;
+    while( _running && read_all(fd, &len, sizeof(len)) ){
+        if( len > MAX_URL_LEN )
+            break;
+
+        string url(len, '\0');
+        if( !read_all(fd, &url[0], len) )
+            break;
+
+        if( !write_response(fd, _request(url)) )
+            break;
+    }
+
+    std::lock_guard<std::mutex> _(_clients_mtx);
+    _client_fds.erase(fd);
+    _finished_threads.push_back( std::this_thread::get_id() );
+    ::close(fd);
+}
+
+#else
+
+GetterBrokerImpl::GetterBrokerImpl( Credentials& creds,
+                                    const string& path,
+                                    milliseconds cache_msec )
+    :
+        _credentials( creds ),
+        _path( path ),
+        _cache_msec( cache_msec ),
+        _listen_fd( -1 ),
+        _running( false ),
+        _connection( conn::HttpMethod::http_get ),
+        _nrequests( 0 ),
+        _nfetched( 0 )
+    {
+        TDMA_API_THROW( APIException, "getter broker not supported on windows" );
+    }
+
+GetterBrokerImpl::~GetterBrokerImpl()
+{}
+
+void
+GetterBrokerImpl::_accept_loop()
+{}
+
+void
+GetterBrokerImpl::_client_loop(int fd)
+{}
+
+void
+GetterBrokerImpl::_join_finished()
+{}
+
+#endif /* _WIN32 */
+
+
+GetterBrokerResponse
+GetterBrokerImpl::_request(const string& url)
+{
+    ++_nrequests;
+
+    /* the broker's token only goes to the API */
+    if( url.compare(0, URL_BASE.size(), URL_BASE) != 0 ){
+        return GetterBrokerResponse{
+            GetterBrokerStatus::exception, TDMA_API_VALUE_ERROR,
+            "url not under " + URL_BASE + ": " + url
+        };
+    }
+
+    std::shared_ptr<InFlight> flight;
+    {
+        std::unique_lock<std::mutex> lock(_state_mtx);
+
+        auto c = _cache.find(url);
+        if( c != _cache.end() ){
+            if( steady_clock::now() < c->second.expires ){
+                return GetterBrokerResponse{
+                    GetterBrokerStatus::ok,
+                    static_cast<int32_t>(conn::HTTP_RESPONSE_OK),
+                    c->second.data
+                };
+            }
+            _cache.erase(c);
+        }
+
+        auto f = _in_flight.find(url);
+        if( f != _in_flight.end() ){
+            /* coalesce w/ the identical request that's already out */
+            flight = f->second;
+            flight->cv.wait(lock, [&]{ return flight->done; });
+            return flight->response;
+        }
+
+        flight = std::make_shared<InFlight>();
+        _in_flight.emplace(url, flight);
+    }
+
+    /* we're the first, make the request */
+    GetterBrokerResponse r = _fetch(url);
+
+    std::lock_guard<std::mutex> _(_state_mtx);
+    if( r.status == GetterBrokerStatus::ok && _cache_msec.count() > 0 ){
+        auto now = steady_clock::now();
+        for( auto c = _cache.begin(); c != _cache.end(); ){
+            if( c->second.expires <= now )
+                c = _cache.erase(c);
+            else
+                ++c;
+        }
+        _cache[url] = CacheEntry{now + _cache_msec, r.data};
+    }
+    flight->response = r;
+    flight->done = true;
+    flight->cv.notify_all();
+    _in_flight.erase(url);
+    return r;
+}
+
+
+GetterBrokerResponse
+GetterBrokerImpl::_fetch(const string& url)
+{
+    try{
+        std::lock_guard<std::mutex> _(_conn_mtx);
+        _connection.set_url(url);
+        string s = APIGetterImpl::throttled_get( _connection, _credentials,
+                                                 throw_http_error );
+        ++_nfetched;
+        return GetterBrokerResponse{
+            GetterBrokerStatus::ok,
+            static_cast<int32_t>(conn::HTTP_RESPONSE_OK),
+            s
+        };
+    }catch( HTTPErrorResponse& e ){
+        ++_nfetched;
+        return GetterBrokerResponse{
+            GetterBrokerStatus::http_error, static_cast<int32_t>(e.code), e.data
+        };
+    }catch( APIException& e ){
+        return GetterBrokerResponse{
+            GetterBrokerStatus::exception, e.error_code(), e.what()
+        };
+    }catch( std::exception& e ){
+        return GetterBrokerResponse{
+            GetterBrokerStatus::exception, TDMA_API_STD_EXCEPTION, e.what()
+        };
+    }
+}
+
+
+void
+GetterBrokerImpl::start( Credentials& creds,
+                         const string& path,
+                         milliseconds cache_msec )
+{
+    std::lock_guard<std::mutex> _(the_broker_mtx);
+    if( the_broker )
+        TDMA_API_THROW( APIException, "broker already running at '"
+                        + the_broker->get_path() + "'" );
+
+    the_broker.reset( new GetterBrokerImpl(creds, path, cache_msec) );
+}
+
+
+void
+GetterBrokerImpl::stop()
+{
+    std::unique_ptr<GetterBrokerImpl> b;
+    {
+        std::lock_guard<std::mutex> _(the_broker_mtx);
+        b.swap(the_broker);
+    }
+    /* destroyed (joined) outside the lock */
+}
+
+
+bool
+GetterBrokerImpl::is_running()
+{
+    std::lock_guard<std::mutex> _(the_broker_mtx);
+    return static_cast<bool>(the_broker);
+}
+
+
+string
+GetterBrokerImpl::request( const string& path,
+                           const string& url,
+                           api_on_error_cb_ty on_error_cb )
+{
+#ifndef _WIN32
+    sockaddr_un addr = socket_addr(path);
+
+    if( url.size() > MAX_URL_LEN )
+        TDMA_API_THROW( ValueException, "url too long for broker" );
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if( fd == -1 ){
+        TDMA_API_THROW( ConnectException,
+                        "socket failed: " + string(strerror(errno)) );
+    }
+
+    if( ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1 ){
+        int e = errno;
+        ::close(fd);
+        TDMA_API_THROW( ConnectException, "failed to connect to broker at '"
+                        + path + "': " + string(strerror(e)) );
+    }
+
+    uint32_t len = static_cast<uint32_t>(url.size());
+    int32_t head[2];
+    GetterBrokerResponse r;
+    bool good = write_all(fd, &len, sizeof(len))
+             && write_all(fd, url.data(), len)
+             && read_all(fd, head, sizeof(head))
+             && read_all(fd, &len, sizeof(len));
+    if( good ){
+        r.status = static_cast<GetterBrokerStatus>(head[0]);
+        r.code = head[1];
+        r.data.resize(len);
+        good = (len == 0) || read_all(fd, &r.data[0], len);
+    }
+    ::close(fd);
+
+    if( !good )
+        TDMA_API_THROW( ConnectException, "lost connection to broker" );
+
+    switch( r.status ){
+    case GetterBrokerStatus::ok:
+        return r.data;
+    case GetterBrokerStatus::http_error:
+        /* same handling as on_return, minus the (broker side) refresh */
+        std::cerr<< "error response: " << r.code << endl;
+        on_error_cb(r.code, r.data);
+        TDMA_API_THROW(ConnectException, "unknown exception", r.code);
+    default:
+        throw_from_broker(r.code, r.data);
+    };
+#else
+    TDMA_API_THROW( APIException, "getter broker not supported on windows" );
+#endif /* _WIN32 */
+    return "";
+}
+
+} /* tdma */
+
+
+using namespace tdma;
+
+int
+APIGetter_StartBroker_ABI( Credentials *pcreds,
+                           const char* path,
+                           unsigned long long cache_msec,
+                           int allow_exceptions )
+{
+    CHECK_PTR(pcreds, "credentials", allow_exceptions);
+    CHECK_PTR(path, "path", allow_exceptions);
+
+    static auto meth = +[](Credentials* c, const char* p,
+                           unsigned long long m){
+        GetterBrokerImpl::start(*c, p, milliseconds(m));
+    };
+
+    return CallImplFromABI( allow_exceptions, meth, pcreds, path, cache_msec );
+}
+
+int
+APIGetter_StopBroker_ABI(int allow_exceptions)
+{
+    return CallImplFromABI( allow_exceptions, GetterBrokerImpl::stop );
+}
+
+int
+APIGetter_IsBrokerRunning_ABI(int *b, int allow_exceptions)
+{
+    CHECK_PTR(b, "b", allow_exceptions);
+
+    *b = static_cast<int>( GetterBrokerImpl::is_running() );
+    return 0;
+}
+
+int
+APIGetter_GetDefBrokerCacheMSec_ABI( unsigned long long *msec,
+                                     int allow_exceptions )
+{
+    CHECK_PTR(msec, "msec", allow_exceptions);
+
+    *msec = static_cast<unsigned long long>(
+        GetterBrokerImpl::DEF_CACHE_MSEC.count()
+        );
+    return 0;
+}
+
+int
+APIGetter_UseBroker_ABI(const char* path, int allow_exceptions)
+{
+    static auto meth = +[](const char* p){
+        APIGetterImpl::use_broker( p ? p : "" );
+    };
+
+    return CallImplFromABI( allow_exceptions, meth, path );
+}
+
+int
+APIGetter_GetBroker_ABI(char** buf, size_t *n, int allow_exceptions)
+{
+    CHECK_PTR(buf, "buf", allow_exceptions);
+    CHECK_PTR(n, "n", allow_exceptions);
+
+    return to_new_char_buffer( APIGetterImpl::get_broker(), buf, n,
+                               allow_exceptions );
+}
@@ -21,6 +21,7 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 #include <tuple>
 #include <cctype>
 #include <string>
+#include <limits>
 
 #include "../../include/_tdma_api.h"
 #include "../../include/_get.h"
@@ -129,6 +130,57 @@ public:
         build();
     }
 
+    /* decoded straight from the response into a new buffer */
+    void
+    get_candles(TDMA_Candle **candles, size_t *n)
+    {
+        RecordBuffer<TDMA_Candle> buf;
+        CandleReader(buf).read( get() );
+        buf.release(candles, n);
+    }
+
+private:
+    /* {"candles":[{...}, ...], ...} */
+    class CandleReader
+            : public JsonRecordReader {
+        RecordBuffer<TDMA_Candle>& _buf;
+        TDMA_Candle *_c;
+
+    public:
+        CandleReader(RecordBuffer<TDMA_Candle>& buf)
+            :
+                JsonRecordReader(3, {"candles"}),
+                _buf(buf),
+                _c(nullptr)
+            {
+            }
+
+    protected:
+        void
+        begin_record(int root)
+        {
+            static const double NaN = std::numeric_limits<double>::quiet_NaN();
+            _c = &_buf.add();
+            _c->open = _c->high = _c->low = _c->close = NaN;
+        }
+
+        void
+        field(const std::string& key, const Value& v)
+        {
+            if( key == "datetime" )
+                _c->datetime = v.as_llong();
+            else if( key == "open" )
+                _c->open = v.as_double();
+            else if( key == "high" )
+                _c->high = v.as_double();
+            else if( key == "low" )
+                _c->low = v.as_double();
+            else if( key == "close" )
+                _c->close = v.as_double();
+            else if( key == "volume" )
+                _c->volume = v.as_llong();
+        }
+    };
 };
 
 
@@ -410,6 +462,37 @@ HistoricalGetterBase_SetExtendedHours_ABI( Getter_C *pgetter,
         );
 }
 
+int
+HistoricalGetterBase_GetCandles_ABI( Getter_C *pgetter,
+                                     TDMA_Candle **candles,
+                                     size_t *n,
+                                     int allow_exceptions )
+{
+    int err = proxy_is_callable<HistoricalGetterBaseImpl>(pgetter,
+                                                          allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_PTR(candles, "candles", allow_exceptions);
+    CHECK_PTR(n, "n", allow_exceptions);
+
+    static auto meth = +[](void* obj, TDMA_Candle** candles, size_t* n){
+        reinterpret_cast<HistoricalGetterBaseImpl*>(obj)->get_candles(
+            candles, n
+            );
+    };
+
+    return CallImplFromABI(allow_exceptions, meth, pgetter->obj, candles, n);
+}
+
+int
+FreeCandlesBuffer_ABI( TDMA_Candle *candles, int allow_exceptions )
+{
+    if( candles )
+        free( (void*)candles );
+    return 0;
+}
+
 int
 HistoricalGetterBase_SetFrequency_ABI( Getter_C *pgetter,
                                        int frequency_type,
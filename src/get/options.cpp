@@ -21,6 +21,9 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 #include <tuple>
 #include <cctype>
 #include <string>
+#include <algorithm>
+#include <cstring>
+#include <limits>
 
 #include "../../include/_tdma_api.h"
 #include "../../include/_get.h"
@@ -244,6 +247,111 @@ public:
         _option_type = option_type;
         build();
     }
+
+    /* decoded straight from the response into a new buffer */
+    void
+    get_quotes(TDMA_OptionQuote **quotes, size_t *n)
+    {
+        RecordBuffer<TDMA_OptionQuote> buf;
+        QuoteReader(buf).read( get() );
+
+        /* keys are sorted as strings, not by date/strike */
+        std::stable_sort( buf.begin(), buf.end(),
+            [](const TDMA_OptionQuote& l, const TDMA_OptionQuote& r){
+                return tie(l.is_put, l.expiration, l.strike)
+                    < tie(r.is_put, r.expiration, r.strike);
+            });
+        buf.release(quotes, n);
+    }
+
+private:
+    /* {"callExpDateMap":{exp date:{strike:[{...}, ...]}}, "putExpDateMap":...} */
+    class QuoteReader
+            : public JsonRecordReader {
+        RecordBuffer<TDMA_OptionQuote>& _buf;
+        TDMA_OptionQuote *_q;
+
+        typedef double TDMA_OptionQuote::*double_field_ty;
+        typedef long long TDMA_OptionQuote::*llong_field_ty;
+
+        static const std::unordered_map<std::string, double_field_ty> DOUBLE_FIELDS;
+        static const std::unordered_map<std::string, llong_field_ty> LLONG_FIELDS;
+
+    public:
+        QuoteReader(RecordBuffer<TDMA_OptionQuote>& buf)
+            :
+                JsonRecordReader(5, {"callExpDateMap", "putExpDateMap"}),
+                _buf(buf),
+                _q(nullptr)
+            {
+            }
+
+    protected:
+        void
+        begin_record(int root)
+        {
+            static const double NaN = std::numeric_limits<double>::quiet_NaN();
+            _q = &_buf.add();
+            for( auto& f : DOUBLE_FIELDS )
+                _q->*(f.second) = NaN;
+            _q->is_put = root;
+        }
+
+        void
+        field(const std::string& key, const Value& v)
+        {
+            auto d = DOUBLE_FIELDS.find(key);
+            if( d != DOUBLE_FIELDS.end() ){
+                _q->*(d->second) = v.as_double();
+                return;
+            }
+            auto ll = LLONG_FIELDS.find(key);
+            if( ll != LLONG_FIELDS.end() ){
+                _q->*(ll->second) = v.as_llong();
+                return;
+            }
+            if( key == "symbol" ){
+                if( v.type == Value::STRING )
+                    strncpy(_q->symbol, v.s->c_str(), sizeof(_q->symbol) - 1);
+            }else if( key == "daysToExpiration" ){
+                _q->days_to_expiration = static_cast<int>( v.as_llong() );
+            }else if( key == "inTheMoney" ){
+                _q->in_the_money = v.as_bool();
+            }else if( key == "nonStandard" ){
+                _q->non_standard = v.as_bool();
+            }
+        }
+    };
+};
+
+const std::unordered_map<string, OptionChainGetterImpl::QuoteReader::double_field_ty>
+OptionChainGetterImpl::QuoteReader::DOUBLE_FIELDS = {
+    {"strikePrice", &TDMA_OptionQuote::strike},
+    {"bid", &TDMA_OptionQuote::bid},
+    {"ask", &TDMA_OptionQuote::ask},
+    {"last", &TDMA_OptionQuote::last},
+    {"mark", &TDMA_OptionQuote::mark},
+    {"volatility", &TDMA_OptionQuote::volatility},
+    {"delta", &TDMA_OptionQuote::delta},
+    {"gamma", &TDMA_OptionQuote::gamma},
+    {"theta", &TDMA_OptionQuote::theta},
+    {"vega", &TDMA_OptionQuote::vega},
+    {"rho", &TDMA_OptionQuote::rho},
+    {"timeValue", &TDMA_OptionQuote::time_value},
+    {"theoreticalOptionValue", &TDMA_OptionQuote::theoretical_value},
+    {"multiplier", &TDMA_OptionQuote::multiplier}
+};
+
+const std::unordered_map<string, OptionChainGetterImpl::QuoteReader::llong_field_ty>
+OptionChainGetterImpl::QuoteReader::LLONG_FIELDS = {
+    {"expirationDate", &TDMA_OptionQuote::expiration},
+    {"bidSize", &TDMA_OptionQuote::bid_size},
+    {"askSize", &TDMA_OptionQuote::ask_size},
+    {"lastSize", &TDMA_OptionQuote::last_size},
+    {"totalVolume", &TDMA_OptionQuote::total_volume},
+    {"openInterest", &TDMA_OptionQuote::open_interest},
+    {"quoteTimeInLong", &TDMA_OptionQuote::quote_time},
+    {"tradeTimeInLong", &TDMA_OptionQuote::trade_time}
 };
 
 
@@ -726,6 +834,42 @@ OptionChainGetter_SetOptionType_ABI( OptionChainGetter_C *pgetter,
         );
 }
 
+int
+OptionChainGetter_GetQuotes_ABI( OptionChainGetter_C *pgetter,
+                                 TDMA_OptionQuote **quotes,
+                                 size_t *n,
+                                 int allow_exceptions )
+{
+    int err = proxy_is_callable<OptionChainGetterImpl>(pgetter,
+                                                       allow_exceptions);
+    if( err )
+        return err;
+
+    /* strategy chains are lists of legs, not contracts */
+    if( pgetter->type_id == TYPE_ID_GETTER_OPTION_CHAIN_STRATEGY ){
+        return HANDLE_ERROR(TypeException,
+            "quotes not supported by OptionChainStrategyGetter",
+            allow_exceptions);
+    }
+
+    CHECK_PTR(quotes, "quotes", allow_exceptions);
+    CHECK_PTR(n, "n", allow_exceptions);
+
+    static auto meth = +[](void* obj, TDMA_OptionQuote** quotes, size_t* n){
+        reinterpret_cast<OptionChainGetterImpl*>(obj)->get_quotes(quotes, n);
+    };
+
+    return CallImplFromABI(allow_exceptions, meth, pgetter->obj, quotes, n);
+}
+
+int
+FreeOptionQuotesBuffer_ABI( TDMA_OptionQuote *quotes, int allow_exceptions )
+{
+    if( quotes )
+        free( (void*)quotes );
+    return 0;
+}
+
 
 int
 OptionChainStrategyGetter_Create_ABI( struct Credentials *pcreds,
@@ -326,6 +326,38 @@ StreamingCallbackType_to_string_ABI( TDMA_API_TO_STRING_ABI_ARGS )
     }
 }
 
+int
+StreamingFilterRuleType_to_string_ABI( TDMA_API_TO_STRING_ABI_ARGS )
+{
+    CHECK_ENUM(StreamingFilterRuleType, v, allow_exceptions);
+
+    switch(static_cast<StreamingFilterRuleType>(v)){
+    case StreamingFilterRuleType::changed:
+        return to_new_char_buffer("changed", buf, n, allow_exceptions);
+    case StreamingFilterRuleType::delta:
+        return to_new_char_buffer("delta", buf, n, allow_exceptions);
+    case StreamingFilterRuleType::cross:
+        return to_new_char_buffer("cross", buf, n, allow_exceptions);
+    default:
+        throw std::runtime_error("Invalid StreamingFilterRuleType");
+    }
+}
+
+int
+SocketBackendType_to_string_ABI( TDMA_API_TO_STRING_ABI_ARGS )
+{
+    CHECK_ENUM(SocketBackendType, v, allow_exceptions);
+
+    switch(static_cast<SocketBackendType>(v)){
+    case SocketBackendType::epoll:
+        return to_new_char_buffer("epoll", buf, n, allow_exceptions);
+    case SocketBackendType::io_uring:
+        return to_new_char_buffer("io_uring", buf, n, allow_exceptions);
+    default:
+        throw std::runtime_error("Invalid SocketBackendType");
+    }
+}
+
 int
 StreamerServiceType_to_string_ABI( TDMA_API_TO_STRING_ABI_ARGS )
 {
@@ -0,0 +1,218 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include <cmath>
+#include <algorithm>
+
+#include "../../include/_streaming_filter.h"
+
+using std::string;
+using std::set;
+
+namespace {
+
+/* false if the field is missing or not a number */
+bool
+field_value(const json& item, const string& field, double& value)
+{
+    auto f = item.find(field);
+    if( f == item.end() || !f->is_number() )
+        return false;
+    value = f->get<double>();
+    return true;
+}
+
+/* tolerate rounding so e.g. 100.05 - 100.0 counts as a .05 move */
+bool
+moved_at_least(double from, double to, double delta)
+{
+    double eps = 1e-9 * std::max(1.0, std::max(std::fabs(from), std::fabs(to)));
+    return std::fabs(to - from) + eps >= delta;
+}
+
+} /* namespace */
+
+
+namespace tdma{
+
+StreamingFilterImpl::StreamingFilterImpl()
+    :
+        _npassed(0),
+        _ndropped(0)
+    {
+    }
+
+
+void
+StreamingFilterImpl::set_symbols(const set<string>& symbols)
+{ _symbols = std::unordered_set<string>(symbols.begin(), symbols.end()); }
+
+
+void
+StreamingFilterImpl::add_rule( int field,
+                               StreamingFilterRuleType type,
+                               double value )
+{
+    if( field < 0 )
+        TDMA_API_THROW(ValueException, "field < 0");
+    if( type == StreamingFilterRuleType::delta && !(value > 0) )
+        TDMA_API_THROW(ValueException, "delta threshold <= 0");
+    if( std::isnan(value) )
+        TDMA_API_THROW(ValueException, "threshold/level is nan");
+    _rules.push_back( Rule{type, std::to_string(field), value} );
+}
+
+
+bool
+StreamingFilterImpl::_passes(const json& item)
+{
+    if( !item.is_object() )
+        return true;
+
+    string symbol;
+    auto k = item.find("key");
+    if( k != item.end() && k->is_string() )
+        symbol = k->get<string>();
+
+    if( !_symbols.empty() && !_symbols.count(symbol) )
+        return false;
+
+    if( _rules.empty() )
+        return true;
+
+    bool pass = false;
+    double v;
+    for( auto& r : _rules ){
+        switch( r.type ){
+        case StreamingFilterRuleType::changed:
+            pass = pass || (item.find(r.field) != item.end());
+            break;
+        case StreamingFilterRuleType::delta:
+            if( !pass && field_value(item, r.field, v) ){
+                auto& last = _last_passed[symbol];
+                auto l = last.find(r.field);
+                pass = (l == last.end())
+                       || moved_at_least(l->second, v, r.value);
+            }
+            break;
+        case StreamingFilterRuleType::cross:
+            /* always update, so a cross isn't missed while dropping */
+            if( field_value(item, r.field, v) ){
+                auto& last = _last_seen[symbol];
+                auto l = last.find(r.field);
+                if( l != last.end() ){
+                    pass = pass || ( (l->second < r.value) != (v < r.value) );
+                    l->second = v;
+                }else{
+                    last.emplace(r.field, v);
+                }
+            }
+            break;
+        }
+    }
+
+    if( pass ){
+        /* the client now has these, measure deltas from here */
+        for( auto& r : _rules ){
+            if( r.type == StreamingFilterRuleType::delta
+                && field_value(item, r.field, v) )
+            {
+                _last_passed[symbol][r.field] = v;
+            }
+        }
+    }
+    return pass;
+}
+
+
+bool
+StreamingFilterImpl::apply(json& content)
+{
+    if( !content.is_array() )
+        return true;
+
+    auto& items = content.get_ref<json::array_t&>();
+    size_t n = 0;
+    for( size_t i = 0; i < items.size(); ++i ){
+        if( _passes(items[i]) ){
+            if( n != i )
+                items[n] = std::move(items[i]);
+            ++n;
+        }
+    }
+
+    _npassed += n;
+    _ndropped += items.size() - n;
+    items.resize(n);
+    return n > 0;
+}
+
+
+void
+StreamingFilterSet::set_symbols( StreamerServiceType service,
+                                 const set<string>& symbols )
+{
+    std::lock_guard<std::mutex> _(_mtx);
+    _filters[static_cast<int>(service)].set_symbols(symbols);
+}
+
+
+void
+StreamingFilterSet::add_rule( StreamerServiceType service,
+                              int field,
+                              StreamingFilterRuleType type,
+                              double value )
+{
+    std::lock_guard<std::mutex> _(_mtx);
+    _filters[static_cast<int>(service)].add_rule(field, type, value);
+}
+
+
+void
+StreamingFilterSet::clear(StreamerServiceType service)
+{
+    std::lock_guard<std::mutex> _(_mtx);
+    if( service == StreamerServiceType::NONE )
+        _filters.clear();
+    else
+        _filters.erase( static_cast<int>(service) );
+}
+
+
+bool
+StreamingFilterSet::apply(StreamerServiceType service, json& content)
+{
+    std::lock_guard<std::mutex> _(_mtx);
+    if( _filters.empty() )
+        return true;
+
+    auto f = _filters.find( static_cast<int>(service) );
+    return (f == _filters.end()) ? true : f->second.apply(content);
+}
+
+
+std::pair<unsigned long long, unsigned long long>
+StreamingFilterSet::get_stats(StreamerServiceType service) const
+{
+    std::lock_guard<std::mutex> _(_mtx);
+    auto f = _filters.find( static_cast<int>(service) );
+    if( f == _filters.end() )
+        return {0, 0};
+    return {f->second.get_npassed(), f->second.get_ndropped()};
+}
+
+} /* tdma */
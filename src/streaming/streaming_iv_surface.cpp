@@ -0,0 +1,564 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <algorithm>
+
+#include "../../include/_streaming_iv_surface.h"
+#include "../../include/_executor.h"
+
+using std::string;
+using std::vector;
+using std::shared_ptr;
+using std::chrono::steady_clock;
+using std::chrono::milliseconds;
+
+namespace {
+
+#define FIELD_STR(f) \
+    std::to_string( static_cast<int>(tdma::OptionsSubscriptionField::f) )
+
+const string F_VOLATILITY = FIELD_STR(volatility);
+const string F_EXP_YEAR = FIELD_STR(expiration_year);
+const string F_EXP_MONTH = FIELD_STR(expiration_month);
+const string F_EXP_DAY = FIELD_STR(expiration_day);
+const string F_STRIKE = FIELD_STR(strike_price);
+const string F_CONTRACT_TYPE = FIELD_STR(contract_type);
+const string F_UNDERLYING = FIELD_STR(underlying);
+const string F_UNDERLYING_PRICE = FIELD_STR(underlying_price);
+
+#undef FIELD_STR
+
+const double NaN = std::numeric_limits<double>::quiet_NaN();
+const double MIN_VOL = 1e-4;
+const double MAX_VOL = 10.0;
+const double EXPIRATION_DAY_FRAC = 21.0 / 24; // 21:00 UTC
+
+/* days since 1970-01-01 (proleptic gregorian) */
+int
+days_from_civil(int y, int m, int d)
+{
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+double
+now_in_days()
+{
+    using namespace std::chrono;
+    return duration<double>( system_clock::now().time_since_epoch() ).count()
+           / 86400;
+}
+
+template<typename T>
+bool
+get_field(const json& item, const string& field, T& value)
+{
+    auto f = item.find(field);
+    if( f == item.end() || f->is_null() )
+        return false;
+    value = f->get<T>();
+    return true;
+}
+
+/* OPTION/chain vols are in percent; nan if missing or nonsense */
+double
+to_decimal_vol(double vol)
+{
+    vol /= 100;
+    return (vol >= MIN_VOL && vol <= MAX_VOL) ? vol : NaN;
+}
+
+double
+norm_cdf(double x)
+{ return 0.5 * std::erfc(-x / std::sqrt(2.0)); }
+
+double
+norm_pdf(double x)
+{ return std::exp(-0.5 * x * x) / std::sqrt(2 * M_PI); }
+
+shared_ptr<const tdma::IVSurfaceEngine::Smile>
+fit_smile(int date, const std::map<double, std::pair<double, double>>& strikes,
+          double underlying_price)
+{
+    auto smile = std::make_shared<tdma::IVSurfaceEngine::Smile>();
+    smile->date = date;
+    for( auto& s : strikes ){
+        double c = s.second.first, p = s.second.second, v;
+        if( std::isnan(c) )
+            v = p;
+        else if( std::isnan(p) )
+            v = c;
+        else if( std::isnan(underlying_price) )
+            v = (c + p) / 2;
+        else
+            v = (s.first < underlying_price) ? p : c;
+        if( std::isnan(v) )
+            continue;
+        smile->strikes.push_back(s.first);
+        smile->vols.push_back(v);
+    }
+
+    size_t n = smile->strikes.size();
+    if( !n )
+        return nullptr;
+
+    /* natural cubic spline */
+    const vector<double>& x = smile->strikes;
+    const vector<double>& y = smile->vols;
+    vector<double>& d2 = smile->d2;
+    d2.assign(n, 0);
+    if( n > 2 ){
+        vector<double> u(n, 0);
+        for( size_t i = 1; i < n - 1; ++i ){
+            double sig = (x[i] - x[i-1]) / (x[i+1] - x[i-1]);
+            double p = sig * d2[i-1] + 2;
+            d2[i] = (sig - 1) / p;
+            u[i] = (y[i+1] - y[i]) / (x[i+1] - x[i])
+                 - (y[i] - y[i-1]) / (x[i] - x[i-1]);
+            u[i] = (6 * u[i] / (x[i+1] - x[i-1]) - sig * u[i-1]) / p;
+        }
+        d2[n-1] = 0;
+        for( size_t k = n - 1; k-- > 0; )
+            d2[k] = d2[k] * d2[k+1] + u[k];
+    }
+    return smile;
+}
+
+} /* namespace */
+
+
+namespace tdma{
+
+const milliseconds IVSurfaceEngine::DEF_REFIT_INTERVAL(
+    STREAMING_IV_SURFACE_DEF_REFIT_INTERVAL
+    );
+
+
+double
+IVSurfaceEngine::Smile::vol(double strike) const
+{
+    size_t n = strikes.size();
+    if( n == 1 || strike <= strikes.front() )
+        return vols.front();
+    if( strike >= strikes.back() )
+        return vols.back();
+
+    size_t hi = std::upper_bound(strikes.begin(), strikes.end(), strike)
+                - strikes.begin();
+    size_t lo = hi - 1;
+    double h = strikes[hi] - strikes[lo];
+    double a = (strikes[hi] - strike) / h;
+    double b = (strike - strikes[lo]) / h;
+    double v = a * vols[lo] + b * vols[hi]
+             + ((a*a*a - a) * d2[lo] + (b*b*b - b) * d2[hi]) * h * h / 6;
+    return std::max(v, MIN_VOL);
+}
+
+
+double
+IVSurfaceEngine::Surface::vol(double strike, double days, double now) const
+{
+    double t_prev = 0, v_prev = NaN;
+    for( auto& smile : smiles ){
+        double t = smile->date + EXPIRATION_DAY_FRAC - now;
+        if( t <= 0 )
+            continue;
+        double v = smile->vol(strike);
+        if( days <= t ){
+            if( std::isnan(v_prev) )
+                return v;
+            /* linear in total variance */
+            double w_prev = v_prev * v_prev * t_prev;
+            double w = w_prev + (v * v * t - w_prev)
+                                * (days - t_prev) / (t - t_prev);
+            return std::sqrt(w / days);
+        }
+        t_prev = t;
+        v_prev = v;
+    }
+    if( std::isnan(v_prev) )
+        TDMA_API_THROW(ValueException, "no unexpired expirations");
+    return v_prev;
+}
+
+
+IVSurfaceEngine::IVSurfaceEngine()
+    :
+        _refit_interval(DEF_REFIT_INTERVAL),
+        _surfaces( std::make_shared<surfaces_ty>() ),
+        _enabled(false),
+        _timer_guard( std::make_shared<TimerGuard>() ),
+        _timer_pending(false)
+    {
+        _timer_guard->engine = this;
+    }
+
+
+IVSurfaceEngine::~IVSurfaceEngine()
+{
+    /* waits out a timer task that's running */
+    std::lock_guard<std::mutex> _(_timer_guard->mtx);
+    _timer_guard->engine = nullptr;
+}
+
+
+void
+IVSurfaceEngine::set_refit_interval(milliseconds interval)
+{
+    if( interval.count() < 0 )
+        TDMA_API_THROW(ValueException, "refit interval < 0");
+    std::lock_guard<std::mutex> _(_mtx);
+    _refit_interval = interval;
+}
+
+
+milliseconds
+IVSurfaceEngine::get_refit_interval() const
+{
+    std::lock_guard<std::mutex> _(_mtx);
+    return _refit_interval;
+}
+
+
+void
+IVSurfaceEngine::set_enabled(bool enabled)
+{
+    std::lock_guard<std::mutex> _(_mtx);
+    if( !enabled ){
+        /* stale vols are worse than none when re-enabled */
+        _dirty.clear();
+        _contracts.clear();
+        _underlyings.clear();
+        std::atomic_store( &_surfaces,
+            std::shared_ptr<const surfaces_ty>(std::make_shared<surfaces_ty>()) );
+    }
+    _enabled.store(enabled, std::memory_order_relaxed);
+}
+
+
+IVSurfaceEngine::Contract*
+IVSurfaceEngine::_add_contract( const string& symbol,
+                                const string& underlying,
+                                int date,
+                                double strike,
+                                bool call )
+{
+    auto u = _underlyings.find(underlying);
+    if( u == _underlyings.end() ){
+        u = _underlyings.emplace(underlying, Underlying()).first;
+        u->second.symbol = underlying;
+        u->second.price = NaN;
+        u->second.rate = 0;
+        u->second.changed = false;
+    }
+
+    auto e = u->second.expiries.find(date);
+    if( e == u->second.expiries.end() ){
+        e = u->second.expiries.emplace(date, Expiry()).first;
+        e->second.date = date;
+        e->second.underlying = &u->second;
+        e->second.dirty = false;
+    }
+
+    Contract& c = _contracts[symbol];
+    c = Contract{&e->second, strike, call};
+    return &c;
+}
+
+
+void
+IVSurfaceEngine::_set_vol(Contract& contract, double vol)
+{
+    auto s = contract.expiry->strikes.find(contract.strike);
+    if( s == contract.expiry->strikes.end() ){
+        s = contract.expiry->strikes.emplace(
+            contract.strike, std::make_pair(NaN, NaN) ).first;
+    }
+    double& v = contract.call ? s->second.first : s->second.second;
+    /* nan != nan */
+    if( v == vol || (std::isnan(v) && std::isnan(vol)) )
+        return;
+    v = vol;
+    if( !contract.expiry->dirty ){
+        contract.expiry->dirty = true;
+        _dirty.push_back(contract.expiry);
+    }
+}
+
+
+void
+IVSurfaceEngine::_refit(bool force)
+{
+    auto now = steady_clock::now();
+    vector<Underlying*> changed;
+
+    for( size_t i = 0; i < _dirty.size(); ){
+        Expiry *e = _dirty[i];
+        if( !force && now - e->last_fit < _refit_interval ){
+            ++i;
+            continue;
+        }
+        e->smile = fit_smile(e->date, e->strikes, e->underlying->price);
+        e->last_fit = now;
+        e->dirty = false;
+        if( !e->underlying->changed ){
+            e->underlying->changed = true;
+            changed.push_back(e->underlying);
+        }
+        _dirty[i] = _dirty.back();
+        _dirty.pop_back();
+    }
+
+    _schedule_refit();
+
+    if( changed.empty() )
+        return;
+
+    auto surfaces = std::make_shared<surfaces_ty>( *std::atomic_load(&_surfaces) );
+    for( Underlying *u : changed ){
+        auto surface = std::make_shared<Surface>();
+        for( auto& e : u->expiries ){
+            if( e.second.smile )
+                surface->smiles.push_back(e.second.smile);
+        }
+        surface->underlying_price = u->price;
+        surface->rate = u->rate;
+        (*surfaces)[u->symbol] = surface;
+        u->changed = false;
+    }
+    std::atomic_store( &_surfaces,
+                       shared_ptr<const surfaces_ty>(std::move(surfaces)) );
+}
+
+
+void
+IVSurfaceEngine::seed(const json& chain)
+{
+    string underlying;
+    try{
+        underlying = util::toupper( chain.at("symbol").get<string>() );
+    }catch( json::exception& e ){
+        TDMA_API_THROW( ValueException,
+                        "invalid option chain: " + string(e.what()) );
+    }
+
+    std::lock_guard<std::mutex> _(_mtx);
+
+    try{
+        for( const char* m : {"callExpDateMap", "putExpDateMap"} ){
+            auto em = chain.find(m);
+            if( em == chain.end() )
+                continue;
+            for( auto exp = em->begin(); exp != em->end(); ++exp ){
+                /* "YYYY-MM-DD:DTE" */
+                int y, mo, d;
+                if( sscanf(exp.key().c_str(), "%d-%d-%d", &y, &mo, &d) != 3 )
+                    TDMA_API_THROW( ValueException,
+                                    "invalid expiration: " + exp.key() );
+                int date = days_from_civil(y, mo, d);
+                for( auto& strike : *exp ){
+                    for( auto& o : strike ){
+                        Contract *c = _add_contract(
+                            o.at("symbol"), underlying, date,
+                            o.at("strikePrice"), o.at("putCall") == "CALL"
+                            );
+                        double vol;
+                        if( get_field(o, "volatility", vol) )
+                            _set_vol(*c, to_decimal_vol(vol));
+                    }
+                }
+            }
+        }
+
+        auto u = _underlyings.find(underlying);
+        if( u == _underlyings.end() )
+            TDMA_API_THROW(ValueException, "no options in chain");
+        get_field(chain, "underlyingPrice", u->second.price);
+        if( get_field(chain, "interestRate", u->second.rate) )
+            u->second.rate /= 100;
+        /* refit it all, the price is used to pick the OTM side */
+        for( auto& e : u->second.expiries ){
+            if( !e.second.dirty ){
+                e.second.dirty = true;
+                _dirty.push_back(&e.second);
+            }
+        }
+    }catch( json::exception& e ){
+        TDMA_API_THROW( ValueException,
+                        "invalid option chain: " + string(e.what()) );
+    }
+
+    _enabled.store(true, std::memory_order_relaxed);
+    _refit(true);
+}
+
+
+void
+IVSurfaceEngine::_schedule_refit()
+{
+    if( _dirty.empty() || _timer_pending )
+        return;
+
+    auto due = _dirty.front()->last_fit;
+    for( Expiry *e : _dirty )
+        due = std::min(due, e->last_fit);
+    due += _refit_interval;
+
+    auto delay = std::chrono::duration_cast<milliseconds>(
+        due - steady_clock::now()
+        );
+    std::shared_ptr<TimerGuard> guard = _timer_guard;
+    Executor::instance().post_after(
+        std::max(delay, milliseconds(0)),
+        [guard](){
+            std::lock_guard<std::mutex> _(guard->mtx);
+            IVSurfaceEngine *engine = guard->engine;
+            if( !engine )
+                return;
+            std::lock_guard<std::mutex> lock(engine->_mtx);
+            engine->_timer_pending = false;
+            engine->_refit(false);
+        });
+    _timer_pending = true;
+}
+
+
+void
+IVSurfaceEngine::refit()
+{
+    std::lock_guard<std::mutex> _(_mtx);
+    _refit(true);
+}
+
+
+void
+IVSurfaceEngine::update(StreamerServiceType service, const json& content)
+{
+    if( service != StreamerServiceType::OPTION || !is_enabled() )
+        return;
+
+    std::lock_guard<std::mutex> _(_mtx);
+
+    for( auto& item : content ){
+        auto k = item.find("key");
+        if( k == item.end() || !k->is_string() )
+            continue;
+
+        Contract *c;
+        auto ci = _contracts.find( k->get_ref<const string&>() );
+        if( ci != _contracts.end() ){
+            c = &ci->second;
+        }else{
+            /* need the first (full) update to place it */
+            string underlying, type;
+            int y, m, d;
+            double strike;
+            if( !get_field(item, F_UNDERLYING, underlying)
+                || !get_field(item, F_EXP_YEAR, y)
+                || !get_field(item, F_EXP_MONTH, m)
+                || !get_field(item, F_EXP_DAY, d)
+                || !get_field(item, F_STRIKE, strike)
+                || !get_field(item, F_CONTRACT_TYPE, type) )
+            {
+                continue;
+            }
+            c = _add_contract( *k, util::toupper(underlying),
+                               days_from_civil(y, m, d), strike,
+                               type == "C" );
+        }
+
+        double v;
+        if( get_field(item, F_UNDERLYING_PRICE, v) )
+            c->expiry->underlying->price = v;
+        if( get_field(item, F_VOLATILITY, v) )
+            _set_vol(*c, to_decimal_vol(v));
+    }
+
+    _refit(false);
+}
+
+
+shared_ptr<const IVSurfaceEngine::Surface>
+IVSurfaceEngine::_get_surface(const string& underlying) const
+{
+    auto surfaces = std::atomic_load(&_surfaces);
+    auto s = surfaces->find( util::toupper(underlying) );
+    if( s == surfaces->end() || s->second->smiles.empty() )
+        TDMA_API_THROW(ValueException, "no surface for " + underlying);
+    return s->second;
+}
+
+
+double
+IVSurfaceEngine::get_vol( const string& underlying,
+                          double strike,
+                          double days_to_expiration ) const
+{
+    if( !(strike > 0) )
+        TDMA_API_THROW(ValueException, "strike <= 0");
+    if( !(days_to_expiration > 0) )
+        TDMA_API_THROW(ValueException, "days to expiration <= 0");
+
+    return _get_surface(underlying)->vol(strike, days_to_expiration,
+                                         now_in_days()) * 100;
+}
+
+
+IVSurfaceGreeks
+IVSurfaceEngine::get_greeks( const string& underlying,
+                             double strike,
+                             double days_to_expiration,
+                             bool call ) const
+{
+    if( !(strike > 0) )
+        TDMA_API_THROW(ValueException, "strike <= 0");
+    if( !(days_to_expiration > 0) )
+        TDMA_API_THROW(ValueException, "days to expiration <= 0");
+
+    auto surface = _get_surface(underlying);
+    double S = surface->underlying_price;
+    if( !(S > 0) )
+        TDMA_API_THROW(ValueException, "no underlying price for " + underlying);
+
+    double vol = surface->vol(strike, days_to_expiration, now_in_days());
+    double r = surface->rate;
+    double T = days_to_expiration / 365;
+    double sqrtT = std::sqrt(T);
+    double d1 = (std::log(S / strike) + (r + vol * vol / 2) * T)
+                / (vol * sqrtT);
+    double d2 = d1 - vol * sqrtT;
+    double disc = strike * std::exp(-r * T);
+    double theta = -S * norm_pdf(d1) * vol / (2 * sqrtT);
+    theta += call ? -r * disc * norm_cdf(d2) : r * disc * norm_cdf(-d2);
+
+    IVSurfaceGreeks g;
+    g.volatility = vol * 100;
+    g.delta = call ? norm_cdf(d1) : norm_cdf(d1) - 1;
+    g.gamma = norm_pdf(d1) / (S * vol * sqrtT);
+    g.theta = theta / 365; // per day
+    g.vega = S * norm_pdf(d1) * sqrtT / 100; // per vol point
+    return g;
+}
+
+} /* tdma */
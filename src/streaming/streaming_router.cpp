@@ -0,0 +1,273 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include <algorithm>
+
+#include "../../include/_streaming_router.h"
+
+using std::string;
+using std::vector;
+using std::set;
+using std::pair;
+
+namespace {
+
+const size_t NSERVICES = static_cast<size_t>(
+    tdma::enum_bounds<tdma::StreamerServiceType>::high ) + 1;
+
+const int DATA = static_cast<int>(tdma::StreamingCallbackType::data);
+
+} /* namespace */
+
+
+namespace tdma{
+
+StreamingRouter::StreamingRouter()
+    :
+        _routes(),
+        _next_id(0),
+        _table(),
+        _empty(true),
+        _mtx()
+    {
+    }
+
+
+int
+StreamingRouter::_add( StreamerServiceType service,
+                       const set<string>& symbols,
+                       Handler handler )
+{
+    if( service == StreamerServiceType::NONE )
+        TDMA_API_THROW(ValueException, "invalid service");
+
+    Route r{service, {}, std::move(handler)};
+    for( auto& s : symbols ){
+        if( s.empty() )
+            TDMA_API_THROW(ValueException, "empty symbol");
+        r.symbols.push_back( util::toupper(s) );
+    }
+
+    std::lock_guard<std::mutex> _(_mtx);
+    int id = _next_id++;
+    _routes.emplace(id, std::move(r));
+    _rebuild();
+    return id;
+}
+
+
+int
+StreamingRouter::add_route( StreamerServiceType service,
+                            const set<string>& symbols,
+                            streaming_cb_ty callback )
+{
+    if( !callback )
+        TDMA_API_THROW(ValueException, "null callback");
+    return _add(service, symbols, Handler{callback, nullptr});
+}
+
+
+int
+StreamingRouter::add_route( StreamerServiceType service,
+                            const set<string>& symbols,
+                            streaming_json_cb_ty callback )
+{
+    if( !callback )
+        TDMA_API_THROW(ValueException, "empty callback");
+    return _add(service, symbols, Handler{nullptr, std::move(callback)});
+}
+
+
+void
+StreamingRouter::remove_route(int id)
+{
+    std::lock_guard<std::mutex> _(_mtx);
+
+    if( !_routes.erase(id) )
+        TDMA_API_THROW(ValueException, "invalid route id");
+    _rebuild();
+}
+
+
+void
+StreamingRouter::clear()
+{
+    std::lock_guard<std::mutex> _(_mtx);
+
+    _routes.clear();
+    _rebuild();
+}
+
+
+void
+StreamingRouter::_rebuild()
+{
+    if( _routes.empty() ){
+        std::atomic_store( &_table, std::shared_ptr<const Table>() );
+        _empty.store(true);
+        return;
+    }
+
+    auto t = std::make_shared<Table>();
+    t->service_handlers.resize(NSERVICES);
+    t->symbol_offsets.resize(NSERVICES);
+    t->symbol_slots.resize(NSERVICES);
+
+    /* (symbol id, slot) per service, slots in route order */
+    vector<vector<pair<int, int>>> entries(NSERVICES);
+    for( auto& r : _routes ){
+        const Route& route = r.second;
+        size_t s = static_cast<size_t>(route.service);
+        if( route.symbols.empty() ){
+            t->service_handlers[s].push_back(route.handler);
+            continue;
+        }
+        int slot = static_cast<int>(t->slot_handlers.size());
+        t->slot_handlers.push_back(route.handler);
+        for( auto& sym : route.symbols ){
+            auto i = t->symbol_ids.emplace(
+                sym, static_cast<int>(t->symbol_ids.size()) );
+            entries[s].emplace_back(i.first->second, slot);
+        }
+    }
+
+    size_t nsymbols = t->symbol_ids.size();
+    for( size_t s = 0; s < NSERVICES; ++s ){
+        auto& e = entries[s];
+        if( e.empty() )
+            continue;
+        std::stable_sort( e.begin(), e.end(),
+                          [](const pair<int, int>& l, const pair<int, int>& r){
+                              return l.first < r.first;
+                          });
+        auto& offsets = t->symbol_offsets[s];
+        auto& slots = t->symbol_slots[s];
+        offsets.assign(nsymbols + 1, 0);
+        for( auto& p : e )
+            ++offsets[p.first + 1];
+        for( size_t i = 1; i <= nsymbols; ++i )
+            offsets[i] += offsets[i - 1];
+        for( auto& p : e )
+            slots.push_back(p.second);
+    }
+
+    std::atomic_store( &_table, std::shared_ptr<const Table>(t) );
+    _empty.store(false);
+}
+
+
+bool
+StreamingRouter::route( StreamerServiceType service,
+                        unsigned long long timestamp,
+                        const json& content,
+                        json& unrouted ) const
+{
+    if( _empty.load(std::memory_order_relaxed) )
+        return false;
+
+    auto t = std::atomic_load(&_table);
+    if( !t )
+        return false;
+
+    size_t s = static_cast<size_t>(service);
+    if( s >= NSERVICES )
+        return false;
+
+    const auto& all = t->service_handlers[s];
+    const auto& offsets = t->symbol_offsets[s];
+    const auto& slots = t->symbol_slots[s];
+
+    /* (slot, item index) */
+    vector<pair<int, size_t>> hits;
+    vector<size_t> misses;
+    if( !offsets.empty() && content.is_array() ){
+        for( size_t i = 0; i < content.size(); ++i ){
+            const json& item = content[i];
+            auto k = item.find("key");
+            if( k != item.end() && k->is_string() ){
+                auto id = t->symbol_ids.find( k->get_ref<const string&>() );
+                if( id != t->symbol_ids.end() ){
+                    unsigned int beg = offsets[id->second];
+                    unsigned int end = offsets[id->second + 1];
+                    for( unsigned int o = beg; o < end; ++o )
+                        hits.emplace_back(slots[o], i);
+                    if( beg != end )
+                        continue;
+                }
+            }
+            misses.push_back(i);
+        }
+    }
+
+    if( all.empty() && hits.empty() )
+        return false;
+
+    string dumped;
+    for( auto& h : all ){
+        if( h.json_callback )
+            h.json_callback(StreamingCallbackType::data, service, timestamp,
+                            content);
+        else{
+            if( dumped.empty() )
+                dumped = content.dump();
+            h.callback(DATA, static_cast<int>(service), timestamp,
+                       dumped.c_str());
+        }
+    }
+
+    /* one call per slot w/ its items, in the order received */
+    std::stable_sort( hits.begin(), hits.end(),
+                      [](const pair<int, size_t>& l,
+                         const pair<int, size_t>& r){
+                          return l.first < r.first;
+                      });
+    for( auto b = hits.begin(); b != hits.end(); ){
+        auto e = std::find_if( b, hits.end(),
+                               [&](const pair<int, size_t>& p){
+                                   return p.first != b->first;
+                               });
+        const Handler& h = t->slot_handlers[b->first];
+        if( h.json_callback ){
+            json items = json::array();
+            for( auto i = b; i != e; ++i )
+                items.push_back( content[i->second] );
+            h.json_callback(StreamingCallbackType::data, service, timestamp,
+                            items);
+        }else{
+            string items = "[";
+            for( auto i = b; i != e; ++i ){
+                if( i != b )
+                    items.push_back(',');
+                items += content[i->second].dump();
+            }
+            items.push_back(']');
+            h.callback(DATA, static_cast<int>(service), timestamp,
+                       items.c_str());
+        }
+        b = e;
+    }
+
+    /* a service route takes everything */
+    if( all.empty() && !misses.empty() ){
+        unrouted = json::array();
+        for( size_t i : misses )
+            unrouted.push_back( content[i] );
+    }
+    return true;
+}
+
+} /* tdma */
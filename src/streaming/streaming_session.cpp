@@ -25,9 +25,19 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 #include <condition_variable>
 
 #include "../../include/_streaming.h"
+#include "../../include/_streaming_shm.h"
+#include "../../include/_streaming_filter.h"
+#include "../../include/_streaming_router.h"
+#include "../../include/_streaming_spreads.h"
+#include "../../include/_streaming_iv_surface.h"
+#include "../../include/_execute_analytics.h"
+#include "../../include/_paper_broker.h"
 #include "../../include/util.h"
 #include "../../include/websocket_connect.h"
 #include "../../include/threadsafe_hashmap.h"
+#include "../../include/_json_parse.h"
+#include "../../include/_probes.h"
+#include "../../include/_executor.h"
 
 using std::string;
 using std::vector;
@@ -252,6 +262,7 @@ class StreamingSessionImpl{
     string _account_id;
     std::unique_ptr<conn::WebSocketClient> _client;
     streaming_cb_ty _callback;
+    streaming_json_cb_ty _json_callback; // (direct linkage) replaces _callback
     milliseconds _connect_timeout;
     milliseconds _listening_timeout;
     milliseconds _subscribe_timeout;
@@ -260,9 +271,17 @@ class StreamingSessionImpl{
     int _next_request_id;
     bool _logged_in;
     bool _listening;
+    bool _external_loop;
+    std::chrono::steady_clock::time_point _last_message; // (external loop)
     QOSType _qos;
     unsigned long long _last_heartbeat;
     ThreadSafeHashMap<int, PendingResponse> _responses_pending;
+    std::unique_ptr<StreamingPublisherImpl> _publisher;
+    mutable mutex _publisher_mtx;
+    StreamingFilterSet _filters;
+    StreamingRouter _router;
+    StreamingSpreadEngine _spreads;
+    IVSurfaceEngine _iv_surface;
 
     class ListenerThreadTarget{
         static const string RESPONSE_TO_REQUEST;
@@ -281,6 +300,9 @@ class StreamingSessionImpl{
         void
         exec();
 
+        void
+        handle(const vector<string>& results);
+
         void
         parse(const string& responses);
 
@@ -294,7 +316,7 @@ class StreamingSessionImpl{
         parse_response_snapshot(const json& response);
 
         void
-        parse_response_data(const json& response);
+        parse_response_data(json& response);
 
     public:
         ListenerThreadTarget( StreamingSessionImpl *ss )
@@ -302,6 +324,23 @@ class StreamingSessionImpl{
 
         void
         operator()();
+
+        /* listening_start callback */
+        void
+        start();
+
+        /* run 'f', the listening_stop/timeout/error callback if it ends
+           listening (returns or throws w/ _listening false) */
+        void
+        guarded(const std::function<void()>& f);
+
+        /* (external loop) what exec() does once, w/o blocking past 'wait' */
+        void
+        poll(milliseconds wait);
+
+        /* (external loop) handle what's been received, stop listening */
+        void
+        stop();
     };
 
     bool
@@ -323,16 +362,70 @@ class StreamingSessionImpl{
     _send_requests( const vector<StreamingSubscriptionImpl>& subscriptions,
                     PendingResponse::response_cb_ty callback = nullptr );
 
+    /* false if _subscribe_timeout expires first */
+    bool
+    _wait_for_responses( const std::shared_ptr<PendingResponseBundle>& bndl );
+
     void
     _exec_callback( StreamingCallbackType cb_type,
                     StreamerServiceType ss_type,
                     unsigned long long ts,
                     const json& j )
     {
-        if( _callback ){
+        /* publish first, other processes shouldn't wait on our callback */
+        _publish(cb_type, ss_type, ts, j);
+        _dispatch(cb_type, ss_type, ts, j);
+    }
+
+    void
+    _publish( StreamingCallbackType cb_type,
+              StreamerServiceType ss_type,
+              unsigned long long ts,
+              const json& j )
+    {
+        std::lock_guard<mutex> _(_publisher_mtx);
+        if( _publisher )
+            _publisher->publish(cb_type, ss_type, ts, j);
+    }
+
+    /* routes, then the catch-all */
+    void
+    _dispatch( StreamingCallbackType cb_type,
+               StreamerServiceType ss_type,
+               unsigned long long ts,
+               const json& j )
+    {
+        if( cb_type == StreamingCallbackType::data ){
+            json unrouted;
+            if( _router.route(ss_type, ts, j, unrouted) ){
+                if( !unrouted.empty() )
+                    _exec_catch_all(cb_type, ss_type, ts, unrouted);
+                return;
+            }
+        }
+        _exec_catch_all(cb_type, ss_type, ts, j);
+    }
+
+    /* the callback passed on creation gets what no route takes */
+    void
+    _exec_catch_all( StreamingCallbackType cb_type,
+                     StreamerServiceType ss_type,
+                     unsigned long long ts,
+                     const json& j )
+    {
+        if( !_json_callback && !_callback )
+            return;
+
+        TDMA_PROBE2(callback_start, static_cast<int>(cb_type),
+                    static_cast<int>(ss_type));
+        if( _json_callback )
+            _json_callback(cb_type, ss_type, ts, j);
+        else{
             _callback( static_cast<int>(cb_type), static_cast<int>(ss_type),
                        ts, j.dump().c_str() );
         }
+        TDMA_PROBE2(callback_end, static_cast<int>(cb_type),
+                    static_cast<int>(ss_type));
     }
 
 public:
@@ -350,6 +443,7 @@ public:
             _account_id( streamer_info.desired_acct_id ),
             _client(nullptr),
             _callback( callback ),
+            _json_callback(),
             _connect_timeout( max(connect_timeout,
                                   StreamingSession::MIN_TIMEOUT) ),
             _listening_timeout( max(listening_timeout,
@@ -361,9 +455,17 @@ public:
             _next_request_id(0),
             _logged_in(false),
             _listening(false),
+            _external_loop(false),
+            _last_message(),
             _qos( QOSType::fast ),
             _last_heartbeat(0),
-            _responses_pending()
+            _responses_pending(),
+            _publisher(nullptr),
+            _publisher_mtx(),
+            _filters(),
+            _router(),
+            _spreads(),
+            _iv_surface()
         {
             D("construct", this);
             D("primary account: " + streamer_info.primary_acct_id, this);
@@ -411,6 +513,81 @@ public:
     string
     get_streamer_subscription_key() const
     { return _streamer_info.streamer_subscription_key; }
+
+    void
+    start_publishing(const string& name, size_t nslots, size_t slot_size)
+    {
+        std::lock_guard<mutex> _(_publisher_mtx);
+        /* release the old segment first in case 'name' is being reused */
+        _publisher.reset();
+        _publisher.reset( new StreamingPublisherImpl(name, nslots, slot_size) );
+    }
+
+    void
+    stop_publishing()
+    {
+        std::lock_guard<mutex> _(_publisher_mtx);
+        _publisher.reset();
+    }
+
+    bool
+    is_publishing() const
+    {
+        std::lock_guard<mutex> _(_publisher_mtx);
+        return static_cast<bool>(_publisher);
+    }
+
+    StreamingFilterSet&
+    filters()
+    { return _filters; }
+
+    StreamingRouter&
+    router()
+    { return _router; }
+
+    StreamingSpreadEngine&
+    spreads()
+    { return _spreads; }
+
+    IVSurfaceEngine&
+    iv_surface()
+    { return _iv_surface; }
+
+    void
+    set_external_loop(bool external_loop)
+    {
+        if( _client ){
+            TDMA_API_THROW( StreamingException,
+                            "can not change the loop mode of an active "
+                            "session" );
+        }
+        _external_loop = external_loop;
+    }
+
+    bool
+    is_external_loop() const
+    { return _external_loop; }
+
+    void
+    set_json_callback(streaming_json_cb_ty callback)
+    {
+        if( _client ){
+            TDMA_API_THROW( StreamingException,
+                            "can not change the callback of an active "
+                            "session" );
+        }
+        _json_callback = std::move(callback);
+    }
+
+    /* fd and poll events */
+    std::pair<int, int>
+    get_event_fd() const;
+
+    long long
+    get_next_timeout() const;
+
+    bool
+    process_events(milliseconds wait);
 };
 
 
@@ -422,18 +599,37 @@ const string StreamingSessionImpl::ListenerThreadTarget::RESPONSE_DATA("data");
 
 void
 StreamingSessionImpl::ListenerThreadTarget::operator()()
+{
+    start();
+    guarded( [this](){ exec(); } );
+}
+
+
+void
+StreamingSessionImpl::ListenerThreadTarget::start()
 {
     _ss->_listening = true;
+    _ss->_last_message = std::chrono::steady_clock::now();
 
     D("call back (listening_start)", _ss);
     _ss->_exec_callback( StreamingCallbackType::listening_start,
                         StreamerServiceType::NONE, 0, json() );
+}
+
 
+void
+StreamingSessionImpl::ListenerThreadTarget::guarded(
+    const std::function<void()>& f
+    )
+{
     StreamingCallbackType cb_t = StreamingCallbackType::listening_stop;
     json cb_j;
 
     try{
-        exec();
+        f();
+        /* still listening, or stopped (w/ callback) from inside 'f' */
+        if( _ss->_listening || !_ss->_client )
+            return;
 
     }catch( Timeout& e ){
         /*
@@ -460,10 +656,13 @@ StreamingSessionImpl::ListenerThreadTarget::operator()()
          */
         D(string("listening thread EXCEPTION: ") + e.what(), _ss);
         _ss->_reset();
+        _ss->_listening = false;
         throw;
     }
 
     _ss->_listening = false;
+    flight::record( flight::EventType::listening_stop, static_cast<int>(cb_t),
+                    0, to_string(cb_t).c_str() );
 
     D("call back (" + to_string(cb_t) + ")", _ss);
     /* callback should be last thing we do */
@@ -489,53 +688,102 @@ StreamingSessionImpl::ListenerThreadTarget::exec()
                         );
 
         if( results.empty() ) /* TIMED OUT */
-            throw Timeout("exec timeout", __LINE__, __FILE__);
-
-        /* each message can have mutliple results */
-        for(string& res : results){
-            if( res.empty() ){
-                /* empty message is the signal to stop listening */
-                D("stop-listening message", _ss);
-                _ss->_listening = false;
-                break;
-            }
-            /*
-             * parse handles the return message logic:
-             *
-             *      response to request: check against _responses_pending
-             *                           and callback to calling function on
-             *                           main thread which sends to stdout
-             *                           if necessary
-             *
-             *      notify: record heartbeat, if not heartbeat call back
-             *
-             *      data: call back to client w/ json object returned
-             *
-             *      snapshot: NOT IMPLEMENTED
-             */
-            try{
-                parse(res);
-            }catch( json::exception& e ){
-                cerr << "Error Parsing Json: " << endl
-                     << '\t' << e.what() << endl
-                     << '\t' << res << endl;
-            }
-        }
+            TDMA_API_THROW(Timeout, "exec timeout");
+
+        handle(results);
     }
     D("end listening loop", _ss);
 }
 
 
+void
+StreamingSessionImpl::ListenerThreadTarget::handle(
+    const vector<string>& results
+    )
+{
+    /* each message can have mutliple results */
+    for(const string& res : results){
+        if( !_ss->_listening )
+            break;
+
+        if( res.empty() ){
+            /* empty message is the signal to stop listening */
+            D("stop-listening message", _ss);
+            _ss->_listening = false;
+            break;
+        }
+        /*
+         * parse handles the return message logic:
+         *
+         *      response to request: check against _responses_pending
+         *                           and callback to calling function on
+         *                           main thread which sends to stdout
+         *                           if necessary
+         *
+         *      notify: record heartbeat, if not heartbeat call back
+         *
+         *      data: call back to client w/ json object returned
+         *
+         *      snapshot: NOT IMPLEMENTED
+         */
+        try{
+            parse(res);
+        }catch( json::exception& e ){
+            cerr << "Error Parsing Json: " << endl
+                 << '\t' << e.what() << endl
+                 << '\t' << res << endl;
+        }
+    }
+}
+
+
+void
+StreamingSessionImpl::ListenerThreadTarget::poll(milliseconds wait)
+{
+    using namespace std::chrono;
+
+    _ss->_client->process_events(wait);
+
+    auto results = _ss->_client->recv_all();
+    auto now = steady_clock::now();
+    if( !results.empty() )
+        _ss->_last_message = now;
+    else if( now - _ss->_last_message >= _ss->_listening_timeout )
+        TDMA_API_THROW(Timeout, "exec timeout");
+
+    handle(results);
+
+    if( _ss->_listening && !_ss->_client->is_connected() ){
+        TDMA_API_THROW( StreamingException,
+                        "client connection ended unexpectedly" );
+    }
+}
+
+
+void
+StreamingSessionImpl::ListenerThreadTarget::stop()
+{
+    guarded( [this](){
+        handle( _ss->_client->recv_all() );
+        _ss->_listening = false;
+    } );
+}
+
+
 void
 StreamingSessionImpl::ListenerThreadTarget::parse(const string& responses)
 {
-    auto resp = json::parse(responses);
+    TDMA_PROBE1(frame_parse_start, responses.size());
+    auto resp = parse_json(responses);
     auto r = resp.begin();
     if( r == resp.end() )
         TDMA_API_THROW(StreamingException,"invalid response JSON");
 
     string resp_ty = r.key();
-    auto resp_array = r.value();
+    auto& resp_array = r.value();
+    TDMA_PROBE2(frame_parsed, resp_ty.c_str(), resp_array.size());
+    flight::record( flight::EventType::frame_parsed, resp_array.size(), 0,
+                    resp_ty.c_str() );
 
     if(resp_ty == RESPONSE_TO_REQUEST){
         for(auto& resp : resp_array)
@@ -582,6 +830,11 @@ StreamingSessionImpl::ListenerThreadTarget::parse_response_to_request(
     }
 
     auto content = response["content"];
+    int code = content.is_object() ? content.value("code", -1) : -1;
+    TDMA_PROBE4(subscription_response, pr.request_id, service.c_str(),
+                command.c_str(), code);
+    flight::record( flight::EventType::subscription_response, pr.request_id,
+                    code, service.c_str(), command.c_str() );
     if( pr.callback ){
         pr.callback( stoi(req_id), service, command, response["timestamp"],
                      content["code"], content["msg"] );
@@ -627,14 +880,30 @@ StreamingSessionImpl::ListenerThreadTarget::parse_response_snapshot(
 
 void
 StreamingSessionImpl::ListenerThreadTarget::parse_response_data(
-    const json& response
+    json& response
     )
 {
     try{
         string service = response.at("service");
-        _ss->_exec_callback( StreamingCallbackType::data,
-                             streamer_service_from_str(service),
-                             response.at("timestamp"), response.at("content") );
+        StreamerServiceType ss_type = streamer_service_from_str(service);
+        json& content = response.at("content");
+        unsigned long long ts = response.at("timestamp");
+        /*
+         * spreads/surface/analytics/paper broker see every update,
+         * filtered or not
+         */
+        _ss->_spreads.update(ss_type, ts, content);
+        _ss->_iv_surface.update(ss_type, content);
+        ExecutionAnalytics::instance().update(ss_type, content);
+        PaperBroker::instance().update(ss_type, ts, content);
+        /*
+         * subscribers in other processes get it unfiltered, this session's
+         * filters only apply to its own callbacks
+         */
+        _ss->_publish( StreamingCallbackType::data, ss_type, ts, content );
+        if( !_ss->_filters.apply(ss_type, content) )
+            return;
+        _ss->_dispatch( StreamingCallbackType::data, ss_type, ts, content );
     }catch(std::exception& e){
         TDMA_API_THROW( StreamingException,
                         "invalid 'data' response: " + string(e.what()) );
@@ -854,12 +1123,8 @@ StreamingSessionImpl::set_qos(const QOSType& qos)
     );
     _send_requests( {sub}, cb );
 
-    std::unique_lock<mutex> l(bndl->mtx);
-    if( !bndl->cond.wait_for(l, _subscribe_timeout,
-                             [&](){ return bndl->is_ready(); } ) )
-    {
+    if( !_wait_for_responses(bndl) )
         cerr<< "timed out trying to set QOS" << endl;
-    }
 
     if( bndl->successes[0] ){
         _qos = qos;
@@ -900,17 +1165,48 @@ StreamingSessionImpl::_send_requests(
     _client->send( msg );
 
     for( size_t i = 0; i < subscriptions.size(); ++i ){
+        string service = subscriptions[i].get_service_str();
+        string command = subscriptions[i].get_command_str();
+        TDMA_PROBE3(subscription_request, req_ids[i], service.c_str(),
+                    command.c_str());
+        flight::record( flight::EventType::subscription_request, req_ids[i], 0,
+                        service.c_str(), command.c_str() );
         _responses_pending.insert(
             req_ids[i],
-            PendingResponse( req_ids[i],
-                             subscriptions[i].get_service_str(),
-                             subscriptions[i].get_command_str(),
-                             callback )
+            PendingResponse( req_ids[i], service, command, callback )
             );
     }
 }
 
 
+bool
+StreamingSessionImpl::_wait_for_responses(
+    const std::shared_ptr<PendingResponseBundle>& bndl
+    )
+{
+    using namespace std::chrono;
+
+    if( !_external_loop ){
+        std::unique_lock<mutex> lock(bndl->mtx);
+        return bndl->cond.wait_for( lock, _subscribe_timeout,
+                                    [&](){ return bndl->is_ready(); } );
+    }
+
+    /* no listening thread to parse the responses; run the loop here */
+    auto t_end = steady_clock::now() + _subscribe_timeout;
+    for( ;; ){
+        {
+            std::lock_guard<mutex> _(bndl->mtx);
+            if( bndl->is_ready() )
+                return true;
+        }
+        auto t_left = duration_cast<milliseconds>(t_end - steady_clock::now());
+        if( t_left.count() <= 0 || !process_events(t_left) )
+            return false;
+    }
+}
+
+
 deque<bool>
 StreamingSessionImpl::add_subscriptions(
     const vector<StreamingSubscriptionImpl>& subscriptions
@@ -959,10 +1255,7 @@ StreamingSessionImpl::add_subscriptions(
 
     _send_requests(subscriptions, cb);
 
-    std::unique_lock<mutex> lock(bndl->mtx);
-    if( !bndl->cond.wait_for( lock, _subscribe_timeout,
-                              [&](){ return bndl->is_ready(); } ) )
-    {
+    if( !_wait_for_responses(bndl) ){
         /*
          * TODO - should we clear _pending_responses ??
          *                        signal bndl to ignore response/callback ??
@@ -1002,7 +1295,9 @@ StreamingSessionImpl::start(
     }
 
     D("_client->reset", this);
-    _client.reset( new conn::WebSocketClient(_streamer_info.url) );
+    _client.reset(
+        new conn::WebSocketClient(_streamer_info.url, _external_loop)
+        );
 
     D("_client->connect", this);
     _client->connect( _connect_timeout );
@@ -1018,7 +1313,10 @@ StreamingSessionImpl::start(
 
     /* only after connect AND login do we consider this an active session */
     active_accounts.insert(acct);
-    _start_listener_thread();
+    if( _external_loop )
+        ListenerThreadTarget(this).start();
+    else
+        _start_listener_thread();
     return add_subscriptions(subscriptions);
 }
 
@@ -1068,7 +1366,8 @@ StreamingSessionImpl::_start_listener_thread()
         _listener_thread.join();
 
     D("move new listener thread", this);
-    _listener_thread = std::move( std::thread(ListenerThreadTarget(this)) );
+    _listener_thread = Executor::instance().spawn_io( "tdma-listen",
+                                                      ListenerThreadTarget(this) );
 }
 
 
@@ -1076,6 +1375,11 @@ void
 StreamingSessionImpl::_stop_listener_thread()
 {
     D("stop listening thread", this);
+    if( _external_loop ){
+        if( _listening && _client )
+            ListenerThreadTarget(this).stop();
+        return;
+    }
     /*
      * force listeners thread out of a wait, but allow it to consume messages
      * up to *this* point first by setting _listening to false in loop
@@ -1089,6 +1393,76 @@ StreamingSessionImpl::_stop_listener_thread()
     D("join listener thread DONE", this);
 }
 
+
+std::pair<int, int>
+StreamingSessionImpl::get_event_fd() const
+{
+    if( !_external_loop )
+        TDMA_API_THROW(StreamingException, "session isn't in external loop mode");
+    if( !_client )
+        TDMA_API_THROW(StreamingException, "session isn't active");
+
+    return std::make_pair( _client->event_fd(), _client->poll_events() );
+}
+
+
+long long
+StreamingSessionImpl::get_next_timeout() const
+{
+    using namespace std::chrono;
+
+    if( !_external_loop )
+        TDMA_API_THROW(StreamingException, "session isn't in external loop mode");
+    if( !_client )
+        return -1;
+
+    long long t = _client->next_timeout();
+    if( _listening ){
+        /* the listening timeout is checked by process_events() */
+        auto us = duration_cast<microseconds>(
+            _last_message + _listening_timeout - steady_clock::now() ).count();
+        long long ms = us > 0 ? (us + 999) / 1000 : 0;
+        if( t < 0 || ms < t )
+            t = ms;
+    }
+    return t;
+}
+
+
+bool
+StreamingSessionImpl::process_events(milliseconds wait)
+{
+    if( !_external_loop )
+        TDMA_API_THROW(StreamingException, "session isn't in external loop mode");
+    if( !_client || !_listening )
+        return false;
+
+    long long t = get_next_timeout();
+    if( t >= 0 && t < wait.count() )
+        wait = milliseconds(t);
+
+    ListenerThreadTarget l(this);
+    l.guarded( [&](){ l.poll(wait); } );
+    return _listening;
+}
+
+
+void
+SetStreamingSocketBackendImpl(SocketBackendType backend)
+{
+    conn::WebSocketClient::set_use_io_uring(
+        backend == SocketBackendType::io_uring
+        );
+}
+
+
+SocketBackendType
+GetStreamingSocketBackendImpl()
+{
+    return conn::WebSocketClient::uses_io_uring() ? SocketBackendType::io_uring
+                                                  : SocketBackendType::epoll;
+}
+
 } /*tdma*/
 
 
@@ -1339,3 +1713,724 @@ StreamingSession_GetQOS_ABI( StreamingSession_C *psession,
     tie(*qos, err) = CallImplFromABI(allow_exceptions, meth, psession->obj);
     return err;
 }
+
+
+int
+StreamingSession_SetExternalLoop_ABI( StreamingSession_C *psession,
+                                      int external_loop,
+                                      int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    auto meth = +[](void *obj, int e){
+        reinterpret_cast<StreamingSessionImpl*>(obj)
+            ->set_external_loop( static_cast<bool>(e) );
+    };
+
+    return CallImplFromABI(allow_exceptions, meth, psession->obj, external_loop);
+}
+
+
+int
+StreamingSession_IsExternalLoop_ABI( StreamingSession_C *psession,
+                                     int *external_loop,
+                                     int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_PTR(external_loop, "external_loop", allow_exceptions);
+
+    auto meth = +[](void *obj){
+        return static_cast<int>(
+            reinterpret_cast<StreamingSessionImpl*>(obj)->is_external_loop()
+            );
+    };
+
+    tie(*external_loop, err) = CallImplFromABI(allow_exceptions, meth,
+                                               psession->obj);
+    return err;
+}
+
+
+int
+StreamingSession_GetEventFd_ABI( StreamingSession_C *psession,
+                                 int *fd,
+                                 int *events,
+                                 int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_PTR(fd, "fd", allow_exceptions);
+    CHECK_PTR(events, "events", allow_exceptions);
+
+    auto meth = +[](void *obj){
+        return reinterpret_cast<StreamingSessionImpl*>(obj)->get_event_fd();
+    };
+
+    std::pair<int, int> r;
+    tie(r, err) = CallImplFromABI(allow_exceptions, meth, psession->obj);
+    if( !err ){
+        *fd = r.first;
+        *events = r.second;
+    }
+    return err;
+}
+
+
+int
+StreamingSession_GetNextTimeout_ABI( StreamingSession_C *psession,
+                                     long long *msec,
+                                     int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_PTR(msec, "msec", allow_exceptions);
+
+    auto meth = +[](void *obj){
+        return reinterpret_cast<StreamingSessionImpl*>(obj)->get_next_timeout();
+    };
+
+    tie(*msec, err) = CallImplFromABI(allow_exceptions, meth, psession->obj);
+    return err;
+}
+
+
+int
+StreamingSession_ProcessEvents_ABI( StreamingSession_C *psession,
+                                    long long wait_msec,
+                                    int *is_listening,
+                                    int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_PTR(is_listening, "is_listening", allow_exceptions);
+
+    auto meth = +[](void *obj, long long w){
+        return static_cast<int>(
+            reinterpret_cast<StreamingSessionImpl*>(obj)
+                ->process_events( milliseconds(std::max(w, 0LL)) )
+            );
+    };
+
+    tie(*is_listening, err) = CallImplFromABI(allow_exceptions, meth,
+                                              psession->obj, wait_msec);
+    return err;
+}
+
+
+int
+SetStreamingSocketBackend_ABI(int backend, int allow_exceptions)
+{
+    CHECK_ENUM(SocketBackendType, backend, allow_exceptions);
+
+    return CallImplFromABI( allow_exceptions, SetStreamingSocketBackendImpl,
+                            static_cast<SocketBackendType>(backend) );
+}
+
+
+int
+GetStreamingSocketBackend_ABI(int *backend, int allow_exceptions)
+{
+    CHECK_PTR(backend, "backend", allow_exceptions);
+
+    SocketBackendType b;
+    int err;
+    tie(b, err) = CallImplFromABI( allow_exceptions,
+                                   GetStreamingSocketBackendImpl );
+    if( err )
+        return err;
+
+    *backend = static_cast<int>(b);
+    return 0;
+}
+
+
+int
+StreamingSession_StartPublishing_ABI( StreamingSession_C *psession,
+                                      const char* name,
+                                      size_t nslots,
+                                      size_t slot_size,
+                                      int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_PTR(name, "name", allow_exceptions);
+
+    auto meth = +[](void *obj, const char* n, size_t ns, size_t ss){
+        reinterpret_cast<StreamingSessionImpl*>(obj)
+            ->start_publishing(n, ns, ss);
+    };
+
+    return CallImplFromABI(allow_exceptions, meth, psession->obj, name,
+                           nslots, slot_size);
+}
+
+int
+StreamingSession_StopPublishing_ABI( StreamingSession_C *psession,
+                                     int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    auto meth = +[](void *obj){
+        reinterpret_cast<StreamingSessionImpl*>(obj)->stop_publishing();
+    };
+
+    return CallImplFromABI(allow_exceptions, meth, psession->obj);
+}
+
+int
+StreamingSession_IsPublishing_ABI( StreamingSession_C *psession,
+                                   int *is_publishing,
+                                   int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_PTR(is_publishing, "is_publishing", allow_exceptions);
+
+    auto meth = +[](void *obj){
+        return static_cast<int>(
+            reinterpret_cast<StreamingSessionImpl*>(obj)->is_publishing()
+            );
+    };
+
+    tie(*is_publishing, err) = CallImplFromABI(allow_exceptions, meth,
+                                               psession->obj);
+    return err;
+}
+
+
+int
+StreamingSession_SetFilterSymbols_ABI( StreamingSession_C *psession,
+                                       int service,
+                                       const char** symbols,
+                                       size_t nsymbols,
+                                       int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_ENUM(StreamerServiceType, service, allow_exceptions);
+    if( nsymbols )
+        CHECK_PTR(symbols, "symbols", allow_exceptions);
+
+    set<string> s;
+    for( size_t i = 0; i < nsymbols; ++i ){
+        CHECK_PTR(symbols[i], "symbol", allow_exceptions);
+        s.insert(symbols[i]);
+    }
+
+    auto meth = +[](void *obj, int service, const set<string>& s){
+        reinterpret_cast<StreamingSessionImpl*>(obj)->filters()
+            .set_symbols( static_cast<StreamerServiceType>(service), s );
+    };
+
+    return CallImplFromABI(allow_exceptions, meth, psession->obj, service, s);
+}
+
+int
+StreamingSession_AddFilterRule_ABI( StreamingSession_C *psession,
+                                    int service,
+                                    int field,
+                                    int rule_type,
+                                    double value,
+                                    int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_ENUM(StreamerServiceType, service, allow_exceptions);
+    CHECK_ENUM(StreamingFilterRuleType, rule_type, allow_exceptions);
+
+    auto meth = +[](void *obj, int service, int field, int rule_type,
+                    double value){
+        reinterpret_cast<StreamingSessionImpl*>(obj)->filters()
+            .add_rule( static_cast<StreamerServiceType>(service), field,
+                       static_cast<StreamingFilterRuleType>(rule_type), value );
+    };
+
+    return CallImplFromABI(allow_exceptions, meth, psession->obj, service,
+                           field, rule_type, value);
+}
+
+int
+StreamingSession_ClearFilter_ABI( StreamingSession_C *psession,
+                                  int service,
+                                  int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    /* NONE (clear all) is outside the valid range */
+    if( service != static_cast<int>(StreamerServiceType::NONE) )
+        CHECK_ENUM(StreamerServiceType, service, allow_exceptions);
+
+    auto meth = +[](void *obj, int service){
+        reinterpret_cast<StreamingSessionImpl*>(obj)->filters()
+            .clear( static_cast<StreamerServiceType>(service) );
+    };
+
+    return CallImplFromABI(allow_exceptions, meth, psession->obj, service);
+}
+
+int
+StreamingSession_GetFilterStats_ABI( StreamingSession_C *psession,
+                                     int service,
+                                     unsigned long long *npassed,
+                                     unsigned long long *ndropped,
+                                     int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_ENUM(StreamerServiceType, service, allow_exceptions);
+    CHECK_PTR(npassed, "npassed", allow_exceptions);
+    CHECK_PTR(ndropped, "ndropped", allow_exceptions);
+
+    auto meth = +[](void *obj, int service){
+        return reinterpret_cast<StreamingSessionImpl*>(obj)->filters()
+            .get_stats( static_cast<StreamerServiceType>(service) );
+    };
+
+    std::pair<unsigned long long, unsigned long long> stats;
+    tie(stats, err) = CallImplFromABI(allow_exceptions, meth, psession->obj,
+                                      service);
+    if( !err ){
+        *npassed = stats.first;
+        *ndropped = stats.second;
+    }
+    return err;
+}
+
+int
+StreamingSession_AddRoute_ABI( StreamingSession_C *psession,
+                               int service,
+                               const char** symbols,
+                               size_t nsymbols,
+                               streaming_cb_ty callback,
+                               int *id,
+                               int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_ENUM(StreamerServiceType, service, allow_exceptions);
+    CHECK_PTR(callback, "callback", allow_exceptions);
+    CHECK_PTR(id, "id", allow_exceptions);
+    if( nsymbols )
+        CHECK_PTR(symbols, "symbols", allow_exceptions);
+
+    set<string> s;
+    for( size_t i = 0; i < nsymbols; ++i ){
+        CHECK_PTR(symbols[i], "symbol", allow_exceptions);
+        s.insert(symbols[i]);
+    }
+
+    auto meth = +[](void *obj, int service, const set<string>& s,
+                    streaming_cb_ty callback){
+        return reinterpret_cast<StreamingSessionImpl*>(obj)->router()
+            .add_route( static_cast<StreamerServiceType>(service), s,
+                        callback );
+    };
+
+    tie(*id, err) = CallImplFromABI(allow_exceptions, meth, psession->obj,
+                                    service, s, callback);
+    return err;
+}
+
+int
+StreamingSession_RemoveRoute_ABI( StreamingSession_C *psession,
+                                  int id,
+                                  int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    auto meth = +[](void *obj, int id){
+        reinterpret_cast<StreamingSessionImpl*>(obj)->router()
+            .remove_route(id);
+    };
+
+    return CallImplFromABI(allow_exceptions, meth, psession->obj, id);
+}
+
+int
+StreamingSession_ClearRoutes_ABI( StreamingSession_C *psession,
+                                  int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    auto meth = +[](void *obj){
+        reinterpret_cast<StreamingSessionImpl*>(obj)->router().clear();
+    };
+
+    return CallImplFromABI(allow_exceptions, meth, psession->obj);
+}
+
+int
+StreamingSession_AddSpread_ABI( StreamingSession_C *psession,
+                                const char** symbols,
+                                int *ratios,
+                                size_t nlegs,
+                                int *id,
+                                int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_PTR(symbols, "symbols", allow_exceptions);
+    CHECK_PTR(ratios, "ratios", allow_exceptions);
+    CHECK_PTR(id, "id", allow_exceptions);
+
+    vector<std::pair<string, int>> legs;
+    for( size_t i = 0; i < nlegs; ++i ){
+        CHECK_PTR(symbols[i], "symbol", allow_exceptions);
+        legs.emplace_back(symbols[i], ratios[i]);
+    }
+
+    auto meth = +[](void *obj, const vector<std::pair<string, int>> *legs){
+        return reinterpret_cast<StreamingSessionImpl*>(obj)->spreads()
+            .add_spread(*legs);
+    };
+
+    tie(*id, err) = CallImplFromABI(allow_exceptions, meth, psession->obj,
+                                    &legs);
+    return err;
+}
+
+int
+StreamingSession_RemoveSpread_ABI( StreamingSession_C *psession,
+                                   int id,
+                                   int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    auto meth = +[](void *obj, int id){
+        reinterpret_cast<StreamingSessionImpl*>(obj)->spreads()
+            .remove_spread(id);
+    };
+
+    return CallImplFromABI(allow_exceptions, meth, psession->obj, id);
+}
+
+int
+StreamingSession_GetSpreadQuote_ABI( StreamingSession_C *psession,
+                                     int id,
+                                     SpreadQuote *quote,
+                                     int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_PTR(quote, "quote", allow_exceptions);
+
+    auto meth = +[](void *obj, int id){
+        return reinterpret_cast<StreamingSessionImpl*>(obj)->spreads()
+            .get_quote(id);
+    };
+
+    tie(*quote, err) = CallImplFromABI(allow_exceptions, meth, psession->obj,
+                                       id);
+    return err;
+}
+
+int
+StreamingSession_SetSpreadCallback_ABI( StreamingSession_C *psession,
+                                        spread_cb_ty callback,
+                                        int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    auto meth = +[](void *obj, spread_cb_ty callback){
+        reinterpret_cast<StreamingSessionImpl*>(obj)->spreads()
+            .set_callback(callback);
+    };
+
+    return CallImplFromABI(allow_exceptions, meth, psession->obj, callback);
+}
+
+int
+StreamingSession_SeedIVSurface_ABI( StreamingSession_C *psession,
+                                    const char* option_chain_json,
+                                    int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_PTR(option_chain_json, "option_chain_json", allow_exceptions);
+
+    auto meth = +[](void *obj, const char* chain){
+        json j;
+        try{
+            j = json::parse(chain);
+        }catch( json::exception& e ){
+            TDMA_API_THROW( ValueException,
+                            "invalid option chain json: " + string(e.what()) );
+        }
+        reinterpret_cast<StreamingSessionImpl*>(obj)->iv_surface().seed(j);
+    };
+
+    return CallImplFromABI(allow_exceptions, meth, psession->obj,
+                           option_chain_json);
+}
+
+int
+StreamingSession_SetIVSurfaceRefitInterval_ABI( StreamingSession_C *psession,
+                                                unsigned long msec,
+                                                int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    auto meth = +[](void *obj, unsigned long msec){
+        reinterpret_cast<StreamingSessionImpl*>(obj)->iv_surface()
+            .set_refit_interval( milliseconds(msec) );
+    };
+
+    return CallImplFromABI(allow_exceptions, meth, psession->obj, msec);
+}
+
+int
+StreamingSession_GetIVSurfaceRefitInterval_ABI( StreamingSession_C *psession,
+                                                unsigned long *msec,
+                                                int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_PTR(msec, "msec", allow_exceptions);
+
+    auto meth = +[](void *obj){
+        return static_cast<unsigned long>(
+            reinterpret_cast<StreamingSessionImpl*>(obj)->iv_surface()
+                .get_refit_interval().count()
+            );
+    };
+
+    tie(*msec, err) = CallImplFromABI(allow_exceptions, meth, psession->obj);
+    return err;
+}
+
+int
+StreamingSession_SetIVSurfaceEnabled_ABI( StreamingSession_C *psession,
+                                          int enabled,
+                                          int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    auto meth = +[](void *obj, int enabled){
+        reinterpret_cast<StreamingSessionImpl*>(obj)->iv_surface()
+            .set_enabled( static_cast<bool>(enabled) );
+    };
+
+    return CallImplFromABI(allow_exceptions, meth, psession->obj, enabled);
+}
+
+int
+StreamingSession_IsIVSurfaceEnabled_ABI( StreamingSession_C *psession,
+                                         int *enabled,
+                                         int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_PTR(enabled, "enabled", allow_exceptions);
+
+    auto meth = +[](void *obj){
+        return static_cast<int>(
+            reinterpret_cast<StreamingSessionImpl*>(obj)->iv_surface()
+                .is_enabled()
+            );
+    };
+
+    tie(*enabled, err) = CallImplFromABI(allow_exceptions, meth, psession->obj);
+    return err;
+}
+
+int
+StreamingSession_RefitIVSurface_ABI( StreamingSession_C *psession,
+                                     int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    auto meth = +[](void *obj){
+        reinterpret_cast<StreamingSessionImpl*>(obj)->iv_surface().refit();
+    };
+
+    return CallImplFromABI(allow_exceptions, meth, psession->obj);
+}
+
+int
+StreamingSession_GetIVSurfaceVol_ABI( StreamingSession_C *psession,
+                                      const char* underlying,
+                                      double strike,
+                                      double days_to_expiration,
+                                      double *vol,
+                                      int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_PTR(underlying, "underlying", allow_exceptions);
+    CHECK_PTR(vol, "vol", allow_exceptions);
+
+    auto meth = +[](void *obj, const char* underlying, double strike,
+                    double days){
+        return reinterpret_cast<StreamingSessionImpl*>(obj)->iv_surface()
+            .get_vol(underlying, strike, days);
+    };
+
+    tie(*vol, err) = CallImplFromABI(allow_exceptions, meth, psession->obj,
+                                     underlying, strike, days_to_expiration);
+    return err;
+}
+
+int
+StreamingSession_GetIVSurfaceGreeks_ABI( StreamingSession_C *psession,
+                                         const char* underlying,
+                                         double strike,
+                                         double days_to_expiration,
+                                         int is_call,
+                                         IVSurfaceGreeks *greeks,
+                                         int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSessionImpl>(psession, allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_PTR(underlying, "underlying", allow_exceptions);
+    CHECK_PTR(greeks, "greeks", allow_exceptions);
+
+    auto meth = +[](void *obj, const char* underlying, double strike,
+                    double days, int is_call){
+        return reinterpret_cast<StreamingSessionImpl*>(obj)->iv_surface()
+            .get_greeks(underlying, strike, days, is_call != 0);
+    };
+
+    tie(*greeks, err) = CallImplFromABI(allow_exceptions, meth, psession->obj,
+                                        underlying, strike, days_to_expiration,
+                                        is_call);
+    return err;
+}
+
+
+namespace tdma{
+
+/* TDMA_API_DIRECT_LINKAGE: the C++ proxy always holds a valid object */
+namespace {
+
+inline StreamingSessionImpl*
+direct_impl(StreamingSession_C *psession)
+{
+    assert( psession && psession->obj );
+    return reinterpret_cast<StreamingSessionImpl*>(psession->obj);
+}
+
+vector<StreamingSubscriptionImpl>
+direct_impl_subs( StreamingSession_C *psession,
+                  const vector<StreamingSubscription_C*>& subscriptions )
+{
+    if( subscriptions.size() > STREAMING_MAX_SUBSCRIPTIONS ){
+        TDMA_API_THROW( ValueException,
+                        "nsubs > STREAMING_MAX_SUBSCRIPTIONS" );
+    }
+
+    if( subscriptions.empty() )
+        TDMA_API_THROW(ValueException, "nsubs == 0");
+
+    try{
+        return create_impl_subs(
+            psession,
+            const_cast<StreamingSubscription_C**>( subscriptions.data() ),
+            subscriptions.size()
+            );
+    }catch(std::exception& e){
+        TDMA_API_THROW(StreamingException, e.what());
+    }
+}
+
+} /* namespace */
+
+deque<bool>
+StreamingSession_Start_Direct(
+    StreamingSession_C *psession,
+    const vector<StreamingSubscription_C*>& subscriptions )
+{
+    return direct_impl(psession)->start(
+        direct_impl_subs(psession, subscriptions)
+        );
+}
+
+deque<bool>
+StreamingSession_AddSubscriptions_Direct(
+    StreamingSession_C *psession,
+    const vector<StreamingSubscription_C*>& subscriptions )
+{
+    return direct_impl(psession)->add_subscriptions(
+        direct_impl_subs(psession, subscriptions)
+        );
+}
+
+void
+StreamingSession_Stop_Direct(StreamingSession_C *psession)
+{ direct_impl(psession)->stop(); }
+
+bool
+StreamingSession_IsActive_Direct(StreamingSession_C *psession)
+{ return direct_impl(psession)->is_active(); }
+
+void
+StreamingSession_SetJsonCallback_Direct( StreamingSession_C *psession,
+                                         streaming_json_cb_ty callback )
+{ direct_impl(psession)->set_json_callback( std::move(callback) ); }
+
+int
+StreamingSession_AddJsonRoute_Direct( StreamingSession_C *psession,
+                                      StreamerServiceType service,
+                                      const set<string>& symbols,
+                                      streaming_json_cb_ty callback )
+{
+    return direct_impl(psession)->router().add_route(
+        service, symbols, std::move(callback)
+        );
+}
+
+} /* tdma */
@@ -0,0 +1,699 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include <iostream>
+#include <cstring>
+#include <thread>
+#include <new>
+#include <limits>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#endif /* _WIN32 */
+
+#include "../../include/_streaming_shm.h"
+
+using std::string;
+using std::set;
+using std::tie;
+using std::cout;
+using std::endl;
+using std::chrono::milliseconds;
+
+namespace tdma{
+
+const size_t StreamingPublisherImpl::DEF_NSLOTS;
+const size_t StreamingPublisherImpl::DEF_SLOT_SIZE;
+const size_t StreamingPublisherImpl::MIN_SLOT_SIZE;
+
+void
+D(string msg, StreamingPublisherImpl *obj)
+{ util::debug_out("StreamingPublisherImpl", msg, obj, cout); }
+
+void
+D(string msg, StreamingSubscriberImpl *obj)
+{ util::debug_out("StreamingSubscriberImpl", msg, obj, cout); }
+
+
+namespace {
+
+string
+segment_name(const string& name)
+{
+    if( name.empty() )
+        TDMA_API_THROW(ValueException, "empty shared memory name");
+
+    if( name.find('/') != string::npos )
+        TDMA_API_THROW(ValueException, "shared memory name can't contain '/'");
+
+    return "/tdma_api." + name;
+}
+
+size_t
+ring_size(size_t nslots, size_t slot_size)
+{
+    if( nslots == 0 || (nslots & (nslots - 1)) )
+        TDMA_API_THROW(ValueException, "nslots must be a power of 2");
+
+    if( nslots > std::numeric_limits<uint32_t>::max() )
+        TDMA_API_THROW(ValueException, "nslots too large");
+
+    if( slot_size < StreamingPublisherImpl::MIN_SLOT_SIZE
+        || slot_size > std::numeric_limits<uint32_t>::max() )
+    {
+        TDMA_API_THROW(ValueException, "invalid slot_size");
+    }
+
+    if( slot_size % alignof(StreamingSlotHeader) )
+        TDMA_API_THROW(ValueException, "slot_size must be a multiple of 8");
+
+    return sizeof(StreamingRingHeader) + nslots * slot_size;
+}
+
+/* for the service mask */
+static_assert( enum_bounds<StreamerServiceType>::low >= 0
+               && enum_bounds<StreamerServiceType>::high < 64,
+               "StreamerServiceType doesn't fit in a 64 bit mask" );
+
+inline bool
+valid_service(int service)
+{
+    return service >= enum_bounds<StreamerServiceType>::low
+        && service <= enum_bounds<StreamerServiceType>::high;
+}
+
+#ifndef _WIN32
+
+/* left by a publisher that died w/o cleaning up (or isn't ours) */
+bool
+is_stale_ring(const void *addr, size_t size)
+{
+    if( size < sizeof(StreamingRingHeader) )
+        return true;
+
+    auto h = reinterpret_cast<const StreamingRingHeader*>(addr);
+    if( h->magic != STREAMING_SHM_MAGIC
+        || h->version != STREAMING_SHM_VERSION
+        || !h->active.load(std::memory_order_acquire) )
+    {
+        return true;
+    }
+
+    pid_t pid = static_cast<pid_t>(h->pid);
+    return pid <= 0 || (kill(pid, 0) == -1 && errno == ESRCH);
+}
+
+#endif /* _WIN32 */
+
+inline uint64_t
+complete_stamp(uint64_t pos)
+{ return (pos + 1) << 1; }
+
+inline uint64_t
+busy_stamp(uint64_t pos)
+{ return complete_stamp(pos) - 1; }
+
+} /* namespace */
+
+
+#ifndef _WIN32
+
+SharedMemorySegment::SharedMemorySegment( const string& name,
+                                          size_t size,
+                                          bool(*is_stale)(const void*, size_t) )
+    :
+        _name( name ),
+        _addr( nullptr ),
+        _size( size ),
+        _owner( true )
+    {
+        string sname = segment_name(name);
+
+        int fd = shm_open( sname.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644 );
+        if( fd == -1 && errno == EEXIST ){
+            /* never pull a live segment out from under its readers */
+            bool stale = false;
+            try{
+                SharedMemorySegment existing(name);
+                stale = is_stale(existing.get(), existing.size());
+            }catch(StreamingException&){
+                stale = true;
+            }
+            if( !stale ){
+                TDMA_API_THROW( StreamingException,
+                                "shared memory segment in use (" + name + ")" );
+            }
+            shm_unlink( sname.c_str() );
+            fd = shm_open( sname.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644 );
+        }
+        if( fd == -1 ){
+            TDMA_API_THROW( StreamingException,
+                            "shm_open failed: " + string(strerror(errno)) );
+        }
+
+        if( ftruncate(fd, size) == -1 ){
+            int e = errno;
+            close(fd);
+            shm_unlink( sname.c_str() );
+            TDMA_API_THROW( StreamingException,
+                            "ftruncate failed: " + string(strerror(e)) );
+        }
+
+        _addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if( _addr == MAP_FAILED ){
+            _addr = nullptr;
+            shm_unlink( sname.c_str() );
+            TDMA_API_THROW( StreamingException,
+                            "mmap failed: " + string(strerror(errno)) );
+        }
+    }
+
+
+SharedMemorySegment::SharedMemorySegment(const string& name)
+    :
+        _name( name ),
+        _addr( nullptr ),
+        _size( 0 ),
+        _owner( false )
+    {
+        string sname = segment_name(name);
+
+        int fd = shm_open( sname.c_str(), O_RDONLY, 0 );
+        if( fd == -1 ){
+            TDMA_API_THROW( StreamingException,
+                            "shm_open failed (" + name + "): "
+                            + string(strerror(errno)) );
+        }
+
+        struct stat st;
+        if( fstat(fd, &st) == -1 ){
+            int e = errno;
+            close(fd);
+            TDMA_API_THROW( StreamingException,
+                            "fstat failed: " + string(strerror(e)) );
+        }
+        _size = static_cast<size_t>(st.st_size);
+
+        _addr = mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if( _addr == MAP_FAILED ){
+            _addr = nullptr;
+            TDMA_API_THROW( StreamingException,
+                            "mmap failed: " + string(strerror(errno)) );
+        }
+    }
+
+
+SharedMemorySegment::~SharedMemorySegment()
+{
+    if( _addr )
+        munmap(_addr, _size);
+    if( _owner )
+        shm_unlink( segment_name(_name).c_str() );
+}
+
+#else
+
+SharedMemorySegment::SharedMemorySegment( const string& name,
+                                          size_t size,
+                                          bool(*)(const void*, size_t) )
+    : _name(name), _addr(nullptr), _size(size), _owner(true)
+    {
+        TDMA_API_THROW( StreamingException,
+                        "shared memory publishing not supported on windows" );
+    }
+
+SharedMemorySegment::SharedMemorySegment(const string& name)
+    : _name(name), _addr(nullptr), _size(0), _owner(false)
+    {
+        TDMA_API_THROW( StreamingException,
+                        "shared memory subscribing not supported on windows" );
+    }
+
+SharedMemorySegment::~SharedMemorySegment()
+{}
+
+#endif /* _WIN32 */
+
+
+StreamingPublisherImpl::StreamingPublisherImpl( const string& name,
+                                                size_t nslots,
+                                                size_t slot_size )
+    :
+#ifndef _WIN32
+        _segment( name, ring_size(nslots, slot_size), is_stale_ring ),
+#else
+        _segment( name, ring_size(nslots, slot_size), nullptr ),
+#endif /* _WIN32 */
+        _header( nullptr ),
+        _slots( nullptr ),
+        _pos( 0 )
+    {
+        D("construct (" + name + ")", this);
+
+        char *base = reinterpret_cast<char*>(_segment.get());
+        _header = new (base) StreamingRingHeader;
+        _header->magic = STREAMING_SHM_MAGIC;
+        _header->version = STREAMING_SHM_VERSION;
+        _header->nslots = static_cast<uint32_t>(nslots);
+        _header->slot_size = static_cast<uint32_t>(slot_size);
+        _header->write_pos.store(0, std::memory_order_relaxed);
+        _header->noversize.store(0, std::memory_order_relaxed);
+#ifndef _WIN32
+        _header->pid = static_cast<int64_t>(getpid());
+#endif /* _WIN32 */
+
+        _slots = base + sizeof(StreamingRingHeader);
+        for( size_t i = 0; i < nslots; ++i ){
+            StreamingSlotHeader *s = new (_slots + i * slot_size)
+                StreamingSlotHeader;
+            s->stamp.store(0, std::memory_order_relaxed);
+        }
+
+        /* subscribers check 'active' before trusting the rest of the header */
+        _header->active.store(1, std::memory_order_release);
+    }
+
+
+StreamingPublisherImpl::~StreamingPublisherImpl()
+{
+    D("destruct", this);
+    if( _header )
+        _header->active.store(0, std::memory_order_release);
+}
+
+
+void
+StreamingPublisherImpl::_write( StreamingCallbackType cb_type,
+                                StreamerServiceType ss_type,
+                                unsigned long long ts,
+                                const string& symbol,
+                                const string& data )
+{
+    size_t cap = _header->slot_size - sizeof(StreamingSlotHeader) - 1;
+    if( data.size() > cap ){
+        _header->noversize.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    StreamingSlotHeader *slot = _slot(_pos);
+
+    slot->stamp.store( busy_stamp(_pos), std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+
+    slot->timestamp = ts;
+    slot->callback_type = static_cast<int32_t>(cb_type);
+    slot->service_type = static_cast<int32_t>(ss_type);
+    slot->data_len = static_cast<uint32_t>(data.size());
+
+    size_t nsym = std::min(symbol.size(), STREAMING_SHM_SYMBOL_MAX);
+    memcpy(slot->symbol, symbol.c_str(), nsym);
+    slot->symbol[nsym] = '\0';
+
+    char *dest = reinterpret_cast<char*>(slot) + sizeof(StreamingSlotHeader);
+    memcpy(dest, data.c_str(), data.size() + 1);
+
+    slot->stamp.store( complete_stamp(_pos), std::memory_order_release );
+    _header->write_pos.store( ++_pos, std::memory_order_release );
+}
+
+
+void
+StreamingPublisherImpl::publish( StreamingCallbackType cb_type,
+                                 StreamerServiceType ss_type,
+                                 unsigned long long ts,
+                                 const json& j )
+{
+    if( cb_type == StreamingCallbackType::data && j.is_array() ){
+        for( auto& elem : j ){
+            auto k = elem.find("key");
+            string symbol = (k != elem.end() && k->is_string())
+                          ? k->get<string>()
+                          : string();
+            _write( cb_type, ss_type, ts, symbol, elem.dump() );
+        }
+    }else{
+        _write( cb_type, ss_type, ts, "", j.is_null() ? "" : j.dump() );
+    }
+}
+
+
+StreamingSubscriberImpl::StreamingSubscriberImpl(const string& name)
+    :
+        _segment( name ),
+        _header( nullptr ),
+        _slots( nullptr ),
+        _cursor( 0 ),
+        _ndropped( 0 ),
+        _services_mask( 0 ),
+        _symbols()
+    {
+        D("construct (" + name + ")", this);
+
+        if( _segment.size() < sizeof(StreamingRingHeader) )
+            TDMA_API_THROW(StreamingException, "invalid shared memory segment");
+
+        const char *base = reinterpret_cast<const char*>(_segment.get());
+        _header = reinterpret_cast<const StreamingRingHeader*>(base);
+
+        if( !_header->active.load(std::memory_order_acquire) )
+            TDMA_API_THROW(StreamingException, "publisher not active");
+
+        if( _header->magic != STREAMING_SHM_MAGIC
+            || _header->version != STREAMING_SHM_VERSION )
+        {
+            TDMA_API_THROW(StreamingException, "invalid shared memory segment");
+        }
+
+        size_t need = sizeof(StreamingRingHeader)
+                    + static_cast<size_t>(_header->nslots) * _header->slot_size;
+        if( _segment.size() < need )
+            TDMA_API_THROW(StreamingException, "truncated shared memory segment");
+
+        _slots = base + sizeof(StreamingRingHeader);
+
+        /* only see what's published from here on */
+        _cursor = _header->write_pos.load(std::memory_order_acquire);
+    }
+
+
+void
+StreamingSubscriberImpl::set_services(const set<StreamerServiceType>& services)
+{
+    uint64_t m = 0;
+    for( auto s : services ){
+        if( !valid_service(static_cast<int>(s)) )
+            TDMA_API_THROW(ValueException, "invalid service");
+        m |= (1ULL << static_cast<int>(s));
+    }
+    _services_mask = m;
+}
+
+
+void
+StreamingSubscriberImpl::set_symbols(const set<string>& symbols)
+{
+    _symbols.clear();
+    _symbols.insert(symbols.begin(), symbols.end());
+}
+
+
+bool
+StreamingSubscriberImpl::_matches(const StreamingSlotHeader *slot) const
+{
+    /* non-data items (start/stop/error etc.) are always passed through */
+    if( slot->callback_type != static_cast<int>(StreamingCallbackType::data) )
+        return true;
+
+    /* 'service_type' comes from another process; check before shifting */
+    if( _services_mask
+        && ( !valid_service(slot->service_type)
+             || !(_services_mask & (1ULL << slot->service_type)) ) )
+    {
+        return false;
+    }
+
+    if( !_symbols.empty() && !_symbols.count(slot->symbol) )
+        return false;
+
+    return true;
+}
+
+
+bool
+StreamingSubscriberImpl::_try_next(StreamingSubscriberItem *item)
+{
+    uint64_t w = _header->write_pos.load(std::memory_order_acquire);
+    while( _cursor < w ){
+        uint64_t nslots = _header->nslots;
+        if( w - _cursor > nslots ){
+            /* lapped by the publisher */
+            _ndropped += (w - nslots) - _cursor;
+            _cursor = w - nslots;
+        }
+
+        uint64_t pos = _cursor++;
+        const StreamingSlotHeader *slot = _slot(pos);
+        uint64_t stamp = complete_stamp(pos);
+
+        if( slot->stamp.load(std::memory_order_acquire) != stamp ){
+            ++_ndropped;
+            continue;
+        }
+
+        bool m = _matches(slot);
+        int32_t cb_type = slot->callback_type;
+        int32_t ss_type = slot->service_type;
+        uint64_t ts = slot->timestamp;
+        uint32_t len = slot->data_len;
+
+        std::atomic_thread_fence( std::memory_order_acquire );
+        if( slot->stamp.load(std::memory_order_relaxed) != stamp ){
+            ++_ndropped;
+            continue;
+        }
+
+        if( !m )
+            continue;
+
+        item->callback_type = cb_type;
+        item->service_type = ss_type;
+        item->timestamp = ts;
+        item->sequence = pos;
+        item->symbol = slot->symbol;
+        item->data = reinterpret_cast<const char*>(slot)
+                     + sizeof(StreamingSlotHeader);
+        item->data_len = len;
+        return true;
+    }
+    return false;
+}
+
+
+bool
+StreamingSubscriberImpl::next( StreamingSubscriberItem *item,
+                               milliseconds timeout )
+{
+    using namespace std::chrono;
+
+    if( _try_next(item) )
+        return true;
+
+    if( timeout.count() <= 0 )
+        return false;
+
+    /*
+     * we poll rather than wait on anything the publisher would have to
+     * signal; the publisher must never do work on behalf of subscribers
+     */
+    auto t_end = steady_clock::now() + timeout;
+    for( int i = 0; ; ++i ){
+        if( i < 64 )
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for( microseconds(100) );
+
+        if( _try_next(item) )
+            return true;
+
+        if( steady_clock::now() >= t_end )
+            return false;
+    }
+}
+
+
+bool
+StreamingSubscriberImpl::is_valid(const StreamingSubscriberItem *item) const
+{
+    std::atomic_thread_fence( std::memory_order_acquire );
+    return _slot(item->sequence)->stamp.load(std::memory_order_relaxed)
+        == complete_stamp(item->sequence);
+}
+
+} /* tdma */
+
+
+using namespace tdma;
+
+int
+StreamingSubscriber_Create_ABI( const char* name,
+                                StreamingSubscriber_C *psub,
+                                int allow_exceptions )
+{
+    CHECK_PTR(psub, "subscriber", allow_exceptions);
+    CHECK_PTR_KILL_PROXY(name, "name", allow_exceptions, psub);
+
+    static auto meth = +[](const char* n){
+        return new StreamingSubscriberImpl(n);
+    };
+
+    int err;
+    StreamingSubscriberImpl *obj;
+    tie(obj, err) = CallImplFromABI( allow_exceptions, meth, name );
+    if( err ){
+        kill_proxy(psub);
+        return err;
+    }
+
+    psub->obj = reinterpret_cast<void*>(obj);
+    psub->type_id = StreamingSubscriberImpl::TYPE_ID_LOW;
+    return 0;
+}
+
+
+int
+StreamingSubscriber_Destroy_ABI( StreamingSubscriber_C *psub,
+                                 int allow_exceptions )
+{ return destroy_proxy<StreamingSubscriberImpl>(psub, allow_exceptions); }
+
+
+int
+StreamingSubscriber_SetServices_ABI( StreamingSubscriber_C *psub,
+                                     int *services,
+                                     size_t nservices,
+                                     int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSubscriberImpl>(psub, allow_exceptions);
+    if( err )
+        return err;
+
+    if( nservices )
+        CHECK_PTR(services, "services", allow_exceptions);
+
+    set<StreamerServiceType> s;
+    for( size_t i = 0; i < nservices; ++i ){
+        CHECK_ENUM(StreamerServiceType, services[i], allow_exceptions);
+        s.insert( static_cast<StreamerServiceType>(services[i]) );
+    }
+
+    static auto meth = +[](void *obj, set<StreamerServiceType> s){
+        reinterpret_cast<StreamingSubscriberImpl*>(obj)->set_services(s);
+    };
+
+    return CallImplFromABI(allow_exceptions, meth, psub->obj, s);
+}
+
+
+int
+StreamingSubscriber_SetSymbols_ABI( StreamingSubscriber_C *psub,
+                                    const char** symbols,
+                                    size_t nsymbols,
+                                    int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSubscriberImpl>(psub, allow_exceptions);
+    if( err )
+        return err;
+
+    if( nsymbols )
+        CHECK_PTR(symbols, "symbols", allow_exceptions);
+
+    set<string> s;
+    for( size_t i = 0; i < nsymbols; ++i ){
+        CHECK_PTR(symbols[i], "symbol", allow_exceptions);
+        s.insert( symbols[i] );
+    }
+
+    static auto meth = +[](void *obj, set<string> s){
+        reinterpret_cast<StreamingSubscriberImpl*>(obj)->set_symbols(s);
+    };
+
+    return CallImplFromABI(allow_exceptions, meth, psub->obj, s);
+}
+
+
+int
+StreamingSubscriber_Next_ABI( StreamingSubscriber_C *psub,
+                              unsigned long timeout,
+                              StreamingSubscriberItem *item,
+                              int *has_item,
+                              int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSubscriberImpl>(psub, allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_PTR(item, "item", allow_exceptions);
+    CHECK_PTR(has_item, "has_item", allow_exceptions);
+
+    static auto meth = +[](void *obj, unsigned long t,
+                           StreamingSubscriberItem *i){
+        return static_cast<int>(
+            reinterpret_cast<StreamingSubscriberImpl*>(obj)
+                ->next( i, milliseconds(t) )
+            );
+    };
+
+    tie(*has_item, err) = CallImplFromABI( allow_exceptions, meth, psub->obj,
+                                           timeout, item );
+    return err;
+}
+
+
+int
+StreamingSubscriber_IsValid_ABI( StreamingSubscriber_C *psub,
+                                 StreamingSubscriberItem *item,
+                                 int *is_valid,
+                                 int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSubscriberImpl>(psub, allow_exceptions);
+    if( err )
+        return err;
+
+    CHECK_PTR(item, "item", allow_exceptions);
+    CHECK_PTR(is_valid, "is_valid", allow_exceptions);
+
+    static auto meth = +[](void *obj, StreamingSubscriberItem *i){
+        return static_cast<int>(
+            reinterpret_cast<StreamingSubscriberImpl*>(obj)->is_valid(i)
+            );
+    };
+
+    tie(*is_valid, err) = CallImplFromABI( allow_exceptions, meth, psub->obj,
+                                           item );
+    return err;
+}
+
+
+int
+StreamingSubscriber_GetNDropped_ABI( StreamingSubscriber_C *psub,
+                                     unsigned long long *ndropped,
+                                     int allow_exceptions )
+{
+    return ImplAccessor<unsigned long long>::template
+        get<StreamingSubscriberImpl>(
+            psub, &StreamingSubscriberImpl::get_ndropped, ndropped,
+            "ndropped", allow_exceptions
+        );
+}
+
+
+int
+StreamingSubscriber_IsPublisherActive_ABI( StreamingSubscriber_C *psub,
+                                           int *is_active,
+                                           int allow_exceptions )
+{
+    return ImplAccessor<int>::template
+        get<StreamingSubscriberImpl, bool>(
+            psub, &StreamingSubscriberImpl::is_publisher_active, is_active,
+            "is_active", allow_exceptions
+        );
+}
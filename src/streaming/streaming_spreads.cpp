@@ -0,0 +1,299 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "../../include/_streaming_spreads.h"
+
+using std::string;
+using std::vector;
+using std::pair;
+
+namespace {
+
+const string QUOTE_BID = std::to_string(
+    static_cast<int>(tdma::QuotesSubscriptionField::bid_price) );
+const string QUOTE_ASK = std::to_string(
+    static_cast<int>(tdma::QuotesSubscriptionField::ask_price) );
+const string OPTION_BID = std::to_string(
+    static_cast<int>(tdma::OptionsSubscriptionField::bid_price) );
+const string OPTION_ASK = std::to_string(
+    static_cast<int>(tdma::OptionsSubscriptionField::ask_price) );
+
+/* true if the field is in the item and changes 'value' */
+bool
+update_value(const json& item, const string& field, double& value)
+{
+    auto f = item.find(field);
+    if( f == item.end() || !f->is_number() )
+        return false;
+    double v = f->get<double>();
+    if( v == value )
+        return false;
+    value = v;
+    return true;
+}
+
+int
+gcd(int a, int b)
+{
+    while( b ){
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+bool
+quotes_differ(const SpreadQuote& l, const SpreadQuote& r)
+{
+    return l.is_valid != r.is_valid
+        || l.bid != r.bid
+        || l.ask != r.ask
+        || l.mid != r.mid;
+}
+
+} /* namespace */
+
+
+namespace tdma{
+
+StreamingSpreadEngine::LegQuote::LegQuote()
+    :
+        bid( std::numeric_limits<double>::quiet_NaN() ),
+        ask( std::numeric_limits<double>::quiet_NaN() )
+    {
+    }
+
+
+StreamingSpreadEngine::StreamingSpreadEngine()
+    :
+        _next_id(1),
+        _epoch(0),
+        _last_timestamp(0),
+        _callback(nullptr),
+        _has_spreads(false)
+    {
+    }
+
+
+int
+StreamingSpreadEngine::_intern(const string& symbol)
+{
+    auto s = _symbol_ids.find(symbol);
+    if( s != _symbol_ids.end() )
+        return s->second;
+    int id = static_cast<int>(_quotes.size());
+    _symbol_ids.emplace(symbol, id);
+    _quotes.emplace_back();
+    return id;
+}
+
+
+void
+StreamingSpreadEngine::_price(Spread& spread) const
+{
+    double bid = 0, ask = 0, mid = 0;
+    for( auto& leg : spread.legs ){
+        const LegQuote& q = _quotes[leg.symbol];
+        if( std::isnan(q.bid) || std::isnan(q.ask) ){
+            spread.quote = SpreadQuote{0, 0, 0, _last_timestamp, 0};
+            return;
+        }
+        /* shorts (r < 0) sell at the bid to buy the spread, buy at the ask */
+        if( leg.ratio > 0 ){
+            bid += leg.ratio * q.bid;
+            ask += leg.ratio * q.ask;
+        }else{
+            bid += leg.ratio * q.ask;
+            ask += leg.ratio * q.bid;
+        }
+        mid += leg.ratio * (q.bid + q.ask) / 2;
+    }
+    spread.quote = SpreadQuote{bid, ask, mid, _last_timestamp, 1};
+}
+
+
+int
+StreamingSpreadEngine::add_spread(const vector<pair<string, int>>& legs)
+{
+    if( legs.empty() )
+        TDMA_API_THROW(ValueException, "no legs");
+
+    /* combine repeated symbols, keep the order they were passed */
+    vector<pair<string, int>> combined;
+    for( auto& l : legs ){
+        if( l.first.empty() )
+            TDMA_API_THROW(ValueException, "empty symbol");
+        if( l.second == 0 )
+            TDMA_API_THROW(ValueException, "ratio == 0");
+        string symbol = util::toupper(l.first);
+        auto c = std::find_if( combined.begin(), combined.end(),
+                               [&](const pair<string, int>& p){
+                                   return p.first == symbol;
+                               });
+        if( c == combined.end() )
+            combined.emplace_back(symbol, l.second);
+        else
+            c->second += l.second;
+    }
+    combined.erase( std::remove_if( combined.begin(), combined.end(),
+                                    [](const pair<string, int>& p){
+                                        return p.second == 0;
+                                    }),
+                    combined.end() );
+    if( combined.empty() )
+        TDMA_API_THROW(ValueException, "legs cancel out");
+
+    int g = 0;
+    for( auto& c : combined )
+        g = gcd(std::abs(c.second), g);
+
+    std::lock_guard<std::mutex> _(_mtx);
+
+    int id = _next_id++;
+    Spread& spread = _spreads[id];
+    spread.id = id;
+    spread.epoch = 0;
+    for( auto& c : combined ){
+        int sid = _intern(c.first);
+        spread.legs.push_back( Leg{sid, c.second / g} );
+        _quotes[sid].spreads.push_back(&spread);
+    }
+    _price(spread);
+    _has_spreads.store(true, std::memory_order_release);
+    return id;
+}
+
+
+void
+StreamingSpreadEngine::remove_spread(int id)
+{
+    std::lock_guard<std::mutex> _(_mtx);
+
+    auto s = _spreads.find(id);
+    if( s == _spreads.end() )
+        TDMA_API_THROW(ValueException, "invalid spread id");
+
+    for( auto& leg : s->second.legs ){
+        auto& spreads = _quotes[leg.symbol].spreads;
+        auto p = std::find(spreads.begin(), spreads.end(), &s->second);
+        *p = spreads.back();
+        spreads.pop_back();
+    }
+    _spreads.erase(s);
+    if( _spreads.empty() )
+        _has_spreads.store(false, std::memory_order_release);
+}
+
+
+SpreadQuote
+StreamingSpreadEngine::get_quote(int id) const
+{
+    std::lock_guard<std::mutex> _(_mtx);
+
+    auto s = _spreads.find(id);
+    if( s == _spreads.end() )
+        TDMA_API_THROW(ValueException, "invalid spread id");
+    return s->second.quote;
+}
+
+
+void
+StreamingSpreadEngine::set_callback(spread_cb_ty callback)
+{
+    std::lock_guard<std::mutex> _(_mtx);
+    _callback = callback;
+}
+
+
+void
+StreamingSpreadEngine::update( StreamerServiceType service,
+                               unsigned long long timestamp,
+                               const json& content )
+{
+    if( !_has_spreads.load(std::memory_order_acquire) )
+        return;
+
+    const string *bid_field, *ask_field;
+    switch( service ){
+    case StreamerServiceType::QUOTE:
+        bid_field = &QUOTE_BID;
+        ask_field = &QUOTE_ASK;
+        break;
+    case StreamerServiceType::OPTION:
+        bid_field = &OPTION_BID;
+        ask_field = &OPTION_ASK;
+        break;
+    default:
+        return;
+    }
+
+    vector<pair<int, SpreadQuote>> changed;
+    spread_cb_ty callback;
+    {
+        std::lock_guard<std::mutex> _(_mtx);
+
+        ++_epoch;
+        _last_timestamp = timestamp;
+        for( auto& item : content ){
+            auto k = item.find("key");
+            if( k == item.end() || !k->is_string() )
+                continue;
+
+            /* not a leg of any spread (added so far) */
+            auto sid = _symbol_ids.find( k->get_ref<const string&>() );
+            if( sid == _symbol_ids.end() )
+                continue;
+
+            LegQuote& q = _quotes[sid->second];
+            bool b = update_value(item, *bid_field, q.bid);
+            bool a = update_value(item, *ask_field, q.ask);
+            if( !(b || a) )
+                continue;
+
+            for( Spread *s : q.spreads ){
+                if( s->epoch != _epoch ){
+                    s->epoch = _epoch;
+                    _dirty.push_back(s);
+                }
+            }
+        }
+
+        for( Spread *s : _dirty ){
+            SpreadQuote old = s->quote;
+            _price(*s);
+            if( quotes_differ(old, s->quote) )
+                changed.emplace_back(s->id, s->quote);
+            else
+                s->quote.timestamp = old.timestamp;
+        }
+        _dirty.clear();
+        callback = _callback;
+    }
+
+    if( callback ){
+        for( auto& c : changed )
+            callback( c.first, c.second.bid, c.second.ask, c.second.mid,
+                      c.second.timestamp );
+    }
+}
+
+} /* tdma */
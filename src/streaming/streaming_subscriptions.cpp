@@ -18,6 +18,9 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 #include <string>
 #include <map>
 #include <unordered_map>
+#include <bitset>
+#include <memory>
+#include <algorithm>
 
 #include "../../include/_streaming.h"
 
@@ -25,11 +28,91 @@ using std::string;
 using std::vector;
 using std::set;
 using std::map;
-using std::function;
 using std::tie;
 
 namespace tdma {
 
+/*
+ * fields of a managed subscription: a bitset sized (at compile time) by the
+ * field enum; iterates/joins in ascending order, like the set<F> it replaces
+ */
+template<typename F>
+class FieldSet{
+    static_assert( enum_bounds<F>::low == 0, "field enum must start at 0" );
+
+    std::bitset<enum_bounds<F>::high + 1> _bits;
+
+public:
+    static bool
+    is_valid(int f)
+    { return f >= enum_bounds<F>::low && f <= enum_bounds<F>::high; }
+
+    FieldSet()
+    {}
+
+    FieldSet( const set<F>& fields )
+    {
+        for( F f : fields )
+            insert(f);
+    }
+
+    // caller checks is_valid
+    void
+    insert(F f)
+    { _bits.set( static_cast<size_t>(f) ); }
+
+    template<typename Func>
+    void
+    for_each(Func func) const
+    {
+        for( size_t i = 0; i < _bits.size(); ++i ){
+            if( _bits[i] )
+                func( static_cast<F>(i) );
+        }
+    }
+
+    set<F>
+    to_set() const
+    {
+        set<F> s;
+        for_each( [&](F f){ s.insert(s.end(), f); } );
+        return s;
+    }
+
+    string
+    join() const
+    {
+        string s;
+        for_each( [&](F f){
+            if( !s.empty() )
+                s.push_back(',');
+            s += std::to_string( static_cast<unsigned int>(f) );
+        } );
+        return s;
+    }
+
+    size_t
+    size() const
+    { return _bits.count(); }
+
+    bool
+    empty() const
+    { return _bits.none(); }
+
+    size_t
+    hash() const
+    { return std::hash<decltype(_bits)>()(_bits); }
+
+    bool
+    operator==(const FieldSet& fields) const
+    { return _bits == fields._bits; }
+
+    bool
+    operator!=(const FieldSet& fields) const
+    { return _bits != fields._bits; }
+};
+
+
 StreamingSubscriptionImpl::StreamingSubscriptionImpl(
         std::string service_str,
         std::string command_str )
@@ -62,8 +145,11 @@ StreamingSubscriptionImpl::encode_symbol(string symbol)
         return symbol;
     */
 
-    for(auto& s : symbol)
-        s = toupper(s);
+    // symbols are ASCII, skip the locale
+    for(auto& s : symbol){
+        if( s >= 'a' && s <= 'z' )
+            s -= ('a' - 'A');
+    }
 
     /*
     char c2 = symbol[s-2];
@@ -150,17 +236,22 @@ public:
         set_parameters( build_parameters() );
     }
 
+    // parameters are built from the typed state so no need to compare them
     virtual bool
     operator==(const ManagedSubscriptionImpl& sub ) const
-    {
-        return StreamingSubscriptionImpl::operator==(sub) &&
-            sub._service == _service && sub._command == _command;
-    }
+    { return sub._service == _service && sub._command == _command; }
 
     virtual bool
     operator!=(const ManagedSubscriptionImpl&  sub ) const
     { return !(*this == sub); }
 
+    size_t
+    hash() const
+    {
+        return util::hash_combine( static_cast<size_t>(_service),
+                                   static_cast<size_t>(_command) );
+    }
+
     ~ManagedSubscriptionImpl(){}
 };
 
@@ -182,10 +273,17 @@ public:
 
 class SubscriptionBySymbolBaseImpl
         : public ManagedSubscriptionImpl {
-    set<string> _symbols;
+    struct Symbols{
+        vector<string> symbols; // encoded, sorted, unique
+        string joined;
+        size_t hash;
+    };
+
+    // shared (immutable) so copies are cheap
+    std::shared_ptr<const Symbols> _symbols;
 
     void
-    check_symbols( const set<string>& symbols ) const
+    check_symbols( const vector<string>& symbols ) const
     {
         CommandType cmd = get_command();
         if( cmd == CommandType::UNSUBS || cmd == CommandType::VIEW )
@@ -201,7 +299,7 @@ class SubscriptionBySymbolBaseImpl
 protected:
     template<typename F>
     void
-    check_fields( const set<F>& fields) const
+    check_fields( const FieldSet<F>& fields) const
     {
         CommandType cmd = get_command();
         if( cmd == CommandType::UNSUBS )
@@ -214,35 +312,12 @@ protected:
         }
     }
 
-    template<typename F>
-    std::string
-    build_fields_value( const set<F>& fields) const
-    {
-        vector<string> fields_str(fields.size());
-        transform( fields.begin(), fields.end(), fields_str.begin(),
-                   [](F f){
-                       return std::to_string(static_cast<unsigned int>(f));
-                   } );
-        return util::join(fields_str, ',');
-    }
-
-    std::string
-    build_symbols_value( const set<string>& symbols) const
-    {
-        vector<string> symbols_enc;
-        for(auto& s : symbols)
-            symbols_enc.emplace_back(
-                StreamingSubscriptionImpl::encode_symbol(s)
-            );
-        return util::join(symbols_enc, ',');
-    }
-
     template<typename F>
     map<string, string>
-    build_parameters( const set<F>& fields ) const
+    build_parameters( const FieldSet<F>& fields ) const
     {
-        return { {"fields", build_fields_value(fields)},
-                 {"keys", build_symbols_value(_symbols)} };
+        return { {"fields", fields.join()},
+                 {"keys", _symbols->joined} };
     }
 
     using ManagedSubscriptionImpl::build_parameters;
@@ -252,34 +327,59 @@ public:
     static const int TYPE_ID_LOW = TYPE_ID_SUB_QUOTES;
     static const int TYPE_ID_HIGH = TYPE_ID_SUB_TIMESALE_OPTIONS;
 
-    set<string>
+    const vector<string>&
     get_symbols() const
-    { return _symbols; }
+    { return _symbols->symbols; }
 
     void
-    set_symbols( const set<string>& symbols )
+    set_symbols( vector<string> symbols )
     {
         check_symbols(symbols);
-        _symbols = util::toupper(symbols);
+        for( auto& s : symbols )
+            s = StreamingSubscriptionImpl::encode_symbol( std::move(s) );
+        // usually sorted already (from a set)
+        if( !std::is_sorted(symbols.begin(), symbols.end()) )
+            std::sort( symbols.begin(), symbols.end() );
+        symbols.erase( std::unique(symbols.begin(), symbols.end()),
+                       symbols.end() );
+
+        std::hash<string> hs;
+        size_t h = symbols.size();
+        for( auto& s : symbols )
+            h = util::hash_combine(h, hs(s));
+
+        string joined = util::join(symbols, ',');
+        _symbols = std::make_shared<const Symbols>(
+            Symbols{std::move(symbols), std::move(joined), h}
+            );
         set_parameters( build_parameters() );
     }
 
     bool
     operator==( const SubscriptionBySymbolBaseImpl& sub ) const
     {
-        return ManagedSubscriptionImpl::operator==(sub)
-            && sub._symbols == _symbols;
+        return sub._symbols->hash == _symbols->hash
+            && ManagedSubscriptionImpl::operator==(sub)
+            && ( sub._symbols == _symbols
+                 || sub._symbols->symbols == _symbols->symbols );
+    }
+
+    size_t
+    hash() const
+    {
+        return util::hash_combine( ManagedSubscriptionImpl::hash(),
+                                   _symbols->hash );
     }
 
 
 protected:
     SubscriptionBySymbolBaseImpl( StreamerServiceType service,
                                   CommandType command,
-                                  const set<string>& symbols )
+                                  vector<string> symbols )
         :
             ManagedSubscriptionImpl(service, command)
         {
-            set_symbols( symbols );
+            set_symbols( std::move(symbols) );
         }
 };
 
@@ -290,20 +390,27 @@ public:
     using FieldType = QuotesSubscriptionField;
 
 private:
-    set<FieldType> _fields;
+    FieldSet<FieldType> _fields;
 
 public:
     typedef QuotesSubscription ProxyType;
     static const int TYPE_ID_LOW = TYPE_ID_SUB_QUOTES;
     static const int TYPE_ID_HIGH = TYPE_ID_SUB_QUOTES;
-    static function<bool(int)> is_valid_field;
+
+    static bool
+    is_valid_field(int f)
+    { return FieldSet<FieldType>::is_valid(f); }
 
     set<FieldType>
     get_fields() const
+    { return _fields.to_set(); }
+
+    const FieldSet<FieldType>&
+    get_field_set() const
     { return _fields; }
 
     void
-    set_fields(const set<FieldType>& fields)
+    set_fields(const FieldSet<FieldType>& fields)
     {
         check_fields(fields);
         _fields = fields;
@@ -316,12 +423,12 @@ public:
         return SubscriptionBySymbolBaseImpl::build_parameters(_fields);
     }
 
-    QuotesSubscriptionImpl( const set<string>& symbols,
-                            const set<FieldType>& fields,
+    QuotesSubscriptionImpl( vector<string> symbols,
+                            const FieldSet<FieldType>& fields,
                             CommandType command = CommandType::SUBS )
         :
             SubscriptionBySymbolBaseImpl(StreamerServiceType::QUOTE, command,
-                                         symbols)
+                                         std::move(symbols))
         {
             set_fields(fields);
         }
@@ -329,8 +436,15 @@ public:
     bool
     operator==( const QuotesSubscriptionImpl& sub ) const
     {
-        return SubscriptionBySymbolBaseImpl::operator==(sub)
-            && sub._fields == _fields;
+        return sub._fields == _fields
+            && SubscriptionBySymbolBaseImpl::operator==(sub);
+    }
+
+    size_t
+    hash() const
+    {
+        return util::hash_combine( SubscriptionBySymbolBaseImpl::hash(),
+                                   _fields.hash() );
     }
 
 };
@@ -342,20 +456,27 @@ public:
     using FieldType = OptionsSubscriptionField;
 
 private:
-    set<FieldType> _fields;
+    FieldSet<FieldType> _fields;
 
 public:
     typedef OptionsSubscription ProxyType;
     static const int TYPE_ID_LOW = TYPE_ID_SUB_OPTIONS;
     static const int TYPE_ID_HIGH = TYPE_ID_SUB_OPTIONS;
-    static function<bool(int)> is_valid_field;
+
+    static bool
+    is_valid_field(int f)
+    { return FieldSet<FieldType>::is_valid(f); }
 
     set<FieldType>
     get_fields() const
+    { return _fields.to_set(); }
+
+    const FieldSet<FieldType>&
+    get_field_set() const
     { return _fields; }
 
     void
-    set_fields(const set<FieldType>& fields)
+    set_fields(const FieldSet<FieldType>& fields)
     {
         check_fields(fields);
         _fields = fields;
@@ -368,12 +489,12 @@ public:
         return SubscriptionBySymbolBaseImpl::build_parameters(_fields);
     }
 
-    OptionsSubscriptionImpl( const set<string>& symbols,
-                             const set<FieldType>& fields,
+    OptionsSubscriptionImpl( vector<string> symbols,
+                             const FieldSet<FieldType>& fields,
                              CommandType command = CommandType::SUBS )
         :
             SubscriptionBySymbolBaseImpl(StreamerServiceType::OPTION, command,
-                                         symbols)
+                                         std::move(symbols))
         {
             set_fields(fields);
         }
@@ -381,8 +502,15 @@ public:
     bool
     operator==( const OptionsSubscriptionImpl& sub ) const
     {
-        return SubscriptionBySymbolBaseImpl::operator==(sub)
-            && sub._fields == _fields;
+        return sub._fields == _fields
+            && SubscriptionBySymbolBaseImpl::operator==(sub);
+    }
+
+    size_t
+    hash() const
+    {
+        return util::hash_combine( SubscriptionBySymbolBaseImpl::hash(),
+                                   _fields.hash() );
     }
 };
 
@@ -393,20 +521,27 @@ public:
     using FieldType = LevelOneFuturesSubscriptionField;
 
 private:
-    set<FieldType> _fields;
+    FieldSet<FieldType> _fields;
 
 public:
     typedef LevelOneFuturesSubscription ProxyType;
     static const int TYPE_ID_LOW = TYPE_ID_SUB_LEVEL_ONE_FUTURES;
     static const int TYPE_ID_HIGH = TYPE_ID_SUB_LEVEL_ONE_FUTURES;
-    static function<bool(int)> is_valid_field;
+
+    static bool
+    is_valid_field(int f)
+    { return FieldSet<FieldType>::is_valid(f); }
 
     set<FieldType>
     get_fields() const
+    { return _fields.to_set(); }
+
+    const FieldSet<FieldType>&
+    get_field_set() const
     { return _fields; }
 
     void
-    set_fields(const set<FieldType>& fields)
+    set_fields(const FieldSet<FieldType>& fields)
     {
         check_fields(fields);
         _fields = fields;
@@ -419,12 +554,12 @@ public:
         return SubscriptionBySymbolBaseImpl::build_parameters(_fields);
     }
 
-    LevelOneFuturesSubscriptionImpl( const set<string>& symbols,
-                                     const set<FieldType>& fields,
+    LevelOneFuturesSubscriptionImpl( vector<string> symbols,
+                                     const FieldSet<FieldType>& fields,
                                      CommandType command = CommandType::SUBS )
         :
             SubscriptionBySymbolBaseImpl(StreamerServiceType::LEVELONE_FUTURES,
-                                         command, symbols)
+                                         command, std::move(symbols))
         {
             set_fields(fields);
         }
@@ -432,8 +567,15 @@ public:
     bool
     operator==( const LevelOneFuturesSubscriptionImpl& sub ) const
     {
-        return SubscriptionBySymbolBaseImpl::operator==(sub)
-            && sub._fields == _fields;
+        return sub._fields == _fields
+            && SubscriptionBySymbolBaseImpl::operator==(sub);
+    }
+
+    size_t
+    hash() const
+    {
+        return util::hash_combine( SubscriptionBySymbolBaseImpl::hash(),
+                                   _fields.hash() );
     }
 };
 
@@ -444,20 +586,27 @@ public:
     using FieldType = LevelOneForexSubscriptionField;
 
 private:
-    set<FieldType> _fields;
+    FieldSet<FieldType> _fields;
 
 public:
     typedef LevelOneForexSubscription ProxyType;
     static const int TYPE_ID_LOW = TYPE_ID_SUB_LEVEL_ONE_FOREX;
     static const int TYPE_ID_HIGH = TYPE_ID_SUB_LEVEL_ONE_FOREX;
-    static function<bool(int)> is_valid_field;
+
+    static bool
+    is_valid_field(int f)
+    { return FieldSet<FieldType>::is_valid(f); }
 
     set<FieldType>
     get_fields() const
+    { return _fields.to_set(); }
+
+    const FieldSet<FieldType>&
+    get_field_set() const
     { return _fields; }
 
     void
-    set_fields(const set<FieldType>& fields)
+    set_fields(const FieldSet<FieldType>& fields)
     {
         check_fields(fields);
         _fields = fields;
@@ -470,12 +619,12 @@ public:
         return SubscriptionBySymbolBaseImpl::build_parameters(_fields);
     }
 
-    LevelOneForexSubscriptionImpl( const set<string>& symbols,
-                                   const set<FieldType>& fields,
+    LevelOneForexSubscriptionImpl( vector<string> symbols,
+                                   const FieldSet<FieldType>& fields,
                                    CommandType command = CommandType::SUBS )
         :
             SubscriptionBySymbolBaseImpl(StreamerServiceType::LEVELONE_FOREX,
-                                         command, symbols)
+                                         command, std::move(symbols))
         {
             set_fields(fields);
         }
@@ -483,8 +632,15 @@ public:
     bool
     operator==( const LevelOneForexSubscriptionImpl& sub ) const
     {
-        return SubscriptionBySymbolBaseImpl::operator==(sub)
-            && sub._fields == _fields;
+        return sub._fields == _fields
+            && SubscriptionBySymbolBaseImpl::operator==(sub);
+    }
+
+    size_t
+    hash() const
+    {
+        return util::hash_combine( SubscriptionBySymbolBaseImpl::hash(),
+                                   _fields.hash() );
     }
 };
 
@@ -495,20 +651,27 @@ public:
     using FieldType = LevelOneFuturesOptionsSubscriptionField;
 
 private:
-    set<FieldType> _fields;
+    FieldSet<FieldType> _fields;
 
 public:
     typedef LevelOneFuturesOptionsSubscription ProxyType;
     static const int TYPE_ID_LOW = TYPE_ID_SUB_LEVEL_ONE_FUTURES_OPTIONS;
     static const int TYPE_ID_HIGH = TYPE_ID_SUB_LEVEL_ONE_FUTURES_OPTIONS;
-    static function<bool(int)> is_valid_field;
+
+    static bool
+    is_valid_field(int f)
+    { return FieldSet<FieldType>::is_valid(f); }
 
     set<FieldType>
     get_fields() const
+    { return _fields.to_set(); }
+
+    const FieldSet<FieldType>&
+    get_field_set() const
     { return _fields; }
 
     void
-    set_fields(const set<FieldType>& fields)
+    set_fields(const FieldSet<FieldType>& fields)
     {
         check_fields(fields);
         _fields = fields;
@@ -521,13 +684,13 @@ public:
         return SubscriptionBySymbolBaseImpl::build_parameters(_fields);
     }
 
-    LevelOneFuturesOptionsSubscriptionImpl( const set<string>& symbols,
-                                            const set<FieldType>& fields,
+    LevelOneFuturesOptionsSubscriptionImpl( vector<string> symbols,
+                                            const FieldSet<FieldType>& fields,
                                             CommandType command = CommandType::SUBS )
         :
             SubscriptionBySymbolBaseImpl(
                 StreamerServiceType::LEVELONE_FUTURES_OPTIONS, command,
-                symbols )
+                std::move(symbols) )
         {
             set_fields(fields);
         }
@@ -535,8 +698,15 @@ public:
     bool
     operator==( const LevelOneFuturesOptionsSubscriptionImpl& sub ) const
     {
-        return SubscriptionBySymbolBaseImpl::operator==(sub)
-            && sub._fields == _fields;
+        return sub._fields == _fields
+            && SubscriptionBySymbolBaseImpl::operator==(sub);
+    }
+
+    size_t
+    hash() const
+    {
+        return util::hash_combine( SubscriptionBySymbolBaseImpl::hash(),
+                                   _fields.hash() );
     }
 };
 
@@ -547,20 +717,27 @@ public:
     using FieldType = NewsHeadlineSubscriptionField;
 
 private:
-    set<FieldType> _fields;
+    FieldSet<FieldType> _fields;
 
 public:
     typedef NewsHeadlineSubscription ProxyType;
     static const int TYPE_ID_LOW = TYPE_ID_SUB_NEWS_HEADLINE;
     static const int TYPE_ID_HIGH = TYPE_ID_SUB_NEWS_HEADLINE;
-    static function<bool(int)> is_valid_field;
+
+    static bool
+    is_valid_field(int f)
+    { return FieldSet<FieldType>::is_valid(f); }
 
     set<FieldType>
     get_fields() const
+    { return _fields.to_set(); }
+
+    const FieldSet<FieldType>&
+    get_field_set() const
     { return _fields; }
 
     void
-    set_fields(const set<FieldType>& fields)
+    set_fields(const FieldSet<FieldType>& fields)
     {
         check_fields(fields);
         _fields = fields;
@@ -573,12 +750,12 @@ public:
         return SubscriptionBySymbolBaseImpl::build_parameters(_fields);
     }
 
-    NewsHeadlineSubscriptionImpl( const set<string>& symbols,
-                                  const set<FieldType>& fields,
+    NewsHeadlineSubscriptionImpl( vector<string> symbols,
+                                  const FieldSet<FieldType>& fields,
                                   CommandType command = CommandType::SUBS)
         :
             SubscriptionBySymbolBaseImpl(StreamerServiceType::NEWS_HEADLINE,
-                                         command, symbols)
+                                         command, std::move(symbols))
         {
             set_fields(fields);
         }
@@ -586,8 +763,15 @@ public:
     bool
     operator==( const NewsHeadlineSubscriptionImpl& sub ) const
     {
-        return SubscriptionBySymbolBaseImpl::operator==(sub)
-            && sub._fields == _fields;
+        return sub._fields == _fields
+            && SubscriptionBySymbolBaseImpl::operator==(sub);
+    }
+
+    size_t
+    hash() const
+    {
+        return util::hash_combine( SubscriptionBySymbolBaseImpl::hash(),
+                                   _fields.hash() );
     }
 
 };
@@ -600,20 +784,27 @@ public:
     using FieldType = ChartEquitySubscriptionField;
 
 private:
-    set<FieldType> _fields;
+    FieldSet<FieldType> _fields;
 
 public:
     typedef ChartEquitySubscription ProxyType;
     static const int TYPE_ID_LOW = TYPE_ID_SUB_CHART_EQUITY;
     static const int TYPE_ID_HIGH = TYPE_ID_SUB_CHART_EQUITY;
-    static function<bool(int)> is_valid_field;
+
+    static bool
+    is_valid_field(int f)
+    { return FieldSet<FieldType>::is_valid(f); }
 
     set<FieldType>
     get_fields() const
+    { return _fields.to_set(); }
+
+    const FieldSet<FieldType>&
+    get_field_set() const
     { return _fields; }
 
     void
-    set_fields(const set<FieldType>& fields)
+    set_fields(const FieldSet<FieldType>& fields)
     {
         check_fields(fields);
         _fields = fields;
@@ -626,12 +817,12 @@ public:
         return SubscriptionBySymbolBaseImpl::build_parameters(_fields);
     }
 
-    ChartEquitySubscriptionImpl( const set<string>& symbols,
-                                 const set<FieldType>& fields,
+    ChartEquitySubscriptionImpl( vector<string> symbols,
+                                 const FieldSet<FieldType>& fields,
                                  CommandType command = CommandType::SUBS )
         :
             SubscriptionBySymbolBaseImpl(StreamerServiceType::CHART_EQUITY,
-                                         command, symbols)
+                                         command, std::move(symbols))
         {
             set_fields(fields);
         }
@@ -639,8 +830,15 @@ public:
     bool
     operator==( const ChartEquitySubscriptionImpl& sub ) const
     {
-        return SubscriptionBySymbolBaseImpl::operator==(sub)
-            && sub._fields == _fields;
+        return sub._fields == _fields
+            && SubscriptionBySymbolBaseImpl::operator==(sub);
+    }
+
+    size_t
+    hash() const
+    {
+        return util::hash_combine( SubscriptionBySymbolBaseImpl::hash(),
+                                   _fields.hash() );
     }
 };
 
@@ -652,18 +850,25 @@ public:
     typedef ChartSubscriptionBase ProxyType;
     static const int TYPE_ID_LOW = TYPE_ID_SUB_CHART_FOREX;
     static const int TYPE_ID_HIGH = TYPE_ID_SUB_CHART_OPTIONS;
-    static function<bool(int)> is_valid_field;
+
+    static bool
+    is_valid_field(int f)
+    { return FieldSet<FieldType>::is_valid(f); }
 
 private:
-    set<FieldType> _fields;
+    FieldSet<FieldType> _fields;
 
 public:
     set<FieldType>
     get_fields() const
+    { return _fields.to_set(); }
+
+    const FieldSet<FieldType>&
+    get_field_set() const
     { return _fields; }
 
     void
-    set_fields(const set<FieldType>& fields)
+    set_fields(const FieldSet<FieldType>& fields)
     {
         check_fields(fields);
         _fields = fields;
@@ -679,17 +884,24 @@ public:
     bool
     operator==( const ChartSubscriptionBaseImpl& sub ) const
     {
-        return SubscriptionBySymbolBaseImpl::operator==(sub)
-            && sub._fields == _fields;
+        return sub._fields == _fields
+            && SubscriptionBySymbolBaseImpl::operator==(sub);
+    }
+
+    size_t
+    hash() const
+    {
+        return util::hash_combine( SubscriptionBySymbolBaseImpl::hash(),
+                                   _fields.hash() );
     }
 
 protected:
     ChartSubscriptionBaseImpl( StreamerServiceType service,
                                CommandType command,
-                               const set<string>& symbols,
-                               const set<FieldType>& fields )
+                               vector<string> symbols,
+                               const FieldSet<FieldType>& fields )
         :
-            SubscriptionBySymbolBaseImpl(service, command, symbols)
+            SubscriptionBySymbolBaseImpl(service, command, std::move(symbols))
         {
             set_fields(fields);
         }
@@ -721,11 +933,11 @@ public:
     static const int TYPE_ID_LOW = TYPE_ID_SUB_CHART_FUTURES;
     static const int TYPE_ID_HIGH = TYPE_ID_SUB_CHART_FUTURES;
 
-    ChartFuturesSubscriptionImpl( const set<string>& symbols,
-                                  const set<FieldType>& fields,
+    ChartFuturesSubscriptionImpl( vector<string> symbols,
+                                  const FieldSet<FieldType>& fields,
                                   CommandType command = CommandType::SUBS )
         : ChartSubscriptionBaseImpl( StreamerServiceType::CHART_FUTURES,
-                                     command, symbols, fields  )
+                                     command, std::move(symbols), fields  )
     {}
 };
 
@@ -737,11 +949,11 @@ public:
     static const int TYPE_ID_LOW = TYPE_ID_SUB_CHART_OPTIONS;
     static const int TYPE_ID_HIGH = TYPE_ID_SUB_CHART_OPTIONS;
 
-    ChartOptionsSubscriptionImpl( const set<string>& symbols,
-                                  const set<FieldType>& fields,
+    ChartOptionsSubscriptionImpl( vector<string> symbols,
+                                  const FieldSet<FieldType>& fields,
                                   CommandType command = CommandType::SUBS )
         : ChartSubscriptionBaseImpl( StreamerServiceType::CHART_OPTIONS,
-                                     command, symbols, fields )
+                                     command, std::move(symbols), fields )
     {}
 };
 
@@ -753,18 +965,25 @@ public:
     typedef TimesaleSubscriptionBase ProxyType;
     static const int TYPE_ID_LOW = TYPE_ID_SUB_TIMESALE_EQUITY;
     static const int TYPE_ID_HIGH = TYPE_ID_SUB_TIMESALE_OPTIONS;
-    static function<bool(int)> is_valid_field;
+
+    static bool
+    is_valid_field(int f)
+    { return FieldSet<FieldType>::is_valid(f); }
 
 private:
-    set<FieldType> _fields;
+    FieldSet<FieldType> _fields;
 
 public:
     set<FieldType>
     get_fields() const
+    { return _fields.to_set(); }
+
+    const FieldSet<FieldType>&
+    get_field_set() const
     { return _fields; }
 
     void
-    set_fields(const set<FieldType>& fields)
+    set_fields(const FieldSet<FieldType>& fields)
     {
         check_fields(fields);
         _fields = fields;
@@ -780,17 +999,24 @@ public:
     bool
     operator==( const TimesaleSubscriptionBaseImpl& sub ) const
     {
-        return SubscriptionBySymbolBaseImpl::operator==(sub)
-            && sub._fields == _fields;
+        return sub._fields == _fields
+            && SubscriptionBySymbolBaseImpl::operator==(sub);
+    }
+
+    size_t
+    hash() const
+    {
+        return util::hash_combine( SubscriptionBySymbolBaseImpl::hash(),
+                                   _fields.hash() );
     }
 
 protected:
     TimesaleSubscriptionBaseImpl( StreamerServiceType service,
                                   CommandType command,
-                                  const set<string>& symbols,
-                                  const set<FieldType>& fields )
+                                  vector<string> symbols,
+                                  const FieldSet<FieldType>& fields )
         :
-            SubscriptionBySymbolBaseImpl(service, command, symbols)
+            SubscriptionBySymbolBaseImpl(service, command, std::move(symbols))
         {
             set_fields(fields);
         }
@@ -804,11 +1030,11 @@ public:
     static const int TYPE_ID_LOW = TYPE_ID_SUB_TIMESALE_EQUITY;
     static const int TYPE_ID_HIGH = TYPE_ID_SUB_TIMESALE_EQUITY;
 
-    TimesaleEquitySubscriptionImpl( const set<string>& symbols,
-                                    const set<FieldType>& fields,
+    TimesaleEquitySubscriptionImpl( vector<string> symbols,
+                                    const FieldSet<FieldType>& fields,
                                     CommandType command = CommandType::SUBS )
         : TimesaleSubscriptionBaseImpl( StreamerServiceType::TIMESALE_EQUITY,
-                                        command, symbols, fields)
+                                        command, std::move(symbols), fields)
     {}
 };
 
@@ -835,11 +1061,11 @@ public:
     static const int TYPE_ID_LOW = TYPE_ID_SUB_TIMESALE_FUTURES;
     static const int TYPE_ID_HIGH = TYPE_ID_SUB_TIMESALE_FUTURES;
 
-    TimesaleFuturesSubscriptionImpl( const set<string>& symbols,
-                                     const set<FieldType>& fields,
+    TimesaleFuturesSubscriptionImpl( vector<string> symbols,
+                                     const FieldSet<FieldType>& fields,
                                      CommandType command = CommandType::SUBS )
         : TimesaleSubscriptionBaseImpl( StreamerServiceType::TIMESALE_FUTURES,
-                                        command, symbols, fields )
+                                        command, std::move(symbols), fields )
     {}
 };
 
@@ -850,11 +1076,11 @@ public:
     static const int TYPE_ID_LOW = TYPE_ID_SUB_TIMESALE_OPTIONS;
     static const int TYPE_ID_HIGH = TYPE_ID_SUB_TIMESALE_OPTIONS;
 
-    TimesaleOptionsSubscriptionImpl( const set<string>& symbols,
-                                     const set<FieldType>& fields,
+    TimesaleOptionsSubscriptionImpl( vector<string> symbols,
+                                     const FieldSet<FieldType>& fields,
                                      CommandType command = CommandType::SUBS )
         : TimesaleSubscriptionBaseImpl( StreamerServiceType::TIMESALE_OPTIONS,
-                                        command, symbols, fields)
+                                        command, std::move(symbols), fields)
     {}
 };
 
@@ -892,7 +1118,10 @@ public:
     typedef ActivesSubscriptionBase ProxyType;
     static const int TYPE_ID_LOW = TYPE_ID_SUB_ACTIVES_NASDAQ;
     static const int TYPE_ID_HIGH = TYPE_ID_SUB_ACTIVES_OPTION;
-    static function<bool(int)> is_valid_duration;
+
+    static bool
+    is_valid_duration(int d)
+    { return DurationType_is_valid(d); }
 
     DurationType
     get_duration() const
@@ -912,6 +1141,14 @@ public:
             && sub._venue == _venue && sub._duration == _duration;
     }
 
+    size_t
+    hash() const
+    {
+        size_t h = util::hash_combine( ManagedSubscriptionImpl::hash(),
+                                       std::hash<string>()(_venue) );
+        return util::hash_combine( h, static_cast<size_t>(_duration) );
+    }
+
 };
 
 
@@ -966,7 +1203,10 @@ public:
     typedef OptionActivesSubscription ProxyType;
     static const int TYPE_ID_LOW = TYPE_ID_SUB_ACTIVES_OPTION;
     static const int TYPE_ID_HIGH = TYPE_ID_SUB_ACTIVES_OPTION;
-    static function<bool(int)> is_valid_venue;
+
+    static bool
+    is_valid_venue(int v)
+    { return VenueType_is_valid(v); }
 
     OptionActivesSubscriptionImpl( VenueType venue,
                                    DurationType duration,
@@ -1000,39 +1240,6 @@ public:
 };
 
 
-function<bool(int)> QuotesSubscriptionImpl::is_valid_field =
-    QuotesSubscriptionField_is_valid;
-
-function<bool(int)> OptionsSubscriptionImpl::is_valid_field =
-    OptionsSubscriptionField_is_valid;
-
-function<bool(int)> LevelOneFuturesSubscriptionImpl::is_valid_field =
-    LevelOneFuturesSubscriptionField_is_valid;
-
-function<bool(int)> LevelOneForexSubscriptionImpl::is_valid_field =
-    LevelOneForexSubscriptionField_is_valid;
-
-function<bool(int)> LevelOneFuturesOptionsSubscriptionImpl::is_valid_field =
-    LevelOneFuturesOptionsSubscriptionField_is_valid;
-
-function<bool(int)> NewsHeadlineSubscriptionImpl::is_valid_field =
-    NewsHeadlineSubscriptionField_is_valid;
-
-function<bool(int)> ChartEquitySubscriptionImpl::is_valid_field =
-    ChartEquitySubscriptionField_is_valid;
-
-function<bool(int)> ChartSubscriptionBaseImpl::is_valid_field =
-    ChartSubscriptionField_is_valid;
-
-function<bool(int)> TimesaleSubscriptionBaseImpl::is_valid_field =
-    TimesaleSubscriptionField_is_valid;
-
-function<bool(int)> ActivesSubscriptionBaseImpl::is_valid_duration =
-    DurationType_is_valid;
-
-function<bool(int)> OptionActivesSubscriptionImpl::is_valid_venue =
-    VenueType_is_valid;
-
 StreamingSubscriptionImpl*
 C_sub_ptr_to_impl_ptr(StreamingSubscription_C *psub)
 {
@@ -1138,29 +1345,28 @@ create_symbol_field_subscription( const char **symbols,
                                 allow_exceptions, psub );
     }
     
-    auto s_symbols = util::buffers_to_set<string>(symbols, nsymbols);
-
-    //TODO combine with buffers_to_set
+    FieldSet<typename ImplTy::FieldType> f_fields;
     for(size_t i = 0; i < nfields; ++i){
         if( !ImplTy::is_valid_field(fields[i]) ){
             return HANDLE_ERROR_EX( ValueException, "invalid FieldType value",
                                     allow_exceptions, psub );
         }
+        f_fields.insert( static_cast<typename ImplTy::FieldType>(fields[i]) );
     }
 
-    auto s_fields = util::buffers_to_set<typename ImplTy::FieldType>(
-        fields, nfields
-        );
+    auto v_symbols = util::buffers_to_vector(symbols, nsymbols);
 
-    static auto meth = +[]( const set<string>& symbols,
-                            const set<typename ImplTy::FieldType>& fields,
+    // by pointer, CallImplFromABI copies its args
+    static auto meth = +[]( vector<string> *symbols,
+                            const FieldSet<typename ImplTy::FieldType> *fields,
                             int cmd){
-        return new ImplTy( symbols, fields, static_cast<CommandType>(cmd) );
+        return new ImplTy( std::move(*symbols), *fields,
+                           static_cast<CommandType>(cmd) );
     };
 
     ImplTy *obj;
-    tie(obj, err) = CallImplFromABI( allow_exceptions, meth, s_symbols,
-                                     s_fields, command);
+    tie(obj, err) = CallImplFromABI( allow_exceptions, meth, &v_symbols,
+                                     &f_fields, command);
     if( err ){
         kill_proxy(psub);
         return err;
@@ -1222,15 +1428,15 @@ get_fields( typename ImplTy::ProxyType::CType *psub,
         return err;
 
     static auto meth = +[]( void *obj ){
-        return reinterpret_cast<ImplTy*>(obj)->get_fields();
+        return &(reinterpret_cast<ImplTy*>(obj)->get_field_set());
     };
 
-    set<typename ImplTy::FieldType> f;
+    const FieldSet<typename ImplTy::FieldType> *f;
     tie(f, err) = CallImplFromABI( allow_exceptions, meth, psub->obj);
     if( err )
         return err;
 
-    *n = f.size();
+    *n = f->size();
     if( *n == 0 ){
         *fields = nullptr;
         return 0;
@@ -1241,8 +1447,9 @@ get_fields( typename ImplTy::ProxyType::CType *psub,
         return err;
 
     int i = 0;
-    for(auto& ff : f)
+    f->for_each( [&](typename ImplTy::FieldType ff){
         (*fields)[i++] = static_cast<int>(ff);
+    } );
 
     return 0;
 }
@@ -1266,98 +1473,34 @@ set_fields( typename ImplTy::ProxyType::CType *psub,
                                 allow_exceptions, psub );
     }
 
+    FieldSet<typename ImplTy::FieldType> f;
     for(size_t i = 0; i < n; ++i){
         if( !ImplTy::is_valid_field(fields[i]) ){
             return HANDLE_ERROR_EX( ValueException, "invalid FieldType value",
                                     allow_exceptions, psub );
         }
+        f.insert( static_cast<typename ImplTy::FieldType>(fields[i]) );
     }
 
-    auto f = util::buffers_to_set<typename ImplTy::FieldType>(fields, n);
-
-    static auto meth = +[]( void *obj, const set<typename ImplTy::FieldType>& f ){
-        reinterpret_cast<ImplTy*>(obj)->set_fields(f);
-    };
-
-   return CallImplFromABI( allow_exceptions, meth, psub->obj, f);
-}
-
-
-template<typename ImplTy>
-std::pair<void*, int>
-copy_construct_impl( ImplTy *from,
-                    int allow_exceptions,
-                 typename std::enable_if<
-                    std::is_base_of<SubscriptionBySymbolBaseImpl,
-                                    ImplTy>::value>::type *_ = nullptr)
-{
-    static auto meth = +[]( const set<string>& symbols,
-                            const set<typename ImplTy::FieldType>& fields,
-                            CommandType cmd){
-        return reinterpret_cast<void*>( new ImplTy(symbols, fields, cmd) );
-    };
-
-    return CallImplFromABI( allow_exceptions, meth, from->get_symbols(),
-                            from->get_fields(), from->get_command() );
-}
-
-template<typename ImplTy> //excludes OptionActivesSubscriptionImpl
-std::pair<void*, int>
-copy_construct_impl( ImplTy *from,
-                     int allow_exceptions,
-                 typename std::enable_if<
-                    std::is_base_of<ActivesSubscriptionBaseImpl, ImplTy>::value
-                    && !std::is_same<ImplTy, OptionActivesSubscriptionImpl>::value
-                        >::type *_ = nullptr)
-{
-    static auto meth = +[]( DurationType d, CommandType cmd){
-        return reinterpret_cast<void*>( new ImplTy( d, cmd ) );
-    };
-
-    return CallImplFromABI( allow_exceptions, meth, from->get_duration(),
-                            from->get_command() );
-}
-
-template<typename ImplTy>
-std::pair<void*, int>
-copy_construct_impl( OptionActivesSubscriptionImpl *from, int allow_exceptions )
-{
-    static auto meth = +[]( VenueType v, DurationType d, CommandType cmd ){
-        return reinterpret_cast<void*>(
-            new OptionActivesSubscriptionImpl( v, d, cmd)
-        );
-    };
-
-    return CallImplFromABI( allow_exceptions, meth, from->get_venue(),
-                            from->get_duration(), from->get_command() );
-}
-
-template<typename ImplTy>
-std::pair<void*, int>
-copy_construct_impl( RawSubscriptionImpl *from, int allow_exceptions )
-{
-    static auto meth = +[]( const std::string& service,
-                            const std::string& command,
-                            const std::map<std::string, std::string>& params){
-        return reinterpret_cast<void*>(
-            new RawSubscriptionImpl( service, command, params )
-        );
+    static auto meth = +[]( void *obj,
+                            const FieldSet<typename ImplTy::FieldType> *f ){
+        reinterpret_cast<ImplTy*>(obj)->set_fields(*f);
     };
 
-    return CallImplFromABI( allow_exceptions, meth, from->get_service_str(),
-                            from->get_command_str(), from->get_parameters() );
+   return CallImplFromABI( allow_exceptions, meth, psub->obj, &f);
 }
 
 
+// a valid Impl copies to a valid Impl, no need to re-check/re-build it
 template<typename ImplTy>
 std::pair<void*, int>
-copy_construct_impl( AcctActivitySubscriptionImpl *from, int allow_exceptions )
+copy_construct_impl( ImplTy *from, int allow_exceptions )
 {
-    static auto meth = +[]( CommandType cmd ){
-        return reinterpret_cast<void*>( new AcctActivitySubscriptionImpl(cmd) );
+    static auto meth = +[]( const ImplTy *from ){
+        return reinterpret_cast<void*>( new ImplTy(*from) );
     };
 
-    return CallImplFromABI( allow_exceptions, meth,  from->get_command() );
+    return CallImplFromABI( allow_exceptions, meth, from );
 }
 
 
@@ -1611,6 +1754,7 @@ StreamingSubscription_Copy_ABI( StreamingSubscription_C *from,
                                 StreamingSubscription_C * to,
                                 int allow_exceptions )
 {
+    CHECK_PTR(from, "from subscription", allow_exceptions);
     return copy_construct_generic(from, to, allow_exceptions);
 }
 
@@ -1639,6 +1783,28 @@ StreamingSubscription_IsSame_ABI( StreamingSubscription_C *l,
 }
 
 
+int
+StreamingSubscription_Hash_ABI( StreamingSubscription_C *psub,
+                                size_t *hash,
+                                int allow_exceptions )
+{
+    int err = proxy_is_callable<StreamingSubscriptionImpl>(
+        psub, allow_exceptions
+        );
+    if( err )
+        return err;
+
+    CHECK_PTR(hash, "hash", allow_exceptions);
+
+    static auto meth = +[]( StreamingSubscription_C *obj ){
+        return C_sub_ptr_to_impl_ptr(obj)->hash();
+    };
+
+    tie(*hash, err) = CallImplFromABI( allow_exceptions, meth, psub );
+    return err;
+}
+
+
 int
 StreamingSubscription_GetService_ABI( StreamingSubscription_C *psub,
                                       int *service,
@@ -1703,16 +1869,16 @@ SubscriptionBySymbolBase_GetSymbols_ABI( StreamingSubscription_C *psub,
     CHECK_PTR(n, "n", allow_exceptions);
 
     static auto meth = +[]( void *obj ){
-        return reinterpret_cast<SubscriptionBySymbolBaseImpl*>(obj)
-            ->get_symbols();
+        return &(reinterpret_cast<SubscriptionBySymbolBaseImpl*>(obj)
+            ->get_symbols());
     };
 
-    set<string> strs;
+    const vector<string> *strs;
     tie(strs,err) = CallImplFromABI(allow_exceptions, meth, psub->obj);
     if( err )
        return err;
 
-    return to_new_char_buffers(strs, buffers, n, allow_exceptions);
+    return to_new_char_buffers(*strs, buffers, n, allow_exceptions);
 }
 
 
@@ -1824,13 +1990,14 @@ SubscriptionBySymbolBase_SetSymbols_ABI( StreamingSubscription_C *psub,
 
     assert( (buffers != nullptr) || (n == 0) );
 
-    auto symbols = util::buffers_to_set<string>(buffers, n);
+    auto symbols = util::buffers_to_vector(buffers, n);
 
-    static auto meth = +[]( void *obj, set<string>& s ){
-        reinterpret_cast<SubscriptionBySymbolBaseImpl*>(obj)->set_symbols(s);
+    static auto meth = +[]( void *obj, vector<string> *s ){
+        reinterpret_cast<SubscriptionBySymbolBaseImpl*>(obj)
+            ->set_symbols( std::move(*s) );
     };
 
-    return CallImplFromABI(allow_exceptions, meth, psub->obj, symbols);
+    return CallImplFromABI(allow_exceptions, meth, psub->obj, &symbols);
 }
 
 
@@ -2415,3 +2582,47 @@ RawSubscription_SetParameters_ABI( RawSubscription_C *psub,
 }
 
 
+
+
+namespace tdma{
+
+/* TDMA_API_DIRECT_LINKAGE: the C++ proxy always holds a valid object */
+namespace {
+
+template<typename ImplTy>
+inline ImplTy*
+direct_impl(StreamingSubscription_C *psub)
+{
+    assert( psub && psub->obj );
+    return reinterpret_cast<ImplTy*>(psub->obj);
+}
+
+} /* namespace */
+
+StreamerServiceType
+StreamingSubscription_GetService_Direct(StreamingSubscription_C *psub)
+{ return direct_impl<ManagedSubscriptionImpl>(psub)->get_service(); }
+
+CommandType
+StreamingSubscription_GetCommand_Direct(StreamingSubscription_C *psub)
+{ return direct_impl<ManagedSubscriptionImpl>(psub)->get_command(); }
+
+set<string>
+SubscriptionBySymbolBase_GetSymbols_Direct(StreamingSubscription_C *psub)
+{
+    auto& symbols = direct_impl<SubscriptionBySymbolBaseImpl>(psub)
+        ->get_symbols();
+    // already sorted
+    return set<string>(symbols.begin(), symbols.end());
+}
+
+void
+SubscriptionBySymbolBase_SetSymbols_Direct( StreamingSubscription_C *psub,
+                                            const set<string>& symbols )
+{
+    direct_impl<SubscriptionBySymbolBaseImpl>(psub)->set_symbols(
+        vector<string>(symbols.begin(), symbols.end())
+        );
+}
+
+} /* tdma */
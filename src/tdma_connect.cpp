@@ -20,10 +20,15 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 #include <regex>
 #include <cctype>
 #include <mutex>
+#include <memory>
+#include <unordered_map>
 #include <string.h>
 
 #include "../include/_tdma_api.h"
 #include "../include/curl_connect.h"
+#include "../include/_token_store.h"
+#include "../include/_json_parse.h"
+#include "../include/_probes.h"
 
 using std::string;
 using std::vector;
@@ -52,6 +57,66 @@ error_msg_about_token_expiration(const string& msg)
         && std::regex_search(msg, EXPIRE_RX);
 }
 
+/*
+ * access tokens cached by client_id (see connect()); getters of different
+ * rate domains connect concurrently
+ */
+struct CachedToken{
+    string token; // guarded by token_cache_mtx
+    std::mutex refresh_mtx; // one refresh at a time per client_id
+};
+
+std::mutex token_cache_mtx;
+std::unordered_map<string, std::unique_ptr<CachedToken>> token_cache;
+
+CachedToken&
+cached_token_entry(const string& client_id, const string& access_token)
+{
+    std::lock_guard<std::mutex> _(token_cache_mtx);
+    auto& e = token_cache[client_id];
+    if( !e ){
+        e.reset( new CachedToken );
+        e->token = access_token;
+    }
+    return *e;
+}
+
+string
+load_cached_token(const CachedToken& cached)
+{
+    std::lock_guard<std::mutex> _(token_cache_mtx);
+    return cached.token;
+}
+
+void
+store_cached_token(CachedToken& cached, const string& token)
+{
+    std::lock_guard<std::mutex> _(token_cache_mtx);
+    cached.token = token;
+}
+
+/* endpoint of a request url, for the request_* probes */
+const char*
+url_class(const string& url)
+{
+    /* most specific first: e.g '/accounts/{id}/orders' */
+    static const char* CLASSES[] = {
+        "pricehistory", "chains", "quotes", "hours", "movers", "instruments",
+        "transactions", "savedorders", "orders", "preferences",
+        "streamersubscriptionkeys", "userprincipals", "accounts", "token"
+    };
+
+    size_t end = url.find('?');
+    if( end == string::npos )
+        end = url.size();
+    for( const char* c : CLASSES ){
+        size_t pos = url.rfind(c, end);
+        if( pos != string::npos && pos + strlen(c) <= end )
+            return c;
+    }
+    return "other";
+}
+
 } /* namespace */
 
 
@@ -149,12 +214,30 @@ query_api_on_error_callback(long code, const string& data)
 
 tuple<long, string, string, conn::clock_ty::time_point>
 curl_execute(conn::HTTPConnectionInterface& connection, bool return_header_data)
-{   /*
+{
+    string url = connection.get_url();
+    const char *uclass = url_class(url);
+    TDMA_PROBE2(request_start, uclass, url.c_str());
+    flight::record(flight::EventType::request_start, 0, 0, uclass);
+    auto start = std::chrono::steady_clock::now();
+    auto usec_since_start = [&](){
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start ).count();
+    };
+
+    /*
      * Curl exceptions are not exposed publicly so we catch and wrap
      */
     try{
-        return connection.execute(return_header_data);
+        auto r = connection.execute(return_header_data);
+        TDMA_PROBE2(request_end, uclass, std::get<0>(r));
+        flight::record( flight::EventType::request_end, std::get<0>(r),
+                        usec_since_start(), uclass );
+        return r;
     }catch( conn::CurlConnectionError& e ){
+        TDMA_PROBE2(request_end, uclass, 0L);
+        flight::record( flight::EventType::request_end, 0, usec_since_start(),
+                        uclass );
         cerr<< "CurlConnectionError --> ConnectionException" << endl;
         string msg = e.what() + string("(curl code=")
                    + std::to_string(e.code) + ')';
@@ -230,11 +313,21 @@ connect( conn::HTTPConnectionInterface& connection,
      *
      * NOTE - the cached token takes priority to avoid refresh 'thrashing'
      *        between unsynced callers
+     *
+     * 'cached_token' is our copy; the entry is only read/written under
+     * token_cache_mtx
      */
-    static std::unordered_map<string, string> token_cache;
-    string& cached_token = token_cache.insert(
-        {creds.client_id, creds.access_token}
-    ).first->second;
+    CachedToken& cache = cached_token_entry(creds.client_id,
+                                            creds.access_token);
+    string cached_token = load_cached_token(cache);
+
+    /* pick up a token another process refreshed BEFORE it fails on us */
+    string shared_token = SharedTokenStore::peek(creds.client_id);
+    if( !shared_token.empty() && shared_token != cached_token ){
+        cached_token = shared_token;
+        store_cached_token(cache, cached_token);
+        connection.reset_headers();
+    }
 
     /* only add headers if we don't already have them */
     if( !connection.has_headers() ){
@@ -266,20 +359,18 @@ connect( conn::HTTPConnectionInterface& connection,
         auto old_headers = connection.get_headers();
         assert( old_headers.back().first == "Authorization");
 
+        /* another thread may have refreshed it since */
+        cached_token = load_cached_token(cache);
+
         /* first check that header token is same as cached version */
         if( old_headers.back().second != ("Bearer " + cached_token) ){
 
-            /* overwrite the token in creds w/ cached */
-            if( strcmp(creds.access_token, cached_token.c_str()) ){
-                /*
-                 * should only get in here if client is using references
-                 * to different cred structs (not recommended)
-                 */
-                delete[] creds.access_token;
-                creds.access_token = new char[cached_token.size() + 1];
-                creds.access_token[cached_token.size()] = 0;
-                strcpy(creds.access_token, cached_token.c_str());
-            }
+            /*
+             * overwrite the token in creds w/ cached; should only change if
+             * client is using references to different cred structs
+             * (not recommended)
+             */
+            replace_access_token(creds, cached_token);
 
             /* update headers w/ cached */
             connection.reset_headers();
@@ -295,11 +386,24 @@ connect( conn::HTTPConnectionInterface& connection,
                 return make_tuple(r_data, r_head, r_tp);
         }
 
-        cerr<< "access token expired; try to refresh..." << endl;
-        RefreshAccessToken(creds); // updates creds.access_token
-
-        /* update the cache */
-        cached_token = creds.access_token;
+        {
+            std::lock_guard<std::mutex> _(cache.refresh_mtx);
+            string current = load_cached_token(cache);
+            if( current != cached_token ){
+                /* refreshed by another thread while we waited */
+                cached_token = current;
+                replace_access_token(creds, cached_token);
+            }else{
+                cerr<< "access token expired; try to refresh..." << endl;
+                /* the failed token; see SharedTokenStore::refresh */
+                replace_access_token(creds, cached_token);
+                RefreshAccessToken(creds); // updates creds.access_token
+
+                /* update the cache */
+                cached_token = creds.access_token;
+                store_cached_token(cache, cached_token);
+            }
+        }
 
         /* update the header */
         connection.reset_headers();
@@ -384,7 +488,7 @@ connect_auth(conn::HTTPConnectionInterface& connection, std::string fname)
         TDMA_API_THROW(AuthenticationException, e, r_code);
     }
 
-    return json::parse(r_data);
+    return parse_json(r_data);
 }
 
 } /* tdma */
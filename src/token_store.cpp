@@ -0,0 +1,289 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+#include <unordered_map>
+#include <sstream>
+#include <iostream>
+#include <mutex>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif /* _WIN32 */
+
+#include "../include/_tdma_api.h"
+#include "../include/_token_store.h"
+
+using std::string;
+using std::cerr;
+using std::endl;
+using tdma::LocalCredentialException;
+
+namespace {
+
+/* TDMA access tokens are good for 30 min; leave a margin */
+const long long ACCESS_TOKEN_LIFE_SEC = 1800 - 60;
+
+struct StoredToken{
+    long long epoch_sec;
+    string token;
+};
+
+typedef std::unordered_map<string, StoredToken> tokens_ty;
+
+string store_path;
+std::mutex store_mtx;
+
+/* what peek() read last, so unchanged files aren't re-read */
+tokens_ty last_tokens;
+#ifndef _WIN32
+struct stat last_stat;
+#endif /* _WIN32 */
+
+long long
+now_sec()
+{
+    using namespace std::chrono;
+    return duration_cast<seconds>(
+        system_clock::now().time_since_epoch() ).count();
+}
+
+bool
+is_fresh(const StoredToken& t)
+{ return (now_sec() - t.epoch_sec) < ACCESS_TOKEN_LIFE_SEC; }
+
+#ifndef _WIN32
+
+class FileLock{
+    int _fd;
+public:
+    FileLock(const string& path, bool exclusive)
+        :
+            _fd( ::open(path.c_str(), exclusive ? (O_RDWR | O_CREAT) : O_RDONLY,
+                        S_IRUSR | S_IWUSR) )
+        {
+            if( _fd == -1 ){
+                if( !exclusive && errno == ENOENT )
+                    return;
+                TDMA_API_THROW( LocalCredentialException,
+                                "failed to open token store '" + path + "': "
+                                + string(strerror(errno)) );
+            }
+            /* O_CREAT's mode only applies to a new file */
+            struct stat st;
+            if( ::fstat(_fd, &st) == -1
+                || ( (st.st_mode & (S_IRWXG | S_IRWXO))
+                     && ::fchmod(_fd, S_IRUSR | S_IWUSR) == -1 ) )
+            {
+                int e = errno;
+                ::close(_fd);
+                TDMA_API_THROW( LocalCredentialException,
+                                "token store '" + path + "' is group/world "
+                                "accessible and can't be restricted: "
+                                + string(strerror(e)) );
+            }
+            while( ::flock(_fd, exclusive ? LOCK_EX : LOCK_SH) == -1 ){
+                if( errno != EINTR ){
+                    int e = errno;
+                    ::close(_fd);
+                    TDMA_API_THROW( LocalCredentialException,
+                                    "failed to lock token store: "
+                                    + string(strerror(e)) );
+                }
+            }
+        }
+
+    ~FileLock()
+    {
+        if( _fd != -1 ){
+            ::flock(_fd, LOCK_UN);
+            ::close(_fd);
+        }
+    }
+
+    FileLock( const FileLock& ) = delete;
+
+    FileLock&
+    operator=( const FileLock& ) = delete;
+
+    int
+    fd() const
+    { return _fd; }
+};
+
+tokens_ty
+read_tokens(int fd)
+{
+    tokens_ty tokens;
+    string buf;
+    char chunk[4096];
+    ssize_t r;
+    off_t off = 0;
+    while( (r = ::pread(fd, chunk, sizeof(chunk), off)) > 0 ){
+        buf.append(chunk, r);
+        off += r;
+    }
+
+    std::istringstream in(buf);
+    string client_id;
+    StoredToken t;
+    while( in >> client_id >> t.epoch_sec >> t.token )
+        tokens[client_id] = t;
+    return tokens;
+}
+
+void
+write_tokens(int fd, const tokens_ty& tokens)
+{
+    std::ostringstream out;
+    for( auto& t : tokens )
+        out<< t.first << ' ' << t.second.epoch_sec << ' '
+           << t.second.token << '\n';
+    string s = out.str();
+
+    if( ::ftruncate(fd, 0) == -1
+        || ::pwrite(fd, s.data(), s.size(), 0) != static_cast<ssize_t>(s.size()) )
+    {
+        TDMA_API_THROW( LocalCredentialException,
+                        "failed to write token store: "
+                        + string(strerror(errno)) );
+    }
+}
+
+bool
+same_file_state(const struct stat& a, const struct stat& b)
+{
+    return a.st_ino == b.st_ino
+        && a.st_size == b.st_size
+        && a.st_mtim.tv_sec == b.st_mtim.tv_sec
+        && a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+}
+
+#endif /* _WIN32 */
+
+} /* namespace */
+
+
+namespace tdma{
+
+void
+replace_access_token(Credentials& creds, const string& token)
+{
+    if( creds.access_token ){
+        if( token == creds.access_token )
+            return;
+        delete[] creds.access_token;
+    }
+    creds.access_token = new char[token.size() + 1];
+    creds.access_token[token.size()] = 0;
+    strcpy(creds.access_token, token.c_str());
+}
+
+
+void
+SharedTokenStore::set_path(const string& path)
+{
+#ifdef _WIN32
+    if( !path.empty() )
+        TDMA_API_THROW( ValueException, "token store not supported on windows" );
+#endif /* _WIN32 */
+
+    std::lock_guard<std::mutex> _(store_mtx);
+    store_path = path;
+    last_tokens.clear();
+#ifndef _WIN32
+    memset(&last_stat, 0, sizeof(last_stat));
+#endif /* _WIN32 */
+}
+
+
+string
+SharedTokenStore::get_path()
+{
+    std::lock_guard<std::mutex> _(store_mtx);
+    return store_path;
+}
+
+
+string
+SharedTokenStore::peek(const string& client_id)
+{
+#ifndef _WIN32
+    std::lock_guard<std::mutex> _(store_mtx);
+    if( store_path.empty() )
+        return "";
+
+    /* a stat per request; only re-read when another process wrote */
+    struct stat st;
+    if( ::stat(store_path.c_str(), &st) == -1 )
+        return "";
+
+    if( !same_file_state(st, last_stat) ){
+        FileLock lock(store_path, false);
+        if( lock.fd() == -1 )
+            return "";
+        last_tokens = read_tokens( lock.fd() );
+        last_stat = st;
+    }
+
+    auto t = last_tokens.find(client_id);
+    if( t != last_tokens.end() && is_fresh(t->second) )
+        return t->second.token;
+#endif /* _WIN32 */
+    return "";
+}
+
+
+void
+SharedTokenStore::refresh( Credentials& creds,
+                           const string& failed_token,
+                           void(*refresh_from_server)(Credentials*) )
+{
+    string path = get_path();
+    if( path.empty() ){
+        refresh_from_server(&creds);
+        return;
+    }
+
+#ifndef _WIN32
+    /* other processes block here until we've stored the new token */
+    FileLock lock(path, true);
+
+    tokens_ty tokens = read_tokens( lock.fd() );
+    auto t = tokens.find(creds.client_id);
+    if( t != tokens.end()
+        && is_fresh(t->second)
+        && t->second.token != failed_token )
+    {
+        cerr<< "use access token refreshed by another process" << endl;
+        replace_access_token(creds, t->second.token);
+        return;
+    }
+
+    refresh_from_server(&creds);
+
+    tokens[creds.client_id] = StoredToken{now_sec(), creds.access_token};
+    write_tokens( lock.fd(), tokens );
+#endif /* _WIN32 */
+}
+
+} /* tdma */
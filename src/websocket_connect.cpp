@@ -16,8 +16,14 @@ along with this program.  If not, see http://www.gnu.org/licenses.
 */
 
 #include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <climits>
 
 #include "../include/websocket_connect.h"
+#include "../include/_probes.h"
+#include "../include/_flight_recorder.h"
+#include "../include/_executor.h"
 
 using std::string;
 using std::vector;
@@ -34,10 +40,16 @@ D(string msg, WebSocketClient *obj)
 
 WebSocketClient *WebSocketClient::Callbacks::wsc = nullptr;
 
-WebSocketClient::WebSocketClient(string url)
+namespace {
+/* (external loop) max wait for a graceful, then an immediate, close */
+const milliseconds CLOSE_TIMEOUT(1000);
+}
+
+WebSocketClient::WebSocketClient(string url, bool external_loop)
     :
         _hub(),
         _url(url),
+        _external_loop(external_loop),
         _signal(new uS::Async(_hub.getLoop())),
         _thread(),
         _in_queue(),
@@ -55,6 +67,12 @@ WebSocketClient::WebSocketClient(string url)
         _hub.onMessage( Callbacks::on_message );
         _signal->start( Callbacks::on_signal );
         _signal->setData( reinterpret_cast<void*>(this) );
+#ifndef USE_EPOLL
+        if( _external_loop ){
+            throw std::logic_error("external loop mode requires the "
+                                   "epoll backend");
+        }
+#endif /* USE_EPOLL */
         D("construct", this);
     }
 
@@ -66,10 +84,31 @@ WebSocketClient::~WebSocketClient()
 }
 
 
+void
+WebSocketClient::set_use_io_uring(bool use_io_uring)
+{
+#ifdef USE_EPOLL
+    uS::preferIoUring = use_io_uring;
+#endif /* USE_EPOLL */
+}
+
+
+bool
+WebSocketClient::uses_io_uring()
+{
+#ifdef USE_EPOLL
+    return uS::preferIoUring && uS::IoUring::available();
+#else
+    return false;
+#endif /* USE_EPOLL */
+}
+
+
 void
 WebSocketClient::Callbacks::on_connect( uws_client_ty *ws, uWS::HttpRequest r)
 {
     D("on_connect", wsc);
+    tdma::flight::record(tdma::flight::EventType::ws_connect);
 
     assert(wsc);
     wsc->_ws = ws;
@@ -88,6 +127,8 @@ WebSocketClient::Callbacks::on_disconnect( uws_client_ty *ws,
                                            size_t msg_len )
 {
     D("on_disconnect", wsc);
+    tdma::flight::record( tdma::flight::EventType::ws_disconnect, code, 0,
+                          string(msg ? msg : "", msg ? msg_len : 0).c_str() );
 
     assert(wsc);
     wsc->_ws = nullptr;
@@ -101,6 +142,7 @@ void
 WebSocketClient::Callbacks::on_error(void *v)
 {
     D("on_error", wsc);
+    tdma::flight::record(tdma::flight::EventType::ws_error);
 
     assert(wsc);
     wsc->_ws = nullptr;
@@ -122,6 +164,9 @@ WebSocketClient::Callbacks::on_message( uws_client_ty *ws,
                                         uWS::OpCode op )
 {
     D("on_message", wsc);
+    TDMA_PROBE2(ws_frame, msg_len, static_cast<int>(op));
+    tdma::flight::record( tdma::flight::EventType::ws_frame, msg_len,
+                          static_cast<int>(op) );
 
     assert(wsc);
     string msg_s(msg, msg_len);
@@ -169,8 +214,19 @@ WebSocketClient::connect(milliseconds timeout)
     if( _ws || _closing_state != CloseType::none )
         return;
 
+    if( _external_loop ){
+        D("connect, external loop", this);
+        _hub.connect(_url, nullptr, {}, timeout.count());
+        /* the socket handles the timeout; this is just a backstop */
+        _run_loop_until( timeout + CLOSE_TIMEOUT,
+                         [this]{ return _init_flag; } );
+        return;
+    }
+
     D("connect, move new _thread", this);
-    _thread = std::move( std::thread( SocketThreadTarget(this, timeout) ) );
+    _thread = tdma::Executor::instance().spawn_io(
+        "tdma-ws", SocketThreadTarget(this, timeout)
+        );
 
     D("connect, wait for callback notify", this);
     /*
@@ -199,6 +255,28 @@ void
 WebSocketClient::close(bool graceful)
 {
     D("close", this);
+    if( _external_loop ){
+        if( is_connected() ){
+            _closing_state = graceful ? CloseType::graceful
+                                      : CloseType::immediate;
+            if( graceful )
+                _ws->close();
+            else
+                _ws->terminate();
+        }
+        if( _init_flag ){
+            /* like the socket thread, done once the loop has nothing left */
+            auto closed = [this]{ return !_hub.getLoop()->numPolls; };
+            _run_loop_until( CLOSE_TIMEOUT, closed );
+            if( _ws ){
+                D("close, _ws->terminate (timed out)", this);
+                _ws->terminate();
+                _run_loop_until( CLOSE_TIMEOUT, closed );
+            }
+        }
+        return;
+    }
+
     if( is_connected() ){
         _closing_state = graceful ? CloseType::graceful : CloseType::immediate;
         D("close, _signal->send", this);
@@ -217,6 +295,13 @@ void
 WebSocketClient::send(string msg)
 {
     if( is_connected() ){
+        if( _external_loop ){
+            D("send, _ws->send: " + msg, this);
+            _ws->send(msg.c_str(), msg.size(), uWS::OpCode::TEXT);
+            /* io_uring: a blocked write re-arms the poll, submit it now */
+            _hub.getLoop()->flush();
+            return;
+        }
         _out_queue.emplace(msg);
         D("send, _signal->send: " + msg, this);
         _signal->send();
@@ -235,6 +320,12 @@ WebSocketClient::recv()
 string
 WebSocketClient::recv_or_wait()
 {
+    if( _external_loop ){
+        while( _in_queue.empty() && process_events(milliseconds::max()) )
+            {}
+        auto p = _in_queue.pop_front_safe();
+        return p.second ? p.first : "";
+    }
     return _in_queue.pop_front_or_wait();
 }
 
@@ -242,6 +333,10 @@ WebSocketClient::recv_or_wait()
 string
 WebSocketClient::recv_or_wait_for(milliseconds timeout)
 {
+    if( _external_loop ){
+        _run_loop_until( timeout, [this]{ return !_in_queue.empty(); } );
+        timeout = milliseconds(0);
+    }
     auto p = _in_queue.pop_front_or_wait_for(timeout);
     return p.second ? p.first : "";
 }
@@ -309,6 +404,12 @@ WebSocketClient::recv_atmost_n(size_t n)
 vector<string>
 WebSocketClient::recv_n_or_wait(size_t n)
 {
+    if( _external_loop ){
+        while( _in_queue.size() < n && process_events(milliseconds::max()) )
+            {}
+        return recv_atmost_n(n);
+    }
+
     vector<string> ret;
     while( ret.size() < n ){
         auto p = _in_queue.pop_front_or_wait();
@@ -323,6 +424,11 @@ WebSocketClient::recv_n_or_wait_for(size_t n, milliseconds timeout)
 {
     using namespace std::chrono;
 
+    if( _external_loop ){
+        _run_loop_until( timeout, [=]{ return _in_queue.size() >= n; } );
+        return recv_atmost_n(n);
+    }
+
     vector<string> ret;
     auto t_beg = steady_clock::now();
     auto t_left = timeout;
@@ -339,4 +445,96 @@ WebSocketClient::recv_n_or_wait_for(size_t n, milliseconds timeout)
     return ret;
 }
 
+
+int
+WebSocketClient::event_fd()
+{
+    assert(_external_loop);
+#ifdef USE_EPOLL
+    /* the loop's epoll (or io_uring) fd: readable when the socket or
+       _signal is */
+    return _hub.getLoop()->getEpollFd();
+#else
+    return -1;
+#endif /* USE_EPOLL */
+}
+
+
+int
+WebSocketClient::poll_events() const
+{
+    assert(_external_loop);
+#ifdef USE_EPOLL
+    return UV_READABLE;
+#else
+    return 0;
+#endif /* USE_EPOLL */
+}
+
+
+long long
+WebSocketClient::next_timeout()
+{
+    using namespace std::chrono;
+
+    assert(_external_loop);
+#ifdef USE_EPOLL
+    /* connect timeouts etc. are uWS timers */
+    uS::Loop *loop = _hub.getLoop();
+    if( loop->timers.empty() )
+        return -1;
+
+    /* round up, uWS fires timers strictly after their time point */
+    auto us = duration_cast<microseconds>(
+        loop->timers[0].timepoint - system_clock::now() ).count();
+    return us > 0 ? (us + 999) / 1000 : 0;
+#else
+    return -1;
+#endif /* USE_EPOLL */
+}
+
+
+bool
+WebSocketClient::process_events(milliseconds wait)
+{
+    assert(_external_loop);
+#ifdef USE_EPOLL
+    uS::Loop *loop = _hub.getLoop();
+    if( !loop->numPolls )
+        return false;
+
+    /* the caller's thread runs the loop now (changes from others are posted) */
+    _hub.setLoopThread();
+
+    long long w = wait.count();
+    long long t = next_timeout();
+    if( t >= 0 && t < w )
+        w = t;
+
+    /* callbacks run here, on this thread */
+    loop->doEpoll( w > INT_MAX ? -1 : static_cast<int>(std::max(w, 0LL)) );
+    /* io_uring: polls are re-armed lazily; the caller is about to wait on
+       event_fd(), so they have to be in the kernel before we return */
+    loop->flush();
+    return loop->numPolls > 0;
+#else
+    return false;
+#endif /* USE_EPOLL */
+}
+
+
+void
+WebSocketClient::_run_loop_until( milliseconds timeout,
+                                  std::function<bool()> pred )
+{
+    using namespace std::chrono;
+
+    auto t_end = steady_clock::now() + timeout;
+    while( !pred() ){
+        auto t_left = duration_cast<milliseconds>(t_end - steady_clock::now());
+        if( t_left.count() <= 0 || !process_events(t_left) )
+            break;
+    }
+}
+
 } /* conn */
@@ -0,0 +1,116 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+/*
+ * direct_linkage_bench - C++ proxy calls through the C ABI vs. direct
+ *
+ * (links the library; build it twice and compare)
+ *
+ *   g++ -std=c++11 -O3 -I../../include direct_linkage_bench.cpp \
+ *       -o abi_bench -L<build dir> -lTDAmeritradeAPI -lpthread
+ *   g++ -std=c++11 -O3 -DTDMA_API_DIRECT_LINKAGE -I../../include \
+ *       direct_linkage_bench.cpp -o direct_bench -L<build dir> \
+ *       -lTDAmeritradeAPI -lpthread
+ *   ./abi_bench [niters [nsymbols]]; ./direct_bench [niters [nsymbols]]
+ *
+ * Reports usec per call of the getter's get() (an OrderGetter on a paper
+ * account, so no network), get_timeout()/is_closed(), and a
+ * QuotesSubscription's get_service(), get_symbols() and set_symbols().
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <set>
+#include <cstdlib>
+#include <string.h>
+
+#include "../../include/tdma_api_get.h"
+#include "../../include/tdma_api_streaming.h"
+#include "../../include/tdma_api_execute.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace tdma;
+
+namespace {
+
+size_t sink = 0;
+
+template<typename F>
+void
+report(const string& name, size_t niters, F f)
+{
+    auto beg = steady_clock::now();
+    for( size_t i = 0; i < niters; ++i )
+        f();
+    duration<double> d = steady_clock::now() - beg;
+    cout << setw(24) << name << setw(14) << fixed << setprecision(4)
+         << d.count() * 1e6 / niters << endl;
+}
+
+} /* namespace */
+
+
+int
+main(int argc, char* argv[])
+{
+    size_t niters = argc > 1 ? strtoul(argv[1], nullptr, 10) : 100000;
+    int nsymbols = argc > 2 ? atoi(argv[2]) : 50;
+
+#ifdef TDMA_API_DIRECT_LINKAGE
+    cout << "direct linkage (usec/call)" << endl;
+#else
+    cout << "C ABI (usec/call)" << endl;
+#endif
+
+    /* the getters only need the fields to be set; freed by Credentials */
+    Credentials creds{};
+    creds.access_token = strdup("x");
+    creds.refresh_token = strdup("x");
+    creds.client_id = strdup("x");
+
+    Execute_PaperAddAccount("BENCH");
+    Execute_PaperSetLiveQuotes(false);
+    Execute_PaperSetQuote("SPY", 99.99, 100.01, 1000, 1000, 1);
+    string id = Execute_SendOrder(
+        creds, "BENCH", SimpleOrderBuilder::Equity::Build("SPY", 10, true, true)
+        );
+
+    OrderGetter getter(creds, "BENCH", id);
+    report("get()", niters / 10, [&](){ sink += getter.get().size(); });
+    report("get_timeout()", niters,
+           [&](){ sink += getter.get_timeout().count(); });
+    report("is_closed()", niters, [&](){ sink += getter.is_closed(); });
+
+    set<string> symbols;
+    for( int i = 0; i < nsymbols; ++i )
+        symbols.insert( "SYM" + to_string(i) );
+    QuotesSubscription sub(symbols, {QuotesSubscriptionField::bid_price,
+                                     QuotesSubscriptionField::ask_price});
+
+    report("get_service()", niters,
+           [&](){ sink += static_cast<int>(sub.get_service()); });
+    report("get_symbols()", niters / 10,
+           [&](){ sink += sub.get_symbols().size(); });
+    report("set_symbols()", niters / 10, [&](){ sub.set_symbols(symbols); });
+
+    Execute_PaperRemoveAccount("BENCH");
+    return sink == 0;
+}
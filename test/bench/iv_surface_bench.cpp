@@ -0,0 +1,233 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+/*
+ * iv_surface_bench - cost of keeping the IV surface up to date and querying it
+ *
+ * (links the library)
+ *
+ *   g++ -std=c++11 -O3 -I../../include iv_surface_bench.cpp \
+ *       -o iv_surface_bench -L<build dir> -lTDAmeritradeAPI -lpthread
+ *   ./iv_surface_bench [nexpirations [nstrikes]]
+ *
+ * Seeds a synthetic chain (weekly expirations, strikes spread evenly from
+ * 50 to 150, calls and puts) and checks the fit reproduces it at the nodes. Then feeds OPTION
+ * messages of 10 vol updates and reports usec per message w/ no refit cap
+ * and the default one, and usec per vol/greeks query.
+ *
+ * While a reader thread queries, the writer moves every vol of the first
+ * expiration to the same level in each message; a query that saw part of a
+ * refit would land between levels. Last, checks a refit left pending w/o
+ * another message is done by the timer.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <cmath>
+#include <ctime>
+#include <cstdlib>
+
+#include "../../include/_streaming_iv_surface.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace tdma;
+
+namespace {
+
+const double PRICE = 100;
+const int ITEMS_PER_MSG = 10;
+
+double
+smile_vol(int e, double strike)
+{ return 20 + 0.002 * (strike - PRICE) * (strike - PRICE) + e * 0.5; }
+
+double
+strike_at(int i, int nstrikes)
+{ return PRICE / 2 + i * PRICE / nstrikes; }
+
+string
+option_symbol(int e, int i, bool call)
+{ return "XYZ_" + to_string(e) + (call ? "C" : "P") + to_string(i); }
+
+/* every vol of the first expiration at 'level' */
+json
+level_msg(int nstrikes, int level)
+{
+    json m = json::array();
+    for( int i = 0; i < nstrikes; ++i ){
+        for( bool call : {true, false} )
+            m.push_back( {{"key", option_symbol(0, i, call)},
+                          {"10", level}} );
+    }
+    return m;
+}
+
+/* days from now to expiration 'e' (they expire at 21:00 UTC) */
+double
+days_to(int e, double now_days)
+{ return floor(now_days) + 7 * (e + 1) + 21.0 / 24 - now_days; }
+
+json
+build_chain(int nexp, int nstrikes, double now_days)
+{
+    json chain = {{"symbol", "XYZ"}, {"underlyingPrice", PRICE},
+                  {"interestRate", 2.0}};
+    for( bool call : {true, false} ){
+        json m = json::object();
+        for( int e = 0; e < nexp; ++e ){
+            time_t t = static_cast<time_t>(
+                (floor(now_days) + 7 * (e + 1)) * 86400 );
+            char buf[32];
+            strftime(buf, sizeof(buf), "%Y-%m-%d", gmtime(&t));
+            string key = string(buf) + ":" + to_string(7 * (e + 1));
+            for( int i = 0; i < nstrikes; ++i ){
+                double k = strike_at(i, nstrikes);
+                m[key][to_string(k)] = json::array({
+                    {{"putCall", call ? "CALL" : "PUT"},
+                     {"symbol", option_symbol(e, i, call)},
+                     {"strikePrice", k},
+                     {"volatility", smile_vol(e, k)}}
+                });
+            }
+        }
+        chain[call ? "callExpDateMap" : "putExpDateMap"] = m;
+    }
+    return chain;
+}
+
+template<typename F>
+double
+time_it(F func)
+{
+    size_t n = 0;
+    auto beg = steady_clock::now();
+    auto end = beg;
+    do{
+        func();
+        ++n;
+        end = steady_clock::now();
+    }while( end - beg < milliseconds(200) );
+    return duration<double, micro>(end - beg).count() / n;
+}
+
+} /* namespace */
+
+
+int
+main(int argc, char* argv[])
+{
+    int nexp = argc > 1 ? atoi(argv[1]) : 8;
+    int nstrikes = argc > 2 ? atoi(argv[2]) : 100;
+    double now = duration<double>(
+        system_clock::now().time_since_epoch() ).count() / 86400;
+
+    IVSurfaceEngine engine;
+    engine.seed( build_chain(nexp, nstrikes, now) );
+
+    for( int e = 0; e < nexp; ++e ){
+        for( int i = 0; i < nstrikes; i += 7 ){
+            double k = strike_at(i, nstrikes);
+            double v = engine.get_vol("XYZ", k, days_to(e, now));
+            if( fabs(v - smile_vol(e, k)) > 1e-6 ){
+                cerr << "bad fit: exp " << e << " strike " << k << ": "
+                     << v << " != " << smile_vol(e, k) << endl;
+                return 1;
+            }
+        }
+    }
+    cout << nexp << " expirations x " << nstrikes << " strikes" << endl;
+
+    /* prebuilt messages of random vol changes */
+    mt19937 rng(1);
+    uniform_int_distribution<int> exp(0, nexp - 1);
+    uniform_int_distribution<int> strike(0, nstrikes - 1);
+    uniform_real_distribution<double> vol(10, 60);
+    vector<json> msgs(20000);
+    for( auto& m : msgs ){
+        m = json::array();
+        for( int i = 0; i < ITEMS_PER_MSG; ++i ){
+            m.push_back( {{"key", option_symbol(exp(rng), strike(rng),
+                                                rng() % 2)},
+                          {"10", vol(rng)}} );
+        }
+    }
+
+    for( long msec : {0L, static_cast<long>(
+                              IVSurfaceEngine::DEF_REFIT_INTERVAL.count())} )
+    {
+        engine.set_refit_interval( milliseconds(msec) );
+        auto beg = steady_clock::now();
+        for( auto& m : msgs )
+            engine.update(StreamerServiceType::OPTION, m);
+        double usec = duration<double, micro>(steady_clock::now() - beg).count();
+        cout << setw(24) << ("update (refit " + to_string(msec) + "ms)")
+             << fixed << setprecision(3) << setw(10) << usec / msgs.size()
+             << endl;
+    }
+    engine.refit();
+
+    double sink = 0;
+    cout << setw(24) << "get_vol" << setw(10) << time_it([&]{
+        sink += engine.get_vol("XYZ", PRICE - 2.7, days_to(nexp / 2, now) - 2);
+    }) << endl;
+    cout << setw(24) << "get_greeks" << setw(10) << time_it([&]{
+        sink += engine.get_greeks("XYZ", PRICE - 2.7, days_to(nexp / 2, now) - 2,
+                                  true).delta;
+    }) << endl;
+
+    /* consistency under a concurrent reader */
+    engine.set_refit_interval( milliseconds(0) );
+    engine.update(StreamerServiceType::OPTION, level_msg(nstrikes, 20));
+    atomic<bool> done(false);
+    atomic<size_t> nreads(0), nbad(0);
+    thread reader([&]{
+        while( !done ){
+            double v = engine.get_vol("XYZ", 100.5, days_to(0, now) / 2);
+            if( fabs(v - round(v)) > 1e-9 )
+                ++nbad;
+            ++nreads;
+        }
+    });
+    for( int level = 0; level < 20000; ++level )
+        engine.update(StreamerServiceType::OPTION,
+                      level_msg(nstrikes, 20 + level % 30));
+    done = true;
+    reader.join();
+    cout << setw(24) << "concurrent reads" << setw(10) << nreads
+         << " (" << nbad << " inconsistent)" << endl;
+
+    /* a pending refit w/o another message is done by the timer */
+    engine.set_refit_interval( milliseconds(100) );
+    engine.refit();
+    engine.update(StreamerServiceType::OPTION, level_msg(nstrikes, 7));
+    this_thread::sleep_for( milliseconds(300) );
+    bool timer_ok = fabs(engine.get_vol("XYZ", 100.5, days_to(0, now) / 2)
+                         - 7) < 1e-9;
+    cout << setw(24) << "timer refit" << setw(10)
+         << (timer_ok ? "OK" : "FAILED") << endl;
+
+    if( sink == 42 )
+        cout << endl;
+    return (nbad || !timer_ok) ? 1 : 0;
+}
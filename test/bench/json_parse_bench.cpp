@@ -0,0 +1,170 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+/*
+ * json_parse_bench - compare tdma::parse_json backends w/ json::parse
+ *
+ * (header-only, no need to link the library)
+ *
+ *   g++ -std=c++11 -O3 -I../../include json_parse_bench.cpp -o json_parse_bench
+ *   ./json_parse_bench [payload.json ...]
+ *
+ * Defaults to the captured payloads in ./payloads. Each result is checked
+ * against json::parse (values AND number types) before it's timed.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstring>
+
+#include "../../include/tdma_common.h"
+#include "../../include/_json_parse.h"
+
+using namespace std;
+using namespace tdma;
+
+namespace {
+
+const vector<string> DEF_PAYLOADS = {
+    "payloads/stream_heartbeat.json",
+    "payloads/stream_quote.json",
+    "payloads/stream_chart_equity.json",
+    "payloads/stream_timesale.json",
+    "payloads/get_price_history.json",
+    "payloads/get_option_chain.json"
+};
+
+const double MIN_SEC = 0.5;
+
+bool
+same(const json& a, const json& b)
+{
+    if( a.type() != b.type() )
+        return false;
+    if( a.is_object() ){
+        if( a.size() != b.size() )
+            return false;
+        for( auto i = a.begin(), j = b.begin(); i != a.end(); ++i, ++j ){
+            if( i.key() != j.key() || !same(*i, *j) )
+                return false;
+        }
+        return true;
+    }
+    if( a.is_array() ){
+        if( a.size() != b.size() )
+            return false;
+        for( size_t i = 0; i < a.size(); ++i ){
+            if( !same(a[i], b[i]) )
+                return false;
+        }
+        return true;
+    }
+    if( a.is_number_float() ){
+        double x = a, y = b;
+        return memcmp(&x, &y, sizeof(double)) == 0;
+    }
+    return a == b;
+}
+
+/* nsec per parse */
+template<typename F>
+double
+time_it(F f)
+{
+    using namespace std::chrono;
+    size_t n = 0;
+    auto beg = steady_clock::now();
+    duration<double> elapsed;
+    do{
+        for( int i = 0; i < 16; ++i, ++n )
+            f();
+        elapsed = steady_clock::now() - beg;
+    }while( elapsed.count() < MIN_SEC );
+    return elapsed.count() * 1e9 / n;
+}
+
+string
+backend_name(JsonIndexBackend b)
+{
+    switch(b){
+    case JsonIndexBackend::scalar: return "scalar";
+    case JsonIndexBackend::sse42: return "sse4.2";
+    case JsonIndexBackend::avx2: return "avx2";
+    }
+    return "?";
+}
+
+} /* namespace */
+
+
+int
+main(int argc, char* argv[])
+{
+    vector<string> paths(argv + 1, argv + argc);
+    if( paths.empty() )
+        paths = DEF_PAYLOADS;
+
+    vector<JsonIndexBackend> backends = {
+        JsonIndexBackend::scalar, JsonIndexBackend::sse42, JsonIndexBackend::avx2
+    };
+
+    cout<< "best backend: " << backend_name(get_json_index_backend()) << endl;
+
+    bool ok = true;
+    for( auto& path : paths ){
+        ifstream in(path, ios::binary);
+        if( !in ){
+            cerr<< "failed to open " << path << endl;
+            ok = false;
+            continue;
+        }
+        stringstream ss;
+        ss << in.rdbuf();
+        const string payload = ss.str();
+
+        json expected = json::parse(payload);
+        double base_ns = time_it([&](){ json j = json::parse(payload); });
+
+        cout<< endl << path << " (" << payload.size() << " bytes)" << endl
+            << "  " << left << setw(12) << "json::parse" << right << fixed
+            << setprecision(0) << setw(12) << base_ns << " ns "
+            << setprecision(1) << setw(8) << (payload.size() / base_ns * 1e3)
+            << " MB/s" << endl;
+
+        for( auto b : backends ){
+            if( !set_json_index_backend(b) )
+                continue;
+            if( !same(parse_json(payload), expected) ){
+                cerr<< "  " << backend_name(b) << ": MISMATCH" << endl;
+                ok = false;
+                continue;
+            }
+            double ns = time_it([&](){ json j = parse_json(payload); });
+            cout<< "  " << left << setw(12) << backend_name(b) << right
+                << setprecision(0) << setw(12) << ns << " ns "
+                << setprecision(1) << setw(8) << (payload.size() / ns * 1e3)
+                << " MB/s  x" << setprecision(2) << (base_ns / ns) << endl;
+        }
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,203 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+/*
+ * paper_broker_bench - simulated orders per hour through the paper broker
+ *
+ * (links the library)
+ *
+ *   g++ -std=c++11 -O3 -I../../include paper_broker_bench.cpp \
+ *       -o paper_broker_bench -L<build dir> -lTDAmeritradeAPI -lpthread
+ *   ./paper_broker_bench [norders [nsymbols]]
+ *
+ * Replays a random walk of QUOTE messages (one symbol each) over 'nsymbols'
+ * while sending a mix of orders as the OrderTicket serializes them:
+ * market, limit around the quote, stop, and limit w/ an OCO take-profit/
+ * stop-loss triggered on fill. Reports orders sent per second (and hour),
+ * usec per quote message, and how many orders ended up filled.
+ *
+ * Run once w/ the TOUCH fill model and once w/ DISPLAYED_SIZE; the activity
+ * callback is set so events are built, like they would be for a client.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <random>
+#include <cstdlib>
+
+#include "../../include/_paper_broker.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace tdma;
+
+namespace {
+
+const int QUOTES_PER_ORDER = 2;
+
+size_t nevents = 0;
+
+void
+on_activity(unsigned long long, const char* items)
+{ nevents += (items != nullptr); }
+
+json
+leg(const string& symbol, bool buy, int quantity)
+{
+    return {{"instruction", buy ? "BUY" : "SELL"},
+            {"quantity", quantity},
+            {"instrument", {{"assetType", "EQUITY"}, {"symbol", symbol}}}};
+}
+
+json
+order(const string& symbol, bool buy, int quantity, const string& type,
+      double price = 0, double stop = 0)
+{
+    json o = {{"session", "NORMAL"}, {"duration", "DAY"},
+              {"orderType", type}, {"orderStrategyType", "SINGLE"},
+              {"orderLegCollection", json::array({leg(symbol, buy, quantity)})}};
+    if( price )
+        o["price"] = to_string(price);
+    if( stop )
+        o["stopPrice"] = to_string(stop);
+    return o;
+}
+
+json
+bracket(const string& symbol, double px)
+{
+    json o = order(symbol, true, 100, "LIMIT", px);
+    o["orderStrategyType"] = "TRIGGER";
+    o["childOrderStrategies"] = json::array({
+        {{"orderStrategyType", "OCO"},
+         {"childOrderStrategies", json::array({
+             order(symbol, false, 100, "LIMIT", px + 0.5),
+             order(symbol, false, 100, "STOP", 0, px - 0.5)})}}
+    });
+    return o;
+}
+
+} /* namespace */
+
+
+int
+main(int argc, char* argv[])
+{
+    size_t norders = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+    int nsymbols = argc > 2 ? atoi(argv[2]) : 100;
+
+    mt19937 rng(1);
+    uniform_int_distribution<int> sym(0, nsymbols - 1);
+    uniform_real_distribution<double> step(-0.05, 0.05);
+    uniform_int_distribution<int> kind(0, 9);
+    uniform_int_distribution<int> size(1, 20);
+
+    vector<string> symbols;
+    vector<double> mids(nsymbols, 100);
+    for( int i = 0; i < nsymbols; ++i )
+        symbols.push_back( "SYM" + to_string(i) );
+
+    /* prebuilt so only the broker is timed */
+    vector<string> orders;
+    vector<json> quotes;
+    for( size_t i = 0; i < norders; ++i ){
+        int s = sym(rng);
+        double mid = mids[s];
+        bool buy = rng() % 2;
+        switch( kind(rng) ){
+        case 0: case 1: case 2:
+            orders.push_back( order(symbols[s], buy, 100, "MARKET").dump() );
+            break;
+        case 3:
+            orders.push_back( order(symbols[s], buy, 100, "STOP", 0,
+                                    buy ? mid + 0.2 : mid - 0.2).dump() );
+            break;
+        case 4:
+            orders.push_back( bracket(symbols[s], mid - 0.1).dump() );
+            break;
+        default:
+            orders.push_back( order(symbols[s], buy, 100, "LIMIT",
+                                    mid + step(rng) * 4).dump() );
+        }
+        for( int q = 0; q < QUOTES_PER_ORDER; ++q ){
+            int qs = sym(rng);
+            mids[qs] += step(rng);
+            quotes.push_back( json::array({
+                {{"key", symbols[qs]}, {"1", mids[qs] - 0.01},
+                 {"2", mids[qs] + 0.01}, {"4", size(rng) * 100},
+                 {"5", size(rng) * 100}}
+            }) );
+        }
+    }
+
+    PaperBroker& broker = PaperBroker::instance();
+    broker.set_live_quotes(false);
+    broker.set_activity_callback(on_activity);
+
+    int run = 0;
+    for( PaperFillModel model : {PaperFillModel::TOUCH,
+                                 PaperFillModel::DISPLAYED_SIZE} )
+    {
+        string account = "BENCH" + to_string(run++);
+        broker.add_account(account);
+        broker.set_fill_model(account, model);
+        broker.set_latency(account, milliseconds(5));
+
+        /* seed every symbol so orders don't wait on a first quote */
+        unsigned long long ts = 1500000000000ULL;
+        for( int i = 0; i < nsymbols; ++i )
+            broker.set_quote(symbols[i], 99.99, 100.01, 1000, 1000, ts);
+
+        duration<double> send_time(0), quote_time(0);
+        size_t qi = 0;
+        for( auto& o : orders ){
+            auto beg = steady_clock::now();
+            broker.send_order(account, o);
+            auto mid = steady_clock::now();
+            for( int q = 0; q < QUOTES_PER_ORDER; ++q )
+                broker.replay(StreamerServiceType::QUOTE, ++ts, quotes[qi++]);
+            send_time += mid - beg;
+            quote_time += steady_clock::now() - mid;
+        }
+
+        json filled = json::parse( broker.get_orders(
+            account, static_cast<unsigned int>(-1), "", "",
+            OrderStatusType::FILLED) );
+
+        double total = (send_time + quote_time).count();
+        cout << to_string(model) << endl
+             << setw(24) << "orders/sec" << setw(14) << fixed
+             << setprecision(0) << norders / total << endl
+             << setw(24) << "orders/hour" << setw(14)
+             << norders / total * 3600 << endl
+             << setw(24) << "usec/send" << setw(14) << setprecision(3)
+             << send_time.count() * 1e6 / norders << endl
+             << setw(24) << "usec/quote" << setw(14)
+             << quote_time.count() * 1e6 / quotes.size() << endl
+             << setw(24) << "filled (root) orders" << setw(14)
+             << filled.size() << endl
+             << setw(24) << "activity callbacks" << setw(14) << nevents
+             << endl;
+
+        broker.remove_account(account);
+        nevents = 0;
+    }
+    return 0;
+}
@@ -0,0 +1,171 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+/*
+ * router_bench - routing 'data' to per-service/per-symbol handlers
+ *
+ * (links the library)
+ *
+ *   g++ -std=c++11 -O3 -I../../include router_bench.cpp \
+ *       -o router_bench -L<build dir> -lTDAmeritradeAPI -lpthread
+ *   ./router_bench [nmessages [nsymbols [nroutes]]]
+ *
+ * 'nroutes' symbol routes on QUOTE (one symbol each, of 'nsymbols') plus a
+ * service route on OPTION. Messages are QUOTE (5 random symbols each) and
+ * every 10th OPTION. Checks each handler only got its own items and the
+ * rest were left for the catch-all, then reports usec per message for the
+ * C callback and json (direct linkage) handlers.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <set>
+#include <random>
+#include <cstdlib>
+
+#include "../../include/_streaming_router.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace tdma;
+
+namespace {
+
+const int ITEMS_PER_MESSAGE = 5;
+
+int nroutes = 100;
+vector<size_t> ncalls; // by symbol (route)
+size_t nservice_calls = 0;
+size_t nbad = 0;
+
+/* symbol routes are added first, in symbol order: 'SYM<i>' has route i */
+void
+check_items(const json& items)
+{
+    for( auto& item : items ){
+        string key = item["key"];
+        size_t i = stoul( key.substr(3) );
+        if( i >= static_cast<size_t>(nroutes) )
+            ++nbad;
+        else
+            ++ncalls[i];
+    }
+}
+
+void
+on_quote(int, int service, unsigned long long, const char* data)
+{
+    if( service != static_cast<int>(StreamerServiceType::QUOTE) )
+        ++nbad;
+    check_items( json::parse(data) );
+}
+
+void
+on_option(int, int service, unsigned long long, const char*)
+{
+    nservice_calls += (service == static_cast<int>(StreamerServiceType::OPTION));
+}
+
+} /* namespace */
+
+
+int
+main(int argc, char* argv[])
+{
+    size_t nmessages = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+    int nsymbols = argc > 2 ? atoi(argv[2]) : 500;
+    nroutes = argc > 3 ? atoi(argv[3]) : 100;
+    if( nroutes > nsymbols )
+        nroutes = nsymbols;
+
+    mt19937 rng(1);
+    uniform_int_distribution<int> sym(0, nsymbols - 1);
+
+    vector<json> messages;
+    vector<StreamerServiceType> services;
+    size_t nrouted_items = 0, nunrouted_items = 0;
+    for( size_t m = 0; m < nmessages; ++m ){
+        bool option = (m % 10 == 9);
+        json content = json::array();
+        for( int i = 0; i < ITEMS_PER_MESSAGE; ++i ){
+            int s = sym(rng);
+            content.push_back( {{"key", "SYM" + to_string(s)},
+                                {"1", 100.0 + s}, {"2", 100.1 + s}} );
+            if( !option )
+                (s < nroutes ? nrouted_items : nunrouted_items) += 1;
+        }
+        messages.push_back( move(content) );
+        services.push_back( option ? StreamerServiceType::OPTION
+                                   : StreamerServiceType::QUOTE );
+    }
+
+    for( int json_handlers = 0; json_handlers < 2; ++json_handlers ){
+        StreamingRouter router;
+        for( int i = 0; i < nroutes; ++i ){
+            set<string> symbols{"SYM" + to_string(i)};
+            if( json_handlers ){
+                router.add_route( StreamerServiceType::QUOTE, symbols,
+                    streaming_json_cb_ty(
+                        [](StreamingCallbackType, StreamerServiceType s,
+                           unsigned long long, const json& items){
+                            nbad += (s != StreamerServiceType::QUOTE);
+                            check_items(items);
+                        }) );
+            }else
+                router.add_route(StreamerServiceType::QUOTE, symbols, on_quote);
+        }
+        router.add_route(StreamerServiceType::OPTION, {}, on_option);
+
+        ncalls.assign(nroutes, 0);
+        nservice_calls = 0;
+        nbad = 0;
+        size_t nunrouted = 0, nnot_routed = 0;
+
+        auto beg = steady_clock::now();
+        for( size_t m = 0; m < nmessages; ++m ){
+            json unrouted;
+            if( router.route(services[m], m, messages[m], unrouted) )
+                nunrouted += unrouted.size();
+            else
+                nunrouted += messages[m].size(), ++nnot_routed;
+        }
+        duration<double> d = steady_clock::now() - beg;
+
+        size_t nchecked = 0;
+        for( auto n : ncalls )
+            nchecked += n;
+        bool ok = !nbad && nchecked == nrouted_items
+                  && nunrouted == nunrouted_items
+                  && nservice_calls == nmessages / 10;
+
+        cout << (json_handlers ? "json handlers" : "C callbacks") << endl
+             << setw(24) << "usec/message" << setw(14) << fixed
+             << setprecision(3) << d.count() * 1e6 / nmessages << endl
+             << setw(24) << "routed items" << setw(14) << nchecked << endl
+             << setw(24) << "catch-all items" << setw(14) << nunrouted << endl
+             << setw(24) << "catch-all messages" << setw(14) << nnot_routed
+             << endl
+             << setw(24) << "check" << setw(14) << (ok ? "OK" : "FAILED")
+             << endl;
+        if( !ok )
+            return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+/*
+ * spread_bench - cost of keeping synthetic spread quotes up to date
+ *
+ * (links the library)
+ *
+ *   g++ -std=c++11 -O3 -I../../include spread_bench.cpp -o spread_bench \
+ *       -L<build dir> -lTDAmeritradeAPI -lpthread
+ *   ./spread_bench [nspreads ...]
+ *
+ * Builds N iron condors (4 legs, 1:-1:-1:1) over a chain of 20 strikes per
+ * expiry (one expiry per 50 spreads) and feeds the engine OPTION messages of
+ * 10 random bid/ask updates. Reports usec per message and per leg update,
+ * and checks every spread against a full reprice from the last leg quotes.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <random>
+#include <unordered_map>
+#include <cmath>
+#include <cstdlib>
+
+#include "../../include/_streaming_spreads.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace tdma;
+
+namespace {
+
+const int NSTRIKES = 20;
+const int SPREADS_PER_EXPIRY = 50;
+const int ITEMS_PER_MSG = 10;
+
+size_t ncallbacks = 0;
+
+void
+callback(int, double, double, double, unsigned long long)
+{ ++ncallbacks; }
+
+string
+option_symbol(int expiry, int strike, bool call)
+{
+    return "SPY_" + to_string(100000 + expiry) + (call ? "C" : "P")
+           + to_string(200 + strike);
+}
+
+struct Condor{
+    vector<pair<string, int>> legs;
+    int id;
+};
+
+} /* namespace */
+
+
+int
+main(int argc, char* argv[])
+{
+    vector<size_t> sizes;
+    for( int i = 1; i < argc; ++i )
+        sizes.push_back( strtoull(argv[i], nullptr, 10) );
+    if( sizes.empty() )
+        sizes = {100, 1000, 10000};
+
+    cout << setw(10) << "spreads" << setw(10) << "symbols"
+         << setw(12) << "msg(us)" << setw(12) << "leg(us)"
+         << setw(12) << "callbacks" << endl;
+
+    for( size_t n : sizes ){
+        StreamingSpreadEngine engine;
+        engine.set_callback(callback);
+        ncallbacks = 0;
+
+        mt19937 rng(n);
+        uniform_int_distribution<int> strike(0, NSTRIKES / 2 - 2);
+        vector<Condor> condors;
+        vector<string> symbols;
+        int nexpiry = static_cast<int>(n / SPREADS_PER_EXPIRY) + 1;
+        for( int e = 0; e < nexpiry; ++e ){
+            for( int s = 0; s < NSTRIKES; ++s ){
+                symbols.push_back( option_symbol(e, s, true) );
+                symbols.push_back( option_symbol(e, s, false) );
+            }
+        }
+        for( size_t i = 0; i < n; ++i ){
+            int e = static_cast<int>(i / SPREADS_PER_EXPIRY);
+            int p = strike(rng);
+            int c = NSTRIKES / 2 + strike(rng);
+            Condor cd;
+            cd.legs = { {option_symbol(e, p, false), 1},
+                        {option_symbol(e, p + 1, false), -1},
+                        {option_symbol(e, c, true), -1},
+                        {option_symbol(e, c + 1, true), 1} };
+            cd.id = engine.add_spread(cd.legs);
+            condors.push_back( std::move(cd) );
+        }
+
+        /* prebuild messages so only the engine is timed */
+        const size_t NMSGS = 20000;
+        uniform_int_distribution<size_t> sym(0, symbols.size() - 1);
+        uniform_real_distribution<double> px(0.5, 10.0);
+        vector<json> msgs(NMSGS);
+        unordered_map<string, pair<double, double>> last;
+        for( auto& m : msgs ){
+            m = json::array();
+            for( int i = 0; i < ITEMS_PER_MSG; ++i ){
+                const string& s = symbols[sym(rng)];
+                double b = round(px(rng) * 100) / 100;
+                double a = b + 0.05;
+                m.push_back( {{"key", s}, {"2", b}, {"3", a}} );
+                last[s] = make_pair(b, a);
+            }
+        }
+
+        auto beg = steady_clock::now();
+        unsigned long long ts = 0;
+        for( auto& m : msgs )
+            engine.update(StreamerServiceType::OPTION, ++ts, m);
+        double usec = duration<double, micro>(steady_clock::now() - beg).count();
+
+        for( auto& cd : condors ){
+            SpreadQuote q = engine.get_quote(cd.id);
+            double bid = 0, ask = 0, mid = 0;
+            bool valid = true;
+            for( auto& l : cd.legs ){
+                auto f = last.find(l.first);
+                if( f == last.end() ){
+                    valid = false;
+                    break;
+                }
+                double b = f->second.first, a = f->second.second;
+                bid += l.second > 0 ? l.second * b : l.second * a;
+                ask += l.second > 0 ? l.second * a : l.second * b;
+                mid += l.second * (a + b) / 2;
+            }
+            if( valid != static_cast<bool>(q.is_valid)
+                || (valid && (fabs(q.bid - bid) > 1e-9
+                              || fabs(q.ask - ask) > 1e-9
+                              || fabs(q.mid - mid) > 1e-9)) )
+            {
+                cerr << "bad quote for spread " << cd.id << endl;
+                return 1;
+            }
+        }
+
+        cout << setw(10) << n << setw(10) << symbols.size()
+             << fixed << setprecision(3)
+             << setw(12) << usec / NMSGS
+             << setw(12) << usec / (NMSGS * ITEMS_PER_MSG)
+             << setw(12) << ncallbacks << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,147 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+/*
+ * subscription_bench - cost of building/copying/comparing subscriptions
+ *
+ * (links the library)
+ *
+ *   g++ -std=c++11 -O3 -I../../include subscription_bench.cpp \
+ *       -o subscription_bench -L<build dir> -lTDAmeritradeAPI
+ *   ./subscription_bench [nsymbols ...]
+ *
+ * For a QuotesSubscription w/ N symbols and all fields reports usec per:
+ * construct, copy, move, == (equal), == (one symbol differs), hash,
+ * set_symbols, set_fields and get_symbols.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <set>
+#include <unordered_set>
+#include <cstdlib>
+
+#include "../../include/tdma_api_streaming.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace tdma;
+
+namespace {
+
+set<string>
+make_symbols(size_t n, const string& suffix = "")
+{
+    set<string> s;
+    for( size_t i = 0; i < n; ++i )
+        s.insert( "sym" + to_string(i) + suffix );
+    return s;
+}
+
+set<QuotesSubscriptionField>
+all_fields()
+{
+    set<QuotesSubscriptionField> f;
+    for( int i = 0; QuotesSubscriptionField_is_valid(i); ++i )
+        f.insert( static_cast<QuotesSubscriptionField>(i) );
+    return f;
+}
+
+/* usec per call of 'func', repeated for ~0.2 sec */
+template<typename F>
+double
+time_it(F func)
+{
+    size_t n = 0;
+    auto beg = steady_clock::now();
+    auto end = beg;
+    do{
+        func();
+        ++n;
+        end = steady_clock::now();
+    }while( end - beg < milliseconds(200) );
+    return duration<double, micro>(end - beg).count() / n;
+}
+
+void
+report(const string& what, double usec)
+{
+    cout << setw(20) << what << fixed << setprecision(2)
+         << setw(12) << usec << endl;
+}
+
+} /* namespace */
+
+
+int
+main(int argc, char* argv[])
+{
+    vector<size_t> sizes;
+    for( int i = 1; i < argc; ++i )
+        sizes.push_back( strtoull(argv[i], nullptr, 10) );
+    if( sizes.empty() )
+        sizes = {10, 500, 5000};
+
+    auto fields = all_fields();
+    for( size_t n : sizes ){
+        auto symbols = make_symbols(n);
+        auto symbols2 = make_symbols(n);
+        symbols2.erase( symbols2.begin() );
+        symbols2.insert("zzz");
+
+        QuotesSubscription q1(symbols, fields);
+        QuotesSubscription q2(symbols, fields);
+        QuotesSubscription q3(symbols2, fields);
+        size_t sink = 0;
+
+        cout << n << " symbols, " << fields.size() << " fields (usec)" << endl;
+        report("construct", time_it([&]{
+            QuotesSubscription q(symbols, fields);
+        }) );
+        report("copy", time_it([&]{
+            QuotesSubscription q(q1);
+        }) );
+        report("copy + move", time_it([&]{
+            QuotesSubscription q(q1);
+            QuotesSubscription m( std::move(q) );
+        }) );
+        report("== (equal)", time_it([&]{ sink += (q1 == q2); }) );
+        report("== (differ)", time_it([&]{ sink += (q1 == q3); }) );
+        report("hash", time_it([&]{ sink += q1.hash(); }) );
+        report("set_symbols", time_it([&]{ q2.set_symbols(symbols); }) );
+        report("set_fields", time_it([&]{ q2.set_fields(fields); }) );
+        report("get_symbols", time_it([&]{
+            sink += q1.get_symbols().size();
+        }) );
+
+        unordered_set<QuotesSubscription, StreamingSubscription::Hash> u;
+        u.insert(q1);
+        if( !u.count(q2) || u.count(q3) || !(q1 == q2) || q1 == q3
+            || q1.hash() != q2.hash() )
+        {
+            cerr << "bad equality/hash" << endl;
+            return 1;
+        }
+        if( sink == 42 )
+            cout << endl;
+        cout << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,270 @@
+/*
+Copyright (C) 2018 Jonathon Ogden <jeog.dev@gmail.com>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses.
+*/
+
+/*
+ * ws_backend_bench - compare the epoll and io_uring socket backends
+ *
+ * (links the library, Linux only)
+ *
+ *   g++ -std=c++11 -O3 -I../../include ws_backend_bench.cpp -o ws_backend_bench \
+ *       -L<build dir> -lTDAmeritradeAPI -lssl -lcrypto -lz -lpthread
+ *   ./ws_backend_bench [--external] [--seconds N] [payload.json] [rate ...]
+ *
+ * A local stand-in for the streamer (uWS server, always epoll, on its own
+ * thread) sends the payload (default payloads/stream_quote.json) to a
+ * conn::WebSocketClient at each rate (msgs/sec, in 1ms bursts). For each
+ * backend it reports the rate received, send->recv latency (as seen by the
+ * thread calling recv_or_wait) and process CPU per message.
+ *
+ * --external runs the client's loop on the receiving thread (the session's
+ * external loop mode) instead of its own socket thread.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <sys/resource.h>
+
+#include "../../include/websocket_connect.h"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+const int PORT = 28790;
+const size_t TS_WIDTH = 20;
+
+long long
+now_nsec()
+{
+    return duration_cast<nanoseconds>(
+        steady_clock::now().time_since_epoch() ).count();
+}
+
+double
+cpu_sec()
+{
+    rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec
+         + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+/* the stand-in streamer: 'total' frames in bursts of 'burst' every 1ms */
+class Server{
+    struct Feed{
+        Server *server;
+        uWS::WebSocket<uWS::SERVER> *ws;
+        const string *payload;
+        size_t burst;
+        size_t left;
+    };
+
+    uWS::Hub _hub;
+    string _payload;
+    size_t _burst;
+    size_t _total;
+    uS::Timer *_timer;
+    thread _thread;
+
+    void
+    stop_feed()
+    {
+        if( _timer ){
+            delete static_cast<Feed*>(_timer->getData());
+            _timer->stop();
+            _timer->close();
+            _timer = nullptr;
+        }
+    }
+
+    static void
+    on_tick(uS::Timer *t)
+    {
+        Feed *f = static_cast<Feed*>(t->getData());
+        string frame(TS_WIDTH + 1 + f->payload->size(), ' ');
+        memcpy(&frame[TS_WIDTH + 1], f->payload->data(), f->payload->size());
+
+        size_t n = min(f->burst, f->left);
+        for( size_t i = 0; i < n; ++i ){
+            string ts = to_string(now_nsec());
+            memcpy(&frame[TS_WIDTH - ts.size()], ts.data(), ts.size());
+            f->ws->send(frame.data(), frame.size(), uWS::OpCode::TEXT);
+        }
+        f->left -= n;
+        if( !f->left )
+            f->server->stop_feed();
+    }
+
+public:
+    /* always epoll: create before setting the client's backend */
+    Server(const string& payload, size_t burst, size_t total)
+        : _payload(payload), _burst(burst), _total(total), _timer(nullptr)
+    {
+        _hub.onConnection(
+            [this](uWS::WebSocket<uWS::SERVER> *ws, uWS::HttpRequest){
+                _timer = new uS::Timer(_hub.getLoop());
+                _timer->setData( new Feed{this, ws, &_payload, _burst, _total} );
+                _timer->start(on_tick, 1, 1);
+            });
+        _hub.onDisconnection(
+            [this](uWS::WebSocket<uWS::SERVER>*, int, char*, size_t){
+                stop_feed(); /* if the client gave up early */
+                _hub.getDefaultGroup<uWS::SERVER>().close();
+            });
+        if( !_hub.listen("127.0.0.1", PORT) )
+            throw runtime_error("listen failed");
+        _thread = thread( [this]{ _hub.run(); } );
+    }
+
+    ~Server()
+    { _thread.join(); }
+};
+
+struct Result{
+    double rate;
+    double p50_us, p99_us, max_us;
+    double cpu_us_per_msg;
+    size_t nrecv;
+};
+
+Result
+run( const string& payload,
+     size_t rate,
+     double seconds,
+     bool external,
+     bool uring )
+{
+    size_t burst = max<size_t>(1, rate / 1000);
+    size_t total = static_cast<size_t>(burst * 1000 * seconds);
+
+    conn::WebSocketClient::set_use_io_uring(false);
+    Server server(payload, burst, total);
+    conn::WebSocketClient::set_use_io_uring(uring);
+    conn::WebSocketClient client("ws://127.0.0.1:" + to_string(PORT),
+                                 external);
+
+    vector<long long> lat;
+    lat.reserve(total);
+
+    double cpu_beg = cpu_sec();
+    client.connect(milliseconds(3000));
+    auto t_beg = steady_clock::now();
+    while( lat.size() < total ){
+        string msg = client.recv_or_wait_for(milliseconds(3000));
+        if( msg.empty() )
+            break;
+        long long ts = strtoll(msg.c_str(), nullptr, 10);
+        lat.push_back(now_nsec() - ts);
+    }
+    auto t_end = steady_clock::now();
+    double cpu = cpu_sec() - cpu_beg;
+    client.close();
+
+    Result r{};
+    r.nrecv = lat.size();
+    if( lat.empty() )
+        return r;
+    r.rate = lat.size() / duration<double>(t_end - t_beg).count();
+    r.cpu_us_per_msg = cpu * 1e6 / lat.size();
+
+    /* skip the first 5% (connect, warm-up) */
+    vector<long long> steady(lat.begin() + lat.size() / 20, lat.end());
+    sort(steady.begin(), steady.end());
+    r.p50_us = steady[steady.size() / 2] / 1e3;
+    r.p99_us = steady[steady.size() * 99 / 100] / 1e3;
+    r.max_us = steady.back() / 1e3;
+    return r;
+}
+
+} /* namespace */
+
+
+int
+main(int argc, char* argv[])
+{
+    bool external = false;
+    double seconds = 2.0;
+    string path = "payloads/stream_quote.json";
+    vector<size_t> rates;
+    for( int i = 1; i < argc; ++i ){
+        string a(argv[i]);
+        if( a == "--external" )
+            external = true;
+        else if( a == "--seconds" && i + 1 < argc )
+            seconds = atof(argv[++i]);
+        else if( a.find(".json") != string::npos )
+            path = a;
+        else
+            rates.push_back( strtoull(a.c_str(), nullptr, 10) );
+    }
+    if( rates.empty() )
+        rates = {10000, 50000, 100000, 200000};
+
+    ifstream in(path);
+    if( !in ){
+        cerr << "can't open " << path << endl;
+        return 1;
+    }
+    stringstream ss;
+    ss << in.rdbuf();
+    string payload = ss.str();
+    while( !payload.empty() && isspace(payload.back()) )
+        payload.pop_back();
+
+    conn::WebSocketClient::set_use_io_uring(true);
+    bool have_uring = conn::WebSocketClient::uses_io_uring();
+    conn::WebSocketClient::set_use_io_uring(false);
+
+    cout << path << " (" << payload.size() << " bytes), "
+         << seconds << " sec per run, "
+         << (external ? "external loop" : "socket thread") << endl;
+    if( !have_uring )
+        cout << "io_uring unavailable, epoll only" << endl;
+
+    cout << setw(10) << "rate" << setw(10) << "backend"
+         << setw(12) << "recv/sec" << setw(10) << "p50(us)"
+         << setw(10) << "p99(us)" << setw(11) << "max(us)"
+         << setw(12) << "cpu/msg(us)" << endl;
+
+    for( size_t rate : rates ){
+        for( bool uring : {false, true} ){
+            if( uring && !have_uring )
+                continue;
+            Result r = run(payload, rate, seconds, external, uring);
+            cout << setw(10) << rate << setw(10) << (uring ? "io_uring" : "epoll")
+                 << fixed << setprecision(0) << setw(12) << r.rate
+                 << setprecision(1) << setw(10) << r.p50_us
+                 << setw(10) << r.p99_us << setw(11) << r.max_us
+                 << setprecision(2) << setw(12) << r.cpu_us_per_msg;
+            if( r.nrecv < static_cast<size_t>(max<size_t>(1, rate / 1000)
+                                              * 1000 * seconds) )
+                cout << "  (only " << r.nrecv << " received)";
+            cout << endl;
+        }
+    }
+    return 0;
+}
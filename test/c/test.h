@@ -29,6 +29,10 @@ int Test_Streaming(struct Credentials *creds, const char* acct);
 
 int Test_Execution_Order_Objects();
 
+int Test_Execution_Replace_Order(struct Credentials *creds, const char* acct);
+
+int Test_Execution_Paper_Broker(struct Credentials *creds);
+
 
 
 #endif /* TEST_H_ */
@@ -1,6 +1,7 @@
 
 #include "test.h"
 #include "tdma_api_execute.h"
+#include "tdma_api_get.h"
 
 #include <math.h>
 
@@ -61,6 +62,245 @@ int test_doublediagonal_spread_order_builder(); /*DONE*/
 int test_one_cancels_other_order_builder(); /*DONE*/
 int test_one_triggers_other_order_builder(); /*DONE*/
 
+int paper_activity_count = 0;
+
+void
+paper_activity_callback(unsigned long long timestamp, const char* msg)
+{ ++paper_activity_count; }
+
+/* 1 if the order's json has 'status', 0 if not, < 0 on error */
+int
+paper_order_status_is( struct Credentials *creds,
+                       const char* acct,
+                       const char* order_id,
+                       const char* status )
+{
+    int err = 0;
+    int is = 0;
+    char* buf = NULL;
+    size_t n;
+    char s[64];
+    OrderGetter_C og = {0,0};
+
+    if( (err = OrderGetter_Create(creds, acct, order_id, &og)) )
+        CHECK_AND_RETURN_ON_ERROR(-err, "OrderGetter_Create (paper)");
+
+    if( (err = OrderGetter_Get(&og, &buf, &n)) ){
+        OrderGetter_Destroy(&og);
+        CHECK_AND_RETURN_ON_ERROR(-err, "OrderGetter_Get (paper)");
+    }
+
+    sprintf(s, "\"status\":\"%s\"", status);
+    is = (strstr(buf, s) != NULL);
+    if( !is )
+        fprintf(stderr, "paper order %s not %s: %s \n", order_id, status, buf);
+    FreeBuffer(buf);
+    OrderGetter_Destroy(&og);
+    return is;
+}
+
+/* paper account, so nothing is sent; quotes are set by hand */
+int
+Test_Execution_Paper_Broker(struct Credentials *creds)
+{
+    int err = 0;
+    int i;
+    const char* ACCT = "PAPER_TEST";
+    OrderTicket_C o = {0,0};
+    char* ids[4] = {NULL, NULL, NULL, NULL};
+    size_t n;
+    PaperFillModel fm;
+
+    if( (err = Execute_PaperAddAccount(ACCT)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "Execute_PaperAddAccount");
+    if( Execute_PaperAddAccount(ACCT) != TDMA_API_VALUE_ERROR ){
+        fprintf(stderr, "Execute_PaperAddAccount didn't fail for existing \n");
+        return -1;
+    }
+
+    if( (err = Execute_PaperSetLiveQuotes(0)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "Execute_PaperSetLiveQuotes");
+    if( (err = Execute_PaperSetLatency(ACCT, 0)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "Execute_PaperSetLatency");
+    if( (err = Execute_PaperSetFillModel(ACCT, PaperFillModel_TOUCH)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "Execute_PaperSetFillModel");
+    if( (err = Execute_PaperGetFillModel(ACCT, &fm)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "Execute_PaperGetFillModel");
+    if( fm != PaperFillModel_TOUCH ){
+        fprintf(stderr, "bad paper fill model (%i) \n", fm);
+        return -1;
+    }
+    if( (err = Execute_PaperSetActivityCallback(paper_activity_callback)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "Execute_PaperSetActivityCallback");
+
+    if( (err = Execute_PaperSetQuote("SPY", 99.99, 100.01, 1000, 1000, 1000)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "Execute_PaperSetQuote");
+
+    /* market fills at the ask */
+    if( (err = BuildOrder_Equity_Market("SPY", 10, 1, 1, &o)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "BuildOrder_Equity_Market (paper)");
+    err = Execute_SendOrder(creds, ACCT, &o, &ids[0], &n);
+    OrderTicket_Destroy(&o);
+    if( err )
+        CHECK_AND_RETURN_ON_ERROR(err, "Execute_SendOrder (paper 1)");
+    if( paper_order_status_is(creds, ACCT, ids[0], "FILLED") != 1 ){
+        err = -1;
+        goto cleanup_and_exit;
+    }
+
+    /* limit below the ask rests, replace moves it, fills when touched */
+    if( (err = BuildOrder_Equity_Limit("SPY", 10, 1, 1, 99.00, &o)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "BuildOrder_Equity_Limit (paper)");
+    err = Execute_SendOrder(creds, ACCT, &o, &ids[1], &n);
+    OrderTicket_Destroy(&o);
+    if( err ){
+        print_error(err, "Execute_SendOrder (paper 2)");
+        goto cleanup_and_exit;
+    }
+    Execute_PaperSetQuote("SPY", 99.99, 100.01, 1000, 1000, 2000);
+    if( paper_order_status_is(creds, ACCT, ids[1], "WORKING") != 1 ){
+        err = -1;
+        goto cleanup_and_exit;
+    }
+
+    if( (err = BuildOrder_Equity_Limit("SPY", 10, 1, 1, 99.50, &o)) ){
+        print_error(err, "BuildOrder_Equity_Limit (paper 2)");
+        goto cleanup_and_exit;
+    }
+    err = Execute_ReplaceOrder(creds, ACCT, ids[1], &o, &ids[2], &n);
+    OrderTicket_Destroy(&o);
+    if( err ){
+        print_error(err, "Execute_ReplaceOrder (paper)");
+        goto cleanup_and_exit;
+    }
+    if( strcmp(ids[1], ids[2]) == 0 ){
+        fprintf(stderr, "paper replace didn't return a new id \n");
+        err = -1;
+        goto cleanup_and_exit;
+    }
+    if( paper_order_status_is(creds, ACCT, ids[1], "REPLACED") != 1 ){
+        err = -1;
+        goto cleanup_and_exit;
+    }
+    Execute_PaperSetQuote("SPY", 99.40, 99.50, 1000, 1000, 3000);
+    if( paper_order_status_is(creds, ACCT, ids[2], "FILLED") != 1 ){
+        err = -1;
+        goto cleanup_and_exit;
+    }
+
+    /* cancel */
+    if( (err = BuildOrder_Equity_Limit("SPY", 10, 1, 1, 90.00, &o)) ){
+        print_error(err, "BuildOrder_Equity_Limit (paper 3)");
+        goto cleanup_and_exit;
+    }
+    err = Execute_SendOrder(creds, ACCT, &o, &ids[3], &n);
+    OrderTicket_Destroy(&o);
+    if( err ){
+        print_error(err, "Execute_SendOrder (paper 3)");
+        goto cleanup_and_exit;
+    }
+    Execute_PaperSetQuote("SPY", 99.40, 99.50, 1000, 1000, 4000);
+    if( (err = Execute_CancelOrder(creds, ACCT, ids[3], &i)) || !i ){
+        print_error(err, "Execute_CancelOrder (paper)");
+        err = -1;
+        goto cleanup_and_exit;
+    }
+    if( paper_order_status_is(creds, ACCT, ids[3], "CANCELED") != 1 ){
+        err = -1;
+        goto cleanup_and_exit;
+    }
+    if( Execute_CancelOrder(creds, ACCT, ids[3], &i) != TDMA_API_EXECUTE_ERROR ){
+        fprintf(stderr, "Execute_CancelOrder didn't fail for canceled order \n");
+        err = -1;
+        goto cleanup_and_exit;
+    }
+    if( Execute_CancelOrder(creds, ACCT, "999999", &i) != TDMA_API_REQUEST_ERROR ){
+        fprintf(stderr, "Execute_CancelOrder didn't fail for bad order id \n");
+        err = -1;
+        goto cleanup_and_exit;
+    }
+
+    if( !paper_activity_count ){
+        fprintf(stderr, "no paper activity callbacks \n");
+        err = -1;
+    }
+
+cleanup_and_exit:
+    for( i = 0; i < 4; ++i ){
+        if( ids[i] )
+            FreeBuffer(ids[i]);
+    }
+    Execute_PaperSetActivityCallback(NULL);
+    Execute_PaperRemoveAccount(ACCT);
+    Execute_PaperSetLiveQuotes(1);
+    return err;
+}
+
+/* argument checks only, nothing is sent */
+int
+Test_Execution_Replace_Order(struct Credentials *creds, const char* acct)
+{
+    int err = 0;
+    OrderTicket_C o = {0,0};
+    OrderTicket_C bad = {0,0};
+    ExecuteLatencyStats stats;
+    char* buf = NULL;
+    size_t n;
+
+    if( (err = BuildOrder_Equity_Limit("SPY", 1, 1, 1, 1.00, &o)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "BuildOrder_Equity_Limit");
+
+    if( (err = Execute_ResetLatencyStats()) ){
+        OrderTicket_Destroy(&o);
+        CHECK_AND_RETURN_ON_ERROR(err, "Execute_ResetLatencyStats");
+    }
+
+    if( Execute_ReplaceOrder(creds, acct, "", &o, &buf, &n)
+        != TDMA_API_VALUE_ERROR )
+    {
+        fprintf(stderr, "Execute_ReplaceOrder didn't fail for empty order id \n");
+        OrderTicket_Destroy(&o);
+        return -1;
+    }
+    if( Execute_ReplaceOrder(creds, NULL, "1", &o, &buf, &n)
+        != TDMA_API_VALUE_ERROR )
+    {
+        fprintf(stderr, "Execute_ReplaceOrder didn't fail for null account \n");
+        OrderTicket_Destroy(&o);
+        return -1;
+    }
+    if( Execute_ReplaceOrder(creds, acct, NULL, &o, &buf, &n)
+        != TDMA_API_VALUE_ERROR )
+    {
+        fprintf(stderr, "Execute_ReplaceOrder didn't fail for null order id \n");
+        OrderTicket_Destroy(&o);
+        return -1;
+    }
+    if( Execute_ReplaceOrder(creds, acct, "1", &o, NULL, &n)
+        != TDMA_API_VALUE_ERROR )
+    {
+        fprintf(stderr, "Execute_ReplaceOrder didn't fail for null buffer \n");
+        OrderTicket_Destroy(&o);
+        return -1;
+    }
+    if( Execute_ReplaceOrder(creds, acct, "1", &bad, &buf, &n) == 0 ){
+        fprintf(stderr, "Execute_ReplaceOrder didn't fail for bad order \n");
+        OrderTicket_Destroy(&o);
+        return -1;
+    }
+
+    OrderTicket_Destroy(&o);
+
+    if( (err = Execute_GetLatencyStats(&stats)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "Execute_GetLatencyStats");
+    if( stats.replace.ncalls || stats.replace.nerrors ){
+        fprintf(stderr, "replace latency stats counted a bad call \n");
+        return -1;
+    }
+
+    return 0;
+}
+
 int
 Test_Execution_Order_Objects()
 {
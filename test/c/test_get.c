@@ -1011,6 +1011,8 @@ Test_HistoricalRangeGetter(struct Credentials *creds)
     int err = 0;
     char *buf = NULL;
     size_t ndata = 0;
+    TDMA_Candle *candles = NULL;
+    size_t ncandles = 0;
 
     HistoricalRangeGetter_C hpg;
     memset(&hpg, 0, sizeof(HistoricalRangeGetter_C));
@@ -1085,6 +1087,25 @@ Test_HistoricalRangeGetter(struct Credentials *creds)
         buf = NULL;
     }
 
+    if( (err = HistoricalRangeGetter_GetCandles(&hpg, &candles, &ncandles)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "HistoricalRangeGetter_GetCandles");
+
+    printf("Candles: %zu \n", ncandles);
+    for( size_t i = 1; i < ncandles; ++i ){
+        if( candles[i].datetime < candles[i-1].datetime ){
+            fprintf(stderr, "candles out of order (%zu) \n", i);
+            FreeCandlesBuffer(candles);
+            return -1;
+        }
+    }
+    if( ncandles ){
+        printf("Candle[0]: %lld %f %f %f %f %lld \n", candles[0].datetime,
+               candles[0].open, candles[0].high, candles[0].low,
+               candles[0].close, candles[0].volume);
+    }
+    if( (err = FreeCandlesBuffer(candles)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "FreeCandlesBuffer");
+
 
     ft = FrequencyType_daily;
     freq = VALID_FREQUENCIES_BY_FREQUENCY_TYPE[ft][0];
@@ -1176,6 +1197,8 @@ Test_OptionChainGetter(struct Credentials *creds)
     size_t ndata = 0;
     char* str;
     size_t n;
+    TDMA_OptionQuote *quotes = NULL;
+    size_t nquotes = 0;
 
     OptionChainGetter_C ocg;
     memset(&ocg, 0, sizeof(OptionChainGetter_C));
@@ -1293,6 +1316,34 @@ Test_OptionChainGetter(struct Credentials *creds)
         buf = NULL;
     }
 
+    /* calls first, then by expiration and strike */
+    if( (err = OptionChainGetter_GetQuotes(&ocg, &quotes, &nquotes)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "OptionChainGetter_GetQuotes");
+
+    printf("OptionQuotes: %zu \n", nquotes);
+    for( size_t i = 0; i < nquotes; ++i ){
+        TDMA_OptionQuote *q = quotes + i;
+        TDMA_OptionQuote *p = q - 1;
+        if( !q->symbol[0] ){
+            fprintf(stderr, "option quote has no symbol (%zu) \n", i);
+            FreeOptionQuotesBuffer(quotes);
+            return -1;
+        }
+        if( i && (p->is_put > q->is_put
+                  || (p->is_put == q->is_put
+                      && (p->expiration > q->expiration
+                          || (p->expiration == q->expiration
+                              && p->strike > q->strike)))) )
+        {
+            fprintf(stderr, "option quotes out of order (%zu) \n", i);
+            FreeOptionQuotesBuffer(quotes);
+            return -1;
+        }
+        printf("OptionQuote: %s %f %f \n", q->symbol, q->bid, q->ask);
+    }
+    if( (err = FreeOptionQuotesBuffer(quotes)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "FreeOptionQuotesBuffer");
+
     ost = OptionStrikesType_n_atm;
     osv.n_atm =  2;
     oct = OptionContractType_all;
@@ -1450,6 +1501,16 @@ Test_OptionChainStrategyGetter(struct Credentials *creds)
         return -1;
     }
 
+    /* strategy responses list legs, not contracts */
+    TDMA_OptionQuote *quotes = NULL;
+    size_t nquotes = 0;
+    if( OptionChainGetter_GetQuotes((OptionChainGetter_C*)&ocg, &quotes,
+                                    &nquotes) != TDMA_API_TYPE_ERROR )
+    {
+        fprintf(stderr, "OptionChainGetter_GetQuotes didn't fail for strategy \n");
+        return -1;
+    }
+
     OptionStrategyType ostrat2;
     double ospread2;
     OptionStrikesType ost2;
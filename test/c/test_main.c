@@ -39,6 +39,24 @@ int main(int argc, char* argv[])
     if( (err = LoadCredentials( argv[2], argv[3], &creds )) )
         CHECK_AND_RETURN_ON_ERROR(err, "LoadCredentials");
 
+    printf("*** [BEGIN] TEST EXECUTION REPLACE ORDER [BEGIN] ***\n");
+    err = Test_Execution_Replace_Order(&creds, argv[1]);
+    if( err ){
+        printf("\n *** [ERROR] TEST EXECUTION REPLACE ORDER [ERROR] ***\n");
+        StoreCredentials( argv[2], argv[3], &creds);
+        return err;
+    }
+    printf("\n *** [END] TEST EXECUTION REPLACE ORDER [END] ***\n\n");
+
+    printf("*** [BEGIN] TEST EXECUTION PAPER BROKER [BEGIN] ***\n");
+    err = Test_Execution_Paper_Broker(&creds);
+    if( err ){
+        printf("\n *** [ERROR] TEST EXECUTION PAPER BROKER [ERROR] ***\n");
+        StoreCredentials( argv[2], argv[3], &creds);
+        return err;
+    }
+    printf("\n *** [END] TEST EXECUTION PAPER BROKER [END] ***\n\n");
+
     printf("*** [BEGIN] TEST GETTERS [BEGIN] ***\n");
     err = Test_Getters(&creds, argv[1], 1500);
     if( err ){
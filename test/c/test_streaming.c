@@ -746,6 +746,317 @@ test_raw_subscription( RawSubscription_C* sub )
 }
 
 
+/* equal subs hash the same; symbol case/order don't matter */
+int
+test_subscription_hash(void)
+{
+    int err = 0;
+    int is_same;
+    size_t h1, h2;
+    const char* symbols1[] = {"spy", "qqq"};
+    const char* symbols2[] = {"QQQ", "SPY"};
+    QuotesSubscriptionField fields1[] = {QuotesSubscriptionField_bid_price,
+                                         QuotesSubscriptionField_ask_price};
+    QuotesSubscriptionField fields2[] = {QuotesSubscriptionField_ask_price,
+                                         QuotesSubscriptionField_bid_price};
+    QuotesSubscription_C q1, q2, q3;
+
+    if( (err = QuotesSubscription_Create(symbols1, 2, fields1, 2,
+                                         CommandType_SUBS, &q1)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "QuotesSubscription_Create (hash 1)");
+    if( (err = QuotesSubscription_Create(symbols2, 2, fields2, 2,
+                                         CommandType_SUBS, &q2)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "QuotesSubscription_Create (hash 2)");
+    if( (err = QuotesSubscription_Create(symbols2, 2, fields2, 2,
+                                         CommandType_UNSUBS, &q3)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "QuotesSubscription_Create (hash 3)");
+
+    if( (err = StreamingSubscription_IsSame((StreamingSubscription_C*)&q1,
+                                            (StreamingSubscription_C*)&q2,
+                                            &is_same)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "StreamingSubscription_IsSame (hash)");
+    if( !is_same ){
+        fprintf(stderr, "QuotesSubscription: q1 != q2 \n");
+        return -1;
+    }
+
+    if( (err = StreamingSubscription_Hash((StreamingSubscription_C*)&q1, &h1)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "StreamingSubscription_Hash (1)");
+    if( (err = StreamingSubscription_Hash((StreamingSubscription_C*)&q2, &h2)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "StreamingSubscription_Hash (2)");
+    if( h1 != h2 ){
+        fprintf(stderr, "QuotesSubscription: hash(q1) != hash(q2) \n");
+        return -1;
+    }
+
+    if( (err = StreamingSubscription_IsSame((StreamingSubscription_C*)&q1,
+                                            (StreamingSubscription_C*)&q3,
+                                            &is_same)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "StreamingSubscription_IsSame (hash 2)");
+    if( is_same ){
+        fprintf(stderr, "QuotesSubscription: q1 == q3 (command) \n");
+        return -1;
+    }
+
+    if( StreamingSubscription_Hash((StreamingSubscription_C*)&q1, NULL)
+        != TDMA_API_VALUE_ERROR )
+    {
+        fprintf(stderr, "StreamingSubscription_Hash didn't fail for null \n");
+        return -1;
+    }
+
+    if( (err = QuotesSubscription_Destroy(&q1)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "QuotesSubscription_Destroy (hash 1)");
+    if( (err = QuotesSubscription_Destroy(&q2)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "QuotesSubscription_Destroy (hash 2)");
+    if( (err = QuotesSubscription_Destroy(&q3)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "QuotesSubscription_Destroy (hash 3)");
+
+    return 0;
+}
+
+
+int filtered_qqq = 0;
+
+void
+filtered_callback( int cb_type,
+                   int ss_type,
+                   unsigned long long ts,
+                   const char* msg )
+{
+    if( cb_type == StreamingCallbackType_data
+        && ss_type == StreamerServiceType_QUOTE
+        && strstr(msg, "\"QQQ\"") )
+    {
+        filtered_qqq = 1;
+    }
+}
+
+/* only SPY should get through the symbol filter */
+int
+test_streaming_filters(struct Credentials* c)
+{
+    int err;
+    unsigned long long npassed, ndropped;
+    const char* keep[] = {"SPY"};
+    const char* symbols[] = {"SPY", "QQQ"};
+    QuotesSubscriptionField fields[] = {QuotesSubscriptionField_symbol,
+                                        QuotesSubscriptionField_bid_price,
+                                        QuotesSubscriptionField_ask_price};
+    QuotesSubscription_C q;
+    StreamingSession_C ss;
+
+    if( (err = StreamingSession_Create(c, filtered_callback, &ss)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "StreamingSession_Create (filters)");
+
+    if( StreamingSession_SetFilterSymbols(&ss, StreamerServiceType_NONE,
+                                          keep, 1) != TDMA_API_VALUE_ERROR ){
+        fprintf(stderr, "SetFilterSymbols didn't fail for NONE \n");
+        return -1;
+    }
+    if( StreamingSession_AddFilterRule(&ss, StreamerServiceType_QUOTE,
+                                       QuotesSubscriptionField_last_price,
+                                       StreamingFilterRuleType_delta, 0.0)
+        != TDMA_API_VALUE_ERROR )
+    {
+        fprintf(stderr, "AddFilterRule didn't fail for delta of 0.0 \n");
+        return -1;
+    }
+    if( StreamingSession_AddFilterRule(&ss, StreamerServiceType_QUOTE, -1,
+                                       StreamingFilterRuleType_changed, 0.0)
+        != TDMA_API_VALUE_ERROR )
+    {
+        fprintf(stderr, "AddFilterRule didn't fail for field -1 \n");
+        return -1;
+    }
+
+    if( (err = StreamingSession_SetFilterSymbols(&ss, StreamerServiceType_QUOTE,
+                                                 keep, 1)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "StreamingSession_SetFilterSymbols");
+
+    if( (err = QuotesSubscription_Create(symbols, 2, fields, 3,
+                                         CommandType_SUBS, &q)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "QuotesSubscription_Create (filters)");
+
+    StreamingSubscription_C* subs[] = {(StreamingSubscription_C*)&q};
+    if( (err = StreamingSession_Start(&ss, subs, 1, NULL)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "StreamingSession_Start (filters)");
+
+    SleepFor(5000);
+
+    if( (err = StreamingSession_Stop(&ss)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "StreamingSession_Stop (filters)");
+
+    if( (err = StreamingSession_GetFilterStats(&ss, StreamerServiceType_QUOTE,
+                                               &npassed, &ndropped)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "StreamingSession_GetFilterStats");
+    printf("filter stats (passed, dropped): %llu, %llu \n", npassed, ndropped);
+
+    if( filtered_qqq ){
+        fprintf(stderr, "filter passed QQQ \n");
+        return -1;
+    }
+
+    if( (err = StreamingSession_ClearFilter(&ss, StreamerServiceType_NONE)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "StreamingSession_ClearFilter");
+
+    if( (err = StreamingSession_GetFilterStats(&ss, StreamerServiceType_QUOTE,
+                                               &npassed, &ndropped)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "StreamingSession_GetFilterStats (2)");
+    if( npassed || ndropped ){
+        fprintf(stderr, "filter stats not cleared \n");
+        return -1;
+    }
+
+    if( (err = StreamingSession_Destroy(&ss)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "StreamingSession_Destroy (filters)");
+
+    if( (err = QuotesSubscription_Destroy(&q)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "QuotesSubscription_Destroy (filters)");
+
+    return 0;
+}
+
+
+int routed_spy = 0;
+int routed_qqq = 0;
+int unrouted_spy = 0;
+int unrouted_qqq = 0;
+
+void
+routed_callback( int cb_type,
+                 int ss_type,
+                 unsigned long long ts,
+                 const char* msg )
+{
+    if( cb_type == StreamingCallbackType_data
+        && ss_type == StreamerServiceType_QUOTE )
+    {
+        if( strstr(msg, "\"SPY\"") )
+            routed_spy = 1;
+        if( strstr(msg, "\"QQQ\"") )
+            routed_qqq = 1;
+    }
+}
+
+void
+unrouted_callback( int cb_type,
+                   int ss_type,
+                   unsigned long long ts,
+                   const char* msg )
+{
+    if( cb_type == StreamingCallbackType_data
+        && ss_type == StreamerServiceType_QUOTE )
+    {
+        if( strstr(msg, "\"SPY\"") )
+            unrouted_spy = 1;
+        if( strstr(msg, "\"QQQ\"") )
+            unrouted_qqq = 1;
+    }
+}
+
+/* SPY to the route, everything else to the session's callback */
+int
+test_streaming_routes(struct Credentials* c)
+{
+    int err;
+    int id;
+    const char* route[] = {"spy"};
+    const char* empty[] = {""};
+    const char* symbols[] = {"SPY", "QQQ"};
+    QuotesSubscriptionField fields[] = {QuotesSubscriptionField_symbol,
+                                        QuotesSubscriptionField_bid_price,
+                                        QuotesSubscriptionField_ask_price};
+    QuotesSubscription_C q;
+    StreamingSession_C ss;
+
+    if( (err = StreamingSession_Create(c, unrouted_callback, &ss)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "StreamingSession_Create (routes)");
+
+    if( StreamingSession_AddRoute(&ss, StreamerServiceType_NONE, NULL, 0,
+                                  routed_callback, &id) != TDMA_API_VALUE_ERROR )
+    {
+        fprintf(stderr, "AddRoute didn't fail for NONE \n");
+        return -1;
+    }
+    if( StreamingSession_AddRoute(&ss, StreamerServiceType_QUOTE, empty, 1,
+                                  routed_callback, &id) != TDMA_API_VALUE_ERROR )
+    {
+        fprintf(stderr, "AddRoute didn't fail for empty symbol \n");
+        return -1;
+    }
+    if( StreamingSession_AddRoute(&ss, StreamerServiceType_QUOTE, route, 1,
+                                  NULL, &id) != TDMA_API_VALUE_ERROR )
+    {
+        fprintf(stderr, "AddRoute didn't fail for null callback \n");
+        return -1;
+    }
+    if( StreamingSession_RemoveRoute(&ss, -1) != TDMA_API_VALUE_ERROR ){
+        fprintf(stderr, "RemoveRoute didn't fail for bad id \n");
+        return -1;
+    }
+
+    if( (err = StreamingSession_AddRoute(&ss, StreamerServiceType_QUOTE, route,
+                                         1, routed_callback, &id)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "StreamingSession_AddRoute");
+
+    if( (err = QuotesSubscription_Create(symbols, 2, fields, 3,
+                                         CommandType_SUBS, &q)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "QuotesSubscription_Create (routes)");
+
+    StreamingSubscription_C* subs[] = {(StreamingSubscription_C*)&q};
+    if( (err = StreamingSession_Start(&ss, subs, 1, NULL)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "StreamingSession_Start (routes)");
+
+    SleepFor(5000);
+
+    if( (err = StreamingSession_Stop(&ss)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "StreamingSession_Stop (routes)");
+
+    if( !routed_spy ){
+        fprintf(stderr, "route didn't get SPY \n");
+        return -1;
+    }
+    if( !unrouted_qqq ){
+        fprintf(stderr, "catch-all didn't get QQQ \n");
+        return -1;
+    }
+    if( routed_qqq ){
+        fprintf(stderr, "route got QQQ \n");
+        return -1;
+    }
+    if( unrouted_spy ){
+        fprintf(stderr, "catch-all got routed SPY \n");
+        return -1;
+    }
+
+    if( (err = StreamingSession_RemoveRoute(&ss, id)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "StreamingSession_RemoveRoute");
+    if( StreamingSession_RemoveRoute(&ss, id) != TDMA_API_VALUE_ERROR ){
+        fprintf(stderr, "RemoveRoute didn't fail for removed route \n");
+        return -1;
+    }
+
+    if( (err = StreamingSession_AddRoute(&ss, StreamerServiceType_QUOTE, NULL,
+                                         0, routed_callback, &id)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "StreamingSession_AddRoute (2)");
+    if( (err = StreamingSession_ClearRoutes(&ss)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "StreamingSession_ClearRoutes");
+    if( StreamingSession_RemoveRoute(&ss, id) != TDMA_API_VALUE_ERROR ){
+        fprintf(stderr, "RemoveRoute didn't fail for cleared route \n");
+        return -1;
+    }
+
+    if( (err = StreamingSession_Destroy(&ss)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "StreamingSession_Destroy (routes)");
+
+    if( (err = QuotesSubscription_Destroy(&q)) )
+        CHECK_AND_RETURN_ON_ERROR(err, "QuotesSubscription_Destroy (routes)");
+
+    return 0;
+}
+
+
 int
 Test_Streaming(struct Credentials* c, const char* account_id)
 {
@@ -853,6 +1164,9 @@ Test_Streaming(struct Credentials* c, const char* account_id)
         return -1;
     }
 
+    if( (err = test_subscription_hash()) )
+        return err;
+
     // CREATE SESSION 1
     StreamingSession_C ss;
     if( (err = StreamingSession_Create(c, streaming_callback, &ss)) )
@@ -1001,6 +1315,12 @@ Test_Streaming(struct Credentials* c, const char* account_id)
           }
     }
 
+    if( (err = test_streaming_filters(c)) )
+        return err;
+
+    if( (err = test_streaming_routes(c)) )
+        return err;
+
     return 0;
 
 }
@@ -17,6 +17,12 @@ void test_streaming( const std::string& account_id,
 
 void test_execution_order_objects();
 
+void
+test_execute_replace_order( const std::string& account_id,
+                            Credentials& creds );
+
+void test_execute_paper_broker(Credentials& creds);
+
 void
 test_execute_transactions( const std::string& account_id,
                            Credentials& creds );
@@ -5,6 +5,7 @@
 #include "test.h"
 
 #include "tdma_api_execute.h"
+#include "tdma_api_get.h"
 
 using namespace tdma;
 using namespace std;
@@ -2016,6 +2017,141 @@ test_execution_order_objects()
     test_conditional_exec_oto();
 }
 
+/* argument checks only, nothing is sent */
+void
+test_execute_replace_order(const std::string& account_id, Credentials& creds)
+{
+    auto order = SimpleOrderBuilder::Equity::Build("SPY", 1, true, true, 1.00);
+
+    Execute_ResetLatencyStats();
+    try{
+        Execute_ReplaceOrder(creds, account_id, "", order);
+        throw std::runtime_error("failed to catch 'empty order id' exception");
+    }catch(ValueException& e){
+        std::cout<< "successfully caught: " << e.what() << std::endl;
+    }
+
+    ExecuteLatencyStats stats = Execute_GetLatencyStats();
+    if( stats.replace.ncalls || stats.replace.nerrors )
+        throw std::runtime_error("replace latency stats counted a bad call");
+    if( stats.send.ncalls || stats.cancel.ncalls )
+        throw std::runtime_error("latency stats weren't reset");
+}
+
+size_t paper_activity_count = 0;
+
+void
+paper_activity_callback(unsigned long long timestamp, const char* msg)
+{ ++paper_activity_count; }
+
+string
+paper_order_status( Credentials& creds,
+                    const string& account_id,
+                    const string& order_id )
+{ return OrderGetter(creds, account_id, order_id).get()["status"]; }
+
+/* paper account, so nothing is sent; quotes are set by hand */
+void
+test_execute_paper_broker(Credentials& creds)
+{
+    const string ACCT = "PAPER_TEST";
+
+    Execute_PaperAddAccount(ACCT);
+    try{
+        Execute_PaperAddAccount(ACCT);
+        throw std::runtime_error("failed to catch 'account exists' exception");
+    }catch(ValueException& e){
+        cout<< "successfully caught: " << e.what() << endl;
+    }
+    if( !Execute_PaperIsAccount(ACCT) )
+        throw std::runtime_error("paper account wasn't added");
+
+    Execute_PaperSetLiveQuotes(false);
+    if( Execute_PaperGetLiveQuotes() )
+        throw std::runtime_error("paper live quotes still on");
+    Execute_PaperSetLatency(ACCT, std::chrono::milliseconds(0));
+    Execute_PaperSetFillModel(ACCT, PaperFillModel::TOUCH);
+    if( Execute_PaperGetFillModel(ACCT) != PaperFillModel::TOUCH )
+        throw std::runtime_error("bad paper fill model");
+    Execute_PaperSetActivityCallback(paper_activity_callback);
+
+    Execute_PaperSetQuote("SPY", 99.99, 100.01, 1000, 1000, 1000);
+
+    /* market fills at the ask */
+    string id1 = Execute_SendOrder(
+        creds, ACCT, SimpleOrderBuilder::Equity::Build("SPY", 10, true, true)
+        );
+    json o1 = OrderGetter(creds, ACCT, id1).get();
+    if( o1["status"] != "FILLED" || o1["filledQuantity"] != 10 )
+        throw std::runtime_error("paper market order didn't fill");
+    if( o1["orderActivityCollection"][0]["executionLegs"][0]["price"] != 100.01 )
+        throw std::runtime_error("paper market order bad fill price");
+
+    /* limit below the ask rests, replace moves it, fills when touched */
+    string id2 = Execute_SendOrder(
+        creds, ACCT,
+        SimpleOrderBuilder::Equity::Build("SPY", 10, true, true, 99.00)
+        );
+    Execute_PaperSetQuote("SPY", 99.99, 100.01, 1000, 1000, 2000);
+    if( paper_order_status(creds, ACCT, id2) != "WORKING" )
+        throw std::runtime_error("paper limit order not working");
+
+    string id3 = Execute_ReplaceOrder(
+        creds, ACCT, id2,
+        SimpleOrderBuilder::Equity::Build("SPY", 10, true, true, 99.50)
+        );
+    if( id3 == id2 )
+        throw std::runtime_error("paper replace didn't return a new id");
+    if( paper_order_status(creds, ACCT, id2) != "REPLACED" )
+        throw std::runtime_error("paper replaced order not REPLACED");
+
+    Execute_PaperSetQuote("SPY", 99.40, 99.50, 1000, 1000, 3000);
+    if( paper_order_status(creds, ACCT, id3) != "FILLED" )
+        throw std::runtime_error("paper replacement order didn't fill");
+
+    try{
+        Execute_ReplaceOrder(
+            creds, ACCT, id3,
+            SimpleOrderBuilder::Equity::Build("SPY", 10, true, true, 99.00)
+            );
+        throw std::runtime_error("failed to catch 'not replaceable' exception");
+    }catch(ExecuteException& e){
+        cout<< "successfully caught: " << e.what() << endl;
+    }
+
+    /* cancel */
+    string id4 = Execute_SendOrder(
+        creds, ACCT,
+        SimpleOrderBuilder::Equity::Build("SPY", 10, true, true, 90.00)
+        );
+    Execute_PaperSetQuote("SPY", 99.40, 99.50, 1000, 1000, 4000);
+    if( !Execute_CancelOrder(creds, ACCT, id4) )
+        throw std::runtime_error("paper cancel failed");
+    if( paper_order_status(creds, ACCT, id4) != "CANCELED" )
+        throw std::runtime_error("paper canceled order not CANCELED");
+    try{
+        Execute_CancelOrder(creds, ACCT, id4);
+        throw std::runtime_error("failed to catch 'not cancelable' exception");
+    }catch(ExecuteException& e){
+        cout<< "successfully caught: " << e.what() << endl;
+    }
+    try{
+        Execute_CancelOrder(creds, ACCT, "999999");
+        throw std::runtime_error("failed to catch 'order not found' exception");
+    }catch(InvalidRequest& e){
+        cout<< "successfully caught: " << e.what() << endl;
+    }
+
+    if( !paper_activity_count )
+        throw std::runtime_error("no paper activity callbacks");
+
+    Execute_PaperSetActivityCallback(nullptr);
+    Execute_PaperRemoveAccount(ACCT);
+    if( Execute_PaperIsAccount(ACCT) )
+        throw std::runtime_error("paper account wasn't removed");
+    Execute_PaperSetLiveQuotes(true);
+}
+
 /* LIVE ORDERS! */
 void
 test_execute_transactions(const std::string& account_id, Credentials& creds)
@@ -3,14 +3,25 @@
 #include <iomanip>
 #include <chrono>
 #include <ctime>
+#include <tuple>
+#include <cstring>
 
 #include "test.h"
 
 #include "tdma_api_get.h"
+#include "tdma_api_execute.h"
+#include "_json_parse.h"
+#include "_tdma_api.h"
+#include "_get.h"
 
 using namespace tdma;
 using namespace std;
 
+void json_parse();
+void record_reader();
+void rate_domains();
+void reserved_slots();
+
 void quote_getters(Credentials& c);
 void historical_getters(Credentials& c);
 
@@ -37,6 +48,18 @@ test_getters(const string& account_id, Credentials& creds)
 {
     using namespace chrono;
 
+    cout<< endl << "*** JSON PARSE ***" << endl;
+    json_parse();
+
+    cout<< endl << "*** RECORD READER ***" << endl;
+    record_reader();
+
+    cout<< endl << "*** RATE DOMAINS ***" << endl;
+    rate_domains();
+
+    cout<< endl << "*** RESERVED SLOTS ***" << endl;
+    reserved_slots();
+
     if( !APIGetter::is_sharing_connections() )
         throw new std::runtime_error("not sharing connections (default)");
 
@@ -646,6 +669,67 @@ check_option_chain_getter( const OptionChainGetter& o,
 }
 
 
+/* the typed array should match the json, calls first by expiration/strike */
+void
+check_option_quotes(const OptionChainGetter& o)
+{
+    if( !use_live_connection )
+        return;
+
+    auto quotes = o.get_quotes();
+    json j = o.get();
+    size_t ncontracts = 0;
+    for( auto m : {"callExpDateMap", "putExpDateMap"} ){
+        auto ji = j.find(m);
+        if( ji == j.end() )
+            continue;
+        for( auto& exp : *ji )
+            for( auto& strike : exp )
+                ncontracts += strike.size();
+    }
+    cout<< "option quotes: " << quotes.size() << endl;
+    if( quotes.size() != ncontracts )
+        throw runtime_error("option quotes don't match the json");
+
+    for( size_t i = 0; i < quotes.size(); ++i ){
+        const TDMA_OptionQuote& q = quotes[i];
+        if( !q.symbol[0] )
+            throw runtime_error("option quote has no symbol");
+        if( i == 0 )
+            continue;
+        const TDMA_OptionQuote& p = quotes[i-1];
+        if( std::make_tuple(p.is_put, p.expiration, p.strike)
+            > std::make_tuple(q.is_put, q.expiration, q.strike) )
+            throw runtime_error("option quotes out of order");
+    }
+}
+
+void
+check_candles(const HistoricalGetterBase& hg)
+{
+    if( !use_live_connection )
+        return;
+
+    auto candles = hg.get_candles();
+    json jc = hg.get()["candles"];
+    cout<< "candles: " << candles.size() << endl;
+    if( candles.size() != jc.size() )
+        throw runtime_error("candles don't match the json");
+    if( candles.empty() )
+        return;
+
+    const TDMA_Candle& c = candles[0];
+    if( c.datetime != jc[0]["datetime"].get<long long>()
+        || c.open != jc[0]["open"].get<double>()
+        || c.close != jc[0]["close"].get<double>()
+        || c.volume != jc[0]["volume"].get<long long>() )
+        throw runtime_error("first candle doesn't match the json");
+    for( size_t i = 1; i < candles.size(); ++i ){
+        if( candles[i].datetime < candles[i-1].datetime )
+            throw runtime_error("candles out of order");
+    }
+}
+
 void option_chain_analytical_getter(Credentials& c)
 {
     auto strikes = OptionStrikes::Single(65.00);
@@ -708,6 +792,13 @@ void option_chain_strategy_getter(Credentials& c)
     if( ocg.get_strategy() != strategy )
         throw runtime_error("invalid strategy");
 
+    try{
+        ocg.get_quotes();
+        throw runtime_error("failed to catch exception for strategy get_quotes");
+    }catch(TypeException& e){
+        cout<< "succesfully caught: " << e << endl;
+    }
+
     Get(ocg);
 
     OptionChainStrategyGetter ocg2(move(ocg));
@@ -760,6 +851,7 @@ void option_chain_getter(Credentials& c)
                               OptionExpMonth::all, OptionType::all);
 
     Get(ocg);
+    check_option_quotes(ocg);
 
     strikes = OptionStrikes::Single(70.00);
     ocg.set_strikes(strikes);
@@ -944,6 +1036,7 @@ historical_getters(Credentials& c)
     }
 
     Get(hrg);
+    check_candles(hrg);
 
     try{
         hrg.set_frequency(FrequencyType::minute, 31);
@@ -1119,3 +1212,288 @@ quote_getters(Credentials& c)
 
 
 
+
+
+/* type, order and (float) bits must match json::parse */
+bool
+same_json(const json& a, const json& b)
+{
+    if( a.type() != b.type() )
+        return false;
+    if( a.is_object() ){
+        if( a.size() != b.size() )
+            return false;
+        for( auto i = a.begin(), j = b.begin(); i != a.end(); ++i, ++j ){
+            if( i.key() != j.key() || !same_json(*i, *j) )
+                return false;
+        }
+        return true;
+    }
+    if( a.is_array() ){
+        if( a.size() != b.size() )
+            return false;
+        for( size_t i = 0; i < a.size(); ++i ){
+            if( !same_json(a[i], b[i]) )
+                return false;
+        }
+        return true;
+    }
+    if( a.is_number_float() ){
+        double x = a, y = b;
+        return memcmp(&x, &y, sizeof(double)) == 0;
+    }
+    return a == b;
+}
+
+void
+json_parse()
+{
+    /* long keys/strings so escapes and quotes straddle 64 byte blocks */
+    string pad(61, 'x');
+    vector<string> good = {
+        "{}", "[]", "0", "-0", "null", "true", "false", "\"\"",
+        " \t\r\n[ 1 , 2 ,\n3 ] ",
+        "[1.5,-2.25e-3,1E10,0.1,1e308,4.9e-324,123456789012345678]",
+        "[18446744073709551615,-9223372036854775808,9223372036854775807]",
+        "{\"a\":{\"b\":[{\"c\":[]},{}]},\"d\":\"e\",\"a\":1}",
+        "{\"esc\":\"\\\"\\\\\\/\\b\\f\\n\\r\\t\\u00e9\\ud83d\\ude00\"}",
+        "{\"" + pad + "\\\"\":\"" + pad + "\\\\\",\"k\":[\"}\",\"]\",\",\"]}",
+        "[\"" + pad + "\\\\\\\"" + pad + "\",{\"" + pad + "\":-1.0}]",
+        "{\"data\":[{\"service\":\"QUOTE\",\"timestamp\":1540498491042,"
+        "\"command\":\"SUBS\",\"content\":[{\"key\":\"SPY\",\"1\":275.47,"
+        "\"2\":275.49,\"3\":275.48,\"4\":2,\"5\":7,\"8\":64431581,"
+        "\"delayed\":false,\"assetMainType\":\"EQUITY\"}]}]}"
+    };
+    vector<string> bad = {
+        "", "[", "{\"a\"}", "[1,]", "{\"a\":1,}", "\"\\x\"", "[01]", "tru",
+        "[1] [2]", "{\"" + pad + "\":\"" + pad
+    };
+
+    vector<JsonIndexBackend> backends = {
+        JsonIndexBackend::scalar, JsonIndexBackend::sse42,
+        JsonIndexBackend::avx2
+    };
+    JsonIndexBackend best = get_json_index_backend();
+
+    for( auto b : backends ){
+        if( !set_json_index_backend(b) )
+            continue;
+        cout<< "backend " << static_cast<int>(b) << endl;
+        for( auto& s : good ){
+            if( !same_json(parse_json(s), json::parse(s)) )
+                throw std::runtime_error("parse_json != json::parse: " + s);
+        }
+        for( auto& s : bad ){
+            try{
+                parse_json(s);
+                throw std::runtime_error("parse_json accepted: " + s);
+            }catch(json::parse_error& e){
+            }
+        }
+    }
+    set_json_index_backend(best);
+}
+
+
+/* slots are per rate domain and only good once (paper account, offline) */
+void
+reserved_slots()
+{
+    using namespace chrono;
+    const string ACCT = "PAPER_SLOTS";
+
+    Credentials ca("x", "x", 0, "SLOT_TEST_A");
+    Credentials cb("x", "x", 0, "SLOT_TEST_B");
+    milliseconds wait = APIGetter::get_wait_msec();
+    APIGetter::set_wait_msec( milliseconds(1000) );
+
+    QuoteGetter ga(ca, "SPY");
+    QuoteGetter gb(cb, "SPY");
+    auto a1 = ga.reserve_slot();
+    auto a2 = ga.reserve_slot();
+    auto b1 = gb.reserve_slot();
+    cout<< "slots (delay): A " << a1.second.count() << ", "
+        << a2.second.count() << "  B " << b1.second.count() << endl;
+    if( a2.first - a1.first < 1000 )
+        throw std::runtime_error("domain A slots not spaced by wait");
+    if( b1.second >= a2.second )
+        throw std::runtime_error("domain B queued behind domain A");
+
+    try{
+        ga.get_in_slot(1);
+        throw std::runtime_error("failed to catch 'unreserved slot' exception");
+    }catch(ValueException& e){
+        cout<< "successfully caught: " << e.what() << endl;
+    }
+    try{
+        gb.get_in_slot(a2.first);
+        throw std::runtime_error("failed to catch 'other domain' exception");
+    }catch(ValueException& e){
+        cout<< "successfully caught: " << e.what() << endl;
+    }
+
+    Execute_PaperAddAccount(ACCT);
+    Execute_PaperSetLiveQuotes(false);
+    Execute_PaperSetQuote("SPY", 99.99, 100.01, 1000, 1000, 1000);
+    string id = Execute_SendOrder(
+        ca, ACCT, SimpleOrderBuilder::Equity::Build("SPY", 10, true, true)
+        );
+
+    OrderGetter og(ca, ACCT, id);
+    auto s = og.reserve_slot();
+    if( og.get_in_slot(s.first)["status"] != "FILLED" )
+        throw std::runtime_error("bad paper order from get_in_slot");
+    try{
+        og.get_in_slot(s.first);
+        throw std::runtime_error("failed to catch 'used slot' exception");
+    }catch(ValueException& e){
+        cout<< "successfully caught: " << e.what() << endl;
+    }
+
+    Execute_PaperRemoveAccount(ACCT);
+    Execute_PaperSetLiveQuotes(true);
+    APIGetter::set_wait_msec(wait);
+}
+
+
+/* records decoded straight from the text (as by get_candles/get_quotes) */
+class TestRecordReader
+        : public JsonRecordReader {
+public:
+    vector<pair<int, map<std::string, double>>> records;
+
+    TestRecordReader()
+        : JsonRecordReader(5, {"callExpDateMap", "putExpDateMap"})
+        {}
+
+protected:
+    void
+    begin_record(int root)
+    { records.emplace_back(root, map<std::string, double>()); }
+
+    void
+    field(const std::string& key, const Value& v)
+    {
+        records.back().second[key] =
+            (v.type == Value::BOOLEAN) ? v.as_bool() : v.as_double();
+        if( key == "size" )
+            records.back().second[key] = static_cast<double>(v.as_llong());
+    }
+};
+
+void
+record_reader()
+{
+    const std::string CHAIN =
+        "{\"symbol\":\"SPY\",\"bid\":1.0,"
+        " \"callExpDateMap\":{\"2019-01-18:3\":{"
+        "   \"100.0\":[{\"bid\":1.5,\"ask\":\"NaN\",\"size\":12.9,"
+        "              \"inTheMoney\":true,\"list\":[{\"bid\":9}],"
+        "              \"obj\":{\"ask\":9}, \"s\":\"x\"}],"
+        "   \"101.0\":[{\"bid\":-2,\"ask\":\"3.25\",\"size\":7}]}},"
+        " \"putExpDateMap\":{\"2019-01-18:3\":{"
+        "   \"100.0\":[{\"bid\":null,\"ask\":\"abc\",\"inTheMoney\":false}]}},"
+        " \"other\":{\"a\":{\"b\":{\"c\":[{\"bid\":99}]}}}}";
+
+    TestRecordReader r;
+    r.read(CHAIN);
+    if( r.records.size() != 3 )
+        throw std::runtime_error("bad # of records: "
+                                 + to_string(r.records.size()));
+
+    auto& c1 = r.records[0];
+    auto& c2 = r.records[1];
+    auto& p1 = r.records[2];
+    if( c1.first != 0 || c2.first != 0 || p1.first != 1 )
+        throw std::runtime_error("bad record roots");
+    if( c1.second.size() != 5 || c1.second["bid"] != 1.5
+        || !std::isnan(c1.second["ask"]) || c1.second["size"] != 12
+        || c1.second["inTheMoney"] != 1 || !std::isnan(c1.second["s"]) )
+    {
+        throw std::runtime_error("bad record #1");
+    }
+    if( c2.second["bid"] != -2 || c2.second["ask"] != 3.25
+        || c2.second["size"] != 7 )
+    {
+        throw std::runtime_error("bad record #2");
+    }
+    if( p1.second.count("bid") || !std::isnan(p1.second["ask"])
+        || p1.second["inTheMoney"] != 0 )
+    {
+        throw std::runtime_error("bad record #3");
+    }
+    cout<< "records: " << r.records.size() << endl;
+
+    TestRecordReader empty;
+    empty.read("");
+    empty.read("{\"symbol\":\"SPY\",\"status\":\"FAILED\"}");
+    if( !empty.records.empty() )
+        throw std::runtime_error("records from empty response");
+
+    try{
+        TestRecordReader bad;
+        bad.read("{\"callExpDateMap\":{\"a\":{\"b\":[{\"bid\":1.0,]}}}");
+        throw std::runtime_error("failed to catch invalid json");
+    }catch(std::runtime_error&){
+        throw;
+    }catch(std::exception& e){
+        cout<< "successfully caught: " << e.what() << endl;
+    }
+}
+
+
+/* each client_id is throttled on its own (offline, w/ reserved slots) */
+void
+rate_domains()
+{
+    using namespace chrono;
+    const string A = "DOMAIN_TEST_A";
+    const string B = "DOMAIN_TEST_B";
+
+    Credentials ca("x", "x", 0, A.c_str());
+    Credentials cb("x", "x", 0, B.c_str());
+    milliseconds wait = APIGetter::get_wait_msec();
+    APIGetter::set_wait_msec( milliseconds(500) );
+
+    QuoteGetter ga(ca, "SPY");
+    QuoteGetter gb(cb, "SPY");
+    auto domains = APIGetter::get_rate_domains();
+    if( !domains.count(A) || !domains.count(B) )
+        throw std::runtime_error("missing rate domain(s)");
+
+    GetterRateDomainStats sa = APIGetter::get_rate_domain_stats(A);
+    if( sa.ngets || sa.nthrottled || sa.nerrors || sa.wait_msec )
+        throw std::runtime_error("stats of a new rate domain not zero");
+
+    /* A's queue is 2 sec deep, B's isn't */
+    for( int i = 0; i < 4; ++i )
+        ga.reserve_slot();
+
+    auto beg = steady_clock::now();
+    milliseconds wa = APIGetter::wait_remaining(A);
+    milliseconds wb = APIGetter::wait_remaining(B);
+    milliseconds wall = APIGetter::wait_remaining();
+    auto took = duration_cast<milliseconds>(steady_clock::now() - beg);
+    cout<< "wait remaining: A " << wa.count() << ", B " << wb.count()
+        << ", all " << wall.count() << " (" << took.count() << " msec)"
+        << endl;
+    if( wa < milliseconds(1500) || wb > milliseconds(500) || wall < wa )
+        throw std::runtime_error("bad wait remaining");
+    if( took > milliseconds(100) )
+        throw std::runtime_error("wait_remaining blocked");
+
+    sa = APIGetter::get_rate_domain_stats(A);
+    if( sa.wait_remaining_msec < 1500 )
+        throw std::runtime_error("bad stats wait_remaining_msec");
+
+    if( APIGetter::wait_remaining("DOMAIN_TEST_NONE").count() != 0 )
+        throw std::runtime_error("wait remaining for an unknown client_id");
+    try{
+        APIGetter::get_rate_domain_stats("DOMAIN_TEST_NONE");
+        throw std::runtime_error("failed to catch 'no rate domain' exception");
+    }catch(ValueException& e){
+        cout<< "successfully caught: " << e.what() << endl;
+    }
+
+    APIGetter::set_wait_msec(wait);
+}
@@ -58,6 +58,14 @@ int main(int argc, char* argv[])
         cout<< "*** [BEGIN] TEST EXECUTION ORDER OBJECTS [BEGIN] ***" << endl;
         test_execution_order_objects();
         cout<< "*** [END] TEST EXECUTION ORDER OBJECTS [END] ***" << endl << endl;
+
+        cout<< "*** [BEGIN] TEST EXECUTION REPLACE ORDER [BEGIN] ***" << endl;
+        test_execute_replace_order(account_id, cmanager.credentials);
+        cout<< "*** [END] TEST EXECUTION REPLACE ORDER [END] ***" << endl << endl;
+
+        cout<< "*** [BEGIN] TEST EXECUTION PAPER BROKER [BEGIN] ***" << endl;
+        test_execute_paper_broker(cmanager.credentials);
+        cout<< "*** [END] TEST EXECUTION PAPER BROKER [END] ***" << endl << endl;
       
         // THIS SENDS LIVE ORDERS
         //cout<< "*** [BEGIN] TEST EXECUTION TRANSACTIONS [BEGIN] ***" << endl;
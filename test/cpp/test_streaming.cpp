@@ -1,8 +1,20 @@
 #include <iostream>
+#include <mutex>
+#include <unordered_set>
+#include <cmath>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif /* _WIN32 */
 
 #include "test.h"
 
 #include "tdma_api_streaming.h"
+#include "_streaming_shm.h"
+#include "_streaming_spreads.h"
+#include "_streaming_iv_surface.h"
+#include "_streaming_router.h"
 
 using namespace tdma;
 using namespace std;
@@ -123,6 +135,443 @@ test_raw_subscription( RawSubscription& sub,
         throw std::runtime_error(name + ": bad parameters");
 }
 
+std::mutex filtered_mtx;
+std::set<std::string> filtered_symbols;
+
+void
+filtered_callback( int cb_type,
+                   int ss_type,
+                   unsigned long long timestamp,
+                   const char* msg )
+{
+    if( cb_type != static_cast<int>(StreamingCallbackType::data)
+        || ss_type != static_cast<int>(StreamerServiceType::QUOTE) )
+        return;
+
+    std::lock_guard<std::mutex> _(filtered_mtx);
+    for( auto& item : json::parse(string(msg)) )
+        filtered_symbols.insert( item["key"].get<string>() );
+}
+
+/* only SPY should get through the symbol filter */
+void
+test_streaming_filters(Credentials& c)
+{
+    using namespace chrono;
+    using ft = QuotesSubscription::FieldType;
+
+    auto ss = StreamingSession::Create(c, filtered_callback);
+
+    try{
+        ss->set_filter_symbols(StreamerServiceType::NONE, {"SPY"});
+        throw std::runtime_error("failed to catch 'invalid service' exception");
+    }catch(ValueException& e){
+        cout<< "successfully caught: " << e.what() << endl;
+    }
+    try{
+        ss->add_filter_rule( StreamerServiceType::QUOTE, ft::last_price,
+                             StreamingFilterRuleType::delta, 0.0 );
+        throw std::runtime_error("failed to catch 'delta threshold' exception");
+    }catch(ValueException& e){
+        cout<< "successfully caught: " << e.what() << endl;
+    }
+    try{
+        ss->add_filter_rule( StreamerServiceType::QUOTE, -1,
+                             StreamingFilterRuleType::changed );
+        throw std::runtime_error("failed to catch 'field < 0' exception");
+    }catch(ValueException& e){
+        cout<< "successfully caught: " << e.what() << endl;
+    }
+
+    ss->set_filter_symbols(StreamerServiceType::QUOTE, {"SPY"});
+
+    QuotesSubscription q( {"SPY", "QQQ"},
+                          {ft::symbol, ft::bid_price, ft::ask_price,
+                           ft::last_price} );
+    if( !ss->start(q) )
+        throw std::runtime_error("failed to start filtered session");
+    std::this_thread::sleep_for( seconds(5) );
+    ss->stop();
+
+    auto stats = ss->get_filter_stats(StreamerServiceType::QUOTE);
+    cout<< "filter stats (passed, dropped): " << stats.first << ", "
+        << stats.second << endl;
+    {
+        std::lock_guard<std::mutex> _(filtered_mtx);
+        if( filtered_symbols.count("QQQ") )
+            throw std::runtime_error("filter passed QQQ");
+        if( filtered_symbols.count("SPY") && stats.first == 0 )
+            throw std::runtime_error("filter didn't count passed items");
+    }
+
+    ss->clear_filter(StreamerServiceType::NONE);
+    stats = ss->get_filter_stats(StreamerServiceType::QUOTE);
+    if( stats.first || stats.second )
+        throw std::runtime_error("filter stats not cleared");
+}
+
+std::mutex routed_mtx;
+std::set<std::string> routed_symbols;
+std::set<std::string> unrouted_symbols;
+
+void
+insert_quote_keys( std::set<std::string>& keys,
+                   int cb_type,
+                   int ss_type,
+                   const char* msg )
+{
+    if( cb_type != static_cast<int>(StreamingCallbackType::data)
+        || ss_type != static_cast<int>(StreamerServiceType::QUOTE) )
+        return;
+
+    std::lock_guard<std::mutex> _(routed_mtx);
+    for( auto& item : json::parse(string(msg)) )
+        keys.insert( item["key"].get<string>() );
+}
+
+void
+routed_callback( int cb_type,
+                 int ss_type,
+                 unsigned long long timestamp,
+                 const char* msg )
+{ insert_quote_keys(routed_symbols, cb_type, ss_type, msg); }
+
+void
+unrouted_callback( int cb_type,
+                   int ss_type,
+                   unsigned long long timestamp,
+                   const char* msg )
+{ insert_quote_keys(unrouted_symbols, cb_type, ss_type, msg); }
+
+/* SPY to the route, everything else to the session's callback */
+void
+test_streaming_routes(Credentials& c)
+{
+    using namespace chrono;
+    using ft = QuotesSubscription::FieldType;
+
+    auto ss = StreamingSession::Create(c, unrouted_callback);
+
+    try{
+        ss->add_route(StreamerServiceType::NONE, routed_callback);
+        throw std::runtime_error("failed to catch 'invalid service' exception");
+    }catch(ValueException& e){
+        cout<< "successfully caught: " << e.what() << endl;
+    }
+    try{
+        ss->add_route(StreamerServiceType::QUOTE, string(), routed_callback);
+        throw std::runtime_error("failed to catch 'empty symbol' exception");
+    }catch(ValueException& e){
+        cout<< "successfully caught: " << e.what() << endl;
+    }
+    try{
+        ss->add_route(StreamerServiceType::QUOTE, "SPY", nullptr);
+        throw std::runtime_error("failed to catch 'null callback' exception");
+    }catch(ValueException& e){
+        cout<< "successfully caught: " << e.what() << endl;
+    }
+    try{
+        ss->remove_route(-1);
+        throw std::runtime_error("failed to catch 'invalid route id' exception");
+    }catch(ValueException& e){
+        cout<< "successfully caught: " << e.what() << endl;
+    }
+
+    int id = ss->add_route(StreamerServiceType::QUOTE, "spy", routed_callback);
+
+    QuotesSubscription q( {"SPY", "QQQ"},
+                          {ft::symbol, ft::bid_price, ft::ask_price,
+                           ft::last_price} );
+    if( !ss->start(q) )
+        throw std::runtime_error("failed to start routed session");
+    std::this_thread::sleep_for( seconds(5) );
+    ss->stop();
+
+    {
+        std::lock_guard<std::mutex> _(routed_mtx);
+        cout<< "routed: " << routed_symbols.size() << " symbol(s), "
+            << "catch-all: " << unrouted_symbols.size() << " symbol(s)"
+            << endl;
+        if( !routed_symbols.count("SPY") )
+            throw std::runtime_error("route didn't get SPY");
+        if( !unrouted_symbols.count("QQQ") )
+            throw std::runtime_error("catch-all didn't get QQQ");
+        if( routed_symbols.count("QQQ") )
+            throw std::runtime_error("route got QQQ");
+        if( unrouted_symbols.count("SPY") )
+            throw std::runtime_error("catch-all got routed SPY");
+        routed_symbols.clear();
+        unrouted_symbols.clear();
+    }
+
+    ss->remove_route(id);
+    try{
+        ss->remove_route(id);
+        throw std::runtime_error("failed to catch 'removed route' exception");
+    }catch(ValueException& e){
+        cout<< "successfully caught: " << e.what() << endl;
+    }
+
+    id = ss->add_route(StreamerServiceType::QUOTE, routed_callback);
+    ss->clear_routes();
+    try{
+        ss->remove_route(id);
+        throw std::runtime_error("failed to catch 'cleared route' exception");
+    }catch(ValueException& e){
+        cout<< "successfully caught: " << e.what() << endl;
+    }
+}
+
+#ifndef _WIN32
+
+/* publisher (no session needed) -> shared ring -> subscriber, offline */
+void
+test_streaming_shm()
+{
+    using namespace chrono;
+    const string NAME = "tdma_api_test_shm";
+    StreamingSubscriber::Item item;
+
+    {
+        auto pub = std::unique_ptr<StreamingPublisherImpl>(
+            new StreamingPublisherImpl(NAME, 16, 256) );
+        try{
+            StreamingPublisherImpl pub2(NAME, 16, 256);
+            throw std::runtime_error("second publisher replaced a live one");
+        }catch(StreamingException& e){
+            cout<< "successfully caught: " << e.what() << endl;
+        }
+
+        StreamingSubscriber sub(NAME);
+        if( !sub.is_publisher_active() )
+            throw std::runtime_error("shm publisher not active");
+        sub.set_services({StreamerServiceType::QUOTE});
+        sub.set_symbols({"SPY"});
+
+        pub->publish( StreamingCallbackType::data, StreamerServiceType::QUOTE,
+                      1000, json::parse("[{\"key\":\"SPY\",\"1\":99.5},"
+                                        "{\"key\":\"QQQ\",\"1\":150.25}]") );
+        pub->publish( StreamingCallbackType::data, StreamerServiceType::OPTION,
+                      1001, json::parse("[{\"key\":\"SPY\",\"1\":1.5}]") );
+        pub->publish( StreamingCallbackType::notify,
+                      StreamerServiceType::NONE, 1002, json() );
+
+        if( !sub.next(item) )
+            throw std::runtime_error("shm: no SPY item");
+        if( item.callback_type != static_cast<int>(StreamingCallbackType::data)
+            || item.service_type != static_cast<int>(StreamerServiceType::QUOTE)
+            || item.timestamp != 1000 || string(item.symbol) != "SPY" )
+            throw std::runtime_error("shm: bad SPY item header");
+        json j = json::parse( string(item.data, item.data_len) );
+        if( j["key"] != "SPY" || j["1"].get<double>() != 99.5 )
+            throw std::runtime_error("shm: bad SPY item data");
+        if( !sub.is_valid(item) )
+            throw std::runtime_error("shm: SPY item not valid");
+
+        /* non-data items always pass */
+        if( !sub.next(item) || item.callback_type
+            != static_cast<int>(StreamingCallbackType::notify) )
+            throw std::runtime_error("shm: no heartbeat item");
+        if( sub.next(item) )
+            throw std::runtime_error("shm: unexpected item");
+        if( sub.get_ndropped() )
+            throw std::runtime_error("shm: dropped items");
+
+        /* lapped: 40 items into 16 slots */
+        sub.set_services({});
+        sub.set_symbols({});
+        for( int i = 0; i < 40; ++i ){
+            pub->publish( StreamingCallbackType::data,
+                          StreamerServiceType::QUOTE, 2000 + i,
+                          json::array({{{"key","SYM" + std::to_string(i)}}}) );
+        }
+        int n = 0;
+        unsigned long long last = 0;
+        while( sub.next(item) ){
+            ++n;
+            last = item.timestamp;
+        }
+        if( n != 16 || last != 2039 || sub.get_ndropped() != 24 )
+            throw std::runtime_error("shm: bad lapped read");
+
+        pub.reset();
+        if( sub.is_publisher_active() )
+            throw std::runtime_error("shm publisher still active");
+    }
+
+    /* a segment left by a dead publisher is replaced */
+    pid_t pid = fork();
+    if( pid == 0 ){
+        new StreamingPublisherImpl(NAME, 16, 256);
+        _exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    {
+        StreamingPublisherImpl pub(NAME, 16, 256);
+        StreamingSubscriber sub(NAME);
+        if( !sub.is_publisher_active() )
+            throw std::runtime_error("shm: stale segment not replaced");
+    }
+}
+
+#endif /* _WIN32 */
+
+/* only legs of spreads that have been added are tracked */
+void
+test_streaming_spreads()
+{
+    auto quote = [](const string& sym, double bid, double ask){
+        return json{ {"key", sym}, {"1", bid}, {"2", ask} };
+    };
+    StreamingSpreadEngine engine;
+
+    /* nothing tracked w/o spreads */
+    engine.update( StreamerServiceType::QUOTE, 1,
+                   json{ quote("SPY", 100, 101), quote("QQQ", 50, 51) } );
+    int id = engine.add_spread( {{"SPY", 1}, {"QQQ", -2}} );
+    if( engine.get_quote(id).is_valid )
+        throw std::runtime_error("spread priced from untracked legs");
+
+    engine.update( StreamerServiceType::QUOTE, 2,
+                   json{ quote("SPY", 100, 101), quote("QQQ", 50, 51),
+                         quote("IWM", 20, 21) } );
+    SpreadQuote q = engine.get_quote(id);
+    if( !q.is_valid || q.bid != -2 || q.ask != 1 || q.mid != -0.5
+        || q.timestamp != 2 )
+    {
+        throw std::runtime_error("bad spread quote");
+    }
+
+    /* a leg of a removed spread isn't forgotten by the others */
+    int id2 = engine.add_spread( {{"SPY", 1}} );
+    engine.remove_spread(id);
+    engine.update( StreamerServiceType::QUOTE, 3,
+                   json{ quote("SPY", 102, 103) } );
+    if( engine.get_quote(id2).bid != 102 )
+        throw std::runtime_error("bad single leg spread quote");
+    engine.remove_spread(id2);
+    try{
+        engine.get_quote(id2);
+        throw std::runtime_error("failed to catch 'invalid spread id'");
+    }catch(ValueException& e){
+        cout<< "successfully caught: " << e.what() << endl;
+    }
+    cout<< "spreads: OK" << endl;
+}
+
+
+/* the surface does nothing until it's enabled */
+void
+test_streaming_iv_surface()
+{
+    auto f = [](OptionsSubscriptionField field){
+        return to_string( static_cast<int>(field) );
+    };
+    json msg = json::array();
+    for( int strike : {90, 100, 110} ){
+        msg.push_back( {
+            {"key", "XYZ_011599C" + to_string(strike)},
+            {f(OptionsSubscriptionField::underlying), "XYZ"},
+            {f(OptionsSubscriptionField::expiration_year), 2099},
+            {f(OptionsSubscriptionField::expiration_month), 1},
+            {f(OptionsSubscriptionField::expiration_day), 15},
+            {f(OptionsSubscriptionField::strike_price), strike},
+            {f(OptionsSubscriptionField::contract_type), "C"},
+            {f(OptionsSubscriptionField::underlying_price), 100.0},
+            {f(OptionsSubscriptionField::volatility), 25.0}
+        } );
+    }
+
+    IVSurfaceEngine engine;
+    auto has_surface = [&](){
+        try{
+            engine.get_vol("XYZ", 100, 30);
+            return true;
+        }catch(ValueException&){
+            return false;
+        }
+    };
+
+    if( engine.is_enabled() )
+        throw std::runtime_error("iv surface enabled by default");
+    engine.update(StreamerServiceType::OPTION, msg);
+    engine.refit();
+    if( has_surface() )
+        throw std::runtime_error("disabled iv surface was updated");
+
+    engine.set_enabled(true);
+    engine.update(StreamerServiceType::OPTION, msg);
+    engine.refit();
+    double v = engine.get_vol("XYZ", 100, 30);
+    if( fabs(v - 25.0) > 1e-9 )
+        throw std::runtime_error("bad iv surface vol: " + to_string(v));
+
+    engine.set_enabled(false);
+    if( has_surface() )
+        throw std::runtime_error("disabled iv surface wasn't dropped");
+    cout<< "iv surface: OK" << endl;
+}
+
+
+/* hand-built messages through the router (no session) */
+void
+test_streaming_router()
+{
+    auto quotes = [](std::initializer_list<const char*> symbols){
+        json j = json::array();
+        for( auto s : symbols )
+            j.push_back( {{"key", s}, {"1", 1.0}, {"2", 2.0}} );
+        return j;
+    };
+    auto keys = [](const json& j){
+        std::set<std::string> k;
+        for( auto& item : j )
+            k.insert( item["key"].get<string>() );
+        return k;
+    };
+    StreamingRouter router;
+    json unrouted;
+
+    int spy = router.add_route(StreamerServiceType::QUOTE, {"SPY"},
+                               routed_callback);
+    router.add_route(StreamerServiceType::OPTION, {}, routed_callback);
+
+    if( !router.route(StreamerServiceType::QUOTE, 1,
+                      quotes({"QQQ", "SPY", "IWM"}), unrouted) )
+        throw std::runtime_error("SPY wasn't routed");
+    if( keys(unrouted) != std::set<std::string>{"QQQ", "IWM"} )
+        throw std::runtime_error("bad unrouted items: " + unrouted.dump());
+    {
+        std::lock_guard<std::mutex> _(routed_mtx);
+        if( routed_symbols != std::set<std::string>{"SPY"} )
+            throw std::runtime_error("route didn't get (just) SPY");
+        routed_symbols.clear();
+    }
+
+    unrouted = json();
+    if( router.route(StreamerServiceType::QUOTE, 2, quotes({"QQQ"}),
+                     unrouted) )
+        throw std::runtime_error("QQQ was routed");
+    if( !router.route(StreamerServiceType::OPTION, 3, quotes({"SPY_C"}),
+                      unrouted) || !unrouted.empty() )
+        throw std::runtime_error("OPTION wasn't routed whole");
+
+    router.remove_route(spy);
+    if( router.route(StreamerServiceType::QUOTE, 4, quotes({"SPY"}),
+                     unrouted) )
+        throw std::runtime_error("removed route was used");
+    router.clear();
+    if( router.route(StreamerServiceType::OPTION, 5, quotes({"SPY_C"}),
+                     unrouted) )
+        throw std::runtime_error("cleared route was used");
+
+    std::lock_guard<std::mutex> _(routed_mtx);
+    routed_symbols.clear();
+    cout<< "router: OK" << endl;
+}
+
+
 void
 test_streaming(const string& account_id, Credentials& c)
 {
@@ -165,6 +614,42 @@ test_streaming(const string& account_id, Credentials& c)
         if( q1 != qz )
             throw std::runtime_error("subscription q1 != qz");
     }
+    // test hash (equal subs hash the same; symbol case/order don't matter)
+    {
+        QuotesSubscription h1({"spy", "qqq"}, {ft::bid_price, ft::ask_price});
+        QuotesSubscription h2({"QQQ", "SPY"}, {ft::ask_price, ft::bid_price});
+        if( h1 != h2 )
+            throw std::runtime_error("subscription h1 != h2");
+        if( h1.hash() != h2.hash() )
+            throw std::runtime_error("subscription h1.hash() != h2.hash()");
+
+        QuotesSubscription h3(h1);
+        h3.set_command(CommandType::UNSUBS);
+        if( h3 == h1 )
+            throw std::runtime_error("subscription h3 == h1 (command)");
+        QuotesSubscription h4(h1);
+        h4.set_fields({ft::bid_price});
+        if( h4 == h1 )
+            throw std::runtime_error("subscription h4 == h1 (fields)");
+        QuotesSubscription h5(h1);
+        h5.set_symbols({"SPY"});
+        if( h5 == h1 )
+            throw std::runtime_error("subscription h5 == h1 (symbols)");
+
+        QuotesSubscription h6( std::move(h2) );
+        if( h6 != h1 || h6.hash() != h1.hash() )
+            throw std::runtime_error("subscription h6 != h1 (MOVE)");
+
+        unordered_set<QuotesSubscription, StreamingSubscription::Hash> hs{
+            h1, h3, h4, h5, h6
+        };
+        if( hs.size() != 4 )
+            throw std::runtime_error("bad hashed subscription set size");
+        if( !hs.count( QuotesSubscription({"SPY", "QQQ"},
+                                          {ft::bid_price, ft::ask_price}) ) )
+            throw std::runtime_error("hashed subscription set lookup failed");
+    }
+
     symbols1 = {"spy"};
     fields1 = {ft::symbol, ft::last_price};
     QuotesSubscription q1(symbols1, fields1);
@@ -409,6 +894,13 @@ test_streaming(const string& account_id, Credentials& c)
     RawSubscription q20( "NASDAQ_BOOK", "SUBS",
                           {{"keys","GOOG,APPL"}, {"fields", "0,1,2"}} );
 
+#ifndef _WIN32
+    test_streaming_shm();
+#endif /* _WIN32 */
+    test_streaming_spreads();
+    test_streaming_iv_surface();
+    test_streaming_router();
+
     if( !use_live_connection ){
           cout<< "CAN NOT TEST STREAMING SESSION W/O LIVE CONNECTION" << endl;
           return;
@@ -520,4 +1012,6 @@ test_streaming(const string& account_id, Credentials& c)
         auto ss4 = std::move(ss2);
     }
 
+    test_streaming_filters(c);
+    test_streaming_routes(c);
 }
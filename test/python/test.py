@@ -312,6 +312,39 @@ def test_historical_period_getters(creds):
     assert gg.is_extended_hours() == True
     assert gg.get_msec_since_epoch() == days_ago_70
 
+def _field(rec, name):
+    # numpy record or ctypes Structure
+    return rec[name] if hasattr(rec, 'dtype') else getattr(rec, name)
+
+def check_candles(g):
+    if not use_live_connection:
+        return
+    c = g.get_candles()
+    j = g.get()["candles"]
+    print("+ candles:", len(c))
+    assert len(c) == len(j)
+    if len(c):
+        assert _field(c[0], 'datetime') == j[0]['datetime']
+        assert _field(c[0], 'close') == j[0]['close']
+        assert _field(c[0], 'volume') == j[0]['volume']
+    for i in range(1, len(c)):
+        assert _field(c[i-1], 'datetime') <= _field(c[i], 'datetime')
+
+def check_option_quotes(g):
+    if not use_live_connection:
+        return
+    q = g.get_quotes()
+    j = g.get()
+    n = sum(len(contracts) for m in ("callExpDateMap", "putExpDateMap")
+            for exp in j.get(m, {}).values() for contracts in exp.values())
+    print("+ option quotes:", len(q))
+    assert len(q) == n
+    key = lambda r: tuple(_field(r, f) for f in ('is_put','expiration','strike'))
+    for i in range(len(q)):
+        assert _field(q[i], 'symbol')
+        if i:
+            assert key(q[i-1]) <= key(q[i])
+
 def test_historical_range_getters(creds):
     ft = get.FREQUENCY_TYPE_MINUTE
     f = get.VALID_FREQUENCIES_BY_FREQUENCY_TYPE[ft][-1]
@@ -330,6 +363,7 @@ def test_historical_range_getters(creds):
     assert g.is_extended_hours() == False
     j = Get(g)
     jprint(j)
+    check_candles(g)
 
     ft = get.FREQUENCY_TYPE_DAILY
     f = get.VALID_FREQUENCIES_BY_FREQUENCY_TYPE[ft][0]
@@ -381,6 +415,7 @@ def test_option_chain_getters(creds):
     assert g.get_option_type() == get.OPTION_TYPE_ALL
     j = Get(g)
     jprint(j)
+    check_option_quotes(g)
 
     strikes = get.OptionStrikes.RANGE(get.OPTION_RANGE_TYPE_ITM)
     from_date = "2019-01-01"
@@ -418,6 +453,11 @@ def test_option_chain_strategy_getters(creds):
                                       get.OPTION_TYPE_ALL)
     assert g.get_symbol() == 'KORS'
     assert g.get_strategy() == strategy
+    try:
+        g.get_quotes()
+        raise Exception("failed to catch exception(1)")
+    except clib.CLibException as e:
+        print("+ successfully caught exception: ", str(e))
     assert g.get_strikes() == strikes
     assert g.get_contract_type() == get.OPTION_CONTRACT_TYPE_CALL
     assert g.includes_quotes() == True
@@ -815,6 +855,19 @@ def test_streaming(creds):
     assert qs.get_service() == stream.SERVICE_TYPE_QUOTE
     assert set(qs.get_symbols()) == {'SPY','QQQ'}
     assert set(qs.get_fields()) == set(fields)
+
+    # HASH (equal subs hash the same; symbol case/order don't matter)
+    h1 = QS(('spy', 'qqq'), (QS.FIELD_BID_PRICE, QS.FIELD_ASK_PRICE))
+    h2 = QS(('QQQ', 'SPY'), (QS.FIELD_ASK_PRICE, QS.FIELD_BID_PRICE))
+    h3 = QS(('QQQ', 'SPY'), (QS.FIELD_ASK_PRICE, QS.FIELD_BID_PRICE),
+            stream.COMMAND_TYPE_UNSUBS)
+    h4 = QS(('SPY',), (QS.FIELD_ASK_PRICE, QS.FIELD_BID_PRICE))
+    assert h1 == h2
+    assert hash(h1) == hash(h2)
+    assert h1 != h3
+    assert h1 != h4
+    assert len({h1, h2, h3, h4}) == 3
+    assert h2 in {h1: None}
     
     # ADD     
     qs2 = QS(symbols, fields)
@@ -1143,6 +1196,126 @@ def test_streaming(creds):
     _pause(1)
 
 
+def test_streaming_filters(creds):
+    if not use_live_connection:
+        print("STREAMING FILTERS test requires 'use_live_connection=True'")
+        return
+
+    QS = stream.QuotesSubscription
+    seen = set()
+
+    def callback(cb, ss, ts, msg):
+        if cb == stream.CALLBACK_TYPE_DATA and ss == stream.SERVICE_TYPE_QUOTE:
+            seen.update(item['key'] for item in msg)
+
+    session = stream.StreamingSession(creds, callback)
+
+    try:
+        session.set_filter_symbols(stream.SERVICE_TYPE_NONE, 'SPY')
+        raise Exception("failed to catch exception(1)")
+    except clib.CLibException as e:
+        print("+ successfully caught exception: ", str(e))
+    try:
+        session.add_filter_rule(stream.SERVICE_TYPE_QUOTE, QS.FIELD_LAST_PRICE,
+                                stream.FILTER_RULE_DELTA, 0.0)
+        raise Exception("failed to catch exception(2)")
+    except clib.CLibException as e:
+        print("+ successfully caught exception: ", str(e))
+    try:
+        session.add_filter_rule(stream.SERVICE_TYPE_QUOTE, -1,
+                                stream.FILTER_RULE_CHANGED)
+        raise Exception("failed to catch exception(3)")
+    except clib.CLibException as e:
+        print("+ successfully caught exception: ", str(e))
+
+    session.set_filter_symbols(stream.SERVICE_TYPE_QUOTE, 'SPY')
+    qs = QS(('SPY', 'QQQ'), (QS.FIELD_SYMBOL, QS.FIELD_BID_PRICE,
+                             QS.FIELD_ASK_PRICE))
+    assert all(session.start(qs))
+    sleep(5)
+    session.stop()
+
+    passed, dropped = session.get_filter_stats(stream.SERVICE_TYPE_QUOTE)
+    print("+ filter stats (passed, dropped):", passed, dropped)
+    assert 'QQQ' not in seen
+    assert passed or 'SPY' not in seen
+
+    session.clear_filter()
+    assert session.get_filter_stats(stream.SERVICE_TYPE_QUOTE) == (0, 0)
+
+    session = None
+    gc.collect()
+
+
+def test_streaming_routes(creds):
+    if not use_live_connection:
+        print("STREAMING ROUTES test requires 'use_live_connection=True'")
+        return
+
+    QS = stream.QuotesSubscription
+    routed = set()
+    unrouted = set()
+
+    def quote_keys(keys, cb, ss, msg):
+        if cb == stream.CALLBACK_TYPE_DATA and ss == stream.SERVICE_TYPE_QUOTE:
+            keys.update(item['key'] for item in msg)
+
+    def routed_callback(cb, ss, ts, msg):
+        quote_keys(routed, cb, ss, msg)
+
+    def unrouted_callback(cb, ss, ts, msg):
+        quote_keys(unrouted, cb, ss, msg)
+
+    session = stream.StreamingSession(creds, unrouted_callback)
+
+    try:
+        session.add_route(stream.SERVICE_TYPE_NONE, routed_callback)
+        raise Exception("failed to catch exception(1)")
+    except clib.CLibException as e:
+        print("+ successfully caught exception: ", str(e))
+    try:
+        session.add_route(stream.SERVICE_TYPE_QUOTE, routed_callback, '')
+        raise Exception("failed to catch exception(2)")
+    except clib.CLibException as e:
+        print("+ successfully caught exception: ", str(e))
+    try:
+        session.remove_route(-1)
+        raise Exception("failed to catch exception(3)")
+    except clib.CLibException as e:
+        print("+ successfully caught exception: ", str(e))
+
+    rid = session.add_route(stream.SERVICE_TYPE_QUOTE, routed_callback, 'spy')
+    qs = QS(('SPY', 'QQQ'), (QS.FIELD_SYMBOL, QS.FIELD_BID_PRICE,
+                             QS.FIELD_ASK_PRICE))
+    assert all(session.start(qs))
+    sleep(5)
+    session.stop()
+
+    print("+ routed:", routed, "catch-all:", unrouted)
+    assert 'SPY' in routed
+    assert 'QQQ' in unrouted
+    assert 'QQQ' not in routed
+    assert 'SPY' not in unrouted
+
+    session.remove_route(rid)
+    try:
+        session.remove_route(rid)
+        raise Exception("failed to catch exception(4)")
+    except clib.CLibException as e:
+        print("+ successfully caught exception: ", str(e))
+
+    rid = session.add_route(stream.SERVICE_TYPE_QUOTE, routed_callback)
+    session.clear_routes()
+    try:
+        session.remove_route(rid)
+        raise Exception("failed to catch exception(5)")
+    except clib.CLibException as e:
+        print("+ successfully caught exception: ", str(e))
+
+    session = None
+    gc.collect()
+
+
 def test_execute_order_objects():
     def test_exc(n, func, *args):
         try:
@@ -2760,6 +2933,109 @@ def test_execute_oco_oto_builders():
     print(oto1.as_json())
 
 
+# argument checks only, nothing is sent
+def test_execute_replace_order(creds, account_id):
+    order = execute.SimpleOrderBuilder.Equity.Build("SPY", 1, True, True, 1.00)
+
+    execute.reset_latency_stats()
+    try:
+        execute.replace_order(creds, account_id, "", order)
+        raise Exception("failed to catch exception(1)")
+    except clib.CLibException as e:
+        print("+ successfully caught exception: ", str(e))
+    try:
+        execute.replace_order(creds, account_id, "1", None)
+        raise Exception("failed to catch exception(2)")
+    except TypeError as e:
+        print("+ successfully caught exception: ", str(e))
+
+    stats = execute.get_latency_stats()
+    assert stats.replace.ncalls == 0
+    assert stats.replace.nerrors == 0
+
+
+# paper account, so nothing is sent; quotes are set by hand
+def test_execute_paper_broker(creds):
+    ACCT = "PAPER_TEST"
+    activity = []
+
+    def callback(timestamp, items):
+        activity.append(items)
+
+    def status(oid):
+        return get.OrderGetter(creds, ACCT, oid).get()["status"]
+
+    execute.paper_add_account(ACCT)
+    try:
+        try:
+            execute.paper_add_account(ACCT)
+            raise Exception("failed to catch exception(1)")
+        except clib.CLibException as e:
+            print("+ successfully caught exception: ", str(e))
+        assert execute.paper_is_account(ACCT)
+
+        execute.paper_set_live_quotes(False)
+        execute.paper_set_latency(ACCT, 0)
+        execute.paper_set_fill_model(ACCT, execute.PAPER_FILL_MODEL_TOUCH)
+        assert execute.paper_get_fill_model(ACCT) \
+            == execute.PAPER_FILL_MODEL_TOUCH
+        execute.paper_set_activity_callback(callback)
+        execute.paper_set_quote("SPY", 99.99, 100.01, 1000, 1000, 1000)
+
+        # market fills at the ask
+        order = execute.SimpleOrderBuilder.Equity.Build("SPY", 10, True, True)
+        oid1 = execute.send_order(creds, ACCT, order)
+        o = get.OrderGetter(creds, ACCT, oid1).get()
+        assert o["status"] == "FILLED"
+        assert o["filledQuantity"] == 10
+        leg = o["orderActivityCollection"][0]["executionLegs"][0]
+        assert abs(leg["price"] - 100.01) < .001
+
+        # limit below the ask rests, replace moves it, fills when touched
+        order = execute.SimpleOrderBuilder.Equity.Build("SPY", 10, True, True,
+                                                        99.00)
+        oid2 = execute.send_order(creds, ACCT, order)
+        execute.paper_set_quote("SPY", 99.99, 100.01, 1000, 1000, 2000)
+        assert status(oid2) == "WORKING"
+        order = execute.SimpleOrderBuilder.Equity.Build("SPY", 10, True, True,
+                                                        99.50)
+        oid3 = execute.replace_order(creds, ACCT, oid2, order)
+        assert oid3 != oid2
+        assert status(oid2) == "REPLACED"
+        execute.paper_set_quote("SPY", 99.40, 99.50, 1000, 1000, 3000)
+        assert status(oid3) == "FILLED"
+        try:
+            execute.replace_order(creds, ACCT, oid3, order)
+            raise Exception("failed to catch exception(2)")
+        except clib.CLibException as e:
+            print("+ successfully caught exception: ", str(e))
+
+        # cancel
+        order = execute.SimpleOrderBuilder.Equity.Build("SPY", 10, True, True,
+                                                        90.00)
+        oid4 = execute.send_order(creds, ACCT, order)
+        execute.paper_set_quote("SPY", 99.40, 99.50, 1000, 1000, 4000)
+        assert execute.cancel_order(creds, ACCT, oid4)
+        assert status(oid4) == "CANCELED"
+        try:
+            execute.cancel_order(creds, ACCT, oid4)
+            raise Exception("failed to catch exception(3)")
+        except clib.CLibException as e:
+            print("+ successfully caught exception: ", str(e))
+        try:
+            execute.cancel_order(creds, ACCT, "999999")
+            raise Exception("failed to catch exception(4)")
+        except clib.CLibException as e:
+            print("+ successfully caught exception: ", str(e))
+
+        assert activity
+    finally:
+        execute.paper_set_activity_callback(None)
+        execute.paper_remove_account(ACCT)
+        execute.paper_set_live_quotes(True)
+    assert not execute.paper_is_account(ACCT)
+
+
 # LIVE ORDERS !
 #def test_execute_transactions(creds, account_id):
 #    order = execute.SimpleOrderBuilder.Equity.Build("XLF", 1, True, True, 1.99)
@@ -2806,6 +3082,8 @@ if __name__ == '__main__':
         test(test_option_symbol_builder)
         test(test_execute_order_objects)
         test(test_execute_order_builders)
+        test(test_execute_replace_order, cm.credentials, args.account_id)
+        test(test_execute_paper_broker, cm.credentials)
         test(test_share_connections)
         test(test_quote_getters, cm.credentials)
         test(test_throttling, cm.credentials)
@@ -2827,5 +3105,7 @@ if __name__ == '__main__':
         test(test_instrument_info_getters, cm.credentials)
         test(test_order_getters, cm.credentials, args.account_id)
         test(test_streaming, cm.credentials)
+        test(test_streaming_filters, cm.credentials)
+        test(test_streaming_routes, cm.credentials)
                 
 
@@ -0,0 +1,142 @@
+#
+# Copyright (C) 2019 Jonathon Ogden <jeog.dev@gmail.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see http://www.gnu.org/licenses.
+#
+
+"""flight_decode.py - print a flight recorder dump
+
+flight_decode.py reads the file written by the library's flight recorder
+(SetFlightRecorderPath/DumpFlightRecorder, see include/_flight_recorder.h)
+and prints the events of all threads in time order:
+
+    <local time> <ms before dump> <thread> <event> <details>
+
+(The dump is in the native layout of the machine that wrote it.)
+"""
+
+import sys, argparse, struct, datetime
+
+FILE_HEADER = struct.Struct("<8sIIqqq256s")
+RING_HEADER = struct.Struct("<QQII")
+EVENT = struct.Struct("<QqqqH30s")
+MAGIC = b"TDMAFR01"
+
+# order of flight::EventType
+EVENT_TYPES = [
+    ("none", lambda t,a,b: ""),
+    ("request_start", lambda t,a,b: t),
+    ("request_end", lambda t,a,b: "%s status=%d %dus" % (t, a, b)),
+    ("throttle", lambda t,a,b: "client=%s wait=%dms gets=%d" % (t, a, b)),
+    ("token_refresh", lambda t,a,b: "client=%s ok=%d" % (t, a)),
+    ("ws_connect", lambda t,a,b: ""),
+    ("ws_disconnect", lambda t,a,b: "code=%d %s" % (a, t)),
+    ("ws_error", lambda t,a,b: ""),
+    ("ws_frame", lambda t,a,b: "%d bytes opcode=%d" % (a, b)),
+    ("frame_parsed", lambda t,a,b: "%s items=%d" % (t, a)),
+    ("subscription_request", lambda t,a,b: "%s id=%d" % (t, a)),
+    ("subscription_response", lambda t,a,b: "%s id=%d code=%d" % (t, a, b)),
+    ("exception", lambda t,a,b: "%s (code=%d line=%d)" % (t, a, b)),
+    ("listening_stop", lambda t,a,b: t)
+    ]
+
+parser = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+
+parser.add_argument("path", help="path of the dump file")
+parser.add_argument("-n", "--last", type=int, default=0,
+                    help="only the last N events")
+parser.add_argument("-t", "--thread", type=int, default=0,
+                    help="only events of this thread id")
+parser.add_argument("--utc", action="store_true",
+                    help="print times in UTC (default local)")
+
+
+def read_dump(path):
+    with open(path, "rb") as f:
+        data = f.read()
+
+    if len(data) < FILE_HEADER.size:
+        raise ValueError("file too small for header")
+    magic, event_size, ring_size, steady_ns, system_ns, pid, reason = \
+        FILE_HEADER.unpack_from(data, 0)
+    if magic != MAGIC:
+        raise ValueError("invalid magic: %s" % magic)
+    if event_size != EVENT.size:
+        raise ValueError("unexpected event size: %d" % event_size)
+
+    hdr = { "steady_ns" : steady_ns,
+            "system_ns" : system_ns,
+            "pid" : pid,
+            "reason" : reason.split(b"\0", 1)[0].decode(errors="replace"),
+            "threads" : [] }
+    events = []
+
+    off = FILE_HEADER.size
+    ring_bytes = RING_HEADER.size + ring_size * event_size
+    while off + ring_bytes <= len(data):
+        tid, head, alive, _ = RING_HEADER.unpack_from(data, off)
+        hdr["threads"].append((tid, head, bool(alive)))
+        off += RING_HEADER.size
+        for i in range(ring_size):
+            seq, ts, a, b, ty, text = EVENT.unpack_from(data, off)
+            off += event_size
+            # valid if seq - 1 is in [head - ring_size, head)
+            if seq == 0 or seq > head or seq + ring_size <= head:
+                continue
+            if seq % ring_size != (i + 1) % ring_size:
+                continue
+            text = text.split(b"\0", 1)[0].decode(errors="replace")
+            events.append((ts, tid, seq, ty, a, b, text))
+
+    events.sort()
+    return hdr, events
+
+
+def main():
+    args = parser.parse_args()
+    try:
+        hdr, events = read_dump(args.path)
+    except (OSError, ValueError) as e:
+        print("failed to read dump: %s" % e, file=sys.stderr)
+        return 1
+
+    if args.thread:
+        events = [e for e in events if e[1] == args.thread]
+    if args.last > 0:
+        events = events[-args.last:]
+
+    tz = datetime.timezone.utc if args.utc else None
+    def wall(ts):
+        ns = hdr["system_ns"] - (hdr["steady_ns"] - ts)
+        t = datetime.datetime.fromtimestamp(ns / 1e9, tz)
+        return t.strftime("%Y-%m-%d %H:%M:%S.%f")
+
+    print("pid: %d" % hdr["pid"])
+    print("reason: %s" % hdr["reason"])
+    print("dumped: %s" % wall(hdr["steady_ns"]))
+    for tid, head, alive in hdr["threads"]:
+        print("thread %d: %d events%s" % (tid, head, "" if alive else " (exited)"))
+    print()
+
+    for ts, tid, seq, ty, a, b, text in events:
+        name, fmt = EVENT_TYPES[ty] if ty < len(EVENT_TYPES) \
+                                    else ("type(%d)" % ty, lambda t,a,b: t)
+        print("%s %10.3f %7d %-21s %s" % (wall(ts), (ts - hdr["steady_ns"]) / 1e6,
+                                          tid, name, fmt(text, a, b)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
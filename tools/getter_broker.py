@@ -0,0 +1,95 @@
+#
+# Copyright (C) 2019 Jonathon Ogden <jeog.dev@gmail.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see http://www.gnu.org/licenses.
+#
+
+"""getter_broker.py - share one getter throttle between local processes
+
+dependencies:
+    tdma_api   :: python setup.py install (from project's python directory)
+
+getter_broker.py will:
+    1) Load (and on exit, store) the Credentials object
+    2) Listen for getter requests on a unix socket
+    3) Make the requests using one global throttle, coalescing identical
+       in-flight requests and caching responses for --cache-msec
+
+Other processes send their getter requests here by calling
+get.use_broker(path) (APIGetter::use_broker in C++, APIGetter_UseBroker in C).
+
+"""
+
+from tdma_api import auth, clib, get
+import sys, argparse, signal
+
+parser = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+
+parser.add_argument("credentials_path", metavar="credentials-path",
+                    help="location of encrypted credentials file", type=str)
+parser.add_argument("credentials_password", metavar="credentials-password",
+                    help="password used to encrypt/decrypt credentials file",
+                    type=str)
+parser.add_argument("socket_path", metavar="socket-path",
+                    help="unix socket path clients connect to", type=str)
+parser.add_argument("--cache-msec",
+                    help="milliseconds to cache responses (0 to disable)",
+                    type=int)
+parser.add_argument("--wait-msec",
+                    help="minimum milliseconds between requests", type=int)
+parser.add_argument("--library-path", help="load C library from custom path",
+                    type=str)
+
+
+def main():
+    args = parser.parse_args()
+
+    if args.library_path:
+        try:
+            clib.init(args.library_path, reload=True)
+        except Exception as exc:
+            print(" - Error initializing C library:", str(exc))
+
+    if not clib._lib:
+        print(" - FAILURE: C library not loaded")
+        return False
+
+    if args.wait_msec is not None:
+        get.set_wait_msec(args.wait_msec)
+
+    done = []
+    for sig in (signal.SIGINT, signal.SIGTERM):
+        signal.signal(sig, lambda *_: done.append(True))
+
+    try:
+        with auth.CredentialsManager(args.credentials_path,
+                                     args.credentials_password) as cm:
+            get.start_broker(cm.credentials, args.socket_path, args.cache_msec)
+            print(" + Broker listening on", args.socket_path)
+            print("   Wait MSec:", get.get_wait_msec())
+            while not done:
+                signal.pause()
+            get.stop_broker()
+            print(" + Broker stopped")
+    except clib.CLibException as exc:
+        print(" - FAILURE:", str(exc))
+        return False
+
+    return True
+
+
+if __name__ == '__main__':
+    if not main():
+        exit(1)
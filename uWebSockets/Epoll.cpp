@@ -9,7 +9,79 @@ std::recursive_mutex cbMutex;
 void (*callbacks[16])(Poll *, int, int);
 int cbHead = 0;
 
+std::atomic<bool> preferIoUring(false);
+
+// eventfd in the ring that runs the posted changes; not counted in numPolls
+struct Wakeup : Poll {
+    Wakeup(Loop *loop) : Poll(loop, ::eventfd(0, EFD_CLOEXEC)) {
+        loop->numPolls--;
+        setCb([](Poll *p, int, int) {
+            uint64_t val;
+            if (::read(((Wakeup *) p)->state.fd, &val, 8) == 8) {
+                ((Wakeup *) p)->loop->runPosted();
+            }
+        });
+        Poll::start(loop, this, UV_READABLE);
+        this->loop = loop;
+    }
+
+    void send() {
+        uint64_t one = 1;
+        if (::write(state.fd, &one, 8) != 8) {
+            return;
+        }
+    }
+
+    void destroy() {
+        Poll::stop(loop);
+        ::close(state.fd);
+        delete this;
+    }
+
+    Loop *loop;
+};
+
+void Loop::createWakeup() {
+    wakeup = new Wakeup(this);
+}
+
+void Loop::destroyWakeup() {
+    if (wakeup) {
+        ((Wakeup *) wakeup)->destroy();
+        wakeup = nullptr;
+    }
+}
+
+void Loop::post(Poll *poll, void (*cb)(Poll *)) {
+    postedMutex.lock();
+    bool wasEmpty = posted.empty();
+    posted.push_back({poll, cb});
+    postedMutex.unlock();
+
+    if (wasEmpty) {
+        ((Wakeup *) wakeup)->send();
+    }
+}
+
+void Loop::runPosted() {
+    postedMutex.lock();
+    std::vector<std::pair<Poll *, void (*)(Poll *)>> p;
+    p.swap(posted);
+    postedMutex.unlock();
+
+    for (std::pair<Poll *, void (*)(Poll *)> c : p) {
+        // closed since (not yet freed: that's done below, in doEpoll)
+        if (!c.first->isClosed()) {
+            c.second(c.first);
+        }
+    }
+}
+
 void Loop::doEpoll(int epollTimeout) {
+    if (wakeup) {
+        runPosted();
+    }
+
     for (std::pair<Poll *, void (*)(Poll *)> c : closing) {
         numPolls--;
 
@@ -22,17 +94,26 @@ void Loop::doEpoll(int epollTimeout) {
     }
     closing.clear();
 
-    int numFdReady = epoll_wait(epfd, readyEvents, 1024, epollTimeout);
+    int numFdReady = ring ? ring->wait(epollTimeout) : epoll_wait(epfd, readyEvents, 1024, epollTimeout);
     timepoint = std::chrono::system_clock::now();
 
     if (preCb) {
         preCb(preCbData);
     }
 
-    for (int i = 0; i < numFdReady; i++) {
-        Poll *poll = (Poll *) readyEvents[i].data.ptr;
-        int status = -bool(readyEvents[i].events & EPOLLERR);
-        callbacks[poll->state.cbIndex](poll, status, readyEvents[i].events);
+    if (ring) {
+        IoUring::Ready *ready = ring->getReady();
+        for (int i = 0; i < numFdReady; i++) {
+            Poll *poll = ready[i].poll;
+            int status = -bool(ready[i].events & EPOLLERR);
+            callbacks[poll->state.cbIndex](poll, status, ready[i].events);
+        }
+    } else {
+        for (int i = 0; i < numFdReady; i++) {
+            Poll *poll = (Poll *) readyEvents[i].data.ptr;
+            int status = -bool(readyEvents[i].events & EPOLLERR);
+            callbacks[poll->state.cbIndex](poll, status, readyEvents[i].events);
+        }
     }
 
     while (timers.size() && timers[0].timepoint < timepoint) {
@@ -58,6 +139,7 @@ void Loop::doEpoll(int epollTimeout) {
 }
 
 void Loop::run() {
+    tid = pthread_self();
     // updated for consistency with libuv impl. behaviour
     timepoint = std::chrono::system_clock::now();
     while (numPolls) {
@@ -66,6 +148,7 @@ void Loop::run() {
 }
 
 void Loop::poll() {
+    tid = pthread_self();
     if (numPolls) {
         doEpoll(0);
     } else {
@@ -5,10 +5,14 @@
 #include <sys/eventfd.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <chrono>
 #include <algorithm>
 #include <vector>
 #include <mutex>
+#include <atomic>
+
+#include "IoUring.h"
 
 typedef int uv_os_sock_t;
 static const int UV_READABLE = EPOLLIN;
@@ -23,6 +27,9 @@ extern std::recursive_mutex cbMutex;
 extern void (*callbacks[16])(Poll *, int, int);
 extern int cbHead;
 
+// loops created after this is set use io_uring (if available) instead of epoll
+extern std::atomic<bool> preferIoUring;
+
 struct Timepoint {
     void (*cb)(Timer *);
     Timer *timer;
@@ -32,6 +39,7 @@ struct Timepoint {
 
 struct Loop {
     int epfd;
+    IoUring *ring = nullptr; // used instead of epfd if set
     int numPolls = 0;
     bool cancelledLastTimer;
     int delay = -1;  // delay to next timer expiry, or -1 if no timers pending
@@ -39,14 +47,28 @@ struct Loop {
     std::chrono::system_clock::time_point timepoint;
     std::vector<Timepoint> timers;
     std::vector<std::pair<Poll *, void (*)(Poll *)>> closing;
+    std::atomic<pthread_t> tid; // last thread to run/poll (or create) it
+
+    // io_uring: changes posted from other threads w/o an Async of their own,
+    // applied on the loop's thread; 'wakeup' (eventfd) interrupts the wait
+    std::mutex postedMutex;
+    std::vector<std::pair<Poll *, void (*)(Poll *)>> posted;
+    Poll *wakeup = nullptr;
 
     void (*preCb)(void *) = nullptr;
     void (*postCb)(void *) = nullptr;
     void *preCbData, *postCbData;
 
     Loop(bool defaultLoop) {
-        epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (preferIoUring) {
+            ring = IoUring::create();
+        }
+        epfd = ring ? -1 : epoll_create1(EPOLL_CLOEXEC);
         timepoint = std::chrono::system_clock::now();
+        tid = pthread_self();
+        if (ring) {
+            createWakeup();
+        }
     }
 
     static Loop *createLoop(bool defaultLoop = true) {
@@ -54,18 +76,48 @@ struct Loop {
     }
 
     void destroy() {
-        ::close(epfd);
+        destroyWakeup();
+        delete ring;
+        if (epfd != -1) {
+            ::close(epfd);
+        }
         delete this;
     }
 
     void doEpoll(int epollTimeout);
 
+    // run 'cb(poll)' on the loop's thread (from any thread)
+    void post(Poll *poll, void (*cb)(Poll *));
+
+    void runPosted();
+
+    void createWakeup();
+
+    void destroyWakeup();
+
     void run();
 
     void poll();
 
+    // submit queued io_uring changes now instead of w/ the next wait, e.g.
+    // before waiting on getEpollFd() from another loop (no-op w/ epoll)
+    void flush() {
+        if (ring) {
+            ring->flush();
+        }
+    }
+
+    bool isIoUring() {
+        return ring != nullptr;
+    }
+
+    bool onLoopThread() {
+        return pthread_equal(tid.load(), pthread_self());
+    }
+
+    // readable when there are events to process (epoll or io_uring fd)
     int getEpollFd() {
-        return epfd;
+        return ring ? ring->getFd() : epfd;
     }
 };
 
@@ -166,6 +218,10 @@ protected:
     }
 
     void start(Loop *loop, Poll *self, int events) {
+        if (loop->ring) {
+            loop->ring->add(state.fd, self, events);
+            return;
+        }
         epoll_event event;
         event.events = events;
         event.data.ptr = self;
@@ -173,6 +229,10 @@ protected:
     }
 
     void change(Loop *loop, Poll *self, int events) {
+        if (loop->ring) {
+            loop->ring->change(state.fd, self, events);
+            return;
+        }
         epoll_event event;
         event.events = events;
         event.data.ptr = self;
@@ -180,6 +240,10 @@ protected:
     }
 
     void stop(Loop *loop) {
+        if (loop->ring) {
+            loop->ring->remove(state.fd);
+            return;
+        }
         epoll_event event;
         epoll_ctl(loop->epfd, EPOLL_CTL_DEL, state.fd, &event);
     }
@@ -193,7 +257,12 @@ protected:
         return true;
     }
 
+    // epoll_ctl is thread-safe but the io_uring queue isn't: from another
+    // thread return false and changePoll() queues it for the loop's thread
     bool threadSafeChange(Loop *loop, Poll *self, int events) {
+        if (loop->ring && !loop->onLoopThread()) {
+            return false;
+        }
         change(loop, self, events);
         return true;
     }
@@ -75,6 +75,7 @@ public:
     using uS::Node::run;
     using uS::Node::poll;
     using uS::Node::getLoop;
+    using uS::Node::setLoopThread;
     using Group<SERVER>::onConnection;
     using Group<CLIENT>::onConnection;
     using Group<SERVER>::onTransfer;
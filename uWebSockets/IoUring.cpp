@@ -0,0 +1,381 @@
+#include "Backend.h"
+
+#ifdef USE_EPOLL
+
+#include <sys/epoll.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define UWS_HAS_IO_URING
+#endif
+#endif
+
+#ifdef UWS_HAS_IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <csignal>
+#include <cstring>
+#include <cerrno>
+
+namespace uS {
+
+namespace {
+
+const uint64_t REMOVE_TAG = ~0ULL; // user_data of POLL_REMOVEs, completions ignored
+
+int sysSetup(unsigned entries, io_uring_params *p) {
+    return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+int sysEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, void *arg, size_t argSize) {
+    return (int) syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize);
+}
+
+inline unsigned loadAcquire(unsigned *p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+inline void storeRelease(unsigned *p, unsigned v) {
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+inline uint64_t userData(int fd, uint32_t gen) {
+    return ((uint64_t) gen << 32) | (uint32_t) fd;
+}
+
+}
+
+IoUring::IoUring() : ringFd(-1), entries(0), sqMap(MAP_FAILED), cqMap(MAP_FAILED), sqesMap(MAP_FAILED),
+    sqMapSize(0), cqMapSize(0), sqesMapSize(0), sqLocalTail(0), toSubmit(0) {
+
+}
+
+IoUring *IoUring::create(unsigned entries) {
+    IoUring *ring = new IoUring;
+    if (!ring->setup(entries)) {
+        delete ring;
+        return nullptr;
+    }
+    return ring;
+}
+
+bool IoUring::available() {
+    static bool result = [] {
+        IoUring *ring = create(8);
+        delete ring;
+        return ring != nullptr;
+    }();
+    return result;
+}
+
+bool IoUring::setup(unsigned entries) {
+    io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_CLAMP;
+    ringFd = sysSetup(entries, &p);
+    if (ringFd < 0) {
+        return false;
+    }
+
+    // NODROP: completions are never lost; EXT_ARG: waits w/ a timeout
+    const unsigned needed = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+    if ((p.features & needed) != needed) {
+        return false;
+    }
+
+    this->entries = p.sq_entries;
+    sqMapSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cqMapSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    sqMapSize = cqMapSize = std::max(sqMapSize, cqMapSize);
+
+    sqMap = mmap(nullptr, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (sqMap == MAP_FAILED) {
+        return false;
+    }
+    cqMap = sqMap;
+
+    sqesMapSize = p.sq_entries * sizeof(io_uring_sqe);
+    sqesMap = mmap(nullptr, sqesMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (sqesMap == MAP_FAILED) {
+        return false;
+    }
+
+    char *sq = (char *) sqMap;
+    sqHead = (unsigned *) (sq + p.sq_off.head);
+    sqTail = (unsigned *) (sq + p.sq_off.tail);
+    sqMask = (unsigned *) (sq + p.sq_off.ring_mask);
+    sqArray = (unsigned *) (sq + p.sq_off.array);
+    sqes = sqesMap;
+
+    char *cq = (char *) cqMap;
+    cqHead = (unsigned *) (cq + p.cq_off.head);
+    cqTail = (unsigned *) (cq + p.cq_off.tail);
+    cqMask = (unsigned *) (cq + p.cq_off.ring_mask);
+    cqes = cq + p.cq_off.cqes;
+
+    // sqe i always goes in slot i
+    for (unsigned i = 0; i < p.sq_entries; i++) {
+        sqArray[i] = i;
+    }
+    sqLocalTail = *sqTail;
+    return true;
+}
+
+IoUring::~IoUring() {
+    if (sqesMap != MAP_FAILED) {
+        munmap(sqesMap, sqesMapSize);
+    }
+    if (sqMap != MAP_FAILED) {
+        munmap(sqMap, sqMapSize);
+    }
+    if (ringFd >= 0) {
+        ::close(ringFd);
+    }
+}
+
+IoUring::Slot &IoUring::slot(int fd) {
+    if ((size_t) fd >= slots.size()) {
+        slots.resize(fd + 1);
+    }
+    return slots[fd];
+}
+
+void *IoUring::nextSqe() {
+    if (sqLocalTail - loadAcquire(sqHead) >= entries) {
+        // full, submit what we have
+        storeRelease(sqTail, sqLocalTail);
+        enter(0, 0);
+        if (sqLocalTail - loadAcquire(sqHead) >= entries) {
+            return nullptr;
+        }
+    }
+    io_uring_sqe *sqe = (io_uring_sqe *) sqes + (sqLocalTail & *sqMask);
+    memset(sqe, 0, sizeof(io_uring_sqe));
+    sqLocalTail++;
+    toSubmit++;
+    return sqe;
+}
+
+void IoUring::queuePollAdd(int fd, Slot &slot) {
+    io_uring_sqe *sqe = (io_uring_sqe *) nextSqe();
+    if (!sqe) {
+        // retried w/ the next batch
+        if (!slot.queued) {
+            slot.queued = true;
+            rearm.push_back(fd);
+        }
+        return;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    sqe->poll32_events = ((uint32_t) slot.events << 16) | ((uint32_t) slot.events >> 16); // halfword-swapped, see io_uring_prep_poll_add
+#else
+    sqe->poll32_events = (uint32_t) slot.events;
+#endif
+    sqe->user_data = userData(fd, slot.gen);
+    slot.armed = true;
+}
+
+void IoUring::queuePollRemove(int fd, Slot &slot) {
+    io_uring_sqe *sqe = (io_uring_sqe *) nextSqe();
+    if (!sqe) {
+        // its completion will be ignored anyway (gen)
+        return;
+    }
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = userData(fd, slot.gen);
+    sqe->user_data = REMOVE_TAG;
+}
+
+void IoUring::queueRearms() {
+    // swap, queuePollAdd can re-queue
+    std::vector<int> fds;
+    fds.swap(rearm);
+    for (int fd : fds) {
+        Slot &s = slots[fd];
+        if (!s.queued) {
+            continue;
+        }
+        s.queued = false;
+        if (s.poll && !s.armed) {
+            queuePollAdd(fd, s);
+        }
+    }
+    if (rearm.empty()) {
+        fds.clear();
+        rearm.swap(fds); // keep the capacity
+    }
+}
+
+int IoUring::enter(unsigned minComplete, int timeoutMs) {
+    storeRelease(sqTail, sqLocalTail);
+
+    unsigned flags = minComplete ? IORING_ENTER_GETEVENTS : 0;
+    int ret;
+    if (minComplete && timeoutMs >= 0) {
+        __kernel_timespec ts;
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = (long long) (timeoutMs % 1000) * 1000000;
+        io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = (uint64_t) (uintptr_t) &ts;
+        ret = sysEnter(ringFd, toSubmit, minComplete, flags | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    } else {
+        ret = sysEnter(ringFd, toSubmit, minComplete, flags, nullptr, 0);
+    }
+
+    if (ret > 0) {
+        toSubmit -= std::min<unsigned>(ret, toSubmit);
+    } else if (ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY && errno != EAGAIN) {
+        // nothing more we can do w/ these
+        toSubmit = 0;
+    }
+    return ret;
+}
+
+void IoUring::add(int fd, Poll *poll, int events) {
+    Slot &s = slot(fd);
+    s.poll = poll;
+    s.events = events;
+    s.gen++;
+    s.armed = false;
+    if (!s.queued) {
+        s.queued = true;
+        rearm.push_back(fd);
+    }
+}
+
+void IoUring::change(int fd, Poll *poll, int events) {
+    Slot &s = slot(fd);
+    if (s.armed) {
+        queuePollRemove(fd, s);
+        s.armed = false;
+        s.gen++;
+    }
+    s.poll = poll;
+    s.events = events;
+    if (!s.queued) {
+        s.queued = true;
+        rearm.push_back(fd);
+    }
+}
+
+void IoUring::remove(int fd) {
+    if ((size_t) fd >= slots.size()) {
+        return;
+    }
+    Slot &s = slots[fd];
+    if (s.armed) {
+        queuePollRemove(fd, s);
+    }
+    s.poll = nullptr;
+    s.armed = false;
+    s.queued = false;
+    s.gen++;
+}
+
+int IoUring::wait(int timeoutMs) {
+    queueRearms();
+
+    unsigned head = *cqHead;
+    if (timeoutMs != 0 && head == loadAcquire(cqTail)) {
+        enter(1, timeoutMs);
+    } else if (toSubmit) {
+        enter(0, 0);
+    }
+
+    const int maxReady = sizeof(readyEvents) / sizeof(readyEvents[0]);
+    int numReady = 0;
+    unsigned tail = loadAcquire(cqTail);
+    // the rest wait for the next call (which then won't block)
+    for (; head != tail && numReady < maxReady; head++) {
+        io_uring_cqe *cqe = (io_uring_cqe *) cqes + (head & *cqMask);
+        if (cqe->user_data == REMOVE_TAG) {
+            continue;
+        }
+
+        int fd = (int) (uint32_t) cqe->user_data;
+        uint32_t gen = (uint32_t) (cqe->user_data >> 32);
+        if ((size_t) fd >= slots.size()) {
+            continue;
+        }
+        Slot &s = slots[fd];
+        if (s.gen != gen || !s.armed) {
+            // removed or changed since
+            continue;
+        }
+
+        // one-shot: re-armed w/ the next batch unless stopped/changed first
+        s.armed = false;
+        if (!s.queued) {
+            s.queued = true;
+            rearm.push_back(fd);
+        }
+        readyEvents[numReady++] = {s.poll, cqe->res < 0 ? (int) EPOLLERR : cqe->res};
+    }
+    storeRelease(cqHead, head);
+    return numReady;
+}
+
+void IoUring::flush() {
+    queueRearms();
+    if (toSubmit) {
+        enter(0, 0);
+    }
+}
+
+}
+
+#else
+
+namespace uS {
+
+// no <linux/io_uring.h> at build time: always falls back to epoll
+
+IoUring::IoUring() : ringFd(-1) {
+
+}
+
+IoUring *IoUring::create(unsigned) {
+    return nullptr;
+}
+
+bool IoUring::available() {
+    return false;
+}
+
+IoUring::~IoUring() {
+
+}
+
+void IoUring::add(int, Poll *, int) {
+
+}
+
+void IoUring::change(int, Poll *, int) {
+
+}
+
+void IoUring::remove(int) {
+
+}
+
+int IoUring::wait(int) {
+    return 0;
+}
+
+void IoUring::flush() {
+
+}
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef IOURING_H
+#define IOURING_H
+
+// io_uring readiness backend for the epoll Loop (see Epoll.h)
+//
+// Polls are armed one-shot w/ IORING_OP_POLL_ADD and re-armed after they
+// fire, so readiness stays level-triggered like epoll's. Re-arms and changes
+// are only queued; they're submitted together w/ the wait for completions
+// (one io_uring_enter per loop iteration instead of epoll_wait + an
+// epoll_ctl for every change).
+//
+// Needs IORING_FEAT_EXT_ARG (5.11+) for timed waits; create() returns
+// nullptr if io_uring is unavailable (old kernel, disabled, seccomp) and the
+// Loop falls back to epoll.
+
+#include <cstdint>
+#include <vector>
+
+namespace uS {
+
+struct Poll;
+
+class IoUring {
+public:
+    struct Ready {
+        Poll *poll;
+        int events; // poll revents, or EPOLLERR
+    };
+
+private:
+    struct Slot {
+        Poll *poll = nullptr;
+        uint32_t gen = 0; // bumped on every (re)arm/stop; stale completions don't match
+        int events = 0;
+        bool armed = false;
+        bool queued = false; // in 'rearm'
+    };
+
+    int ringFd;
+    unsigned entries;
+    void *sqMap, *cqMap, *sqesMap;
+    size_t sqMapSize, cqMapSize, sqesMapSize;
+    unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+    unsigned *cqHead, *cqTail, *cqMask;
+    void *sqes, *cqes;
+    unsigned sqLocalTail;
+    unsigned toSubmit;
+
+    std::vector<Slot> slots; // by fd
+    std::vector<int> rearm; // fds to arm before the next wait
+    Ready readyEvents[1024];
+
+    IoUring();
+
+    bool setup(unsigned entries);
+    void *nextSqe();
+    void queuePollAdd(int fd, Slot &slot);
+    void queuePollRemove(int fd, Slot &slot);
+    void queueRearms();
+    int enter(unsigned minComplete, int timeoutMs);
+    Slot &slot(int fd);
+
+public:
+    // nullptr if unavailable
+    static IoUring *create(unsigned entries = 256);
+
+    // can create() succeed here (probed once)
+    static bool available();
+
+    ~IoUring();
+
+    IoUring(const IoUring &) = delete;
+    IoUring &operator=(const IoUring &) = delete;
+
+    int getFd() {
+        return ringFd;
+    }
+
+    void add(int fd, Poll *poll, int events);
+    void change(int fd, Poll *poll, int events);
+    void remove(int fd);
+
+    // submit what's queued, wait up to timeoutMs (-1 forever, 0 not at all)
+    // for completions; returns # in getReady()
+    int wait(int timeoutMs);
+
+    Ready *getReady() {
+        return readyEvents;
+    }
+
+    // submit what's queued w/o waiting
+    void flush();
+};
+
+}
+
+#endif // IOURING_H
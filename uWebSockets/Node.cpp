@@ -67,9 +67,17 @@ void Node::run() {
 }
 
 void Node::poll() {
+    nodeData->tid = pthread_self();
     loop->poll();
 }
 
+void Node::setLoopThread() {
+    nodeData->tid = pthread_self();
+#ifdef USE_EPOLL
+    loop->tid = pthread_self();
+#endif
+}
+
 Node::~Node() {
     delete [] nodeData->recvBufferMemoryBlock;
     SSL_CTX_free(nodeData->clientContext);
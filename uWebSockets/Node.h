@@ -85,6 +85,9 @@ public:
     /* Non-blocking */
     void poll();
 
+    /* For a loop driven from outside (doEpoll) - make this its thread */
+    void setLoopThread();
+
     Loop *getLoop() {
         return loop;
     }
@@ -108,6 +108,16 @@ protected:
     void changePoll(Socket *socket) {
         if (!threadSafeChange(nodeData->loop, this, socket->getPoll())) {
             if (socket->nodeData->tid != pthread_self()) {
+#ifdef USE_EPOLL
+                // no Group::addAsync() (e.g. client hubs): the loop's own queue
+                if (!socket->nodeData->async) {
+                    socket->nodeData->loop->post(socket, [](Poll *p) {
+                        Socket *s = (Socket *) p;
+                        s->change(s->nodeData->loop, s, s->getPoll());
+                    });
+                    return;
+                }
+#endif
                 socket->nodeData->asyncMutex->lock();
                 socket->nodeData->changePollQueue.push_back(socket);
                 socket->nodeData->asyncMutex->unlock();